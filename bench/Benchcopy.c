@@ -0,0 +1,154 @@
+#include "bench.h"
+#include "intrinsics_utils.h"
+#include "cpu_flags.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+// Compare the copy kernels across register widths: contiguous copies of an
+// array that fits in cache, and 2D index generation and gather-copies of a
+// block of rows from a column-major grid. Timings are the best of several
+// runs, in nanoseconds per element. A second table times the copy2d
+// strategies on a tall grid, where the row indices no longer fit in cache.
+
+#define REPS 20
+#define TALL_NROWS (1 << 20)
+#define TALL_NCOLS 32
+
+int main(int argc, char *argv[])
+{
+    int nrows = argc > 1 ? strtol(argv[1], NULL, 10) : 1024;
+    int ncols = nrows;
+    int numi = nrows / 2 + 3;
+    int numj = ncols / 2;
+    int n = numi * numj;
+    float *src = malloc((size_t)nrows * ncols * sizeof(float));
+    float *dst = malloc(n * sizeof(float));
+    int *isrc = malloc(n * sizeof(int));
+    int *kind = malloc(n * sizeof(int));
+    int *iind = malloc(numi * sizeof(int));
+    int *jind = malloc(numj * sizeof(int));
+    int strategies[] = {COPY2D_CONTIGUOUS, COPY2D_SPLIT, COPY2D_TILED};
+    const char *names[] = {"contiguous", "split", "tiled"};
+    double ns;
+
+    if (src == NULL || dst == NULL || isrc == NULL || kind == NULL || iind == NULL || jind == NULL) {
+        fprintf(stderr, "allocation failed\n");
+        return 1;
+    }
+
+    random_farray(src, nrows * ncols, -1.0f, 1.0f);
+    random_index_array(isrc, n);
+    seq_index_array(iind, numi, (nrows - numi) / 2, 1);
+    seq_index_array(jind, numj, (ncols - numj) / 2, 1);
+
+    printf("%d x %d grid, %d x %d block (ns per element)\n\n", nrows, ncols, numi, numj);
+    printf("%-20s %8s %8s %8s\n", "kernel", "sse", "avx2", "avx512");
+
+    printf("%-20s", "copy1d_ps");
+    BENCH_BEST_NS(ns, REPS, n, _mm_copy1d_ps(dst, src, n));
+    printf(" %8.3f", ns);
+    BENCH_BEST_NS(ns, REPS, n, _mm256_copy1d_ps(dst, src, n));
+    printf(" %8.3f", ns);
+#ifdef SUPPORTS_AVX512
+    BENCH_BEST_NS(ns, REPS, n, _mm512_copy1d_ps(dst, src, n));
+    printf(" %8.3f", ns);
+#endif
+    printf("\n");
+
+    printf("%-20s", "copy1d_epi32");
+    BENCH_BEST_NS(ns, REPS, n, _mm_copy1d_epi32(kind, isrc, n));
+    printf(" %8.3f", ns);
+    BENCH_BEST_NS(ns, REPS, n, _mm256_copy1d_epi32(kind, isrc, n));
+    printf(" %8.3f", ns);
+#ifdef SUPPORTS_AVX512
+    BENCH_BEST_NS(ns, REPS, n, _mm512_copy1d_epi32(kind, isrc, n));
+    printf(" %8.3f", ns);
+#endif
+    printf("\n");
+
+    printf("%-20s", "copy2d_epi32");
+    BENCH_BEST_NS(ns, REPS, n, _mm_copy2d_epi32(kind, nrows, iind, jind, numi, numj));
+    printf(" %8.3f", ns);
+    BENCH_BEST_NS(ns, REPS, n, _mm256_copy2d_epi32(kind, nrows, iind, jind, numi, numj));
+    printf(" %8.3f", ns);
+#ifdef SUPPORTS_AVX512
+    BENCH_BEST_NS(ns, REPS, n, _mm512_copy2d_epi32(kind, nrows, iind, jind, numi, numj));
+    printf(" %8.3f", ns);
+#endif
+    printf("\n");
+
+    printf("%-20s", "copy2d_indexed_ps");
+    BENCH_BEST_NS(ns, REPS, n, _mm_copy2d_indexed_ps(dst, src, nrows, iind, jind, numi, numj));
+    printf(" %8.3f", ns);
+    BENCH_BEST_NS(ns, REPS, n, _mm256_copy2d_indexed_ps(dst, src, nrows, iind, jind, numi, numj));
+    printf(" %8.3f", ns);
+#ifdef SUPPORTS_AVX512
+    BENCH_BEST_NS(ns, REPS, n, _mm512_copy2d_indexed_ps(dst, src, nrows, iind, jind, numi, numj));
+    printf(" %8.3f", ns);
+#endif
+    printf("\n");
+
+    free(src);
+    free(dst);
+    free(isrc);
+    free(kind);
+    free(iind);
+    free(jind);
+
+    // Every other row of a tall grid, so each column's row indices span
+    // several times the L2 cache.
+    numi = TALL_NROWS / 2 - 3;
+    numj = TALL_NCOLS;
+    n = numi * numj;
+    src = malloc((size_t)TALL_NROWS * TALL_NCOLS * sizeof(float));
+    dst = malloc((size_t)n * sizeof(float));
+    kind = malloc((size_t)n * sizeof(int));
+    iind = malloc(numi * sizeof(int));
+    jind = malloc(numj * sizeof(int));
+
+    if (src == NULL || dst == NULL || kind == NULL || iind == NULL || jind == NULL) {
+        fprintf(stderr, "allocation failed\n");
+        return 1;
+    }
+
+    random_farray(src, TALL_NROWS * TALL_NCOLS, -1.0f, 1.0f);
+    seq_index_array(iind, numi, 0, 2);
+    seq_index_array(jind, numj, 0, 1);
+
+    printf("\n%d x %d grid, %d x %d block (ns per element)\n\n", TALL_NROWS, TALL_NCOLS, numi, numj);
+    printf("%-20s %-12s %8s %8s %8s\n", "kernel", "strategy", "sse", "avx2", "avx512");
+
+    for (int s = 0; s < 3; s++) {
+        iu_set_copy2d_strategy(strategies[s]);
+
+        printf("%-20s %-12s", "copy2d_epi32", names[s]);
+        BENCH_BEST_NS(ns, REPS, n, _mm_copy2d_epi32(kind, TALL_NROWS, iind, jind, numi, numj));
+        printf(" %8.3f", ns);
+        BENCH_BEST_NS(ns, REPS, n, _mm256_copy2d_epi32(kind, TALL_NROWS, iind, jind, numi, numj));
+        printf(" %8.3f", ns);
+#ifdef SUPPORTS_AVX512
+        BENCH_BEST_NS(ns, REPS, n, _mm512_copy2d_epi32(kind, TALL_NROWS, iind, jind, numi, numj));
+        printf(" %8.3f", ns);
+#endif
+        printf("\n");
+
+        printf("%-20s %-12s", "copy2d_indexed_ps", names[s]);
+        BENCH_BEST_NS(ns, REPS, n, _mm_copy2d_indexed_ps(dst, src, TALL_NROWS, iind, jind, numi, numj));
+        printf(" %8.3f", ns);
+        BENCH_BEST_NS(ns, REPS, n, _mm256_copy2d_indexed_ps(dst, src, TALL_NROWS, iind, jind, numi, numj));
+        printf(" %8.3f", ns);
+#ifdef SUPPORTS_AVX512
+        BENCH_BEST_NS(ns, REPS, n, _mm512_copy2d_indexed_ps(dst, src, TALL_NROWS, iind, jind, numi, numj));
+        printf(" %8.3f", ns);
+#endif
+        printf("\n");
+    }
+
+    free(src);
+    free(dst);
+    free(kind);
+    free(iind);
+    free(jind);
+
+    return 0;
+}
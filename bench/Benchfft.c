@@ -0,0 +1,68 @@
+#include "bench.h"
+#include "fft.h"
+#include "smoothlife.h"
+#include "dispatch.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+// SmoothLife integrals by direct summation and by FFT convolution, for outer
+// radii from a small stencil up to the default, on power-of-two, mixed-radix
+// and prime grids, reported in ns per cell under the best instruction set.
+// The auto column shows which method iu_conv2d_prefer_fft picks, so the
+// crossover constant in fft.c can be checked against the measured one. The
+// real two-dimensional transform is also timed on its own.
+
+#define REPS 3
+
+int main(void)
+{
+    int sizes[] = {64, 128, 256, 500, 509, 512};
+    float radii[] = {3, 6, 9, 12, 21};
+    int nsizes = sizeof(sizes) / sizeof(sizes[0]);
+    int nradii = sizeof(radii) / sizeof(radii[0]);
+    double ns[3];
+
+    printf("isa %s\n", iu_dispatch_isa_name());
+    printf("%-6s %-6s %8s %12s %12s %12s %6s\n", "grid", "ra", "weights", "direct ns", "fft ns", "r2c ns", "auto");
+
+    for (int s = 0; s < nsizes; s++) {
+        int len = sizes[s];
+        int cells = len * len;
+
+        for (int r = 0; r < nradii; r++) {
+            struct iu_smoothlife_params p;
+            struct iu_smoothlife *sl;
+
+            iu_smoothlife_default_params(&p);
+            p.ra = radii[r];
+            p.ri = radii[r] / 3;
+            sl = iu_smoothlife_create(len, len, &p);
+
+            if (sl == NULL) {
+                fprintf(stderr, "allocation failed\n");
+                return 1;
+            }
+
+            srand(0);
+            random_farray(sl->field, cells, 0.0f, 1.0f);
+
+            iu_smoothlife_set_method(sl, SMOOTHLIFE_DIRECT);
+            BENCH_BEST_NS(ns[0], REPS, cells, iu_smoothlife_integrals(sl));
+
+            if (iu_smoothlife_set_method(sl, SMOOTHLIFE_FFT) != 0) {
+                fprintf(stderr, "allocation failed\n");
+                return 1;
+            }
+
+            BENCH_BEST_NS(ns[1], REPS, cells, iu_smoothlife_integrals(sl));
+            BENCH_BEST_NS(ns[2], REPS, cells, iu_fft2d_r2c(sl->conv->fft, sl->conv->spectrum, sl->field));
+
+            printf("%-6d %-6.0f %8d %12.2f %12.2f %12.2f %6s\n", len, radii[r], sl->nm + sl->nn, ns[0], ns[1], ns[2],
+                   iu_conv2d_prefer_fft(len, len, sl->nm + sl->nn, 2) ? "fft" : "direct");
+
+            iu_smoothlife_free(sl);
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,105 @@
+#include "bench.h"
+#include "intrinsics_utils.h"
+#include "cpu_flags.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+// Compare float dot products with half-precision ones over the same number
+// of elements. Once the operands leave the cache the halves move half the
+// bytes, which should make up for the conversions. Also times the bulk
+// conversions themselves. Results are the best of several runs, in
+// nanoseconds per element.
+
+#define REPS 10
+#define WORK (1 << 24)
+
+static volatile float fsink;
+static volatile double dsink;
+
+#define BENCH_CALLS(result, len, stmt)                              \
+    do {                                                            \
+        int calls_ = WORK / (len) > 0 ? WORK / (len) : 1;           \
+        BENCH_BEST_NS(result, REPS, (double)calls_ * (len),         \
+            for (int c_ = 0; c_ < calls_; c_++) { stmt; });         \
+    } while (0)
+
+int main(void)
+{
+    int lens[] = {4096, 1 << 18, 1 << 23};
+    int nlens = sizeof(lens) / sizeof(lens[0]);
+    int maxlen = lens[nlens - 1];
+    float *xf = malloc(maxlen * sizeof(float));
+    float *yf = malloc(maxlen * sizeof(float));
+    uint16_t *xh = malloc(maxlen * sizeof(uint16_t));
+    uint16_t *yh = malloc(maxlen * sizeof(uint16_t));
+    int *indices = malloc(maxlen * sizeof(int));
+    double ns[4];
+
+    if (xf == NULL || yf == NULL || xh == NULL || yh == NULL || indices == NULL) {
+        fprintf(stderr, "allocation failed\n");
+        return 1;
+    }
+
+    random_farray(xf, maxlen, -1.0f, 1.0f);
+    random_farray(yf, maxlen, -1.0f, 1.0f);
+    _mm256_cvt_f32_to_f16(xh, xf, maxlen);
+    _mm256_cvt_f32_to_f16(yh, yf, maxlen);
+
+    printf("ns per element: float / half\n\n");
+    printf("%-10s %-14s %17s %17s\n", "len", "kernel", "avx2", "avx512");
+
+    for (int k = 0; k < nlens; k++) {
+        int len = lens[k];
+
+        random_index_array(indices, len);
+
+        BENCH_CALLS(ns[0], len, fsink = _mm256_fdot(xf, yf, len));
+        BENCH_CALLS(ns[1], len, fsink = _mm256_hdot(xh, yh, len));
+        printf("%-10d %-14s %8.3f %8.3f", len, "dot", ns[0], ns[1]);
+#ifdef SUPPORTS_AVX512
+        BENCH_CALLS(ns[2], len, fsink = _mm512_fdot(xf, yf, len));
+        BENCH_CALLS(ns[3], len, fsink = _mm512_hdot(xh, yh, len));
+        printf(" %8.3f %8.3f", ns[2], ns[3]);
+#endif
+        printf("\n");
+
+        BENCH_CALLS(ns[0], len, fsink = _mm256_fdot_indexed(xf, indices, yf, len));
+        BENCH_CALLS(ns[1], len, fsink = _mm256_hdot_indexed(xh, indices, yh, len));
+        printf("%-10d %-14s %8.3f %8.3f", len, "dot_indexed", ns[0], ns[1]);
+#ifdef SUPPORTS_AVX512
+        BENCH_CALLS(ns[2], len, fsink = _mm512_fdot_indexed(xf, indices, yf, len));
+        BENCH_CALLS(ns[3], len, fsink = _mm512_hdot_indexed(xh, indices, yh, len));
+        printf(" %8.3f %8.3f", ns[2], ns[3]);
+#endif
+        printf("\n");
+
+        BENCH_CALLS(ns[0], len, dsink = _mm256_fdot_acc64(xf, yf, len));
+        BENCH_CALLS(ns[1], len, dsink = _mm256_hdot_acc64(xh, yh, len));
+        printf("%-10d %-14s %8.3f %8.3f", len, "dot_acc64", ns[0], ns[1]);
+#ifdef SUPPORTS_AVX512
+        BENCH_CALLS(ns[2], len, dsink = _mm512_fdot_acc64(xf, yf, len));
+        BENCH_CALLS(ns[3], len, dsink = _mm512_hdot_acc64(xh, yh, len));
+        printf(" %8.3f %8.3f", ns[2], ns[3]);
+#endif
+        printf("\n");
+
+        BENCH_CALLS(ns[0], len, _mm256_cvt_f16_to_f32(xf, xh, len));
+        BENCH_CALLS(ns[1], len, _mm256_cvt_f32_to_f16(xh, xf, len));
+        printf("%-10d %-14s %8.3f %8.3f", len, "to f32 / f16", ns[0], ns[1]);
+#ifdef SUPPORTS_AVX512
+        BENCH_CALLS(ns[2], len, _mm512_cvt_f16_to_f32(xf, xh, len));
+        BENCH_CALLS(ns[3], len, _mm512_cvt_f32_to_f16(xh, xf, len));
+        printf(" %8.3f %8.3f", ns[2], ns[3]);
+#endif
+        printf("\n\n");
+    }
+
+    free(xf);
+    free(yf);
+    free(xh);
+    free(yh);
+    free(indices);
+
+    return 0;
+}
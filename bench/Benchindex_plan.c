@@ -0,0 +1,107 @@
+#include "bench.h"
+#include "index_plan.h"
+#include "dispatch.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+// Compare the dispatched indexed dot product with span-compressed plans on
+// Smoothlife-like neighbourhoods: the disk and annulus around many centres
+// of a padded grid, under each instruction set the host supports. One plan
+// per radius serves every centre and is built outside the timed region; the
+// indexed kernel gets an index list per centre. Timings are the best of
+// several runs, in nanoseconds per cell read.
+
+#define REPS 5
+#define NUM_ISAS 3
+#define NUM_CENTRES 256
+
+// Padding on every side of the grid, enough for the widest radius.
+#define PAD 21
+
+double radii[][2] = {{0.0, 7.0}, {7.0, 21.0}, {0.0, 3.0}, {3.0, 9.0}};
+int num_radii = sizeof(radii) / sizeof(radii[0]);
+
+int main(int argc, char *argv[])
+{
+    int n = argc > 1 ? strtol(argv[1], NULL, 10) : 1024;
+    int ld = n + 2 * PAD;
+    int m = ld * ld;
+    float *field = malloc(m * sizeof(float));
+    float *weights = malloc(m * sizeof(float));
+    struct iu_index_plan *plan;
+    int centres[NUM_CENTRES];
+    int *indices[NUM_CENTRES];
+    volatile double sink = 0;
+    double ns_indexed, ns_plan;
+
+    if (field == NULL || weights == NULL) {
+        fprintf(stderr, "allocation failed\n");
+        return 1;
+    }
+
+    random_farray(field, m, 0.0f, 1.0f);
+    random_farray(weights, m, 0.0f, 1.0f);
+
+    printf("%d x %d grid, %d centres (ns per cell)\n\n", n, n, NUM_CENTRES);
+    printf("%-16s %7s %7s %9s", "radius", "cells", "spans", "gathered");
+
+    for (int isa = 0; isa < NUM_ISAS; isa++) {
+        if (iu_dispatch_set_isa(isa) == 0) {
+            printf(" %8s %8s", "indexed", "plan");
+        }
+    }
+
+    printf("\n");
+
+    for (int c = 0; c < NUM_CENTRES; c++) {
+        centres[c] = (rand() % n + PAD) * ld + rand() % n + PAD;
+    }
+
+    for (int r = 0; r < num_radii; r++) {
+        int cells;
+
+        plan = iu_index_plan_from_radius(ld, radii[r][0], radii[r][1]);
+        cells = NUM_CENTRES * plan->len;
+
+        for (int c = 0; c < NUM_CENTRES; c++) {
+            indices[c] = malloc((plan->len > 0 ? plan->len : 1) * sizeof(int));
+
+            // Expand the plan back to the plain index list around the centre.
+            for (int s = 0; s < plan->nspans; s++) {
+                seq_index_array(indices[c] + plan->spans[3*s + 2], plan->spans[3*s + 1], centres[c] + plan->spans[3*s], 1);
+            }
+
+            for (int s = 0; s < plan->nsingles; s++) {
+                indices[c][plan->single_offsets[s]] = centres[c] + plan->singles[s];
+            }
+        }
+
+        printf("[%5.1f, %5.1f)   %7d %7d %9d", radii[r][0], radii[r][1], plan->len, plan->nspans, plan->nsingles);
+
+        for (int isa = 0; isa < NUM_ISAS; isa++) {
+            if (iu_dispatch_set_isa(isa) != 0) {
+                continue;
+            }
+
+            BENCH_BEST_NS(ns_indexed, REPS, cells,
+                for (int c = 0; c < NUM_CENTRES; c++) sink += iu_fdot_indexed(field, indices[c], weights, plan->len));
+            BENCH_BEST_NS(ns_plan, REPS, cells,
+                for (int c = 0; c < NUM_CENTRES; c++) sink += iu_fdot_plan(plan, field + centres[c], weights));
+
+            printf(" %8.3f %8.3f", ns_indexed, ns_plan);
+        }
+
+        printf("\n");
+
+        for (int c = 0; c < NUM_CENTRES; c++) {
+            free(indices[c]);
+        }
+
+        iu_index_plan_free(plan);
+    }
+
+    free(field);
+    free(weights);
+
+    return 0;
+}
@@ -0,0 +1,101 @@
+#include "bench.h"
+#include "intrinsics_utils.h"
+#include "cpu_flags.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+// Compare the float dot product with the integer dot products on the same
+// number of elements. Narrower types move fewer bytes per element, and the
+// u8 x i8 kernel can use a single VNNI instruction where it is available.
+// Results are the best of several runs, in nanoseconds per element.
+
+#define REPS 20
+#define WORK (1 << 22)
+
+static volatile float fsink;
+static volatile int64_t isink;
+
+#define BENCH_CALLS(result, len, stmt)                              \
+    do {                                                            \
+        int calls_ = WORK / (len);                                  \
+        BENCH_BEST_NS(result, REPS, (double)calls_ * (len),         \
+            for (int c_ = 0; c_ < calls_; c_++) { stmt; });         \
+    } while (0)
+
+int main(void)
+{
+    int lens[] = {1000, 16384, 1 << 20};
+    int nlens = sizeof(lens) / sizeof(lens[0]);
+    int maxlen = lens[nlens - 1];
+    float *xf = malloc(maxlen * sizeof(float));
+    float *yf = malloc(maxlen * sizeof(float));
+    int16_t *x16 = malloc(maxlen * sizeof(int16_t));
+    int16_t *y16 = malloc(maxlen * sizeof(int16_t));
+    uint8_t *xu8 = malloc(maxlen * sizeof(uint8_t));
+    int8_t *yi8 = malloc(maxlen * sizeof(int8_t));
+    double ns;
+
+    if (xf == NULL || yf == NULL || x16 == NULL || y16 == NULL || xu8 == NULL || yi8 == NULL) {
+        fprintf(stderr, "allocation failed\n");
+        return 1;
+    }
+
+    random_farray(xf, maxlen, -1.0f, 1.0f);
+    random_farray(yf, maxlen, -1.0f, 1.0f);
+
+    for (int i = 0; i < maxlen; i++) {
+        x16[i] = (int16_t)rand();
+        y16[i] = (int16_t)rand();
+        xu8[i] = (uint8_t)rand();
+        yi8[i] = (int8_t)rand();
+    }
+
+    printf("ns per element\n\n");
+    printf("%-10s %-22s %8s\n", "len", "kernel", "ns");
+
+    for (int k = 0; k < nlens; k++) {
+        int len = lens[k];
+
+        BENCH_CALLS(ns, len, fsink = _mm256_fdot(xf, yf, len));
+        printf("%-10d %-22s %8.3f\n", len, "_mm256_fdot", ns);
+        BENCH_CALLS(ns, len, isink = _mm256_dot_epi16(x16, y16, len));
+        printf("%-10d %-22s %8.3f\n", len, "_mm256_dot_epi16", ns);
+        BENCH_CALLS(ns, len, isink = _mm256_dot_u8i8(xu8, yi8, len));
+        printf("%-10d %-22s %8.3f\n", len, "_mm256_dot_u8i8", ns);
+#ifdef SUPPORTS_AVXVNNI
+        if (SUPPORTS_AVXVNNI) {
+            BENCH_CALLS(ns, len, isink = _mm256_dot_u8i8_vnni(xu8, yi8, len));
+            printf("%-10d %-22s %8.3f\n", len, "_mm256_dot_u8i8_vnni", ns);
+        }
+#endif
+#ifdef SUPPORTS_AVX512
+        BENCH_CALLS(ns, len, fsink = _mm512_fdot(xf, yf, len));
+        printf("%-10d %-22s %8.3f\n", len, "_mm512_fdot", ns);
+#endif
+#ifdef SUPPORTS_AVX512BW
+        if (SUPPORTS_AVX512BW) {
+            BENCH_CALLS(ns, len, isink = _mm512_dot_epi16(x16, y16, len));
+            printf("%-10d %-22s %8.3f\n", len, "_mm512_dot_epi16", ns);
+            BENCH_CALLS(ns, len, isink = _mm512_dot_u8i8(xu8, yi8, len));
+            printf("%-10d %-22s %8.3f\n", len, "_mm512_dot_u8i8", ns);
+        }
+#endif
+#ifdef SUPPORTS_AVX512VNNI
+        if (SUPPORTS_AVX512VNNI) {
+            BENCH_CALLS(ns, len, isink = _mm512_dot_u8i8_vnni(xu8, yi8, len));
+            printf("%-10d %-22s %8.3f\n", len, "_mm512_dot_u8i8_vnni", ns);
+        }
+#endif
+        printf("\n");
+    }
+
+    free(xf);
+    free(yf);
+    free(x16);
+    free(y16);
+    free(xu8);
+    free(yi8);
+
+    return 0;
+}
@@ -0,0 +1,86 @@
+#include "bench.h"
+#include "intrinsics_utils.h"
+#include "cpu_flags.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+// Compare the masked-tail kernels with their _padded variants on short and
+// medium lengths, where the tail prologue is a visible share of each call.
+// Each timing repeats the call over about a million elements and reports the
+// best of several runs, in nanoseconds per element.
+
+#define REPS 20
+#define WORK (1 << 20)
+
+static volatile float sink;
+
+#define BENCH_CALLS(result, len, stmt)                              \
+    do {                                                            \
+        int calls_ = WORK / (len);                                  \
+        BENCH_BEST_NS(result, REPS, (double)calls_ * (len),         \
+            for (int c_ = 0; c_ < calls_; c_++) { stmt; });         \
+    } while (0)
+
+int main(void)
+{
+    int lens[] = {13, 45, 100, 333, 1000, 4099};
+    int nlens = sizeof(lens) / sizeof(lens[0]);
+    int maxlen = lens[nlens - 1];
+    float *x = iu_alloc_padded(maxlen, sizeof(float));
+    float *y = iu_alloc_padded(maxlen, sizeof(float));
+    int *indices = iu_alloc_padded(maxlen, sizeof(int));
+    double ns[4];
+
+    if (x == NULL || y == NULL || indices == NULL) {
+        fprintf(stderr, "allocation failed\n");
+        return 1;
+    }
+
+    random_farray(x, maxlen, -1.0f, 1.0f);
+    random_farray(y, maxlen, -1.0f, 1.0f);
+
+    printf("ns per element: plain / padded\n\n");
+    printf("%-8s %-20s %17s %17s\n", "len", "kernel", "avx2", "avx512");
+
+    for (int k = 0; k < nlens; k++) {
+        int len = lens[k];
+
+        random_index_array(indices, len);
+
+        BENCH_CALLS(ns[0], len, sink = _mm256_fdot(x, y, len));
+        BENCH_CALLS(ns[1], len, sink = _mm256_fdot_padded(x, y, len));
+        printf("%-8d %-20s %8.3f %8.3f", len, "fdot", ns[0], ns[1]);
+#ifdef SUPPORTS_AVX512
+        BENCH_CALLS(ns[2], len, sink = _mm512_fdot(x, y, len));
+        BENCH_CALLS(ns[3], len, sink = _mm512_fdot_padded(x, y, len));
+        printf(" %8.3f %8.3f", ns[2], ns[3]);
+#endif
+        printf("\n");
+
+        BENCH_CALLS(ns[0], len, sink = _mm256_fdot_indexed(x, indices, y, len));
+        BENCH_CALLS(ns[1], len, sink = _mm256_fdot_indexed_padded(x, indices, y, len));
+        printf("%-8d %-20s %8.3f %8.3f", len, "fdot_indexed", ns[0], ns[1]);
+#ifdef SUPPORTS_AVX512
+        BENCH_CALLS(ns[2], len, sink = _mm512_fdot_indexed(x, indices, y, len));
+        BENCH_CALLS(ns[3], len, sink = _mm512_fdot_indexed_padded(x, indices, y, len));
+        printf(" %8.3f %8.3f", ns[2], ns[3]);
+#endif
+        printf("\n");
+
+        BENCH_CALLS(ns[0], len, _mm256_copy1d_ps(y, x, len));
+        BENCH_CALLS(ns[1], len, _mm256_copy1d_ps_padded(y, x, len));
+        printf("%-8d %-20s %8.3f %8.3f", len, "copy1d_ps", ns[0], ns[1]);
+#ifdef SUPPORTS_AVX512
+        BENCH_CALLS(ns[2], len, _mm512_copy1d_ps(y, x, len));
+        BENCH_CALLS(ns[3], len, _mm512_copy1d_ps_padded(y, x, len));
+        printf(" %8.3f %8.3f", ns[2], ns[3]);
+#endif
+        printf("\n");
+    }
+
+    iu_free_padded(x);
+    iu_free_padded(y);
+    iu_free_padded(indices);
+
+    return 0;
+}
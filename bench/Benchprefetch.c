@@ -0,0 +1,199 @@
+#include "bench.h"
+#include "intrinsics_utils.h"
+#include "cpu_flags.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+// Compare the gather-based indexed kernels with and without software
+// prefetching, for indices that are random over an array larger than the
+// last-level cache and for indices that come in short sequential runs.
+// Timings are the best of several runs, in nanoseconds per element. The
+// 2D copy is also run with short columns, as in a SmoothLife neighbourhood,
+// where the look-ahead spans several columns.
+
+#define REPS 5
+
+// Length of the sequential runs in the clustered pattern.
+#define RUN_LEN 16
+
+int distances[] = {0, 16, 32, 64, 128, 256, 512};
+int num_distances = sizeof(distances) / sizeof(distances[0]);
+
+// Column lengths for the short-column copies.
+int short_numi[] = {8, 16, 24, 31};
+int num_short_numi = sizeof(short_numi) / sizeof(short_numi[0]);
+
+// Indices in runs of RUN_LEN consecutive elements, starting at random
+// offsets.
+void clustered_index_array(int *indices, int len, int range)
+{
+    for (int i = 0; i < len; i += RUN_LEN) {
+        int run = len - i < RUN_LEN ? len - i : RUN_LEN;
+
+        seq_index_array(indices + i, run, rand() % (range - RUN_LEN), 1);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    int log_range = argc > 1 ? strtol(argv[1], NULL, 10) : 24;
+    int range = 1 << log_range;
+    int n = range / 4;
+    int nrows = 4096;
+    int numi = 1024;
+    int numj = n / numi;
+    float *xf = malloc(range * sizeof(float));
+    float *yf = malloc(n * sizeof(float));
+    double *xd = malloc(range * sizeof(double));
+    double *yd = malloc(n * sizeof(double));
+    int *perm = malloc(range * sizeof(int));
+    int *indices = malloc(n * sizeof(int));
+    int *iind = malloc(numi * sizeof(int));
+    int *jind = malloc(numj * sizeof(int));
+    int *jind_short = malloc((n / short_numi[0]) * sizeof(int));
+    volatile double sink = 0;
+    double ns;
+
+    if (xf == NULL || yf == NULL || xd == NULL || yd == NULL || perm == NULL || indices == NULL || iind == NULL || jind == NULL || jind_short == NULL) {
+        fprintf(stderr, "allocation failed\n");
+        return 1;
+    }
+
+    random_farray(xf, range, -1.0f, 1.0f);
+    random_farray(yf, n, -1.0f, 1.0f);
+    random_darray(xd, range, -1.0, 1.0);
+    random_darray(yd, n, -1.0, 1.0);
+
+    printf("%d indices into %d elements (ns per element, distance 0 = no prefetch)\n\n", n, range);
+    printf("%-10s %-28s", "pattern", "kernel");
+
+    for (int d = 0; d < num_distances; d++) {
+        printf(" %7d", distances[d]);
+    }
+
+    printf("\n");
+
+    for (int pattern = 0; pattern < 2; pattern++) {
+        const char *name = pattern == 0 ? "random" : "clustered";
+
+        if (pattern == 0) {
+            random_index_array(perm, range);
+
+            for (int i = 0; i < n; i++) {
+                indices[i] = perm[i];
+            }
+
+            random_index_array(perm, nrows);
+
+            for (int i = 0; i < numi; i++) {
+                iind[i] = perm[i];
+            }
+        } else {
+            clustered_index_array(indices, n, range);
+            seq_index_array(iind, numi, (nrows - numi) / 2, 1);
+        }
+
+        for (int j = 0; j < numj; j++) {
+            jind[j] = rand() % (range / nrows);
+        }
+
+        printf("%-10s %-28s", name, "_mm256_fdot_indexed");
+        for (int d = 0; d < num_distances; d++) {
+            if (distances[d] == 0) {
+                BENCH_BEST_NS(ns, REPS, n, sink += _mm256_fdot_indexed(xf, indices, yf, n));
+            } else {
+                BENCH_BEST_NS(ns, REPS, n, sink += _mm256_fdot_indexed_prefetch(xf, indices, yf, n, distances[d]));
+            }
+            printf(" %7.3f", ns);
+        }
+        printf("\n");
+
+        printf("%-10s %-28s", name, "_mm256_ddot_indexed");
+        for (int d = 0; d < num_distances; d++) {
+            if (distances[d] == 0) {
+                BENCH_BEST_NS(ns, REPS, n, sink += _mm256_ddot_indexed(xd, indices, yd, n));
+            } else {
+                BENCH_BEST_NS(ns, REPS, n, sink += _mm256_ddot_indexed_prefetch(xd, indices, yd, n, distances[d]));
+            }
+            printf(" %7.3f", ns);
+        }
+        printf("\n");
+
+        printf("%-10s %-28s", name, "_mm256_copy2d_indexed_ps");
+        for (int d = 0; d < num_distances; d++) {
+            if (distances[d] == 0) {
+                BENCH_BEST_NS(ns, REPS, n, _mm256_copy2d_indexed_ps(yf, xf, nrows, iind, jind, numi, numj));
+            } else {
+                BENCH_BEST_NS(ns, REPS, n, _mm256_copy2d_indexed_ps_prefetch(yf, xf, nrows, iind, jind, numi, numj, distances[d]));
+            }
+            printf(" %7.3f", ns);
+        }
+        printf("\n");
+
+#ifdef SUPPORTS_AVX512
+        printf("%-10s %-28s", name, "_mm512_fdot_indexed");
+        for (int d = 0; d < num_distances; d++) {
+            if (distances[d] == 0) {
+                BENCH_BEST_NS(ns, REPS, n, sink += _mm512_fdot_indexed(xf, indices, yf, n));
+            } else {
+                BENCH_BEST_NS(ns, REPS, n, sink += _mm512_fdot_indexed_prefetch(xf, indices, yf, n, distances[d]));
+            }
+            printf(" %7.3f", ns);
+        }
+        printf("\n");
+
+        printf("%-10s %-28s", name, "_mm512_ddot_indexed");
+        for (int d = 0; d < num_distances; d++) {
+            if (distances[d] == 0) {
+                BENCH_BEST_NS(ns, REPS, n, sink += _mm512_ddot_indexed(xd, indices, yd, n));
+            } else {
+                BENCH_BEST_NS(ns, REPS, n, sink += _mm512_ddot_indexed_prefetch(xd, indices, yd, n, distances[d]));
+            }
+            printf(" %7.3f", ns);
+        }
+        printf("\n");
+#endif
+    }
+
+    printf("\n%-10s %-28s", "numi", "kernel");
+
+    for (int d = 0; d < num_distances; d++) {
+        printf(" %7d", distances[d]);
+    }
+
+    printf("\n");
+
+    random_index_array(perm, nrows);
+
+    for (int s = 0; s < num_short_numi; s++) {
+        int numi_short = short_numi[s];
+        int numj_short = n / numi_short;
+
+        for (int j = 0; j < numj_short; j++) {
+            jind_short[j] = rand() % (range / nrows);
+        }
+
+        printf("%-10d %-28s", numi_short, "_mm256_copy2d_indexed_ps");
+        for (int d = 0; d < num_distances; d++) {
+            if (distances[d] == 0) {
+                BENCH_BEST_NS(ns, REPS, n, _mm256_copy2d_indexed_ps(yf, xf, nrows, perm, jind_short, numi_short, numj_short));
+            } else {
+                BENCH_BEST_NS(ns, REPS, n, _mm256_copy2d_indexed_ps_prefetch(yf, xf, nrows, perm, jind_short, numi_short, numj_short, distances[d]));
+            }
+            printf(" %7.3f", ns);
+        }
+        printf("\n");
+    }
+
+    free(xf);
+    free(yf);
+    free(xd);
+    free(yd);
+    free(perm);
+    free(indices);
+    free(iind);
+    free(jind);
+    free(jind_short);
+
+    return 0;
+}
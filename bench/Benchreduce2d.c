@@ -0,0 +1,90 @@
+#include "bench.h"
+#include "dispatch.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+// Weighted sums over the periodic (2r + 1)^2 neighbourhood of every cell of
+// a square column-major grid, under the best instruction set. The copy
+// column gathers each neighbourhood into a scratch buffer with
+// iu_copy2d_indexed_ps and then calls iu_fdot on it; the fused column calls
+// iu_dot2d_indexed_ps. Timings are in ns per gathered element.
+
+#define REPS 3
+#define LEN 512
+
+static volatile float sink;
+
+static void neighbourhood(int *ind, int c, int r)
+{
+    for (int d = -r; d <= r; d++) {
+        ind[d + r] = (c + d + LEN) % LEN;
+    }
+}
+
+static void copy_dot(const float *x, const float *w, float *buf, int r)
+{
+    int n = 2 * r + 1;
+    int iind[2 * 32 + 1], jind[2 * 32 + 1];
+
+    for (int j = 0; j < LEN; j++) {
+        neighbourhood(jind, j, r);
+
+        for (int i = 0; i < LEN; i++) {
+            neighbourhood(iind, i, r);
+            iu_copy2d_indexed_ps(buf, x, LEN, iind, jind, n, n);
+            sink += iu_fdot(buf, w, n * n);
+        }
+    }
+}
+
+static void fused_dot(const float *x, const float *w, int r)
+{
+    int n = 2 * r + 1;
+    int iind[2 * 32 + 1], jind[2 * 32 + 1];
+
+    for (int j = 0; j < LEN; j++) {
+        neighbourhood(jind, j, r);
+
+        for (int i = 0; i < LEN; i++) {
+            neighbourhood(iind, i, r);
+            sink += iu_dot2d_indexed_ps(x, LEN, iind, jind, n, n, w);
+        }
+    }
+}
+
+int main(void)
+{
+    int radii[] = {1, 2, 4, 8, 16, 32};
+    int nradii = sizeof(radii) / sizeof(radii[0]);
+    float *x = malloc((size_t)LEN * LEN * sizeof(float));
+    float *w = malloc((2 * 32 + 1) * (2 * 32 + 1) * sizeof(float));
+    float *buf = malloc((2 * 32 + 1) * (2 * 32 + 1) * sizeof(float));
+    double ns[2];
+
+    if (x == NULL || w == NULL || buf == NULL) {
+        fprintf(stderr, "allocation failed\n");
+        return 1;
+    }
+
+    srand(0);
+    random_farray(x, LEN * LEN, 0.0f, 1.0f);
+    random_farray(w, (2 * 32 + 1) * (2 * 32 + 1), 0.0f, 1.0f);
+
+    printf("isa %s, grid %dx%d\n", iu_dispatch_isa_name(), LEN, LEN);
+    printf("%-6s %12s %12s\n", "r", "copy ns", "fused ns");
+
+    for (int k = 0; k < nradii; k++) {
+        int r = radii[k];
+        double elements = (double)LEN * LEN * (2 * r + 1) * (2 * r + 1);
+
+        BENCH_BEST_NS(ns[0], REPS, elements, copy_dot(x, w, buf, r));
+        BENCH_BEST_NS(ns[1], REPS, elements, fused_dot(x, w, r));
+        printf("%-6d %12.3f %12.3f\n", r, ns[0], ns[1]);
+    }
+
+    free(x);
+    free(w);
+    free(buf);
+
+    return 0;
+}
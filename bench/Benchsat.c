@@ -0,0 +1,77 @@
+#include "bench.h"
+#include "sat.h"
+#include "dispatch.h"
+#include "constants.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+// Periodic box sums of every cell of a square column-major grid, from a
+// summed-area table and by direct summation of the (2r + 1)^2 neighbours,
+// in ns per cell under the best instruction set. The table column includes
+// building the table, so it is the full cost of one pass over a new grid.
+
+#define REPS 3
+#define LEN 512
+
+static void direct_box(float *dst, const float *x, int n, int r)
+{
+    for (int j = 0; j < n; j++) {
+        for (int i = 0; i < n; i++) {
+            float sum = 0;
+
+            for (int dj = -r; dj <= r; dj++) {
+                const float *col = x + (size_t)((j + dj + n) % n) * n;
+
+                for (int di = -r; di <= r; di++) {
+                    sum += col[(i + di + n) % n];
+                }
+            }
+
+            dst[(size_t)j * n + i] = sum;
+        }
+    }
+}
+
+static void sat_box(struct iu_ssat *sat, float *dst, const float *x, int n, int r)
+{
+    iu_ssat_build(sat, x, n);
+    iu_ssat_box(sat, dst, n, -r, -r, 2 * r + 1, 2 * r + 1);
+}
+
+int main(void)
+{
+    int radii[] = {1, 2, 4, 8, 16, 32};
+    int nradii = sizeof(radii) / sizeof(radii[0]);
+    int cells = LEN * LEN;
+    float *x = malloc((size_t)cells * sizeof(float));
+    float *dst = malloc((size_t)cells * sizeof(float));
+    struct iu_ssat *sat = iu_ssat_create(LEN, LEN, COLUMN_MAJOR_ORDER);
+    double ns[3];
+
+    if (x == NULL || dst == NULL || sat == NULL) {
+        fprintf(stderr, "allocation failed\n");
+        return 1;
+    }
+
+    srand(0);
+    random_farray(x, cells, 0.0f, 1.0f);
+
+    printf("isa %s, grid %dx%d\n", iu_dispatch_isa_name(), LEN, LEN);
+    BENCH_BEST_NS(ns[0], REPS, cells, iu_ssat_build(sat, x, LEN));
+    printf("build %.2f ns/cell\n", ns[0]);
+    printf("%-6s %12s %12s\n", "r", "direct ns", "table ns");
+
+    for (int k = 0; k < nradii; k++) {
+        int r = radii[k];
+
+        BENCH_BEST_NS(ns[1], REPS, cells, direct_box(dst, x, LEN, r));
+        BENCH_BEST_NS(ns[2], REPS, cells, sat_box(sat, dst, x, LEN, r));
+        printf("%-6d %12.2f %12.2f\n", r, ns[1], ns[2]);
+    }
+
+    free(x);
+    free(dst);
+    iu_ssat_free(sat);
+
+    return 0;
+}
@@ -0,0 +1,52 @@
+#include "bench.h"
+#include "smoothlife.h"
+#include "dispatch.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+// End-to-end SmoothLife steps with the default radii (ri = 7, ra = 21) under
+// each instruction set the host supports, reported in cell updates per
+// second. The integrals and the transition are also timed on their own, so
+// changes to either show up separately.
+
+#define REPS 5
+#define NUM_ISAS 3
+
+int main(void)
+{
+    int sizes[] = {128, 512};
+    int nsizes = sizeof(sizes) / sizeof(sizes[0]);
+    double ns[3];
+
+    printf("%-6s %-8s %14s %14s %14s\n", "grid", "isa", "step Mcells/s", "integrals ns", "transition ns");
+
+    for (int s = 0; s < nsizes; s++) {
+        int len = sizes[s];
+        int cells = len * len;
+        struct iu_smoothlife *sl = iu_smoothlife_create(len, len, NULL);
+
+        if (sl == NULL) {
+            fprintf(stderr, "allocation failed\n");
+            return 1;
+        }
+
+        for (int isa = 0; isa < NUM_ISAS; isa++) {
+            if (iu_dispatch_set_isa(isa) != 0) {
+                continue;
+            }
+
+            srand(0);
+            random_farray(sl->field, cells, 0.0f, 1.0f);
+
+            BENCH_BEST_NS(ns[0], REPS, cells, iu_smoothlife_step(sl));
+            BENCH_BEST_NS(ns[1], REPS, cells, iu_smoothlife_integrals(sl));
+            BENCH_BEST_NS(ns[2], REPS, cells, iu_smoothlife_transition_ps(sl->field, sl->m, sl->n, cells, &sl->params));
+
+            printf("%-6d %-8s %14.2f %14.3f %14.3f\n", len, iu_dispatch_isa_name(), 1e3 / ns[0], ns[1], ns[2]);
+        }
+
+        iu_smoothlife_free(sl);
+    }
+
+    return 0;
+}
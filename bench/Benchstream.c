@@ -0,0 +1,63 @@
+#include "bench.h"
+#include "intrinsics_utils.h"
+#include "cpu_flags.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+// Compare regular and non-temporal stores for set_value and copy1d on arrays
+// much larger than the last-level cache. The stream threshold is set to
+// SIZE_MAX to force regular stores and to 1 to force streaming. Timings are
+// the best of several runs, in nanoseconds per element.
+
+#define REPS 10
+
+int main(int argc, char *argv[])
+{
+    int n = argc > 1 ? strtol(argv[1], NULL, 10) : 1 << 26;
+    float *src = malloc((size_t)n * sizeof(float));
+    float *dst = malloc((size_t)n * sizeof(float));
+    size_t thresholds[] = {SIZE_MAX, 1};
+    const char *names[] = {"storeu", "stream"};
+    double ns;
+
+    if (src == NULL || dst == NULL) {
+        fprintf(stderr, "allocation failed\n");
+        return 1;
+    }
+
+    random_farray(src, n, -1.0f, 1.0f);
+    random_farray(dst, n, -1.0f, 1.0f);
+
+    printf("%d floats, default threshold %zu bytes (ns per element)\n\n", n, iu_stream_threshold());
+    printf("%-20s %8s %8s\n", "kernel", "avx2", "avx512");
+
+    for (int k = 0; k < 2; k++) {
+        iu_set_stream_threshold(thresholds[k]);
+
+        printf("%-13s%-7s", "sset_value", names[k]);
+        BENCH_BEST_NS(ns, REPS, n, _mm256_sset_value(dst, n, 0.5f));
+        printf(" %8.3f", ns);
+#ifdef SUPPORTS_AVX512
+        BENCH_BEST_NS(ns, REPS, n, _mm512_sset_value(dst, n, 0.5f));
+        printf(" %8.3f", ns);
+#endif
+        printf("\n");
+
+        printf("%-13s%-7s", "copy1d_ps", names[k]);
+        BENCH_BEST_NS(ns, REPS, n, _mm256_copy1d_ps(dst, src, n));
+        printf(" %8.3f", ns);
+#ifdef SUPPORTS_AVX512
+        BENCH_BEST_NS(ns, REPS, n, _mm512_copy1d_ps(dst, src, n));
+        printf(" %8.3f", ns);
+#endif
+        printf("\n");
+    }
+
+    iu_set_stream_threshold(0);
+
+    free(src);
+    free(dst);
+
+    return 0;
+}
@@ -0,0 +1,117 @@
+#include "bench.h"
+#include "intrinsics_utils.h"
+#include "constants.h"
+#include "cpu_flags.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+// Compare the blocked transposes with a naive double loop, out of place and
+// in place, for square matrices from L1-sized up to well past the last-level
+// cache. Timings are the best of several runs, in nanoseconds per element.
+
+#define REPS 5
+
+static void naive_transpose_ps(int n, const float *a, float *b)
+{
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < n; j++) {
+            b[(size_t)j * n + i] = a[(size_t)i * n + j];
+        }
+    }
+}
+
+static void naive_transpose_pd(int n, const double *a, double *b)
+{
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < n; j++) {
+            b[(size_t)j * n + i] = a[(size_t)i * n + j];
+        }
+    }
+}
+
+static void naive_transpose_inplace_ps(int n, float *a)
+{
+    for (int i = 0; i < n; i++) {
+        for (int j = i + 1; j < n; j++) {
+            float t = a[(size_t)i * n + j];
+
+            a[(size_t)i * n + j] = a[(size_t)j * n + i];
+            a[(size_t)j * n + i] = t;
+        }
+    }
+}
+
+int main(void)
+{
+    int sizes[] = {64, 256, 1000, 1024, 4096};
+    int nsizes = sizeof(sizes) / sizeof(sizes[0]);
+    double ns;
+
+    printf("%-6s %-16s %8s %8s %8s %8s\n", "n", "kernel", "naive", "sse", "avx2", "avx512");
+
+    for (int s = 0; s < nsizes; s++) {
+        int n = sizes[s];
+        size_t cells = (size_t)n * n;
+        float *af = malloc(cells * sizeof(float));
+        float *bf = malloc(cells * sizeof(float));
+        double *ad = malloc(cells * sizeof(double));
+        double *bd = malloc(cells * sizeof(double));
+        int reps = n >= 4096 ? 2 : REPS;
+
+        if (af == NULL || bf == NULL || ad == NULL || bd == NULL) {
+            fprintf(stderr, "allocation failed\n");
+            return 1;
+        }
+
+        random_farray(af, cells, -1.0f, 1.0f);
+        random_farray(bf, cells, -1.0f, 1.0f);
+        random_darray(ad, cells, -1.0, 1.0);
+        random_darray(bd, cells, -1.0, 1.0);
+
+        printf("%-6d %-16s", n, "transpose_ps");
+        BENCH_BEST_NS(ns, reps, cells, naive_transpose_ps(n, af, bf));
+        printf(" %8.3f", ns);
+        BENCH_BEST_NS(ns, reps, cells, _mm_transpose_ps(ROW_MAJOR_ORDER, n, n, af, n, bf, n));
+        printf(" %8.3f", ns);
+        BENCH_BEST_NS(ns, reps, cells, _mm256_transpose_ps(ROW_MAJOR_ORDER, n, n, af, n, bf, n));
+        printf(" %8.3f", ns);
+#ifdef SUPPORTS_AVX512
+        BENCH_BEST_NS(ns, reps, cells, _mm512_transpose_ps(ROW_MAJOR_ORDER, n, n, af, n, bf, n));
+        printf(" %8.3f", ns);
+#endif
+        printf("\n");
+
+        printf("%-6d %-16s", n, "transpose_pd");
+        BENCH_BEST_NS(ns, reps, cells, naive_transpose_pd(n, ad, bd));
+        printf(" %8.3f", ns);
+        BENCH_BEST_NS(ns, reps, cells, _mm_transpose_pd(ROW_MAJOR_ORDER, n, n, ad, n, bd, n));
+        printf(" %8.3f", ns);
+        BENCH_BEST_NS(ns, reps, cells, _mm256_transpose_pd(ROW_MAJOR_ORDER, n, n, ad, n, bd, n));
+        printf(" %8.3f", ns);
+#ifdef SUPPORTS_AVX512
+        BENCH_BEST_NS(ns, reps, cells, _mm512_transpose_pd(ROW_MAJOR_ORDER, n, n, ad, n, bd, n));
+        printf(" %8.3f", ns);
+#endif
+        printf("\n");
+
+        printf("%-6d %-16s", n, "inplace_ps");
+        BENCH_BEST_NS(ns, reps, cells, naive_transpose_inplace_ps(n, af));
+        printf(" %8.3f", ns);
+        BENCH_BEST_NS(ns, reps, cells, _mm_transpose_inplace_ps(n, af, n));
+        printf(" %8.3f", ns);
+        BENCH_BEST_NS(ns, reps, cells, _mm256_transpose_inplace_ps(n, af, n));
+        printf(" %8.3f", ns);
+#ifdef SUPPORTS_AVX512
+        BENCH_BEST_NS(ns, reps, cells, _mm512_transpose_inplace_ps(n, af, n));
+        printf(" %8.3f", ns);
+#endif
+        printf("\n");
+
+        free(af);
+        free(bf);
+        free(ad);
+        free(bd);
+    }
+
+    return 0;
+}
@@ -0,0 +1,72 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdlib.h>
+#include <time.h>
+
+//----------------------------------------------------------------------------
+// Helpers shared by the benchmarks.
+//----------------------------------------------------------------------------
+
+// Seconds on a monotonic clock.
+static inline double bench_now(void)
+{
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+
+    return t.tv_sec + 1e-9 * t.tv_nsec;
+}
+
+// Fill an array with the sequence start, start + step, ...
+static inline void seq_index_array(int *indices, int len, int start, int step)
+{
+    for (int i = 0; i < len; i++) {
+        indices[i] = start + i * step;
+    }
+}
+
+// Fill an array with a random permutation of 0, ..., len - 1.
+static inline void random_index_array(int *indices, int len)
+{
+    int j;
+    int temp;
+
+    seq_index_array(indices, len, 0, 1);
+
+    for (int i = len - 1; i > 0; i--) {
+        j = rand() % (i + 1);
+        temp = indices[i];
+        indices[i] = indices[j];
+        indices[j] = temp;
+    }
+}
+
+static inline void random_farray(float *x, int len, float a, float b)
+{
+    for (int i = 0; i < len; i++) {
+        x[i] = a + (b - a) * ((float)rand() / RAND_MAX);
+    }
+}
+
+static inline void random_darray(double *x, int len, double a, double b)
+{
+    for (int i = 0; i < len; i++) {
+        x[i] = a + (b - a) * ((double)rand() / RAND_MAX);
+    }
+}
+
+// Best of reps runs of a statement, in nanoseconds per element.
+#define BENCH_BEST_NS(result, reps, elements, stmt)                 \
+    do {                                                            \
+        double best_ = 1e300;                                       \
+        for (int rep_ = 0; rep_ < (reps); rep_++) {                 \
+            double t0_ = bench_now();                               \
+            stmt;                                                   \
+            double t1_ = bench_now() - t0_;                         \
+            best_ = t1_ < best_ ? t1_ : best_;                      \
+        }                                                           \
+        (result) = 1e9 * best_ / (double)(elements);                \
+    } while (0)
+
+#endif
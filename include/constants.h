@@ -58,6 +58,18 @@ extern "C" {
 #define FLOAT_PER_M512_REG 16
 #define INT32_PER_M512_REG FLOAT_PER_M512_REG
 
+#define COMPLEX_PER_M128_REG 2
+#define COMPLEX_PER_M256_REG 4
+#define COMPLEX_PER_M512_REG 8
+
+#define INT16_PER_M128_REG 8
+#define INT16_PER_M256_REG 16
+#define INT16_PER_M512_REG 32
+
+#define INT8_PER_M128_REG 16
+#define INT8_PER_M256_REG 32
+#define INT8_PER_M512_REG 64
+
 #define INT32_ZERO ((int32_t)0)
 #define INT32_ALLBITS ((int32_t)0xFFFFFFFF)
 #define INT32_LOWBIT  ((int32_t)0x00000001)
@@ -68,4 +80,58 @@ extern "C" {
 #define INT64_HIGHBIT ((int64_t)0x8000000000000000)
 #define INT64_ALLBITS ((int64_t)0xFFFFFFFFFFFFFFFF)
 
+//----------------------------------------------------------------------------
+// Macros for sparse matrix storage. A SELL-C-sigma chunk holds one AVX-512
+// register of rows.
+//----------------------------------------------------------------------------
+
+#define SELL_CHUNK_PS FLOAT_PER_M512_REG
+#define SELL_CHUNK_PD DOUBLE_PER_M512_REG
+
+//----------------------------------------------------------------------------
+// Default look-ahead, in elements, of the prefetching indexed kernels.
+//----------------------------------------------------------------------------
+
+#define PREFETCH_DISTANCE_M256 64
+#define PREFETCH_DISTANCE_M512 128
+
+//----------------------------------------------------------------------------
+// Defaults for non-temporal stores: outputs of at least 1/STREAM_LLC_DIVISOR
+// of the last-level cache are streamed, and STREAM_DEFAULT_LLC bytes are
+// assumed when the cache size cannot be detected.
+//----------------------------------------------------------------------------
+
+#define STREAM_LLC_DIVISOR 2
+#define STREAM_DEFAULT_LLC (8 << 20)
+
+//----------------------------------------------------------------------------
+// Tiles of tiled two-dimensional copies: a tile's rows of the index vector
+// fill 1/COPY2D_L1_DIVISOR of L1, and the source it gathers from, when the
+// row indices are dense, 1/COPY2D_L2_DIVISOR of L2. Rows per tile are a
+// multiple of COPY2D_TILE_ALIGN, a whole number of registers of every
+// width. The defaults stand in when the cache sizes cannot be detected.
+//----------------------------------------------------------------------------
+
+#define COPY2D_L1_DIVISOR 4
+#define COPY2D_L2_DIVISOR 2
+#define COPY2D_TILE_ALIGN 16
+#define COPY2D_DEFAULT_L1 (32 << 10)
+#define COPY2D_DEFAULT_L2 (1 << 20)
+
+//----------------------------------------------------------------------------
+// Lines per block of the blocked transposes: a block of a float or int
+// matrix and its transpose fill 32 KB, and a block of a double matrix and
+// its transpose 16 KB. Both are multiples of every register width.
+//----------------------------------------------------------------------------
+
+#define TRANSPOSE_BLOCK_PS 64
+#define TRANSPOSE_BLOCK_PD 32
+
+//----------------------------------------------------------------------------
+// Alignment, in bytes, of padded buffers. Their lengths are rounded up to
+// whole blocks of this size, one AVX-512 register.
+//----------------------------------------------------------------------------
+
+#define PADDED_ALIGNMENT 64
+
 #endif
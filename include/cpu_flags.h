@@ -1,6 +1,13 @@
 #ifndef SUPPORT_H
 #define SUPPORT_H
 
+//----------------------------------------------------------------------------
+// Runtime checks for instruction set support. Normally these follow the
+// -march flags the library is built with. Defining MULTIARCH compiles every
+// variant regardless of the build host, and leaves the choice between them
+// to the runtime checks (see dispatch.h).
+//----------------------------------------------------------------------------
+
 #ifdef __MMX__
 #define SUPPORTS_MMX __builtin_cpu_supports("mmx")
 #endif
@@ -17,16 +24,43 @@
 #define SUPPORTS_SSE3 __builtin_cpu_supports("sse3")
 #endif
 
-#ifdef __AVX__
+#if defined(__AVX__) || defined(MULTIARCH)
 #define SUPPORTS_AVX __builtin_cpu_supports("avx")
 #endif
 
-#ifdef __AVX2__
-#define SUPPORTS_AVX2 __builtin_cpu_supports("avx2")
+#if defined(__AVX2__) || defined(MULTIARCH)
+#define SUPPORTS_AVX2 (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+#endif
+
+#if defined(__FMA__) || defined(MULTIARCH)
+#define SUPPORTS_FMA __builtin_cpu_supports("fma")
 #endif
 
-#if defined(__AVX512F__) && defined(__AVX512DQ__)
+#if (defined(__AVX512F__) && defined(__AVX512DQ__)) || defined(MULTIARCH)
 #define SUPPORTS_AVX512 (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512dq"))
 #endif
 
+#if (defined(__AVX512F__) && defined(__AVX512DQ__) && defined(__AVX512BW__)) || defined(MULTIARCH)
+#define SUPPORTS_AVX512BW (SUPPORTS_AVX512 && __builtin_cpu_supports("avx512bw"))
+#endif
+
+#if defined(__AVXVNNI__) || defined(MULTIARCH)
+#define SUPPORTS_AVXVNNI (SUPPORTS_AVX2 && __builtin_cpu_supports("avxvnni"))
+#endif
+
+#if (defined(__AVX512F__) && defined(__AVX512DQ__) && defined(__AVX512BW__) && defined(__AVX512VNNI__)) || defined(MULTIARCH)
+#define SUPPORTS_AVX512VNNI (SUPPORTS_AVX512BW && __builtin_cpu_supports("avx512vnni"))
+#endif
+
+//----------------------------------------------------------------------------
+// Function attributes allowing kernels for wider instruction sets to be
+// compiled alongside the baseline ones.
+//----------------------------------------------------------------------------
+
+#define TARGET_AVX2 __attribute__((target("avx,avx2,fma,f16c,popcnt")))
+#define TARGET_AVX512 __attribute__((target("avx,avx2,fma,f16c,popcnt,avx512f,avx512dq")))
+#define TARGET_AVX512BW __attribute__((target("avx,avx2,fma,f16c,popcnt,avx512f,avx512dq,avx512bw")))
+#define TARGET_AVXVNNI __attribute__((target("avx,avx2,fma,f16c,popcnt,avxvnni")))
+#define TARGET_AVX512VNNI __attribute__((target("avx,avx2,fma,f16c,popcnt,avx512f,avx512dq,avx512bw,avx512vnni")))
+
 #endif
@@ -0,0 +1,220 @@
+#ifndef DISPATCH_H
+#define DISPATCH_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//----------------------------------------------------------------------------
+// Instruction sets the width-neutral entry points can be bound to.
+//----------------------------------------------------------------------------
+
+#define IU_ISA_SSE 0
+#define IU_ISA_AVX2 1
+#define IU_ISA_AVX512 2
+
+//----------------------------------------------------------------------------
+// Ways the indexed kernels can load their operands: with the gather
+// instructions, or with scalar loads and inserts.
+//----------------------------------------------------------------------------
+
+#define IU_GATHER_HARDWARE 0
+#define IU_GATHER_EMULATED 1
+
+//----------------------------------------------------------------------------
+// Functions for selecting kernels. The best instruction set supported by the
+// running CPU is bound when the library is loaded; iu_dispatch_set_isa
+// rebinds to a narrower one, returning -1 if the CPU or build lacks it.
+//----------------------------------------------------------------------------
+
+int iu_dispatch_isa(void);
+const char *iu_dispatch_isa_name(void);
+int iu_dispatch_set_isa(int);
+
+//----------------------------------------------------------------------------
+// Functions for selecting the gather path of the indexed kernels. At load
+// time a short microbenchmark binds whichever path is faster on the running
+// CPU, unless the IU_GATHER environment variable is set to "hardware" or
+// "emulated". iu_dispatch_set_gather returns -1 for an unknown path. SSE
+// kernels always load indexed operands one at a time.
+//----------------------------------------------------------------------------
+
+int iu_dispatch_gather(void);
+const char *iu_dispatch_gather_name(void);
+int iu_dispatch_set_gather(int);
+
+//----------------------------------------------------------------------------
+// Width-neutral functions for setting values of arrays.
+//----------------------------------------------------------------------------
+
+void iu_sset_value(float *, int, float);
+void iu_dset_value(double *, int, double);
+
+//----------------------------------------------------------------------------
+// Width-neutral dot products.
+//----------------------------------------------------------------------------
+
+float iu_fdot(const float *, const float *, int);
+float iu_fdot_indexed(const float *, const int *, const float *, int);
+float iu_fdot_indexed2(const float *, const int *, const float *, const int *, int);
+
+double iu_ddot(const double *, const double *, int);
+double iu_ddot_indexed(const double *, const int *, const double *, int);
+double iu_ddot_indexed2(const double *, const int *, const double *, const int *, int);
+
+//----------------------------------------------------------------------------
+// Width-neutral integer dot products, summed in 64 bits. The u8i8 products
+// take unsigned bytes of x and signed bytes of y, and use vpdpbusd where the
+// CPU has AVX-VNNI or AVX512-VNNI.
+//----------------------------------------------------------------------------
+
+int64_t iu_dot_epi32(const int *, const int *, int);
+int64_t iu_dot_indexed_epi32(const int *, const int *, const int *, int);
+int64_t iu_dot_epi16(const int16_t *, const int16_t *, int);
+int64_t iu_dot_indexed_epi16(const int16_t *, const int *, const int16_t *, int);
+int64_t iu_dot_u8i8(const uint8_t *, const int8_t *, int);
+int64_t iu_dot_indexed_u8i8(const uint8_t *, const int *, const int8_t *, int);
+
+//----------------------------------------------------------------------------
+// Width-neutral half-precision conversions and dot products. Halves are IEEE
+// binary16 bit patterns stored in uint16_t; see intrinsics_utils.h.
+//----------------------------------------------------------------------------
+
+void iu_cvt_f16_to_f32(float *, const uint16_t *, int);
+void iu_cvt_f32_to_f16(uint16_t *, const float *, int);
+float iu_hdot(const uint16_t *, const uint16_t *, int);
+float iu_hdot_indexed(const uint16_t *, const int *, const uint16_t *, int);
+
+//----------------------------------------------------------------------------
+// Width-neutral weighted stencils and SmoothLife transition; see
+// intrinsics_utils.h and smoothlife.h.
+//----------------------------------------------------------------------------
+
+struct iu_smoothlife_params;
+
+void iu_stencil_ps(float *, const float *, int, const int *, const float *, int);
+void iu_smoothlife_transition_ps(float *, const float *, const float *, int, const struct iu_smoothlife_params *);
+
+//----------------------------------------------------------------------------
+// Width-neutral FFT kernels on interleaved complex floats; see
+// intrinsics_utils.h and fft.h.
+//----------------------------------------------------------------------------
+
+void iu_fft_stage_ps(float *, const float *, int, int, int, const float *, const float *);
+void iu_cmul_ps(float *, const float *, const float *, int);
+
+//----------------------------------------------------------------------------
+// Width-neutral summed-area table kernels; see intrinsics_utils.h and sat.h.
+//----------------------------------------------------------------------------
+
+void iu_sat_build_ps(float *, int, const float *, int, int, int);
+void iu_sat_build_pd(double *, int, const double *, int, int, int);
+void iu_sat_box_ps(float *, const float *, const float *, const float *, float, int, int, int);
+void iu_sat_box_pd(double *, const double *, const double *, const double *, double, int, int, int);
+
+//----------------------------------------------------------------------------
+// Width-neutral transposes; see intrinsics_utils.h. iu_transpose_ps(order,
+// nrows, ncols, a, lda, b, ldb) writes the ncols by nrows transpose of a to
+// b. Called with COLUMN_MAJOR_ORDER it turns a column-major matrix into the
+// same matrix in row-major order, and with ROW_MAJOR_ORDER the reverse.
+//----------------------------------------------------------------------------
+
+void iu_transpose_ps(char, int, int, const float *, int, float *, int);
+void iu_transpose_pd(char, int, int, const double *, int, double *, int);
+void iu_transpose_epi32(char, int, int, const int *, int, int *, int);
+
+void iu_transpose_inplace_ps(int, float *, int);
+void iu_transpose_inplace_pd(int, double *, int);
+void iu_transpose_inplace_epi32(int, int *, int);
+
+//----------------------------------------------------------------------------
+// Width-neutral reductions over two-dimensional gathers; see
+// intrinsics_utils.h. iu_sum2d_indexed_ps(src, nrows, iind, jind, numi, numj)
+// equals summing the output of iu_copy2d_indexed_ps with the same arguments,
+// and iu_dot2d_indexed_ps takes its dot product with w, without the buffer.
+//----------------------------------------------------------------------------
+
+float iu_sum2d_indexed_ps(const float *, int, const int *, const int *, int, int);
+float iu_dot2d_indexed_ps(const float *, int, const int *, const int *, int, int, const float *);
+double iu_sum2d_indexed_pd(const double *, int, const int *, const int *, int, int);
+double iu_dot2d_indexed_pd(const double *, int, const int *, const int *, int, int, const double *);
+
+//----------------------------------------------------------------------------
+// Width-neutral matrix-vector products y = A x. The order is ROW_MAJOR_ORDER
+// or COLUMN_MAJOR_ORDER from constants.h; lda is the distance between
+// consecutive rows or columns respectively.
+//----------------------------------------------------------------------------
+
+void iu_sgemv(char, int, int, const float *, int, const float *, float *);
+void iu_dgemv(char, int, int, const double *, int, const double *, double *);
+
+//----------------------------------------------------------------------------
+// Width-neutral sparse matrix-vector products on the arrays of a CSR or
+// SELL-C-sigma matrix. See sparse.h for the formats and for building
+// SELL-C-sigma from CSR.
+//----------------------------------------------------------------------------
+
+void iu_scsrmv(int, const int *, const int *, const float *, const float *, float *);
+void iu_dcsrmv(int, const int *, const int *, const double *, const double *, double *);
+void iu_ssellmv(int, const int *, const int *, const int *, const float *, const float *, float *);
+void iu_dsellmv(int, const int *, const int *, const int *, const double *, const double *, double *);
+
+//----------------------------------------------------------------------------
+// Width-neutral reductions over span-compressed index lists. See
+// index_plan.h for the layout of the spans and singles arrays.
+//----------------------------------------------------------------------------
+
+float iu_fdot_spans(const float *, const float *, const int *, int, const int *, const int *, int);
+double iu_ddot_spans(const double *, const double *, const int *, int, const int *, const int *, int);
+float iu_fsum_spans(const float *, const int *, int, const int *, int);
+double iu_dsum_spans(const double *, const int *, int, const int *, int);
+void iu_copy_spans_ps(float *, const float *, const int *, int, const int *, const int *, int);
+
+//----------------------------------------------------------------------------
+// Width-neutral extrema of arrays. The arg functions return the first
+// position of the extremum, or -1 for an empty array.
+//----------------------------------------------------------------------------
+
+float iu_smin(const float *, int);
+float iu_smax(const float *, int);
+int iu_sargmin(const float *, int);
+int iu_sargmax(const float *, int);
+
+double iu_dmin(const double *, int);
+double iu_dmax(const double *, int);
+int iu_dargmin(const double *, int);
+int iu_dargmax(const double *, int);
+
+//----------------------------------------------------------------------------
+// Width-neutral kernels for buffers from iu_alloc_padded. See
+// intrinsics_utils.h for the padding guarantee they rely on.
+//----------------------------------------------------------------------------
+
+void iu_sset_value_padded(float *, int, float);
+void iu_dset_value_padded(double *, int, double);
+float iu_fdot_padded(const float *, const float *, int);
+double iu_ddot_padded(const double *, const double *, int);
+float iu_fdot_indexed_padded(const float *, const int *, const float *, int);
+double iu_ddot_indexed_padded(const double *, const int *, const double *, int);
+void iu_copy1d_ps_padded(float *, const float *, int);
+void iu_copy1d_epi32_padded(int *, const int *, int);
+
+//----------------------------------------------------------------------------
+// Width-neutral routines for copying data.
+//----------------------------------------------------------------------------
+
+void iu_copy1d_epi32(int *, const int *, int);
+void iu_copy2d_epi32(int *, int, const int *, const int *, int, int);
+void iu_copy2d_epi32_ld(char, int *, int, int, const int *, const int *, int, int);
+
+void iu_copy1d_ps(float *, const float *, int);
+void iu_copy2d_indexed_ps(float *, const float *, int, const int *, const int *, int, int);
+void iu_copy2d_indexed_ps_ld(char, float *, int, const float *, int, const int *, const int *, int, int);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,117 @@
+#ifndef FFT_H
+#define FFT_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//----------------------------------------------------------------------------
+// Fast Fourier transforms on interleaved complex floats (re, im pairs),
+// without external libraries. A length is factored into radices 4 and 2,
+// then 3, 5 and any remaining primes, and every factor becomes one Stockham
+// stage (see iu_fft_stage_ps), so all positive lengths are supported, but a
+// prime factor p costs O(p) operations per element. Transforms are
+// unnormalised: an inverse transform after a forward one scales by n.
+//----------------------------------------------------------------------------
+
+#define IU_FFT_FORWARD (-1)
+#define IU_FFT_INVERSE 1
+
+#define FFT_MAX_STAGES 32
+
+// For each direction, the tables hold for every stage the p roots of unity
+// followed by the (p - 1) twiddles of each of the m butterfly groups, all as
+// complex values, starting at stage_offset[s] floats.
+struct iu_fft_plan {
+	int n;
+	int nstages;
+	int radix[FFT_MAX_STAGES];
+	size_t stage_offset[FFT_MAX_STAGES];
+	float *tables[2];
+};
+
+//----------------------------------------------------------------------------
+// Functions for one-dimensional transforms. iu_fft_batch transforms batch
+// interleaved sequences at once: element e of every sequence is stored in
+// the batch consecutive complex values starting at data + 2 e batch, so
+// registers run across sequences. work must hold as many values as data.
+// The direction is IU_FFT_FORWARD (exp(-2 pi i jk / n)) or IU_FFT_INVERSE.
+// NULL is returned if memory cannot be allocated or n < 1.
+//----------------------------------------------------------------------------
+
+struct iu_fft_plan *iu_fft_plan_create(int);
+
+void iu_fft_plan_free(struct iu_fft_plan *);
+
+void iu_fft_batch(const struct iu_fft_plan *, float *, float *, int, int);
+
+//----------------------------------------------------------------------------
+// Real two-dimensional transforms of column-major grids of nrows by ncols.
+// Real data has a Hermitian spectrum, so only the column frequencies below
+// hcols = ncols / 2 + 1 are kept, for every row frequency. The spectrum is
+// stored transposed, column frequency fastest: frequency (kr, kc) is the
+// complex value at index kc + kr hcols. Even ncols pack pairs of columns
+// into one complex transform of half the length; odd ncols use a full
+// complex transform. iu_fft2d_c2r normalises, so it inverts iu_fft2d_r2c,
+// and leaves its input unchanged. A plan owns scratch memory, so one plan
+// must not be used by two threads at once.
+//----------------------------------------------------------------------------
+
+struct iu_fft2d {
+	int nrows;
+	int ncols;
+	int hcols;
+
+	struct iu_fft_plan *row_plan;
+	struct iu_fft_plan *col_plan;
+
+	float *split;
+	float *work;
+};
+
+struct iu_fft2d *iu_fft2d_create(int, int);
+
+void iu_fft2d_free(struct iu_fft2d *);
+
+void iu_fft2d_r2c(struct iu_fft2d *, float *, const float *);
+void iu_fft2d_c2r(struct iu_fft2d *, float *, const float *);
+
+//----------------------------------------------------------------------------
+// Periodic convolution of a real grid with fixed kernels. The nkernels
+// kernels are given as consecutive real grids of nrows by ncols with the
+// origin at cell (0, 0), so an offset (di, dj) with negative components
+// wraps to the far rows and columns. Their spectra are computed once;
+// iu_conv2d_apply(conv, out, f) then sets
+//
+//   out[k][i, j] = sum over (a, b) of kernel_k[a, b] f[i - a, j - b]
+//
+// with indices taken modulo the grid, at the cost of one forward and
+// nkernels inverse transforms. iu_conv2d_prefer_fft estimates whether that
+// beats direct summation of nweights weights in total for nkernels kernels
+// on the same grid.
+//----------------------------------------------------------------------------
+
+struct iu_conv2d {
+	struct iu_fft2d *fft;
+	int nkernels;
+
+	float *spectra;
+	float *spectrum;
+	float *product;
+};
+
+struct iu_conv2d *iu_conv2d_create(int, int, const float *, int);
+
+void iu_conv2d_free(struct iu_conv2d *);
+
+void iu_conv2d_apply(struct iu_conv2d *, float *const *, const float *);
+
+int iu_conv2d_prefer_fft(int, int, int, int);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,68 @@
+#ifndef INDEX_PLAN_H
+#define INDEX_PLAN_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//----------------------------------------------------------------------------
+// Span-compressed index lists. Runs of at least min_span consecutive indices
+// are stored in spans as (start, length, offset) triples, where offset is the
+// position of the run's first index in the original list. The remaining
+// indices are kept in singles, with their positions in single_offsets. Plans
+// built once for a fixed neighbourhood replace gathers with contiguous loads
+// in every reduction that uses them.
+//----------------------------------------------------------------------------
+
+#define PLAN_MIN_SPAN 4
+
+struct iu_index_plan {
+	int len;
+
+	int nspans;
+	int *spans;
+
+	int nsingles;
+	int *singles;
+	int *single_offsets;
+};
+
+//----------------------------------------------------------------------------
+// Functions for building plans. A min_span of zero or less selects
+// PLAN_MIN_SPAN. iu_index_plan_from_radius(ld, inner, outer) takes the
+// offsets dj * ld + di of the cells whose distance from the centre lies in
+// [inner, outer), listed column by column; an inner radius of zero gives a
+// disk and a positive one an annulus. The offsets are relative to the centre,
+// so one plan serves every cell of a column-major grid with leading
+// dimension ld: pass a pointer to the centre cell when applying it. The grid
+// must be padded by (int)outer cells on every side, as the SmoothLife engine
+// pads its field, and NULL is returned if ld is less than 2 (int)outer + 1.
+// NULL is also returned if memory cannot be allocated.
+//----------------------------------------------------------------------------
+
+struct iu_index_plan *iu_index_plan_from_indices(const int *, int, int);
+struct iu_index_plan *iu_index_plan_from_radius(int, double, double);
+
+void iu_index_plan_free(struct iu_index_plan *);
+
+//----------------------------------------------------------------------------
+// Reductions over a plan. iu_fdot_plan(plan, x, y) equals
+// iu_fdot_indexed(x, indices, y, len) for the indices the plan was built
+// from, up to rounding; iu_copy_plan_ps(plan, dst, src) sets
+// dst[k] = src[indices[k]]. Indices may be negative, as the offsets of a
+// radius plan are, as long as x + indices[k] lies in the array.
+//----------------------------------------------------------------------------
+
+float iu_fdot_plan(const struct iu_index_plan *, const float *, const float *);
+double iu_ddot_plan(const struct iu_index_plan *, const double *, const double *);
+
+float iu_fsum_plan(const struct iu_index_plan *, const float *);
+double iu_dsum_plan(const struct iu_index_plan *, const double *);
+
+void iu_copy_plan_ps(const struct iu_index_plan *, float *, const float *);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -8,11 +8,56 @@ extern "C" {
 #endif
 
 #include <immintrin.h>
+#include <stddef.h>
+#include <stdint.h>
+
+//----------------------------------------------------------------------------
+// Functions for configuring non-temporal stores. The AVX2 and AVX-512
+// set_value and copy1d kernels stream their output, bypassing the cache,
+// once it spans at least iu_stream_threshold() bytes. The default is a
+// fraction of the last-level cache (see constants.h), or the value of the
+// IU_STREAM_THRESHOLD environment variable in bytes. An empty, zero or
+// non-numeric value is ignored, as passing 0 to iu_set_stream_threshold
+// restores the default; SIZE_MAX disables streaming.
+//----------------------------------------------------------------------------
+
+size_t iu_stream_threshold(void);
+void iu_set_stream_threshold(size_t);
+
+//----------------------------------------------------------------------------
+// Functions for configuring two-dimensional copies. The copy2d kernels walk
+// the iind by jind product in one of three orders:
+//
+// COPY2D_CONTIGUOUS copies each column whole, its partial register first.
+// COPY2D_SPLIT copies the partial registers of every column first, then the
+// whole registers column by column.
+// COPY2D_TILED (the default) copies tiles of rows and columns sized from the
+// L1 and L2 caches (see constants.h), so a tile's row indices stay in L1 for
+// every column it covers. Copies no taller than a tile run as
+// COPY2D_CONTIGUOUS.
+//
+// iu_set_copy2d_strategy returns -1 for an unknown strategy. The cache sizes
+// are detected at load time; passing 0 to iu_set_copy2d_cache restores the
+// detected size.
+//----------------------------------------------------------------------------
+
+#define COPY2D_CONTIGUOUS 0
+#define COPY2D_SPLIT 1
+#define COPY2D_TILED 2
+
+int iu_copy2d_strategy(void);
+int iu_set_copy2d_strategy(int);
+
+void iu_copy2d_cache(size_t *, size_t *);
+void iu_set_copy2d_cache(size_t, size_t);
 
 //----------------------------------------------------------------------------
 // Functions for setting values of arrays.
 //----------------------------------------------------------------------------
 
+void _mm_sset_value(float *, int, float);
+void _mm_dset_value(double *, int, double);
+
 void _mm256_sset_value(float *, int, float);
 void _mm256_dset_value(double *, int, double);
 
@@ -23,6 +68,14 @@ void _mm512_dset_value(double *, int, double);
 // Functions for computing sums of elements in registers.
 //----------------------------------------------------------------------------
 
+float _mm_fdot(const float *, const float *, int);
+float _mm_fdot_indexed(const float *, const int *, const float *, int);
+float _mm_fdot_indexed2(const float *, const int *, const float *, const int *, int);
+
+double _mm_ddot(const double *, const double *, int);
+double _mm_ddot_indexed(const double *, const int *, const double *, int);
+double _mm_ddot_indexed2(const double *, const int *, const double *, const int *, int);
+
 float _mm256_fdot(const float *, const float *, int);
 float _mm256_fdot_indexed(const float *, const int *, const float *, int);
 float _mm256_fdot_indexed2(const float *, const int *, const float *, const int *, int);
@@ -41,6 +94,28 @@ double _mm512_ddot_indexed(const double *, const int *, const double *, int);
 double _mm512_ddot_indexed2(const double *, const int *, const double *, const int *, int);
 #endif
 
+float _mm256_fdot_kahan(const float *, const float *, int);
+float _mm256_fdot_indexed_kahan(const float *, const int *, const float *, int);
+double _mm256_ddot_kahan(const double *, const double *, int);
+double _mm256_ddot_indexed_kahan(const double *, const int *, const double *, int);
+
+#ifdef SUPPORTS_AVX512
+float _mm512_fdot_kahan(const float *, const float *, int);
+float _mm512_fdot_indexed_kahan(const float *, const int *, const float *, int);
+double _mm512_ddot_kahan(const double *, const double *, int);
+double _mm512_ddot_indexed_kahan(const double *, const int *, const double *, int);
+#endif
+
+double _mm256_fdot_acc64(const float *, const float *, int);
+double _mm256_fdot_indexed_acc64(const float *, const int *, const float *, int);
+double _mm256_fdot_indexed2_acc64(const float *, const int *, const float *, const int *, int);
+
+#ifdef SUPPORTS_AVX512
+double _mm512_fdot_acc64(const float *, const float *, int);
+double _mm512_fdot_indexed_acc64(const float *, const int *, const float *, int);
+double _mm512_fdot_indexed2_acc64(const float *, const int *, const float *, const int *, int);
+#endif
+
 float _mm_register_sum_ps(__m128);
 double _mm_register_sum_pd(__m128d);
 int _mm_count_nonzero_ps(__m128);
@@ -58,6 +133,412 @@ int _mm512_count_nonzero_ps(__m512);
 int _mm512_count_nonzero_pd(__m512d);
 #endif
 
+//----------------------------------------------------------------------------
+// Functions for computing matrix-vector products.
+//----------------------------------------------------------------------------
+
+void _mm_sgemv(char, int, int, const float *, int, const float *, float *);
+void _mm_dgemv(char, int, int, const double *, int, const double *, double *);
+
+void _mm256_sgemv(char, int, int, const float *, int, const float *, float *);
+void _mm256_dgemv(char, int, int, const double *, int, const double *, double *);
+
+#ifdef SUPPORTS_AVX512
+void _mm512_sgemv(char, int, int, const float *, int, const float *, float *);
+void _mm512_dgemv(char, int, int, const double *, int, const double *, double *);
+#endif
+
+//----------------------------------------------------------------------------
+// Functions for computing sparse matrix-vector products.
+//----------------------------------------------------------------------------
+
+void _mm_scsrmv(int, const int *, const int *, const float *, const float *, float *);
+void _mm_dcsrmv(int, const int *, const int *, const double *, const double *, double *);
+void _mm_ssellmv(int, const int *, const int *, const int *, const float *, const float *, float *);
+void _mm_dsellmv(int, const int *, const int *, const int *, const double *, const double *, double *);
+
+void _mm256_scsrmv(int, const int *, const int *, const float *, const float *, float *);
+void _mm256_dcsrmv(int, const int *, const int *, const double *, const double *, double *);
+void _mm256_ssellmv(int, const int *, const int *, const int *, const float *, const float *, float *);
+void _mm256_dsellmv(int, const int *, const int *, const int *, const double *, const double *, double *);
+
+#ifdef SUPPORTS_AVX512
+void _mm512_scsrmv(int, const int *, const int *, const float *, const float *, float *);
+void _mm512_dcsrmv(int, const int *, const int *, const double *, const double *, double *);
+void _mm512_ssellmv(int, const int *, const int *, const int *, const float *, const float *, float *);
+void _mm512_dsellmv(int, const int *, const int *, const int *, const double *, const double *, double *);
+#endif
+
+//----------------------------------------------------------------------------
+// Indexed kernels with software prefetching. The last argument is the
+// prefetch distance in elements; zero or less selects the default for the
+// width.
+//----------------------------------------------------------------------------
+
+float _mm256_fdot_indexed_prefetch(const float *, const int *, const float *, int, int);
+float _mm256_fdot_indexed2_prefetch(const float *, const int *, const float *, const int *, int, int);
+double _mm256_ddot_indexed_prefetch(const double *, const int *, const double *, int, int);
+double _mm256_ddot_indexed2_prefetch(const double *, const int *, const double *, const int *, int, int);
+void _mm256_copy2d_indexed_ps_prefetch(float *, const float *, int, const int *, const int *, int, int, int);
+
+#ifdef SUPPORTS_AVX512
+float _mm512_fdot_indexed_prefetch(const float *, const int *, const float *, int, int);
+float _mm512_fdot_indexed2_prefetch(const float *, const int *, const float *, const int *, int, int);
+double _mm512_ddot_indexed_prefetch(const double *, const int *, const double *, int, int);
+double _mm512_ddot_indexed2_prefetch(const double *, const int *, const double *, const int *, int, int);
+#endif
+
+//----------------------------------------------------------------------------
+// Indexed kernels with gathers emulated by scalar loads and inserts.
+//----------------------------------------------------------------------------
+
+float _mm256_fdot_indexed_emu(const float *, const int *, const float *, int);
+float _mm256_fdot_indexed2_emu(const float *, const int *, const float *, const int *, int);
+double _mm256_ddot_indexed_emu(const double *, const int *, const double *, int);
+double _mm256_ddot_indexed2_emu(const double *, const int *, const double *, const int *, int);
+void _mm256_copy2d_indexed_ps_emu(float *, const float *, int, const int *, const int *, int, int);
+void _mm256_copy2d_indexed_ps_ld_emu(char, float *, int, const float *, int, const int *, const int *, int, int);
+float _mm256_sum2d_indexed_ps_emu(const float *, int, const int *, const int *, int, int);
+float _mm256_dot2d_indexed_ps_emu(const float *, int, const int *, const int *, int, int, const float *);
+double _mm256_sum2d_indexed_pd_emu(const double *, int, const int *, const int *, int, int);
+double _mm256_dot2d_indexed_pd_emu(const double *, int, const int *, const int *, int, int, const double *);
+float _mm256_fdot_indexed_padded_emu(const float *, const int *, const float *, int);
+double _mm256_ddot_indexed_padded_emu(const double *, const int *, const double *, int);
+void _mm256_ssellmv_emu(int, const int *, const int *, const int *, const float *, const float *, float *);
+void _mm256_dsellmv_emu(int, const int *, const int *, const int *, const double *, const double *, double *);
+void _mm256_scsrmv_emu(int, const int *, const int *, const float *, const float *, float *);
+void _mm256_dcsrmv_emu(int, const int *, const int *, const double *, const double *, double *);
+
+#ifdef SUPPORTS_AVX512
+float _mm512_fdot_indexed_emu(const float *, const int *, const float *, int);
+float _mm512_fdot_indexed2_emu(const float *, const int *, const float *, const int *, int);
+double _mm512_ddot_indexed_emu(const double *, const int *, const double *, int);
+double _mm512_ddot_indexed2_emu(const double *, const int *, const double *, const int *, int);
+void _mm512_copy2d_indexed_ps_emu(float *, const float *, int, const int *, const int *, int, int);
+void _mm512_copy2d_indexed_ps_ld_emu(char, float *, int, const float *, int, const int *, const int *, int, int);
+float _mm512_sum2d_indexed_ps_emu(const float *, int, const int *, const int *, int, int);
+float _mm512_dot2d_indexed_ps_emu(const float *, int, const int *, const int *, int, int, const float *);
+double _mm512_sum2d_indexed_pd_emu(const double *, int, const int *, const int *, int, int);
+double _mm512_dot2d_indexed_pd_emu(const double *, int, const int *, const int *, int, int, const double *);
+float _mm512_fdot_indexed_padded_emu(const float *, const int *, const float *, int);
+double _mm512_ddot_indexed_padded_emu(const double *, const int *, const double *, int);
+void _mm512_ssellmv_emu(int, const int *, const int *, const int *, const float *, const float *, float *);
+void _mm512_dsellmv_emu(int, const int *, const int *, const int *, const double *, const double *, double *);
+void _mm512_scsrmv_emu(int, const int *, const int *, const float *, const float *, float *);
+void _mm512_dcsrmv_emu(int, const int *, const int *, const double *, const double *, double *);
+#endif
+
+//----------------------------------------------------------------------------
+// Functions driven by span-compressed index lists.
+//----------------------------------------------------------------------------
+
+float _mm_fdot_spans(const float *, const float *, const int *, int, const int *, const int *, int);
+double _mm_ddot_spans(const double *, const double *, const int *, int, const int *, const int *, int);
+float _mm_fsum_spans(const float *, const int *, int, const int *, int);
+double _mm_dsum_spans(const double *, const int *, int, const int *, int);
+void _mm_copy_spans_ps(float *, const float *, const int *, int, const int *, const int *, int);
+
+float _mm256_fdot_spans(const float *, const float *, const int *, int, const int *, const int *, int);
+double _mm256_ddot_spans(const double *, const double *, const int *, int, const int *, const int *, int);
+float _mm256_fsum_spans(const float *, const int *, int, const int *, int);
+double _mm256_dsum_spans(const double *, const int *, int, const int *, int);
+void _mm256_copy_spans_ps(float *, const float *, const int *, int, const int *, const int *, int);
+
+#ifdef SUPPORTS_AVX512
+float _mm512_fdot_spans(const float *, const float *, const int *, int, const int *, const int *, int);
+double _mm512_ddot_spans(const double *, const double *, const int *, int, const int *, const int *, int);
+float _mm512_fsum_spans(const float *, const int *, int, const int *, int);
+double _mm512_dsum_spans(const double *, const int *, int, const int *, int);
+void _mm512_copy_spans_ps(float *, const float *, const int *, int, const int *, const int *, int);
+#endif
+
+//----------------------------------------------------------------------------
+// Functions for finding the extrema of arrays and their first positions.
+//----------------------------------------------------------------------------
+
+float _mm_smin(const float *, int);
+float _mm_smax(const float *, int);
+int _mm_sargmin(const float *, int);
+int _mm_sargmax(const float *, int);
+
+double _mm_dmin(const double *, int);
+double _mm_dmax(const double *, int);
+int _mm_dargmin(const double *, int);
+int _mm_dargmax(const double *, int);
+
+float _mm256_smin(const float *, int);
+float _mm256_smax(const float *, int);
+int _mm256_sargmin(const float *, int);
+int _mm256_sargmax(const float *, int);
+
+double _mm256_dmin(const double *, int);
+double _mm256_dmax(const double *, int);
+int _mm256_dargmin(const double *, int);
+int _mm256_dargmax(const double *, int);
+
+#ifdef SUPPORTS_AVX512
+float _mm512_smin(const float *, int);
+float _mm512_smax(const float *, int);
+int _mm512_sargmin(const float *, int);
+int _mm512_sargmax(const float *, int);
+
+double _mm512_dmin(const double *, int);
+double _mm512_dmax(const double *, int);
+int _mm512_dargmin(const double *, int);
+int _mm512_dargmax(const double *, int);
+#endif
+
+//----------------------------------------------------------------------------
+// Functions for padded buffers. iu_alloc_padded returns zeroed memory for n
+// elements of the given size, aligned to PADDED_ALIGNMENT bytes, with the
+// byte count rounded up to whole blocks of that size, or NULL if the byte
+// count overflows or memory cannot be allocated; release it with
+// iu_free_padded. iu_padded_length gives the number of elements that fit,
+// for any element size. The _padded kernels require such buffers (for the
+// indices too). They process whole registers with aligned loads and stores
+// and keep the padding zero.
+//----------------------------------------------------------------------------
+
+size_t iu_padded_length(size_t, size_t);
+void *iu_alloc_padded(size_t, size_t);
+void iu_free_padded(void *);
+
+void _mm_sset_value_padded(float *, int, float);
+void _mm_dset_value_padded(double *, int, double);
+float _mm_fdot_padded(const float *, const float *, int);
+double _mm_ddot_padded(const double *, const double *, int);
+float _mm_fdot_indexed_padded(const float *, const int *, const float *, int);
+double _mm_ddot_indexed_padded(const double *, const int *, const double *, int);
+void _mm_copy1d_ps_padded(float *, const float *, int);
+void _mm_copy1d_epi32_padded(int *, const int *, int);
+
+void _mm256_sset_value_padded(float *, int, float);
+void _mm256_dset_value_padded(double *, int, double);
+float _mm256_fdot_padded(const float *, const float *, int);
+double _mm256_ddot_padded(const double *, const double *, int);
+float _mm256_fdot_indexed_padded(const float *, const int *, const float *, int);
+double _mm256_ddot_indexed_padded(const double *, const int *, const double *, int);
+void _mm256_copy1d_ps_padded(float *, const float *, int);
+void _mm256_copy1d_epi32_padded(int *, const int *, int);
+
+#ifdef SUPPORTS_AVX512
+void _mm512_sset_value_padded(float *, int, float);
+void _mm512_dset_value_padded(double *, int, double);
+float _mm512_fdot_padded(const float *, const float *, int);
+double _mm512_ddot_padded(const double *, const double *, int);
+float _mm512_fdot_indexed_padded(const float *, const int *, const float *, int);
+double _mm512_ddot_indexed_padded(const double *, const int *, const double *, int);
+void _mm512_copy1d_ps_padded(float *, const float *, int);
+void _mm512_copy1d_epi32_padded(int *, const int *, int);
+#endif
+
+//----------------------------------------------------------------------------
+// Integer dot products, summed in 64 bits. The u8i8 kernels multiply
+// unsigned bytes of x with signed bytes of y. The AVX-512 int16 and int8
+// kernels need AVX512BW, and the _vnni variants use vpdpbusd from AVX-VNNI and
+// AVX512-VNNI respectively.
+//----------------------------------------------------------------------------
+
+int64_t _mm_dot_epi32(const int *, const int *, int);
+int64_t _mm_dot_indexed_epi32(const int *, const int *, const int *, int);
+int64_t _mm_dot_epi16(const int16_t *, const int16_t *, int);
+int64_t _mm_dot_indexed_epi16(const int16_t *, const int *, const int16_t *, int);
+int64_t _mm_dot_u8i8(const uint8_t *, const int8_t *, int);
+int64_t _mm_dot_indexed_u8i8(const uint8_t *, const int *, const int8_t *, int);
+
+int64_t _mm256_dot_epi32(const int *, const int *, int);
+int64_t _mm256_dot_indexed_epi32(const int *, const int *, const int *, int);
+int64_t _mm256_dot_epi16(const int16_t *, const int16_t *, int);
+int64_t _mm256_dot_indexed_epi16(const int16_t *, const int *, const int16_t *, int);
+int64_t _mm256_dot_u8i8(const uint8_t *, const int8_t *, int);
+int64_t _mm256_dot_indexed_u8i8(const uint8_t *, const int *, const int8_t *, int);
+
+#ifdef SUPPORTS_AVXVNNI
+int64_t _mm256_dot_u8i8_vnni(const uint8_t *, const int8_t *, int);
+#endif
+
+#ifdef SUPPORTS_AVX512
+int64_t _mm512_dot_epi32(const int *, const int *, int);
+int64_t _mm512_dot_indexed_epi32(const int *, const int *, const int *, int);
+#endif
+
+#ifdef SUPPORTS_AVX512BW
+int64_t _mm512_dot_epi16(const int16_t *, const int16_t *, int);
+int64_t _mm512_dot_indexed_epi16(const int16_t *, const int *, const int16_t *, int);
+int64_t _mm512_dot_u8i8(const uint8_t *, const int8_t *, int);
+int64_t _mm512_dot_indexed_u8i8(const uint8_t *, const int *, const int8_t *, int);
+#endif
+
+#ifdef SUPPORTS_AVX512VNNI
+int64_t _mm512_dot_u8i8_vnni(const uint8_t *, const int8_t *, int);
+#endif
+
+//----------------------------------------------------------------------------
+// Half-precision storage. Halves are IEEE binary16 bit patterns in uint16_t,
+// converted with round to nearest even. The hdot kernels widen both operands
+// to float as they load them, and the _acc64 variants accumulate in double.
+//----------------------------------------------------------------------------
+
+void _mm_cvt_f16_to_f32(float *, const uint16_t *, int);
+void _mm_cvt_f32_to_f16(uint16_t *, const float *, int);
+float _mm_hdot(const uint16_t *, const uint16_t *, int);
+float _mm_hdot_indexed(const uint16_t *, const int *, const uint16_t *, int);
+
+void _mm256_cvt_f16_to_f32(float *, const uint16_t *, int);
+void _mm256_cvt_f32_to_f16(uint16_t *, const float *, int);
+float _mm256_hdot(const uint16_t *, const uint16_t *, int);
+float _mm256_hdot_indexed(const uint16_t *, const int *, const uint16_t *, int);
+double _mm256_hdot_acc64(const uint16_t *, const uint16_t *, int);
+double _mm256_hdot_indexed_acc64(const uint16_t *, const int *, const uint16_t *, int);
+
+#ifdef SUPPORTS_AVX512
+void _mm512_cvt_f16_to_f32(float *, const uint16_t *, int);
+void _mm512_cvt_f32_to_f16(uint16_t *, const float *, int);
+float _mm512_hdot(const uint16_t *, const uint16_t *, int);
+float _mm512_hdot_indexed(const uint16_t *, const int *, const uint16_t *, int);
+double _mm512_hdot_acc64(const uint16_t *, const uint16_t *, int);
+double _mm512_hdot_indexed_acc64(const uint16_t *, const int *, const uint16_t *, int);
+#endif
+
+//----------------------------------------------------------------------------
+// Weighted stencils, dst[i] = sum over k of weights[k] * src[i + offsets[k]],
+// and the SmoothLife transition applied in place to f from the integrals m
+// and n. The parameters are those of the SmoothLife engine, described in
+// smoothlife.h, which takes the definition from here so that the kernels do
+// not depend on the engine.
+//----------------------------------------------------------------------------
+
+struct iu_smoothlife_params {
+	float ri;
+	float ra;
+	float b1;
+	float b2;
+	float d1;
+	float d2;
+	float alpha_n;
+	float alpha_m;
+	float dt;
+};
+
+void _mm_stencil_ps(float *, const float *, int, const int *, const float *, int);
+void _mm_smoothlife_transition_ps(float *, const float *, const float *, int, const struct iu_smoothlife_params *);
+
+void _mm256_stencil_ps(float *, const float *, int, const int *, const float *, int);
+void _mm256_smoothlife_transition_ps(float *, const float *, const float *, int, const struct iu_smoothlife_params *);
+
+#ifdef SUPPORTS_AVX512
+void _mm512_stencil_ps(float *, const float *, int, const int *, const float *, int);
+void _mm512_smoothlife_transition_ps(float *, const float *, const float *, int, const struct iu_smoothlife_params *);
+#endif
+
+//----------------------------------------------------------------------------
+// FFT kernels on interleaved complex floats: one radix-p Stockham stage (see
+// fft.h) and the pointwise product dst = x * y of n complex values.
+//----------------------------------------------------------------------------
+
+void _mm_fft_stage_ps(float *, const float *, int, int, int, const float *, const float *);
+void _mm_cmul_ps(float *, const float *, const float *, int);
+
+void _mm256_fft_stage_ps(float *, const float *, int, int, int, const float *, const float *);
+void _mm256_cmul_ps(float *, const float *, const float *, int);
+
+#ifdef SUPPORTS_AVX512
+void _mm512_fft_stage_ps(float *, const float *, int, int, int, const float *, const float *);
+void _mm512_cmul_ps(float *, const float *, const float *, int);
+#endif
+
+//----------------------------------------------------------------------------
+// Summed-area tables: building a table of nlines + 1 lines of len + 1 sums
+// from a grid, and the four-corner box sums of len consecutive cells from
+// two (or three) of its lines (see sat.h).
+//----------------------------------------------------------------------------
+
+void _mm_sat_build_ps(float *, int, const float *, int, int, int);
+void _mm_sat_build_pd(double *, int, const double *, int, int, int);
+void _mm_sat_box_ps(float *, const float *, const float *, const float *, float, int, int, int);
+void _mm_sat_box_pd(double *, const double *, const double *, const double *, double, int, int, int);
+
+void _mm256_sat_build_ps(float *, int, const float *, int, int, int);
+void _mm256_sat_build_pd(double *, int, const double *, int, int, int);
+void _mm256_sat_box_ps(float *, const float *, const float *, const float *, float, int, int, int);
+void _mm256_sat_box_pd(double *, const double *, const double *, const double *, double, int, int, int);
+
+#ifdef SUPPORTS_AVX512
+void _mm512_sat_build_ps(float *, int, const float *, int, int, int);
+void _mm512_sat_build_pd(double *, int, const double *, int, int, int);
+void _mm512_sat_box_ps(float *, const float *, const float *, const float *, float, int, int, int);
+void _mm512_sat_box_pd(double *, const double *, const double *, const double *, double, int, int, int);
+#endif
+
+//----------------------------------------------------------------------------
+// Functions for transposing registers and matrices. The register functions
+// transpose a square of registers in place. The matrix functions take
+// (order, nrows, ncols, a, lda, b, ldb) and write the transpose of a to b,
+// in the same order, which is also a copied into the other order. The
+// in-place functions take (n, a, lda) for a square matrix.
+//----------------------------------------------------------------------------
+
+void _mm_transpose4_ps(__m128 *);
+void _mm_transpose4_epi32(__m128i *);
+void _mm_transpose2_pd(__m128d *);
+
+void _mm_transpose_ps(char, int, int, const float *, int, float *, int);
+void _mm_transpose_pd(char, int, int, const double *, int, double *, int);
+void _mm_transpose_epi32(char, int, int, const int *, int, int *, int);
+
+void _mm_transpose_inplace_ps(int, float *, int);
+void _mm_transpose_inplace_pd(int, double *, int);
+void _mm_transpose_inplace_epi32(int, int *, int);
+
+void _mm256_transpose8_ps(__m256 *);
+void _mm256_transpose8_epi32(__m256i *);
+void _mm256_transpose4_pd(__m256d *);
+
+void _mm256_transpose_ps(char, int, int, const float *, int, float *, int);
+void _mm256_transpose_pd(char, int, int, const double *, int, double *, int);
+void _mm256_transpose_epi32(char, int, int, const int *, int, int *, int);
+
+void _mm256_transpose_inplace_ps(int, float *, int);
+void _mm256_transpose_inplace_pd(int, double *, int);
+void _mm256_transpose_inplace_epi32(int, int *, int);
+
+#ifdef SUPPORTS_AVX512
+void _mm512_transpose16_ps(__m512 *);
+void _mm512_transpose16_epi32(__m512i *);
+void _mm512_transpose8_pd(__m512d *);
+
+void _mm512_transpose_ps(char, int, int, const float *, int, float *, int);
+void _mm512_transpose_pd(char, int, int, const double *, int, double *, int);
+void _mm512_transpose_epi32(char, int, int, const int *, int, int *, int);
+
+void _mm512_transpose_inplace_ps(int, float *, int);
+void _mm512_transpose_inplace_pd(int, double *, int);
+void _mm512_transpose_inplace_epi32(int, int *, int);
+#endif
+
+//----------------------------------------------------------------------------
+// Functions for reducing two-dimensional gathers. Each sums, or weights and
+// sums, src[iind[i] + jind[j] * nrows] over the iind by jind product without
+// copying it out first. The weights are numi by numj in column-major order.
+//----------------------------------------------------------------------------
+
+float _mm_sum2d_indexed_ps(const float *, int, const int *, const int *, int, int);
+float _mm_dot2d_indexed_ps(const float *, int, const int *, const int *, int, int, const float *);
+double _mm_sum2d_indexed_pd(const double *, int, const int *, const int *, int, int);
+double _mm_dot2d_indexed_pd(const double *, int, const int *, const int *, int, int, const double *);
+
+float _mm256_sum2d_indexed_ps(const float *, int, const int *, const int *, int, int);
+float _mm256_dot2d_indexed_ps(const float *, int, const int *, const int *, int, int, const float *);
+double _mm256_sum2d_indexed_pd(const double *, int, const int *, const int *, int, int);
+double _mm256_dot2d_indexed_pd(const double *, int, const int *, const int *, int, int, const double *);
+
+#ifdef SUPPORTS_AVX512
+float _mm512_sum2d_indexed_ps(const float *, int, const int *, const int *, int, int);
+float _mm512_dot2d_indexed_ps(const float *, int, const int *, const int *, int, int, const float *);
+double _mm512_sum2d_indexed_pd(const double *, int, const int *, const int *, int, int);
+double _mm512_dot2d_indexed_pd(const double *, int, const int *, const int *, int, int, const double *);
+#endif
+
 //----------------------------------------------------------------------------
 // Functions for computing statistics of registers.
 //----------------------------------------------------------------------------
@@ -67,6 +548,18 @@ float _mm256_register_min_ps(__m256);
 double _mm_register_min_pd(__m128d);
 double _mm256_register_min_pd(__m256d);
 
+float _mm_register_max_ps(__m128);
+float _mm256_register_max_ps(__m256);
+double _mm_register_max_pd(__m128d);
+double _mm256_register_max_pd(__m256d);
+
+#ifdef SUPPORTS_AVX512
+float _mm512_register_min_ps(__m512);
+double _mm512_register_min_pd(__m512d);
+float _mm512_register_max_ps(__m512);
+double _mm512_register_max_pd(__m512d);
+#endif
+
 
 //----------------------------------------------------------------------------
 // Functions for permuting elements in registers.
@@ -84,15 +577,88 @@ __m256i _mm256_rightperm_epi32(__m256i, int);
 __m256i _mm256_leftperm_epi64(__m256i, int);
 __m256i _mm256_rightperm_epi64(__m256i, int);
 
+#ifdef SUPPORTS_AVX512
+__m512 _mm512_leftperm_ps(__m512, int);
+__m512 _mm512_rightperm_ps(__m512, int);
+
+__m512d _mm512_leftperm_pd(__m512d, int);
+__m512d _mm512_rightperm_pd(__m512d, int);
+
+__m512i _mm512_leftperm_epi32(__m512i, int);
+__m512i _mm512_rightperm_epi32(__m512i, int);
+
+__m512i _mm512_leftperm_epi64(__m512i, int);
+__m512i _mm512_rightperm_epi64(__m512i, int);
+#endif
+
 //----------------------------------------------------------------------------
 // Helper routines for copying data.
 //----------------------------------------------------------------------------
 
+// The _ld variants take the storage order and leading dimensions of both
+// sides. Column-major copies read src[iind[i] + jind[j] * ldsrc] into
+// dst[i + j * lddst], row-major ones src[iind[i] * ldsrc + jind[j]] into
+// dst[i * lddst + j]. Unknown orders leave dst untouched.
+
+void _mm_copy1d_epi32(int *, const int *, int);
+void _mm_copy2d_epi32(int *, int, const int *, const int *, int, int);
+void _mm_copy2d_epi32_ld(char, int *, int, int, const int *, const int *, int, int);
+
+void _mm_copy1d_ps(float *, const float *, int);
+void _mm_copy2d_indexed_ps(float *, const float *, int, const int *, const int *, int, int);
+void _mm_copy2d_indexed_ps_ld(char, float *, int, const float *, int, const int *, const int *, int, int);
+
 void _mm256_copy1d_epi32(int *, const int *, int);
 void _mm256_copy2d_epi32(int *, int, const int *, const int *, int, int);
+void _mm256_copy2d_epi32_ld(char, int *, int, int, const int *, const int *, int, int);
 
 void _mm256_copy1d_ps(float *, const float *, int);
 void _mm256_copy2d_indexed_ps(float *, const float *, int, const int *, const int *, int, int);
+void _mm256_copy2d_indexed_ps_ld(char, float *, int, const float *, int, const int *, const int *, int, int);
+
+#ifdef SUPPORTS_AVX512
+void _mm512_copy1d_epi32(int *, const int *, int);
+void _mm512_copy2d_epi32(int *, int, const int *, const int *, int, int);
+void _mm512_copy2d_epi32_ld(char, int *, int, int, const int *, const int *, int, int);
+
+void _mm512_copy1d_ps(float *, const float *, int);
+void _mm512_copy2d_indexed_ps(float *, const float *, int, const int *, const int *, int, int);
+void _mm512_copy2d_indexed_ps_ld(char, float *, int, const float *, int, const int *, const int *, int, int);
+#endif
+
+//----------------------------------------------------------------------------
+// Functions taking 64-bit lengths and indices.
+//----------------------------------------------------------------------------
+
+void _mm256_sset_value_64(float *, size_t, float);
+void _mm256_dset_value_64(double *, size_t, double);
+
+float _mm256_fdot_64(const float *, const float *, size_t);
+float _mm256_fdot_indexed_64(const float *, const int64_t *, const float *, size_t);
+float _mm256_fdot_indexed2_64(const float *, const int64_t *, const float *, const int64_t *, size_t);
+
+double _mm256_ddot_64(const double *, const double *, size_t);
+double _mm256_ddot_indexed_64(const double *, const int64_t *, const double *, size_t);
+double _mm256_ddot_indexed2_64(const double *, const int64_t *, const double *, const int64_t *, size_t);
+
+void _mm256_copy1d_epi32_64(int *, const int *, size_t);
+void _mm256_copy2d_epi64(int64_t *, size_t, const int64_t *, const int64_t *, size_t, size_t);
+
+void _mm256_copy1d_ps_64(float *, const float *, size_t);
+void _mm256_copy2d_indexed_ps_64(float *, const float *, size_t, const int64_t *, const int64_t *, size_t, size_t);
+
+#ifdef SUPPORTS_AVX512
+void _mm512_sset_value_64(float *, size_t, float);
+void _mm512_dset_value_64(double *, size_t, double);
+
+float _mm512_fdot_64(const float *, const float *, size_t);
+float _mm512_fdot_indexed_64(const float *, const int64_t *, const float *, size_t);
+float _mm512_fdot_indexed2_64(const float *, const int64_t *, const float *, const int64_t *, size_t);
+
+double _mm512_ddot_64(const double *, const double *, size_t);
+double _mm512_ddot_indexed_64(const double *, const int64_t *, const double *, size_t);
+double _mm512_ddot_indexed2_64(const double *, const int64_t *, const double *, const int64_t *, size_t);
+#endif
 
 //----------------------------------------------------------------------------
 // Helper routines for printing and buffer storage.
@@ -12,31 +12,130 @@ extern "C" {
 #include <stdint.h>
 
 //----------------------------------------------------------------------------
-// Functions for creating masks.
+// Functions for creating masks. Masks are built without branches: a lane is
+// set when from <= lane <= to, which is tested by comparing a vector of lane
+// indices against broadcasts of from and to. Indices outside the register
+// simply match no lanes, and from > to gives an empty mask. The 64-bit masks
+// compare pairs of equal 32-bit lane indices, so both halves of each lane
+// agree.
+//
+// The definitions are inline so that kernels building a mask on every call,
+// such as the span tails of the index plans, do not pay for a call;
+// mask_utils.c emits the external definitions the library exports.
 //----------------------------------------------------------------------------
 
 // SSE* functions.
-__m128i _mm_setmask_fromto_epi32(int, int);
-__m128i _mm_setmask_fromto_epi64(int, int);
-__m128i _mm_set_mask_epi32(int);
-__m128i _mm_set_mask_epi64(int);
-__m128 _mm_set_mask_ps(int);
-__m128d _mm_set_mask_pd(int);
+inline __m128i _mm_setmask_fromto_epi32(int from, int to)
+{
+	__m128i lanes = _mm_setr_epi32(0, 1, 2, 3);
+	__m128i outside = _mm_or_si128(_mm_cmpgt_epi32(_mm_set1_epi32(from), lanes), _mm_cmpgt_epi32(lanes, _mm_set1_epi32(to)));
+
+	return _mm_andnot_si128(outside, _mm_set1_epi32(INT32_ALLBITS));
+}
+
+inline __m128i _mm_setmask_fromto_epi64(int from, int to)
+{
+	__m128i lanes = _mm_setr_epi32(0, 0, 1, 1);
+	__m128i outside = _mm_or_si128(_mm_cmpgt_epi32(_mm_set1_epi32(from), lanes), _mm_cmpgt_epi32(lanes, _mm_set1_epi32(to)));
+
+	return _mm_andnot_si128(outside, _mm_set1_epi32(INT32_ALLBITS));
+}
+
+inline __m128i _mm_set_mask_epi32(int cutoff_index)
+{
+	return _mm_setmask_fromto_epi32(0, cutoff_index);
+}
+
+inline __m128i _mm_set_mask_epi64(int cutoff_index)
+{
+	return _mm_setmask_fromto_epi64(0, cutoff_index);
+}
+
+inline __m128 _mm_set_mask_ps(int cutoff_index)
+{
+	return _mm_castsi128_ps(_mm_set_mask_epi32(cutoff_index));
+}
+
+inline __m128d _mm_set_mask_pd(int cutoff_index)
+{
+	return _mm_castsi128_pd(_mm_set_mask_epi64(cutoff_index));
+}
 
 // AVX2 functions.
-__m256i _mm256_setmask_fromto_epi32(int, int);
-__m256i _mm256_setmask_fromto_epi64(int, int);
-__m256i _mm256_set_mask_epi32(int);
-__m256i _mm256_set_mask_epi64(int);
-__m256 _mm256_set_mask_ps(int);
-__m256d _mm256_set_mask_pd(int);
-
-// AVX512 functions.
+TARGET_AVX2
+inline __m256i _mm256_setmask_fromto_epi32(int from, int to)
+{
+	__m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+	__m256i outside = _mm256_or_si256(_mm256_cmpgt_epi32(_mm256_set1_epi32(from), lanes), _mm256_cmpgt_epi32(lanes, _mm256_set1_epi32(to)));
+
+	return _mm256_andnot_si256(outside, _mm256_set1_epi32(INT32_ALLBITS));
+}
+
+TARGET_AVX2
+inline __m256i _mm256_setmask_fromto_epi64(int from, int to)
+{
+	__m256i lanes = _mm256_setr_epi32(0, 0, 1, 1, 2, 2, 3, 3);
+	__m256i outside = _mm256_or_si256(_mm256_cmpgt_epi32(_mm256_set1_epi32(from), lanes), _mm256_cmpgt_epi32(lanes, _mm256_set1_epi32(to)));
+
+	return _mm256_andnot_si256(outside, _mm256_set1_epi32(INT32_ALLBITS));
+}
+
+TARGET_AVX2
+inline __m256i _mm256_set_mask_epi32(int cutoff_index)
+{
+	return _mm256_setmask_fromto_epi32(0, cutoff_index);
+}
+
+TARGET_AVX2
+inline __m256i _mm256_set_mask_epi64(int cutoff_index)
+{
+	return _mm256_setmask_fromto_epi64(0, cutoff_index);
+}
+
+TARGET_AVX2
+inline __m256 _mm256_set_mask_ps(int cutoff_index)
+{
+	return _mm256_castsi256_ps(_mm256_set_mask_epi32(cutoff_index));
+}
+
+TARGET_AVX2
+inline __m256d _mm256_set_mask_pd(int cutoff_index)
+{
+	return _mm256_castsi256_pd(_mm256_set_mask_epi64(cutoff_index));
+}
+
+// AVX512 functions. The two comparisons write straight into a mask register,
+// the second under the mask of the first.
 #ifdef SUPPORTS_AVX512
-__mmask16 _mm512_setmask_fromto_epi32(int, int);
-__mmask8 _mm512_setmask_fromto_epi64(int, int);
-__mmask16 _mm512_set_mask_epi32(int);
-__mmask8 _mm512_set_mask_epi64(int);
+TARGET_AVX512
+inline __mmask16 _mm512_setmask_fromto_epi32(int from, int to)
+{
+	__m512i lanes = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+	__mmask16 above = _mm512_cmpge_epi32_mask(lanes, _mm512_set1_epi32(from));
+
+	return _mm512_mask_cmple_epi32_mask(above, lanes, _mm512_set1_epi32(to));
+}
+
+TARGET_AVX512
+inline __mmask8 _mm512_setmask_fromto_epi64(int from, int to)
+{
+	__m512i lanes = _mm512_setr_epi64(0, 1, 2, 3, 4, 5, 6, 7);
+	__mmask8 above = _mm512_cmpge_epi64_mask(lanes, _mm512_set1_epi64(from));
+
+	return _mm512_mask_cmple_epi64_mask(above, lanes, _mm512_set1_epi64(to));
+}
+
+TARGET_AVX512
+inline __mmask16 _mm512_set_mask_epi32(int cutoff_index)
+{
+	return _mm512_setmask_fromto_epi32(0, cutoff_index);
+}
+
+TARGET_AVX512
+inline __mmask8 _mm512_set_mask_epi64(int cutoff_index)
+{
+	return _mm512_setmask_fromto_epi64(0, cutoff_index);
+}
 #endif
 
 #ifdef __cplusplus
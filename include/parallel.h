@@ -0,0 +1,30 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+
+//----------------------------------------------------------------------------
+// Multithreaded dot products. The range is split into one slice per thread,
+// each reduced with the kernel bound in dispatch.h, and the per-thread
+// partial sums are combined in a fixed pairwise tree. For a given length,
+// thread count and instruction set the result is therefore bitwise
+// reproducible. Thread counts below one are treated as one.
+//----------------------------------------------------------------------------
+
+float iu_fdot_parallel(const float *, const float *, size_t, int);
+float iu_fdot_indexed_parallel(const float *, const int *, const float *, size_t, int);
+float iu_fdot_indexed2_parallel(const float *, const int *, const float *, const int *, size_t, int);
+
+double iu_ddot_parallel(const double *, const double *, size_t, int);
+double iu_ddot_indexed_parallel(const double *, const int *, const double *, size_t, int);
+double iu_ddot_indexed2_parallel(const double *, const int *, const double *, const int *, size_t, int);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,91 @@
+#ifndef SAT_H
+#define SAT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//----------------------------------------------------------------------------
+// Summed-area tables (integral images) of nrows by ncols grids stored in
+// ROW_MAJOR_ORDER or COLUMN_MAJOR_ORDER (constants.h). The grid is seen as
+// nlines lines of len contiguous elements: rows of ncols for row-major
+// grids, columns of nrows for column-major ones. The table holds nlines + 1
+// lines of len + 1 sums, ld = len + 1 apart, where entry (l, t) is the sum
+// of the grid over lines below l and positions below t. Any rectangle then
+// sums from four entries.
+//
+// Sums are periodic: rectangles may start anywhere and be larger than the
+// grid, and wrap around it as often as they need to. Every table sum is
+// extended past the grid as S(l + q nlines, t) = S(l, t) + q S(nlines, t),
+// and likewise along lines.
+//
+// Float tables accumulate the whole grid in float, so box sums lose about
+// as many digits as the grid total has over a single box. Use the double
+// tables for large grids or sums of widely varying magnitude.
+//----------------------------------------------------------------------------
+
+struct iu_ssat {
+	int nrows;
+	int ncols;
+	char order;
+
+	int nlines;
+	int len;
+	int ld;
+	float *table;
+};
+
+struct iu_dsat {
+	int nrows;
+	int ncols;
+	char order;
+
+	int nlines;
+	int len;
+	int ld;
+	double *table;
+};
+
+//----------------------------------------------------------------------------
+// Functions for creating tables. create allocates the table for a grid of
+// the given shape and order, and build fills it from a grid whose lines are
+// ldx elements apart. A table may be rebuilt any number of times. NULL is
+// returned if memory cannot be allocated, a dimension is not positive or
+// the order is unknown.
+//----------------------------------------------------------------------------
+
+struct iu_ssat *iu_ssat_create(int, int, char);
+struct iu_dsat *iu_dsat_create(int, int, char);
+
+void iu_ssat_build(struct iu_ssat *, const float *, int);
+void iu_dsat_build(struct iu_dsat *, const double *, int);
+
+void iu_ssat_free(struct iu_ssat *);
+void iu_dsat_free(struct iu_dsat *);
+
+//----------------------------------------------------------------------------
+// Queries. rect(sat, row, col, height, width) sums the rows [row, row +
+// height) and columns [col, col + width), wrapped. box(sat, dst, lddst,
+// top, left, height, width) fills a grid of the table's shape and order,
+// lines lddst apart, with the rect at (i + top, j + left) for every cell
+// (i, j); whole registers of cells in a line read their four corners
+// together and only cells whose rectangle wraps along the line fall back to
+// scalar code. ring(sat, dst, lddst, inner, outer) is the box of radius
+// outer, (2 outer + 1) cells square, minus the box of radius inner; an inner
+// radius below zero removes nothing.
+//----------------------------------------------------------------------------
+
+float iu_ssat_rect(const struct iu_ssat *, int, int, int, int);
+double iu_dsat_rect(const struct iu_dsat *, int, int, int, int);
+
+void iu_ssat_box(const struct iu_ssat *, float *, int, int, int, int, int);
+void iu_dsat_box(const struct iu_dsat *, double *, int, int, int, int, int);
+
+void iu_ssat_ring(const struct iu_ssat *, float *, int, int, int);
+void iu_dsat_ring(const struct iu_dsat *, double *, int, int, int);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
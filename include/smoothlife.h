@@ -0,0 +1,103 @@
+#ifndef SMOOTHLIFE_H
+#define SMOOTHLIFE_H
+
+#include "intrinsics_utils.h"
+#include "fft.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//----------------------------------------------------------------------------
+// SmoothLife (Rafler, 2011) on a periodic column-major grid of nrows by
+// ncols cells. Each step integrates the field over an inner disk of radius
+// ri, giving the filling m, and over the annulus between ri and ra, giving
+// n. Both neighbourhoods are anti-aliased over one cell at their edges and
+// normalised by their area. The transition then maps (n, m) to the new
+// state. The birth interval is [b1, b2], the death interval is [d1, d2], and
+// alpha_n and alpha_m are the widths of the sigmoid steps in n and m. A dt
+// of zero gives discrete steps; otherwise f += dt (2 s(n, m) - 1), clamped
+// to [0, 1].
+//----------------------------------------------------------------------------
+
+#define SMOOTHLIFE_RA 21.0f
+#define SMOOTHLIFE_RI (SMOOTHLIFE_RA / 3.0f)
+#define SMOOTHLIFE_B1 0.278f
+#define SMOOTHLIFE_B2 0.365f
+#define SMOOTHLIFE_D1 0.267f
+#define SMOOTHLIFE_D2 0.445f
+#define SMOOTHLIFE_ALPHA_N 0.028f
+#define SMOOTHLIFE_ALPHA_M 0.147f
+
+// Ways of computing the integrals: direct summation of the weights over the
+// padded grid, periodic convolution by FFT (see fft.h), or whichever
+// iu_conv2d_prefer_fft estimates to be faster for the radii and grid.
+#define SMOOTHLIFE_DIRECT 0
+#define SMOOTHLIFE_FFT 1
+#define SMOOTHLIFE_AUTO 2
+
+// struct iu_smoothlife_params holds the parameters above and is defined in
+// intrinsics_utils.h next to the transition kernels.
+
+// The field is stored padded by pad cells on every side, with the padding
+// refreshed from the opposite edges before each step. The weights fold in
+// the normalisation, and their offsets are relative to a cell of the padded
+// grid. m and n hold the integrals of the last step. conv holds the spectra
+// of both neighbourhoods while the FFT method is in use and is NULL
+// otherwise.
+struct iu_smoothlife {
+	int nrows;
+	int ncols;
+	struct iu_smoothlife_params params;
+
+	float *field;
+	float *m;
+	float *n;
+
+	int pad;
+	int ldp;
+	float *padded;
+
+	int nm;
+	int *m_offsets;
+	float *m_weights;
+
+	int nn;
+	int *n_offsets;
+	float *n_weights;
+
+	int method;
+	struct iu_conv2d *conv;
+};
+
+//----------------------------------------------------------------------------
+// Functions for creating engines. A NULL params selects the defaults above
+// with discrete steps. The field starts empty and may be written directly.
+// NULL is returned if memory cannot be allocated or the radii do not satisfy
+// 0 < ri < ra. Engines start with SMOOTHLIFE_AUTO; iu_smoothlife_set_method
+// switches to another method and returns 0, or -1 for an unknown method or
+// if the kernel spectra cannot be allocated, in which case the engine keeps
+// its previous method.
+//----------------------------------------------------------------------------
+
+void iu_smoothlife_default_params(struct iu_smoothlife_params *);
+
+struct iu_smoothlife *iu_smoothlife_create(int, int, const struct iu_smoothlife_params *);
+
+void iu_smoothlife_free(struct iu_smoothlife *);
+
+int iu_smoothlife_set_method(struct iu_smoothlife *, int);
+
+//----------------------------------------------------------------------------
+// Functions for advancing engines. iu_smoothlife_integrals only fills m and
+// n from the current field; iu_smoothlife_step also applies the transition.
+//----------------------------------------------------------------------------
+
+void iu_smoothlife_integrals(struct iu_smoothlife *);
+void iu_smoothlife_step(struct iu_smoothlife *);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
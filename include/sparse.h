@@ -0,0 +1,72 @@
+#ifndef SPARSE_H
+#define SPARSE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//----------------------------------------------------------------------------
+// Sparse matrices in SELL-C-sigma format. Rows are sorted by decreasing
+// length within windows of sigma rows, then grouped in chunks of C rows
+// (SELL_CHUNK_PS or SELL_CHUNK_PD from constants.h). Each chunk is padded to
+// its longest row and stored column-major, so column j of chunk k occupies
+// colind[chunkptr[k] + j * C] to colind[chunkptr[k] + j * C + C - 1]. Padding
+// entries have column -1 and value 0. The kernels mask them out of the
+// gathers, so a NaN or infinity in x cannot reach a row through its
+// padding. perm[i] is the original row of sorted row i. A sigma of one or
+// less keeps the original row order.
+//----------------------------------------------------------------------------
+
+struct iu_ssell {
+	int nrows;
+	int ncols;
+	int sigma;
+	int nchunks;
+
+	int *chunkptr;
+	int *perm;
+	int *colind;
+	float *values;
+};
+
+struct iu_dsell {
+	int nrows;
+	int ncols;
+	int sigma;
+	int nchunks;
+
+	int *chunkptr;
+	int *perm;
+	int *colind;
+	double *values;
+};
+
+//----------------------------------------------------------------------------
+// Functions for converting from CSR. The returned matrix owns copies of the
+// data and is released with the matching free function. NULL is returned if
+// memory cannot be allocated.
+//----------------------------------------------------------------------------
+
+struct iu_ssell *iu_ssell_from_csr(int, int, const int *, const int *, const float *, int);
+struct iu_dsell *iu_dsell_from_csr(int, int, const int *, const int *, const double *, int);
+
+void iu_ssell_free(struct iu_ssell *);
+void iu_dsell_free(struct iu_dsell *);
+
+//----------------------------------------------------------------------------
+// Sparse matrix-vector products y = A x. The CSR products take the row
+// count, row pointers, column indices and values, and reduce blocks of rows
+// together rather than one dot product per row.
+//----------------------------------------------------------------------------
+
+void iu_sspmv_csr(int, const int *, const int *, const float *, const float *, float *);
+void iu_dspmv_csr(int, const int *, const int *, const double *, const double *, double *);
+
+void iu_sspmv_sell(const struct iu_ssell *, const float *, float *);
+void iu_dspmv_sell(const struct iu_dsell *, const double *, double *);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,958 @@
+#include "dispatch.h"
+#include "intrinsics_utils.h"
+#include "cpu_flags.h"
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+//----------------------------------------------------------------------------
+// Table of kernels the width-neutral entry points forward to.
+//----------------------------------------------------------------------------
+
+struct dispatch_table {
+	int isa;
+
+	void (*sset_value)(float *, int, float);
+	void (*dset_value)(double *, int, double);
+
+	float (*fdot)(const float *, const float *, int);
+	float (*fdot_indexed)(const float *, const int *, const float *, int);
+	float (*fdot_indexed2)(const float *, const int *, const float *, const int *, int);
+
+	double (*ddot)(const double *, const double *, int);
+	double (*ddot_indexed)(const double *, const int *, const double *, int);
+	double (*ddot_indexed2)(const double *, const int *, const double *, const int *, int);
+
+	int64_t (*dot_epi32)(const int *, const int *, int);
+	int64_t (*dot_indexed_epi32)(const int *, const int *, const int *, int);
+	int64_t (*dot_epi16)(const int16_t *, const int16_t *, int);
+	int64_t (*dot_indexed_epi16)(const int16_t *, const int *, const int16_t *, int);
+	int64_t (*dot_u8i8)(const uint8_t *, const int8_t *, int);
+	int64_t (*dot_indexed_u8i8)(const uint8_t *, const int *, const int8_t *, int);
+
+	void (*cvt_f16_to_f32)(float *, const uint16_t *, int);
+	void (*cvt_f32_to_f16)(uint16_t *, const float *, int);
+	float (*hdot)(const uint16_t *, const uint16_t *, int);
+	float (*hdot_indexed)(const uint16_t *, const int *, const uint16_t *, int);
+
+	void (*stencil_ps)(float *, const float *, int, const int *, const float *, int);
+	void (*smoothlife_transition_ps)(float *, const float *, const float *, int, const struct iu_smoothlife_params *);
+	void (*fft_stage_ps)(float *, const float *, int, int, int, const float *, const float *);
+	void (*cmul_ps)(float *, const float *, const float *, int);
+	void (*sat_build_ps)(float *, int, const float *, int, int, int);
+	void (*sat_build_pd)(double *, int, const double *, int, int, int);
+	void (*sat_box_ps)(float *, const float *, const float *, const float *, float, int, int, int);
+	void (*sat_box_pd)(double *, const double *, const double *, const double *, double, int, int, int);
+	void (*transpose_ps)(char, int, int, const float *, int, float *, int);
+	void (*transpose_pd)(char, int, int, const double *, int, double *, int);
+	void (*transpose_epi32)(char, int, int, const int *, int, int *, int);
+	void (*transpose_inplace_ps)(int, float *, int);
+	void (*transpose_inplace_pd)(int, double *, int);
+	void (*transpose_inplace_epi32)(int, int *, int);
+	float (*sum2d_indexed_ps)(const float *, int, const int *, const int *, int, int);
+	float (*dot2d_indexed_ps)(const float *, int, const int *, const int *, int, int, const float *);
+	double (*sum2d_indexed_pd)(const double *, int, const int *, const int *, int, int);
+	double (*dot2d_indexed_pd)(const double *, int, const int *, const int *, int, int, const double *);
+
+	void (*sgemv)(char, int, int, const float *, int, const float *, float *);
+	void (*dgemv)(char, int, int, const double *, int, const double *, double *);
+
+	void (*scsrmv)(int, const int *, const int *, const float *, const float *, float *);
+	void (*dcsrmv)(int, const int *, const int *, const double *, const double *, double *);
+	void (*ssellmv)(int, const int *, const int *, const int *, const float *, const float *, float *);
+	void (*dsellmv)(int, const int *, const int *, const int *, const double *, const double *, double *);
+
+	float (*fdot_spans)(const float *, const float *, const int *, int, const int *, const int *, int);
+	double (*ddot_spans)(const double *, const double *, const int *, int, const int *, const int *, int);
+	float (*fsum_spans)(const float *, const int *, int, const int *, int);
+	double (*dsum_spans)(const double *, const int *, int, const int *, int);
+	void (*copy_spans_ps)(float *, const float *, const int *, int, const int *, const int *, int);
+
+	float (*smin)(const float *, int);
+	float (*smax)(const float *, int);
+	int (*sargmin)(const float *, int);
+	int (*sargmax)(const float *, int);
+	double (*dmin)(const double *, int);
+	double (*dmax)(const double *, int);
+	int (*dargmin)(const double *, int);
+	int (*dargmax)(const double *, int);
+
+	void (*sset_value_padded)(float *, int, float);
+	void (*dset_value_padded)(double *, int, double);
+	float (*fdot_padded)(const float *, const float *, int);
+	double (*ddot_padded)(const double *, const double *, int);
+	float (*fdot_indexed_padded)(const float *, const int *, const float *, int);
+	double (*ddot_indexed_padded)(const double *, const int *, const double *, int);
+	void (*copy1d_ps_padded)(float *, const float *, int);
+	void (*copy1d_epi32_padded)(int *, const int *, int);
+
+	void (*copy1d_epi32)(int *, const int *, int);
+	void (*copy2d_epi32)(int *, int, const int *, const int *, int, int);
+	void (*copy2d_epi32_ld)(char, int *, int, int, const int *, const int *, int, int);
+
+	void (*copy1d_ps)(float *, const float *, int);
+	void (*copy2d_indexed_ps)(float *, const float *, int, const int *, const int *, int, int);
+	void (*copy2d_indexed_ps_ld)(char, float *, int, const float *, int, const int *, const int *, int, int);
+};
+
+static struct dispatch_table table;
+
+// Gather path bound alongside the instruction set.
+static int gather_mode = IU_GATHER_HARDWARE;
+
+//----------------------------------------------------------------------------
+// Functions for binding the table.
+//----------------------------------------------------------------------------
+
+static void bind_sse(void)
+{
+	table.isa = IU_ISA_SSE;
+
+	table.sset_value = _mm_sset_value;
+	table.dset_value = _mm_dset_value;
+
+	table.fdot = _mm_fdot;
+	table.fdot_indexed = _mm_fdot_indexed;
+	table.fdot_indexed2 = _mm_fdot_indexed2;
+
+	table.ddot = _mm_ddot;
+	table.ddot_indexed = _mm_ddot_indexed;
+	table.ddot_indexed2 = _mm_ddot_indexed2;
+
+	table.dot_epi32 = _mm_dot_epi32;
+	table.dot_indexed_epi32 = _mm_dot_indexed_epi32;
+	table.dot_epi16 = _mm_dot_epi16;
+	table.dot_indexed_epi16 = _mm_dot_indexed_epi16;
+	table.dot_u8i8 = _mm_dot_u8i8;
+	table.dot_indexed_u8i8 = _mm_dot_indexed_u8i8;
+
+	table.cvt_f16_to_f32 = _mm_cvt_f16_to_f32;
+	table.cvt_f32_to_f16 = _mm_cvt_f32_to_f16;
+	table.hdot = _mm_hdot;
+	table.hdot_indexed = _mm_hdot_indexed;
+
+	table.stencil_ps = _mm_stencil_ps;
+	table.smoothlife_transition_ps = _mm_smoothlife_transition_ps;
+	table.fft_stage_ps = _mm_fft_stage_ps;
+	table.cmul_ps = _mm_cmul_ps;
+	table.sat_build_ps = _mm_sat_build_ps;
+	table.sat_build_pd = _mm_sat_build_pd;
+	table.sat_box_ps = _mm_sat_box_ps;
+	table.sat_box_pd = _mm_sat_box_pd;
+	table.transpose_ps = _mm_transpose_ps;
+	table.transpose_pd = _mm_transpose_pd;
+	table.transpose_epi32 = _mm_transpose_epi32;
+	table.transpose_inplace_ps = _mm_transpose_inplace_ps;
+	table.transpose_inplace_pd = _mm_transpose_inplace_pd;
+	table.transpose_inplace_epi32 = _mm_transpose_inplace_epi32;
+	table.sum2d_indexed_ps = _mm_sum2d_indexed_ps;
+	table.dot2d_indexed_ps = _mm_dot2d_indexed_ps;
+	table.sum2d_indexed_pd = _mm_sum2d_indexed_pd;
+	table.dot2d_indexed_pd = _mm_dot2d_indexed_pd;
+
+	table.sgemv = _mm_sgemv;
+	table.dgemv = _mm_dgemv;
+
+	table.scsrmv = _mm_scsrmv;
+	table.dcsrmv = _mm_dcsrmv;
+	table.ssellmv = _mm_ssellmv;
+	table.dsellmv = _mm_dsellmv;
+
+	table.fdot_spans = _mm_fdot_spans;
+	table.ddot_spans = _mm_ddot_spans;
+	table.fsum_spans = _mm_fsum_spans;
+	table.dsum_spans = _mm_dsum_spans;
+	table.copy_spans_ps = _mm_copy_spans_ps;
+
+	table.smin = _mm_smin;
+	table.smax = _mm_smax;
+	table.sargmin = _mm_sargmin;
+	table.sargmax = _mm_sargmax;
+	table.dmin = _mm_dmin;
+	table.dmax = _mm_dmax;
+	table.dargmin = _mm_dargmin;
+	table.dargmax = _mm_dargmax;
+
+	table.sset_value_padded = _mm_sset_value_padded;
+	table.dset_value_padded = _mm_dset_value_padded;
+	table.fdot_padded = _mm_fdot_padded;
+	table.ddot_padded = _mm_ddot_padded;
+	table.fdot_indexed_padded = _mm_fdot_indexed_padded;
+	table.ddot_indexed_padded = _mm_ddot_indexed_padded;
+	table.copy1d_ps_padded = _mm_copy1d_ps_padded;
+	table.copy1d_epi32_padded = _mm_copy1d_epi32_padded;
+
+	table.copy1d_epi32 = _mm_copy1d_epi32;
+	table.copy2d_epi32 = _mm_copy2d_epi32;
+	table.copy2d_epi32_ld = _mm_copy2d_epi32_ld;
+
+	table.copy1d_ps = _mm_copy1d_ps;
+	table.copy2d_indexed_ps = _mm_copy2d_indexed_ps;
+	table.copy2d_indexed_ps_ld = _mm_copy2d_indexed_ps_ld;
+}
+
+static void bind_avx2(void)
+{
+	table.isa = IU_ISA_AVX2;
+
+	table.sset_value = _mm256_sset_value;
+	table.dset_value = _mm256_dset_value;
+
+	table.fdot = _mm256_fdot;
+	table.fdot_indexed = _mm256_fdot_indexed;
+	table.fdot_indexed2 = _mm256_fdot_indexed2;
+
+	table.ddot = _mm256_ddot;
+	table.ddot_indexed = _mm256_ddot_indexed;
+	table.ddot_indexed2 = _mm256_ddot_indexed2;
+
+	table.dot_epi32 = _mm256_dot_epi32;
+	table.dot_indexed_epi32 = _mm256_dot_indexed_epi32;
+	table.dot_epi16 = _mm256_dot_epi16;
+	table.dot_indexed_epi16 = _mm256_dot_indexed_epi16;
+	table.dot_u8i8 = _mm256_dot_u8i8;
+	table.dot_indexed_u8i8 = _mm256_dot_indexed_u8i8;
+
+	table.cvt_f16_to_f32 = _mm256_cvt_f16_to_f32;
+	table.cvt_f32_to_f16 = _mm256_cvt_f32_to_f16;
+	table.hdot = _mm256_hdot;
+	table.hdot_indexed = _mm256_hdot_indexed;
+
+	table.stencil_ps = _mm256_stencil_ps;
+	table.smoothlife_transition_ps = _mm256_smoothlife_transition_ps;
+	table.fft_stage_ps = _mm256_fft_stage_ps;
+	table.cmul_ps = _mm256_cmul_ps;
+	table.sat_build_ps = _mm256_sat_build_ps;
+	table.sat_build_pd = _mm256_sat_build_pd;
+	table.sat_box_ps = _mm256_sat_box_ps;
+	table.sat_box_pd = _mm256_sat_box_pd;
+	table.transpose_ps = _mm256_transpose_ps;
+	table.transpose_pd = _mm256_transpose_pd;
+	table.transpose_epi32 = _mm256_transpose_epi32;
+	table.transpose_inplace_ps = _mm256_transpose_inplace_ps;
+	table.transpose_inplace_pd = _mm256_transpose_inplace_pd;
+	table.transpose_inplace_epi32 = _mm256_transpose_inplace_epi32;
+	table.sum2d_indexed_ps = _mm256_sum2d_indexed_ps;
+	table.dot2d_indexed_ps = _mm256_dot2d_indexed_ps;
+	table.sum2d_indexed_pd = _mm256_sum2d_indexed_pd;
+	table.dot2d_indexed_pd = _mm256_dot2d_indexed_pd;
+
+#ifdef SUPPORTS_AVXVNNI
+	if (SUPPORTS_AVXVNNI) {
+		table.dot_u8i8 = _mm256_dot_u8i8_vnni;
+	}
+#endif
+
+	table.sgemv = _mm256_sgemv;
+	table.dgemv = _mm256_dgemv;
+
+	table.scsrmv = _mm256_scsrmv;
+	table.dcsrmv = _mm256_dcsrmv;
+	table.ssellmv = _mm256_ssellmv;
+	table.dsellmv = _mm256_dsellmv;
+
+	table.fdot_spans = _mm256_fdot_spans;
+	table.ddot_spans = _mm256_ddot_spans;
+	table.fsum_spans = _mm256_fsum_spans;
+	table.dsum_spans = _mm256_dsum_spans;
+	table.copy_spans_ps = _mm256_copy_spans_ps;
+
+	table.smin = _mm256_smin;
+	table.smax = _mm256_smax;
+	table.sargmin = _mm256_sargmin;
+	table.sargmax = _mm256_sargmax;
+	table.dmin = _mm256_dmin;
+	table.dmax = _mm256_dmax;
+	table.dargmin = _mm256_dargmin;
+	table.dargmax = _mm256_dargmax;
+
+	table.sset_value_padded = _mm256_sset_value_padded;
+	table.dset_value_padded = _mm256_dset_value_padded;
+	table.fdot_padded = _mm256_fdot_padded;
+	table.ddot_padded = _mm256_ddot_padded;
+	table.fdot_indexed_padded = _mm256_fdot_indexed_padded;
+	table.ddot_indexed_padded = _mm256_ddot_indexed_padded;
+	table.copy1d_ps_padded = _mm256_copy1d_ps_padded;
+	table.copy1d_epi32_padded = _mm256_copy1d_epi32_padded;
+
+	table.copy1d_epi32 = _mm256_copy1d_epi32;
+	table.copy2d_epi32 = _mm256_copy2d_epi32;
+	table.copy2d_epi32_ld = _mm256_copy2d_epi32_ld;
+
+	table.copy1d_ps = _mm256_copy1d_ps;
+	table.copy2d_indexed_ps = _mm256_copy2d_indexed_ps;
+	table.copy2d_indexed_ps_ld = _mm256_copy2d_indexed_ps_ld;
+
+	if (gather_mode == IU_GATHER_EMULATED) {
+		table.fdot_indexed = _mm256_fdot_indexed_emu;
+		table.fdot_indexed2 = _mm256_fdot_indexed2_emu;
+		table.ddot_indexed = _mm256_ddot_indexed_emu;
+		table.ddot_indexed2 = _mm256_ddot_indexed2_emu;
+		table.scsrmv = _mm256_scsrmv_emu;
+		table.dcsrmv = _mm256_dcsrmv_emu;
+		table.ssellmv = _mm256_ssellmv_emu;
+		table.dsellmv = _mm256_dsellmv_emu;
+		table.copy2d_indexed_ps = _mm256_copy2d_indexed_ps_emu;
+		table.copy2d_indexed_ps_ld = _mm256_copy2d_indexed_ps_ld_emu;
+		table.sum2d_indexed_ps = _mm256_sum2d_indexed_ps_emu;
+		table.dot2d_indexed_ps = _mm256_dot2d_indexed_ps_emu;
+		table.sum2d_indexed_pd = _mm256_sum2d_indexed_pd_emu;
+		table.dot2d_indexed_pd = _mm256_dot2d_indexed_pd_emu;
+		table.fdot_indexed_padded = _mm256_fdot_indexed_padded_emu;
+		table.ddot_indexed_padded = _mm256_ddot_indexed_padded_emu;
+	}
+}
+
+#ifdef SUPPORTS_AVX512
+static void bind_avx512(void)
+{
+	// Start from the AVX2 kernels for anything without an AVX-512 port.
+	bind_avx2();
+
+	table.isa = IU_ISA_AVX512;
+
+	table.sset_value = _mm512_sset_value;
+	table.dset_value = _mm512_dset_value;
+
+	table.fdot = _mm512_fdot;
+	table.fdot_indexed = _mm512_fdot_indexed;
+	table.fdot_indexed2 = _mm512_fdot_indexed2;
+
+	table.ddot = _mm512_ddot;
+	table.ddot_indexed = _mm512_ddot_indexed;
+	table.ddot_indexed2 = _mm512_ddot_indexed2;
+
+	table.dot_epi32 = _mm512_dot_epi32;
+	table.dot_indexed_epi32 = _mm512_dot_indexed_epi32;
+
+#ifdef SUPPORTS_AVX512BW
+	if (SUPPORTS_AVX512BW) {
+		table.dot_epi16 = _mm512_dot_epi16;
+		table.dot_indexed_epi16 = _mm512_dot_indexed_epi16;
+		table.dot_u8i8 = _mm512_dot_u8i8;
+		table.dot_indexed_u8i8 = _mm512_dot_indexed_u8i8;
+	}
+#endif
+
+#ifdef SUPPORTS_AVX512VNNI
+	if (SUPPORTS_AVX512VNNI) {
+		table.dot_u8i8 = _mm512_dot_u8i8_vnni;
+	}
+#endif
+
+	table.cvt_f16_to_f32 = _mm512_cvt_f16_to_f32;
+	table.cvt_f32_to_f16 = _mm512_cvt_f32_to_f16;
+	table.hdot = _mm512_hdot;
+	table.hdot_indexed = _mm512_hdot_indexed;
+
+	table.stencil_ps = _mm512_stencil_ps;
+	table.smoothlife_transition_ps = _mm512_smoothlife_transition_ps;
+	table.fft_stage_ps = _mm512_fft_stage_ps;
+	table.cmul_ps = _mm512_cmul_ps;
+	table.sat_build_ps = _mm512_sat_build_ps;
+	table.sat_build_pd = _mm512_sat_build_pd;
+	table.sat_box_ps = _mm512_sat_box_ps;
+	table.sat_box_pd = _mm512_sat_box_pd;
+	table.transpose_ps = _mm512_transpose_ps;
+	table.transpose_pd = _mm512_transpose_pd;
+	table.transpose_epi32 = _mm512_transpose_epi32;
+	table.transpose_inplace_ps = _mm512_transpose_inplace_ps;
+	table.transpose_inplace_pd = _mm512_transpose_inplace_pd;
+	table.transpose_inplace_epi32 = _mm512_transpose_inplace_epi32;
+	table.sum2d_indexed_ps = _mm512_sum2d_indexed_ps;
+	table.dot2d_indexed_ps = _mm512_dot2d_indexed_ps;
+	table.sum2d_indexed_pd = _mm512_sum2d_indexed_pd;
+	table.dot2d_indexed_pd = _mm512_dot2d_indexed_pd;
+
+	table.sgemv = _mm512_sgemv;
+	table.dgemv = _mm512_dgemv;
+
+	table.scsrmv = _mm512_scsrmv;
+	table.dcsrmv = _mm512_dcsrmv;
+	table.ssellmv = _mm512_ssellmv;
+	table.dsellmv = _mm512_dsellmv;
+
+	table.fdot_spans = _mm512_fdot_spans;
+	table.ddot_spans = _mm512_ddot_spans;
+	table.fsum_spans = _mm512_fsum_spans;
+	table.dsum_spans = _mm512_dsum_spans;
+	table.copy_spans_ps = _mm512_copy_spans_ps;
+
+	table.smin = _mm512_smin;
+	table.smax = _mm512_smax;
+	table.sargmin = _mm512_sargmin;
+	table.sargmax = _mm512_sargmax;
+	table.dmin = _mm512_dmin;
+	table.dmax = _mm512_dmax;
+	table.dargmin = _mm512_dargmin;
+	table.dargmax = _mm512_dargmax;
+
+	table.sset_value_padded = _mm512_sset_value_padded;
+	table.dset_value_padded = _mm512_dset_value_padded;
+	table.fdot_padded = _mm512_fdot_padded;
+	table.ddot_padded = _mm512_ddot_padded;
+	table.fdot_indexed_padded = _mm512_fdot_indexed_padded;
+	table.ddot_indexed_padded = _mm512_ddot_indexed_padded;
+	table.copy1d_ps_padded = _mm512_copy1d_ps_padded;
+	table.copy1d_epi32_padded = _mm512_copy1d_epi32_padded;
+
+	table.copy1d_epi32 = _mm512_copy1d_epi32;
+	table.copy2d_epi32 = _mm512_copy2d_epi32;
+	table.copy2d_epi32_ld = _mm512_copy2d_epi32_ld;
+
+	table.copy1d_ps = _mm512_copy1d_ps;
+	table.copy2d_indexed_ps = _mm512_copy2d_indexed_ps;
+	table.copy2d_indexed_ps_ld = _mm512_copy2d_indexed_ps_ld;
+
+	if (gather_mode == IU_GATHER_EMULATED) {
+		table.fdot_indexed = _mm512_fdot_indexed_emu;
+		table.fdot_indexed2 = _mm512_fdot_indexed2_emu;
+		table.ddot_indexed = _mm512_ddot_indexed_emu;
+		table.ddot_indexed2 = _mm512_ddot_indexed2_emu;
+		table.scsrmv = _mm512_scsrmv_emu;
+		table.dcsrmv = _mm512_dcsrmv_emu;
+		table.ssellmv = _mm512_ssellmv_emu;
+		table.dsellmv = _mm512_dsellmv_emu;
+		table.copy2d_indexed_ps = _mm512_copy2d_indexed_ps_emu;
+		table.copy2d_indexed_ps_ld = _mm512_copy2d_indexed_ps_ld_emu;
+		table.sum2d_indexed_ps = _mm512_sum2d_indexed_ps_emu;
+		table.dot2d_indexed_ps = _mm512_dot2d_indexed_ps_emu;
+		table.sum2d_indexed_pd = _mm512_sum2d_indexed_pd_emu;
+		table.dot2d_indexed_pd = _mm512_dot2d_indexed_pd_emu;
+		table.fdot_indexed_padded = _mm512_fdot_indexed_padded_emu;
+		table.ddot_indexed_padded = _mm512_ddot_indexed_padded_emu;
+	}
+}
+#endif
+
+static int host_supports(int isa)
+{
+	__builtin_cpu_init();
+
+	switch (isa) {
+		case IU_ISA_SSE:
+			return 1;
+#ifdef SUPPORTS_AVX2
+		case IU_ISA_AVX2:
+			return SUPPORTS_AVX2;
+#endif
+#ifdef SUPPORTS_AVX512
+		case IU_ISA_AVX512:
+			return SUPPORTS_AVX512;
+#endif
+		default:
+			return 0;
+	}
+}
+
+int iu_dispatch_set_isa(int isa)
+{
+	if (!host_supports(isa)) {
+		return -1;
+	}
+
+	switch (isa) {
+#ifdef SUPPORTS_AVX512
+		case IU_ISA_AVX512:
+			bind_avx512();
+			break;
+#endif
+		case IU_ISA_AVX2:
+			bind_avx2();
+			break;
+		default:
+			bind_sse();
+	}
+
+	return 0;
+}
+
+int iu_dispatch_set_gather(int mode)
+{
+	if (mode != IU_GATHER_HARDWARE && mode != IU_GATHER_EMULATED) {
+		return -1;
+	}
+
+	gather_mode = mode;
+
+	return iu_dispatch_set_isa(table.isa);
+}
+
+//----------------------------------------------------------------------------
+// Choosing the gather path at load time.
+//----------------------------------------------------------------------------
+
+// Length of the microbenchmark. The data fits in L1, so the timings measure
+// the gathers themselves rather than the memory behind them.
+#define GATHER_PROBE_LEN 2048
+#define GATHER_PROBE_REPS 8
+
+static double seconds(void)
+{
+	struct timespec t;
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+
+	return t.tv_sec + 1e-9 * t.tv_nsec;
+}
+
+// Best time of the bound fdot_indexed over the probe data.
+static double time_fdot_indexed(const float *x, const int *indices, const float *y)
+{
+	volatile float sink;
+	double best = 1e300;
+	double start, elapsed;
+	int rep;
+
+	for (rep = 0; rep < GATHER_PROBE_REPS; rep++) {
+		start = seconds();
+		sink = table.fdot_indexed(x, indices, y, GATHER_PROBE_LEN);
+		elapsed = seconds() - start;
+		best = elapsed < best ? elapsed : best;
+	}
+
+	(void)sink;
+
+	return best;
+}
+
+// Time both paths on the bound instruction set and keep the faster. The
+// indices come from a fixed linear congruential generator so the probe does
+// not disturb the caller's rand() sequence.
+static int measure_gather_mode(void)
+{
+	static float x[GATHER_PROBE_LEN], y[GATHER_PROBE_LEN];
+	static int indices[GATHER_PROBE_LEN];
+	unsigned state = 12345;
+	double hardware, emulated;
+	int i;
+
+	if (table.isa == IU_ISA_SSE) {
+		return IU_GATHER_HARDWARE;
+	}
+
+	for (i = 0; i < GATHER_PROBE_LEN; i++) {
+		state = state * 1103515245u + 12345u;
+		indices[i] = (state >> 8) % GATHER_PROBE_LEN;
+		x[i] = 1.0f;
+		y[i] = 1.0f;
+	}
+
+	iu_dispatch_set_gather(IU_GATHER_HARDWARE);
+	hardware = time_fdot_indexed(x, indices, y);
+
+	iu_dispatch_set_gather(IU_GATHER_EMULATED);
+	emulated = time_fdot_indexed(x, indices, y);
+
+	return emulated < hardware ? IU_GATHER_EMULATED : IU_GATHER_HARDWARE;
+}
+
+// IU_GATHER=hardware or IU_GATHER=emulated skips the microbenchmark.
+static int env_gather_mode(void)
+{
+	const char *env = getenv("IU_GATHER");
+
+	if (env == NULL) {
+		return -1;
+	} else if (strcmp(env, "hardware") == 0) {
+		return IU_GATHER_HARDWARE;
+	} else if (strcmp(env, "emulated") == 0) {
+		return IU_GATHER_EMULATED;
+	}
+
+	return -1;
+}
+
+__attribute__((constructor))
+static void dispatch_init(void)
+{
+	int mode;
+
+	if (iu_dispatch_set_isa(IU_ISA_AVX512) != 0 && iu_dispatch_set_isa(IU_ISA_AVX2) != 0) {
+		iu_dispatch_set_isa(IU_ISA_SSE);
+	}
+
+	mode = env_gather_mode();
+
+	if (mode < 0) {
+		mode = measure_gather_mode();
+	}
+
+	iu_dispatch_set_gather(mode);
+}
+
+int iu_dispatch_isa(void)
+{
+	return table.isa;
+}
+
+int iu_dispatch_gather(void)
+{
+	return gather_mode;
+}
+
+const char *iu_dispatch_gather_name(void)
+{
+	return gather_mode == IU_GATHER_EMULATED ? "emulated" : "hardware";
+}
+
+const char *iu_dispatch_isa_name(void)
+{
+	switch (table.isa) {
+		case IU_ISA_AVX512:
+			return "avx512";
+		case IU_ISA_AVX2:
+			return "avx2";
+		default:
+			return "sse";
+	}
+}
+
+//----------------------------------------------------------------------------
+// Width-neutral entry points.
+//----------------------------------------------------------------------------
+
+void iu_sset_value(float *x, int n, float value)
+{
+	table.sset_value(x, n, value);
+}
+
+void iu_dset_value(double *x, int n, double value)
+{
+	table.dset_value(x, n, value);
+}
+
+float iu_fdot(const float *x, const float *y, int n)
+{
+	return table.fdot(x, y, n);
+}
+
+float iu_fdot_indexed(const float *x, const int *xindices, const float *y, int n)
+{
+	return table.fdot_indexed(x, xindices, y, n);
+}
+
+float iu_fdot_indexed2(const float *x, const int *xindices, const float *y, const int *yindices, int n)
+{
+	return table.fdot_indexed2(x, xindices, y, yindices, n);
+}
+
+double iu_ddot(const double *x, const double *y, int n)
+{
+	return table.ddot(x, y, n);
+}
+
+double iu_ddot_indexed(const double *x, const int *xindices, const double *y, int n)
+{
+	return table.ddot_indexed(x, xindices, y, n);
+}
+
+double iu_ddot_indexed2(const double *x, const int *xindices, const double *y, const int *yindices, int n)
+{
+	return table.ddot_indexed2(x, xindices, y, yindices, n);
+}
+
+int64_t iu_dot_epi32(const int *x, const int *y, int n)
+{
+	return table.dot_epi32(x, y, n);
+}
+
+int64_t iu_dot_indexed_epi32(const int *x, const int *xindices, const int *y, int n)
+{
+	return table.dot_indexed_epi32(x, xindices, y, n);
+}
+
+int64_t iu_dot_epi16(const int16_t *x, const int16_t *y, int n)
+{
+	return table.dot_epi16(x, y, n);
+}
+
+int64_t iu_dot_indexed_epi16(const int16_t *x, const int *xindices, const int16_t *y, int n)
+{
+	return table.dot_indexed_epi16(x, xindices, y, n);
+}
+
+int64_t iu_dot_u8i8(const uint8_t *x, const int8_t *y, int n)
+{
+	return table.dot_u8i8(x, y, n);
+}
+
+int64_t iu_dot_indexed_u8i8(const uint8_t *x, const int *xindices, const int8_t *y, int n)
+{
+	return table.dot_indexed_u8i8(x, xindices, y, n);
+}
+
+void iu_cvt_f16_to_f32(float *y, const uint16_t *x, int n)
+{
+	table.cvt_f16_to_f32(y, x, n);
+}
+
+void iu_cvt_f32_to_f16(uint16_t *y, const float *x, int n)
+{
+	table.cvt_f32_to_f16(y, x, n);
+}
+
+float iu_hdot(const uint16_t *x, const uint16_t *y, int n)
+{
+	return table.hdot(x, y, n);
+}
+
+float iu_hdot_indexed(const uint16_t *x, const int *xindices, const uint16_t *y, int n)
+{
+	return table.hdot_indexed(x, xindices, y, n);
+}
+
+void iu_stencil_ps(float *dst, const float *src, int n, const int *offsets, const float *weights, int nweights)
+{
+	table.stencil_ps(dst, src, n, offsets, weights, nweights);
+}
+
+void iu_smoothlife_transition_ps(float *f, const float *m, const float *n, int len, const struct iu_smoothlife_params *params)
+{
+	table.smoothlife_transition_ps(f, m, n, len, params);
+}
+
+void iu_fft_stage_ps(float *y, const float *x, int run, int m, int p, const float *twiddles, const float *roots)
+{
+	table.fft_stage_ps(y, x, run, m, p, twiddles, roots);
+}
+
+void iu_cmul_ps(float *dst, const float *x, const float *y, int n)
+{
+	table.cmul_ps(dst, x, y, n);
+}
+
+void iu_sat_build_ps(float *sat, int ld, const float *x, int ldx, int len, int nlines)
+{
+	table.sat_build_ps(sat, ld, x, ldx, len, nlines);
+}
+
+void iu_sat_build_pd(double *sat, int ld, const double *x, int ldx, int len, int nlines)
+{
+	table.sat_build_pd(sat, ld, x, ldx, len, nlines);
+}
+
+void iu_sat_box_ps(float *dst, const float *lo, const float *hi, const float *full, float count, int len, int width, int accumulate)
+{
+	table.sat_box_ps(dst, lo, hi, full, count, len, width, accumulate);
+}
+
+void iu_sat_box_pd(double *dst, const double *lo, const double *hi, const double *full, double count, int len, int width, int accumulate)
+{
+	table.sat_box_pd(dst, lo, hi, full, count, len, width, accumulate);
+}
+
+void iu_transpose_ps(char order, int nrows, int ncols, const float *a, int lda, float *b, int ldb)
+{
+	table.transpose_ps(order, nrows, ncols, a, lda, b, ldb);
+}
+
+void iu_transpose_pd(char order, int nrows, int ncols, const double *a, int lda, double *b, int ldb)
+{
+	table.transpose_pd(order, nrows, ncols, a, lda, b, ldb);
+}
+
+void iu_transpose_epi32(char order, int nrows, int ncols, const int *a, int lda, int *b, int ldb)
+{
+	table.transpose_epi32(order, nrows, ncols, a, lda, b, ldb);
+}
+
+void iu_transpose_inplace_ps(int n, float *a, int lda)
+{
+	table.transpose_inplace_ps(n, a, lda);
+}
+
+void iu_transpose_inplace_pd(int n, double *a, int lda)
+{
+	table.transpose_inplace_pd(n, a, lda);
+}
+
+void iu_transpose_inplace_epi32(int n, int *a, int lda)
+{
+	table.transpose_inplace_epi32(n, a, lda);
+}
+
+float iu_sum2d_indexed_ps(const float *src, int nrows, const int *iind, const int *jind, int numi, int numj)
+{
+	return table.sum2d_indexed_ps(src, nrows, iind, jind, numi, numj);
+}
+
+float iu_dot2d_indexed_ps(const float *src, int nrows, const int *iind, const int *jind, int numi, int numj, const float *w)
+{
+	return table.dot2d_indexed_ps(src, nrows, iind, jind, numi, numj, w);
+}
+
+double iu_sum2d_indexed_pd(const double *src, int nrows, const int *iind, const int *jind, int numi, int numj)
+{
+	return table.sum2d_indexed_pd(src, nrows, iind, jind, numi, numj);
+}
+
+double iu_dot2d_indexed_pd(const double *src, int nrows, const int *iind, const int *jind, int numi, int numj, const double *w)
+{
+	return table.dot2d_indexed_pd(src, nrows, iind, jind, numi, numj, w);
+}
+
+void iu_sgemv(char order, int nrows, int ncols, const float *a, int lda, const float *x, float *y)
+{
+	table.sgemv(order, nrows, ncols, a, lda, x, y);
+}
+
+void iu_dgemv(char order, int nrows, int ncols, const double *a, int lda, const double *x, double *y)
+{
+	table.dgemv(order, nrows, ncols, a, lda, x, y);
+}
+
+void iu_scsrmv(int nrows, const int *rowptr, const int *colind, const float *values, const float *x, float *y)
+{
+	table.scsrmv(nrows, rowptr, colind, values, x, y);
+}
+
+void iu_dcsrmv(int nrows, const int *rowptr, const int *colind, const double *values, const double *x, double *y)
+{
+	table.dcsrmv(nrows, rowptr, colind, values, x, y);
+}
+
+void iu_ssellmv(int nrows, const int *chunkptr, const int *perm, const int *colind, const float *values, const float *x, float *y)
+{
+	table.ssellmv(nrows, chunkptr, perm, colind, values, x, y);
+}
+
+void iu_dsellmv(int nrows, const int *chunkptr, const int *perm, const int *colind, const double *values, const double *x, double *y)
+{
+	table.dsellmv(nrows, chunkptr, perm, colind, values, x, y);
+}
+
+float iu_fdot_spans(const float *x, const float *y, const int *spans, int nspans, const int *singles, const int *offsets, int nsingles)
+{
+	return table.fdot_spans(x, y, spans, nspans, singles, offsets, nsingles);
+}
+
+double iu_ddot_spans(const double *x, const double *y, const int *spans, int nspans, const int *singles, const int *offsets, int nsingles)
+{
+	return table.ddot_spans(x, y, spans, nspans, singles, offsets, nsingles);
+}
+
+float iu_fsum_spans(const float *x, const int *spans, int nspans, const int *singles, int nsingles)
+{
+	return table.fsum_spans(x, spans, nspans, singles, nsingles);
+}
+
+double iu_dsum_spans(const double *x, const int *spans, int nspans, const int *singles, int nsingles)
+{
+	return table.dsum_spans(x, spans, nspans, singles, nsingles);
+}
+
+void iu_copy_spans_ps(float *dst, const float *src, const int *spans, int nspans, const int *singles, const int *offsets, int nsingles)
+{
+	table.copy_spans_ps(dst, src, spans, nspans, singles, offsets, nsingles);
+}
+
+float iu_smin(const float *x, int n)
+{
+	return table.smin(x, n);
+}
+
+float iu_smax(const float *x, int n)
+{
+	return table.smax(x, n);
+}
+
+int iu_sargmin(const float *x, int n)
+{
+	return table.sargmin(x, n);
+}
+
+int iu_sargmax(const float *x, int n)
+{
+	return table.sargmax(x, n);
+}
+
+double iu_dmin(const double *x, int n)
+{
+	return table.dmin(x, n);
+}
+
+double iu_dmax(const double *x, int n)
+{
+	return table.dmax(x, n);
+}
+
+int iu_dargmin(const double *x, int n)
+{
+	return table.dargmin(x, n);
+}
+
+int iu_dargmax(const double *x, int n)
+{
+	return table.dargmax(x, n);
+}
+
+void iu_sset_value_padded(float *x, int n, float value)
+{
+	table.sset_value_padded(x, n, value);
+}
+
+void iu_dset_value_padded(double *x, int n, double value)
+{
+	table.dset_value_padded(x, n, value);
+}
+
+float iu_fdot_padded(const float *x, const float *y, int n)
+{
+	return table.fdot_padded(x, y, n);
+}
+
+double iu_ddot_padded(const double *x, const double *y, int n)
+{
+	return table.ddot_padded(x, y, n);
+}
+
+float iu_fdot_indexed_padded(const float *x, const int *xindices, const float *y, int n)
+{
+	return table.fdot_indexed_padded(x, xindices, y, n);
+}
+
+double iu_ddot_indexed_padded(const double *x, const int *xindices, const double *y, int n)
+{
+	return table.ddot_indexed_padded(x, xindices, y, n);
+}
+
+void iu_copy1d_ps_padded(float *dst, const float *src, int n)
+{
+	table.copy1d_ps_padded(dst, src, n);
+}
+
+void iu_copy1d_epi32_padded(int *dst, const int *src, int n)
+{
+	table.copy1d_epi32_padded(dst, src, n);
+}
+
+void iu_copy1d_epi32(int *dst, const int *src, int n)
+{
+	table.copy1d_epi32(dst, src, n);
+}
+
+void iu_copy2d_epi32(int *kind, int nrows, const int *iind, const int *jind, int numi, int numj)
+{
+	table.copy2d_epi32(kind, nrows, iind, jind, numi, numj);
+}
+
+void iu_copy2d_epi32_ld(char order, int *kind, int ldk, int ld, const int *iind, const int *jind, int numi, int numj)
+{
+	table.copy2d_epi32_ld(order, kind, ldk, ld, iind, jind, numi, numj);
+}
+
+void iu_copy1d_ps(float *dst, const float *src, int n)
+{
+	table.copy1d_ps(dst, src, n);
+}
+
+void iu_copy2d_indexed_ps(float *dst, const float *src, int nrows, const int *iind, const int *jind, int numi, int numj)
+{
+	table.copy2d_indexed_ps(dst, src, nrows, iind, jind, numi, numj);
+}
+
+void iu_copy2d_indexed_ps_ld(char order, float *dst, int lddst, const float *src, int ldsrc, const int *iind, const int *jind, int numi, int numj)
+{
+	table.copy2d_indexed_ps_ld(order, dst, lddst, src, ldsrc, iind, jind, numi, numj);
+}
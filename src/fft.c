@@ -0,0 +1,428 @@
+#include "fft.h"
+#include "dispatch.h"
+#include "constants.h"
+#include <stdlib.h>
+#include <math.h>
+
+#define FFT_TWO_PI 6.28318530717958647692
+
+// Direct summation costs one FMA per weight and cell; an FFT convolution
+// costs about as much as this many weights per cell and unit of stage cost
+// (log2 p for radices up to 5, p for larger primes) in each of its
+// transforms, as measured by bench/Benchfft.c.
+#define CONV2D_FFT_COST 9.0
+
+//----------------------------------------------------------------------------
+// Functions for one-dimensional transforms.
+//----------------------------------------------------------------------------
+
+static int factor(int n, int *radix)
+{
+	int p, nstages = 0;
+
+	while (n % 4 == 0) {
+		radix[nstages++] = 4;
+		n /= 4;
+	}
+
+	if (n % 2 == 0) {
+		radix[nstages++] = 2;
+		n /= 2;
+	}
+
+	for (p = 3; n > 1; p += 2) {
+		while (n % p == 0) {
+			radix[nstages++] = p;
+			n /= p;
+		}
+
+		if ((long long)p * p > n && n > 1) {
+			radix[nstages++] = n;
+			n = 1;
+		}
+	}
+
+	return nstages;
+}
+
+// exp(sign 2 pi i num / den), with num reduced first to keep the angle exact.
+static void unit_root(float *z, long long num, long long den, int sign)
+{
+	double angle = FFT_TWO_PI * (double)(num % den) / (double)den;
+
+	z[0] = (float)cos(angle);
+	z[1] = (float)(sign * sin(angle));
+}
+
+struct iu_fft_plan *iu_fft_plan_create(int n)
+{
+	struct iu_fft_plan *plan;
+	int d, s, e, jj, k, p, len;
+	size_t size = 0;
+	float *table;
+
+	if (n < 1) {
+		return NULL;
+	}
+
+	plan = calloc(1, sizeof(*plan));
+
+	if (plan == NULL) {
+		return NULL;
+	}
+
+	plan->n = n;
+	plan->nstages = factor(n, plan->radix);
+
+	for (s = 0, len = n; s < plan->nstages; len /= plan->radix[s++]) {
+		plan->stage_offset[s] = size;
+		size += 2 * (size_t)plan->radix[s] * (1 + len / plan->radix[s]);
+	}
+
+	for (d = 0; d < 2; d++) {
+		plan->tables[d] = malloc((size > 0 ? size : 1) * sizeof(float));
+
+		if (plan->tables[d] == NULL) {
+			iu_fft_plan_free(plan);
+			return NULL;
+		}
+
+		for (s = 0, len = n; s < plan->nstages; len /= plan->radix[s++]) {
+			p = plan->radix[s];
+			table = plan->tables[d] + plan->stage_offset[s];
+
+			for (e = 0; e < p; e++) {
+				unit_root(table + 2 * e, e, p, d == 0 ? IU_FFT_FORWARD : IU_FFT_INVERSE);
+			}
+
+			table += 2 * p;
+
+			for (jj = 0; jj < len / p; jj++) {
+				for (k = 1; k < p; k++) {
+					unit_root(table + 2 * ((size_t)jj * (p - 1) + k - 1), (long long)jj * k, len, d == 0 ? IU_FFT_FORWARD : IU_FFT_INVERSE);
+				}
+			}
+		}
+	}
+
+	return plan;
+}
+
+void iu_fft_plan_free(struct iu_fft_plan *plan)
+{
+	if (plan == NULL) {
+		return;
+	}
+
+	free(plan->tables[0]);
+	free(plan->tables[1]);
+	free(plan);
+}
+
+// Stages alternate between data and work; after an odd number of them the
+// result is copied back.
+void iu_fft_batch(const struct iu_fft_plan *plan, float *data, float *work, int batch, int direction)
+{
+	int s, p, len = plan->n, span = 1;
+	const float *table = plan->tables[direction == IU_FFT_FORWARD ? 0 : 1];
+	float *src = data, *dst = work, *tmp;
+
+	for (s = 0; s < plan->nstages; s++) {
+		p = plan->radix[s];
+		iu_fft_stage_ps(dst, src, span * batch, len / p, p, table + plan->stage_offset[s] + 2 * p, table + plan->stage_offset[s]);
+
+		tmp = src;
+		src = dst;
+		dst = tmp;
+		len /= p;
+		span *= p;
+	}
+
+	if (src != data) {
+		iu_copy1d_ps(data, src, 2 * plan->n * batch);
+	}
+}
+
+//----------------------------------------------------------------------------
+// Functions for real two-dimensional transforms. Transforms across columns
+// run with the rows of a column as the batch, so both passes keep registers
+// on contiguous data; the grid is transposed in between.
+//----------------------------------------------------------------------------
+
+// dst[c + r cols] = src[r + c rows] for complex values, which move as
+// doubles.
+static void transpose_complex(float *dst, const float *src, int rows, int cols)
+{
+	iu_transpose_pd(COLUMN_MAJOR_ORDER, rows, cols, (const double *)src, rows, (double *)dst, cols);
+}
+
+struct iu_fft2d *iu_fft2d_create(int nrows, int ncols)
+{
+	struct iu_fft2d *fft;
+	int k;
+
+	if (nrows < 1 || ncols < 1) {
+		return NULL;
+	}
+
+	fft = calloc(1, sizeof(*fft));
+
+	if (fft == NULL) {
+		return NULL;
+	}
+
+	fft->nrows = nrows;
+	fft->ncols = ncols;
+	fft->hcols = ncols / 2 + 1;
+	fft->row_plan = iu_fft_plan_create(nrows);
+	fft->col_plan = iu_fft_plan_create(ncols % 2 == 0 ? ncols / 2 : ncols);
+	fft->split = malloc(2 * fft->hcols * sizeof(float));
+	fft->work = malloc(4 * (size_t)nrows * ncols * sizeof(float));
+
+	if (fft->row_plan == NULL || fft->col_plan == NULL || fft->split == NULL || fft->work == NULL) {
+		iu_fft2d_free(fft);
+		return NULL;
+	}
+
+	for (k = 0; k < fft->hcols; k++) {
+		unit_root(fft->split + 2 * k, k, ncols, IU_FFT_FORWARD);
+	}
+
+	return fft;
+}
+
+void iu_fft2d_free(struct iu_fft2d *fft)
+{
+	if (fft == NULL) {
+		return;
+	}
+
+	iu_fft_plan_free(fft->row_plan);
+	iu_fft_plan_free(fft->col_plan);
+	free(fft->split);
+	free(fft->work);
+	free(fft);
+}
+
+// With z = x[2t] + i x[2t + 1] transformed to Z over h = ncols / 2 columns,
+// the spectrum of x is X[k] = (Z[k] + Z*[h - k]) / 2
+// - i w^k (Z[k] - Z*[h - k]) / 2 for k <= h, with w = exp(-2 pi i / ncols)
+// and Z[h] = Z[0].
+static void split_columns(const struct iu_fft2d *fft, float *dst, const float *src)
+{
+	int i, k, h = fft->ncols / 2, nrows = fft->nrows;
+	const float *a, *b;
+	float *x;
+	float wr, wi, er, ei, fr, fi;
+
+	for (k = 0; k <= h; k++) {
+		a = src + 2 * (size_t)(k % h) * nrows;
+		b = src + 2 * (size_t)((h - k) % h) * nrows;
+		x = dst + 2 * (size_t)k * nrows;
+		wr = fft->split[2 * k];
+		wi = fft->split[2 * k + 1];
+
+		for (i = 0; i < nrows; i++) {
+			er = 0.5f * (a[2 * i] + b[2 * i]);
+			ei = 0.5f * (a[2 * i + 1] - b[2 * i + 1]);
+			fr = 0.5f * (a[2 * i + 1] + b[2 * i + 1]);
+			fi = -0.5f * (a[2 * i] - b[2 * i]);
+			x[2 * i] = er + wr * fr - wi * fi;
+			x[2 * i + 1] = ei + wr * fi + wi * fr;
+		}
+	}
+}
+
+// The inverse of split_columns, doubled: Z[k] = (X[k] + X*[h - k])
+// + i w^-k (X[k] - X*[h - k]) for k < h.
+static void merge_columns(const struct iu_fft2d *fft, float *dst, const float *src)
+{
+	int i, k, h = fft->ncols / 2, nrows = fft->nrows;
+	const float *a, *b;
+	float *z;
+	float wr, wi, dr, di, fr, fi;
+
+	for (k = 0; k < h; k++) {
+		a = src + 2 * (size_t)k * nrows;
+		b = src + 2 * (size_t)(h - k) * nrows;
+		z = dst + 2 * (size_t)k * nrows;
+		wr = fft->split[2 * k];
+		wi = -fft->split[2 * k + 1];
+
+		for (i = 0; i < nrows; i++) {
+			dr = a[2 * i] - b[2 * i];
+			di = a[2 * i + 1] + b[2 * i + 1];
+			fr = wr * dr - wi * di;
+			fi = wr * di + wi * dr;
+			z[2 * i] = a[2 * i] + b[2 * i] - fi;
+			z[2 * i + 1] = a[2 * i + 1] - b[2 * i + 1] + fr;
+		}
+	}
+}
+
+void iu_fft2d_r2c(struct iu_fft2d *fft, float *spectrum, const float *x)
+{
+	int i, j, nrows = fft->nrows, ncols = fft->ncols;
+	size_t cells = (size_t)nrows * ncols;
+	float *a = fft->work, *b = fft->work + 2 * cells;
+	const float *even, *odd;
+
+	if (ncols % 2 == 0) {
+		for (j = 0; j < ncols / 2; j++) {
+			even = x + 2 * (size_t)j * nrows;
+			odd = even + nrows;
+
+			for (i = 0; i < nrows; i++) {
+				a[2 * ((size_t)j * nrows + i)] = even[i];
+				a[2 * ((size_t)j * nrows + i) + 1] = odd[i];
+			}
+		}
+
+		iu_fft_batch(fft->col_plan, a, b, nrows, IU_FFT_FORWARD);
+		split_columns(fft, b, a);
+	} else {
+		for (i = 0; i < (int)cells; i++) {
+			b[2 * i] = x[i];
+			b[2 * i + 1] = 0;
+		}
+
+		iu_fft_batch(fft->col_plan, b, a, nrows, IU_FFT_FORWARD);
+	}
+
+	transpose_complex(spectrum, b, nrows, fft->hcols);
+	iu_fft_batch(fft->row_plan, spectrum, a, fft->hcols, IU_FFT_FORWARD);
+}
+
+void iu_fft2d_c2r(struct iu_fft2d *fft, float *x, const float *spectrum)
+{
+	int i, j, k, nrows = fft->nrows, ncols = fft->ncols, hcols = fft->hcols;
+	size_t cells = (size_t)nrows * ncols;
+	float *a = fft->work, *b = fft->work + 2 * cells;
+	float scale = 1.0f / (float)cells;
+	float *z;
+
+	iu_copy1d_ps(a, spectrum, 2 * nrows * hcols);
+	iu_fft_batch(fft->row_plan, a, b, hcols, IU_FFT_INVERSE);
+	transpose_complex(b, a, hcols, nrows);
+
+	if (ncols % 2 == 0) {
+		merge_columns(fft, a, b);
+		iu_fft_batch(fft->col_plan, a, b, nrows, IU_FFT_INVERSE);
+
+		for (j = 0; j < ncols / 2; j++) {
+			z = a + 2 * (size_t)j * nrows;
+
+			for (i = 0; i < nrows; i++) {
+				x[(size_t)2 * j * nrows + i] = scale * z[2 * i];
+				x[(size_t)(2 * j + 1) * nrows + i] = scale * z[2 * i + 1];
+			}
+		}
+	} else {
+		for (k = hcols; k < ncols; k++) {
+			for (i = 0; i < nrows; i++) {
+				b[2 * ((size_t)k * nrows + i)] = b[2 * ((size_t)(ncols - k) * nrows + i)];
+				b[2 * ((size_t)k * nrows + i) + 1] = -b[2 * ((size_t)(ncols - k) * nrows + i) + 1];
+			}
+		}
+
+		iu_fft_batch(fft->col_plan, b, a, nrows, IU_FFT_INVERSE);
+
+		for (i = 0; i < (int)cells; i++) {
+			x[i] = scale * b[2 * i];
+		}
+	}
+}
+
+//----------------------------------------------------------------------------
+// Functions for periodic convolutions.
+//----------------------------------------------------------------------------
+
+struct iu_conv2d *iu_conv2d_create(int nrows, int ncols, const float *kernels, int nkernels)
+{
+	struct iu_conv2d *conv;
+	int k;
+	size_t len;
+
+	if (nkernels < 1) {
+		return NULL;
+	}
+
+	conv = calloc(1, sizeof(*conv));
+
+	if (conv == NULL) {
+		return NULL;
+	}
+
+	conv->nkernels = nkernels;
+	conv->fft = iu_fft2d_create(nrows, ncols);
+
+	if (conv->fft == NULL) {
+		iu_conv2d_free(conv);
+		return NULL;
+	}
+
+	len = 2 * (size_t)nrows * conv->fft->hcols;
+	conv->spectra = malloc(nkernels * len * sizeof(float));
+	conv->spectrum = malloc(len * sizeof(float));
+	conv->product = malloc(len * sizeof(float));
+
+	if (conv->spectra == NULL || conv->spectrum == NULL || conv->product == NULL) {
+		iu_conv2d_free(conv);
+		return NULL;
+	}
+
+	for (k = 0; k < nkernels; k++) {
+		iu_fft2d_r2c(conv->fft, conv->spectra + k * len, kernels + (size_t)k * nrows * ncols);
+	}
+
+	return conv;
+}
+
+void iu_conv2d_free(struct iu_conv2d *conv)
+{
+	if (conv == NULL) {
+		return;
+	}
+
+	iu_fft2d_free(conv->fft);
+	free(conv->spectra);
+	free(conv->spectrum);
+	free(conv->product);
+	free(conv);
+}
+
+void iu_conv2d_apply(struct iu_conv2d *conv, float *const *out, const float *f)
+{
+	int k;
+	int n = conv->fft->nrows * conv->fft->hcols;
+
+	iu_fft2d_r2c(conv->fft, conv->spectrum, f);
+
+	for (k = 0; k < conv->nkernels; k++) {
+		iu_cmul_ps(conv->product, conv->spectrum, conv->spectra + 2 * (size_t)k * n, n);
+		iu_fft2d_c2r(conv->fft, out[k], conv->product);
+	}
+}
+
+// Per element, a radix p stage costs about log2(p) for p <= 5 and p beyond.
+static double transform_cost(int n)
+{
+	int s, nstages;
+	int radix[FFT_MAX_STAGES];
+	double cost = 0;
+
+	nstages = factor(n, radix);
+
+	for (s = 0; s < nstages; s++) {
+		cost += radix[s] <= 5 ? log2(radix[s]) : radix[s];
+	}
+
+	return cost;
+}
+
+int iu_conv2d_prefer_fft(int nrows, int ncols, int nweights, int nkernels)
+{
+	double fft = CONV2D_FFT_COST * (nkernels + 1) * (transform_cost(nrows) + transform_cost(ncols) + 1);
+
+	return nweights > fft;
+}
@@ -0,0 +1,133 @@
+#include "index_plan.h"
+#include "dispatch.h"
+#include <stdlib.h>
+
+//----------------------------------------------------------------------------
+// Functions for building plans.
+//----------------------------------------------------------------------------
+
+struct iu_index_plan *iu_index_plan_from_indices(const int *indices, int n, int min_span)
+{
+	struct iu_index_plan *plan;
+	int i, k, run;
+
+	if (min_span <= 0) {
+		min_span = PLAN_MIN_SPAN;
+	}
+
+	plan = calloc(1, sizeof(*plan));
+
+	if (plan == NULL) {
+		return NULL;
+	}
+
+	// At most n / min_span spans and n singles; sized for the worst case.
+	plan->len = n;
+	plan->spans = malloc((3 * (n / min_span) + 1) * sizeof(int));
+	plan->singles = malloc((n > 0 ? n : 1) * sizeof(int));
+	plan->single_offsets = malloc((n > 0 ? n : 1) * sizeof(int));
+
+	if (plan->spans == NULL || plan->singles == NULL || plan->single_offsets == NULL) {
+		iu_index_plan_free(plan);
+		return NULL;
+	}
+
+	for (i = 0; i < n; i += run) {
+		for (run = 1; i + run < n && indices[i + run] == indices[i] + run; run++);
+
+		if (run >= min_span) {
+			plan->spans[3 * plan->nspans] = indices[i];
+			plan->spans[3 * plan->nspans + 1] = run;
+			plan->spans[3 * plan->nspans + 2] = i;
+			plan->nspans++;
+		} else {
+			for (k = i; k < i + run; k++) {
+				plan->singles[plan->nsingles] = indices[k];
+				plan->single_offsets[plan->nsingles] = k;
+				plan->nsingles++;
+			}
+		}
+	}
+
+	return plan;
+}
+
+struct iu_index_plan *iu_index_plan_from_radius(int ld, double inner, double outer)
+{
+	struct iu_index_plan *plan;
+	int *indices;
+	int di, dj, r, n;
+	double dist2;
+
+	// Columns of the window must not overlap, or a cell would be listed
+	// under two offsets.
+	r = outer > 0 ? (int)outer : 0;
+
+	if (ld < 2 * r + 1) {
+		return NULL;
+	}
+
+	indices = malloc((size_t)(2 * r + 1) * (2 * r + 1) * sizeof(int));
+
+	if (indices == NULL) {
+		return NULL;
+	}
+
+	n = 0;
+
+	for (dj = -r; dj <= r; dj++) {
+		for (di = -r; di <= r; di++) {
+			dist2 = (double)(di * di + dj * dj);
+
+			if (dist2 >= inner * inner && dist2 < outer * outer) {
+				indices[n++] = dj * ld + di;
+			}
+		}
+	}
+
+	plan = iu_index_plan_from_indices(indices, n, 0);
+	free(indices);
+
+	return plan;
+}
+
+void iu_index_plan_free(struct iu_index_plan *plan)
+{
+	if (plan == NULL) {
+		return;
+	}
+
+	free(plan->spans);
+	free(plan->singles);
+	free(plan->single_offsets);
+	free(plan);
+}
+
+//----------------------------------------------------------------------------
+// Reductions over a plan.
+//----------------------------------------------------------------------------
+
+float iu_fdot_plan(const struct iu_index_plan *plan, const float *x, const float *y)
+{
+	return iu_fdot_spans(x, y, plan->spans, plan->nspans, plan->singles, plan->single_offsets, plan->nsingles);
+}
+
+double iu_ddot_plan(const struct iu_index_plan *plan, const double *x, const double *y)
+{
+	return iu_ddot_spans(x, y, plan->spans, plan->nspans, plan->singles, plan->single_offsets, plan->nsingles);
+}
+
+float iu_fsum_plan(const struct iu_index_plan *plan, const float *x)
+{
+	return iu_fsum_spans(x, plan->spans, plan->nspans, plan->singles, plan->nsingles);
+}
+
+double iu_dsum_plan(const struct iu_index_plan *plan, const double *x)
+{
+	return iu_dsum_spans(x, plan->spans, plan->nspans, plan->singles, plan->nsingles);
+}
+
+void iu_copy_plan_ps(const struct iu_index_plan *plan, float *dst, const float *src)
+{
+	iu_copy_spans_ps(dst, src, plan->spans, plan->nspans, plan->singles, plan->single_offsets, plan->nsingles);
+}
@@ -3,1049 +3,11201 @@
 #include "constants.h"
 #include "cpu_flags.h"
 #include <immintrin.h>
+#include <errno.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
 
 //----------------------------------------------------------------------------
-// Functions for setting values of arrays.
+// Helpers for SSE kernels, which have no masked loads or stores.
 //----------------------------------------------------------------------------
 
-void _mm256_sset_value(float *x, int n, float value)
+static __m128 load_partial_ps(const float *x, int len)
 {
-	int k;
-	int cutoff = n % FLOAT_PER_M256_REG;
-	__m256 vreg = _mm256_set1_ps(value);
-	__m256i mask;
+	float buffer[FLOAT_PER_M128_REG] = {0};
 
-	if (cutoff > 0) {
-		mask = _mm256_set_mask_epi32(cutoff - 1);
-		_mm256_maskstore_ps(x, mask, vreg);
+	for (int k = 0; k < len; k++) {
+		buffer[k] = x[k];
 	}
 
-	for (k = cutoff; k < n; k += FLOAT_PER_M256_REG) {
-		_mm256_storeu_ps(x + k, vreg);
-	}
+	return _mm_loadu_ps(buffer);
 }
 
-void _mm256_dset_value(double *x, int n, double value)
+static __m128 gather_partial_ps(const float *x, const int *indices, int len)
 {
-	int k;
-	int cutoff = n % DOUBLE_PER_M256_REG;
-	__m256d vreg = _mm256_set1_pd(value);
-	__m256i mask;
+	float buffer[FLOAT_PER_M128_REG] = {0};
 
-	if (cutoff > 0) {
-		mask = _mm256_set_mask_epi64(cutoff - 1);
-		_mm256_maskstore_pd(x, mask, vreg);
+	for (int k = 0; k < len; k++) {
+		buffer[k] = x[indices[k]];
 	}
 
-	for (k = cutoff; k < n; k += DOUBLE_PER_M256_REG) {
-		_mm256_storeu_pd(x + k, vreg);
-	}
+	return _mm_loadu_ps(buffer);
 }
 
-#ifdef SUPPORTS_AVX512
-void _mm512_sset_value(float *x, int n, float value)
+static __m128 gather_ps(const float *x, const int *indices)
 {
-	int k;
-	int cutoff = n % FLOAT_PER_M512_REG;
-	__m512 vreg = _mm512_set1_ps(value);
-	__mmask16 mask;
-
-	if (cutoff > 0) {
-		mask = _mm512_set_mask_epi32(cutoff - 1);
-		_mm512_mask_storeu_ps(x, mask, vreg);
-	}
-
-	for (k = cutoff; k < n; k += FLOAT_PER_M512_REG) {
-		_mm512_storeu_ps(x + k, vreg);
-	}
+	return _mm_setr_ps(x[indices[0]], x[indices[1]], x[indices[2]], x[indices[3]]);
 }
 
-void _mm512_dset_value(double *x, int n, double value)
+static __m128d gather_pd(const double *x, const int *indices)
 {
-	int k;
-	int cutoff = n % FLOAT_PER_M512_REG;
-	__m512d vreg = _mm512_set1_pd(value);
-	__mmask8 mask;
-
-	if (cutoff > 0) {
-		mask = _mm512_set_mask_epi64(cutoff - 1);
-		_mm512_mask_storeu_pd(x, mask, vreg);
-	}
-
-	for (k = cutoff; k < n; k += FLOAT_PER_M512_REG) {
-		_mm512_storeu_pd(x + k, vreg);
-	}
+	return _mm_setr_pd(x[indices[0]], x[indices[1]]);
 }
-#endif
 
 //----------------------------------------------------------------------------
-// Functions for computing sums of elements in registers.
+// Helpers for non-temporal stores. Streaming kernels peel a masked head up
+// to the first register-aligned element, stream whole registers, finish
+// with a masked tail and fence so the stores are ordered before any that
+// follow.
 //----------------------------------------------------------------------------
 
-float _mm256_fdot(const float *x, const float *y, int n)
+static size_t stream_threshold;
+
+// IU_STREAM_THRESHOLD must be a positive decimal byte count. Anything else,
+// including 0, falls back to the cache-derived default, matching
+// iu_set_stream_threshold(0).
+static size_t default_stream_threshold(void)
 {
-	__m256 xreg;
-	__m256 yreg;
-	__m256 preg;
-	__m256 sreg = _mm256_set1_ps(0);
-	__m256i mask;
-	int i;
-	int cutoff = n % FLOAT_PER_M256_REG;
+	const char *env = getenv("IU_STREAM_THRESHOLD");
+	char *end;
+	unsigned long long bytes;
+	long llc = -1;
 
-	if (cutoff > 0) {
-		mask = _mm256_set_mask_epi32(cutoff - 1);
+	if (env != NULL && *env >= '0' && *env <= '9') {
+		errno = 0;
+		bytes = strtoull(env, &end, 10);
 
-		xreg = _mm256_maskload_ps(x, mask);
-		yreg = _mm256_maskload_ps(y, mask);
-		preg = _mm256_mul_ps(xreg, yreg);
-		sreg = _mm256_add_ps(sreg, preg);
+		if (*end == '\0' && errno == 0 && bytes > 0 && bytes <= SIZE_MAX) {
+			return (size_t)bytes;
+		}
 	}
 
-	for (i = cutoff; i < n; i += FLOAT_PER_M256_REG) {
-		xreg = _mm256_loadu_ps(x + i);
-		yreg = _mm256_loadu_ps(y + i);
-		preg = _mm256_mul_ps(xreg, yreg);
-		sreg = _mm256_add_ps(sreg, preg);
+#ifdef _SC_LEVEL3_CACHE_SIZE
+	llc = sysconf(_SC_LEVEL3_CACHE_SIZE);
+
+	if (llc <= 0) {
+		llc = sysconf(_SC_LEVEL2_CACHE_SIZE);
 	}
+#endif
 
-	return _mm256_register_sum_ps(sreg);
+	if (llc <= 0) {
+		llc = STREAM_DEFAULT_LLC;
+	}
+
+	return (size_t)llc / STREAM_LLC_DIVISOR;
 }
 
-float _mm256_fdot_indexed(const float *x, const int *xindices, const float *y, int n)
+__attribute__((constructor))
+static void stream_init(void)
 {
-	__m256 xreg;
-	__m256 yreg;
-	__m256 preg;
-	__m256 sreg = _mm256_set1_ps(0);
-	__m256i vindex;
-	__m256i mask;
-	int i;
-	int cutoff = n % FLOAT_PER_M256_REG;
-
-	if (cutoff > 0) {
-		mask = _mm256_set_mask_epi32(cutoff - 1);
-		vindex = _mm256_maskload_epi32(xindices, mask);
-		yreg = _mm256_maskload_ps(y, mask);
-		xreg = _mm256_mask_i32gather_ps(sreg, x, vindex, _mm256_castsi256_ps(mask), 4);
+	stream_threshold = default_stream_threshold();
+}
 
-		preg = _mm256_mul_ps(xreg, yreg);
-		sreg = _mm256_add_ps(sreg, preg);
-	}
+size_t iu_stream_threshold(void)
+{
+	return stream_threshold;
+}
 
-	mask = _mm256_set_mask_epi32(INT32_PER_M256_REG - 1);
+void iu_set_stream_threshold(size_t bytes)
+{
+	stream_threshold = bytes > 0 ? bytes : default_stream_threshold();
+}
 
-	for (i = cutoff; i < n; i += FLOAT_PER_M256_REG) {
-		vindex = _mm256_maskload_epi32(xindices + i, mask);
-		yreg = _mm256_loadu_ps(y + i);
-		xreg = _mm256_i32gather_ps(x, vindex, 4);
+// Streaming needs the output to be large enough and naturally aligned, so
+// that some element falls on a register boundary.
+static inline int use_stream(const void *dst, size_t bytes, size_t elsize)
+{
+	return bytes >= stream_threshold && (uintptr_t)dst % elsize == 0;
+}
 
-		preg = _mm256_mul_ps(xreg, yreg);
-		sreg = _mm256_add_ps(sreg, preg);
-	}
+// Number of elements before the first one aligned to a register of width
+// bytes, capped at n.
+static inline int stream_head(const void *dst, size_t width, size_t elsize, int n)
+{
+	int head = (int)((width - (uintptr_t)dst % width) % width / elsize);
 
-	return _mm256_register_sum_ps(sreg);
+	return head < n ? head : n;
 }
 
-float _mm256_fdot_indexed2(const float *x, const int *xindices, const float *y, const int *yindices, int n)
+TARGET_AVX2
+static void stream_sset_value256(float *x, int n, __m256 vreg)
 {
-	__m256 xreg;
-	__m256 yreg;
-	__m256 preg;
-	__m256 sreg = _mm256_set1_ps(0);
-	__m256i xindex, yindex;
-	__m256i mask;
-	int i;
-	int cutoff = n % FLOAT_PER_M256_REG;
+	int k;
+	int head = stream_head(x, sizeof(__m256), sizeof(float), n);
 
-	if (cutoff > 0) {
-		mask = _mm256_set_mask_epi32(cutoff - 1);
-		xindex = _mm256_maskload_epi32(xindices, mask);
-		yindex = _mm256_maskload_epi32(yindices, mask);
+	if (head > 0) {
+		_mm256_maskstore_ps(x, _mm256_set_mask_epi32(head - 1), vreg);
+	}
 
-		xreg = _mm256_mask_i32gather_ps(sreg, x, xindex, _mm256_castsi256_ps(mask), 4);
-		yreg = _mm256_mask_i32gather_ps(sreg, y, yindex, _mm256_castsi256_ps(mask), 4);
+	for (k = head; k + FLOAT_PER_M256_REG <= n; k += FLOAT_PER_M256_REG) {
+		_mm256_stream_ps(x + k, vreg);
+	}
 
-		preg = _mm256_mul_ps(xreg, yreg);
-		sreg = _mm256_add_ps(sreg, preg);
+	if (k < n) {
+		_mm256_maskstore_ps(x + k, _mm256_set_mask_epi32(n - k - 1), vreg);
 	}
 
-	mask = _mm256_set_mask_epi32(INT32_PER_M256_REG - 1);
+	_mm_sfence();
+}
 
-	for (i = cutoff; i < n; i += FLOAT_PER_M256_REG) {
-		xindex = _mm256_maskload_epi32(xindices + i, mask);
-		yindex = _mm256_maskload_epi32(yindices + i, mask);
+TARGET_AVX2
+static void stream_dset_value256(double *x, int n, __m256d vreg)
+{
+	int k;
+	int head = stream_head(x, sizeof(__m256d), sizeof(double), n);
 
-		xreg = _mm256_i32gather_ps(x, xindex, 4);
-		yreg = _mm256_i32gather_ps(y, yindex, 4);
+	if (head > 0) {
+		_mm256_maskstore_pd(x, _mm256_set_mask_epi64(head - 1), vreg);
+	}
 
-		preg = _mm256_mul_ps(xreg, yreg);
-		sreg = _mm256_add_ps(sreg, preg);
+	for (k = head; k + DOUBLE_PER_M256_REG <= n; k += DOUBLE_PER_M256_REG) {
+		_mm256_stream_pd(x + k, vreg);
 	}
 
-	return _mm256_register_sum_ps(sreg);
+	if (k < n) {
+		_mm256_maskstore_pd(x + k, _mm256_set_mask_epi64(n - k - 1), vreg);
+	}
+
+	_mm_sfence();
 }
 
-double _mm256_ddot(const double *x, const double *y, int n)
+TARGET_AVX2
+static void stream_copy1d_ps256(float *dst, const float *src, int n)
 {
-	__m256d xreg;
-	__m256d yreg;
-	__m256d preg;
-	__m256d sreg = _mm256_set1_pd(0);
+	int k;
+	int head = stream_head(dst, sizeof(__m256), sizeof(float), n);
 	__m256i mask;
-	int i;
-	int cutoff = n % DOUBLE_PER_M256_REG;
 
-	if (cutoff > 0) {
-		mask = _mm256_set_mask_epi64(cutoff - 1);
+	if (head > 0) {
+		mask = _mm256_set_mask_epi32(head - 1);
+		_mm256_maskstore_ps(dst, mask, _mm256_maskload_ps(src, mask));
+	}
 
-		xreg = _mm256_maskload_pd(x, mask);
-		yreg = _mm256_maskload_pd(y, mask);
-		preg = _mm256_mul_pd(xreg, yreg);
-		sreg = _mm256_add_pd(sreg, preg);
+	for (k = head; k + FLOAT_PER_M256_REG <= n; k += FLOAT_PER_M256_REG) {
+		_mm256_stream_ps(dst + k, _mm256_loadu_ps(src + k));
 	}
 
-	for (i = cutoff; i < n; i += DOUBLE_PER_M256_REG) {
-		xreg = _mm256_loadu_pd(x + i);
-		yreg = _mm256_loadu_pd(y + i);
-		preg = _mm256_mul_pd(xreg, yreg);
-		sreg = _mm256_add_pd(sreg, preg);
+	if (k < n) {
+		mask = _mm256_set_mask_epi32(n - k - 1);
+		_mm256_maskstore_ps(dst + k, mask, _mm256_maskload_ps(src + k, mask));
 	}
 
-	return _mm256_register_sum_pd(sreg);
+	_mm_sfence();
 }
 
-double _mm256_ddot_indexed(const double *x, const int *xindices, const double *y, int n)
+TARGET_AVX2
+static void stream_copy1d_epi32_256(int *dst, const int *src, int n)
 {
-	__m256d xreg;
-	__m256d yreg;
-	__m256d preg;
-	__m256d sreg = _mm256_set1_pd(0);
-	__m128i vindex;
+	int k;
+	int head = stream_head(dst, sizeof(__m256i), sizeof(int), n);
 	__m256i mask;
-	__m256d dmask;
-	__m128i mask128;
-	int i;
-	int cutoff = n % DOUBLE_PER_M256_REG;
-
-	if (cutoff > 0) {
-		mask = _mm256_set_mask_epi64(cutoff - 1);
-		dmask = _mm256_castsi256_pd(mask);
-		mask128 = _mm_set_mask_epi32(cutoff - 1);
-
-		vindex = _mm_maskload_epi32(xindices, mask128);
-		xreg = _mm256_mask_i32gather_pd(sreg, x, vindex, dmask, 8);
-		yreg = _mm256_maskload_pd(y, mask);
 
-		preg = _mm256_mul_pd(xreg, yreg);
-		sreg = _mm256_add_pd(sreg, preg);
+	if (head > 0) {
+		mask = _mm256_set_mask_epi32(head - 1);
+		_mm256_maskstore_epi32(dst, mask, _mm256_maskload_epi32(src, mask));
 	}
 
-    for (i = cutoff; i < n; i += DOUBLE_PER_M256_REG) {
-        vindex = _mm_loadu_epi32(xindices + i);
-		yreg = _mm256_loadu_pd(y + i);
-		xreg = _mm256_i32gather_pd(x, vindex, 8);
+	for (k = head; k + INT32_PER_M256_REG <= n; k += INT32_PER_M256_REG) {
+		_mm256_stream_si256((__m256i *)(dst + k), _mm256_loadu_si256((const __m256i *)(src + k)));
+	}
 
-		preg = _mm256_mul_pd(xreg, yreg);
-		sreg = _mm256_add_pd(sreg, preg);
+	if (k < n) {
+		mask = _mm256_set_mask_epi32(n - k - 1);
+		_mm256_maskstore_epi32(dst + k, mask, _mm256_maskload_epi32(src + k, mask));
 	}
 
-	return _mm256_register_sum_pd(sreg);
+	_mm_sfence();
 }
 
-double _mm256_ddot_indexed2(const double *x, const int *xindices, const double *y, const int *yindices, int n)
+#ifdef SUPPORTS_AVX512
+TARGET_AVX512
+static void stream_sset_value512(float *x, int n, __m512 vreg)
 {
-	__m256d xreg;
-	__m256d yreg;
-	__m256d preg;
-	__m256d sreg = _mm256_set1_pd(0);
-	__m128i xindex, yindex;
-	__m256i mask;
-	__m256d dmask;
-	__m128i mask128;
-	int i;
-	int cutoff = n % DOUBLE_PER_M256_REG;
-
-	if (cutoff > 0) {
-		mask = _mm256_set_mask_epi64(cutoff - 1);
-		dmask = _mm256_castsi256_pd(mask);
-		mask128 = _mm_set_mask_epi32(cutoff - 1);
+	int k;
+	int head = stream_head(x, sizeof(__m512), sizeof(float), n);
 
-		xindex = _mm_maskload_epi32(xindices, mask128);
-		yindex = _mm_maskload_epi32(yindices, mask128);
+	if (head > 0) {
+		_mm512_mask_storeu_ps(x, _mm512_set_mask_epi32(head - 1), vreg);
+	}
 
-		xreg = _mm256_mask_i32gather_pd(sreg, x, xindex, dmask, 8);
-		yreg = _mm256_mask_i32gather_pd(sreg, y, yindex, dmask, 8);
+	for (k = head; k + FLOAT_PER_M512_REG <= n; k += FLOAT_PER_M512_REG) {
+		_mm512_stream_ps(x + k, vreg);
+	}
 
-		preg = _mm256_mul_pd(xreg, yreg);
-		sreg = _mm256_add_pd(sreg, preg);
+	if (k < n) {
+		_mm512_mask_storeu_ps(x + k, _mm512_set_mask_epi32(n - k - 1), vreg);
 	}
 
-    mask128 = _mm_set_mask_epi32(INT32_PER_M128_REG - 1);
+	_mm_sfence();
+}
 
-	for (i = cutoff; i < n; i += DOUBLE_PER_M256_REG) {
-		xindex = _mm_maskload_epi32(xindices, mask128);
-		yindex = _mm_maskload_epi32(yindices, mask128);
+TARGET_AVX512
+static void stream_dset_value512(double *x, int n, __m512d vreg)
+{
+	int k;
+	int head = stream_head(x, sizeof(__m512d), sizeof(double), n);
 
-		xreg = _mm256_i32gather_pd(x, xindex, 8);
-		yreg = _mm256_i32gather_pd(y, yindex, 8);
+	if (head > 0) {
+		_mm512_mask_storeu_pd(x, _mm512_set_mask_epi64(head - 1), vreg);
+	}
 
-		preg = _mm256_mul_pd(xreg, yreg);
-		sreg = _mm256_add_pd(sreg, preg);
+	for (k = head; k + DOUBLE_PER_M512_REG <= n; k += DOUBLE_PER_M512_REG) {
+		_mm512_stream_pd(x + k, vreg);
 	}
 
-	return _mm256_register_sum_pd(sreg);
-}
+	if (k < n) {
+		_mm512_mask_storeu_pd(x + k, _mm512_set_mask_epi64(n - k - 1), vreg);
+	}
 
+	_mm_sfence();
+}
 
-#ifdef SUPPORTS_AVX512
-float _mm512_fdot(const float *x, const float *y, int n)
+TARGET_AVX512
+static void stream_copy1d_ps512(float *dst, const float *src, int n)
 {
-	__m512 xreg;
-	__m512 yreg;
-	__m512 preg;
-	__m512 sreg = _mm512_set1_ps(0);
+	int k;
+	int head = stream_head(dst, sizeof(__m512), sizeof(float), n);
 	__mmask16 mask;
 
-	int i;
-	int cutoff = n % FLOAT_PER_M512_REG;
+	if (head > 0) {
+		mask = _mm512_set_mask_epi32(head - 1);
+		_mm512_mask_storeu_ps(dst, mask, _mm512_maskz_loadu_ps(mask, src));
+	}
 
-	if (cutoff > 0) {
-		mask = _mm512_set_mask_epi32(cutoff - 1);
+	for (k = head; k + FLOAT_PER_M512_REG <= n; k += FLOAT_PER_M512_REG) {
+		_mm512_stream_ps(dst + k, _mm512_loadu_ps(src + k));
+	}
 
-		xreg = _mm512_maskz_loadu_ps(mask, x);
-		yreg = _mm512_maskz_loadu_ps(mask, y);
-		preg = _mm512_mul_ps(xreg, yreg);
-		sreg = _mm512_add_ps(sreg, preg);
-	}
-
-	for (i = cutoff; i < n; i += FLOAT_PER_M512_REG) {
-		xreg = _mm512_loadu_ps(x + i);
-		yreg = _mm512_loadu_ps(y + i);
-		preg = _mm512_mul_ps(xreg, yreg);
-		sreg = _mm512_add_ps(sreg, preg);
+	if (k < n) {
+		mask = _mm512_set_mask_epi32(n - k - 1);
+		_mm512_mask_storeu_ps(dst + k, mask, _mm512_maskz_loadu_ps(mask, src + k));
 	}
 
-	return _mm512_register_sum_ps(sreg);
+	_mm_sfence();
 }
 
-float _mm512_fdot_indexed(const float *x, const int *xindices, const float *y, int n)
+TARGET_AVX512
+static void stream_copy1d_epi32_512(int *dst, const int *src, int n)
 {
-	__m512 xreg;
-	__m512 yreg;
-	__m512 preg;
-	__m512 sreg = _mm512_set1_ps(0);
-	__m512i vindex;
+	int k;
+	int head = stream_head(dst, sizeof(__m512i), sizeof(int), n);
 	__mmask16 mask;
-	int i;
-	int cutoff = n % FLOAT_PER_M512_REG;
-
-	if (cutoff > 0) {
-		mask = _mm512_set_mask_epi32(cutoff - 1);
-		vindex = _mm512_maskz_loadu_epi32(mask, xindices);
-		yreg = _mm512_maskz_loadu_ps(mask, y);
-		xreg = _mm512_mask_i32gather_ps(sreg, mask, vindex, x, 4);
 
-		preg = _mm512_mul_ps(xreg, yreg);
-		sreg = _mm512_add_ps(sreg, preg);
+	if (head > 0) {
+		mask = _mm512_set_mask_epi32(head - 1);
+		_mm512_mask_storeu_epi32(dst, mask, _mm512_maskz_loadu_epi32(mask, src));
 	}
 
-	for (i = cutoff; i < n; i += FLOAT_PER_M512_REG) {
-		vindex = _mm512_loadu_epi32(xindices + i);
-		yreg = _mm512_loadu_ps(y + i);
-		xreg = _mm512_i32gather_ps(vindex, x, 4);
+	for (k = head; k + INT32_PER_M512_REG <= n; k += INT32_PER_M512_REG) {
+		_mm512_stream_si512((void *)(dst + k), _mm512_loadu_si512(src + k));
+	}
 
-		preg = _mm512_mul_ps(xreg, yreg);
-		sreg = _mm512_add_ps(sreg, preg);
+	if (k < n) {
+		mask = _mm512_set_mask_epi32(n - k - 1);
+		_mm512_mask_storeu_epi32(dst + k, mask, _mm512_maskz_loadu_epi32(mask, src + k));
 	}
 
-	return _mm512_register_sum_ps(sreg);
+	_mm_sfence();
 }
+#endif
 
-float _mm512_fdot_indexed2(const float *x, const int *xindices, const float *y, const int *yindices, int n)
-{
-	__m512 xreg;
-	__m512 yreg;
-	__m512 preg;
-	__m512 sreg = _mm512_set1_ps(0);
-	__m512i xind;
-	__m512i yind;
-	__mmask16 mask;
-	int i;
-	int cutoff = n % FLOAT_PER_M512_REG;
-
-	if (cutoff > 0) {
-		mask = _mm512_set_mask_epi32(cutoff - 1);
-
-		xind = _mm512_maskz_loadu_epi32(mask, xindices);
-		yind = _mm512_maskz_loadu_epi32(mask, yindices);
-
-		xreg = _mm512_mask_i32gather_ps(sreg, mask, xind, x, 4);
-		yreg = _mm512_mask_i32gather_ps(sreg, mask, yind, y, 4);
+//----------------------------------------------------------------------------
+// Helpers for two-dimensional copies. Tiles start on row icutoff + k ti,
+// where ti is a multiple of every register width, so only the first tile of
+// each column band has a partial register, at its top.
+//----------------------------------------------------------------------------
 
-		preg = _mm512_mul_ps(xreg, yreg);
-		sreg = _mm512_add_ps(sreg, preg);
-	}
+static int copy2d_strategy = COPY2D_TILED;
+static size_t copy2d_l1;
+static size_t copy2d_l2;
 
-	for (i = cutoff; i < n; i += FLOAT_PER_M512_REG) {
-		xind = _mm512_loadu_epi32(xindices + i);
-		yind = _mm512_loadu_epi32(yindices + i);
+static size_t default_copy2d_cache(int level)
+{
+	long size = -1;
 
-		xreg = _mm512_i32gather_ps(xind, x, 4);
-		yreg = _mm512_i32gather_ps(yind, y, 4);
+#ifdef _SC_LEVEL1_DCACHE_SIZE
+	size = sysconf(level == 1 ? _SC_LEVEL1_DCACHE_SIZE : _SC_LEVEL2_CACHE_SIZE);
+#endif
 
-		preg = _mm512_mul_ps(xreg, yreg);
-		sreg = _mm512_add_ps(sreg, preg);
+	if (size <= 0) {
+		size = level == 1 ? COPY2D_DEFAULT_L1 : COPY2D_DEFAULT_L2;
 	}
 
-	return _mm512_register_sum_ps(sreg);
+	return (size_t)size;
 }
 
-double _mm512_ddot(const double *x, const double *y, int n)
+__attribute__((constructor))
+static void copy2d_init(void)
 {
-	__m512d xreg;
-	__m512d yreg;
-	__m512d preg;
-	__m512d sreg = _mm512_set1_pd(0);
-	__mmask8 mask;
-
-	int i;
-	int cutoff = n % DOUBLE_PER_M512_REG;
+	copy2d_l1 = default_copy2d_cache(1);
+	copy2d_l2 = default_copy2d_cache(2);
+}
 
-	if (cutoff > 0) {
-		mask = _mm512_set_mask_epi64(cutoff - 1);
+int iu_copy2d_strategy(void)
+{
+	return copy2d_strategy;
+}
 
-		xreg = _mm512_maskz_loadu_pd(mask, x);
-		yreg = _mm512_maskz_loadu_pd(mask, y);
-		preg = _mm512_mul_pd(xreg, yreg);
-		sreg = _mm512_add_pd(sreg, preg);
+int iu_set_copy2d_strategy(int strategy)
+{
+	if (strategy != COPY2D_CONTIGUOUS && strategy != COPY2D_SPLIT && strategy != COPY2D_TILED) {
+		return -1;
 	}
 
-	for (i = cutoff; i < n; i += FLOAT_PER_M256_REG) {
-		xreg = _mm512_loadu_pd(x + i);
-		yreg = _mm512_loadu_pd(y + i);
-		preg = _mm512_mul_pd(xreg, yreg);
-		sreg = _mm512_add_pd(sreg, preg);
-	}
+	copy2d_strategy = strategy;
 
-	return _mm512_register_sum_pd(sreg);
+	return 0;
 }
 
-double _mm512_ddot_indexed(const double *x, const int *xindices, const double *y, int n)
+void iu_copy2d_cache(size_t *l1, size_t *l2)
 {
-	__m512d xreg;
-	__m512d yreg;
-	__m512d preg;
-	__m512d sreg = _mm512_set1_pd(0);
-	__m256i vindex;
-	__mmask8 mask;
-	int i;
-	int cutoff = n % DOUBLE_PER_M512_REG;
-
-	if (cutoff > 0) {
-		mask = _mm512_set_mask_epi32(cutoff - 1);
-		vindex = _mm256_maskz_loadu_epi32(mask, xindices);
-		yreg = _mm512_maskz_loadu_pd(mask, y);
-		xreg = _mm512_mask_i32gather_pd(sreg, mask, vindex, x, 8);
-
-		preg = _mm512_mul_pd(xreg, yreg);
-		sreg = _mm512_add_pd(sreg, preg);
-	}
+	*l1 = copy2d_l1;
+	*l2 = copy2d_l2;
+}
 
-	for (i = cutoff; i < n; i += DOUBLE_PER_M512_REG) {
-		vindex = _mm256_loadu_epi32(xindices + i);
-		yreg = _mm512_loadu_pd(y + i);
-		xreg = _mm512_i32gather_pd(vindex, x, 8);
+void iu_set_copy2d_cache(size_t l1, size_t l2)
+{
+	copy2d_l1 = l1 > 0 ? l1 : default_copy2d_cache(1);
+	copy2d_l2 = l2 > 0 ? l2 : default_copy2d_cache(2);
+}
 
-		preg = _mm512_mul_pd(xreg, yreg);
-		sreg = _mm512_add_pd(sreg, preg);
+// Positions and lines of an iind by jind copy in the given order: a
+// column-major source is read along iind within the columns in jind, and a
+// row-major one along jind within the rows in iind. The output is laid out
+// the same way.
+static int copy2d_lines(char order, const int *iind, const int *jind, int numi, int numj, const int **pos, const int **lines, int *npos, int *nlines)
+{
+	if (order == COLUMN_MAJOR_ORDER) {
+		*pos = iind;
+		*lines = jind;
+		*npos = numi;
+		*nlines = numj;
+	} else if (order == ROW_MAJOR_ORDER) {
+		*pos = jind;
+		*lines = iind;
+		*npos = numj;
+		*nlines = numi;
+	} else {
+		return -1;
 	}
 
-	return _mm512_register_sum_pd(sreg);
+	return 0;
 }
 
-double _mm512_ddot_indexed2(const double *x, const int *xindices, const double *y, const int *yindices, int n)
+// Rows and columns per tile for a numi by numj copy whose row indices are
+// elsize bytes, capped at the extent. Strategies other than COPY2D_TILED
+// copy the whole extent as one tile.
+static void copy2d_tile_64(size_t numi, size_t numj, size_t elsize, size_t *ti, size_t *tj)
 {
-	__m512d xreg;
-	__m512d yreg;
-	__m512d preg;
-	__m512d sreg = _mm512_set1_pd(0);
-	__m256i xind;
-	__m256i yind;
-	__mmask8 mask;
-	int i;
-	int cutoff = n % DOUBLE_PER_M512_REG;
-
-	if (cutoff > 0) {
-		mask = _mm512_set_mask_epi32(cutoff - 1);
-
-		xind = _mm256_maskz_loadu_epi32(mask, xindices);
-		yind = _mm256_maskz_loadu_epi32(mask, yindices);
-
-		xreg = _mm512_mask_i32gather_pd(sreg, mask, xind, x, 8);
-		yreg = _mm512_mask_i32gather_pd(sreg, mask, yind, y, 8);
+	size_t rows, cols;
 
-		preg = _mm512_mul_pd(xreg, yreg);
-		sreg = _mm512_add_pd(sreg, preg);
+	if (copy2d_strategy != COPY2D_TILED) {
+		*ti = numi;
+		*tj = numj;
+		return;
 	}
 
-	for (i = cutoff; i < n; i += DOUBLE_PER_M512_REG) {
-		xind = _mm256_loadu_epi32(xindices + i);
-		yind = _mm256_loadu_epi32(xindices + i);
-
-		xreg = _mm512_i32gather_pd(xind, x, 8);
-		yreg = _mm512_i32gather_pd(yind, y, 8);
-
-		preg = _mm512_mul_pd(xreg, yreg);
-		sreg = _mm512_add_pd(sreg, preg);
-	}
+	rows = copy2d_l1 / COPY2D_L1_DIVISOR / elsize / COPY2D_TILE_ALIGN * COPY2D_TILE_ALIGN;
+	rows = rows > 0 ? rows : COPY2D_TILE_ALIGN;
+	cols = copy2d_l2 / COPY2D_L2_DIVISOR / elsize / rows;
+	cols = cols > 0 ? cols : 1;
 
-	return _mm512_register_sum_pd(sreg);
+	*ti = rows < numi ? rows : numi;
+	*tj = cols < numj ? cols : numj;
 }
-#endif
 
-float _mm_register_sum_ps(__m128 vreg)
+static void copy2d_tile(int numi, int numj, size_t elsize, int *ti, int *tj)
 {
-	vreg = _mm_hadd_ps(vreg, vreg);
-    vreg = _mm_permute_ps(vreg, 0xd8); // Swap positions 1 and 2: 0xd8 = 0b 1101 1000 = 0b 11 01 10 00
-    vreg = _mm_hadd_ps(vreg, vreg);
-
-	vreg = _mm_hadd_ps(vreg, vreg);
+	size_t rows, cols;
 
-	return _mm_cvtss_f32(vreg);
+	copy2d_tile_64((size_t)numi, (size_t)numj, elsize, &rows, &cols);
+	*ti = (int)rows;
+	*tj = (int)cols;
 }
 
-double _mm_register_sum_pd(__m128d vreg)
+// End of the tile of rows starting at i0.
+static inline size_t copy2d_tile_end(size_t i0, size_t icutoff, size_t ti, size_t numi)
 {
-	vreg = _mm_hadd_pd(vreg, vreg);
+	size_t i1 = i0 + ti + (i0 == 0 ? icutoff : 0);
 
-	return _mm_cvtsd_f64(vreg);
+	return i1 < numi ? i1 : numi;
 }
 
-float _mm256_register_sum_ps(__m256 vreg)
+//----------------------------------------------------------------------------
+// Functions for setting values of arrays.
+//----------------------------------------------------------------------------
+
+void _mm_sset_value(float *x, int n, float value)
 {
-	__m256i idx = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+	int k;
+	int cutoff = n % FLOAT_PER_M128_REG;
+	__m128 vreg = _mm_set1_ps(value);
 
-	vreg = _mm256_hadd_ps(vreg, vreg);
-	vreg = _mm256_hadd_ps(vreg, vreg);
-	vreg = _mm256_permutevar8x32_ps(vreg, idx);
-	vreg = _mm256_hadd_ps(vreg, vreg);
+	for (k = 0; k < cutoff; k++) {
+		x[k] = value;
+	}
 
-	return _mm256_cvtss_f32(vreg);
+	for (k = cutoff; k < n; k += FLOAT_PER_M128_REG) {
+		_mm_storeu_ps(x + k, vreg);
+	}
 }
 
-double _mm256_register_sum_pd(__m256d vreg)
+void _mm_dset_value(double *x, int n, double value)
 {
-	vreg = _mm256_hadd_pd(vreg, vreg);
-    vreg = _mm256_permute4x64_pd(vreg, 0xd8); // Swap positions 1 and 2:
-                                              // 0xd8 = 0b 1101 1000 = 0b 11 01 10 00 
-	vreg = _mm256_hadd_pd(vreg, vreg);
+	int k;
+	int cutoff = n % DOUBLE_PER_M128_REG;
+	__m128d vreg = _mm_set1_pd(value);
 
-	return _mm256_cvtsd_f64(vreg);
+	if (cutoff > 0) {
+		_mm_store_sd(x, vreg);
+	}
+
+	for (k = cutoff; k < n; k += DOUBLE_PER_M128_REG) {
+		_mm_storeu_pd(x + k, vreg);
+	}
 }
 
-int _mm_count_nonzero_ps(__m128 a)
+TARGET_AVX2
+void _mm256_sset_value(float *x, int n, float value)
 {
-	int cmask = _mm_movemask_ps(a);
+	int k;
+	int cutoff = n % FLOAT_PER_M256_REG;
+	__m256 vreg = _mm256_set1_ps(value);
+	__m256i mask;
 
-	return _popcnt32(cmask);
-}
+	if (use_stream(x, (size_t)n * sizeof(float), sizeof(float))) {
+		stream_sset_value256(x, n, vreg);
+		return;
+	}
 
-int _mm_count_nonzero_pd(__m128d a)
-{
-	int cmask = _mm_movemask_pd(a);
+	if (cutoff > 0) {
+		mask = _mm256_set_mask_epi32(cutoff - 1);
+		_mm256_maskstore_ps(x, mask, vreg);
+	}
 
-	return _popcnt32(cmask);
+	for (k = cutoff; k < n; k += FLOAT_PER_M256_REG) {
+		_mm256_storeu_ps(x + k, vreg);
+	}
 }
 
-int _mm256_count_nonzero_ps(__m256 a)
+TARGET_AVX2
+void _mm256_dset_value(double *x, int n, double value)
 {
-	int cmask = _mm256_movemask_ps(a);
+	int k;
+	int cutoff = n % DOUBLE_PER_M256_REG;
+	__m256d vreg = _mm256_set1_pd(value);
+	__m256i mask;
 
-	return _popcnt32(cmask);
-}
+	if (use_stream(x, (size_t)n * sizeof(double), sizeof(double))) {
+		stream_dset_value256(x, n, vreg);
+		return;
+	}
 
-int _mm256_count_nonzero_pd(__m256d a)
-{
-	int cmask = _mm256_movemask_pd(a);
+	if (cutoff > 0) {
+		mask = _mm256_set_mask_epi64(cutoff - 1);
+		_mm256_maskstore_pd(x, mask, vreg);
+	}
 
-	return _popcnt32(cmask);
+	for (k = cutoff; k < n; k += DOUBLE_PER_M256_REG) {
+		_mm256_storeu_pd(x + k, vreg);
+	}
 }
 
 #ifdef SUPPORTS_AVX512
-float _mm512_register_sum_ps(__m512 vreg)
+TARGET_AVX512
+void _mm512_sset_value(float *x, int n, float value)
 {
-    __m256 vlo = _mm512_extractf32x8_ps(vreg, 0);
-    __m256 vhi = _mm512_extractf32x8_ps(vreg, 1);
-	__m256i idx = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
-
-	vlo = _mm256_hadd_ps(vlo, vlo);
-	vhi = _mm256_hadd_ps(vhi, vhi);
-
-    vlo = _mm256_hadd_ps(vlo, vlo);
-    vhi = _mm256_hadd_ps(vhi, vhi);
+	int k;
+	int cutoff = n % FLOAT_PER_M512_REG;
+	__m512 vreg = _mm512_set1_ps(value);
+	__mmask16 mask;
 
-	vlo = _mm256_permutevar8x32_ps(vlo, idx);
-	vhi = _mm256_permutevar8x32_ps(vhi, idx);
+	if (use_stream(x, (size_t)n * sizeof(float), sizeof(float))) {
+		stream_sset_value512(x, n, vreg);
+		return;
+	}
 
-    vlo = _mm256_hadd_ps(vlo, vlo);
-    vhi = _mm256_hadd_ps(vhi, vhi); 
+	if (cutoff > 0) {
+		mask = _mm512_set_mask_epi32(cutoff - 1);
+		_mm512_mask_storeu_ps(x, mask, vreg);
+	}
 
-    return _mm256_cvtss_f32(vlo) + _mm256_cvtss_f32(vhi);
+	for (k = cutoff; k < n; k += FLOAT_PER_M512_REG) {
+		_mm512_storeu_ps(x + k, vreg);
+	}
 }
 
+TARGET_AVX512
+void _mm512_dset_value(double *x, int n, double value)
+{
+	int k;
+	int cutoff = n % DOUBLE_PER_M512_REG;
+	__m512d vreg = _mm512_set1_pd(value);
+	__mmask8 mask;
+
+	if (use_stream(x, (size_t)n * sizeof(double), sizeof(double))) {
+		stream_dset_value512(x, n, vreg);
+		return;
+	}
+
+	if (cutoff > 0) {
+		mask = _mm512_set_mask_epi64(cutoff - 1);
+		_mm512_mask_storeu_pd(x, mask, vreg);
+	}
+
+	for (k = cutoff; k < n; k += DOUBLE_PER_M512_REG) {
+		_mm512_storeu_pd(x + k, vreg);
+	}
+}
+#endif
+
+//----------------------------------------------------------------------------
+// Functions for computing sums of elements in registers.
+//----------------------------------------------------------------------------
+
+float _mm_fdot(const float *x, const float *y, int n)
+{
+	__m128 xreg;
+	__m128 yreg;
+	__m128 preg;
+	__m128 sreg = _mm_set1_ps(0);
+	int i;
+	int cutoff = n % FLOAT_PER_M128_REG;
+
+	if (cutoff > 0) {
+		xreg = load_partial_ps(x, cutoff);
+		yreg = load_partial_ps(y, cutoff);
+		preg = _mm_mul_ps(xreg, yreg);
+		sreg = _mm_add_ps(sreg, preg);
+	}
+
+	for (i = cutoff; i < n; i += FLOAT_PER_M128_REG) {
+		xreg = _mm_loadu_ps(x + i);
+		yreg = _mm_loadu_ps(y + i);
+		preg = _mm_mul_ps(xreg, yreg);
+		sreg = _mm_add_ps(sreg, preg);
+	}
+
+	return _mm_register_sum_ps(sreg);
+}
+
+float _mm_fdot_indexed(const float *x, const int *xindices, const float *y, int n)
+{
+	__m128 xreg;
+	__m128 yreg;
+	__m128 preg;
+	__m128 sreg = _mm_set1_ps(0);
+	int i;
+	int cutoff = n % FLOAT_PER_M128_REG;
+
+	if (cutoff > 0) {
+		xreg = gather_partial_ps(x, xindices, cutoff);
+		yreg = load_partial_ps(y, cutoff);
+		preg = _mm_mul_ps(xreg, yreg);
+		sreg = _mm_add_ps(sreg, preg);
+	}
+
+	for (i = cutoff; i < n; i += FLOAT_PER_M128_REG) {
+		xreg = gather_ps(x, xindices + i);
+		yreg = _mm_loadu_ps(y + i);
+		preg = _mm_mul_ps(xreg, yreg);
+		sreg = _mm_add_ps(sreg, preg);
+	}
+
+	return _mm_register_sum_ps(sreg);
+}
+
+float _mm_fdot_indexed2(const float *x, const int *xindices, const float *y, const int *yindices, int n)
+{
+	__m128 xreg;
+	__m128 yreg;
+	__m128 preg;
+	__m128 sreg = _mm_set1_ps(0);
+	int i;
+	int cutoff = n % FLOAT_PER_M128_REG;
+
+	if (cutoff > 0) {
+		xreg = gather_partial_ps(x, xindices, cutoff);
+		yreg = gather_partial_ps(y, yindices, cutoff);
+		preg = _mm_mul_ps(xreg, yreg);
+		sreg = _mm_add_ps(sreg, preg);
+	}
+
+	for (i = cutoff; i < n; i += FLOAT_PER_M128_REG) {
+		xreg = gather_ps(x, xindices + i);
+		yreg = gather_ps(y, yindices + i);
+		preg = _mm_mul_ps(xreg, yreg);
+		sreg = _mm_add_ps(sreg, preg);
+	}
+
+	return _mm_register_sum_ps(sreg);
+}
+
+double _mm_ddot(const double *x, const double *y, int n)
+{
+	__m128d xreg;
+	__m128d yreg;
+	__m128d preg;
+	__m128d sreg = _mm_set1_pd(0);
+	int i;
+	int cutoff = n % DOUBLE_PER_M128_REG;
+
+	if (cutoff > 0) {
+		xreg = _mm_load_sd(x);
+		yreg = _mm_load_sd(y);
+		preg = _mm_mul_pd(xreg, yreg);
+		sreg = _mm_add_pd(sreg, preg);
+	}
+
+	for (i = cutoff; i < n; i += DOUBLE_PER_M128_REG) {
+		xreg = _mm_loadu_pd(x + i);
+		yreg = _mm_loadu_pd(y + i);
+		preg = _mm_mul_pd(xreg, yreg);
+		sreg = _mm_add_pd(sreg, preg);
+	}
+
+	return _mm_register_sum_pd(sreg);
+}
+
+double _mm_ddot_indexed(const double *x, const int *xindices, const double *y, int n)
+{
+	__m128d xreg;
+	__m128d yreg;
+	__m128d preg;
+	__m128d sreg = _mm_set1_pd(0);
+	int i;
+	int cutoff = n % DOUBLE_PER_M128_REG;
+
+	if (cutoff > 0) {
+		xreg = _mm_load_sd(x + xindices[0]);
+		yreg = _mm_load_sd(y);
+		preg = _mm_mul_pd(xreg, yreg);
+		sreg = _mm_add_pd(sreg, preg);
+	}
+
+	for (i = cutoff; i < n; i += DOUBLE_PER_M128_REG) {
+		xreg = gather_pd(x, xindices + i);
+		yreg = _mm_loadu_pd(y + i);
+		preg = _mm_mul_pd(xreg, yreg);
+		sreg = _mm_add_pd(sreg, preg);
+	}
+
+	return _mm_register_sum_pd(sreg);
+}
+
+double _mm_ddot_indexed2(const double *x, const int *xindices, const double *y, const int *yindices, int n)
+{
+	__m128d xreg;
+	__m128d yreg;
+	__m128d preg;
+	__m128d sreg = _mm_set1_pd(0);
+	int i;
+	int cutoff = n % DOUBLE_PER_M128_REG;
+
+	if (cutoff > 0) {
+		xreg = _mm_load_sd(x + xindices[0]);
+		yreg = _mm_load_sd(y + yindices[0]);
+		preg = _mm_mul_pd(xreg, yreg);
+		sreg = _mm_add_pd(sreg, preg);
+	}
+
+	for (i = cutoff; i < n; i += DOUBLE_PER_M128_REG) {
+		xreg = gather_pd(x, xindices + i);
+		yreg = gather_pd(y, yindices + i);
+		preg = _mm_mul_pd(xreg, yreg);
+		sreg = _mm_add_pd(sreg, preg);
+	}
+
+	return _mm_register_sum_pd(sreg);
+}
+
+TARGET_AVX2
+float _mm256_fdot(const float *x, const float *y, int n)
+{
+	__m256 xreg;
+	__m256 yreg;
+	__m256 preg;
+	__m256 sreg = _mm256_set1_ps(0);
+	__m256i mask;
+	int i;
+	int cutoff = n % FLOAT_PER_M256_REG;
+#ifdef SUPPORTS_FMA
+	__m256 sreg1 = _mm256_set1_ps(0);
+	__m256 sreg2 = _mm256_set1_ps(0);
+	__m256 sreg3 = _mm256_set1_ps(0);
+#endif
+
+	if (cutoff > 0) {
+		mask = _mm256_set_mask_epi32(cutoff - 1);
+
+		xreg = _mm256_maskload_ps(x, mask);
+		yreg = _mm256_maskload_ps(y, mask);
+		preg = _mm256_mul_ps(xreg, yreg);
+		sreg = _mm256_add_ps(sreg, preg);
+	}
+
+#ifdef SUPPORTS_FMA
+	// Spread the main loop over four independent accumulators so that each
+	// FMA does not wait on the latency of the previous one.
+	for (i = cutoff; i + 4 * FLOAT_PER_M256_REG <= n; i += 4 * FLOAT_PER_M256_REG) {
+		sreg = _mm256_fmadd_ps(_mm256_loadu_ps(x + i), _mm256_loadu_ps(y + i), sreg);
+		sreg1 = _mm256_fmadd_ps(_mm256_loadu_ps(x + i + 8), _mm256_loadu_ps(y + i + 8), sreg1);
+		sreg2 = _mm256_fmadd_ps(_mm256_loadu_ps(x + i + 16), _mm256_loadu_ps(y + i + 16), sreg2);
+		sreg3 = _mm256_fmadd_ps(_mm256_loadu_ps(x + i + 24), _mm256_loadu_ps(y + i + 24), sreg3);
+	}
+
+	for (; i < n; i += FLOAT_PER_M256_REG) {
+		xreg = _mm256_loadu_ps(x + i);
+		yreg = _mm256_loadu_ps(y + i);
+		sreg = _mm256_fmadd_ps(xreg, yreg, sreg);
+	}
+
+	sreg = _mm256_add_ps(_mm256_add_ps(sreg, sreg1), _mm256_add_ps(sreg2, sreg3));
+#else
+	for (i = cutoff; i < n; i += FLOAT_PER_M256_REG) {
+		xreg = _mm256_loadu_ps(x + i);
+		yreg = _mm256_loadu_ps(y + i);
+		preg = _mm256_mul_ps(xreg, yreg);
+		sreg = _mm256_add_ps(sreg, preg);
+	}
+#endif
+
+	return _mm256_register_sum_ps(sreg);
+}
+
+TARGET_AVX2
+float _mm256_fdot_indexed(const float *x, const int *xindices, const float *y, int n)
+{
+	__m256 xreg;
+	__m256 yreg;
+	__m256 preg;
+	__m256 sreg = _mm256_set1_ps(0);
+	__m256i vindex;
+	__m256i mask;
+	int i;
+	int cutoff = n % FLOAT_PER_M256_REG;
+
+	if (cutoff > 0) {
+		mask = _mm256_set_mask_epi32(cutoff - 1);
+		vindex = _mm256_maskload_epi32(xindices, mask);
+		yreg = _mm256_maskload_ps(y, mask);
+		xreg = _mm256_mask_i32gather_ps(sreg, x, vindex, _mm256_castsi256_ps(mask), 4);
+
+		preg = _mm256_mul_ps(xreg, yreg);
+		sreg = _mm256_add_ps(sreg, preg);
+	}
+
+	mask = _mm256_set_mask_epi32(INT32_PER_M256_REG - 1);
+
+	for (i = cutoff; i < n; i += FLOAT_PER_M256_REG) {
+		vindex = _mm256_maskload_epi32(xindices + i, mask);
+		yreg = _mm256_loadu_ps(y + i);
+		xreg = _mm256_i32gather_ps(x, vindex, 4);
+
+		preg = _mm256_mul_ps(xreg, yreg);
+		sreg = _mm256_add_ps(sreg, preg);
+	}
+
+	return _mm256_register_sum_ps(sreg);
+}
+
+TARGET_AVX2
+float _mm256_fdot_indexed2(const float *x, const int *xindices, const float *y, const int *yindices, int n)
+{
+	__m256 xreg;
+	__m256 yreg;
+	__m256 preg;
+	__m256 sreg = _mm256_set1_ps(0);
+	__m256i xindex, yindex;
+	__m256i mask;
+	int i;
+	int cutoff = n % FLOAT_PER_M256_REG;
+
+	if (cutoff > 0) {
+		mask = _mm256_set_mask_epi32(cutoff - 1);
+		xindex = _mm256_maskload_epi32(xindices, mask);
+		yindex = _mm256_maskload_epi32(yindices, mask);
+
+		xreg = _mm256_mask_i32gather_ps(sreg, x, xindex, _mm256_castsi256_ps(mask), 4);
+		yreg = _mm256_mask_i32gather_ps(sreg, y, yindex, _mm256_castsi256_ps(mask), 4);
+
+		preg = _mm256_mul_ps(xreg, yreg);
+		sreg = _mm256_add_ps(sreg, preg);
+	}
+
+	mask = _mm256_set_mask_epi32(INT32_PER_M256_REG - 1);
+
+	for (i = cutoff; i < n; i += FLOAT_PER_M256_REG) {
+		xindex = _mm256_maskload_epi32(xindices + i, mask);
+		yindex = _mm256_maskload_epi32(yindices + i, mask);
+
+		xreg = _mm256_i32gather_ps(x, xindex, 4);
+		yreg = _mm256_i32gather_ps(y, yindex, 4);
+
+		preg = _mm256_mul_ps(xreg, yreg);
+		sreg = _mm256_add_ps(sreg, preg);
+	}
+
+	return _mm256_register_sum_ps(sreg);
+}
+
+TARGET_AVX2
+double _mm256_ddot(const double *x, const double *y, int n)
+{
+	__m256d xreg;
+	__m256d yreg;
+	__m256d preg;
+	__m256d sreg = _mm256_set1_pd(0);
+	__m256i mask;
+	int i;
+	int cutoff = n % DOUBLE_PER_M256_REG;
+#ifdef SUPPORTS_FMA
+	__m256d sreg1 = _mm256_set1_pd(0);
+	__m256d sreg2 = _mm256_set1_pd(0);
+	__m256d sreg3 = _mm256_set1_pd(0);
+#endif
+
+	if (cutoff > 0) {
+		mask = _mm256_set_mask_epi64(cutoff - 1);
+
+		xreg = _mm256_maskload_pd(x, mask);
+		yreg = _mm256_maskload_pd(y, mask);
+		preg = _mm256_mul_pd(xreg, yreg);
+		sreg = _mm256_add_pd(sreg, preg);
+	}
+
+#ifdef SUPPORTS_FMA
+	for (i = cutoff; i + 4 * DOUBLE_PER_M256_REG <= n; i += 4 * DOUBLE_PER_M256_REG) {
+		sreg = _mm256_fmadd_pd(_mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i), sreg);
+		sreg1 = _mm256_fmadd_pd(_mm256_loadu_pd(x + i + 4), _mm256_loadu_pd(y + i + 4), sreg1);
+		sreg2 = _mm256_fmadd_pd(_mm256_loadu_pd(x + i + 8), _mm256_loadu_pd(y + i + 8), sreg2);
+		sreg3 = _mm256_fmadd_pd(_mm256_loadu_pd(x + i + 12), _mm256_loadu_pd(y + i + 12), sreg3);
+	}
+
+	for (; i < n; i += DOUBLE_PER_M256_REG) {
+		xreg = _mm256_loadu_pd(x + i);
+		yreg = _mm256_loadu_pd(y + i);
+		sreg = _mm256_fmadd_pd(xreg, yreg, sreg);
+	}
+
+	sreg = _mm256_add_pd(_mm256_add_pd(sreg, sreg1), _mm256_add_pd(sreg2, sreg3));
+#else
+	for (i = cutoff; i < n; i += DOUBLE_PER_M256_REG) {
+		xreg = _mm256_loadu_pd(x + i);
+		yreg = _mm256_loadu_pd(y + i);
+		preg = _mm256_mul_pd(xreg, yreg);
+		sreg = _mm256_add_pd(sreg, preg);
+	}
+#endif
+
+	return _mm256_register_sum_pd(sreg);
+}
+
+TARGET_AVX2
+double _mm256_ddot_indexed(const double *x, const int *xindices, const double *y, int n)
+{
+	__m256d xreg;
+	__m256d yreg;
+	__m256d preg;
+	__m256d sreg = _mm256_set1_pd(0);
+	__m128i vindex;
+	__m256i mask;
+	__m256d dmask;
+	__m128i mask128;
+	int i;
+	int cutoff = n % DOUBLE_PER_M256_REG;
+
+	if (cutoff > 0) {
+		mask = _mm256_set_mask_epi64(cutoff - 1);
+		dmask = _mm256_castsi256_pd(mask);
+		mask128 = _mm_set_mask_epi32(cutoff - 1);
+
+		vindex = _mm_maskload_epi32(xindices, mask128);
+		xreg = _mm256_mask_i32gather_pd(sreg, x, vindex, dmask, 8);
+		yreg = _mm256_maskload_pd(y, mask);
+
+		preg = _mm256_mul_pd(xreg, yreg);
+		sreg = _mm256_add_pd(sreg, preg);
+	}
+
+	for (i = cutoff; i < n; i += DOUBLE_PER_M256_REG) {
+		vindex = _mm_loadu_si128((const __m128i *)(xindices + i));
+		yreg = _mm256_loadu_pd(y + i);
+		xreg = _mm256_i32gather_pd(x, vindex, 8);
+
+		preg = _mm256_mul_pd(xreg, yreg);
+		sreg = _mm256_add_pd(sreg, preg);
+	}
+
+	return _mm256_register_sum_pd(sreg);
+}
+
+TARGET_AVX2
+double _mm256_ddot_indexed2(const double *x, const int *xindices, const double *y, const int *yindices, int n)
+{
+	__m256d xreg;
+	__m256d yreg;
+	__m256d preg;
+	__m256d sreg = _mm256_set1_pd(0);
+	__m128i xindex, yindex;
+	__m256i mask;
+	__m256d dmask;
+	__m128i mask128;
+	int i;
+	int cutoff = n % DOUBLE_PER_M256_REG;
+
+	if (cutoff > 0) {
+		mask = _mm256_set_mask_epi64(cutoff - 1);
+		dmask = _mm256_castsi256_pd(mask);
+		mask128 = _mm_set_mask_epi32(cutoff - 1);
+
+		xindex = _mm_maskload_epi32(xindices, mask128);
+		yindex = _mm_maskload_epi32(yindices, mask128);
+
+		xreg = _mm256_mask_i32gather_pd(sreg, x, xindex, dmask, 8);
+		yreg = _mm256_mask_i32gather_pd(sreg, y, yindex, dmask, 8);
+
+		preg = _mm256_mul_pd(xreg, yreg);
+		sreg = _mm256_add_pd(sreg, preg);
+	}
+
+	for (i = cutoff; i < n; i += DOUBLE_PER_M256_REG) {
+		xindex = _mm_loadu_si128((const __m128i *)(xindices + i));
+		yindex = _mm_loadu_si128((const __m128i *)(yindices + i));
+
+		xreg = _mm256_i32gather_pd(x, xindex, 8);
+		yreg = _mm256_i32gather_pd(y, yindex, 8);
+
+		preg = _mm256_mul_pd(xreg, yreg);
+		sreg = _mm256_add_pd(sreg, preg);
+	}
+
+	return _mm256_register_sum_pd(sreg);
+}
+
+
+#ifdef SUPPORTS_AVX512
+TARGET_AVX512
+float _mm512_fdot(const float *x, const float *y, int n)
+{
+	__m512 xreg;
+	__m512 yreg;
+	__m512 preg;
+	__m512 sreg = _mm512_set1_ps(0);
+	__m512 sreg1 = _mm512_set1_ps(0);
+	__m512 sreg2 = _mm512_set1_ps(0);
+	__m512 sreg3 = _mm512_set1_ps(0);
+	__mmask16 mask;
+
+	int i;
+	int cutoff = n % FLOAT_PER_M512_REG;
+
+	if (cutoff > 0) {
+		mask = _mm512_set_mask_epi32(cutoff - 1);
+
+		xreg = _mm512_maskz_loadu_ps(mask, x);
+		yreg = _mm512_maskz_loadu_ps(mask, y);
+		preg = _mm512_mul_ps(xreg, yreg);
+		sreg = _mm512_add_ps(sreg, preg);
+	}
+
+	// AVX512F always provides FMA, so the main loop keeps four independent
+	// accumulators unconditionally.
+	for (i = cutoff; i + 4 * FLOAT_PER_M512_REG <= n; i += 4 * FLOAT_PER_M512_REG) {
+		sreg = _mm512_fmadd_ps(_mm512_loadu_ps(x + i), _mm512_loadu_ps(y + i), sreg);
+		sreg1 = _mm512_fmadd_ps(_mm512_loadu_ps(x + i + 16), _mm512_loadu_ps(y + i + 16), sreg1);
+		sreg2 = _mm512_fmadd_ps(_mm512_loadu_ps(x + i + 32), _mm512_loadu_ps(y + i + 32), sreg2);
+		sreg3 = _mm512_fmadd_ps(_mm512_loadu_ps(x + i + 48), _mm512_loadu_ps(y + i + 48), sreg3);
+	}
+
+	for (; i < n; i += FLOAT_PER_M512_REG) {
+		xreg = _mm512_loadu_ps(x + i);
+		yreg = _mm512_loadu_ps(y + i);
+		sreg = _mm512_fmadd_ps(xreg, yreg, sreg);
+	}
+
+	sreg = _mm512_add_ps(_mm512_add_ps(sreg, sreg1), _mm512_add_ps(sreg2, sreg3));
+
+	return _mm512_register_sum_ps(sreg);
+}
+
+TARGET_AVX512
+float _mm512_fdot_indexed(const float *x, const int *xindices, const float *y, int n)
+{
+	__m512 xreg;
+	__m512 yreg;
+	__m512 sreg = _mm512_set1_ps(0);
+	__m512i vindex;
+	__mmask16 mask;
+	int i;
+	int cutoff = n % FLOAT_PER_M512_REG;
+
+	if (cutoff > 0) {
+		mask = _mm512_set_mask_epi32(cutoff - 1);
+		vindex = _mm512_maskz_loadu_epi32(mask, xindices);
+		yreg = _mm512_maskz_loadu_ps(mask, y);
+		xreg = _mm512_mask_i32gather_ps(sreg, mask, vindex, x, 4);
+
+		sreg = _mm512_fmadd_ps(xreg, yreg, sreg);
+	}
+
+	for (i = cutoff; i < n; i += FLOAT_PER_M512_REG) {
+		vindex = _mm512_loadu_epi32(xindices + i);
+		yreg = _mm512_loadu_ps(y + i);
+		xreg = _mm512_i32gather_ps(vindex, x, 4);
+
+		sreg = _mm512_fmadd_ps(xreg, yreg, sreg);
+	}
+
+	return _mm512_register_sum_ps(sreg);
+}
+
+TARGET_AVX512
+float _mm512_fdot_indexed2(const float *x, const int *xindices, const float *y, const int *yindices, int n)
+{
+	__m512 xreg;
+	__m512 yreg;
+	__m512 sreg = _mm512_set1_ps(0);
+	__m512i xind;
+	__m512i yind;
+	__mmask16 mask;
+	int i;
+	int cutoff = n % FLOAT_PER_M512_REG;
+
+	if (cutoff > 0) {
+		mask = _mm512_set_mask_epi32(cutoff - 1);
+
+		xind = _mm512_maskz_loadu_epi32(mask, xindices);
+		yind = _mm512_maskz_loadu_epi32(mask, yindices);
+
+		xreg = _mm512_mask_i32gather_ps(sreg, mask, xind, x, 4);
+		yreg = _mm512_mask_i32gather_ps(sreg, mask, yind, y, 4);
+
+		sreg = _mm512_fmadd_ps(xreg, yreg, sreg);
+	}
+
+	for (i = cutoff; i < n; i += FLOAT_PER_M512_REG) {
+		xind = _mm512_loadu_epi32(xindices + i);
+		yind = _mm512_loadu_epi32(yindices + i);
+
+		xreg = _mm512_i32gather_ps(xind, x, 4);
+		yreg = _mm512_i32gather_ps(yind, y, 4);
+
+		sreg = _mm512_fmadd_ps(xreg, yreg, sreg);
+	}
+
+	return _mm512_register_sum_ps(sreg);
+}
+
+TARGET_AVX512
+double _mm512_ddot(const double *x, const double *y, int n)
+{
+	__m512d xreg;
+	__m512d yreg;
+	__m512d preg;
+	__m512d sreg = _mm512_set1_pd(0);
+	__m512d sreg1 = _mm512_set1_pd(0);
+	__m512d sreg2 = _mm512_set1_pd(0);
+	__m512d sreg3 = _mm512_set1_pd(0);
+	__mmask8 mask;
+
+	int i;
+	int cutoff = n % DOUBLE_PER_M512_REG;
+
+	if (cutoff > 0) {
+		mask = _mm512_set_mask_epi64(cutoff - 1);
+
+		xreg = _mm512_maskz_loadu_pd(mask, x);
+		yreg = _mm512_maskz_loadu_pd(mask, y);
+		preg = _mm512_mul_pd(xreg, yreg);
+		sreg = _mm512_add_pd(sreg, preg);
+	}
+
+	for (i = cutoff; i + 4 * DOUBLE_PER_M512_REG <= n; i += 4 * DOUBLE_PER_M512_REG) {
+		sreg = _mm512_fmadd_pd(_mm512_loadu_pd(x + i), _mm512_loadu_pd(y + i), sreg);
+		sreg1 = _mm512_fmadd_pd(_mm512_loadu_pd(x + i + 8), _mm512_loadu_pd(y + i + 8), sreg1);
+		sreg2 = _mm512_fmadd_pd(_mm512_loadu_pd(x + i + 16), _mm512_loadu_pd(y + i + 16), sreg2);
+		sreg3 = _mm512_fmadd_pd(_mm512_loadu_pd(x + i + 24), _mm512_loadu_pd(y + i + 24), sreg3);
+	}
+
+	for (; i < n; i += DOUBLE_PER_M512_REG) {
+		xreg = _mm512_loadu_pd(x + i);
+		yreg = _mm512_loadu_pd(y + i);
+		sreg = _mm512_fmadd_pd(xreg, yreg, sreg);
+	}
+
+	sreg = _mm512_add_pd(_mm512_add_pd(sreg, sreg1), _mm512_add_pd(sreg2, sreg3));
+
+	return _mm512_register_sum_pd(sreg);
+}
+
+TARGET_AVX512
+double _mm512_ddot_indexed(const double *x, const int *xindices, const double *y, int n)
+{
+	__m512d xreg;
+	__m512d yreg;
+	__m512d sreg = _mm512_set1_pd(0);
+	__m256i vindex;
+	__mmask8 mask;
+	int i;
+	int cutoff = n % DOUBLE_PER_M512_REG;
+
+	if (cutoff > 0) {
+		mask = _mm512_set_mask_epi64(cutoff - 1);
+		vindex = _mm512_castsi512_si256(_mm512_maskz_loadu_epi32(mask, xindices));
+		yreg = _mm512_maskz_loadu_pd(mask, y);
+		xreg = _mm512_mask_i32gather_pd(sreg, mask, vindex, x, 8);
+
+		sreg = _mm512_fmadd_pd(xreg, yreg, sreg);
+	}
+
+	for (i = cutoff; i < n; i += DOUBLE_PER_M512_REG) {
+		vindex = _mm256_loadu_si256((const __m256i *)(xindices + i));
+		yreg = _mm512_loadu_pd(y + i);
+		xreg = _mm512_i32gather_pd(vindex, x, 8);
+
+		sreg = _mm512_fmadd_pd(xreg, yreg, sreg);
+	}
+
+	return _mm512_register_sum_pd(sreg);
+}
+
+TARGET_AVX512
+double _mm512_ddot_indexed2(const double *x, const int *xindices, const double *y, const int *yindices, int n)
+{
+	__m512d xreg;
+	__m512d yreg;
+	__m512d sreg = _mm512_set1_pd(0);
+	__m256i xind;
+	__m256i yind;
+	__mmask8 mask;
+	int i;
+	int cutoff = n % DOUBLE_PER_M512_REG;
+
+	if (cutoff > 0) {
+		mask = _mm512_set_mask_epi64(cutoff - 1);
+
+		xind = _mm512_castsi512_si256(_mm512_maskz_loadu_epi32(mask, xindices));
+		yind = _mm512_castsi512_si256(_mm512_maskz_loadu_epi32(mask, yindices));
+
+		xreg = _mm512_mask_i32gather_pd(sreg, mask, xind, x, 8);
+		yreg = _mm512_mask_i32gather_pd(sreg, mask, yind, y, 8);
+
+		sreg = _mm512_fmadd_pd(xreg, yreg, sreg);
+	}
+
+	for (i = cutoff; i < n; i += DOUBLE_PER_M512_REG) {
+		xind = _mm256_loadu_si256((const __m256i *)(xindices + i));
+		yind = _mm256_loadu_si256((const __m256i *)(yindices + i));
+
+		xreg = _mm512_i32gather_pd(xind, x, 8);
+		yreg = _mm512_i32gather_pd(yind, y, 8);
+
+		sreg = _mm512_fmadd_pd(xreg, yreg, sreg);
+	}
+
+	return _mm512_register_sum_pd(sreg);
+}
+#endif
+
+float _mm_register_sum_ps(__m128 vreg)
+{
+	vreg = _mm_hadd_ps(vreg, vreg);
+	vreg = _mm_hadd_ps(vreg, vreg);
+
+	return _mm_cvtss_f32(vreg);
+}
+
+double _mm_register_sum_pd(__m128d vreg)
+{
+	vreg = _mm_hadd_pd(vreg, vreg);
+
+	return _mm_cvtsd_f64(vreg);
+}
+
+TARGET_AVX2
+float _mm256_register_sum_ps(__m256 vreg)
+{
+	__m256i idx = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+
+	vreg = _mm256_hadd_ps(vreg, vreg);
+	vreg = _mm256_hadd_ps(vreg, vreg);
+	vreg = _mm256_permutevar8x32_ps(vreg, idx);
+	vreg = _mm256_hadd_ps(vreg, vreg);
+
+	return _mm256_cvtss_f32(vreg);
+}
+
+TARGET_AVX2
+double _mm256_register_sum_pd(__m256d vreg)
+{
+	vreg = _mm256_hadd_pd(vreg, vreg);
+    vreg = _mm256_permute4x64_pd(vreg, 0xd8); // Swap positions 1 and 2:
+                                              // 0xd8 = 0b 1101 1000 = 0b 11 01 10 00 
+	vreg = _mm256_hadd_pd(vreg, vreg);
+
+	return _mm256_cvtsd_f64(vreg);
+}
+
+int _mm_count_nonzero_ps(__m128 a)
+{
+	int cmask = _mm_movemask_ps(a);
+
+	return _popcnt32(cmask);
+}
+
+int _mm_count_nonzero_pd(__m128d a)
+{
+	int cmask = _mm_movemask_pd(a);
+
+	return _popcnt32(cmask);
+}
+
+TARGET_AVX2
+int _mm256_count_nonzero_ps(__m256 a)
+{
+	int cmask = _mm256_movemask_ps(a);
+
+	return _popcnt32(cmask);
+}
+
+TARGET_AVX2
+int _mm256_count_nonzero_pd(__m256d a)
+{
+	int cmask = _mm256_movemask_pd(a);
+
+	return _popcnt32(cmask);
+}
+
+#ifdef SUPPORTS_AVX512
+TARGET_AVX512
+float _mm512_register_sum_ps(__m512 vreg)
+{
+    __m256 vlo = _mm512_extractf32x8_ps(vreg, 0);
+    __m256 vhi = _mm512_extractf32x8_ps(vreg, 1);
+	__m256i idx = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+
+	vlo = _mm256_hadd_ps(vlo, vlo);
+	vhi = _mm256_hadd_ps(vhi, vhi);
+
+    vlo = _mm256_hadd_ps(vlo, vlo);
+    vhi = _mm256_hadd_ps(vhi, vhi);
+
+	vlo = _mm256_permutevar8x32_ps(vlo, idx);
+	vhi = _mm256_permutevar8x32_ps(vhi, idx);
+
+    vlo = _mm256_hadd_ps(vlo, vlo);
+    vhi = _mm256_hadd_ps(vhi, vhi); 
+
+    return _mm256_cvtss_f32(vlo) + _mm256_cvtss_f32(vhi);
+}
+
+TARGET_AVX512
 double _mm512_register_sum_pd(__m512d vreg)
 {
-    __m256d vlo = _mm512_extractf64x4_pd(vreg, 0);
-    __m256d vhi = _mm512_extractf64x4_pd(vreg, 1);
+    __m256d vlo = _mm512_extractf64x4_pd(vreg, 0);
+    __m256d vhi = _mm512_extractf64x4_pd(vreg, 1);
+
+	vlo = _mm256_hadd_pd(vlo, vlo);
+	vhi = _mm256_hadd_pd(vhi, vhi);
+
+    // Swap positions 1 and 2: 0xd8 = 0b 1101 1000 = 0b 11 01 10 00
+	vlo = _mm256_permute4x64_pd(vlo, 0xd8);
+	vhi = _mm256_permute4x64_pd(vhi, 0xd8);
+
+    vlo = _mm256_hadd_pd(vlo, vlo);
+    vhi = _mm256_hadd_pd(vhi, vhi);
+
+    return _mm256_cvtsd_f64(vlo) + _mm256_cvtsd_f64(vhi); 
+}
+
+TARGET_AVX512
+int _mm512_count_nonzero_ps(__m512 vreg)
+{
+    __m256 vlo = _mm512_extractf32x8_ps(vreg, 0);
+    __m256 vhi = _mm512_extractf32x8_ps(vreg, 1);
+	int clo = _mm256_movemask_ps(vlo);
+	int chi = _mm256_movemask_ps(vhi);
+
+    return _popcnt32(clo) + _popcnt32(chi);
+}
+
+TARGET_AVX512
+int _mm512_count_nonzero_pd(__m512d vreg)
+{
+    __m256d vlo = _mm512_extractf64x4_pd(vreg, 0);
+    __m256d vhi = _mm512_extractf64x4_pd(vreg, 1);
+	int clo = _mm256_movemask_pd(vlo);
+	int chi = _mm256_movemask_pd(vhi);
+
+    return _popcnt32(clo) + _popcnt32(chi);
+}
+#endif
+
+//----------------------------------------------------------------------------
+// Functions for computing compensated (Kahan) dot products. Each lane keeps
+// its own running compensation, so these must not be built with
+// -ffast-math, which would fold the compensation away.
+//----------------------------------------------------------------------------
+
+TARGET_AVX2
+static inline void kahan_step_ps(__m256 *sreg, __m256 *creg, __m256 xreg, __m256 yreg)
+{
+	__m256 zreg, treg;
+
+#ifdef SUPPORTS_FMA
+	zreg = _mm256_fmsub_ps(xreg, yreg, *creg);
+#else
+	zreg = _mm256_sub_ps(_mm256_mul_ps(xreg, yreg), *creg);
+#endif
+	treg = _mm256_add_ps(*sreg, zreg);
+	*creg = _mm256_sub_ps(_mm256_sub_ps(treg, *sreg), zreg);
+	*sreg = treg;
+}
+
+TARGET_AVX2
+static inline void kahan_step_pd(__m256d *sreg, __m256d *creg, __m256d xreg, __m256d yreg)
+{
+	__m256d zreg, treg;
+
+#ifdef SUPPORTS_FMA
+	zreg = _mm256_fmsub_pd(xreg, yreg, *creg);
+#else
+	zreg = _mm256_sub_pd(_mm256_mul_pd(xreg, yreg), *creg);
+#endif
+	treg = _mm256_add_pd(*sreg, zreg);
+	*creg = _mm256_sub_pd(_mm256_sub_pd(treg, *sreg), zreg);
+	*sreg = treg;
+}
+
+// Widen the compensated lanes to double before the horizontal sum, so the
+// reduction does not give back the accuracy the loop gained.
+TARGET_AVX2
+static inline __m256d kahan_widen_ps(__m256 sreg, __m256 creg)
+{
+	__m256d slo = _mm256_cvtps_pd(_mm256_castps256_ps128(sreg));
+	__m256d shi = _mm256_cvtps_pd(_mm256_extractf128_ps(sreg, 1));
+	__m256d clo = _mm256_cvtps_pd(_mm256_castps256_ps128(creg));
+	__m256d chi = _mm256_cvtps_pd(_mm256_extractf128_ps(creg, 1));
+
+	return _mm256_sub_pd(_mm256_add_pd(slo, shi), _mm256_add_pd(clo, chi));
+}
+
+TARGET_AVX2
+float _mm256_fdot_kahan(const float *x, const float *y, int n)
+{
+	__m256 xreg;
+	__m256 yreg;
+	__m256 sreg0 = _mm256_set1_ps(0), creg0 = _mm256_set1_ps(0);
+	__m256 sreg1 = _mm256_set1_ps(0), creg1 = _mm256_set1_ps(0);
+	__m256 sreg2 = _mm256_set1_ps(0), creg2 = _mm256_set1_ps(0);
+	__m256 sreg3 = _mm256_set1_ps(0), creg3 = _mm256_set1_ps(0);
+	__m256 sreg4 = _mm256_set1_ps(0), creg4 = _mm256_set1_ps(0);
+	__m256 sreg5 = _mm256_set1_ps(0), creg5 = _mm256_set1_ps(0);
+	__m256d dreg;
+	__m256i mask;
+	int i;
+	int cutoff = n % FLOAT_PER_M256_REG;
+
+	if (cutoff > 0) {
+		mask = _mm256_set_mask_epi32(cutoff - 1);
+
+		xreg = _mm256_maskload_ps(x, mask);
+		yreg = _mm256_maskload_ps(y, mask);
+		kahan_step_ps(&sreg0, &creg0, xreg, yreg);
+	}
+
+	// Each step carries four dependent operations through the compensation,
+	// so six independent chains are needed to keep the adders busy. That
+	// uses twelve of the sixteen ymm registers.
+	for (i = cutoff; i + 6 * FLOAT_PER_M256_REG <= n; i += 6 * FLOAT_PER_M256_REG) {
+		kahan_step_ps(&sreg0, &creg0, _mm256_loadu_ps(x + i), _mm256_loadu_ps(y + i));
+		kahan_step_ps(&sreg1, &creg1, _mm256_loadu_ps(x + i + 8), _mm256_loadu_ps(y + i + 8));
+		kahan_step_ps(&sreg2, &creg2, _mm256_loadu_ps(x + i + 16), _mm256_loadu_ps(y + i + 16));
+		kahan_step_ps(&sreg3, &creg3, _mm256_loadu_ps(x + i + 24), _mm256_loadu_ps(y + i + 24));
+		kahan_step_ps(&sreg4, &creg4, _mm256_loadu_ps(x + i + 32), _mm256_loadu_ps(y + i + 32));
+		kahan_step_ps(&sreg5, &creg5, _mm256_loadu_ps(x + i + 40), _mm256_loadu_ps(y + i + 40));
+	}
+
+	for (; i < n; i += FLOAT_PER_M256_REG) {
+		xreg = _mm256_loadu_ps(x + i);
+		yreg = _mm256_loadu_ps(y + i);
+		kahan_step_ps(&sreg0, &creg0, xreg, yreg);
+	}
+
+	dreg = _mm256_add_pd(kahan_widen_ps(sreg0, creg0), kahan_widen_ps(sreg1, creg1));
+	dreg = _mm256_add_pd(dreg, kahan_widen_ps(sreg2, creg2));
+	dreg = _mm256_add_pd(dreg, kahan_widen_ps(sreg3, creg3));
+	dreg = _mm256_add_pd(dreg, kahan_widen_ps(sreg4, creg4));
+	dreg = _mm256_add_pd(dreg, kahan_widen_ps(sreg5, creg5));
+
+	return (float)_mm256_register_sum_pd(dreg);
+}
+
+TARGET_AVX2
+float _mm256_fdot_indexed_kahan(const float *x, const int *xindices, const float *y, int n)
+{
+	__m256 xreg;
+	__m256 yreg;
+	__m256 zero = _mm256_set1_ps(0);
+	__m256 sreg0 = _mm256_set1_ps(0), creg0 = _mm256_set1_ps(0);
+	__m256 sreg1 = _mm256_set1_ps(0), creg1 = _mm256_set1_ps(0);
+	__m256i vindex;
+	__m256i mask;
+	int i;
+	int cutoff = n % FLOAT_PER_M256_REG;
+
+	if (cutoff > 0) {
+		mask = _mm256_set_mask_epi32(cutoff - 1);
+		vindex = _mm256_maskload_epi32(xindices, mask);
+		yreg = _mm256_maskload_ps(y, mask);
+		xreg = _mm256_mask_i32gather_ps(zero, x, vindex, _mm256_castsi256_ps(mask), 4);
+
+		kahan_step_ps(&sreg0, &creg0, xreg, yreg);
+	}
+
+	// The gathers bound these loops, so two chains are enough.
+	for (i = cutoff; i + 2 * FLOAT_PER_M256_REG <= n; i += 2 * FLOAT_PER_M256_REG) {
+		vindex = _mm256_loadu_si256((const __m256i *)(xindices + i));
+		xreg = _mm256_i32gather_ps(x, vindex, 4);
+		kahan_step_ps(&sreg0, &creg0, xreg, _mm256_loadu_ps(y + i));
+
+		vindex = _mm256_loadu_si256((const __m256i *)(xindices + i + 8));
+		xreg = _mm256_i32gather_ps(x, vindex, 4);
+		kahan_step_ps(&sreg1, &creg1, xreg, _mm256_loadu_ps(y + i + 8));
+	}
+
+	for (; i < n; i += FLOAT_PER_M256_REG) {
+		vindex = _mm256_loadu_si256((const __m256i *)(xindices + i));
+		xreg = _mm256_i32gather_ps(x, vindex, 4);
+		kahan_step_ps(&sreg0, &creg0, xreg, _mm256_loadu_ps(y + i));
+	}
+
+	return (float)_mm256_register_sum_pd(_mm256_add_pd(kahan_widen_ps(sreg0, creg0), kahan_widen_ps(sreg1, creg1)));
+}
+
+TARGET_AVX2
+double _mm256_ddot_kahan(const double *x, const double *y, int n)
+{
+	__m256d xreg;
+	__m256d yreg;
+	__m256d sreg0 = _mm256_set1_pd(0), creg0 = _mm256_set1_pd(0);
+	__m256d sreg1 = _mm256_set1_pd(0), creg1 = _mm256_set1_pd(0);
+	__m256d sreg2 = _mm256_set1_pd(0), creg2 = _mm256_set1_pd(0);
+	__m256d sreg3 = _mm256_set1_pd(0), creg3 = _mm256_set1_pd(0);
+	__m256d sreg4 = _mm256_set1_pd(0), creg4 = _mm256_set1_pd(0);
+	__m256d sreg5 = _mm256_set1_pd(0), creg5 = _mm256_set1_pd(0);
+	__m256d sreg, creg;
+	__m256i mask;
+	int i;
+	int cutoff = n % DOUBLE_PER_M256_REG;
+
+	if (cutoff > 0) {
+		mask = _mm256_set_mask_epi64(cutoff - 1);
+
+		xreg = _mm256_maskload_pd(x, mask);
+		yreg = _mm256_maskload_pd(y, mask);
+		kahan_step_pd(&sreg0, &creg0, xreg, yreg);
+	}
+
+	for (i = cutoff; i + 6 * DOUBLE_PER_M256_REG <= n; i += 6 * DOUBLE_PER_M256_REG) {
+		kahan_step_pd(&sreg0, &creg0, _mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i));
+		kahan_step_pd(&sreg1, &creg1, _mm256_loadu_pd(x + i + 4), _mm256_loadu_pd(y + i + 4));
+		kahan_step_pd(&sreg2, &creg2, _mm256_loadu_pd(x + i + 8), _mm256_loadu_pd(y + i + 8));
+		kahan_step_pd(&sreg3, &creg3, _mm256_loadu_pd(x + i + 12), _mm256_loadu_pd(y + i + 12));
+		kahan_step_pd(&sreg4, &creg4, _mm256_loadu_pd(x + i + 16), _mm256_loadu_pd(y + i + 16));
+		kahan_step_pd(&sreg5, &creg5, _mm256_loadu_pd(x + i + 20), _mm256_loadu_pd(y + i + 20));
+	}
+
+	for (; i < n; i += DOUBLE_PER_M256_REG) {
+		xreg = _mm256_loadu_pd(x + i);
+		yreg = _mm256_loadu_pd(y + i);
+		kahan_step_pd(&sreg0, &creg0, xreg, yreg);
+	}
+
+	// Fold the chains into one, carrying each compensation along.
+	sreg = sreg0;
+	creg = creg0;
+	kahan_step_pd(&sreg, &creg, sreg1, _mm256_set1_pd(1));
+	kahan_step_pd(&sreg, &creg, sreg2, _mm256_set1_pd(1));
+	kahan_step_pd(&sreg, &creg, sreg3, _mm256_set1_pd(1));
+	kahan_step_pd(&sreg, &creg, sreg4, _mm256_set1_pd(1));
+	kahan_step_pd(&sreg, &creg, sreg5, _mm256_set1_pd(1));
+	creg = _mm256_add_pd(_mm256_add_pd(creg, creg1), _mm256_add_pd(creg2, creg3));
+	creg = _mm256_add_pd(creg, _mm256_add_pd(creg4, creg5));
+
+	return _mm256_register_sum_pd(_mm256_sub_pd(sreg, creg));
+}
+
+TARGET_AVX2
+double _mm256_ddot_indexed_kahan(const double *x, const int *xindices, const double *y, int n)
+{
+	__m256d xreg;
+	__m256d yreg;
+	__m256d zero = _mm256_set1_pd(0);
+	__m256d sreg0 = _mm256_set1_pd(0), creg0 = _mm256_set1_pd(0);
+	__m256d sreg1 = _mm256_set1_pd(0), creg1 = _mm256_set1_pd(0);
+	__m128i vindex;
+	__m256i mask;
+	__m128i mask128;
+	int i;
+	int cutoff = n % DOUBLE_PER_M256_REG;
+
+	if (cutoff > 0) {
+		mask = _mm256_set_mask_epi64(cutoff - 1);
+		mask128 = _mm_set_mask_epi32(cutoff - 1);
+
+		vindex = _mm_maskload_epi32(xindices, mask128);
+		xreg = _mm256_mask_i32gather_pd(zero, x, vindex, _mm256_castsi256_pd(mask), 8);
+		yreg = _mm256_maskload_pd(y, mask);
+
+		kahan_step_pd(&sreg0, &creg0, xreg, yreg);
+	}
+
+	for (i = cutoff; i + 2 * DOUBLE_PER_M256_REG <= n; i += 2 * DOUBLE_PER_M256_REG) {
+		vindex = _mm_loadu_si128((const __m128i *)(xindices + i));
+		xreg = _mm256_i32gather_pd(x, vindex, 8);
+		kahan_step_pd(&sreg0, &creg0, xreg, _mm256_loadu_pd(y + i));
+
+		vindex = _mm_loadu_si128((const __m128i *)(xindices + i + 4));
+		xreg = _mm256_i32gather_pd(x, vindex, 8);
+		kahan_step_pd(&sreg1, &creg1, xreg, _mm256_loadu_pd(y + i + 4));
+	}
+
+	for (; i < n; i += DOUBLE_PER_M256_REG) {
+		vindex = _mm_loadu_si128((const __m128i *)(xindices + i));
+		xreg = _mm256_i32gather_pd(x, vindex, 8);
+		kahan_step_pd(&sreg0, &creg0, xreg, _mm256_loadu_pd(y + i));
+	}
+
+	kahan_step_pd(&sreg0, &creg0, sreg1, _mm256_set1_pd(1));
+	creg0 = _mm256_add_pd(creg0, creg1);
+
+	return _mm256_register_sum_pd(_mm256_sub_pd(sreg0, creg0));
+}
+
+#ifdef SUPPORTS_AVX512
+TARGET_AVX512
+static inline void kahan_step_ps512(__m512 *sreg, __m512 *creg, __m512 xreg, __m512 yreg)
+{
+	__m512 zreg = _mm512_fmsub_ps(xreg, yreg, *creg);
+	__m512 treg = _mm512_add_ps(*sreg, zreg);
+
+	*creg = _mm512_sub_ps(_mm512_sub_ps(treg, *sreg), zreg);
+	*sreg = treg;
+}
+
+TARGET_AVX512
+static inline void kahan_step_pd512(__m512d *sreg, __m512d *creg, __m512d xreg, __m512d yreg)
+{
+	__m512d zreg = _mm512_fmsub_pd(xreg, yreg, *creg);
+	__m512d treg = _mm512_add_pd(*sreg, zreg);
+
+	*creg = _mm512_sub_pd(_mm512_sub_pd(treg, *sreg), zreg);
+	*sreg = treg;
+}
+
+TARGET_AVX512
+static inline __m512d kahan_widen_ps512(__m512 sreg, __m512 creg)
+{
+	__m512d slo = _mm512_cvtps_pd(_mm512_castps512_ps256(sreg));
+	__m512d shi = _mm512_cvtps_pd(_mm512_extractf32x8_ps(sreg, 1));
+	__m512d clo = _mm512_cvtps_pd(_mm512_castps512_ps256(creg));
+	__m512d chi = _mm512_cvtps_pd(_mm512_extractf32x8_ps(creg, 1));
+
+	return _mm512_sub_pd(_mm512_add_pd(slo, shi), _mm512_add_pd(clo, chi));
+}
+
+TARGET_AVX512
+float _mm512_fdot_kahan(const float *x, const float *y, int n)
+{
+	__m512 xreg;
+	__m512 yreg;
+	__m512 sreg0 = _mm512_set1_ps(0), creg0 = _mm512_set1_ps(0);
+	__m512 sreg1 = _mm512_set1_ps(0), creg1 = _mm512_set1_ps(0);
+	__m512 sreg2 = _mm512_set1_ps(0), creg2 = _mm512_set1_ps(0);
+	__m512 sreg3 = _mm512_set1_ps(0), creg3 = _mm512_set1_ps(0);
+	__m512 sreg4 = _mm512_set1_ps(0), creg4 = _mm512_set1_ps(0);
+	__m512 sreg5 = _mm512_set1_ps(0), creg5 = _mm512_set1_ps(0);
+	__m512 sreg6 = _mm512_set1_ps(0), creg6 = _mm512_set1_ps(0);
+	__m512 sreg7 = _mm512_set1_ps(0), creg7 = _mm512_set1_ps(0);
+	__m512d dreg;
+	__mmask16 mask;
+	int i;
+	int cutoff = n % FLOAT_PER_M512_REG;
+
+	if (cutoff > 0) {
+		mask = _mm512_set_mask_epi32(cutoff - 1);
+
+		xreg = _mm512_maskz_loadu_ps(mask, x);
+		yreg = _mm512_maskz_loadu_ps(mask, y);
+		kahan_step_ps512(&sreg0, &creg0, xreg, yreg);
+	}
+
+	// With 32 zmm registers there is room for eight chains.
+	for (i = cutoff; i + 8 * FLOAT_PER_M512_REG <= n; i += 8 * FLOAT_PER_M512_REG) {
+		kahan_step_ps512(&sreg0, &creg0, _mm512_loadu_ps(x + i), _mm512_loadu_ps(y + i));
+		kahan_step_ps512(&sreg1, &creg1, _mm512_loadu_ps(x + i + 16), _mm512_loadu_ps(y + i + 16));
+		kahan_step_ps512(&sreg2, &creg2, _mm512_loadu_ps(x + i + 32), _mm512_loadu_ps(y + i + 32));
+		kahan_step_ps512(&sreg3, &creg3, _mm512_loadu_ps(x + i + 48), _mm512_loadu_ps(y + i + 48));
+		kahan_step_ps512(&sreg4, &creg4, _mm512_loadu_ps(x + i + 64), _mm512_loadu_ps(y + i + 64));
+		kahan_step_ps512(&sreg5, &creg5, _mm512_loadu_ps(x + i + 80), _mm512_loadu_ps(y + i + 80));
+		kahan_step_ps512(&sreg6, &creg6, _mm512_loadu_ps(x + i + 96), _mm512_loadu_ps(y + i + 96));
+		kahan_step_ps512(&sreg7, &creg7, _mm512_loadu_ps(x + i + 112), _mm512_loadu_ps(y + i + 112));
+	}
+
+	for (; i < n; i += FLOAT_PER_M512_REG) {
+		xreg = _mm512_loadu_ps(x + i);
+		yreg = _mm512_loadu_ps(y + i);
+		kahan_step_ps512(&sreg0, &creg0, xreg, yreg);
+	}
+
+	dreg = _mm512_add_pd(kahan_widen_ps512(sreg0, creg0), kahan_widen_ps512(sreg1, creg1));
+	dreg = _mm512_add_pd(dreg, kahan_widen_ps512(sreg2, creg2));
+	dreg = _mm512_add_pd(dreg, kahan_widen_ps512(sreg3, creg3));
+	dreg = _mm512_add_pd(dreg, kahan_widen_ps512(sreg4, creg4));
+	dreg = _mm512_add_pd(dreg, kahan_widen_ps512(sreg5, creg5));
+	dreg = _mm512_add_pd(dreg, kahan_widen_ps512(sreg6, creg6));
+	dreg = _mm512_add_pd(dreg, kahan_widen_ps512(sreg7, creg7));
+
+	return (float)_mm512_register_sum_pd(dreg);
+}
+
+TARGET_AVX512
+float _mm512_fdot_indexed_kahan(const float *x, const int *xindices, const float *y, int n)
+{
+	__m512 xreg;
+	__m512 yreg;
+	__m512 zero = _mm512_set1_ps(0);
+	__m512 sreg0 = _mm512_set1_ps(0), creg0 = _mm512_set1_ps(0);
+	__m512 sreg1 = _mm512_set1_ps(0), creg1 = _mm512_set1_ps(0);
+	__m512i vindex;
+	__mmask16 mask;
+	int i;
+	int cutoff = n % FLOAT_PER_M512_REG;
+
+	if (cutoff > 0) {
+		mask = _mm512_set_mask_epi32(cutoff - 1);
+		vindex = _mm512_maskz_loadu_epi32(mask, xindices);
+		yreg = _mm512_maskz_loadu_ps(mask, y);
+		xreg = _mm512_mask_i32gather_ps(zero, mask, vindex, x, 4);
+
+		kahan_step_ps512(&sreg0, &creg0, xreg, yreg);
+	}
+
+	for (i = cutoff; i + 2 * FLOAT_PER_M512_REG <= n; i += 2 * FLOAT_PER_M512_REG) {
+		vindex = _mm512_loadu_epi32(xindices + i);
+		xreg = _mm512_i32gather_ps(vindex, x, 4);
+		kahan_step_ps512(&sreg0, &creg0, xreg, _mm512_loadu_ps(y + i));
+
+		vindex = _mm512_loadu_epi32(xindices + i + 16);
+		xreg = _mm512_i32gather_ps(vindex, x, 4);
+		kahan_step_ps512(&sreg1, &creg1, xreg, _mm512_loadu_ps(y + i + 16));
+	}
+
+	for (; i < n; i += FLOAT_PER_M512_REG) {
+		vindex = _mm512_loadu_epi32(xindices + i);
+		xreg = _mm512_i32gather_ps(vindex, x, 4);
+		kahan_step_ps512(&sreg0, &creg0, xreg, _mm512_loadu_ps(y + i));
+	}
+
+	return (float)_mm512_register_sum_pd(_mm512_add_pd(kahan_widen_ps512(sreg0, creg0), kahan_widen_ps512(sreg1, creg1)));
+}
+
+TARGET_AVX512
+double _mm512_ddot_kahan(const double *x, const double *y, int n)
+{
+	__m512d xreg;
+	__m512d yreg;
+	__m512d sreg0 = _mm512_set1_pd(0), creg0 = _mm512_set1_pd(0);
+	__m512d sreg1 = _mm512_set1_pd(0), creg1 = _mm512_set1_pd(0);
+	__m512d sreg2 = _mm512_set1_pd(0), creg2 = _mm512_set1_pd(0);
+	__m512d sreg3 = _mm512_set1_pd(0), creg3 = _mm512_set1_pd(0);
+	__m512d sreg4 = _mm512_set1_pd(0), creg4 = _mm512_set1_pd(0);
+	__m512d sreg5 = _mm512_set1_pd(0), creg5 = _mm512_set1_pd(0);
+	__m512d sreg6 = _mm512_set1_pd(0), creg6 = _mm512_set1_pd(0);
+	__m512d sreg7 = _mm512_set1_pd(0), creg7 = _mm512_set1_pd(0);
+	__m512d sreg, creg;
+	__mmask8 mask;
+	int i;
+	int cutoff = n % DOUBLE_PER_M512_REG;
+
+	if (cutoff > 0) {
+		mask = _mm512_set_mask_epi64(cutoff - 1);
+
+		xreg = _mm512_maskz_loadu_pd(mask, x);
+		yreg = _mm512_maskz_loadu_pd(mask, y);
+		kahan_step_pd512(&sreg0, &creg0, xreg, yreg);
+	}
+
+	for (i = cutoff; i + 8 * DOUBLE_PER_M512_REG <= n; i += 8 * DOUBLE_PER_M512_REG) {
+		kahan_step_pd512(&sreg0, &creg0, _mm512_loadu_pd(x + i), _mm512_loadu_pd(y + i));
+		kahan_step_pd512(&sreg1, &creg1, _mm512_loadu_pd(x + i + 8), _mm512_loadu_pd(y + i + 8));
+		kahan_step_pd512(&sreg2, &creg2, _mm512_loadu_pd(x + i + 16), _mm512_loadu_pd(y + i + 16));
+		kahan_step_pd512(&sreg3, &creg3, _mm512_loadu_pd(x + i + 24), _mm512_loadu_pd(y + i + 24));
+		kahan_step_pd512(&sreg4, &creg4, _mm512_loadu_pd(x + i + 32), _mm512_loadu_pd(y + i + 32));
+		kahan_step_pd512(&sreg5, &creg5, _mm512_loadu_pd(x + i + 40), _mm512_loadu_pd(y + i + 40));
+		kahan_step_pd512(&sreg6, &creg6, _mm512_loadu_pd(x + i + 48), _mm512_loadu_pd(y + i + 48));
+		kahan_step_pd512(&sreg7, &creg7, _mm512_loadu_pd(x + i + 56), _mm512_loadu_pd(y + i + 56));
+	}
+
+	for (; i < n; i += DOUBLE_PER_M512_REG) {
+		xreg = _mm512_loadu_pd(x + i);
+		yreg = _mm512_loadu_pd(y + i);
+		kahan_step_pd512(&sreg0, &creg0, xreg, yreg);
+	}
+
+	sreg = sreg0;
+	creg = creg0;
+	kahan_step_pd512(&sreg, &creg, sreg1, _mm512_set1_pd(1));
+	kahan_step_pd512(&sreg, &creg, sreg2, _mm512_set1_pd(1));
+	kahan_step_pd512(&sreg, &creg, sreg3, _mm512_set1_pd(1));
+	kahan_step_pd512(&sreg, &creg, sreg4, _mm512_set1_pd(1));
+	kahan_step_pd512(&sreg, &creg, sreg5, _mm512_set1_pd(1));
+	kahan_step_pd512(&sreg, &creg, sreg6, _mm512_set1_pd(1));
+	kahan_step_pd512(&sreg, &creg, sreg7, _mm512_set1_pd(1));
+	creg = _mm512_add_pd(_mm512_add_pd(creg, creg1), _mm512_add_pd(creg2, creg3));
+	creg = _mm512_add_pd(creg, _mm512_add_pd(_mm512_add_pd(creg4, creg5), _mm512_add_pd(creg6, creg7)));
+
+	return _mm512_register_sum_pd(_mm512_sub_pd(sreg, creg));
+}
+
+TARGET_AVX512
+double _mm512_ddot_indexed_kahan(const double *x, const int *xindices, const double *y, int n)
+{
+	__m512d xreg;
+	__m512d yreg;
+	__m512d zero = _mm512_set1_pd(0);
+	__m512d sreg0 = _mm512_set1_pd(0), creg0 = _mm512_set1_pd(0);
+	__m512d sreg1 = _mm512_set1_pd(0), creg1 = _mm512_set1_pd(0);
+	__m256i vindex;
+	__mmask8 mask;
+	int i;
+	int cutoff = n % DOUBLE_PER_M512_REG;
+
+	if (cutoff > 0) {
+		mask = _mm512_set_mask_epi64(cutoff - 1);
+		vindex = _mm512_castsi512_si256(_mm512_maskz_loadu_epi32(mask, xindices));
+		yreg = _mm512_maskz_loadu_pd(mask, y);
+		xreg = _mm512_mask_i32gather_pd(zero, mask, vindex, x, 8);
+
+		kahan_step_pd512(&sreg0, &creg0, xreg, yreg);
+	}
+
+	for (i = cutoff; i + 2 * DOUBLE_PER_M512_REG <= n; i += 2 * DOUBLE_PER_M512_REG) {
+		vindex = _mm256_loadu_si256((const __m256i *)(xindices + i));
+		xreg = _mm512_i32gather_pd(vindex, x, 8);
+		kahan_step_pd512(&sreg0, &creg0, xreg, _mm512_loadu_pd(y + i));
+
+		vindex = _mm256_loadu_si256((const __m256i *)(xindices + i + 8));
+		xreg = _mm512_i32gather_pd(vindex, x, 8);
+		kahan_step_pd512(&sreg1, &creg1, xreg, _mm512_loadu_pd(y + i + 8));
+	}
+
+	for (; i < n; i += DOUBLE_PER_M512_REG) {
+		vindex = _mm256_loadu_si256((const __m256i *)(xindices + i));
+		xreg = _mm512_i32gather_pd(vindex, x, 8);
+		kahan_step_pd512(&sreg0, &creg0, xreg, _mm512_loadu_pd(y + i));
+	}
+
+	kahan_step_pd512(&sreg0, &creg0, sreg1, _mm512_set1_pd(1));
+	creg0 = _mm512_add_pd(creg0, creg1);
+
+	return _mm512_register_sum_pd(_mm512_sub_pd(sreg0, creg0));
+}
+#endif
+
+//----------------------------------------------------------------------------
+// Functions for computing dot products of floats with double accumulation.
+// Lanes are widened to double as they are loaded, so the result is close to
+// double accuracy while memory traffic stays that of float arrays.
+//----------------------------------------------------------------------------
+
+TARGET_AVX2
+static inline void acc64_step_ps(__m256d *slo, __m256d *shi, __m256 xreg, __m256 yreg)
+{
+	__m256d xlo = _mm256_cvtps_pd(_mm256_castps256_ps128(xreg));
+	__m256d xhi = _mm256_cvtps_pd(_mm256_extractf128_ps(xreg, 1));
+	__m256d ylo = _mm256_cvtps_pd(_mm256_castps256_ps128(yreg));
+	__m256d yhi = _mm256_cvtps_pd(_mm256_extractf128_ps(yreg, 1));
+
+#ifdef SUPPORTS_FMA
+	*slo = _mm256_fmadd_pd(xlo, ylo, *slo);
+	*shi = _mm256_fmadd_pd(xhi, yhi, *shi);
+#else
+	*slo = _mm256_add_pd(*slo, _mm256_mul_pd(xlo, ylo));
+	*shi = _mm256_add_pd(*shi, _mm256_mul_pd(xhi, yhi));
+#endif
+}
+
+TARGET_AVX2
+double _mm256_fdot_acc64(const float *x, const float *y, int n)
+{
+	__m256 xreg;
+	__m256 yreg;
+	__m256d sreg0 = _mm256_set1_pd(0), sreg1 = _mm256_set1_pd(0);
+	__m256d sreg2 = _mm256_set1_pd(0), sreg3 = _mm256_set1_pd(0);
+	__m256i mask;
+	int i;
+	int cutoff = n % FLOAT_PER_M256_REG;
+
+	if (cutoff > 0) {
+		mask = _mm256_set_mask_epi32(cutoff - 1);
+
+		xreg = _mm256_maskload_ps(x, mask);
+		yreg = _mm256_maskload_ps(y, mask);
+		acc64_step_ps(&sreg0, &sreg1, xreg, yreg);
+	}
+
+	for (i = cutoff; i + 2 * FLOAT_PER_M256_REG <= n; i += 2 * FLOAT_PER_M256_REG) {
+		acc64_step_ps(&sreg0, &sreg1, _mm256_loadu_ps(x + i), _mm256_loadu_ps(y + i));
+		acc64_step_ps(&sreg2, &sreg3, _mm256_loadu_ps(x + i + 8), _mm256_loadu_ps(y + i + 8));
+	}
+
+	for (; i < n; i += FLOAT_PER_M256_REG) {
+		xreg = _mm256_loadu_ps(x + i);
+		yreg = _mm256_loadu_ps(y + i);
+		acc64_step_ps(&sreg0, &sreg1, xreg, yreg);
+	}
+
+	sreg0 = _mm256_add_pd(_mm256_add_pd(sreg0, sreg1), _mm256_add_pd(sreg2, sreg3));
+
+	return _mm256_register_sum_pd(sreg0);
+}
+
+TARGET_AVX2
+double _mm256_fdot_indexed_acc64(const float *x, const int *xindices, const float *y, int n)
+{
+	__m256 xreg;
+	__m256 yreg;
+	__m256 zero = _mm256_set1_ps(0);
+	__m256d sreg0 = _mm256_set1_pd(0), sreg1 = _mm256_set1_pd(0);
+	__m256i vindex;
+	__m256i mask;
+	int i;
+	int cutoff = n % FLOAT_PER_M256_REG;
+
+	if (cutoff > 0) {
+		mask = _mm256_set_mask_epi32(cutoff - 1);
+		vindex = _mm256_maskload_epi32(xindices, mask);
+		yreg = _mm256_maskload_ps(y, mask);
+		xreg = _mm256_mask_i32gather_ps(zero, x, vindex, _mm256_castsi256_ps(mask), 4);
+
+		acc64_step_ps(&sreg0, &sreg1, xreg, yreg);
+	}
+
+	for (i = cutoff; i < n; i += FLOAT_PER_M256_REG) {
+		vindex = _mm256_loadu_si256((const __m256i *)(xindices + i));
+		yreg = _mm256_loadu_ps(y + i);
+		xreg = _mm256_i32gather_ps(x, vindex, 4);
+
+		acc64_step_ps(&sreg0, &sreg1, xreg, yreg);
+	}
+
+	return _mm256_register_sum_pd(_mm256_add_pd(sreg0, sreg1));
+}
+
+TARGET_AVX2
+double _mm256_fdot_indexed2_acc64(const float *x, const int *xindices, const float *y, const int *yindices, int n)
+{
+	__m256 xreg;
+	__m256 yreg;
+	__m256 zero = _mm256_set1_ps(0);
+	__m256d sreg0 = _mm256_set1_pd(0), sreg1 = _mm256_set1_pd(0);
+	__m256i xindex, yindex;
+	__m256i mask;
+	int i;
+	int cutoff = n % FLOAT_PER_M256_REG;
+
+	if (cutoff > 0) {
+		mask = _mm256_set_mask_epi32(cutoff - 1);
+		xindex = _mm256_maskload_epi32(xindices, mask);
+		yindex = _mm256_maskload_epi32(yindices, mask);
+
+		xreg = _mm256_mask_i32gather_ps(zero, x, xindex, _mm256_castsi256_ps(mask), 4);
+		yreg = _mm256_mask_i32gather_ps(zero, y, yindex, _mm256_castsi256_ps(mask), 4);
+
+		acc64_step_ps(&sreg0, &sreg1, xreg, yreg);
+	}
+
+	for (i = cutoff; i < n; i += FLOAT_PER_M256_REG) {
+		xindex = _mm256_loadu_si256((const __m256i *)(xindices + i));
+		yindex = _mm256_loadu_si256((const __m256i *)(yindices + i));
+
+		xreg = _mm256_i32gather_ps(x, xindex, 4);
+		yreg = _mm256_i32gather_ps(y, yindex, 4);
+
+		acc64_step_ps(&sreg0, &sreg1, xreg, yreg);
+	}
+
+	return _mm256_register_sum_pd(_mm256_add_pd(sreg0, sreg1));
+}
+
+#ifdef SUPPORTS_AVX512
+TARGET_AVX512
+static inline void acc64_step_ps512(__m512d *slo, __m512d *shi, __m512 xreg, __m512 yreg)
+{
+	__m512d xlo = _mm512_cvtps_pd(_mm512_castps512_ps256(xreg));
+	__m512d xhi = _mm512_cvtps_pd(_mm512_extractf32x8_ps(xreg, 1));
+	__m512d ylo = _mm512_cvtps_pd(_mm512_castps512_ps256(yreg));
+	__m512d yhi = _mm512_cvtps_pd(_mm512_extractf32x8_ps(yreg, 1));
+
+	*slo = _mm512_fmadd_pd(xlo, ylo, *slo);
+	*shi = _mm512_fmadd_pd(xhi, yhi, *shi);
+}
+
+TARGET_AVX512
+double _mm512_fdot_acc64(const float *x, const float *y, int n)
+{
+	__m512 xreg;
+	__m512 yreg;
+	__m512d sreg0 = _mm512_set1_pd(0), sreg1 = _mm512_set1_pd(0);
+	__m512d sreg2 = _mm512_set1_pd(0), sreg3 = _mm512_set1_pd(0);
+	__mmask16 mask;
+	int i;
+	int cutoff = n % FLOAT_PER_M512_REG;
+
+	if (cutoff > 0) {
+		mask = _mm512_set_mask_epi32(cutoff - 1);
+
+		xreg = _mm512_maskz_loadu_ps(mask, x);
+		yreg = _mm512_maskz_loadu_ps(mask, y);
+		acc64_step_ps512(&sreg0, &sreg1, xreg, yreg);
+	}
+
+	for (i = cutoff; i + 2 * FLOAT_PER_M512_REG <= n; i += 2 * FLOAT_PER_M512_REG) {
+		acc64_step_ps512(&sreg0, &sreg1, _mm512_loadu_ps(x + i), _mm512_loadu_ps(y + i));
+		acc64_step_ps512(&sreg2, &sreg3, _mm512_loadu_ps(x + i + 16), _mm512_loadu_ps(y + i + 16));
+	}
+
+	for (; i < n; i += FLOAT_PER_M512_REG) {
+		xreg = _mm512_loadu_ps(x + i);
+		yreg = _mm512_loadu_ps(y + i);
+		acc64_step_ps512(&sreg0, &sreg1, xreg, yreg);
+	}
+
+	sreg0 = _mm512_add_pd(_mm512_add_pd(sreg0, sreg1), _mm512_add_pd(sreg2, sreg3));
+
+	return _mm512_register_sum_pd(sreg0);
+}
+
+TARGET_AVX512
+double _mm512_fdot_indexed_acc64(const float *x, const int *xindices, const float *y, int n)
+{
+	__m512 xreg;
+	__m512 yreg;
+	__m512 zero = _mm512_set1_ps(0);
+	__m512d sreg0 = _mm512_set1_pd(0), sreg1 = _mm512_set1_pd(0);
+	__m512i vindex;
+	__mmask16 mask;
+	int i;
+	int cutoff = n % FLOAT_PER_M512_REG;
+
+	if (cutoff > 0) {
+		mask = _mm512_set_mask_epi32(cutoff - 1);
+		vindex = _mm512_maskz_loadu_epi32(mask, xindices);
+		yreg = _mm512_maskz_loadu_ps(mask, y);
+		xreg = _mm512_mask_i32gather_ps(zero, mask, vindex, x, 4);
+
+		acc64_step_ps512(&sreg0, &sreg1, xreg, yreg);
+	}
+
+	for (i = cutoff; i < n; i += FLOAT_PER_M512_REG) {
+		vindex = _mm512_loadu_epi32(xindices + i);
+		yreg = _mm512_loadu_ps(y + i);
+		xreg = _mm512_i32gather_ps(vindex, x, 4);
+
+		acc64_step_ps512(&sreg0, &sreg1, xreg, yreg);
+	}
+
+	return _mm512_register_sum_pd(_mm512_add_pd(sreg0, sreg1));
+}
+
+TARGET_AVX512
+double _mm512_fdot_indexed2_acc64(const float *x, const int *xindices, const float *y, const int *yindices, int n)
+{
+	__m512 xreg;
+	__m512 yreg;
+	__m512 zero = _mm512_set1_ps(0);
+	__m512d sreg0 = _mm512_set1_pd(0), sreg1 = _mm512_set1_pd(0);
+	__m512i xind;
+	__m512i yind;
+	__mmask16 mask;
+	int i;
+	int cutoff = n % FLOAT_PER_M512_REG;
+
+	if (cutoff > 0) {
+		mask = _mm512_set_mask_epi32(cutoff - 1);
+
+		xind = _mm512_maskz_loadu_epi32(mask, xindices);
+		yind = _mm512_maskz_loadu_epi32(mask, yindices);
+
+		xreg = _mm512_mask_i32gather_ps(zero, mask, xind, x, 4);
+		yreg = _mm512_mask_i32gather_ps(zero, mask, yind, y, 4);
+
+		acc64_step_ps512(&sreg0, &sreg1, xreg, yreg);
+	}
+
+	for (i = cutoff; i < n; i += FLOAT_PER_M512_REG) {
+		xind = _mm512_loadu_epi32(xindices + i);
+		yind = _mm512_loadu_epi32(yindices + i);
+
+		xreg = _mm512_i32gather_ps(xind, x, 4);
+		yreg = _mm512_i32gather_ps(yind, y, 4);
+
+		acc64_step_ps512(&sreg0, &sreg1, xreg, yreg);
+	}
+
+	return _mm512_register_sum_pd(_mm512_add_pd(sreg0, sreg1));
+}
+#endif
+
+//----------------------------------------------------------------------------
+// Functions for computing matrix-vector products y = A x, with A stored in
+// ROW_MAJOR_ORDER or COLUMN_MAJOR_ORDER and a leading dimension lda. Row-major
+// kernels take a block of rows per pass, so every register of x is loaded
+// once per block, and reduce the block with a single transpose-and-add.
+// Column-major kernels keep a block of y in registers across all columns.
+// Any other order leaves y untouched.
+//----------------------------------------------------------------------------
+
+// Reduce four registers to the register of their sums.
+static inline __m128 transpose_sum4_ps128(__m128 s0, __m128 s1, __m128 s2, __m128 s3)
+{
+	return _mm_hadd_ps(_mm_hadd_ps(s0, s1), _mm_hadd_ps(s2, s3));
+}
+
+static void sgemv_rows_ps128(int nrows, int ncols, const float *a, int lda, const float *x, float *y)
+{
+	int r, c;
+	int cutoff = ncols % FLOAT_PER_M128_REG;
+	const float *row;
+	__m128 xreg;
+	__m128 s0, s1, s2, s3;
+
+	for (r = 0; r + 4 <= nrows; r += 4) {
+		row = a + (size_t)r * lda;
+
+		s0 = _mm_set1_ps(0);
+		s1 = _mm_set1_ps(0);
+		s2 = _mm_set1_ps(0);
+		s3 = _mm_set1_ps(0);
+
+		if (cutoff > 0) {
+			xreg = load_partial_ps(x, cutoff);
+			s0 = _mm_mul_ps(load_partial_ps(row, cutoff), xreg);
+			s1 = _mm_mul_ps(load_partial_ps(row + lda, cutoff), xreg);
+			s2 = _mm_mul_ps(load_partial_ps(row + 2 * lda, cutoff), xreg);
+			s3 = _mm_mul_ps(load_partial_ps(row + 3 * lda, cutoff), xreg);
+		}
+
+		for (c = cutoff; c < ncols; c += FLOAT_PER_M128_REG) {
+			xreg = _mm_loadu_ps(x + c);
+			s0 = _mm_add_ps(s0, _mm_mul_ps(_mm_loadu_ps(row + c), xreg));
+			s1 = _mm_add_ps(s1, _mm_mul_ps(_mm_loadu_ps(row + lda + c), xreg));
+			s2 = _mm_add_ps(s2, _mm_mul_ps(_mm_loadu_ps(row + 2 * lda + c), xreg));
+			s3 = _mm_add_ps(s3, _mm_mul_ps(_mm_loadu_ps(row + 3 * lda + c), xreg));
+		}
+
+		_mm_storeu_ps(y + r, transpose_sum4_ps128(s0, s1, s2, s3));
+	}
+
+	for (; r < nrows; r++) {
+		y[r] = _mm_fdot(a + (size_t)r * lda, x, ncols);
+	}
+}
+
+static void sgemv_cols_ps128(int nrows, int ncols, const float *a, int lda, const float *x, float *y)
+{
+	int r, c;
+	const float *col;
+	__m128 xreg;
+	__m128 s0, s1, s2, s3;
+
+	for (r = 0; r + 4 * FLOAT_PER_M128_REG <= nrows; r += 4 * FLOAT_PER_M128_REG) {
+		s0 = _mm_set1_ps(0);
+		s1 = _mm_set1_ps(0);
+		s2 = _mm_set1_ps(0);
+		s3 = _mm_set1_ps(0);
+
+		for (c = 0; c < ncols; c++) {
+			col = a + (size_t)c * lda + r;
+			xreg = _mm_set1_ps(x[c]);
+			s0 = _mm_add_ps(s0, _mm_mul_ps(_mm_loadu_ps(col), xreg));
+			s1 = _mm_add_ps(s1, _mm_mul_ps(_mm_loadu_ps(col + 4), xreg));
+			s2 = _mm_add_ps(s2, _mm_mul_ps(_mm_loadu_ps(col + 8), xreg));
+			s3 = _mm_add_ps(s3, _mm_mul_ps(_mm_loadu_ps(col + 12), xreg));
+		}
+
+		_mm_storeu_ps(y + r, s0);
+		_mm_storeu_ps(y + r + 4, s1);
+		_mm_storeu_ps(y + r + 8, s2);
+		_mm_storeu_ps(y + r + 12, s3);
+	}
+
+	for (; r + FLOAT_PER_M128_REG <= nrows; r += FLOAT_PER_M128_REG) {
+		s0 = _mm_set1_ps(0);
+
+		for (c = 0; c < ncols; c++) {
+			s0 = _mm_add_ps(s0, _mm_mul_ps(_mm_loadu_ps(a + (size_t)c * lda + r), _mm_set1_ps(x[c])));
+		}
+
+		_mm_storeu_ps(y + r, s0);
+	}
+
+	for (; r < nrows; r++) {
+		y[r] = 0;
+
+		for (c = 0; c < ncols; c++) {
+			y[r] += a[(size_t)c * lda + r] * x[c];
+		}
+	}
+}
+
+void _mm_sgemv(char order, int nrows, int ncols, const float *a, int lda, const float *x, float *y)
+{
+	if (order == ROW_MAJOR_ORDER) {
+		sgemv_rows_ps128(nrows, ncols, a, lda, x, y);
+	} else if (order == COLUMN_MAJOR_ORDER) {
+		sgemv_cols_ps128(nrows, ncols, a, lda, x, y);
+	}
+}
+
+static void dgemv_rows_pd128(int nrows, int ncols, const double *a, int lda, const double *x, double *y)
+{
+	int r, c;
+	int cutoff = ncols % DOUBLE_PER_M128_REG;
+	const double *row;
+	__m128d xreg;
+	__m128d s0, s1;
+
+	for (r = 0; r + 2 <= nrows; r += 2) {
+		row = a + (size_t)r * lda;
+
+		s0 = _mm_set1_pd(0);
+		s1 = _mm_set1_pd(0);
+
+		if (cutoff > 0) {
+			xreg = _mm_load_sd(x);
+			s0 = _mm_mul_pd(_mm_load_sd(row), xreg);
+			s1 = _mm_mul_pd(_mm_load_sd(row + lda), xreg);
+		}
+
+		for (c = cutoff; c < ncols; c += DOUBLE_PER_M128_REG) {
+			xreg = _mm_loadu_pd(x + c);
+			s0 = _mm_add_pd(s0, _mm_mul_pd(_mm_loadu_pd(row + c), xreg));
+			s1 = _mm_add_pd(s1, _mm_mul_pd(_mm_loadu_pd(row + lda + c), xreg));
+		}
+
+		_mm_storeu_pd(y + r, _mm_hadd_pd(s0, s1));
+	}
+
+	for (; r < nrows; r++) {
+		y[r] = _mm_ddot(a + (size_t)r * lda, x, ncols);
+	}
+}
+
+static void dgemv_cols_pd128(int nrows, int ncols, const double *a, int lda, const double *x, double *y)
+{
+	int r, c;
+	const double *col;
+	__m128d xreg;
+	__m128d s0, s1, s2, s3;
+
+	for (r = 0; r + 4 * DOUBLE_PER_M128_REG <= nrows; r += 4 * DOUBLE_PER_M128_REG) {
+		s0 = _mm_set1_pd(0);
+		s1 = _mm_set1_pd(0);
+		s2 = _mm_set1_pd(0);
+		s3 = _mm_set1_pd(0);
+
+		for (c = 0; c < ncols; c++) {
+			col = a + (size_t)c * lda + r;
+			xreg = _mm_set1_pd(x[c]);
+			s0 = _mm_add_pd(s0, _mm_mul_pd(_mm_loadu_pd(col), xreg));
+			s1 = _mm_add_pd(s1, _mm_mul_pd(_mm_loadu_pd(col + 2), xreg));
+			s2 = _mm_add_pd(s2, _mm_mul_pd(_mm_loadu_pd(col + 4), xreg));
+			s3 = _mm_add_pd(s3, _mm_mul_pd(_mm_loadu_pd(col + 6), xreg));
+		}
+
+		_mm_storeu_pd(y + r, s0);
+		_mm_storeu_pd(y + r + 2, s1);
+		_mm_storeu_pd(y + r + 4, s2);
+		_mm_storeu_pd(y + r + 6, s3);
+	}
+
+	for (; r < nrows; r++) {
+		y[r] = 0;
+
+		for (c = 0; c < ncols; c++) {
+			y[r] += a[(size_t)c * lda + r] * x[c];
+		}
+	}
+}
+
+void _mm_dgemv(char order, int nrows, int ncols, const double *a, int lda, const double *x, double *y)
+{
+	if (order == ROW_MAJOR_ORDER) {
+		dgemv_rows_pd128(nrows, ncols, a, lda, x, y);
+	} else if (order == COLUMN_MAJOR_ORDER) {
+		dgemv_cols_pd128(nrows, ncols, a, lda, x, y);
+	}
+}
+
+TARGET_AVX2
+static inline __m256 madd_ps(__m256 a, __m256 b, __m256 c)
+{
+#ifdef SUPPORTS_FMA
+	return _mm256_fmadd_ps(a, b, c);
+#else
+	return _mm256_add_ps(_mm256_mul_ps(a, b), c);
+#endif
+}
+
+TARGET_AVX2
+static inline __m256d madd_pd(__m256d a, __m256d b, __m256d c)
+{
+#ifdef SUPPORTS_FMA
+	return _mm256_fmadd_pd(a, b, c);
+#else
+	return _mm256_add_pd(_mm256_mul_pd(a, b), c);
+#endif
+}
+
+// The first two rounds of hadd leave the sums of the lower and upper 128-bit
+// lanes side by side; swapping lanes between the two halves and adding
+// finishes the reduction.
+TARGET_AVX2
+static inline __m256 transpose_sum8_ps(__m256 s0, __m256 s1, __m256 s2, __m256 s3, __m256 s4, __m256 s5, __m256 s6, __m256 s7)
+{
+	__m256 t0 = _mm256_hadd_ps(_mm256_hadd_ps(s0, s1), _mm256_hadd_ps(s2, s3));
+	__m256 t1 = _mm256_hadd_ps(_mm256_hadd_ps(s4, s5), _mm256_hadd_ps(s6, s7));
+
+	return _mm256_add_ps(_mm256_permute2f128_ps(t0, t1, 0x20), _mm256_permute2f128_ps(t0, t1, 0x31));
+}
+
+TARGET_AVX2
+static inline __m256d transpose_sum4_pd(__m256d s0, __m256d s1, __m256d s2, __m256d s3)
+{
+	__m256d t0 = _mm256_hadd_pd(s0, s1);
+	__m256d t1 = _mm256_hadd_pd(s2, s3);
+
+	return _mm256_add_pd(_mm256_permute2f128_pd(t0, t1, 0x20), _mm256_permute2f128_pd(t0, t1, 0x31));
+}
+
+TARGET_AVX2
+static void sgemv_rows_ps(int nrows, int ncols, const float *a, int lda, const float *x, float *y)
+{
+	int r, c;
+	int cutoff = ncols % FLOAT_PER_M256_REG;
+	const float *row;
+	__m256 xreg;
+	__m256 s0, s1, s2, s3, s4, s5, s6, s7;
+	__m256i mask = _mm256_set_mask_epi32(cutoff - 1);
+
+	for (r = 0; r + 8 <= nrows; r += 8) {
+		row = a + (size_t)r * lda;
+
+		s0 = s1 = s2 = s3 = s4 = s5 = s6 = s7 = _mm256_set1_ps(0);
+
+		if (cutoff > 0) {
+			xreg = _mm256_maskload_ps(x, mask);
+			s0 = _mm256_mul_ps(_mm256_maskload_ps(row, mask), xreg);
+			s1 = _mm256_mul_ps(_mm256_maskload_ps(row + lda, mask), xreg);
+			s2 = _mm256_mul_ps(_mm256_maskload_ps(row + 2 * lda, mask), xreg);
+			s3 = _mm256_mul_ps(_mm256_maskload_ps(row + 3 * lda, mask), xreg);
+			s4 = _mm256_mul_ps(_mm256_maskload_ps(row + 4 * lda, mask), xreg);
+			s5 = _mm256_mul_ps(_mm256_maskload_ps(row + 5 * lda, mask), xreg);
+			s6 = _mm256_mul_ps(_mm256_maskload_ps(row + 6 * lda, mask), xreg);
+			s7 = _mm256_mul_ps(_mm256_maskload_ps(row + 7 * lda, mask), xreg);
+		}
+
+		for (c = cutoff; c < ncols; c += FLOAT_PER_M256_REG) {
+			xreg = _mm256_loadu_ps(x + c);
+			s0 = madd_ps(_mm256_loadu_ps(row + c), xreg, s0);
+			s1 = madd_ps(_mm256_loadu_ps(row + lda + c), xreg, s1);
+			s2 = madd_ps(_mm256_loadu_ps(row + 2 * lda + c), xreg, s2);
+			s3 = madd_ps(_mm256_loadu_ps(row + 3 * lda + c), xreg, s3);
+			s4 = madd_ps(_mm256_loadu_ps(row + 4 * lda + c), xreg, s4);
+			s5 = madd_ps(_mm256_loadu_ps(row + 5 * lda + c), xreg, s5);
+			s6 = madd_ps(_mm256_loadu_ps(row + 6 * lda + c), xreg, s6);
+			s7 = madd_ps(_mm256_loadu_ps(row + 7 * lda + c), xreg, s7);
+		}
+
+		_mm256_storeu_ps(y + r, transpose_sum8_ps(s0, s1, s2, s3, s4, s5, s6, s7));
+	}
+
+	for (; r < nrows; r++) {
+		y[r] = _mm256_fdot(a + (size_t)r * lda, x, ncols);
+	}
+}
+
+TARGET_AVX2
+static void sgemv_cols_ps(int nrows, int ncols, const float *a, int lda, const float *x, float *y)
+{
+	int r, c;
+	const float *col;
+	__m256 xreg;
+	__m256 s0, s1, s2, s3;
+	__m256i mask;
+
+	for (r = 0; r + 4 * FLOAT_PER_M256_REG <= nrows; r += 4 * FLOAT_PER_M256_REG) {
+		s0 = s1 = s2 = s3 = _mm256_set1_ps(0);
+
+		for (c = 0; c < ncols; c++) {
+			col = a + (size_t)c * lda + r;
+			xreg = _mm256_broadcast_ss(x + c);
+			s0 = madd_ps(_mm256_loadu_ps(col), xreg, s0);
+			s1 = madd_ps(_mm256_loadu_ps(col + 8), xreg, s1);
+			s2 = madd_ps(_mm256_loadu_ps(col + 16), xreg, s2);
+			s3 = madd_ps(_mm256_loadu_ps(col + 24), xreg, s3);
+		}
+
+		_mm256_storeu_ps(y + r, s0);
+		_mm256_storeu_ps(y + r + 8, s1);
+		_mm256_storeu_ps(y + r + 16, s2);
+		_mm256_storeu_ps(y + r + 24, s3);
+	}
+
+	for (; r + FLOAT_PER_M256_REG <= nrows; r += FLOAT_PER_M256_REG) {
+		s0 = _mm256_set1_ps(0);
+
+		for (c = 0; c < ncols; c++) {
+			s0 = madd_ps(_mm256_loadu_ps(a + (size_t)c * lda + r), _mm256_broadcast_ss(x + c), s0);
+		}
+
+		_mm256_storeu_ps(y + r, s0);
+	}
+
+	if (r < nrows) {
+		mask = _mm256_set_mask_epi32(nrows - r - 1);
+		s0 = _mm256_set1_ps(0);
+
+		for (c = 0; c < ncols; c++) {
+			s0 = madd_ps(_mm256_maskload_ps(a + (size_t)c * lda + r, mask), _mm256_broadcast_ss(x + c), s0);
+		}
+
+		_mm256_maskstore_ps(y + r, mask, s0);
+	}
+}
+
+TARGET_AVX2
+void _mm256_sgemv(char order, int nrows, int ncols, const float *a, int lda, const float *x, float *y)
+{
+	if (order == ROW_MAJOR_ORDER) {
+		sgemv_rows_ps(nrows, ncols, a, lda, x, y);
+	} else if (order == COLUMN_MAJOR_ORDER) {
+		sgemv_cols_ps(nrows, ncols, a, lda, x, y);
+	}
+}
+
+TARGET_AVX2
+static void dgemv_rows_pd(int nrows, int ncols, const double *a, int lda, const double *x, double *y)
+{
+	int r, c;
+	int cutoff = ncols % DOUBLE_PER_M256_REG;
+	const double *row;
+	__m256d xreg;
+	__m256d s0, s1, s2, s3;
+	__m256i mask = _mm256_set_mask_epi64(cutoff - 1);
+
+	for (r = 0; r + 4 <= nrows; r += 4) {
+		row = a + (size_t)r * lda;
+
+		s0 = s1 = s2 = s3 = _mm256_set1_pd(0);
+
+		if (cutoff > 0) {
+			xreg = _mm256_maskload_pd(x, mask);
+			s0 = _mm256_mul_pd(_mm256_maskload_pd(row, mask), xreg);
+			s1 = _mm256_mul_pd(_mm256_maskload_pd(row + lda, mask), xreg);
+			s2 = _mm256_mul_pd(_mm256_maskload_pd(row + 2 * lda, mask), xreg);
+			s3 = _mm256_mul_pd(_mm256_maskload_pd(row + 3 * lda, mask), xreg);
+		}
+
+		for (c = cutoff; c < ncols; c += DOUBLE_PER_M256_REG) {
+			xreg = _mm256_loadu_pd(x + c);
+			s0 = madd_pd(_mm256_loadu_pd(row + c), xreg, s0);
+			s1 = madd_pd(_mm256_loadu_pd(row + lda + c), xreg, s1);
+			s2 = madd_pd(_mm256_loadu_pd(row + 2 * lda + c), xreg, s2);
+			s3 = madd_pd(_mm256_loadu_pd(row + 3 * lda + c), xreg, s3);
+		}
+
+		_mm256_storeu_pd(y + r, transpose_sum4_pd(s0, s1, s2, s3));
+	}
+
+	for (; r < nrows; r++) {
+		y[r] = _mm256_ddot(a + (size_t)r * lda, x, ncols);
+	}
+}
+
+TARGET_AVX2
+static void dgemv_cols_pd(int nrows, int ncols, const double *a, int lda, const double *x, double *y)
+{
+	int r, c;
+	const double *col;
+	__m256d xreg;
+	__m256d s0, s1, s2, s3;
+	__m256i mask;
+
+	for (r = 0; r + 4 * DOUBLE_PER_M256_REG <= nrows; r += 4 * DOUBLE_PER_M256_REG) {
+		s0 = s1 = s2 = s3 = _mm256_set1_pd(0);
+
+		for (c = 0; c < ncols; c++) {
+			col = a + (size_t)c * lda + r;
+			xreg = _mm256_broadcast_sd(x + c);
+			s0 = madd_pd(_mm256_loadu_pd(col), xreg, s0);
+			s1 = madd_pd(_mm256_loadu_pd(col + 4), xreg, s1);
+			s2 = madd_pd(_mm256_loadu_pd(col + 8), xreg, s2);
+			s3 = madd_pd(_mm256_loadu_pd(col + 12), xreg, s3);
+		}
+
+		_mm256_storeu_pd(y + r, s0);
+		_mm256_storeu_pd(y + r + 4, s1);
+		_mm256_storeu_pd(y + r + 8, s2);
+		_mm256_storeu_pd(y + r + 12, s3);
+	}
+
+	for (; r + DOUBLE_PER_M256_REG <= nrows; r += DOUBLE_PER_M256_REG) {
+		s0 = _mm256_set1_pd(0);
+
+		for (c = 0; c < ncols; c++) {
+			s0 = madd_pd(_mm256_loadu_pd(a + (size_t)c * lda + r), _mm256_broadcast_sd(x + c), s0);
+		}
+
+		_mm256_storeu_pd(y + r, s0);
+	}
+
+	if (r < nrows) {
+		mask = _mm256_set_mask_epi64(nrows - r - 1);
+		s0 = _mm256_set1_pd(0);
+
+		for (c = 0; c < ncols; c++) {
+			s0 = madd_pd(_mm256_maskload_pd(a + (size_t)c * lda + r, mask), _mm256_broadcast_sd(x + c), s0);
+		}
+
+		_mm256_maskstore_pd(y + r, mask, s0);
+	}
+}
+
+TARGET_AVX2
+void _mm256_dgemv(char order, int nrows, int ncols, const double *a, int lda, const double *x, double *y)
+{
+	if (order == ROW_MAJOR_ORDER) {
+		dgemv_rows_pd(nrows, ncols, a, lda, x, y);
+	} else if (order == COLUMN_MAJOR_ORDER) {
+		dgemv_cols_pd(nrows, ncols, a, lda, x, y);
+	}
+}
+
+#ifdef SUPPORTS_AVX512
+// Fold each register to 256 bits and finish with the AVX2 reductions.
+TARGET_AVX512
+static inline __m256 fold_ps512(__m512 s)
+{
+	return _mm256_add_ps(_mm512_castps512_ps256(s), _mm512_extractf32x8_ps(s, 1));
+}
+
+TARGET_AVX512
+static inline __m256d fold_pd512(__m512d s)
+{
+	return _mm256_add_pd(_mm512_castpd512_pd256(s), _mm512_extractf64x4_pd(s, 1));
+}
+
+TARGET_AVX512
+static void sgemv_rows_ps512(int nrows, int ncols, const float *a, int lda, const float *x, float *y)
+{
+	int r, c;
+	int cutoff = ncols % FLOAT_PER_M512_REG;
+	const float *row;
+	__m512 xreg;
+	__m512 s0, s1, s2, s3, s4, s5, s6, s7;
+	__mmask16 mask = _mm512_set_mask_epi32(cutoff - 1);
+
+	for (r = 0; r + 8 <= nrows; r += 8) {
+		row = a + (size_t)r * lda;
+
+		// With cutoff == 0 the mask is empty and these start the sums at zero.
+		xreg = _mm512_maskz_loadu_ps(mask, x);
+		s0 = _mm512_mul_ps(_mm512_maskz_loadu_ps(mask, row), xreg);
+		s1 = _mm512_mul_ps(_mm512_maskz_loadu_ps(mask, row + lda), xreg);
+		s2 = _mm512_mul_ps(_mm512_maskz_loadu_ps(mask, row + 2 * lda), xreg);
+		s3 = _mm512_mul_ps(_mm512_maskz_loadu_ps(mask, row + 3 * lda), xreg);
+		s4 = _mm512_mul_ps(_mm512_maskz_loadu_ps(mask, row + 4 * lda), xreg);
+		s5 = _mm512_mul_ps(_mm512_maskz_loadu_ps(mask, row + 5 * lda), xreg);
+		s6 = _mm512_mul_ps(_mm512_maskz_loadu_ps(mask, row + 6 * lda), xreg);
+		s7 = _mm512_mul_ps(_mm512_maskz_loadu_ps(mask, row + 7 * lda), xreg);
+
+		for (c = cutoff; c < ncols; c += FLOAT_PER_M512_REG) {
+			xreg = _mm512_loadu_ps(x + c);
+			s0 = _mm512_fmadd_ps(_mm512_loadu_ps(row + c), xreg, s0);
+			s1 = _mm512_fmadd_ps(_mm512_loadu_ps(row + lda + c), xreg, s1);
+			s2 = _mm512_fmadd_ps(_mm512_loadu_ps(row + 2 * lda + c), xreg, s2);
+			s3 = _mm512_fmadd_ps(_mm512_loadu_ps(row + 3 * lda + c), xreg, s3);
+			s4 = _mm512_fmadd_ps(_mm512_loadu_ps(row + 4 * lda + c), xreg, s4);
+			s5 = _mm512_fmadd_ps(_mm512_loadu_ps(row + 5 * lda + c), xreg, s5);
+			s6 = _mm512_fmadd_ps(_mm512_loadu_ps(row + 6 * lda + c), xreg, s6);
+			s7 = _mm512_fmadd_ps(_mm512_loadu_ps(row + 7 * lda + c), xreg, s7);
+		}
+
+		_mm256_storeu_ps(y + r, transpose_sum8_ps(fold_ps512(s0), fold_ps512(s1), fold_ps512(s2), fold_ps512(s3),
+		                                          fold_ps512(s4), fold_ps512(s5), fold_ps512(s6), fold_ps512(s7)));
+	}
+
+	for (; r < nrows; r++) {
+		y[r] = _mm512_fdot(a + (size_t)r * lda, x, ncols);
+	}
+}
+
+TARGET_AVX512
+static void sgemv_cols_ps512(int nrows, int ncols, const float *a, int lda, const float *x, float *y)
+{
+	int r, c;
+	const float *col;
+	__m512 xreg;
+	__m512 s0, s1, s2, s3;
+	__mmask16 mask;
+
+	for (r = 0; r + 4 * FLOAT_PER_M512_REG <= nrows; r += 4 * FLOAT_PER_M512_REG) {
+		s0 = s1 = s2 = s3 = _mm512_set1_ps(0);
+
+		for (c = 0; c < ncols; c++) {
+			col = a + (size_t)c * lda + r;
+			xreg = _mm512_set1_ps(x[c]);
+			s0 = _mm512_fmadd_ps(_mm512_loadu_ps(col), xreg, s0);
+			s1 = _mm512_fmadd_ps(_mm512_loadu_ps(col + 16), xreg, s1);
+			s2 = _mm512_fmadd_ps(_mm512_loadu_ps(col + 32), xreg, s2);
+			s3 = _mm512_fmadd_ps(_mm512_loadu_ps(col + 48), xreg, s3);
+		}
+
+		_mm512_storeu_ps(y + r, s0);
+		_mm512_storeu_ps(y + r + 16, s1);
+		_mm512_storeu_ps(y + r + 32, s2);
+		_mm512_storeu_ps(y + r + 48, s3);
+	}
+
+	for (; r + FLOAT_PER_M512_REG <= nrows; r += FLOAT_PER_M512_REG) {
+		s0 = _mm512_set1_ps(0);
+
+		for (c = 0; c < ncols; c++) {
+			s0 = _mm512_fmadd_ps(_mm512_loadu_ps(a + (size_t)c * lda + r), _mm512_set1_ps(x[c]), s0);
+		}
+
+		_mm512_storeu_ps(y + r, s0);
+	}
+
+	if (r < nrows) {
+		mask = _mm512_set_mask_epi32(nrows - r - 1);
+		s0 = _mm512_set1_ps(0);
+
+		for (c = 0; c < ncols; c++) {
+			s0 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(mask, a + (size_t)c * lda + r), _mm512_set1_ps(x[c]), s0);
+		}
+
+		_mm512_mask_storeu_ps(y + r, mask, s0);
+	}
+}
+
+TARGET_AVX512
+void _mm512_sgemv(char order, int nrows, int ncols, const float *a, int lda, const float *x, float *y)
+{
+	if (order == ROW_MAJOR_ORDER) {
+		sgemv_rows_ps512(nrows, ncols, a, lda, x, y);
+	} else if (order == COLUMN_MAJOR_ORDER) {
+		sgemv_cols_ps512(nrows, ncols, a, lda, x, y);
+	}
+}
+
+TARGET_AVX512
+static void dgemv_rows_pd512(int nrows, int ncols, const double *a, int lda, const double *x, double *y)
+{
+	int r, c;
+	int cutoff = ncols % DOUBLE_PER_M512_REG;
+	const double *row;
+	__m512d xreg;
+	__m512d s0, s1, s2, s3;
+	__mmask8 mask = _mm512_set_mask_epi64(cutoff - 1);
+
+	for (r = 0; r + 4 <= nrows; r += 4) {
+		row = a + (size_t)r * lda;
+
+		xreg = _mm512_maskz_loadu_pd(mask, x);
+		s0 = _mm512_mul_pd(_mm512_maskz_loadu_pd(mask, row), xreg);
+		s1 = _mm512_mul_pd(_mm512_maskz_loadu_pd(mask, row + lda), xreg);
+		s2 = _mm512_mul_pd(_mm512_maskz_loadu_pd(mask, row + 2 * lda), xreg);
+		s3 = _mm512_mul_pd(_mm512_maskz_loadu_pd(mask, row + 3 * lda), xreg);
+
+		for (c = cutoff; c < ncols; c += DOUBLE_PER_M512_REG) {
+			xreg = _mm512_loadu_pd(x + c);
+			s0 = _mm512_fmadd_pd(_mm512_loadu_pd(row + c), xreg, s0);
+			s1 = _mm512_fmadd_pd(_mm512_loadu_pd(row + lda + c), xreg, s1);
+			s2 = _mm512_fmadd_pd(_mm512_loadu_pd(row + 2 * lda + c), xreg, s2);
+			s3 = _mm512_fmadd_pd(_mm512_loadu_pd(row + 3 * lda + c), xreg, s3);
+		}
+
+		_mm256_storeu_pd(y + r, transpose_sum4_pd(fold_pd512(s0), fold_pd512(s1), fold_pd512(s2), fold_pd512(s3)));
+	}
+
+	for (; r < nrows; r++) {
+		y[r] = _mm512_ddot(a + (size_t)r * lda, x, ncols);
+	}
+}
+
+TARGET_AVX512
+static void dgemv_cols_pd512(int nrows, int ncols, const double *a, int lda, const double *x, double *y)
+{
+	int r, c;
+	const double *col;
+	__m512d xreg;
+	__m512d s0, s1, s2, s3;
+	__mmask8 mask;
+
+	for (r = 0; r + 4 * DOUBLE_PER_M512_REG <= nrows; r += 4 * DOUBLE_PER_M512_REG) {
+		s0 = s1 = s2 = s3 = _mm512_set1_pd(0);
+
+		for (c = 0; c < ncols; c++) {
+			col = a + (size_t)c * lda + r;
+			xreg = _mm512_set1_pd(x[c]);
+			s0 = _mm512_fmadd_pd(_mm512_loadu_pd(col), xreg, s0);
+			s1 = _mm512_fmadd_pd(_mm512_loadu_pd(col + 8), xreg, s1);
+			s2 = _mm512_fmadd_pd(_mm512_loadu_pd(col + 16), xreg, s2);
+			s3 = _mm512_fmadd_pd(_mm512_loadu_pd(col + 24), xreg, s3);
+		}
+
+		_mm512_storeu_pd(y + r, s0);
+		_mm512_storeu_pd(y + r + 8, s1);
+		_mm512_storeu_pd(y + r + 16, s2);
+		_mm512_storeu_pd(y + r + 24, s3);
+	}
+
+	for (; r + DOUBLE_PER_M512_REG <= nrows; r += DOUBLE_PER_M512_REG) {
+		s0 = _mm512_set1_pd(0);
+
+		for (c = 0; c < ncols; c++) {
+			s0 = _mm512_fmadd_pd(_mm512_loadu_pd(a + (size_t)c * lda + r), _mm512_set1_pd(x[c]), s0);
+		}
+
+		_mm512_storeu_pd(y + r, s0);
+	}
+
+	if (r < nrows) {
+		mask = _mm512_set_mask_epi64(nrows - r - 1);
+		s0 = _mm512_set1_pd(0);
+
+		for (c = 0; c < ncols; c++) {
+			s0 = _mm512_fmadd_pd(_mm512_maskz_loadu_pd(mask, a + (size_t)c * lda + r), _mm512_set1_pd(x[c]), s0);
+		}
+
+		_mm512_mask_storeu_pd(y + r, mask, s0);
+	}
+}
+
+TARGET_AVX512
+void _mm512_dgemv(char order, int nrows, int ncols, const double *a, int lda, const double *x, double *y)
+{
+	if (order == ROW_MAJOR_ORDER) {
+		dgemv_rows_pd512(nrows, ncols, a, lda, x, y);
+	} else if (order == COLUMN_MAJOR_ORDER) {
+		dgemv_cols_pd512(nrows, ncols, a, lda, x, y);
+	}
+}
+#endif
+
+//----------------------------------------------------------------------------
+// Functions for sparse matrix-vector products y = A x with A stored in CSR
+// or in the SELL-C-sigma format built by sparse.h. SELL rows are grouped in
+// chunks of SELL_CHUNK_PS (SELL_CHUNK_PD) rows stored column by column, so
+// each column of a chunk is one contiguous block of indices and values, and
+// every row of the chunk is reduced in its own lane without horizontal sums.
+// chunkptr holds the offset of every chunk, and perm the original row of
+// every sorted row.
+//----------------------------------------------------------------------------
+
+// Padding entries have a negative column and are never loaded, so they add
+// an exact zero whatever x holds.
+static inline float sell_load_ps(const float *x, int col)
+{
+	return col < 0 ? 0.0f : x[col];
+}
+
+static inline double sell_load_pd(const double *x, int col)
+{
+	return col < 0 ? 0.0 : x[col];
+}
+
+static inline __m128 sell_gather_ps(const float *x, const int *cols)
+{
+	return _mm_setr_ps(sell_load_ps(x, cols[0]), sell_load_ps(x, cols[1]), sell_load_ps(x, cols[2]), sell_load_ps(x, cols[3]));
+}
+
+static inline __m128d sell_gather_pd(const double *x, const int *cols)
+{
+	return _mm_setr_pd(sell_load_pd(x, cols[0]), sell_load_pd(x, cols[1]));
+}
+
+TARGET_AVX2
+static inline __m256 sell_gather_ps256(const float *x, const int *cols)
+{
+	__m256i vindex = _mm256_loadu_si256((const __m256i *)cols);
+	__m256i mask = _mm256_cmpgt_epi32(vindex, _mm256_set1_epi32(-1));
+
+	return _mm256_mask_i32gather_ps(_mm256_setzero_ps(), x, vindex, _mm256_castsi256_ps(mask), 4);
+}
+
+TARGET_AVX2
+static inline __m256d sell_gather_pd256(const double *x, const int *cols)
+{
+	__m128i vindex = _mm_loadu_si128((const __m128i *)cols);
+	__m256i mask = _mm256_cvtepi32_epi64(_mm_cmpgt_epi32(vindex, _mm_set1_epi32(-1)));
+
+	return _mm256_mask_i32gather_pd(_mm256_setzero_pd(), x, vindex, _mm256_castsi256_pd(mask), 8);
+}
+
+#ifdef SUPPORTS_AVX512
+TARGET_AVX512
+static inline __m512 sell_gather_ps512(const float *x, const int *cols)
+{
+	__m512i vindex = _mm512_loadu_si512(cols);
+	__mmask16 mask = _mm512_cmpge_epi32_mask(vindex, _mm512_setzero_si512());
+
+	return _mm512_mask_i32gather_ps(_mm512_setzero_ps(), mask, vindex, x, 4);
+}
+
+TARGET_AVX512
+static inline __m512d sell_gather_pd512(const double *x, const int *cols)
+{
+	__m256i vindex = _mm256_loadu_si256((const __m256i *)cols);
+	__mmask8 mask = (__mmask8)_mm512_cmpge_epi32_mask(_mm512_zextsi256_si512(vindex), _mm512_setzero_si512());
+
+	return _mm512_mask_i32gather_pd(_mm512_setzero_pd(), mask, vindex, x, 8);
+}
+#endif
+
+static void scatter_chunk_ps(float *y, const int *perm, const float *buffer, int len)
+{
+	for (int k = 0; k < len; k++) {
+		y[perm[k]] = buffer[k];
+	}
+}
+
+static void scatter_chunk_pd(double *y, const int *perm, const double *buffer, int len)
+{
+	for (int k = 0; k < len; k++) {
+		y[perm[k]] = buffer[k];
+	}
+}
+
+void _mm_ssellmv(int nrows, const int *chunkptr, const int *perm, const int *colind, const float *values, const float *x, float *y)
+{
+	int k, j, end, row;
+	const int *cols;
+	const float *vals;
+	float buffer[SELL_CHUNK_PS];
+	__m128 s0, s1, s2, s3;
+
+	for (k = 0, row = 0; row < nrows; k++, row += SELL_CHUNK_PS) {
+		s0 = s1 = s2 = s3 = _mm_set1_ps(0);
+		end = chunkptr[k + 1];
+
+		for (j = chunkptr[k]; j < end; j += SELL_CHUNK_PS) {
+			cols = colind + j;
+			vals = values + j;
+			s0 = _mm_add_ps(s0, _mm_mul_ps(sell_gather_ps(x, cols), _mm_loadu_ps(vals)));
+			s1 = _mm_add_ps(s1, _mm_mul_ps(sell_gather_ps(x, cols + 4), _mm_loadu_ps(vals + 4)));
+			s2 = _mm_add_ps(s2, _mm_mul_ps(sell_gather_ps(x, cols + 8), _mm_loadu_ps(vals + 8)));
+			s3 = _mm_add_ps(s3, _mm_mul_ps(sell_gather_ps(x, cols + 12), _mm_loadu_ps(vals + 12)));
+		}
+
+		_mm_storeu_ps(buffer, s0);
+		_mm_storeu_ps(buffer + 4, s1);
+		_mm_storeu_ps(buffer + 8, s2);
+		_mm_storeu_ps(buffer + 12, s3);
+		scatter_chunk_ps(y, perm + row, buffer, nrows - row < SELL_CHUNK_PS ? nrows - row : SELL_CHUNK_PS);
+	}
+}
+
+void _mm_dsellmv(int nrows, const int *chunkptr, const int *perm, const int *colind, const double *values, const double *x, double *y)
+{
+	int k, j, end, row;
+	const int *cols;
+	const double *vals;
+	double buffer[SELL_CHUNK_PD];
+	__m128d s0, s1, s2, s3;
+
+	for (k = 0, row = 0; row < nrows; k++, row += SELL_CHUNK_PD) {
+		s0 = s1 = s2 = s3 = _mm_set1_pd(0);
+		end = chunkptr[k + 1];
+
+		for (j = chunkptr[k]; j < end; j += SELL_CHUNK_PD) {
+			cols = colind + j;
+			vals = values + j;
+			s0 = _mm_add_pd(s0, _mm_mul_pd(sell_gather_pd(x, cols), _mm_loadu_pd(vals)));
+			s1 = _mm_add_pd(s1, _mm_mul_pd(sell_gather_pd(x, cols + 2), _mm_loadu_pd(vals + 2)));
+			s2 = _mm_add_pd(s2, _mm_mul_pd(sell_gather_pd(x, cols + 4), _mm_loadu_pd(vals + 4)));
+			s3 = _mm_add_pd(s3, _mm_mul_pd(sell_gather_pd(x, cols + 6), _mm_loadu_pd(vals + 6)));
+		}
+
+		_mm_storeu_pd(buffer, s0);
+		_mm_storeu_pd(buffer + 2, s1);
+		_mm_storeu_pd(buffer + 4, s2);
+		_mm_storeu_pd(buffer + 6, s3);
+		scatter_chunk_pd(y, perm + row, buffer, nrows - row < SELL_CHUNK_PD ? nrows - row : SELL_CHUNK_PD);
+	}
+}
+
+TARGET_AVX2
+void _mm256_ssellmv(int nrows, const int *chunkptr, const int *perm, const int *colind, const float *values, const float *x, float *y)
+{
+	int k, j, end, row;
+	const int *cols;
+	const float *vals;
+	float buffer[SELL_CHUNK_PS];
+	__m256 s0, s1;
+
+	for (k = 0, row = 0; row < nrows; k++, row += SELL_CHUNK_PS) {
+		s0 = s1 = _mm256_set1_ps(0);
+		end = chunkptr[k + 1];
+
+		for (j = chunkptr[k]; j < end; j += SELL_CHUNK_PS) {
+			cols = colind + j;
+			vals = values + j;
+			s0 = madd_ps(sell_gather_ps256(x, cols), _mm256_loadu_ps(vals), s0);
+			s1 = madd_ps(sell_gather_ps256(x, cols + 8), _mm256_loadu_ps(vals + 8), s1);
+		}
+
+		_mm256_storeu_ps(buffer, s0);
+		_mm256_storeu_ps(buffer + 8, s1);
+		scatter_chunk_ps(y, perm + row, buffer, nrows - row < SELL_CHUNK_PS ? nrows - row : SELL_CHUNK_PS);
+	}
+}
+
+TARGET_AVX2
+void _mm256_dsellmv(int nrows, const int *chunkptr, const int *perm, const int *colind, const double *values, const double *x, double *y)
+{
+	int k, j, end, row;
+	const int *cols;
+	const double *vals;
+	double buffer[SELL_CHUNK_PD];
+	__m256d s0, s1;
+
+	for (k = 0, row = 0; row < nrows; k++, row += SELL_CHUNK_PD) {
+		s0 = s1 = _mm256_set1_pd(0);
+		end = chunkptr[k + 1];
+
+		for (j = chunkptr[k]; j < end; j += SELL_CHUNK_PD) {
+			cols = colind + j;
+			vals = values + j;
+			s0 = madd_pd(sell_gather_pd256(x, cols), _mm256_loadu_pd(vals), s0);
+			s1 = madd_pd(sell_gather_pd256(x, cols + 4), _mm256_loadu_pd(vals + 4), s1);
+		}
+
+		_mm256_storeu_pd(buffer, s0);
+		_mm256_storeu_pd(buffer + 4, s1);
+		scatter_chunk_pd(y, perm + row, buffer, nrows - row < SELL_CHUNK_PD ? nrows - row : SELL_CHUNK_PD);
+	}
+}
+
+#ifdef SUPPORTS_AVX512
+// A chunk is one register wide, so alternate columns go to two accumulators
+// to keep more than one gather in flight, and the results are scattered
+// straight to y through perm.
+TARGET_AVX512
+void _mm512_ssellmv(int nrows, const int *chunkptr, const int *perm, const int *colind, const float *values, const float *x, float *y)
+{
+	int k, j, end, row;
+	__m512 s0, s1;
+	__mmask16 mask;
+
+	for (k = 0, row = 0; row < nrows; k++, row += SELL_CHUNK_PS) {
+		s0 = s1 = _mm512_set1_ps(0);
+		end = chunkptr[k + 1];
+
+		for (j = chunkptr[k]; j + SELL_CHUNK_PS < end; j += 2 * SELL_CHUNK_PS) {
+			s0 = _mm512_fmadd_ps(sell_gather_ps512(x, colind + j), _mm512_loadu_ps(values + j), s0);
+			s1 = _mm512_fmadd_ps(sell_gather_ps512(x, colind + j + SELL_CHUNK_PS), _mm512_loadu_ps(values + j + SELL_CHUNK_PS), s1);
+		}
+
+		if (j < end) {
+			s0 = _mm512_fmadd_ps(sell_gather_ps512(x, colind + j), _mm512_loadu_ps(values + j), s0);
+		}
+
+		mask = _mm512_set_mask_epi32((nrows - row < SELL_CHUNK_PS ? nrows - row : SELL_CHUNK_PS) - 1);
+		_mm512_mask_i32scatter_ps(y, mask, _mm512_maskz_loadu_epi32(mask, perm + row), _mm512_add_ps(s0, s1), 4);
+	}
+}
+
+TARGET_AVX512
+void _mm512_dsellmv(int nrows, const int *chunkptr, const int *perm, const int *colind, const double *values, const double *x, double *y)
+{
+	int k, j, end, row;
+	__m512d s0, s1;
+	__mmask8 mask;
+
+	for (k = 0, row = 0; row < nrows; k++, row += SELL_CHUNK_PD) {
+		s0 = s1 = _mm512_set1_pd(0);
+		end = chunkptr[k + 1];
+
+		for (j = chunkptr[k]; j + SELL_CHUNK_PD < end; j += 2 * SELL_CHUNK_PD) {
+			s0 = _mm512_fmadd_pd(sell_gather_pd512(x, colind + j), _mm512_loadu_pd(values + j), s0);
+			s1 = _mm512_fmadd_pd(sell_gather_pd512(x, colind + j + SELL_CHUNK_PD), _mm512_loadu_pd(values + j + SELL_CHUNK_PD), s1);
+		}
+
+		if (j < end) {
+			s0 = _mm512_fmadd_pd(sell_gather_pd512(x, colind + j), _mm512_loadu_pd(values + j), s0);
+		}
+
+		mask = _mm512_set_mask_epi64((nrows - row < SELL_CHUNK_PD ? nrows - row : SELL_CHUNK_PD) - 1);
+		_mm512_mask_i32scatter_pd(y, mask, _mm512_castsi512_si256(_mm512_maskz_loadu_epi32(mask, perm + row)), _mm512_add_pd(s0, s1), 8);
+	}
+}
+#endif
+
+// CSR rows are reduced a block at a time. Every row of the block keeps its
+// own accumulator, and one transpose-and-add turns the block into the
+// register of its sums, so short rows do not each pay for a horizontal sum
+// and a call through the dispatch table. Rows left over after the last block
+// are reduced one at a time.
+static inline __m128 csr_row_ps128(const float *x, const int *colind, const float *values, const int *rowptr)
+{
+	int i;
+	int begin = rowptr[0];
+	int end = rowptr[1];
+	int cutoff = (end - begin) % FLOAT_PER_M128_REG;
+	__m128 sreg = _mm_set1_ps(0);
+
+	if (cutoff > 0) {
+		sreg = _mm_mul_ps(gather_partial_ps(x, colind + begin, cutoff), load_partial_ps(values + begin, cutoff));
+	}
+
+	for (i = begin + cutoff; i < end; i += FLOAT_PER_M128_REG) {
+		sreg = _mm_add_ps(sreg, _mm_mul_ps(gather_ps(x, colind + i), _mm_loadu_ps(values + i)));
+	}
+
+	return sreg;
+}
+
+static inline __m128d csr_row_pd128(const double *x, const int *colind, const double *values, const int *rowptr)
+{
+	int i;
+	int begin = rowptr[0];
+	int end = rowptr[1];
+	int cutoff = (end - begin) % DOUBLE_PER_M128_REG;
+	__m128d sreg = _mm_set1_pd(0);
+
+	if (cutoff > 0) {
+		sreg = _mm_mul_pd(_mm_load_sd(x + colind[begin]), _mm_load_sd(values + begin));
+	}
+
+	for (i = begin + cutoff; i < end; i += DOUBLE_PER_M128_REG) {
+		sreg = _mm_add_pd(sreg, _mm_mul_pd(gather_pd(x, colind + i), _mm_loadu_pd(values + i)));
+	}
+
+	return sreg;
+}
+
+void _mm_scsrmv(int nrows, const int *rowptr, const int *colind, const float *values, const float *x, float *y)
+{
+	int r;
+	__m128 s0, s1, s2, s3;
+
+	for (r = 0; r + 4 <= nrows; r += 4) {
+		s0 = csr_row_ps128(x, colind, values, rowptr + r);
+		s1 = csr_row_ps128(x, colind, values, rowptr + r + 1);
+		s2 = csr_row_ps128(x, colind, values, rowptr + r + 2);
+		s3 = csr_row_ps128(x, colind, values, rowptr + r + 3);
+
+		_mm_storeu_ps(y + r, transpose_sum4_ps128(s0, s1, s2, s3));
+	}
+
+	for (; r < nrows; r++) {
+		y[r] = _mm_register_sum_ps(csr_row_ps128(x, colind, values, rowptr + r));
+	}
+}
+
+void _mm_dcsrmv(int nrows, const int *rowptr, const int *colind, const double *values, const double *x, double *y)
+{
+	int r;
+	__m128d s0, s1;
+
+	for (r = 0; r + 2 <= nrows; r += 2) {
+		s0 = csr_row_pd128(x, colind, values, rowptr + r);
+		s1 = csr_row_pd128(x, colind, values, rowptr + r + 1);
+
+		_mm_storeu_pd(y + r, _mm_hadd_pd(s0, s1));
+	}
+
+	for (; r < nrows; r++) {
+		y[r] = _mm_register_sum_pd(csr_row_pd128(x, colind, values, rowptr + r));
+	}
+}
+
+TARGET_AVX2
+static inline __m256 csr_row_ps256(const float *x, const int *colind, const float *values, const int *rowptr)
+{
+	int i;
+	int begin = rowptr[0];
+	int end = rowptr[1];
+	int cutoff = (end - begin) % FLOAT_PER_M256_REG;
+	__m256 sreg = _mm256_set1_ps(0);
+	__m256i vindex;
+	__m256i mask;
+
+	if (cutoff > 0) {
+		mask = _mm256_set_mask_epi32(cutoff - 1);
+		vindex = _mm256_maskload_epi32(colind + begin, mask);
+		sreg = _mm256_mul_ps(_mm256_mask_i32gather_ps(sreg, x, vindex, _mm256_castsi256_ps(mask), 4), _mm256_maskload_ps(values + begin, mask));
+	}
+
+	for (i = begin + cutoff; i < end; i += FLOAT_PER_M256_REG) {
+		vindex = _mm256_loadu_si256((const __m256i *)(colind + i));
+		sreg = madd_ps(_mm256_i32gather_ps(x, vindex, 4), _mm256_loadu_ps(values + i), sreg);
+	}
+
+	return sreg;
+}
+
+TARGET_AVX2
+static inline __m256d csr_row_pd256(const double *x, const int *colind, const double *values, const int *rowptr)
+{
+	int i;
+	int begin = rowptr[0];
+	int end = rowptr[1];
+	int cutoff = (end - begin) % DOUBLE_PER_M256_REG;
+	__m256d sreg = _mm256_set1_pd(0);
+	__m128i vindex;
+	__m256i mask;
+
+	if (cutoff > 0) {
+		mask = _mm256_set_mask_epi64(cutoff - 1);
+		vindex = _mm_maskload_epi32(colind + begin, _mm_set_mask_epi32(cutoff - 1));
+		sreg = _mm256_mul_pd(_mm256_mask_i32gather_pd(sreg, x, vindex, _mm256_castsi256_pd(mask), 8), _mm256_maskload_pd(values + begin, mask));
+	}
+
+	for (i = begin + cutoff; i < end; i += DOUBLE_PER_M256_REG) {
+		vindex = _mm_loadu_si128((const __m128i *)(colind + i));
+		sreg = madd_pd(_mm256_i32gather_pd(x, vindex, 8), _mm256_loadu_pd(values + i), sreg);
+	}
+
+	return sreg;
+}
+
+TARGET_AVX2
+void _mm256_scsrmv(int nrows, const int *rowptr, const int *colind, const float *values, const float *x, float *y)
+{
+	int r;
+	__m256 s0, s1, s2, s3, s4, s5, s6, s7;
+
+	for (r = 0; r + 8 <= nrows; r += 8) {
+		s0 = csr_row_ps256(x, colind, values, rowptr + r);
+		s1 = csr_row_ps256(x, colind, values, rowptr + r + 1);
+		s2 = csr_row_ps256(x, colind, values, rowptr + r + 2);
+		s3 = csr_row_ps256(x, colind, values, rowptr + r + 3);
+		s4 = csr_row_ps256(x, colind, values, rowptr + r + 4);
+		s5 = csr_row_ps256(x, colind, values, rowptr + r + 5);
+		s6 = csr_row_ps256(x, colind, values, rowptr + r + 6);
+		s7 = csr_row_ps256(x, colind, values, rowptr + r + 7);
+
+		_mm256_storeu_ps(y + r, transpose_sum8_ps(s0, s1, s2, s3, s4, s5, s6, s7));
+	}
+
+	for (; r < nrows; r++) {
+		y[r] = _mm256_register_sum_ps(csr_row_ps256(x, colind, values, rowptr + r));
+	}
+}
+
+TARGET_AVX2
+void _mm256_dcsrmv(int nrows, const int *rowptr, const int *colind, const double *values, const double *x, double *y)
+{
+	int r;
+	__m256d s0, s1, s2, s3;
+
+	for (r = 0; r + 4 <= nrows; r += 4) {
+		s0 = csr_row_pd256(x, colind, values, rowptr + r);
+		s1 = csr_row_pd256(x, colind, values, rowptr + r + 1);
+		s2 = csr_row_pd256(x, colind, values, rowptr + r + 2);
+		s3 = csr_row_pd256(x, colind, values, rowptr + r + 3);
+
+		_mm256_storeu_pd(y + r, transpose_sum4_pd(s0, s1, s2, s3));
+	}
+
+	for (; r < nrows; r++) {
+		y[r] = _mm256_register_sum_pd(csr_row_pd256(x, colind, values, rowptr + r));
+	}
+}
+
+#ifdef SUPPORTS_AVX512
+TARGET_AVX512
+static inline __m512 csr_row_ps512(const float *x, const int *colind, const float *values, const int *rowptr)
+{
+	int i;
+	int begin = rowptr[0];
+	int end = rowptr[1];
+	int cutoff = (end - begin) % FLOAT_PER_M512_REG;
+	__m512 sreg = _mm512_set1_ps(0);
+	__m512i vindex;
+	__mmask16 mask;
+
+	if (cutoff > 0) {
+		mask = _mm512_set_mask_epi32(cutoff - 1);
+		vindex = _mm512_maskz_loadu_epi32(mask, colind + begin);
+		sreg = _mm512_mul_ps(_mm512_mask_i32gather_ps(sreg, mask, vindex, x, 4), _mm512_maskz_loadu_ps(mask, values + begin));
+	}
+
+	for (i = begin + cutoff; i < end; i += FLOAT_PER_M512_REG) {
+		vindex = _mm512_loadu_epi32(colind + i);
+		sreg = _mm512_fmadd_ps(_mm512_i32gather_ps(vindex, x, 4), _mm512_loadu_ps(values + i), sreg);
+	}
+
+	return sreg;
+}
+
+TARGET_AVX512
+static inline __m512d csr_row_pd512(const double *x, const int *colind, const double *values, const int *rowptr)
+{
+	int i;
+	int begin = rowptr[0];
+	int end = rowptr[1];
+	int cutoff = (end - begin) % DOUBLE_PER_M512_REG;
+	__m512d sreg = _mm512_set1_pd(0);
+	__m256i vindex;
+	__mmask8 mask;
+
+	if (cutoff > 0) {
+		mask = _mm512_set_mask_epi64(cutoff - 1);
+		vindex = _mm512_castsi512_si256(_mm512_maskz_loadu_epi32(mask, colind + begin));
+		sreg = _mm512_mul_pd(_mm512_mask_i32gather_pd(sreg, mask, vindex, x, 8), _mm512_maskz_loadu_pd(mask, values + begin));
+	}
+
+	for (i = begin + cutoff; i < end; i += DOUBLE_PER_M512_REG) {
+		vindex = _mm256_loadu_si256((const __m256i *)(colind + i));
+		sreg = _mm512_fmadd_pd(_mm512_i32gather_pd(vindex, x, 8), _mm512_loadu_pd(values + i), sreg);
+	}
+
+	return sreg;
+}
+
+TARGET_AVX512
+void _mm512_scsrmv(int nrows, const int *rowptr, const int *colind, const float *values, const float *x, float *y)
+{
+	int r;
+	__m512 s0, s1, s2, s3, s4, s5, s6, s7;
+
+	for (r = 0; r + 8 <= nrows; r += 8) {
+		s0 = csr_row_ps512(x, colind, values, rowptr + r);
+		s1 = csr_row_ps512(x, colind, values, rowptr + r + 1);
+		s2 = csr_row_ps512(x, colind, values, rowptr + r + 2);
+		s3 = csr_row_ps512(x, colind, values, rowptr + r + 3);
+		s4 = csr_row_ps512(x, colind, values, rowptr + r + 4);
+		s5 = csr_row_ps512(x, colind, values, rowptr + r + 5);
+		s6 = csr_row_ps512(x, colind, values, rowptr + r + 6);
+		s7 = csr_row_ps512(x, colind, values, rowptr + r + 7);
+
+		_mm256_storeu_ps(y + r, transpose_sum8_ps(fold_ps512(s0), fold_ps512(s1), fold_ps512(s2), fold_ps512(s3),
+		                                          fold_ps512(s4), fold_ps512(s5), fold_ps512(s6), fold_ps512(s7)));
+	}
+
+	for (; r < nrows; r++) {
+		y[r] = _mm512_register_sum_ps(csr_row_ps512(x, colind, values, rowptr + r));
+	}
+}
+
+TARGET_AVX512
+void _mm512_dcsrmv(int nrows, const int *rowptr, const int *colind, const double *values, const double *x, double *y)
+{
+	int r;
+	__m512d s0, s1, s2, s3;
+
+	for (r = 0; r + 4 <= nrows; r += 4) {
+		s0 = csr_row_pd512(x, colind, values, rowptr + r);
+		s1 = csr_row_pd512(x, colind, values, rowptr + r + 1);
+		s2 = csr_row_pd512(x, colind, values, rowptr + r + 2);
+		s3 = csr_row_pd512(x, colind, values, rowptr + r + 3);
+
+		_mm256_storeu_pd(y + r, transpose_sum4_pd(fold_pd512(s0), fold_pd512(s1), fold_pd512(s2), fold_pd512(s3)));
+	}
+
+	for (; r < nrows; r++) {
+		y[r] = _mm512_register_sum_pd(csr_row_pd512(x, colind, values, rowptr + r));
+	}
+}
+#endif
+
+//----------------------------------------------------------------------------
+// Indexed kernels with software prefetching. Each pass prefetches the
+// targets of the indices a given number of elements ahead, so the gathers
+// that follow find their lines in cache when the indices span more than the
+// cache. A distance of zero or less selects the default for the width
+// (PREFETCH_DISTANCE_M256 or PREFETCH_DISTANCE_M512). The last distance
+// elements are handled without prefetching, so indices are never read past
+// the end.
+//----------------------------------------------------------------------------
+
+static inline void prefetch_indexed_ps(const float *x, const int *indices, int len)
+{
+	for (int k = 0; k < len; k++) {
+		_mm_prefetch((const char *)(x + indices[k]), _MM_HINT_T0);
+	}
+}
+
+static inline void prefetch_indexed_pd(const double *x, const int *indices, int len)
+{
+	for (int k = 0; k < len; k++) {
+		_mm_prefetch((const char *)(x + indices[k]), _MM_HINT_T0);
+	}
+}
+
+TARGET_AVX2
+float _mm256_fdot_indexed_prefetch(const float *x, const int *xindices, const float *y, int n, int distance)
+{
+	__m256 xreg;
+	__m256 yreg;
+	__m256 sreg = _mm256_set1_ps(0);
+	__m256i vindex;
+	__m256i mask;
+	int i;
+	int cutoff = n % FLOAT_PER_M256_REG;
+
+	if (distance <= 0) {
+		distance = PREFETCH_DISTANCE_M256;
+	}
+
+	if (cutoff > 0) {
+		mask = _mm256_set_mask_epi32(cutoff - 1);
+		vindex = _mm256_maskload_epi32(xindices, mask);
+		yreg = _mm256_maskload_ps(y, mask);
+		xreg = _mm256_mask_i32gather_ps(sreg, x, vindex, _mm256_castsi256_ps(mask), 4);
+
+		sreg = _mm256_mul_ps(xreg, yreg);
+	}
+
+	for (i = cutoff; i + distance + FLOAT_PER_M256_REG <= n; i += FLOAT_PER_M256_REG) {
+		prefetch_indexed_ps(x, xindices + i + distance, FLOAT_PER_M256_REG);
+
+		vindex = _mm256_loadu_si256((const __m256i *)(xindices + i));
+		yreg = _mm256_loadu_ps(y + i);
+		xreg = _mm256_i32gather_ps(x, vindex, 4);
+
+		sreg = madd_ps(xreg, yreg, sreg);
+	}
+
+	for (; i < n; i += FLOAT_PER_M256_REG) {
+		vindex = _mm256_loadu_si256((const __m256i *)(xindices + i));
+		yreg = _mm256_loadu_ps(y + i);
+		xreg = _mm256_i32gather_ps(x, vindex, 4);
+
+		sreg = madd_ps(xreg, yreg, sreg);
+	}
+
+	return _mm256_register_sum_ps(sreg);
+}
+
+TARGET_AVX2
+float _mm256_fdot_indexed2_prefetch(const float *x, const int *xindices, const float *y, const int *yindices, int n, int distance)
+{
+	__m256 xreg;
+	__m256 yreg;
+	__m256 sreg = _mm256_set1_ps(0);
+	__m256i xindex, yindex;
+	__m256i mask;
+	int i;
+	int cutoff = n % FLOAT_PER_M256_REG;
+
+	if (distance <= 0) {
+		distance = PREFETCH_DISTANCE_M256;
+	}
+
+	if (cutoff > 0) {
+		mask = _mm256_set_mask_epi32(cutoff - 1);
+		xindex = _mm256_maskload_epi32(xindices, mask);
+		yindex = _mm256_maskload_epi32(yindices, mask);
+
+		xreg = _mm256_mask_i32gather_ps(sreg, x, xindex, _mm256_castsi256_ps(mask), 4);
+		yreg = _mm256_mask_i32gather_ps(sreg, y, yindex, _mm256_castsi256_ps(mask), 4);
+
+		sreg = _mm256_mul_ps(xreg, yreg);
+	}
+
+	for (i = cutoff; i + distance + FLOAT_PER_M256_REG <= n; i += FLOAT_PER_M256_REG) {
+		prefetch_indexed_ps(x, xindices + i + distance, FLOAT_PER_M256_REG);
+		prefetch_indexed_ps(y, yindices + i + distance, FLOAT_PER_M256_REG);
+
+		xindex = _mm256_loadu_si256((const __m256i *)(xindices + i));
+		yindex = _mm256_loadu_si256((const __m256i *)(yindices + i));
+
+		xreg = _mm256_i32gather_ps(x, xindex, 4);
+		yreg = _mm256_i32gather_ps(y, yindex, 4);
+
+		sreg = madd_ps(xreg, yreg, sreg);
+	}
+
+	for (; i < n; i += FLOAT_PER_M256_REG) {
+		xindex = _mm256_loadu_si256((const __m256i *)(xindices + i));
+		yindex = _mm256_loadu_si256((const __m256i *)(yindices + i));
+
+		xreg = _mm256_i32gather_ps(x, xindex, 4);
+		yreg = _mm256_i32gather_ps(y, yindex, 4);
+
+		sreg = madd_ps(xreg, yreg, sreg);
+	}
+
+	return _mm256_register_sum_ps(sreg);
+}
+
+TARGET_AVX2
+double _mm256_ddot_indexed_prefetch(const double *x, const int *xindices, const double *y, int n, int distance)
+{
+	__m256d xreg;
+	__m256d yreg;
+	__m256d sreg = _mm256_set1_pd(0);
+	__m128i vindex;
+	__m256i mask;
+	int i;
+	int cutoff = n % DOUBLE_PER_M256_REG;
+
+	if (distance <= 0) {
+		distance = PREFETCH_DISTANCE_M256;
+	}
+
+	if (cutoff > 0) {
+		mask = _mm256_set_mask_epi64(cutoff - 1);
+		vindex = _mm_maskload_epi32(xindices, _mm_set_mask_epi32(cutoff - 1));
+		yreg = _mm256_maskload_pd(y, mask);
+		xreg = _mm256_mask_i32gather_pd(sreg, x, vindex, _mm256_castsi256_pd(mask), 8);
+
+		sreg = _mm256_mul_pd(xreg, yreg);
+	}
+
+	for (i = cutoff; i + distance + DOUBLE_PER_M256_REG <= n; i += DOUBLE_PER_M256_REG) {
+		prefetch_indexed_pd(x, xindices + i + distance, DOUBLE_PER_M256_REG);
+
+		vindex = _mm_loadu_si128((const __m128i *)(xindices + i));
+		yreg = _mm256_loadu_pd(y + i);
+		xreg = _mm256_i32gather_pd(x, vindex, 8);
+
+		sreg = madd_pd(xreg, yreg, sreg);
+	}
+
+	for (; i < n; i += DOUBLE_PER_M256_REG) {
+		vindex = _mm_loadu_si128((const __m128i *)(xindices + i));
+		yreg = _mm256_loadu_pd(y + i);
+		xreg = _mm256_i32gather_pd(x, vindex, 8);
+
+		sreg = madd_pd(xreg, yreg, sreg);
+	}
+
+	return _mm256_register_sum_pd(sreg);
+}
+
+TARGET_AVX2
+double _mm256_ddot_indexed2_prefetch(const double *x, const int *xindices, const double *y, const int *yindices, int n, int distance)
+{
+	__m256d xreg;
+	__m256d yreg;
+	__m256d sreg = _mm256_set1_pd(0);
+	__m128i xindex, yindex;
+	__m128i imask;
+	__m256i mask;
+	int i;
+	int cutoff = n % DOUBLE_PER_M256_REG;
+
+	if (distance <= 0) {
+		distance = PREFETCH_DISTANCE_M256;
+	}
+
+	if (cutoff > 0) {
+		mask = _mm256_set_mask_epi64(cutoff - 1);
+		imask = _mm_set_mask_epi32(cutoff - 1);
+		xindex = _mm_maskload_epi32(xindices, imask);
+		yindex = _mm_maskload_epi32(yindices, imask);
+
+		xreg = _mm256_mask_i32gather_pd(sreg, x, xindex, _mm256_castsi256_pd(mask), 8);
+		yreg = _mm256_mask_i32gather_pd(sreg, y, yindex, _mm256_castsi256_pd(mask), 8);
+
+		sreg = _mm256_mul_pd(xreg, yreg);
+	}
+
+	for (i = cutoff; i + distance + DOUBLE_PER_M256_REG <= n; i += DOUBLE_PER_M256_REG) {
+		prefetch_indexed_pd(x, xindices + i + distance, DOUBLE_PER_M256_REG);
+		prefetch_indexed_pd(y, yindices + i + distance, DOUBLE_PER_M256_REG);
+
+		xindex = _mm_loadu_si128((const __m128i *)(xindices + i));
+		yindex = _mm_loadu_si128((const __m128i *)(yindices + i));
+
+		xreg = _mm256_i32gather_pd(x, xindex, 8);
+		yreg = _mm256_i32gather_pd(y, yindex, 8);
+
+		sreg = madd_pd(xreg, yreg, sreg);
+	}
+
+	for (; i < n; i += DOUBLE_PER_M256_REG) {
+		xindex = _mm_loadu_si128((const __m128i *)(xindices + i));
+		yindex = _mm_loadu_si128((const __m128i *)(yindices + i));
+
+		xreg = _mm256_i32gather_pd(x, xindex, 8);
+		yreg = _mm256_i32gather_pd(y, yindex, 8);
+
+		sreg = madd_pd(xreg, yreg, sreg);
+	}
+
+	return _mm256_register_sum_pd(sreg);
+}
+
+// Prefetching runs in storage order across the whole copy, so a target p
+// elements past the start of column j is row iind[p % numi] of column
+// jind[j + p / numi]. Short columns put the target several columns on;
+// targets past the last column are skipped.
+static inline void prefetch_copy2d_ps(const float *src, int nrows, const int *iind, const int *jind, int numi, int numj, int j, int p, int len)
+{
+	int ii = p % numi;
+	int jj = j + p / numi;
+
+	for (int k = 0; k < len && jj < numj; k++) {
+		_mm_prefetch((const char *)(src + (size_t)jind[jj] * nrows + iind[ii]), _MM_HINT_T0);
+
+		if (++ii == numi) {
+			ii = 0;
+			jj++;
+		}
+	}
+}
+
+TARGET_AVX2
+void _mm256_copy2d_indexed_ps_prefetch(float *dst, const float *src, int nrows, const int *iind, const int *jind, int numi, int numj, int distance)
+{
+	int i, j, jdidx;
+	int icutoff = numi % FLOAT_PER_M256_REG;
+	const float *col;
+	__m256i ireg;
+	__m256i mask = _mm256_set_mask_epi32(icutoff - 1);
+	__m256 sreg;
+	__m256 zero = _mm256_set1_ps(0);
+
+	if (distance <= 0) {
+		distance = PREFETCH_DISTANCE_M256;
+	}
+
+	for (j = 0; j < numj; j++) {
+		jdidx = j * numi;
+		col = src + (size_t)jind[j] * nrows;
+
+		if (icutoff > 0) {
+			prefetch_copy2d_ps(src, nrows, iind, jind, numi, numj, j, distance, icutoff);
+
+			ireg = _mm256_maskload_epi32(iind, mask);
+			sreg = _mm256_mask_i32gather_ps(zero, col, ireg, _mm256_castsi256_ps(mask), 4);
+			_mm256_maskstore_ps(dst + jdidx, mask, sreg);
+		}
+
+		for (i = icutoff; i < numi; i += INT32_PER_M256_REG) {
+			prefetch_copy2d_ps(src, nrows, iind, jind, numi, numj, j, i + distance, INT32_PER_M256_REG);
+
+			ireg = _mm256_loadu_si256((const __m256i *)(iind + i));
+			sreg = _mm256_i32gather_ps(col, ireg, 4);
+			_mm256_storeu_ps(dst + jdidx + i, sreg);
+		}
+	}
+}
+
+#ifdef SUPPORTS_AVX512
+TARGET_AVX512
+float _mm512_fdot_indexed_prefetch(const float *x, const int *xindices, const float *y, int n, int distance)
+{
+	__m512 xreg;
+	__m512 yreg;
+	__m512 sreg = _mm512_set1_ps(0);
+	__m512i vindex;
+	__mmask16 mask;
+	int i;
+	int cutoff = n % FLOAT_PER_M512_REG;
+
+	if (distance <= 0) {
+		distance = PREFETCH_DISTANCE_M512;
+	}
+
+	if (cutoff > 0) {
+		mask = _mm512_set_mask_epi32(cutoff - 1);
+		vindex = _mm512_maskz_loadu_epi32(mask, xindices);
+		yreg = _mm512_maskz_loadu_ps(mask, y);
+		xreg = _mm512_mask_i32gather_ps(sreg, mask, vindex, x, 4);
+
+		sreg = _mm512_mul_ps(xreg, yreg);
+	}
+
+	for (i = cutoff; i + distance + FLOAT_PER_M512_REG <= n; i += FLOAT_PER_M512_REG) {
+		prefetch_indexed_ps(x, xindices + i + distance, FLOAT_PER_M512_REG);
+
+		vindex = _mm512_loadu_epi32(xindices + i);
+		yreg = _mm512_loadu_ps(y + i);
+		xreg = _mm512_i32gather_ps(vindex, x, 4);
+
+		sreg = _mm512_fmadd_ps(xreg, yreg, sreg);
+	}
+
+	for (; i < n; i += FLOAT_PER_M512_REG) {
+		vindex = _mm512_loadu_epi32(xindices + i);
+		yreg = _mm512_loadu_ps(y + i);
+		xreg = _mm512_i32gather_ps(vindex, x, 4);
+
+		sreg = _mm512_fmadd_ps(xreg, yreg, sreg);
+	}
+
+	return _mm512_register_sum_ps(sreg);
+}
+
+TARGET_AVX512
+float _mm512_fdot_indexed2_prefetch(const float *x, const int *xindices, const float *y, const int *yindices, int n, int distance)
+{
+	__m512 xreg;
+	__m512 yreg;
+	__m512 sreg = _mm512_set1_ps(0);
+	__m512i xind;
+	__m512i yind;
+	__mmask16 mask;
+	int i;
+	int cutoff = n % FLOAT_PER_M512_REG;
+
+	if (distance <= 0) {
+		distance = PREFETCH_DISTANCE_M512;
+	}
+
+	if (cutoff > 0) {
+		mask = _mm512_set_mask_epi32(cutoff - 1);
+
+		xind = _mm512_maskz_loadu_epi32(mask, xindices);
+		yind = _mm512_maskz_loadu_epi32(mask, yindices);
+
+		xreg = _mm512_mask_i32gather_ps(sreg, mask, xind, x, 4);
+		yreg = _mm512_mask_i32gather_ps(sreg, mask, yind, y, 4);
+
+		sreg = _mm512_mul_ps(xreg, yreg);
+	}
+
+	for (i = cutoff; i + distance + FLOAT_PER_M512_REG <= n; i += FLOAT_PER_M512_REG) {
+		prefetch_indexed_ps(x, xindices + i + distance, FLOAT_PER_M512_REG);
+		prefetch_indexed_ps(y, yindices + i + distance, FLOAT_PER_M512_REG);
+
+		xind = _mm512_loadu_epi32(xindices + i);
+		yind = _mm512_loadu_epi32(yindices + i);
+
+		xreg = _mm512_i32gather_ps(xind, x, 4);
+		yreg = _mm512_i32gather_ps(yind, y, 4);
+
+		sreg = _mm512_fmadd_ps(xreg, yreg, sreg);
+	}
+
+	for (; i < n; i += FLOAT_PER_M512_REG) {
+		xind = _mm512_loadu_epi32(xindices + i);
+		yind = _mm512_loadu_epi32(yindices + i);
+
+		xreg = _mm512_i32gather_ps(xind, x, 4);
+		yreg = _mm512_i32gather_ps(yind, y, 4);
+
+		sreg = _mm512_fmadd_ps(xreg, yreg, sreg);
+	}
+
+	return _mm512_register_sum_ps(sreg);
+}
+
+TARGET_AVX512
+double _mm512_ddot_indexed_prefetch(const double *x, const int *xindices, const double *y, int n, int distance)
+{
+	__m512d xreg;
+	__m512d yreg;
+	__m512d sreg = _mm512_set1_pd(0);
+	__m256i vindex;
+	__mmask8 mask;
+	int i;
+	int cutoff = n % DOUBLE_PER_M512_REG;
+
+	if (distance <= 0) {
+		distance = PREFETCH_DISTANCE_M512;
+	}
+
+	if (cutoff > 0) {
+		mask = _mm512_set_mask_epi64(cutoff - 1);
+		vindex = _mm512_castsi512_si256(_mm512_maskz_loadu_epi32(mask, xindices));
+		yreg = _mm512_maskz_loadu_pd(mask, y);
+		xreg = _mm512_mask_i32gather_pd(sreg, mask, vindex, x, 8);
+
+		sreg = _mm512_mul_pd(xreg, yreg);
+	}
+
+	for (i = cutoff; i + distance + DOUBLE_PER_M512_REG <= n; i += DOUBLE_PER_M512_REG) {
+		prefetch_indexed_pd(x, xindices + i + distance, DOUBLE_PER_M512_REG);
+
+		vindex = _mm256_loadu_si256((const __m256i *)(xindices + i));
+		yreg = _mm512_loadu_pd(y + i);
+		xreg = _mm512_i32gather_pd(vindex, x, 8);
+
+		sreg = _mm512_fmadd_pd(xreg, yreg, sreg);
+	}
+
+	for (; i < n; i += DOUBLE_PER_M512_REG) {
+		vindex = _mm256_loadu_si256((const __m256i *)(xindices + i));
+		yreg = _mm512_loadu_pd(y + i);
+		xreg = _mm512_i32gather_pd(vindex, x, 8);
+
+		sreg = _mm512_fmadd_pd(xreg, yreg, sreg);
+	}
+
+	return _mm512_register_sum_pd(sreg);
+}
+
+TARGET_AVX512
+double _mm512_ddot_indexed2_prefetch(const double *x, const int *xindices, const double *y, const int *yindices, int n, int distance)
+{
+	__m512d xreg;
+	__m512d yreg;
+	__m512d sreg = _mm512_set1_pd(0);
+	__m256i xind;
+	__m256i yind;
+	__mmask8 mask;
+	int i;
+	int cutoff = n % DOUBLE_PER_M512_REG;
+
+	if (distance <= 0) {
+		distance = PREFETCH_DISTANCE_M512;
+	}
+
+	if (cutoff > 0) {
+		mask = _mm512_set_mask_epi64(cutoff - 1);
+
+		xind = _mm512_castsi512_si256(_mm512_maskz_loadu_epi32(mask, xindices));
+		yind = _mm512_castsi512_si256(_mm512_maskz_loadu_epi32(mask, yindices));
+
+		xreg = _mm512_mask_i32gather_pd(sreg, mask, xind, x, 8);
+		yreg = _mm512_mask_i32gather_pd(sreg, mask, yind, y, 8);
+
+		sreg = _mm512_mul_pd(xreg, yreg);
+	}
+
+	for (i = cutoff; i + distance + DOUBLE_PER_M512_REG <= n; i += DOUBLE_PER_M512_REG) {
+		prefetch_indexed_pd(x, xindices + i + distance, DOUBLE_PER_M512_REG);
+		prefetch_indexed_pd(y, yindices + i + distance, DOUBLE_PER_M512_REG);
+
+		xind = _mm256_loadu_si256((const __m256i *)(xindices + i));
+		yind = _mm256_loadu_si256((const __m256i *)(yindices + i));
+
+		xreg = _mm512_i32gather_pd(xind, x, 8);
+		yreg = _mm512_i32gather_pd(yind, y, 8);
+
+		sreg = _mm512_fmadd_pd(xreg, yreg, sreg);
+	}
+
+	for (; i < n; i += DOUBLE_PER_M512_REG) {
+		xind = _mm256_loadu_si256((const __m256i *)(xindices + i));
+		yind = _mm256_loadu_si256((const __m256i *)(yindices + i));
+
+		xreg = _mm512_i32gather_pd(xind, x, 8);
+		yreg = _mm512_i32gather_pd(yind, y, 8);
+
+		sreg = _mm512_fmadd_pd(xreg, yreg, sreg);
+	}
+
+	return _mm512_register_sum_pd(sreg);
+}
+#endif
+
+//----------------------------------------------------------------------------
+// Indexed kernels with emulated gathers. Each register is built from scalar
+// loads and inserts instead of vpgatherdd/vgatherdps, which microcode
+// mitigations make several times slower on some hosts. The arithmetic
+// matches the hardware-gather kernels; dispatch.h picks between the two.
+//----------------------------------------------------------------------------
+
+TARGET_AVX2
+static inline __m256 emu_gather_ps(const float *x, const int *indices)
+{
+	return _mm256_setr_ps(x[indices[0]], x[indices[1]], x[indices[2]], x[indices[3]],
+	                      x[indices[4]], x[indices[5]], x[indices[6]], x[indices[7]]);
+}
+
+TARGET_AVX2
+static inline __m256d emu_gather_pd(const double *x, const int *indices)
+{
+	return _mm256_setr_pd(x[indices[0]], x[indices[1]], x[indices[2]], x[indices[3]]);
+}
+
+TARGET_AVX2
+static inline __m256 emu_sell_gather_ps(const float *x, const int *cols)
+{
+	return _mm256_setr_ps(sell_load_ps(x, cols[0]), sell_load_ps(x, cols[1]), sell_load_ps(x, cols[2]), sell_load_ps(x, cols[3]),
+	                      sell_load_ps(x, cols[4]), sell_load_ps(x, cols[5]), sell_load_ps(x, cols[6]), sell_load_ps(x, cols[7]));
+}
+
+TARGET_AVX2
+static inline __m256d emu_sell_gather_pd(const double *x, const int *cols)
+{
+	return _mm256_setr_pd(sell_load_pd(x, cols[0]), sell_load_pd(x, cols[1]), sell_load_pd(x, cols[2]), sell_load_pd(x, cols[3]));
+}
+
+TARGET_AVX2
+static inline __m256 emu_gather_partial_ps(const float *x, const int *indices, int len)
+{
+	float buffer[FLOAT_PER_M256_REG] = {0};
+
+	for (int k = 0; k < len; k++) {
+		buffer[k] = x[indices[k]];
+	}
+
+	return _mm256_loadu_ps(buffer);
+}
+
+TARGET_AVX2
+static inline __m256d emu_gather_partial_pd(const double *x, const int *indices, int len)
+{
+	double buffer[DOUBLE_PER_M256_REG] = {0};
+
+	for (int k = 0; k < len; k++) {
+		buffer[k] = x[indices[k]];
+	}
+
+	return _mm256_loadu_pd(buffer);
+}
+
+TARGET_AVX2
+float _mm256_fdot_indexed_emu(const float *x, const int *xindices, const float *y, int n)
+{
+	__m256 xreg;
+	__m256 yreg;
+	__m256 sreg = _mm256_set1_ps(0);
+	int i;
+	int cutoff = n % FLOAT_PER_M256_REG;
+
+	if (cutoff > 0) {
+		xreg = emu_gather_partial_ps(x, xindices, cutoff);
+		yreg = _mm256_maskload_ps(y, _mm256_set_mask_epi32(cutoff - 1));
+
+		sreg = _mm256_add_ps(sreg, _mm256_mul_ps(xreg, yreg));
+	}
+
+	for (i = cutoff; i < n; i += FLOAT_PER_M256_REG) {
+		xreg = emu_gather_ps(x, xindices + i);
+		yreg = _mm256_loadu_ps(y + i);
+
+		sreg = _mm256_add_ps(sreg, _mm256_mul_ps(xreg, yreg));
+	}
+
+	return _mm256_register_sum_ps(sreg);
+}
+
+TARGET_AVX2
+float _mm256_fdot_indexed2_emu(const float *x, const int *xindices, const float *y, const int *yindices, int n)
+{
+	__m256 xreg;
+	__m256 yreg;
+	__m256 sreg = _mm256_set1_ps(0);
+	int i;
+	int cutoff = n % FLOAT_PER_M256_REG;
+
+	if (cutoff > 0) {
+		xreg = emu_gather_partial_ps(x, xindices, cutoff);
+		yreg = emu_gather_partial_ps(y, yindices, cutoff);
+
+		sreg = _mm256_add_ps(sreg, _mm256_mul_ps(xreg, yreg));
+	}
+
+	for (i = cutoff; i < n; i += FLOAT_PER_M256_REG) {
+		xreg = emu_gather_ps(x, xindices + i);
+		yreg = emu_gather_ps(y, yindices + i);
+
+		sreg = _mm256_add_ps(sreg, _mm256_mul_ps(xreg, yreg));
+	}
+
+	return _mm256_register_sum_ps(sreg);
+}
+
+TARGET_AVX2
+double _mm256_ddot_indexed_emu(const double *x, const int *xindices, const double *y, int n)
+{
+	__m256d xreg;
+	__m256d yreg;
+	__m256d sreg = _mm256_set1_pd(0);
+	int i;
+	int cutoff = n % DOUBLE_PER_M256_REG;
+
+	if (cutoff > 0) {
+		xreg = emu_gather_partial_pd(x, xindices, cutoff);
+		yreg = _mm256_maskload_pd(y, _mm256_set_mask_epi64(cutoff - 1));
+
+		sreg = _mm256_add_pd(sreg, _mm256_mul_pd(xreg, yreg));
+	}
+
+	for (i = cutoff; i < n; i += DOUBLE_PER_M256_REG) {
+		xreg = emu_gather_pd(x, xindices + i);
+		yreg = _mm256_loadu_pd(y + i);
+
+		sreg = _mm256_add_pd(sreg, _mm256_mul_pd(xreg, yreg));
+	}
+
+	return _mm256_register_sum_pd(sreg);
+}
+
+TARGET_AVX2
+double _mm256_ddot_indexed2_emu(const double *x, const int *xindices, const double *y, const int *yindices, int n)
+{
+	__m256d xreg;
+	__m256d yreg;
+	__m256d sreg = _mm256_set1_pd(0);
+	int i;
+	int cutoff = n % DOUBLE_PER_M256_REG;
+
+	if (cutoff > 0) {
+		xreg = emu_gather_partial_pd(x, xindices, cutoff);
+		yreg = emu_gather_partial_pd(y, yindices, cutoff);
+
+		sreg = _mm256_add_pd(sreg, _mm256_mul_pd(xreg, yreg));
+	}
+
+	for (i = cutoff; i < n; i += DOUBLE_PER_M256_REG) {
+		xreg = emu_gather_pd(x, xindices + i);
+		yreg = emu_gather_pd(y, yindices + i);
+
+		sreg = _mm256_add_pd(sreg, _mm256_mul_pd(xreg, yreg));
+	}
+
+	return _mm256_register_sum_pd(sreg);
+}
+
+TARGET_AVX2
+void _mm256_copy2d_indexed_ps_ld_emu(char order, float *dst, int lddst, const float *src, int ldsrc, const int *iind, const int *jind, int numi, int numj)
+{
+	const int *pos, *lines;
+	int i, j, jdidx;
+	int icutoff, npos, nlines;
+	const float *line;
+	__m256i mask;
+
+	if (copy2d_lines(order, iind, jind, numi, numj, &pos, &lines, &npos, &nlines) != 0) {
+		return;
+	}
+
+	icutoff = npos % FLOAT_PER_M256_REG;
+	mask = _mm256_set_mask_epi32(icutoff - 1);
+
+	for (j = 0; j < nlines; j++) {
+		jdidx = j * lddst;
+		line = src + (size_t)lines[j] * ldsrc;
+
+		if (icutoff > 0) {
+			_mm256_maskstore_ps(dst + jdidx, mask, emu_gather_partial_ps(line, pos, icutoff));
+		}
+
+		for (i = icutoff; i < npos; i += FLOAT_PER_M256_REG) {
+			_mm256_storeu_ps(dst + jdidx + i, emu_gather_ps(line, pos + i));
+		}
+	}
+}
+
+TARGET_AVX2
+void _mm256_copy2d_indexed_ps_emu(float *dst, const float *src, int nrows, const int *iind, const int *jind, int numi, int numj)
+{
+	_mm256_copy2d_indexed_ps_ld_emu(COLUMN_MAJOR_ORDER, dst, numi, src, nrows, iind, jind, numi, numj);
+}
+
+TARGET_AVX2
+float _mm256_sum2d_indexed_ps_emu(const float *src, int nrows, const int *iind, const int *jind, int numi, int numj)
+{
+	const float *col;
+	__m256 sreg = _mm256_set1_ps(0);
+	int i, j;
+	int icutoff = numi % FLOAT_PER_M256_REG;
+
+	for (j = 0; j < numj; j++) {
+		col = src + (size_t)jind[j] * nrows;
+
+		if (icutoff > 0) {
+			sreg = _mm256_add_ps(sreg, emu_gather_partial_ps(col, iind, icutoff));
+		}
+
+		for (i = icutoff; i < numi; i += FLOAT_PER_M256_REG) {
+			sreg = _mm256_add_ps(sreg, emu_gather_ps(col, iind + i));
+		}
+	}
+
+	return _mm256_register_sum_ps(sreg);
+}
+
+TARGET_AVX2
+float _mm256_dot2d_indexed_ps_emu(const float *src, int nrows, const int *iind, const int *jind, int numi, int numj, const float *w)
+{
+	const float *col, *wcol;
+	__m256 sreg = _mm256_set1_ps(0);
+	__m256i mask;
+	int i, j;
+	int icutoff = numi % FLOAT_PER_M256_REG;
+
+	mask = _mm256_set_mask_epi32(icutoff - 1);
+
+	for (j = 0; j < numj; j++) {
+		col = src + (size_t)jind[j] * nrows;
+		wcol = w + (size_t)j * numi;
+
+		if (icutoff > 0) {
+			sreg = _mm256_fmadd_ps(emu_gather_partial_ps(col, iind, icutoff), _mm256_maskload_ps(wcol, mask), sreg);
+		}
+
+		for (i = icutoff; i < numi; i += FLOAT_PER_M256_REG) {
+			sreg = _mm256_fmadd_ps(emu_gather_ps(col, iind + i), _mm256_loadu_ps(wcol + i), sreg);
+		}
+	}
+
+	return _mm256_register_sum_ps(sreg);
+}
+
+TARGET_AVX2
+double _mm256_sum2d_indexed_pd_emu(const double *src, int nrows, const int *iind, const int *jind, int numi, int numj)
+{
+	const double *col;
+	__m256d sreg = _mm256_set1_pd(0);
+	int i, j;
+	int icutoff = numi % DOUBLE_PER_M256_REG;
+
+	for (j = 0; j < numj; j++) {
+		col = src + (size_t)jind[j] * nrows;
+
+		if (icutoff > 0) {
+			sreg = _mm256_add_pd(sreg, emu_gather_partial_pd(col, iind, icutoff));
+		}
+
+		for (i = icutoff; i < numi; i += DOUBLE_PER_M256_REG) {
+			sreg = _mm256_add_pd(sreg, emu_gather_pd(col, iind + i));
+		}
+	}
+
+	return _mm256_register_sum_pd(sreg);
+}
+
+TARGET_AVX2
+double _mm256_dot2d_indexed_pd_emu(const double *src, int nrows, const int *iind, const int *jind, int numi, int numj, const double *w)
+{
+	const double *col, *wcol;
+	__m256d sreg = _mm256_set1_pd(0);
+	__m256i mask;
+	int i, j;
+	int icutoff = numi % DOUBLE_PER_M256_REG;
+
+	mask = _mm256_set_mask_epi64(icutoff - 1);
+
+	for (j = 0; j < numj; j++) {
+		col = src + (size_t)jind[j] * nrows;
+		wcol = w + (size_t)j * numi;
+
+		if (icutoff > 0) {
+			sreg = _mm256_fmadd_pd(emu_gather_partial_pd(col, iind, icutoff), _mm256_maskload_pd(wcol, mask), sreg);
+		}
+
+		for (i = icutoff; i < numi; i += DOUBLE_PER_M256_REG) {
+			sreg = _mm256_fmadd_pd(emu_gather_pd(col, iind + i), _mm256_loadu_pd(wcol + i), sreg);
+		}
+	}
+
+	return _mm256_register_sum_pd(sreg);
+}
+
+TARGET_AVX2
+void _mm256_ssellmv_emu(int nrows, const int *chunkptr, const int *perm, const int *colind, const float *values, const float *x, float *y)
+{
+	int k, j, end, row;
+	float buffer[SELL_CHUNK_PS];
+	__m256 s0, s1;
+
+	for (k = 0, row = 0; row < nrows; k++, row += SELL_CHUNK_PS) {
+		s0 = s1 = _mm256_set1_ps(0);
+		end = chunkptr[k + 1];
+
+		for (j = chunkptr[k]; j < end; j += SELL_CHUNK_PS) {
+			s0 = madd_ps(emu_sell_gather_ps(x, colind + j), _mm256_loadu_ps(values + j), s0);
+			s1 = madd_ps(emu_sell_gather_ps(x, colind + j + 8), _mm256_loadu_ps(values + j + 8), s1);
+		}
+
+		_mm256_storeu_ps(buffer, s0);
+		_mm256_storeu_ps(buffer + 8, s1);
+		scatter_chunk_ps(y, perm + row, buffer, nrows - row < SELL_CHUNK_PS ? nrows - row : SELL_CHUNK_PS);
+	}
+}
+
+TARGET_AVX2
+void _mm256_dsellmv_emu(int nrows, const int *chunkptr, const int *perm, const int *colind, const double *values, const double *x, double *y)
+{
+	int k, j, end, row;
+	double buffer[SELL_CHUNK_PD];
+	__m256d s0, s1;
+
+	for (k = 0, row = 0; row < nrows; k++, row += SELL_CHUNK_PD) {
+		s0 = s1 = _mm256_set1_pd(0);
+		end = chunkptr[k + 1];
+
+		for (j = chunkptr[k]; j < end; j += SELL_CHUNK_PD) {
+			s0 = madd_pd(emu_sell_gather_pd(x, colind + j), _mm256_loadu_pd(values + j), s0);
+			s1 = madd_pd(emu_sell_gather_pd(x, colind + j + 4), _mm256_loadu_pd(values + j + 4), s1);
+		}
+
+		_mm256_storeu_pd(buffer, s0);
+		_mm256_storeu_pd(buffer + 4, s1);
+		scatter_chunk_pd(y, perm + row, buffer, nrows - row < SELL_CHUNK_PD ? nrows - row : SELL_CHUNK_PD);
+	}
+}
+
+TARGET_AVX2
+static inline __m256 emu_csr_row_ps(const float *x, const int *colind, const float *values, const int *rowptr)
+{
+	int i;
+	int begin = rowptr[0];
+	int end = rowptr[1];
+	int cutoff = (end - begin) % FLOAT_PER_M256_REG;
+	__m256 sreg = _mm256_set1_ps(0);
+
+	if (cutoff > 0) {
+		sreg = _mm256_mul_ps(emu_gather_partial_ps(x, colind + begin, cutoff), _mm256_maskload_ps(values + begin, _mm256_set_mask_epi32(cutoff - 1)));
+	}
+
+	for (i = begin + cutoff; i < end; i += FLOAT_PER_M256_REG) {
+		sreg = madd_ps(emu_gather_ps(x, colind + i), _mm256_loadu_ps(values + i), sreg);
+	}
+
+	return sreg;
+}
+
+TARGET_AVX2
+static inline __m256d emu_csr_row_pd(const double *x, const int *colind, const double *values, const int *rowptr)
+{
+	int i;
+	int begin = rowptr[0];
+	int end = rowptr[1];
+	int cutoff = (end - begin) % DOUBLE_PER_M256_REG;
+	__m256d sreg = _mm256_set1_pd(0);
+
+	if (cutoff > 0) {
+		sreg = _mm256_mul_pd(emu_gather_partial_pd(x, colind + begin, cutoff), _mm256_maskload_pd(values + begin, _mm256_set_mask_epi64(cutoff - 1)));
+	}
+
+	for (i = begin + cutoff; i < end; i += DOUBLE_PER_M256_REG) {
+		sreg = madd_pd(emu_gather_pd(x, colind + i), _mm256_loadu_pd(values + i), sreg);
+	}
+
+	return sreg;
+}
+
+TARGET_AVX2
+void _mm256_scsrmv_emu(int nrows, const int *rowptr, const int *colind, const float *values, const float *x, float *y)
+{
+	int r;
+	__m256 s0, s1, s2, s3, s4, s5, s6, s7;
+
+	for (r = 0; r + 8 <= nrows; r += 8) {
+		s0 = emu_csr_row_ps(x, colind, values, rowptr + r);
+		s1 = emu_csr_row_ps(x, colind, values, rowptr + r + 1);
+		s2 = emu_csr_row_ps(x, colind, values, rowptr + r + 2);
+		s3 = emu_csr_row_ps(x, colind, values, rowptr + r + 3);
+		s4 = emu_csr_row_ps(x, colind, values, rowptr + r + 4);
+		s5 = emu_csr_row_ps(x, colind, values, rowptr + r + 5);
+		s6 = emu_csr_row_ps(x, colind, values, rowptr + r + 6);
+		s7 = emu_csr_row_ps(x, colind, values, rowptr + r + 7);
+
+		_mm256_storeu_ps(y + r, transpose_sum8_ps(s0, s1, s2, s3, s4, s5, s6, s7));
+	}
+
+	for (; r < nrows; r++) {
+		y[r] = _mm256_register_sum_ps(emu_csr_row_ps(x, colind, values, rowptr + r));
+	}
+}
+
+TARGET_AVX2
+void _mm256_dcsrmv_emu(int nrows, const int *rowptr, const int *colind, const double *values, const double *x, double *y)
+{
+	int r;
+	__m256d s0, s1, s2, s3;
+
+	for (r = 0; r + 4 <= nrows; r += 4) {
+		s0 = emu_csr_row_pd(x, colind, values, rowptr + r);
+		s1 = emu_csr_row_pd(x, colind, values, rowptr + r + 1);
+		s2 = emu_csr_row_pd(x, colind, values, rowptr + r + 2);
+		s3 = emu_csr_row_pd(x, colind, values, rowptr + r + 3);
+
+		_mm256_storeu_pd(y + r, transpose_sum4_pd(s0, s1, s2, s3));
+	}
+
+	for (; r < nrows; r++) {
+		y[r] = _mm256_register_sum_pd(emu_csr_row_pd(x, colind, values, rowptr + r));
+	}
+}
+
+#ifdef SUPPORTS_AVX512
+TARGET_AVX512
+static inline __m512 emu_gather_ps512(const float *x, const int *indices)
+{
+	return _mm512_insertf32x8(_mm512_castps256_ps512(emu_gather_ps(x, indices)), emu_gather_ps(x, indices + 8), 1);
+}
+
+TARGET_AVX512
+static inline __m512d emu_gather_pd512(const double *x, const int *indices)
+{
+	return _mm512_insertf64x4(_mm512_castpd256_pd512(emu_gather_pd(x, indices)), emu_gather_pd(x, indices + 4), 1);
+}
+
+TARGET_AVX512
+static inline __m512 emu_sell_gather_ps512(const float *x, const int *cols)
+{
+	return _mm512_insertf32x8(_mm512_castps256_ps512(emu_sell_gather_ps(x, cols)), emu_sell_gather_ps(x, cols + 8), 1);
+}
+
+TARGET_AVX512
+static inline __m512d emu_sell_gather_pd512(const double *x, const int *cols)
+{
+	return _mm512_insertf64x4(_mm512_castpd256_pd512(emu_sell_gather_pd(x, cols)), emu_sell_gather_pd(x, cols + 4), 1);
+}
+
+TARGET_AVX512
+static inline __m512 emu_gather_partial_ps512(const float *x, const int *indices, int len)
+{
+	float buffer[FLOAT_PER_M512_REG] = {0};
+
+	for (int k = 0; k < len; k++) {
+		buffer[k] = x[indices[k]];
+	}
+
+	return _mm512_loadu_ps(buffer);
+}
+
+TARGET_AVX512
+static inline __m512d emu_gather_partial_pd512(const double *x, const int *indices, int len)
+{
+	double buffer[DOUBLE_PER_M512_REG] = {0};
+
+	for (int k = 0; k < len; k++) {
+		buffer[k] = x[indices[k]];
+	}
+
+	return _mm512_loadu_pd(buffer);
+}
+
+TARGET_AVX512
+float _mm512_fdot_indexed_emu(const float *x, const int *xindices, const float *y, int n)
+{
+	__m512 xreg;
+	__m512 yreg;
+	__m512 sreg = _mm512_set1_ps(0);
+	int i;
+	int cutoff = n % FLOAT_PER_M512_REG;
+
+	if (cutoff > 0) {
+		xreg = emu_gather_partial_ps512(x, xindices, cutoff);
+		yreg = _mm512_maskz_loadu_ps(_mm512_set_mask_epi32(cutoff - 1), y);
+
+		sreg = _mm512_fmadd_ps(xreg, yreg, sreg);
+	}
+
+	for (i = cutoff; i < n; i += FLOAT_PER_M512_REG) {
+		xreg = emu_gather_ps512(x, xindices + i);
+		yreg = _mm512_loadu_ps(y + i);
+
+		sreg = _mm512_fmadd_ps(xreg, yreg, sreg);
+	}
+
+	return _mm512_register_sum_ps(sreg);
+}
+
+TARGET_AVX512
+float _mm512_fdot_indexed2_emu(const float *x, const int *xindices, const float *y, const int *yindices, int n)
+{
+	__m512 xreg;
+	__m512 yreg;
+	__m512 sreg = _mm512_set1_ps(0);
+	int i;
+	int cutoff = n % FLOAT_PER_M512_REG;
+
+	if (cutoff > 0) {
+		xreg = emu_gather_partial_ps512(x, xindices, cutoff);
+		yreg = emu_gather_partial_ps512(y, yindices, cutoff);
+
+		sreg = _mm512_fmadd_ps(xreg, yreg, sreg);
+	}
+
+	for (i = cutoff; i < n; i += FLOAT_PER_M512_REG) {
+		xreg = emu_gather_ps512(x, xindices + i);
+		yreg = emu_gather_ps512(y, yindices + i);
+
+		sreg = _mm512_fmadd_ps(xreg, yreg, sreg);
+	}
+
+	return _mm512_register_sum_ps(sreg);
+}
+
+TARGET_AVX512
+double _mm512_ddot_indexed_emu(const double *x, const int *xindices, const double *y, int n)
+{
+	__m512d xreg;
+	__m512d yreg;
+	__m512d sreg = _mm512_set1_pd(0);
+	int i;
+	int cutoff = n % DOUBLE_PER_M512_REG;
+
+	if (cutoff > 0) {
+		xreg = emu_gather_partial_pd512(x, xindices, cutoff);
+		yreg = _mm512_maskz_loadu_pd(_mm512_set_mask_epi64(cutoff - 1), y);
+
+		sreg = _mm512_fmadd_pd(xreg, yreg, sreg);
+	}
+
+	for (i = cutoff; i < n; i += DOUBLE_PER_M512_REG) {
+		xreg = emu_gather_pd512(x, xindices + i);
+		yreg = _mm512_loadu_pd(y + i);
+
+		sreg = _mm512_fmadd_pd(xreg, yreg, sreg);
+	}
+
+	return _mm512_register_sum_pd(sreg);
+}
+
+TARGET_AVX512
+double _mm512_ddot_indexed2_emu(const double *x, const int *xindices, const double *y, const int *yindices, int n)
+{
+	__m512d xreg;
+	__m512d yreg;
+	__m512d sreg = _mm512_set1_pd(0);
+	int i;
+	int cutoff = n % DOUBLE_PER_M512_REG;
+
+	if (cutoff > 0) {
+		xreg = emu_gather_partial_pd512(x, xindices, cutoff);
+		yreg = emu_gather_partial_pd512(y, yindices, cutoff);
+
+		sreg = _mm512_fmadd_pd(xreg, yreg, sreg);
+	}
+
+	for (i = cutoff; i < n; i += DOUBLE_PER_M512_REG) {
+		xreg = emu_gather_pd512(x, xindices + i);
+		yreg = emu_gather_pd512(y, yindices + i);
+
+		sreg = _mm512_fmadd_pd(xreg, yreg, sreg);
+	}
+
+	return _mm512_register_sum_pd(sreg);
+}
+
+TARGET_AVX512
+void _mm512_copy2d_indexed_ps_ld_emu(char order, float *dst, int lddst, const float *src, int ldsrc, const int *iind, const int *jind, int numi, int numj)
+{
+	const int *pos, *lines;
+	int i, j, jdidx;
+	int icutoff, npos, nlines;
+	const float *line;
+	__mmask16 mask;
+
+	if (copy2d_lines(order, iind, jind, numi, numj, &pos, &lines, &npos, &nlines) != 0) {
+		return;
+	}
+
+	icutoff = npos % FLOAT_PER_M512_REG;
+	mask = _mm512_set_mask_epi32(icutoff - 1);
+
+	for (j = 0; j < nlines; j++) {
+		jdidx = j * lddst;
+		line = src + (size_t)lines[j] * ldsrc;
+
+		if (icutoff > 0) {
+			_mm512_mask_storeu_ps(dst + jdidx, mask, emu_gather_partial_ps512(line, pos, icutoff));
+		}
+
+		for (i = icutoff; i < npos; i += FLOAT_PER_M512_REG) {
+			_mm512_storeu_ps(dst + jdidx + i, emu_gather_ps512(line, pos + i));
+		}
+	}
+}
+
+TARGET_AVX512
+void _mm512_copy2d_indexed_ps_emu(float *dst, const float *src, int nrows, const int *iind, const int *jind, int numi, int numj)
+{
+	_mm512_copy2d_indexed_ps_ld_emu(COLUMN_MAJOR_ORDER, dst, numi, src, nrows, iind, jind, numi, numj);
+}
+
+TARGET_AVX512
+float _mm512_sum2d_indexed_ps_emu(const float *src, int nrows, const int *iind, const int *jind, int numi, int numj)
+{
+	const float *col;
+	__m512 sreg = _mm512_set1_ps(0);
+	int i, j;
+	int icutoff = numi % FLOAT_PER_M512_REG;
+
+	for (j = 0; j < numj; j++) {
+		col = src + (size_t)jind[j] * nrows;
+
+		if (icutoff > 0) {
+			sreg = _mm512_add_ps(sreg, emu_gather_partial_ps512(col, iind, icutoff));
+		}
+
+		for (i = icutoff; i < numi; i += FLOAT_PER_M512_REG) {
+			sreg = _mm512_add_ps(sreg, emu_gather_ps512(col, iind + i));
+		}
+	}
+
+	return _mm512_register_sum_ps(sreg);
+}
+
+TARGET_AVX512
+float _mm512_dot2d_indexed_ps_emu(const float *src, int nrows, const int *iind, const int *jind, int numi, int numj, const float *w)
+{
+	const float *col, *wcol;
+	__m512 sreg = _mm512_set1_ps(0);
+	__mmask16 mask;
+	int i, j;
+	int icutoff = numi % FLOAT_PER_M512_REG;
+
+	mask = _mm512_set_mask_epi32(icutoff - 1);
+
+	for (j = 0; j < numj; j++) {
+		col = src + (size_t)jind[j] * nrows;
+		wcol = w + (size_t)j * numi;
+
+		if (icutoff > 0) {
+			sreg = _mm512_fmadd_ps(emu_gather_partial_ps512(col, iind, icutoff), _mm512_maskz_loadu_ps(mask, wcol), sreg);
+		}
+
+		for (i = icutoff; i < numi; i += FLOAT_PER_M512_REG) {
+			sreg = _mm512_fmadd_ps(emu_gather_ps512(col, iind + i), _mm512_loadu_ps(wcol + i), sreg);
+		}
+	}
+
+	return _mm512_register_sum_ps(sreg);
+}
+
+TARGET_AVX512
+double _mm512_sum2d_indexed_pd_emu(const double *src, int nrows, const int *iind, const int *jind, int numi, int numj)
+{
+	const double *col;
+	__m512d sreg = _mm512_set1_pd(0);
+	int i, j;
+	int icutoff = numi % DOUBLE_PER_M512_REG;
+
+	for (j = 0; j < numj; j++) {
+		col = src + (size_t)jind[j] * nrows;
+
+		if (icutoff > 0) {
+			sreg = _mm512_add_pd(sreg, emu_gather_partial_pd512(col, iind, icutoff));
+		}
+
+		for (i = icutoff; i < numi; i += DOUBLE_PER_M512_REG) {
+			sreg = _mm512_add_pd(sreg, emu_gather_pd512(col, iind + i));
+		}
+	}
+
+	return _mm512_register_sum_pd(sreg);
+}
+
+TARGET_AVX512
+double _mm512_dot2d_indexed_pd_emu(const double *src, int nrows, const int *iind, const int *jind, int numi, int numj, const double *w)
+{
+	const double *col, *wcol;
+	__m512d sreg = _mm512_set1_pd(0);
+	__mmask8 mask;
+	int i, j;
+	int icutoff = numi % DOUBLE_PER_M512_REG;
+
+	mask = _mm512_set_mask_epi64(icutoff - 1);
+
+	for (j = 0; j < numj; j++) {
+		col = src + (size_t)jind[j] * nrows;
+		wcol = w + (size_t)j * numi;
+
+		if (icutoff > 0) {
+			sreg = _mm512_fmadd_pd(emu_gather_partial_pd512(col, iind, icutoff), _mm512_maskz_loadu_pd(mask, wcol), sreg);
+		}
+
+		for (i = icutoff; i < numi; i += DOUBLE_PER_M512_REG) {
+			sreg = _mm512_fmadd_pd(emu_gather_pd512(col, iind + i), _mm512_loadu_pd(wcol + i), sreg);
+		}
+	}
+
+	return _mm512_register_sum_pd(sreg);
+}
+
+TARGET_AVX512
+void _mm512_ssellmv_emu(int nrows, const int *chunkptr, const int *perm, const int *colind, const float *values, const float *x, float *y)
+{
+	int k, j, end, row;
+	__m512 s0, s1;
+	__mmask16 mask;
+
+	for (k = 0, row = 0; row < nrows; k++, row += SELL_CHUNK_PS) {
+		s0 = s1 = _mm512_set1_ps(0);
+		end = chunkptr[k + 1];
+
+		for (j = chunkptr[k]; j + SELL_CHUNK_PS < end; j += 2 * SELL_CHUNK_PS) {
+			s0 = _mm512_fmadd_ps(emu_sell_gather_ps512(x, colind + j), _mm512_loadu_ps(values + j), s0);
+			s1 = _mm512_fmadd_ps(emu_sell_gather_ps512(x, colind + j + SELL_CHUNK_PS), _mm512_loadu_ps(values + j + SELL_CHUNK_PS), s1);
+		}
+
+		if (j < end) {
+			s0 = _mm512_fmadd_ps(emu_sell_gather_ps512(x, colind + j), _mm512_loadu_ps(values + j), s0);
+		}
+
+		mask = _mm512_set_mask_epi32((nrows - row < SELL_CHUNK_PS ? nrows - row : SELL_CHUNK_PS) - 1);
+		_mm512_mask_i32scatter_ps(y, mask, _mm512_maskz_loadu_epi32(mask, perm + row), _mm512_add_ps(s0, s1), 4);
+	}
+}
+
+TARGET_AVX512
+void _mm512_dsellmv_emu(int nrows, const int *chunkptr, const int *perm, const int *colind, const double *values, const double *x, double *y)
+{
+	int k, j, end, row;
+	__m512d s0, s1;
+	__mmask8 mask;
+
+	for (k = 0, row = 0; row < nrows; k++, row += SELL_CHUNK_PD) {
+		s0 = s1 = _mm512_set1_pd(0);
+		end = chunkptr[k + 1];
+
+		for (j = chunkptr[k]; j + SELL_CHUNK_PD < end; j += 2 * SELL_CHUNK_PD) {
+			s0 = _mm512_fmadd_pd(emu_sell_gather_pd512(x, colind + j), _mm512_loadu_pd(values + j), s0);
+			s1 = _mm512_fmadd_pd(emu_sell_gather_pd512(x, colind + j + SELL_CHUNK_PD), _mm512_loadu_pd(values + j + SELL_CHUNK_PD), s1);
+		}
+
+		if (j < end) {
+			s0 = _mm512_fmadd_pd(emu_sell_gather_pd512(x, colind + j), _mm512_loadu_pd(values + j), s0);
+		}
+
+		mask = _mm512_set_mask_epi64((nrows - row < SELL_CHUNK_PD ? nrows - row : SELL_CHUNK_PD) - 1);
+		_mm512_mask_i32scatter_pd(y, mask, _mm512_castsi512_si256(_mm512_maskz_loadu_epi32(mask, perm + row)), _mm512_add_pd(s0, s1), 8);
+	}
+}
+
+TARGET_AVX512
+static inline __m512 emu_csr_row_ps512(const float *x, const int *colind, const float *values, const int *rowptr)
+{
+	int i;
+	int begin = rowptr[0];
+	int end = rowptr[1];
+	int cutoff = (end - begin) % FLOAT_PER_M512_REG;
+	__m512 sreg = _mm512_set1_ps(0);
+
+	if (cutoff > 0) {
+		sreg = _mm512_mul_ps(emu_gather_partial_ps512(x, colind + begin, cutoff), _mm512_maskz_loadu_ps(_mm512_set_mask_epi32(cutoff - 1), values + begin));
+	}
+
+	for (i = begin + cutoff; i < end; i += FLOAT_PER_M512_REG) {
+		sreg = _mm512_fmadd_ps(emu_gather_ps512(x, colind + i), _mm512_loadu_ps(values + i), sreg);
+	}
+
+	return sreg;
+}
+
+TARGET_AVX512
+static inline __m512d emu_csr_row_pd512(const double *x, const int *colind, const double *values, const int *rowptr)
+{
+	int i;
+	int begin = rowptr[0];
+	int end = rowptr[1];
+	int cutoff = (end - begin) % DOUBLE_PER_M512_REG;
+	__m512d sreg = _mm512_set1_pd(0);
+
+	if (cutoff > 0) {
+		sreg = _mm512_mul_pd(emu_gather_partial_pd512(x, colind + begin, cutoff), _mm512_maskz_loadu_pd(_mm512_set_mask_epi64(cutoff - 1), values + begin));
+	}
+
+	for (i = begin + cutoff; i < end; i += DOUBLE_PER_M512_REG) {
+		sreg = _mm512_fmadd_pd(emu_gather_pd512(x, colind + i), _mm512_loadu_pd(values + i), sreg);
+	}
+
+	return sreg;
+}
+
+TARGET_AVX512
+void _mm512_scsrmv_emu(int nrows, const int *rowptr, const int *colind, const float *values, const float *x, float *y)
+{
+	int r;
+	__m512 s0, s1, s2, s3, s4, s5, s6, s7;
+
+	for (r = 0; r + 8 <= nrows; r += 8) {
+		s0 = emu_csr_row_ps512(x, colind, values, rowptr + r);
+		s1 = emu_csr_row_ps512(x, colind, values, rowptr + r + 1);
+		s2 = emu_csr_row_ps512(x, colind, values, rowptr + r + 2);
+		s3 = emu_csr_row_ps512(x, colind, values, rowptr + r + 3);
+		s4 = emu_csr_row_ps512(x, colind, values, rowptr + r + 4);
+		s5 = emu_csr_row_ps512(x, colind, values, rowptr + r + 5);
+		s6 = emu_csr_row_ps512(x, colind, values, rowptr + r + 6);
+		s7 = emu_csr_row_ps512(x, colind, values, rowptr + r + 7);
+
+		_mm256_storeu_ps(y + r, transpose_sum8_ps(fold_ps512(s0), fold_ps512(s1), fold_ps512(s2), fold_ps512(s3),
+		                                          fold_ps512(s4), fold_ps512(s5), fold_ps512(s6), fold_ps512(s7)));
+	}
+
+	for (; r < nrows; r++) {
+		y[r] = _mm512_register_sum_ps(emu_csr_row_ps512(x, colind, values, rowptr + r));
+	}
+}
+
+TARGET_AVX512
+void _mm512_dcsrmv_emu(int nrows, const int *rowptr, const int *colind, const double *values, const double *x, double *y)
+{
+	int r;
+	__m512d s0, s1, s2, s3;
+
+	for (r = 0; r + 4 <= nrows; r += 4) {
+		s0 = emu_csr_row_pd512(x, colind, values, rowptr + r);
+		s1 = emu_csr_row_pd512(x, colind, values, rowptr + r + 1);
+		s2 = emu_csr_row_pd512(x, colind, values, rowptr + r + 2);
+		s3 = emu_csr_row_pd512(x, colind, values, rowptr + r + 3);
+
+		_mm256_storeu_pd(y + r, transpose_sum4_pd(fold_pd512(s0), fold_pd512(s1), fold_pd512(s2), fold_pd512(s3)));
+	}
+
+	for (; r < nrows; r++) {
+		y[r] = _mm512_register_sum_pd(emu_csr_row_pd512(x, colind, values, rowptr + r));
+	}
+}
+#endif
+
+//----------------------------------------------------------------------------
+// Functions driven by span-compressed index lists (see index_plan.h). Runs
+// of consecutive indices are stored as (start, length, offset) triples and
+// read with plain loads; offset is the position of the run in the original
+// index list, which is where the matching elements of y or dst live.
+// Isolated indices are gathered together with their offsets. Every span
+// accumulates into the same registers, so there is a single horizontal sum
+// per call.
+//----------------------------------------------------------------------------
+
+float _mm_fdot_spans(const float *x, const float *y, const int *spans, int nspans, const int *singles, const int *offsets, int nsingles)
+{
+	__m128 sreg = _mm_set1_ps(0);
+	float tail = 0;
+	const float *xs, *ys;
+	int s, i, len, cutoff;
+
+	for (s = 0; s < nspans; s++) {
+		xs = x + spans[3 * s];
+		len = spans[3 * s + 1];
+		ys = y + spans[3 * s + 2];
+		cutoff = len % FLOAT_PER_M128_REG;
+
+		for (i = 0; i < cutoff; i++) {
+			tail += xs[i] * ys[i];
+		}
+
+		for (i = cutoff; i < len; i += FLOAT_PER_M128_REG) {
+			sreg = _mm_add_ps(sreg, _mm_mul_ps(_mm_loadu_ps(xs + i), _mm_loadu_ps(ys + i)));
+		}
+	}
+
+	cutoff = nsingles % FLOAT_PER_M128_REG;
+
+	if (cutoff > 0) {
+		sreg = _mm_add_ps(sreg, _mm_mul_ps(gather_partial_ps(x, singles, cutoff), gather_partial_ps(y, offsets, cutoff)));
+	}
+
+	for (i = cutoff; i < nsingles; i += FLOAT_PER_M128_REG) {
+		sreg = _mm_add_ps(sreg, _mm_mul_ps(gather_ps(x, singles + i), gather_ps(y, offsets + i)));
+	}
+
+	return _mm_register_sum_ps(sreg) + tail;
+}
+
+double _mm_ddot_spans(const double *x, const double *y, const int *spans, int nspans, const int *singles, const int *offsets, int nsingles)
+{
+	__m128d sreg = _mm_set1_pd(0);
+	const double *xs, *ys;
+	int s, i, len, cutoff;
+
+	for (s = 0; s < nspans; s++) {
+		xs = x + spans[3 * s];
+		len = spans[3 * s + 1];
+		ys = y + spans[3 * s + 2];
+		cutoff = len % DOUBLE_PER_M128_REG;
+
+		if (cutoff > 0) {
+			sreg = _mm_add_pd(sreg, _mm_mul_pd(_mm_load_sd(xs), _mm_load_sd(ys)));
+		}
+
+		for (i = cutoff; i < len; i += DOUBLE_PER_M128_REG) {
+			sreg = _mm_add_pd(sreg, _mm_mul_pd(_mm_loadu_pd(xs + i), _mm_loadu_pd(ys + i)));
+		}
+	}
+
+	cutoff = nsingles % DOUBLE_PER_M128_REG;
+
+	if (cutoff > 0) {
+		sreg = _mm_add_pd(sreg, _mm_mul_pd(_mm_load_sd(x + singles[0]), _mm_load_sd(y + offsets[0])));
+	}
+
+	for (i = cutoff; i < nsingles; i += DOUBLE_PER_M128_REG) {
+		sreg = _mm_add_pd(sreg, _mm_mul_pd(gather_pd(x, singles + i), gather_pd(y, offsets + i)));
+	}
+
+	return _mm_register_sum_pd(sreg);
+}
+
+float _mm_fsum_spans(const float *x, const int *spans, int nspans, const int *singles, int nsingles)
+{
+	__m128 sreg = _mm_set1_ps(0);
+	float tail = 0;
+	const float *xs;
+	int s, i, len, cutoff;
+
+	for (s = 0; s < nspans; s++) {
+		xs = x + spans[3 * s];
+		len = spans[3 * s + 1];
+		cutoff = len % FLOAT_PER_M128_REG;
+
+		for (i = 0; i < cutoff; i++) {
+			tail += xs[i];
+		}
+
+		for (i = cutoff; i < len; i += FLOAT_PER_M128_REG) {
+			sreg = _mm_add_ps(sreg, _mm_loadu_ps(xs + i));
+		}
+	}
+
+	cutoff = nsingles % FLOAT_PER_M128_REG;
+
+	if (cutoff > 0) {
+		sreg = _mm_add_ps(sreg, gather_partial_ps(x, singles, cutoff));
+	}
+
+	for (i = cutoff; i < nsingles; i += FLOAT_PER_M128_REG) {
+		sreg = _mm_add_ps(sreg, gather_ps(x, singles + i));
+	}
+
+	return _mm_register_sum_ps(sreg) + tail;
+}
+
+double _mm_dsum_spans(const double *x, const int *spans, int nspans, const int *singles, int nsingles)
+{
+	__m128d sreg = _mm_set1_pd(0);
+	const double *xs;
+	int s, i, len, cutoff;
+
+	for (s = 0; s < nspans; s++) {
+		xs = x + spans[3 * s];
+		len = spans[3 * s + 1];
+		cutoff = len % DOUBLE_PER_M128_REG;
+
+		if (cutoff > 0) {
+			sreg = _mm_add_pd(sreg, _mm_load_sd(xs));
+		}
+
+		for (i = cutoff; i < len; i += DOUBLE_PER_M128_REG) {
+			sreg = _mm_add_pd(sreg, _mm_loadu_pd(xs + i));
+		}
+	}
+
+	cutoff = nsingles % DOUBLE_PER_M128_REG;
+
+	if (cutoff > 0) {
+		sreg = _mm_add_pd(sreg, _mm_load_sd(x + singles[0]));
+	}
+
+	for (i = cutoff; i < nsingles; i += DOUBLE_PER_M128_REG) {
+		sreg = _mm_add_pd(sreg, gather_pd(x, singles + i));
+	}
+
+	return _mm_register_sum_pd(sreg);
+}
+
+void _mm_copy_spans_ps(float *dst, const float *src, const int *spans, int nspans, const int *singles, const int *offsets, int nsingles)
+{
+	const float *ss;
+	float *ds;
+	int s, i, len, cutoff;
+
+	for (s = 0; s < nspans; s++) {
+		ss = src + spans[3 * s];
+		len = spans[3 * s + 1];
+		ds = dst + spans[3 * s + 2];
+		cutoff = len % FLOAT_PER_M128_REG;
+
+		for (i = 0; i < cutoff; i++) {
+			ds[i] = ss[i];
+		}
+
+		for (i = cutoff; i < len; i += FLOAT_PER_M128_REG) {
+			_mm_storeu_ps(ds + i, _mm_loadu_ps(ss + i));
+		}
+	}
+
+	for (i = 0; i < nsingles; i++) {
+		dst[offsets[i]] = src[singles[i]];
+	}
+}
+
+TARGET_AVX2
+float _mm256_fdot_spans(const float *x, const float *y, const int *spans, int nspans, const int *singles, const int *offsets, int nsingles)
+{
+	__m256 sreg = _mm256_set1_ps(0);
+	__m256 sreg1 = _mm256_set1_ps(0);
+	__m256 zero = _mm256_set1_ps(0);
+	__m256i mask;
+	const float *xs, *ys;
+	int s, i, len, cutoff;
+
+	for (s = 0; s < nspans; s++) {
+		xs = x + spans[3 * s];
+		len = spans[3 * s + 1];
+		ys = y + spans[3 * s + 2];
+		cutoff = len % FLOAT_PER_M256_REG;
+
+		if (cutoff > 0) {
+			mask = _mm256_set_mask_epi32(cutoff - 1);
+			sreg1 = madd_ps(_mm256_maskload_ps(xs, mask), _mm256_maskload_ps(ys, mask), sreg1);
+		}
+
+		for (i = cutoff; i < len; i += FLOAT_PER_M256_REG) {
+			sreg = madd_ps(_mm256_loadu_ps(xs + i), _mm256_loadu_ps(ys + i), sreg);
+		}
+	}
+
+	cutoff = nsingles % FLOAT_PER_M256_REG;
+
+	if (cutoff > 0) {
+		mask = _mm256_set_mask_epi32(cutoff - 1);
+		sreg1 = madd_ps(_mm256_mask_i32gather_ps(zero, x, _mm256_maskload_epi32(singles, mask), _mm256_castsi256_ps(mask), 4),
+		                _mm256_mask_i32gather_ps(zero, y, _mm256_maskload_epi32(offsets, mask), _mm256_castsi256_ps(mask), 4), sreg1);
+	}
+
+	for (i = cutoff; i < nsingles; i += FLOAT_PER_M256_REG) {
+		sreg = madd_ps(_mm256_i32gather_ps(x, _mm256_loadu_si256((const __m256i *)(singles + i)), 4),
+		               _mm256_i32gather_ps(y, _mm256_loadu_si256((const __m256i *)(offsets + i)), 4), sreg);
+	}
+
+	return _mm256_register_sum_ps(_mm256_add_ps(sreg, sreg1));
+}
+
+TARGET_AVX2
+double _mm256_ddot_spans(const double *x, const double *y, const int *spans, int nspans, const int *singles, const int *offsets, int nsingles)
+{
+	__m256d sreg = _mm256_set1_pd(0);
+	__m256d sreg1 = _mm256_set1_pd(0);
+	__m256d zero = _mm256_set1_pd(0);
+	__m256i mask;
+	__m128i imask;
+	const double *xs, *ys;
+	int s, i, len, cutoff;
+
+	for (s = 0; s < nspans; s++) {
+		xs = x + spans[3 * s];
+		len = spans[3 * s + 1];
+		ys = y + spans[3 * s + 2];
+		cutoff = len % DOUBLE_PER_M256_REG;
+
+		if (cutoff > 0) {
+			mask = _mm256_set_mask_epi64(cutoff - 1);
+			sreg1 = madd_pd(_mm256_maskload_pd(xs, mask), _mm256_maskload_pd(ys, mask), sreg1);
+		}
+
+		for (i = cutoff; i < len; i += DOUBLE_PER_M256_REG) {
+			sreg = madd_pd(_mm256_loadu_pd(xs + i), _mm256_loadu_pd(ys + i), sreg);
+		}
+	}
+
+	cutoff = nsingles % DOUBLE_PER_M256_REG;
+
+	if (cutoff > 0) {
+		mask = _mm256_set_mask_epi64(cutoff - 1);
+		imask = _mm_set_mask_epi32(cutoff - 1);
+		sreg1 = madd_pd(_mm256_mask_i32gather_pd(zero, x, _mm_maskload_epi32(singles, imask), _mm256_castsi256_pd(mask), 8),
+		                _mm256_mask_i32gather_pd(zero, y, _mm_maskload_epi32(offsets, imask), _mm256_castsi256_pd(mask), 8), sreg1);
+	}
+
+	for (i = cutoff; i < nsingles; i += DOUBLE_PER_M256_REG) {
+		sreg = madd_pd(_mm256_i32gather_pd(x, _mm_loadu_si128((const __m128i *)(singles + i)), 8),
+		               _mm256_i32gather_pd(y, _mm_loadu_si128((const __m128i *)(offsets + i)), 8), sreg);
+	}
+
+	return _mm256_register_sum_pd(_mm256_add_pd(sreg, sreg1));
+}
+
+TARGET_AVX2
+float _mm256_fsum_spans(const float *x, const int *spans, int nspans, const int *singles, int nsingles)
+{
+	__m256 sreg = _mm256_set1_ps(0);
+	__m256 sreg1 = _mm256_set1_ps(0);
+	__m256 zero = _mm256_set1_ps(0);
+	__m256i mask;
+	const float *xs;
+	int s, i, len, cutoff;
+
+	for (s = 0; s < nspans; s++) {
+		xs = x + spans[3 * s];
+		len = spans[3 * s + 1];
+		cutoff = len % FLOAT_PER_M256_REG;
+
+		if (cutoff > 0) {
+			sreg1 = _mm256_add_ps(sreg1, _mm256_maskload_ps(xs, _mm256_set_mask_epi32(cutoff - 1)));
+		}
+
+		for (i = cutoff; i < len; i += FLOAT_PER_M256_REG) {
+			sreg = _mm256_add_ps(sreg, _mm256_loadu_ps(xs + i));
+		}
+	}
+
+	cutoff = nsingles % FLOAT_PER_M256_REG;
+
+	if (cutoff > 0) {
+		mask = _mm256_set_mask_epi32(cutoff - 1);
+		sreg1 = _mm256_add_ps(sreg1, _mm256_mask_i32gather_ps(zero, x, _mm256_maskload_epi32(singles, mask), _mm256_castsi256_ps(mask), 4));
+	}
+
+	for (i = cutoff; i < nsingles; i += FLOAT_PER_M256_REG) {
+		sreg = _mm256_add_ps(sreg, _mm256_i32gather_ps(x, _mm256_loadu_si256((const __m256i *)(singles + i)), 4));
+	}
+
+	return _mm256_register_sum_ps(_mm256_add_ps(sreg, sreg1));
+}
+
+TARGET_AVX2
+double _mm256_dsum_spans(const double *x, const int *spans, int nspans, const int *singles, int nsingles)
+{
+	__m256d sreg = _mm256_set1_pd(0);
+	__m256d sreg1 = _mm256_set1_pd(0);
+	__m256d zero = _mm256_set1_pd(0);
+	__m256i mask;
+	const double *xs;
+	int s, i, len, cutoff;
+
+	for (s = 0; s < nspans; s++) {
+		xs = x + spans[3 * s];
+		len = spans[3 * s + 1];
+		cutoff = len % DOUBLE_PER_M256_REG;
+
+		if (cutoff > 0) {
+			sreg1 = _mm256_add_pd(sreg1, _mm256_maskload_pd(xs, _mm256_set_mask_epi64(cutoff - 1)));
+		}
+
+		for (i = cutoff; i < len; i += DOUBLE_PER_M256_REG) {
+			sreg = _mm256_add_pd(sreg, _mm256_loadu_pd(xs + i));
+		}
+	}
+
+	cutoff = nsingles % DOUBLE_PER_M256_REG;
+
+	if (cutoff > 0) {
+		mask = _mm256_set_mask_epi64(cutoff - 1);
+		sreg1 = _mm256_add_pd(sreg1, _mm256_mask_i32gather_pd(zero, x, _mm_maskload_epi32(singles, _mm_set_mask_epi32(cutoff - 1)), _mm256_castsi256_pd(mask), 8));
+	}
+
+	for (i = cutoff; i < nsingles; i += DOUBLE_PER_M256_REG) {
+		sreg = _mm256_add_pd(sreg, _mm256_i32gather_pd(x, _mm_loadu_si128((const __m128i *)(singles + i)), 8));
+	}
+
+	return _mm256_register_sum_pd(_mm256_add_pd(sreg, sreg1));
+}
+
+TARGET_AVX2
+void _mm256_copy_spans_ps(float *dst, const float *src, const int *spans, int nspans, const int *singles, const int *offsets, int nsingles)
+{
+	float buffer[FLOAT_PER_M256_REG];
+	const float *ss;
+	float *ds;
+	__m256i mask;
+	int s, i, k, len, cutoff;
+
+	for (s = 0; s < nspans; s++) {
+		ss = src + spans[3 * s];
+		len = spans[3 * s + 1];
+		ds = dst + spans[3 * s + 2];
+		cutoff = len % FLOAT_PER_M256_REG;
+
+		if (cutoff > 0) {
+			mask = _mm256_set_mask_epi32(cutoff - 1);
+			_mm256_maskstore_ps(ds, mask, _mm256_maskload_ps(ss, mask));
+		}
+
+		for (i = cutoff; i < len; i += FLOAT_PER_M256_REG) {
+			_mm256_storeu_ps(ds + i, _mm256_loadu_ps(ss + i));
+		}
+	}
+
+	// AVX2 has no scatter, so gathered singles are stored one at a time.
+	cutoff = nsingles % FLOAT_PER_M256_REG;
+
+	for (i = 0; i < cutoff; i++) {
+		dst[offsets[i]] = src[singles[i]];
+	}
+
+	for (i = cutoff; i < nsingles; i += FLOAT_PER_M256_REG) {
+		_mm256_storeu_ps(buffer, _mm256_i32gather_ps(src, _mm256_loadu_si256((const __m256i *)(singles + i)), 4));
+
+		for (k = 0; k < FLOAT_PER_M256_REG; k++) {
+			dst[offsets[i + k]] = buffer[k];
+		}
+	}
+}
+
+#ifdef SUPPORTS_AVX512
+TARGET_AVX512
+float _mm512_fdot_spans(const float *x, const float *y, const int *spans, int nspans, const int *singles, const int *offsets, int nsingles)
+{
+	__m512 sreg = _mm512_set1_ps(0);
+	__m512 sreg1 = _mm512_set1_ps(0);
+	__m512 zero = _mm512_set1_ps(0);
+	__mmask16 mask;
+	const float *xs, *ys;
+	int s, i, len, cutoff;
+
+	for (s = 0; s < nspans; s++) {
+		xs = x + spans[3 * s];
+		len = spans[3 * s + 1];
+		ys = y + spans[3 * s + 2];
+		cutoff = len % FLOAT_PER_M512_REG;
+
+		if (cutoff > 0) {
+			mask = _mm512_set_mask_epi32(cutoff - 1);
+			sreg1 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(mask, xs), _mm512_maskz_loadu_ps(mask, ys), sreg1);
+		}
+
+		for (i = cutoff; i < len; i += FLOAT_PER_M512_REG) {
+			sreg = _mm512_fmadd_ps(_mm512_loadu_ps(xs + i), _mm512_loadu_ps(ys + i), sreg);
+		}
+	}
+
+	cutoff = nsingles % FLOAT_PER_M512_REG;
+
+	if (cutoff > 0) {
+		mask = _mm512_set_mask_epi32(cutoff - 1);
+		sreg1 = _mm512_fmadd_ps(_mm512_mask_i32gather_ps(zero, mask, _mm512_maskz_loadu_epi32(mask, singles), x, 4),
+		                        _mm512_mask_i32gather_ps(zero, mask, _mm512_maskz_loadu_epi32(mask, offsets), y, 4), sreg1);
+	}
+
+	for (i = cutoff; i < nsingles; i += FLOAT_PER_M512_REG) {
+		sreg = _mm512_fmadd_ps(_mm512_i32gather_ps(_mm512_loadu_si512(singles + i), x, 4),
+		                       _mm512_i32gather_ps(_mm512_loadu_si512(offsets + i), y, 4), sreg);
+	}
+
+	return _mm512_register_sum_ps(_mm512_add_ps(sreg, sreg1));
+}
+
+TARGET_AVX512
+double _mm512_ddot_spans(const double *x, const double *y, const int *spans, int nspans, const int *singles, const int *offsets, int nsingles)
+{
+	__m512d sreg = _mm512_set1_pd(0);
+	__m512d sreg1 = _mm512_set1_pd(0);
+	__m512d zero = _mm512_set1_pd(0);
+	__mmask8 mask;
+	const double *xs, *ys;
+	int s, i, len, cutoff;
+
+	for (s = 0; s < nspans; s++) {
+		xs = x + spans[3 * s];
+		len = spans[3 * s + 1];
+		ys = y + spans[3 * s + 2];
+		cutoff = len % DOUBLE_PER_M512_REG;
+
+		if (cutoff > 0) {
+			mask = _mm512_set_mask_epi64(cutoff - 1);
+			sreg1 = _mm512_fmadd_pd(_mm512_maskz_loadu_pd(mask, xs), _mm512_maskz_loadu_pd(mask, ys), sreg1);
+		}
+
+		for (i = cutoff; i < len; i += DOUBLE_PER_M512_REG) {
+			sreg = _mm512_fmadd_pd(_mm512_loadu_pd(xs + i), _mm512_loadu_pd(ys + i), sreg);
+		}
+	}
+
+	cutoff = nsingles % DOUBLE_PER_M512_REG;
+
+	if (cutoff > 0) {
+		mask = _mm512_set_mask_epi64(cutoff - 1);
+		sreg1 = _mm512_fmadd_pd(_mm512_mask_i32gather_pd(zero, mask, _mm512_castsi512_si256(_mm512_maskz_loadu_epi32(mask, singles)), x, 8),
+		                        _mm512_mask_i32gather_pd(zero, mask, _mm512_castsi512_si256(_mm512_maskz_loadu_epi32(mask, offsets)), y, 8), sreg1);
+	}
+
+	for (i = cutoff; i < nsingles; i += DOUBLE_PER_M512_REG) {
+		sreg = _mm512_fmadd_pd(_mm512_i32gather_pd(_mm256_loadu_si256((const __m256i *)(singles + i)), x, 8),
+		                       _mm512_i32gather_pd(_mm256_loadu_si256((const __m256i *)(offsets + i)), y, 8), sreg);
+	}
+
+	return _mm512_register_sum_pd(_mm512_add_pd(sreg, sreg1));
+}
+
+TARGET_AVX512
+float _mm512_fsum_spans(const float *x, const int *spans, int nspans, const int *singles, int nsingles)
+{
+	__m512 sreg = _mm512_set1_ps(0);
+	__m512 sreg1 = _mm512_set1_ps(0);
+	__m512 zero = _mm512_set1_ps(0);
+	__mmask16 mask;
+	const float *xs;
+	int s, i, len, cutoff;
+
+	for (s = 0; s < nspans; s++) {
+		xs = x + spans[3 * s];
+		len = spans[3 * s + 1];
+		cutoff = len % FLOAT_PER_M512_REG;
+
+		if (cutoff > 0) {
+			sreg1 = _mm512_add_ps(sreg1, _mm512_maskz_loadu_ps(_mm512_set_mask_epi32(cutoff - 1), xs));
+		}
+
+		for (i = cutoff; i < len; i += FLOAT_PER_M512_REG) {
+			sreg = _mm512_add_ps(sreg, _mm512_loadu_ps(xs + i));
+		}
+	}
+
+	cutoff = nsingles % FLOAT_PER_M512_REG;
+
+	if (cutoff > 0) {
+		mask = _mm512_set_mask_epi32(cutoff - 1);
+		sreg1 = _mm512_add_ps(sreg1, _mm512_mask_i32gather_ps(zero, mask, _mm512_maskz_loadu_epi32(mask, singles), x, 4));
+	}
+
+	for (i = cutoff; i < nsingles; i += FLOAT_PER_M512_REG) {
+		sreg = _mm512_add_ps(sreg, _mm512_i32gather_ps(_mm512_loadu_si512(singles + i), x, 4));
+	}
+
+	return _mm512_register_sum_ps(_mm512_add_ps(sreg, sreg1));
+}
+
+TARGET_AVX512
+double _mm512_dsum_spans(const double *x, const int *spans, int nspans, const int *singles, int nsingles)
+{
+	__m512d sreg = _mm512_set1_pd(0);
+	__m512d sreg1 = _mm512_set1_pd(0);
+	__m512d zero = _mm512_set1_pd(0);
+	__mmask8 mask;
+	const double *xs;
+	int s, i, len, cutoff;
+
+	for (s = 0; s < nspans; s++) {
+		xs = x + spans[3 * s];
+		len = spans[3 * s + 1];
+		cutoff = len % DOUBLE_PER_M512_REG;
+
+		if (cutoff > 0) {
+			sreg1 = _mm512_add_pd(sreg1, _mm512_maskz_loadu_pd(_mm512_set_mask_epi64(cutoff - 1), xs));
+		}
+
+		for (i = cutoff; i < len; i += DOUBLE_PER_M512_REG) {
+			sreg = _mm512_add_pd(sreg, _mm512_loadu_pd(xs + i));
+		}
+	}
+
+	cutoff = nsingles % DOUBLE_PER_M512_REG;
+
+	if (cutoff > 0) {
+		mask = _mm512_set_mask_epi64(cutoff - 1);
+		sreg1 = _mm512_add_pd(sreg1, _mm512_mask_i32gather_pd(zero, mask, _mm512_castsi512_si256(_mm512_maskz_loadu_epi32(mask, singles)), x, 8));
+	}
+
+	for (i = cutoff; i < nsingles; i += DOUBLE_PER_M512_REG) {
+		sreg = _mm512_add_pd(sreg, _mm512_i32gather_pd(_mm256_loadu_si256((const __m256i *)(singles + i)), x, 8));
+	}
+
+	return _mm512_register_sum_pd(_mm512_add_pd(sreg, sreg1));
+}
+
+TARGET_AVX512
+void _mm512_copy_spans_ps(float *dst, const float *src, const int *spans, int nspans, const int *singles, const int *offsets, int nsingles)
+{
+	const float *ss;
+	float *ds;
+	__mmask16 mask;
+	int s, i, len, cutoff;
+
+	for (s = 0; s < nspans; s++) {
+		ss = src + spans[3 * s];
+		len = spans[3 * s + 1];
+		ds = dst + spans[3 * s + 2];
+		cutoff = len % FLOAT_PER_M512_REG;
+
+		if (cutoff > 0) {
+			mask = _mm512_set_mask_epi32(cutoff - 1);
+			_mm512_mask_storeu_ps(ds, mask, _mm512_maskz_loadu_ps(mask, ss));
+		}
+
+		for (i = cutoff; i < len; i += FLOAT_PER_M512_REG) {
+			_mm512_storeu_ps(ds + i, _mm512_loadu_ps(ss + i));
+		}
+	}
+
+	cutoff = nsingles % FLOAT_PER_M512_REG;
+
+	if (cutoff > 0) {
+		mask = _mm512_set_mask_epi32(cutoff - 1);
+		_mm512_mask_i32scatter_ps(dst, mask, _mm512_maskz_loadu_epi32(mask, offsets),
+		                          _mm512_mask_i32gather_ps(_mm512_set1_ps(0), mask, _mm512_maskz_loadu_epi32(mask, singles), src, 4), 4);
+	}
+
+	for (i = cutoff; i < nsingles; i += FLOAT_PER_M512_REG) {
+		_mm512_i32scatter_ps(dst, _mm512_loadu_si512(offsets + i), _mm512_i32gather_ps(_mm512_loadu_si512(singles + i), src, 4), 4);
+	}
+}
+#endif
+
+//----------------------------------------------------------------------------
+// Functions for finding the extrema of arrays. Maxima are found as minima of
+// the sign-flipped values, so one helper per width serves both. The argmin
+// and argmax kernels carry a register of indices alongside the running
+// extrema and return the first position of the extremum in a single pass.
+// Empty arrays give +inf (min), -inf (max) or -1 (arg). Results are
+// unspecified if the array contains NaNs.
+//----------------------------------------------------------------------------
+
+// Merge per-lane candidates, preferring the lower index on ties. A negative
+// best index means no candidate yet.
+static inline void merge_candidate_ps(float v, int idx, float *best, int *bestidx)
+{
+	if (*bestidx < 0 || v < *best || (v == *best && idx < *bestidx)) {
+		*best = v;
+		*bestidx = idx;
+	}
+}
+
+static inline void merge_candidate_pd(double v, int idx, double *best, int *bestidx)
+{
+	if (*bestidx < 0 || v < *best || (v == *best && idx < *bestidx)) {
+		*best = v;
+		*bestidx = idx;
+	}
+}
+
+static inline float extreme_ps128(const float *x, int n, int max)
+{
+	__m128 flip = max ? _mm_set1_ps(-0.0f) : _mm_set1_ps(0);
+	__m128 mreg = _mm_set1_ps(INFINITY);
+	__m128 mreg1 = _mm_set1_ps(INFINITY);
+	float tail = INFINITY;
+	float buffer[FLOAT_PER_M128_REG];
+	int i, k;
+	int cutoff = n % FLOAT_PER_M128_REG;
+
+	for (i = 0; i < cutoff; i++) {
+		tail = (max ? -x[i] : x[i]) < tail ? (max ? -x[i] : x[i]) : tail;
+	}
+
+	for (; i + 2 * FLOAT_PER_M128_REG <= n; i += 2 * FLOAT_PER_M128_REG) {
+		mreg = _mm_min_ps(mreg, _mm_xor_ps(_mm_loadu_ps(x + i), flip));
+		mreg1 = _mm_min_ps(mreg1, _mm_xor_ps(_mm_loadu_ps(x + i + 4), flip));
+	}
+
+	if (i < n) {
+		mreg = _mm_min_ps(mreg, _mm_xor_ps(_mm_loadu_ps(x + i), flip));
+	}
+
+	_mm_storeu_ps(buffer, _mm_min_ps(mreg, mreg1));
+
+	for (k = 0; k < FLOAT_PER_M128_REG; k++) {
+		tail = buffer[k] < tail ? buffer[k] : tail;
+	}
+
+	return max ? -tail : tail;
+}
+
+static inline double extreme_pd128(const double *x, int n, int max)
+{
+	__m128d flip = max ? _mm_set1_pd(-0.0) : _mm_set1_pd(0);
+	__m128d mreg = _mm_set1_pd(INFINITY);
+	__m128d mreg1 = _mm_set1_pd(INFINITY);
+	double tail = INFINITY;
+	double buffer[DOUBLE_PER_M128_REG];
+	int i, k;
+	int cutoff = n % DOUBLE_PER_M128_REG;
+
+	for (i = 0; i < cutoff; i++) {
+		tail = (max ? -x[i] : x[i]) < tail ? (max ? -x[i] : x[i]) : tail;
+	}
+
+	for (; i + 2 * DOUBLE_PER_M128_REG <= n; i += 2 * DOUBLE_PER_M128_REG) {
+		mreg = _mm_min_pd(mreg, _mm_xor_pd(_mm_loadu_pd(x + i), flip));
+		mreg1 = _mm_min_pd(mreg1, _mm_xor_pd(_mm_loadu_pd(x + i + 2), flip));
+	}
+
+	if (i < n) {
+		mreg = _mm_min_pd(mreg, _mm_xor_pd(_mm_loadu_pd(x + i), flip));
+	}
+
+	_mm_storeu_pd(buffer, _mm_min_pd(mreg, mreg1));
+
+	for (k = 0; k < DOUBLE_PER_M128_REG; k++) {
+		tail = buffer[k] < tail ? buffer[k] : tail;
+	}
+
+	return max ? -tail : tail;
+}
+
+static inline int argextreme_ps128(const float *x, int n, int max)
+{
+	__m128 flip = max ? _mm_set1_ps(-0.0f) : _mm_set1_ps(0);
+	__m128 mreg, xreg, lt;
+	__m128i ireg, mireg;
+	__m128i step = _mm_set1_epi32(FLOAT_PER_M128_REG);
+	float best = 0;
+	float vbuffer[FLOAT_PER_M128_REG];
+	int ibuffer[FLOAT_PER_M128_REG];
+	int bestidx = -1;
+	int i, k;
+	int cutoff = n % FLOAT_PER_M128_REG;
+
+	for (i = 0; i < cutoff; i++) {
+		merge_candidate_ps(max ? -x[i] : x[i], i, &best, &bestidx);
+	}
+
+	if (i < n) {
+		mreg = _mm_xor_ps(_mm_loadu_ps(x + i), flip);
+		mireg = _mm_add_epi32(_mm_setr_epi32(0, 1, 2, 3), _mm_set1_epi32(i));
+		ireg = mireg;
+
+		for (i += FLOAT_PER_M128_REG; i < n; i += FLOAT_PER_M128_REG) {
+			ireg = _mm_add_epi32(ireg, step);
+			xreg = _mm_xor_ps(_mm_loadu_ps(x + i), flip);
+			lt = _mm_cmplt_ps(xreg, mreg);
+			mreg = _mm_blendv_ps(mreg, xreg, lt);
+			mireg = _mm_castps_si128(_mm_blendv_ps(_mm_castsi128_ps(mireg), _mm_castsi128_ps(ireg), lt));
+		}
+
+		_mm_storeu_ps(vbuffer, mreg);
+		_mm_storeu_si128((__m128i *)ibuffer, mireg);
+
+		for (k = 0; k < FLOAT_PER_M128_REG; k++) {
+			merge_candidate_ps(vbuffer[k], ibuffer[k], &best, &bestidx);
+		}
+	}
+
+	return bestidx;
+}
+
+static inline int argextreme_pd128(const double *x, int n, int max)
+{
+	__m128d flip = max ? _mm_set1_pd(-0.0) : _mm_set1_pd(0);
+	__m128d mreg, xreg, lt;
+	__m128i ireg, mireg;
+	__m128i step = _mm_set1_epi64x(DOUBLE_PER_M128_REG);
+	double best = 0;
+	double vbuffer[DOUBLE_PER_M128_REG];
+	int64_t ibuffer[DOUBLE_PER_M128_REG];
+	int bestidx = -1;
+	int i, k;
+	int cutoff = n % DOUBLE_PER_M128_REG;
+
+	for (i = 0; i < cutoff; i++) {
+		merge_candidate_pd(max ? -x[i] : x[i], i, &best, &bestidx);
+	}
+
+	if (i < n) {
+		mreg = _mm_xor_pd(_mm_loadu_pd(x + i), flip);
+		mireg = _mm_set_epi64x(i + 1, i);
+		ireg = mireg;
+
+		for (i += DOUBLE_PER_M128_REG; i < n; i += DOUBLE_PER_M128_REG) {
+			ireg = _mm_add_epi64(ireg, step);
+			xreg = _mm_xor_pd(_mm_loadu_pd(x + i), flip);
+			lt = _mm_cmplt_pd(xreg, mreg);
+			mreg = _mm_blendv_pd(mreg, xreg, lt);
+			mireg = _mm_castpd_si128(_mm_blendv_pd(_mm_castsi128_pd(mireg), _mm_castsi128_pd(ireg), lt));
+		}
+
+		_mm_storeu_pd(vbuffer, mreg);
+		_mm_storeu_si128((__m128i *)ibuffer, mireg);
+
+		for (k = 0; k < DOUBLE_PER_M128_REG; k++) {
+			merge_candidate_pd(vbuffer[k], (int)ibuffer[k], &best, &bestidx);
+		}
+	}
+
+	return bestidx;
+}
+
+float _mm_smin(const float *x, int n)
+{
+	return extreme_ps128(x, n, 0);
+}
+
+float _mm_smax(const float *x, int n)
+{
+	return extreme_ps128(x, n, 1);
+}
+
+int _mm_sargmin(const float *x, int n)
+{
+	return argextreme_ps128(x, n, 0);
+}
+
+int _mm_sargmax(const float *x, int n)
+{
+	return argextreme_ps128(x, n, 1);
+}
+
+double _mm_dmin(const double *x, int n)
+{
+	return extreme_pd128(x, n, 0);
+}
+
+double _mm_dmax(const double *x, int n)
+{
+	return extreme_pd128(x, n, 1);
+}
+
+int _mm_dargmin(const double *x, int n)
+{
+	return argextreme_pd128(x, n, 0);
+}
+
+int _mm_dargmax(const double *x, int n)
+{
+	return argextreme_pd128(x, n, 1);
+}
+
+// Masked-off tail lanes are filled with +inf so they never win; they can
+// only tie when every element is +inf, and then element 0 wins on index.
+TARGET_AVX2
+static inline float extreme_ps256(const float *x, int n, int max)
+{
+	__m256 flip = max ? _mm256_set1_ps(-0.0f) : _mm256_set1_ps(0);
+	__m256 inf = _mm256_set1_ps(INFINITY);
+	__m256 mreg = inf;
+	__m256 mreg1 = inf;
+	__m256i mask;
+	float result;
+	int i;
+	int cutoff = n % FLOAT_PER_M256_REG;
+
+	if (cutoff > 0) {
+		mask = _mm256_set_mask_epi32(cutoff - 1);
+		mreg = _mm256_blendv_ps(inf, _mm256_xor_ps(_mm256_maskload_ps(x, mask), flip), _mm256_castsi256_ps(mask));
+	}
+
+	for (i = cutoff; i + 2 * FLOAT_PER_M256_REG <= n; i += 2 * FLOAT_PER_M256_REG) {
+		mreg = _mm256_min_ps(mreg, _mm256_xor_ps(_mm256_loadu_ps(x + i), flip));
+		mreg1 = _mm256_min_ps(mreg1, _mm256_xor_ps(_mm256_loadu_ps(x + i + 8), flip));
+	}
+
+	if (i < n) {
+		mreg = _mm256_min_ps(mreg, _mm256_xor_ps(_mm256_loadu_ps(x + i), flip));
+	}
+
+	result = _mm256_register_min_ps(_mm256_min_ps(mreg, mreg1));
+
+	return max ? -result : result;
+}
+
+TARGET_AVX2
+static inline double extreme_pd256(const double *x, int n, int max)
+{
+	__m256d flip = max ? _mm256_set1_pd(-0.0) : _mm256_set1_pd(0);
+	__m256d inf = _mm256_set1_pd(INFINITY);
+	__m256d mreg = inf;
+	__m256d mreg1 = inf;
+	__m256i mask;
+	double result;
+	int i;
+	int cutoff = n % DOUBLE_PER_M256_REG;
+
+	if (cutoff > 0) {
+		mask = _mm256_set_mask_epi64(cutoff - 1);
+		mreg = _mm256_blendv_pd(inf, _mm256_xor_pd(_mm256_maskload_pd(x, mask), flip), _mm256_castsi256_pd(mask));
+	}
+
+	for (i = cutoff; i + 2 * DOUBLE_PER_M256_REG <= n; i += 2 * DOUBLE_PER_M256_REG) {
+		mreg = _mm256_min_pd(mreg, _mm256_xor_pd(_mm256_loadu_pd(x + i), flip));
+		mreg1 = _mm256_min_pd(mreg1, _mm256_xor_pd(_mm256_loadu_pd(x + i + 4), flip));
+	}
+
+	if (i < n) {
+		mreg = _mm256_min_pd(mreg, _mm256_xor_pd(_mm256_loadu_pd(x + i), flip));
+	}
+
+	result = _mm256_register_min_pd(_mm256_min_pd(mreg, mreg1));
+
+	return max ? -result : result;
+}
+
+TARGET_AVX2
+static inline int argextreme_ps256(const float *x, int n, int max)
+{
+	__m256 flip = max ? _mm256_set1_ps(-0.0f) : _mm256_set1_ps(0);
+	__m256 mreg, xreg, lt;
+	__m256i ireg, mireg, mask;
+	__m256i step = _mm256_set1_epi32(FLOAT_PER_M256_REG);
+	float best = 0;
+	float vbuffer[FLOAT_PER_M256_REG];
+	int ibuffer[FLOAT_PER_M256_REG];
+	int bestidx = -1;
+	int i, k;
+	int cutoff = n % FLOAT_PER_M256_REG;
+
+	if (n <= 0) {
+		return -1;
+	}
+
+	// Start from the tail, or from the first full register.
+	ireg = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+	mireg = ireg;
+
+	if (cutoff > 0) {
+		mask = _mm256_set_mask_epi32(cutoff - 1);
+		mreg = _mm256_blendv_ps(_mm256_set1_ps(INFINITY), _mm256_xor_ps(_mm256_maskload_ps(x, mask), flip), _mm256_castsi256_ps(mask));
+		ireg = _mm256_add_epi32(ireg, _mm256_set1_epi32(cutoff - FLOAT_PER_M256_REG));
+		i = cutoff;
+	} else {
+		mreg = _mm256_xor_ps(_mm256_loadu_ps(x), flip);
+		i = FLOAT_PER_M256_REG;
+	}
+
+	for (; i < n; i += FLOAT_PER_M256_REG) {
+		ireg = _mm256_add_epi32(ireg, step);
+		xreg = _mm256_xor_ps(_mm256_loadu_ps(x + i), flip);
+		lt = _mm256_cmp_ps(xreg, mreg, _CMP_LT_OQ);
+		mreg = _mm256_blendv_ps(mreg, xreg, lt);
+		mireg = _mm256_blendv_epi8(mireg, ireg, _mm256_castps_si256(lt));
+	}
+
+	_mm256_storeu_ps(vbuffer, mreg);
+	_mm256_storeu_si256((__m256i *)ibuffer, mireg);
+
+	for (k = 0; k < FLOAT_PER_M256_REG; k++) {
+		merge_candidate_ps(vbuffer[k], ibuffer[k], &best, &bestidx);
+	}
+
+	return bestidx;
+}
+
+TARGET_AVX2
+static inline int argextreme_pd256(const double *x, int n, int max)
+{
+	__m256d flip = max ? _mm256_set1_pd(-0.0) : _mm256_set1_pd(0);
+	__m256d mreg, xreg, lt;
+	__m256i ireg, mireg, mask;
+	__m256i step = _mm256_set1_epi64x(DOUBLE_PER_M256_REG);
+	double best = 0;
+	double vbuffer[DOUBLE_PER_M256_REG];
+	int64_t ibuffer[DOUBLE_PER_M256_REG];
+	int bestidx = -1;
+	int i, k;
+	int cutoff = n % DOUBLE_PER_M256_REG;
+
+	if (n <= 0) {
+		return -1;
+	}
+
+	ireg = _mm256_setr_epi64x(0, 1, 2, 3);
+	mireg = ireg;
+
+	if (cutoff > 0) {
+		mask = _mm256_set_mask_epi64(cutoff - 1);
+		mreg = _mm256_blendv_pd(_mm256_set1_pd(INFINITY), _mm256_xor_pd(_mm256_maskload_pd(x, mask), flip), _mm256_castsi256_pd(mask));
+		ireg = _mm256_add_epi64(ireg, _mm256_set1_epi64x(cutoff - DOUBLE_PER_M256_REG));
+		i = cutoff;
+	} else {
+		mreg = _mm256_xor_pd(_mm256_loadu_pd(x), flip);
+		i = DOUBLE_PER_M256_REG;
+	}
+
+	for (; i < n; i += DOUBLE_PER_M256_REG) {
+		ireg = _mm256_add_epi64(ireg, step);
+		xreg = _mm256_xor_pd(_mm256_loadu_pd(x + i), flip);
+		lt = _mm256_cmp_pd(xreg, mreg, _CMP_LT_OQ);
+		mreg = _mm256_blendv_pd(mreg, xreg, lt);
+		mireg = _mm256_blendv_epi8(mireg, ireg, _mm256_castpd_si256(lt));
+	}
+
+	_mm256_storeu_pd(vbuffer, mreg);
+	_mm256_storeu_si256((__m256i *)ibuffer, mireg);
+
+	for (k = 0; k < DOUBLE_PER_M256_REG; k++) {
+		merge_candidate_pd(vbuffer[k], (int)ibuffer[k], &best, &bestidx);
+	}
+
+	return bestidx;
+}
+
+TARGET_AVX2
+float _mm256_smin(const float *x, int n)
+{
+	return extreme_ps256(x, n, 0);
+}
+
+TARGET_AVX2
+float _mm256_smax(const float *x, int n)
+{
+	return extreme_ps256(x, n, 1);
+}
+
+TARGET_AVX2
+int _mm256_sargmin(const float *x, int n)
+{
+	return argextreme_ps256(x, n, 0);
+}
+
+TARGET_AVX2
+int _mm256_sargmax(const float *x, int n)
+{
+	return argextreme_ps256(x, n, 1);
+}
+
+TARGET_AVX2
+double _mm256_dmin(const double *x, int n)
+{
+	return extreme_pd256(x, n, 0);
+}
+
+TARGET_AVX2
+double _mm256_dmax(const double *x, int n)
+{
+	return extreme_pd256(x, n, 1);
+}
+
+TARGET_AVX2
+int _mm256_dargmin(const double *x, int n)
+{
+	return argextreme_pd256(x, n, 0);
+}
+
+TARGET_AVX2
+int _mm256_dargmax(const double *x, int n)
+{
+	return argextreme_pd256(x, n, 1);
+}
+
+#ifdef SUPPORTS_AVX512
+TARGET_AVX512
+static inline float extreme_ps512(const float *x, int n, int max)
+{
+	__m512 flip = max ? _mm512_set1_ps(-0.0f) : _mm512_set1_ps(0);
+	__m512 inf = _mm512_set1_ps(INFINITY);
+	__m512 mreg = inf;
+	__m512 mreg1 = inf;
+	float result;
+	int i;
+	int cutoff = n % FLOAT_PER_M512_REG;
+
+	if (cutoff > 0) {
+		mreg = _mm512_xor_ps(_mm512_mask_loadu_ps(_mm512_xor_ps(inf, flip), _mm512_set_mask_epi32(cutoff - 1), x), flip);
+	}
+
+	for (i = cutoff; i + 2 * FLOAT_PER_M512_REG <= n; i += 2 * FLOAT_PER_M512_REG) {
+		mreg = _mm512_min_ps(mreg, _mm512_xor_ps(_mm512_loadu_ps(x + i), flip));
+		mreg1 = _mm512_min_ps(mreg1, _mm512_xor_ps(_mm512_loadu_ps(x + i + 16), flip));
+	}
+
+	if (i < n) {
+		mreg = _mm512_min_ps(mreg, _mm512_xor_ps(_mm512_loadu_ps(x + i), flip));
+	}
+
+	result = _mm512_register_min_ps(_mm512_min_ps(mreg, mreg1));
+
+	return max ? -result : result;
+}
+
+TARGET_AVX512
+static inline double extreme_pd512(const double *x, int n, int max)
+{
+	__m512d flip = max ? _mm512_set1_pd(-0.0) : _mm512_set1_pd(0);
+	__m512d inf = _mm512_set1_pd(INFINITY);
+	__m512d mreg = inf;
+	__m512d mreg1 = inf;
+	double result;
+	int i;
+	int cutoff = n % DOUBLE_PER_M512_REG;
+
+	if (cutoff > 0) {
+		mreg = _mm512_xor_pd(_mm512_mask_loadu_pd(_mm512_xor_pd(inf, flip), _mm512_set_mask_epi64(cutoff - 1), x), flip);
+	}
+
+	for (i = cutoff; i + 2 * DOUBLE_PER_M512_REG <= n; i += 2 * DOUBLE_PER_M512_REG) {
+		mreg = _mm512_min_pd(mreg, _mm512_xor_pd(_mm512_loadu_pd(x + i), flip));
+		mreg1 = _mm512_min_pd(mreg1, _mm512_xor_pd(_mm512_loadu_pd(x + i + 8), flip));
+	}
+
+	if (i < n) {
+		mreg = _mm512_min_pd(mreg, _mm512_xor_pd(_mm512_loadu_pd(x + i), flip));
+	}
+
+	result = _mm512_register_min_pd(_mm512_min_pd(mreg, mreg1));
+
+	return max ? -result : result;
+}
+
+TARGET_AVX512
+static inline int argextreme_ps512(const float *x, int n, int max)
+{
+	__m512 flip = max ? _mm512_set1_ps(-0.0f) : _mm512_set1_ps(0);
+	__m512 inf = _mm512_set1_ps(INFINITY);
+	__m512 mreg, xreg;
+	__m512i ireg, mireg;
+	__m512i step = _mm512_set1_epi32(FLOAT_PER_M512_REG);
+	__mmask16 lt;
+	float best = 0;
+	float vbuffer[FLOAT_PER_M512_REG];
+	int ibuffer[FLOAT_PER_M512_REG];
+	int bestidx = -1;
+	int i, k;
+	int cutoff = n % FLOAT_PER_M512_REG;
+
+	if (n <= 0) {
+		return -1;
+	}
+
+	ireg = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+	mireg = ireg;
+
+	if (cutoff > 0) {
+		mreg = _mm512_xor_ps(_mm512_mask_loadu_ps(_mm512_xor_ps(inf, flip), _mm512_set_mask_epi32(cutoff - 1), x), flip);
+		ireg = _mm512_add_epi32(ireg, _mm512_set1_epi32(cutoff - FLOAT_PER_M512_REG));
+		i = cutoff;
+	} else {
+		mreg = _mm512_xor_ps(_mm512_loadu_ps(x), flip);
+		i = FLOAT_PER_M512_REG;
+	}
+
+	for (; i < n; i += FLOAT_PER_M512_REG) {
+		ireg = _mm512_add_epi32(ireg, step);
+		xreg = _mm512_xor_ps(_mm512_loadu_ps(x + i), flip);
+		lt = _mm512_cmp_ps_mask(xreg, mreg, _CMP_LT_OQ);
+		mreg = _mm512_mask_mov_ps(mreg, lt, xreg);
+		mireg = _mm512_mask_mov_epi32(mireg, lt, ireg);
+	}
+
+	_mm512_storeu_ps(vbuffer, mreg);
+	_mm512_storeu_si512(ibuffer, mireg);
+
+	for (k = 0; k < FLOAT_PER_M512_REG; k++) {
+		merge_candidate_ps(vbuffer[k], ibuffer[k], &best, &bestidx);
+	}
+
+	return bestidx;
+}
+
+TARGET_AVX512
+static inline int argextreme_pd512(const double *x, int n, int max)
+{
+	__m512d flip = max ? _mm512_set1_pd(-0.0) : _mm512_set1_pd(0);
+	__m512d inf = _mm512_set1_pd(INFINITY);
+	__m512d mreg, xreg;
+	__m512i ireg, mireg;
+	__m512i step = _mm512_set1_epi64(DOUBLE_PER_M512_REG);
+	__mmask8 lt;
+	double best = 0;
+	double vbuffer[DOUBLE_PER_M512_REG];
+	int64_t ibuffer[DOUBLE_PER_M512_REG];
+	int bestidx = -1;
+	int i, k;
+	int cutoff = n % DOUBLE_PER_M512_REG;
+
+	if (n <= 0) {
+		return -1;
+	}
+
+	ireg = _mm512_setr_epi64(0, 1, 2, 3, 4, 5, 6, 7);
+	mireg = ireg;
+
+	if (cutoff > 0) {
+		mreg = _mm512_xor_pd(_mm512_mask_loadu_pd(_mm512_xor_pd(inf, flip), _mm512_set_mask_epi64(cutoff - 1), x), flip);
+		ireg = _mm512_add_epi64(ireg, _mm512_set1_epi64(cutoff - DOUBLE_PER_M512_REG));
+		i = cutoff;
+	} else {
+		mreg = _mm512_xor_pd(_mm512_loadu_pd(x), flip);
+		i = DOUBLE_PER_M512_REG;
+	}
+
+	for (; i < n; i += DOUBLE_PER_M512_REG) {
+		ireg = _mm512_add_epi64(ireg, step);
+		xreg = _mm512_xor_pd(_mm512_loadu_pd(x + i), flip);
+		lt = _mm512_cmp_pd_mask(xreg, mreg, _CMP_LT_OQ);
+		mreg = _mm512_mask_mov_pd(mreg, lt, xreg);
+		mireg = _mm512_mask_mov_epi64(mireg, lt, ireg);
+	}
+
+	_mm512_storeu_pd(vbuffer, mreg);
+	_mm512_storeu_si512(ibuffer, mireg);
+
+	for (k = 0; k < DOUBLE_PER_M512_REG; k++) {
+		merge_candidate_pd(vbuffer[k], (int)ibuffer[k], &best, &bestidx);
+	}
+
+	return bestidx;
+}
+
+TARGET_AVX512
+float _mm512_smin(const float *x, int n)
+{
+	return extreme_ps512(x, n, 0);
+}
+
+TARGET_AVX512
+float _mm512_smax(const float *x, int n)
+{
+	return extreme_ps512(x, n, 1);
+}
+
+TARGET_AVX512
+int _mm512_sargmin(const float *x, int n)
+{
+	return argextreme_ps512(x, n, 0);
+}
+
+TARGET_AVX512
+int _mm512_sargmax(const float *x, int n)
+{
+	return argextreme_ps512(x, n, 1);
+}
+
+TARGET_AVX512
+double _mm512_dmin(const double *x, int n)
+{
+	return extreme_pd512(x, n, 0);
+}
+
+TARGET_AVX512
+double _mm512_dmax(const double *x, int n)
+{
+	return extreme_pd512(x, n, 1);
+}
+
+TARGET_AVX512
+int _mm512_dargmin(const double *x, int n)
+{
+	return argextreme_pd512(x, n, 0);
+}
+
+TARGET_AVX512
+int _mm512_dargmax(const double *x, int n)
+{
+	return argextreme_pd512(x, n, 1);
+}
+#endif
+
+//----------------------------------------------------------------------------
+// Padded buffers and kernels relying on them. iu_alloc_padded returns
+// zeroed memory aligned to PADDED_ALIGNMENT bytes and holding a whole number
+// of AVX-512 registers, so the _padded kernels round n up to whole registers
+// and use aligned full-width loads and stores without a masked tail. The
+// padding stays zero: set_value zeroes it in its last register and copies
+// carry over the zero padding of their source, which keeps the padded dot
+// products exact.
+//----------------------------------------------------------------------------
+
+// Bytes for n elements, rounded up to whole blocks so that aligned_alloc
+// gets a multiple of its alignment for any element size.
+static size_t padded_bytes(size_t n, size_t size)
+{
+	return (n * size + PADDED_ALIGNMENT - 1) & ~(size_t)(PADDED_ALIGNMENT - 1);
+}
+
+size_t iu_padded_length(size_t n, size_t size)
+{
+	if (size == 0) {
+		return n;
+	}
+
+	return padded_bytes(n, size) / size;
+}
+
+void *iu_alloc_padded(size_t n, size_t size)
+{
+	size_t bytes;
+	void *x;
+
+	// Rounding n * size up must not wrap around to a short buffer.
+	if (size > 0 && n > (SIZE_MAX - (PADDED_ALIGNMENT - 1)) / size) {
+		return NULL;
+	}
+
+	bytes = padded_bytes(n, size);
+
+	if (bytes == 0) {
+		bytes = PADDED_ALIGNMENT;
+	}
+
+	x = aligned_alloc(PADDED_ALIGNMENT, bytes);
+
+	if (x != NULL) {
+		memset(x, 0, bytes);
+	}
+
+	return x;
+}
+
+void iu_free_padded(void *x)
+{
+	free(x);
+}
+
+static inline int padded_count(int n, int width)
+{
+	return n > 0 ? (n + width - 1) / width * width : 0;
+}
+
+void _mm_sset_value_padded(float *x, int n, float value)
+{
+	int k;
+	__m128 vreg = _mm_set1_ps(value);
+	__m128i lanes = _mm_setr_epi32(0, 1, 2, 3);
+
+	for (k = 0; k + FLOAT_PER_M128_REG < n; k += FLOAT_PER_M128_REG) {
+		_mm_store_ps(x + k, vreg);
+	}
+
+	if (k < n) {
+		_mm_store_ps(x + k, _mm_and_ps(vreg, _mm_castsi128_ps(_mm_cmpgt_epi32(_mm_set1_epi32(n - k), lanes))));
+	}
+}
+
+void _mm_dset_value_padded(double *x, int n, double value)
+{
+	int k;
+	__m128d vreg = _mm_set1_pd(value);
+	__m128i lanes = _mm_setr_epi32(0, 0, 1, 1);
+
+	for (k = 0; k + DOUBLE_PER_M128_REG < n; k += DOUBLE_PER_M128_REG) {
+		_mm_store_pd(x + k, vreg);
+	}
+
+	if (k < n) {
+		_mm_store_pd(x + k, _mm_and_pd(vreg, _mm_castsi128_pd(_mm_cmpgt_epi32(_mm_set1_epi32(n - k), lanes))));
+	}
+}
+
+float _mm_fdot_padded(const float *x, const float *y, int n)
+{
+	int i;
+	int len = padded_count(n, FLOAT_PER_M128_REG);
+	__m128 sreg = _mm_set1_ps(0);
+
+	for (i = 0; i < len; i += FLOAT_PER_M128_REG) {
+		sreg = _mm_add_ps(sreg, _mm_mul_ps(_mm_load_ps(x + i), _mm_load_ps(y + i)));
+	}
+
+	return _mm_register_sum_ps(sreg);
+}
+
+double _mm_ddot_padded(const double *x, const double *y, int n)
+{
+	int i;
+	int len = padded_count(n, DOUBLE_PER_M128_REG);
+	__m128d sreg = _mm_set1_pd(0);
+
+	for (i = 0; i < len; i += DOUBLE_PER_M128_REG) {
+		sreg = _mm_add_pd(sreg, _mm_mul_pd(_mm_load_pd(x + i), _mm_load_pd(y + i)));
+	}
+
+	return _mm_register_sum_pd(sreg);
+}
+
+float _mm_fdot_indexed_padded(const float *x, const int *xindices, const float *y, int n)
+{
+	int i;
+	int len = padded_count(n, FLOAT_PER_M128_REG);
+	__m128 sreg = _mm_set1_ps(0);
+
+	for (i = 0; i < len; i += FLOAT_PER_M128_REG) {
+		sreg = _mm_add_ps(sreg, _mm_mul_ps(gather_ps(x, xindices + i), _mm_load_ps(y + i)));
+	}
+
+	return _mm_register_sum_ps(sreg);
+}
+
+double _mm_ddot_indexed_padded(const double *x, const int *xindices, const double *y, int n)
+{
+	int i;
+	int len = padded_count(n, DOUBLE_PER_M128_REG);
+	__m128d sreg = _mm_set1_pd(0);
+
+	for (i = 0; i < len; i += DOUBLE_PER_M128_REG) {
+		sreg = _mm_add_pd(sreg, _mm_mul_pd(gather_pd(x, xindices + i), _mm_load_pd(y + i)));
+	}
+
+	return _mm_register_sum_pd(sreg);
+}
+
+void _mm_copy1d_ps_padded(float *dst, const float *src, int n)
+{
+	int i;
+	int len = padded_count(n, FLOAT_PER_M128_REG);
+
+	for (i = 0; i < len; i += FLOAT_PER_M128_REG) {
+		_mm_store_ps(dst + i, _mm_load_ps(src + i));
+	}
+}
+
+void _mm_copy1d_epi32_padded(int *dst, const int *src, int n)
+{
+	int i;
+	int len = padded_count(n, INT32_PER_M128_REG);
+
+	for (i = 0; i < len; i += INT32_PER_M128_REG) {
+		_mm_store_si128((__m128i *)(dst + i), _mm_load_si128((const __m128i *)(src + i)));
+	}
+}
+
+TARGET_AVX2
+void _mm256_sset_value_padded(float *x, int n, float value)
+{
+	int k;
+	__m256 vreg = _mm256_set1_ps(value);
+	__m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+
+	for (k = 0; k + FLOAT_PER_M256_REG < n; k += FLOAT_PER_M256_REG) {
+		_mm256_store_ps(x + k, vreg);
+	}
+
+	if (k < n) {
+		_mm256_store_ps(x + k, _mm256_and_ps(vreg, _mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_set1_epi32(n - k), lanes))));
+	}
+}
+
+TARGET_AVX2
+void _mm256_dset_value_padded(double *x, int n, double value)
+{
+	int k;
+	__m256d vreg = _mm256_set1_pd(value);
+	__m256i lanes = _mm256_setr_epi32(0, 0, 1, 1, 2, 2, 3, 3);
+
+	for (k = 0; k + DOUBLE_PER_M256_REG < n; k += DOUBLE_PER_M256_REG) {
+		_mm256_store_pd(x + k, vreg);
+	}
+
+	if (k < n) {
+		_mm256_store_pd(x + k, _mm256_and_pd(vreg, _mm256_castsi256_pd(_mm256_cmpgt_epi32(_mm256_set1_epi32(n - k), lanes))));
+	}
+}
+
+TARGET_AVX2
+float _mm256_fdot_padded(const float *x, const float *y, int n)
+{
+	int i;
+	int len = padded_count(n, FLOAT_PER_M256_REG);
+	__m256 sreg = _mm256_set1_ps(0);
+	__m256 sreg1 = _mm256_set1_ps(0);
+	__m256 sreg2 = _mm256_set1_ps(0);
+	__m256 sreg3 = _mm256_set1_ps(0);
+
+	for (i = 0; i + 4 * FLOAT_PER_M256_REG <= len; i += 4 * FLOAT_PER_M256_REG) {
+		sreg = madd_ps(_mm256_load_ps(x + i), _mm256_load_ps(y + i), sreg);
+		sreg1 = madd_ps(_mm256_load_ps(x + i + 8), _mm256_load_ps(y + i + 8), sreg1);
+		sreg2 = madd_ps(_mm256_load_ps(x + i + 16), _mm256_load_ps(y + i + 16), sreg2);
+		sreg3 = madd_ps(_mm256_load_ps(x + i + 24), _mm256_load_ps(y + i + 24), sreg3);
+	}
+
+	for (; i < len; i += FLOAT_PER_M256_REG) {
+		sreg = madd_ps(_mm256_load_ps(x + i), _mm256_load_ps(y + i), sreg);
+	}
+
+	sreg = _mm256_add_ps(_mm256_add_ps(sreg, sreg1), _mm256_add_ps(sreg2, sreg3));
+
+	return _mm256_register_sum_ps(sreg);
+}
+
+TARGET_AVX2
+double _mm256_ddot_padded(const double *x, const double *y, int n)
+{
+	int i;
+	int len = padded_count(n, DOUBLE_PER_M256_REG);
+	__m256d sreg = _mm256_set1_pd(0);
+	__m256d sreg1 = _mm256_set1_pd(0);
+	__m256d sreg2 = _mm256_set1_pd(0);
+	__m256d sreg3 = _mm256_set1_pd(0);
+
+	for (i = 0; i + 4 * DOUBLE_PER_M256_REG <= len; i += 4 * DOUBLE_PER_M256_REG) {
+		sreg = madd_pd(_mm256_load_pd(x + i), _mm256_load_pd(y + i), sreg);
+		sreg1 = madd_pd(_mm256_load_pd(x + i + 4), _mm256_load_pd(y + i + 4), sreg1);
+		sreg2 = madd_pd(_mm256_load_pd(x + i + 8), _mm256_load_pd(y + i + 8), sreg2);
+		sreg3 = madd_pd(_mm256_load_pd(x + i + 12), _mm256_load_pd(y + i + 12), sreg3);
+	}
+
+	for (; i < len; i += DOUBLE_PER_M256_REG) {
+		sreg = madd_pd(_mm256_load_pd(x + i), _mm256_load_pd(y + i), sreg);
+	}
+
+	sreg = _mm256_add_pd(_mm256_add_pd(sreg, sreg1), _mm256_add_pd(sreg2, sreg3));
+
+	return _mm256_register_sum_pd(sreg);
+}
+
+TARGET_AVX2
+float _mm256_fdot_indexed_padded(const float *x, const int *xindices, const float *y, int n)
+{
+	int i;
+	int len = padded_count(n, FLOAT_PER_M256_REG);
+	__m256 xreg;
+	__m256 sreg = _mm256_set1_ps(0);
+	__m256i vindex;
+
+	for (i = 0; i < len; i += FLOAT_PER_M256_REG) {
+		vindex = _mm256_load_si256((const __m256i *)(xindices + i));
+		xreg = _mm256_i32gather_ps(x, vindex, 4);
+		sreg = madd_ps(xreg, _mm256_load_ps(y + i), sreg);
+	}
+
+	return _mm256_register_sum_ps(sreg);
+}
+
+TARGET_AVX2
+double _mm256_ddot_indexed_padded(const double *x, const int *xindices, const double *y, int n)
+{
+	int i;
+	int len = padded_count(n, DOUBLE_PER_M256_REG);
+	__m256d xreg;
+	__m256d sreg = _mm256_set1_pd(0);
+	__m128i vindex;
+
+	for (i = 0; i < len; i += DOUBLE_PER_M256_REG) {
+		vindex = _mm_load_si128((const __m128i *)(xindices + i));
+		xreg = _mm256_i32gather_pd(x, vindex, 8);
+		sreg = madd_pd(xreg, _mm256_load_pd(y + i), sreg);
+	}
+
+	return _mm256_register_sum_pd(sreg);
+}
+
+TARGET_AVX2
+float _mm256_fdot_indexed_padded_emu(const float *x, const int *xindices, const float *y, int n)
+{
+	int i;
+	int len = padded_count(n, FLOAT_PER_M256_REG);
+	__m256 sreg = _mm256_set1_ps(0);
+
+	for (i = 0; i < len; i += FLOAT_PER_M256_REG) {
+		sreg = madd_ps(emu_gather_ps(x, xindices + i), _mm256_load_ps(y + i), sreg);
+	}
+
+	return _mm256_register_sum_ps(sreg);
+}
+
+TARGET_AVX2
+double _mm256_ddot_indexed_padded_emu(const double *x, const int *xindices, const double *y, int n)
+{
+	int i;
+	int len = padded_count(n, DOUBLE_PER_M256_REG);
+	__m256d sreg = _mm256_set1_pd(0);
+
+	for (i = 0; i < len; i += DOUBLE_PER_M256_REG) {
+		sreg = madd_pd(emu_gather_pd(x, xindices + i), _mm256_load_pd(y + i), sreg);
+	}
+
+	return _mm256_register_sum_pd(sreg);
+}
+
+TARGET_AVX2
+void _mm256_copy1d_ps_padded(float *dst, const float *src, int n)
+{
+	int i;
+	int len = padded_count(n, FLOAT_PER_M256_REG);
+
+	for (i = 0; i < len; i += FLOAT_PER_M256_REG) {
+		_mm256_store_ps(dst + i, _mm256_load_ps(src + i));
+	}
+}
+
+TARGET_AVX2
+void _mm256_copy1d_epi32_padded(int *dst, const int *src, int n)
+{
+	int i;
+	int len = padded_count(n, INT32_PER_M256_REG);
+
+	for (i = 0; i < len; i += INT32_PER_M256_REG) {
+		_mm256_store_si256((__m256i *)(dst + i), _mm256_load_si256((const __m256i *)(src + i)));
+	}
+}
+
+#ifdef SUPPORTS_AVX512
+TARGET_AVX512
+void _mm512_sset_value_padded(float *x, int n, float value)
+{
+	int k;
+	__m512 vreg = _mm512_set1_ps(value);
+
+	for (k = 0; k + FLOAT_PER_M512_REG < n; k += FLOAT_PER_M512_REG) {
+		_mm512_store_ps(x + k, vreg);
+	}
+
+	if (k < n) {
+		_mm512_store_ps(x + k, _mm512_maskz_mov_ps((__mmask16)((1u << (n - k)) - 1), vreg));
+	}
+}
+
+TARGET_AVX512
+void _mm512_dset_value_padded(double *x, int n, double value)
+{
+	int k;
+	__m512d vreg = _mm512_set1_pd(value);
+
+	for (k = 0; k + DOUBLE_PER_M512_REG < n; k += DOUBLE_PER_M512_REG) {
+		_mm512_store_pd(x + k, vreg);
+	}
+
+	if (k < n) {
+		_mm512_store_pd(x + k, _mm512_maskz_mov_pd((__mmask8)((1u << (n - k)) - 1), vreg));
+	}
+}
+
+TARGET_AVX512
+float _mm512_fdot_padded(const float *x, const float *y, int n)
+{
+	int i;
+	int len = padded_count(n, FLOAT_PER_M512_REG);
+	__m512 sreg = _mm512_set1_ps(0);
+	__m512 sreg1 = _mm512_set1_ps(0);
+
+	for (i = 0; i + 2 * FLOAT_PER_M512_REG <= len; i += 2 * FLOAT_PER_M512_REG) {
+		sreg = _mm512_fmadd_ps(_mm512_load_ps(x + i), _mm512_load_ps(y + i), sreg);
+		sreg1 = _mm512_fmadd_ps(_mm512_load_ps(x + i + 16), _mm512_load_ps(y + i + 16), sreg1);
+	}
+
+	if (i < len) {
+		sreg = _mm512_fmadd_ps(_mm512_load_ps(x + i), _mm512_load_ps(y + i), sreg);
+	}
+
+	return _mm512_register_sum_ps(_mm512_add_ps(sreg, sreg1));
+}
+
+TARGET_AVX512
+double _mm512_ddot_padded(const double *x, const double *y, int n)
+{
+	int i;
+	int len = padded_count(n, DOUBLE_PER_M512_REG);
+	__m512d sreg = _mm512_set1_pd(0);
+	__m512d sreg1 = _mm512_set1_pd(0);
+
+	for (i = 0; i + 2 * DOUBLE_PER_M512_REG <= len; i += 2 * DOUBLE_PER_M512_REG) {
+		sreg = _mm512_fmadd_pd(_mm512_load_pd(x + i), _mm512_load_pd(y + i), sreg);
+		sreg1 = _mm512_fmadd_pd(_mm512_load_pd(x + i + 8), _mm512_load_pd(y + i + 8), sreg1);
+	}
+
+	if (i < len) {
+		sreg = _mm512_fmadd_pd(_mm512_load_pd(x + i), _mm512_load_pd(y + i), sreg);
+	}
+
+	return _mm512_register_sum_pd(_mm512_add_pd(sreg, sreg1));
+}
+
+TARGET_AVX512
+float _mm512_fdot_indexed_padded(const float *x, const int *xindices, const float *y, int n)
+{
+	int i;
+	int len = padded_count(n, FLOAT_PER_M512_REG);
+	__m512 xreg;
+	__m512 sreg = _mm512_set1_ps(0);
+	__m512i vindex;
+
+	for (i = 0; i < len; i += FLOAT_PER_M512_REG) {
+		vindex = _mm512_load_si512(xindices + i);
+		xreg = _mm512_i32gather_ps(vindex, x, 4);
+		sreg = _mm512_fmadd_ps(xreg, _mm512_load_ps(y + i), sreg);
+	}
+
+	return _mm512_register_sum_ps(sreg);
+}
+
+TARGET_AVX512
+double _mm512_ddot_indexed_padded(const double *x, const int *xindices, const double *y, int n)
+{
+	int i;
+	int len = padded_count(n, DOUBLE_PER_M512_REG);
+	__m512d xreg;
+	__m512d sreg = _mm512_set1_pd(0);
+	__m256i vindex;
+
+	for (i = 0; i < len; i += DOUBLE_PER_M512_REG) {
+		vindex = _mm256_load_si256((const __m256i *)(xindices + i));
+		xreg = _mm512_i32gather_pd(vindex, x, 8);
+		sreg = _mm512_fmadd_pd(xreg, _mm512_load_pd(y + i), sreg);
+	}
+
+	return _mm512_register_sum_pd(sreg);
+}
+
+TARGET_AVX512
+float _mm512_fdot_indexed_padded_emu(const float *x, const int *xindices, const float *y, int n)
+{
+	int i;
+	int len = padded_count(n, FLOAT_PER_M512_REG);
+	__m512 sreg = _mm512_set1_ps(0);
+
+	for (i = 0; i < len; i += FLOAT_PER_M512_REG) {
+		sreg = _mm512_fmadd_ps(emu_gather_ps512(x, xindices + i), _mm512_load_ps(y + i), sreg);
+	}
+
+	return _mm512_register_sum_ps(sreg);
+}
+
+TARGET_AVX512
+double _mm512_ddot_indexed_padded_emu(const double *x, const int *xindices, const double *y, int n)
+{
+	int i;
+	int len = padded_count(n, DOUBLE_PER_M512_REG);
+	__m512d sreg = _mm512_set1_pd(0);
+
+	for (i = 0; i < len; i += DOUBLE_PER_M512_REG) {
+		sreg = _mm512_fmadd_pd(emu_gather_pd512(x, xindices + i), _mm512_load_pd(y + i), sreg);
+	}
+
+	return _mm512_register_sum_pd(sreg);
+}
+
+TARGET_AVX512
+void _mm512_copy1d_ps_padded(float *dst, const float *src, int n)
+{
+	int i;
+	int len = padded_count(n, FLOAT_PER_M512_REG);
+
+	for (i = 0; i < len; i += FLOAT_PER_M512_REG) {
+		_mm512_store_ps(dst + i, _mm512_load_ps(src + i));
+	}
+}
+
+TARGET_AVX512
+void _mm512_copy1d_epi32_padded(int *dst, const int *src, int n)
+{
+	int i;
+	int len = padded_count(n, INT32_PER_M512_REG);
+
+	for (i = 0; i < len; i += INT32_PER_M512_REG) {
+		_mm512_store_si512(dst + i, _mm512_load_si512(src + i));
+	}
+}
+#endif
+
+//----------------------------------------------------------------------------
+// Integer dot products, returned as 64-bit sums. epi32 products are widened
+// with mul_epi32 on the even and odd lanes. epi16 and widened u8/i8 pairs go
+// through madd_epi16. Its 32-bit pair sums can only wrap for two products of
+// (-32768)^2, so they are offset by MADD_EPI16_BIAS into the unsigned range
+// and zero-extended, and the offset is subtracted at the end. Pair sums of
+// bytes are small enough to stay in 32-bit lanes for INT8_DOT_BLOCK registers
+// before being widened, even four at a time as vpdpbusd adds them. The
+// indexed epi16 kernels gather the dword ending at each element, so no byte
+// past it is read; index 0 is blended in rather than read from x - 1. Bytes
+// are too narrow to gather, so the indexed u8i8 kernels insert scalars.
+//----------------------------------------------------------------------------
+
+#define MADD_EPI16_BIAS 2147418112
+#define INT8_DOT_BLOCK 8192
+
+static inline int64_t sum_epi64_128(__m128i a)
+{
+	return _mm_cvtsi128_si64(a) + _mm_extract_epi64(a, 1);
+}
+
+// Adds the 64-bit products of the even and of the odd 32-bit lanes.
+static inline __m128i mul_add_epi32_128(__m128i sum, __m128i a, __m128i b)
+{
+	sum = _mm_add_epi64(sum, _mm_mul_epi32(a, b));
+
+	return _mm_add_epi64(sum, _mm_mul_epi32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32)));
+}
+
+// Adds the biased pair sums of madd_epi16, zero-extended to 64 bits.
+static inline __m128i madd_add_epi16_128(__m128i sum, __m128i a, __m128i b)
+{
+	__m128i zero = _mm_setzero_si128();
+	__m128i pairs = _mm_add_epi32(_mm_madd_epi16(a, b), _mm_set1_epi32(MADD_EPI16_BIAS));
+
+	sum = _mm_add_epi64(sum, _mm_unpacklo_epi32(pairs, zero));
+
+	return _mm_add_epi64(sum, _mm_unpackhi_epi32(pairs, zero));
+}
+
+static inline __m128i widen_add_epi32_128(__m128i sum, __m128i a)
+{
+	sum = _mm_add_epi64(sum, _mm_cvtepi32_epi64(a));
+
+	return _mm_add_epi64(sum, _mm_cvtepi32_epi64(_mm_unpackhi_epi64(a, a)));
+}
+
+int64_t _mm_dot_epi32(const int *x, const int *y, int n)
+{
+	int i;
+	int cutoff = n % INT32_PER_M128_REG;
+	int64_t sum = 0;
+	__m128i xreg, yreg;
+	__m128i sreg = _mm_setzero_si128();
+
+	for (i = 0; i < cutoff; i++) {
+		sum += (int64_t)x[i] * y[i];
+	}
+
+	for (i = cutoff; i < n; i += INT32_PER_M128_REG) {
+		xreg = _mm_loadu_si128((const __m128i *)(x + i));
+		yreg = _mm_loadu_si128((const __m128i *)(y + i));
+		sreg = mul_add_epi32_128(sreg, xreg, yreg);
+	}
+
+	return sum + sum_epi64_128(sreg);
+}
+
+int64_t _mm_dot_indexed_epi32(const int *x, const int *xindices, const int *y, int n)
+{
+	int i;
+	int cutoff = n % INT32_PER_M128_REG;
+	int64_t sum = 0;
+	const int *k;
+	__m128i xreg, yreg;
+	__m128i sreg = _mm_setzero_si128();
+
+	for (i = 0; i < cutoff; i++) {
+		sum += (int64_t)x[xindices[i]] * y[i];
+	}
+
+	for (i = cutoff; i < n; i += INT32_PER_M128_REG) {
+		k = xindices + i;
+		xreg = _mm_setr_epi32(x[k[0]], x[k[1]], x[k[2]], x[k[3]]);
+		yreg = _mm_loadu_si128((const __m128i *)(y + i));
+		sreg = mul_add_epi32_128(sreg, xreg, yreg);
+	}
+
+	return sum + sum_epi64_128(sreg);
+}
+
+int64_t _mm_dot_epi16(const int16_t *x, const int16_t *y, int n)
+{
+	int i;
+	int cutoff = n % INT16_PER_M128_REG;
+	int64_t sum = 0;
+	__m128i xreg, yreg;
+	__m128i sreg = _mm_setzero_si128();
+
+	for (i = 0; i < cutoff; i++) {
+		sum += (int32_t)x[i] * y[i];
+	}
+
+	for (i = cutoff; i < n; i += INT16_PER_M128_REG) {
+		xreg = _mm_loadu_si128((const __m128i *)(x + i));
+		yreg = _mm_loadu_si128((const __m128i *)(y + i));
+		sreg = madd_add_epi16_128(sreg, xreg, yreg);
+	}
+
+	sum -= (int64_t)MADD_EPI16_BIAS * ((n - cutoff) / 2);
+
+	return sum + sum_epi64_128(sreg);
+}
+
+int64_t _mm_dot_indexed_epi16(const int16_t *x, const int *xindices, const int16_t *y, int n)
+{
+	int i;
+	int cutoff = n % INT16_PER_M128_REG;
+	int64_t sum = 0;
+	const int *k;
+	__m128i xreg, yreg;
+	__m128i sreg = _mm_setzero_si128();
+
+	for (i = 0; i < cutoff; i++) {
+		sum += (int32_t)x[xindices[i]] * y[i];
+	}
+
+	for (i = cutoff; i < n; i += INT16_PER_M128_REG) {
+		k = xindices + i;
+		xreg = _mm_setr_epi16(x[k[0]], x[k[1]], x[k[2]], x[k[3]], x[k[4]], x[k[5]], x[k[6]], x[k[7]]);
+		yreg = _mm_loadu_si128((const __m128i *)(y + i));
+		sreg = madd_add_epi16_128(sreg, xreg, yreg);
+	}
+
+	sum -= (int64_t)MADD_EPI16_BIAS * ((n - cutoff) / 2);
+
+	return sum + sum_epi64_128(sreg);
+}
+
+int64_t _mm_dot_u8i8(const uint8_t *x, const int8_t *y, int n)
+{
+	int i, end;
+	int cutoff = n % INT16_PER_M128_REG;
+	int64_t sum = 0;
+	__m128i xreg, yreg;
+	__m128i preg;
+	__m128i sreg = _mm_setzero_si128();
+
+	for (i = 0; i < cutoff; i++) {
+		sum += (int32_t)x[i] * y[i];
+	}
+
+	for (i = cutoff; i < n; i = end) {
+		end = n - i > INT8_DOT_BLOCK * INT16_PER_M128_REG ? i + INT8_DOT_BLOCK * INT16_PER_M128_REG : n;
+		preg = _mm_setzero_si128();
+
+		for (; i < end; i += INT16_PER_M128_REG) {
+			xreg = _mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i *)(x + i)));
+			yreg = _mm_cvtepi8_epi16(_mm_loadl_epi64((const __m128i *)(y + i)));
+			preg = _mm_add_epi32(preg, _mm_madd_epi16(xreg, yreg));
+		}
+
+		sreg = widen_add_epi32_128(sreg, preg);
+	}
+
+	return sum + sum_epi64_128(sreg);
+}
+
+int64_t _mm_dot_indexed_u8i8(const uint8_t *x, const int *xindices, const int8_t *y, int n)
+{
+	int i, end;
+	int cutoff = n % INT16_PER_M128_REG;
+	int64_t sum = 0;
+	const int *k;
+	__m128i xreg, yreg;
+	__m128i preg;
+	__m128i sreg = _mm_setzero_si128();
+
+	for (i = 0; i < cutoff; i++) {
+		sum += (int32_t)x[xindices[i]] * y[i];
+	}
+
+	for (i = cutoff; i < n; i = end) {
+		end = n - i > INT8_DOT_BLOCK * INT16_PER_M128_REG ? i + INT8_DOT_BLOCK * INT16_PER_M128_REG : n;
+		preg = _mm_setzero_si128();
+
+		for (; i < end; i += INT16_PER_M128_REG) {
+			k = xindices + i;
+			xreg = _mm_setr_epi16(x[k[0]], x[k[1]], x[k[2]], x[k[3]], x[k[4]], x[k[5]], x[k[6]], x[k[7]]);
+			yreg = _mm_cvtepi8_epi16(_mm_loadl_epi64((const __m128i *)(y + i)));
+			preg = _mm_add_epi32(preg, _mm_madd_epi16(xreg, yreg));
+		}
+
+		sreg = widen_add_epi32_128(sreg, preg);
+	}
+
+	return sum + sum_epi64_128(sreg);
+}
+
+TARGET_AVX2
+static inline int64_t sum_epi64_256(__m256i a)
+{
+	return sum_epi64_128(_mm_add_epi64(_mm256_castsi256_si128(a), _mm256_extracti128_si256(a, 1)));
+}
+
+TARGET_AVX2
+static inline __m256i mul_add_epi32_256(__m256i sum, __m256i a, __m256i b)
+{
+	sum = _mm256_add_epi64(sum, _mm256_mul_epi32(a, b));
+
+	return _mm256_add_epi64(sum, _mm256_mul_epi32(_mm256_srli_epi64(a, 32), _mm256_srli_epi64(b, 32)));
+}
+
+TARGET_AVX2
+static inline __m256i madd_add_epi16_256(__m256i sum, __m256i a, __m256i b)
+{
+	__m256i zero = _mm256_setzero_si256();
+	__m256i pairs = _mm256_add_epi32(_mm256_madd_epi16(a, b), _mm256_set1_epi32(MADD_EPI16_BIAS));
+
+	sum = _mm256_add_epi64(sum, _mm256_unpacklo_epi32(pairs, zero));
+
+	return _mm256_add_epi64(sum, _mm256_unpackhi_epi32(pairs, zero));
+}
+
+TARGET_AVX2
+static inline __m256i widen_add_epi32_256(__m256i sum, __m256i a)
+{
+	sum = _mm256_add_epi64(sum, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(a)));
+
+	return _mm256_add_epi64(sum, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(a, 1)));
+}
+
+// Loads the elements x[k] for eight indices, each in the upper half of its
+// dword with the lower half cleared.
+TARGET_AVX2
+static inline __m256i gather_high_epi16_256(const int16_t *x, __m256i vindex)
+{
+	__m256i zero = _mm256_setzero_si256();
+	__m256i first = _mm256_set1_epi32((int)((uint32_t)(uint16_t)x[0] << 16));
+	__m256i mask = _mm256_xor_si256(_mm256_cmpeq_epi32(vindex, zero), _mm256_set1_epi32(INT32_ALLBITS));
+	__m256i xreg = _mm256_mask_i32gather_epi32(first, (const int *)(x - 1), vindex, mask, 2);
+
+	return _mm256_and_si256(xreg, _mm256_set1_epi32((int32_t)0xFFFF0000));
+}
+
+TARGET_AVX2
+int64_t _mm256_dot_epi32(const int *x, const int *y, int n)
+{
+	int i;
+	int cutoff = n % INT32_PER_M256_REG;
+	__m256i xreg, yreg;
+	__m256i mask;
+	__m256i sreg = _mm256_setzero_si256();
+	__m256i sreg1 = _mm256_setzero_si256();
+
+	if (cutoff > 0) {
+		mask = _mm256_set_mask_epi32(cutoff - 1);
+		xreg = _mm256_maskload_epi32(x, mask);
+		yreg = _mm256_maskload_epi32(y, mask);
+		sreg = mul_add_epi32_256(sreg, xreg, yreg);
+	}
+
+	for (i = cutoff; i + 2 * INT32_PER_M256_REG <= n; i += 2 * INT32_PER_M256_REG) {
+		sreg = mul_add_epi32_256(sreg, _mm256_loadu_si256((const __m256i *)(x + i)), _mm256_loadu_si256((const __m256i *)(y + i)));
+		sreg1 = mul_add_epi32_256(sreg1, _mm256_loadu_si256((const __m256i *)(x + i + 8)), _mm256_loadu_si256((const __m256i *)(y + i + 8)));
+	}
+
+	if (i < n) {
+		sreg = mul_add_epi32_256(sreg, _mm256_loadu_si256((const __m256i *)(x + i)), _mm256_loadu_si256((const __m256i *)(y + i)));
+	}
+
+	return sum_epi64_256(_mm256_add_epi64(sreg, sreg1));
+}
+
+TARGET_AVX2
+int64_t _mm256_dot_indexed_epi32(const int *x, const int *xindices, const int *y, int n)
+{
+	int i;
+	int cutoff = n % INT32_PER_M256_REG;
+	__m256i xreg, yreg;
+	__m256i vindex;
+	__m256i mask;
+	__m256i sreg = _mm256_setzero_si256();
+
+	if (cutoff > 0) {
+		mask = _mm256_set_mask_epi32(cutoff - 1);
+		vindex = _mm256_maskload_epi32(xindices, mask);
+		xreg = _mm256_mask_i32gather_epi32(sreg, x, vindex, mask, 4);
+		yreg = _mm256_maskload_epi32(y, mask);
+		sreg = mul_add_epi32_256(sreg, xreg, yreg);
+	}
+
+	for (i = cutoff; i < n; i += INT32_PER_M256_REG) {
+		vindex = _mm256_loadu_si256((const __m256i *)(xindices + i));
+		xreg = _mm256_i32gather_epi32(x, vindex, 4);
+		yreg = _mm256_loadu_si256((const __m256i *)(y + i));
+		sreg = mul_add_epi32_256(sreg, xreg, yreg);
+	}
+
+	return sum_epi64_256(sreg);
+}
+
+TARGET_AVX2
+int64_t _mm256_dot_epi16(const int16_t *x, const int16_t *y, int n)
+{
+	int i;
+	int cutoff = n % INT16_PER_M256_REG;
+	int64_t sum = 0;
+	__m256i xreg, yreg;
+	__m256i sreg = _mm256_setzero_si256();
+
+	for (i = 0; i < cutoff; i++) {
+		sum += (int32_t)x[i] * y[i];
+	}
+
+	for (i = cutoff; i < n; i += INT16_PER_M256_REG) {
+		xreg = _mm256_loadu_si256((const __m256i *)(x + i));
+		yreg = _mm256_loadu_si256((const __m256i *)(y + i));
+		sreg = madd_add_epi16_256(sreg, xreg, yreg);
+	}
+
+	sum -= (int64_t)MADD_EPI16_BIAS * ((n - cutoff) / 2);
+
+	return sum + sum_epi64_256(sreg);
+}
+
+TARGET_AVX2
+int64_t _mm256_dot_indexed_epi16(const int16_t *x, const int *xindices, const int16_t *y, int n)
+{
+	int i;
+	int cutoff = n % INT32_PER_M256_REG;
+	int64_t sum = 0;
+	__m256i xreg, yreg;
+	__m256i vindex;
+	__m256i preg;
+	__m256i sreg = _mm256_setzero_si256();
+
+	for (i = 0; i < cutoff; i++) {
+		sum += (int32_t)x[xindices[i]] * y[i];
+	}
+
+	// With both operands in the upper halves of their dwords, madd_epi16
+	// leaves each product alone in its lane.
+	for (i = cutoff; i < n; i += INT32_PER_M256_REG) {
+		vindex = _mm256_loadu_si256((const __m256i *)(xindices + i));
+		xreg = gather_high_epi16_256(x, vindex);
+		yreg = _mm256_slli_epi32(_mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *)(y + i))), 16);
+		preg = _mm256_madd_epi16(xreg, yreg);
+		sreg = widen_add_epi32_256(sreg, preg);
+	}
+
+	return sum + sum_epi64_256(sreg);
+}
+
+TARGET_AVX2
+int64_t _mm256_dot_u8i8(const uint8_t *x, const int8_t *y, int n)
+{
+	int i, end;
+	int cutoff = n % INT16_PER_M256_REG;
+	int64_t sum = 0;
+	__m256i xreg, yreg;
+	__m256i preg;
+	__m256i sreg = _mm256_setzero_si256();
+
+	for (i = 0; i < cutoff; i++) {
+		sum += (int32_t)x[i] * y[i];
+	}
+
+	for (i = cutoff; i < n; i = end) {
+		end = n - i > INT8_DOT_BLOCK * INT16_PER_M256_REG ? i + INT8_DOT_BLOCK * INT16_PER_M256_REG : n;
+		preg = _mm256_setzero_si256();
+
+		for (; i < end; i += INT16_PER_M256_REG) {
+			xreg = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(x + i)));
+			yreg = _mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i *)(y + i)));
+			preg = _mm256_add_epi32(preg, _mm256_madd_epi16(xreg, yreg));
+		}
+
+		sreg = widen_add_epi32_256(sreg, preg);
+	}
+
+	return sum + sum_epi64_256(sreg);
+}
+
+TARGET_AVX2
+int64_t _mm256_dot_indexed_u8i8(const uint8_t *x, const int *xindices, const int8_t *y, int n)
+{
+	int i, end;
+	int cutoff = n % INT16_PER_M256_REG;
+	int64_t sum = 0;
+	const int *k;
+	__m256i xreg, yreg;
+	__m256i preg;
+	__m256i sreg = _mm256_setzero_si256();
+
+	for (i = 0; i < cutoff; i++) {
+		sum += (int32_t)x[xindices[i]] * y[i];
+	}
+
+	for (i = cutoff; i < n; i = end) {
+		end = n - i > INT8_DOT_BLOCK * INT16_PER_M256_REG ? i + INT8_DOT_BLOCK * INT16_PER_M256_REG : n;
+		preg = _mm256_setzero_si256();
+
+		for (; i < end; i += INT16_PER_M256_REG) {
+			k = xindices + i;
+			xreg = _mm256_setr_epi16(x[k[0]], x[k[1]], x[k[2]], x[k[3]], x[k[4]], x[k[5]], x[k[6]], x[k[7]],
+				x[k[8]], x[k[9]], x[k[10]], x[k[11]], x[k[12]], x[k[13]], x[k[14]], x[k[15]]);
+			yreg = _mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i *)(y + i)));
+			preg = _mm256_add_epi32(preg, _mm256_madd_epi16(xreg, yreg));
+		}
+
+		sreg = widen_add_epi32_256(sreg, preg);
+	}
+
+	return sum + sum_epi64_256(sreg);
+}
+
+#ifdef SUPPORTS_AVXVNNI
+TARGET_AVXVNNI
+int64_t _mm256_dot_u8i8_vnni(const uint8_t *x, const int8_t *y, int n)
+{
+	int i, end;
+	int cutoff = n % INT8_PER_M256_REG;
+	int64_t sum = 0;
+	__m256i xreg, yreg;
+	__m256i preg;
+	__m256i sreg = _mm256_setzero_si256();
+
+	for (i = 0; i < cutoff; i++) {
+		sum += (int32_t)x[i] * y[i];
+	}
+
+	for (i = cutoff; i < n; i = end) {
+		end = n - i > INT8_DOT_BLOCK * INT8_PER_M256_REG ? i + INT8_DOT_BLOCK * INT8_PER_M256_REG : n;
+		preg = _mm256_setzero_si256();
+
+		for (; i < end; i += INT8_PER_M256_REG) {
+			xreg = _mm256_loadu_si256((const __m256i *)(x + i));
+			yreg = _mm256_loadu_si256((const __m256i *)(y + i));
+			preg = _mm256_dpbusd_avx_epi32(preg, xreg, yreg);
+		}
+
+		sreg = widen_add_epi32_256(sreg, preg);
+	}
+
+	return sum + sum_epi64_256(sreg);
+}
+#endif
+
+#ifdef SUPPORTS_AVX512
+TARGET_AVX512
+static inline __m512i mul_add_epi32_512(__m512i sum, __m512i a, __m512i b)
+{
+	sum = _mm512_add_epi64(sum, _mm512_mul_epi32(a, b));
+
+	return _mm512_add_epi64(sum, _mm512_mul_epi32(_mm512_srli_epi64(a, 32), _mm512_srli_epi64(b, 32)));
+}
+
+TARGET_AVX512
+static inline __m512i widen_add_epi32_512(__m512i sum, __m512i a)
+{
+	sum = _mm512_add_epi64(sum, _mm512_cvtepi32_epi64(_mm512_castsi512_si256(a)));
+
+	return _mm512_add_epi64(sum, _mm512_cvtepi32_epi64(_mm512_extracti64x4_epi64(a, 1)));
+}
+
+TARGET_AVX512
+int64_t _mm512_dot_epi32(const int *x, const int *y, int n)
+{
+	int i;
+	int cutoff = n % INT32_PER_M512_REG;
+	__m512i xreg, yreg;
+	__mmask16 mask;
+	__m512i sreg = _mm512_setzero_si512();
+	__m512i sreg1 = _mm512_setzero_si512();
+
+	if (cutoff > 0) {
+		mask = _mm512_set_mask_epi32(cutoff - 1);
+		xreg = _mm512_maskz_loadu_epi32(mask, x);
+		yreg = _mm512_maskz_loadu_epi32(mask, y);
+		sreg = mul_add_epi32_512(sreg, xreg, yreg);
+	}
+
+	for (i = cutoff; i + 2 * INT32_PER_M512_REG <= n; i += 2 * INT32_PER_M512_REG) {
+		sreg = mul_add_epi32_512(sreg, _mm512_loadu_si512(x + i), _mm512_loadu_si512(y + i));
+		sreg1 = mul_add_epi32_512(sreg1, _mm512_loadu_si512(x + i + 16), _mm512_loadu_si512(y + i + 16));
+	}
+
+	if (i < n) {
+		sreg = mul_add_epi32_512(sreg, _mm512_loadu_si512(x + i), _mm512_loadu_si512(y + i));
+	}
+
+	return _mm512_reduce_add_epi64(_mm512_add_epi64(sreg, sreg1));
+}
+
+TARGET_AVX512
+int64_t _mm512_dot_indexed_epi32(const int *x, const int *xindices, const int *y, int n)
+{
+	int i;
+	int cutoff = n % INT32_PER_M512_REG;
+	__m512i xreg, yreg;
+	__m512i vindex;
+	__mmask16 mask;
+	__m512i sreg = _mm512_setzero_si512();
+
+	if (cutoff > 0) {
+		mask = _mm512_set_mask_epi32(cutoff - 1);
+		vindex = _mm512_maskz_loadu_epi32(mask, xindices);
+		xreg = _mm512_mask_i32gather_epi32(sreg, mask, vindex, x, 4);
+		yreg = _mm512_maskz_loadu_epi32(mask, y);
+		sreg = mul_add_epi32_512(sreg, xreg, yreg);
+	}
+
+	for (i = cutoff; i < n; i += INT32_PER_M512_REG) {
+		vindex = _mm512_loadu_si512(xindices + i);
+		xreg = _mm512_i32gather_epi32(vindex, x, 4);
+		yreg = _mm512_loadu_si512(y + i);
+		sreg = mul_add_epi32_512(sreg, xreg, yreg);
+	}
+
+	return _mm512_reduce_add_epi64(sreg);
+}
+#endif
+
+#ifdef SUPPORTS_AVX512BW
+TARGET_AVX512BW
+static inline __m512i madd_add_epi16_512(__m512i sum, __m512i a, __m512i b)
+{
+	__m512i zero = _mm512_setzero_si512();
+	__m512i pairs = _mm512_add_epi32(_mm512_madd_epi16(a, b), _mm512_set1_epi32(MADD_EPI16_BIAS));
+
+	sum = _mm512_add_epi64(sum, _mm512_unpacklo_epi32(pairs, zero));
+
+	return _mm512_add_epi64(sum, _mm512_unpackhi_epi32(pairs, zero));
+}
+
+TARGET_AVX512BW
+int64_t _mm512_dot_epi16(const int16_t *x, const int16_t *y, int n)
+{
+	int i;
+	int cutoff = n % INT16_PER_M512_REG;
+	int64_t sum;
+	__m512i xreg, yreg;
+	__mmask32 mask;
+	__m512i sreg = _mm512_setzero_si512();
+
+	if (cutoff > 0) {
+		mask = (__mmask32)((1u << cutoff) - 1);
+		xreg = _mm512_maskz_loadu_epi16(mask, x);
+		yreg = _mm512_maskz_loadu_epi16(mask, y);
+		sreg = madd_add_epi16_512(sreg, xreg, yreg);
+	}
+
+	for (i = cutoff; i < n; i += INT16_PER_M512_REG) {
+		xreg = _mm512_loadu_si512(x + i);
+		yreg = _mm512_loadu_si512(y + i);
+		sreg = madd_add_epi16_512(sreg, xreg, yreg);
+	}
+
+	sum = _mm512_reduce_add_epi64(sreg);
+
+	return sum - (int64_t)MADD_EPI16_BIAS * ((n + INT16_PER_M512_REG - 1) / INT16_PER_M512_REG) * INT32_PER_M512_REG;
+}
+
+TARGET_AVX512BW
+int64_t _mm512_dot_indexed_epi16(const int16_t *x, const int *xindices, const int16_t *y, int n)
+{
+	int i;
+	int cutoff = n % INT32_PER_M512_REG;
+	__m512i xreg, yreg;
+	__m512i vindex;
+	__m512i first = _mm512_set1_epi32((int)((uint32_t)(uint16_t)x[0] << 16));
+	__m512i high = _mm512_set1_epi32((int32_t)0xFFFF0000);
+	__mmask16 mask;
+	__m512i sreg = _mm512_setzero_si512();
+
+	// As in the AVX2 kernel, both operands sit in the upper halves of their
+	// dwords so that madd_epi16 leaves each product alone in its lane.
+	if (cutoff > 0) {
+		mask = _mm512_set_mask_epi32(cutoff - 1);
+		vindex = _mm512_maskz_loadu_epi32(mask, xindices);
+		mask = _mm512_mask_cmpneq_epi32_mask(mask, vindex, _mm512_setzero_si512());
+		xreg = _mm512_and_si512(_mm512_mask_i32gather_epi32(first, mask, vindex, (const int *)(x - 1), 2), high);
+		yreg = _mm512_slli_epi32(_mm512_cvtepi16_epi32(_mm512_castsi512_si256(_mm512_maskz_loadu_epi16((__mmask32)((1u << cutoff) - 1), y))), 16);
+		sreg = widen_add_epi32_512(sreg, _mm512_madd_epi16(xreg, yreg));
+	}
+
+	for (i = cutoff; i < n; i += INT32_PER_M512_REG) {
+		vindex = _mm512_loadu_si512(xindices + i);
+		mask = _mm512_cmpneq_epi32_mask(vindex, _mm512_setzero_si512());
+		xreg = _mm512_and_si512(_mm512_mask_i32gather_epi32(first, mask, vindex, (const int *)(x - 1), 2), high);
+		yreg = _mm512_slli_epi32(_mm512_cvtepi16_epi32(_mm256_loadu_si256((const __m256i *)(y + i))), 16);
+		sreg = widen_add_epi32_512(sreg, _mm512_madd_epi16(xreg, yreg));
+	}
+
+	return _mm512_reduce_add_epi64(sreg);
+}
+
+TARGET_AVX512BW
+int64_t _mm512_dot_u8i8(const uint8_t *x, const int8_t *y, int n)
+{
+	int i, end;
+	int cutoff = n % INT16_PER_M512_REG;
+	__m512i xreg, yreg;
+	__m512i preg = _mm512_setzero_si512();
+	__m512i sreg = _mm512_setzero_si512();
+	__mmask64 mask;
+
+	if (cutoff > 0) {
+		mask = (__mmask64)((1ull << cutoff) - 1);
+		xreg = _mm512_cvtepu8_epi16(_mm512_castsi512_si256(_mm512_maskz_loadu_epi8(mask, x)));
+		yreg = _mm512_cvtepi8_epi16(_mm512_castsi512_si256(_mm512_maskz_loadu_epi8(mask, y)));
+		preg = _mm512_madd_epi16(xreg, yreg);
+	}
+
+	for (i = cutoff; i < n; i = end) {
+		end = n - i > INT8_DOT_BLOCK * INT16_PER_M512_REG ? i + INT8_DOT_BLOCK * INT16_PER_M512_REG : n;
+
+		for (; i < end; i += INT16_PER_M512_REG) {
+			xreg = _mm512_cvtepu8_epi16(_mm256_loadu_si256((const __m256i *)(x + i)));
+			yreg = _mm512_cvtepi8_epi16(_mm256_loadu_si256((const __m256i *)(y + i)));
+			preg = _mm512_add_epi32(preg, _mm512_madd_epi16(xreg, yreg));
+		}
+
+		sreg = widen_add_epi32_512(sreg, preg);
+		preg = _mm512_setzero_si512();
+	}
+
+	sreg = widen_add_epi32_512(sreg, preg);
+
+	return _mm512_reduce_add_epi64(sreg);
+}
+
+TARGET_AVX512BW
+int64_t _mm512_dot_indexed_u8i8(const uint8_t *x, const int *xindices, const int8_t *y, int n)
+{
+	int i, end;
+	int cutoff = n % INT16_PER_M512_REG;
+	int64_t sum = 0;
+	const int *k;
+	__m256i lo, hi;
+	__m512i xreg, yreg;
+	__m512i preg;
+	__m512i sreg = _mm512_setzero_si512();
+
+	for (i = 0; i < cutoff; i++) {
+		sum += (int32_t)x[xindices[i]] * y[i];
+	}
+
+	for (i = cutoff; i < n; i = end) {
+		end = n - i > INT8_DOT_BLOCK * INT16_PER_M512_REG ? i + INT8_DOT_BLOCK * INT16_PER_M512_REG : n;
+		preg = _mm512_setzero_si512();
+
+		for (; i < end; i += INT16_PER_M512_REG) {
+			k = xindices + i;
+			lo = _mm256_setr_epi16(x[k[0]], x[k[1]], x[k[2]], x[k[3]], x[k[4]], x[k[5]], x[k[6]], x[k[7]],
+				x[k[8]], x[k[9]], x[k[10]], x[k[11]], x[k[12]], x[k[13]], x[k[14]], x[k[15]]);
+			hi = _mm256_setr_epi16(x[k[16]], x[k[17]], x[k[18]], x[k[19]], x[k[20]], x[k[21]], x[k[22]], x[k[23]],
+				x[k[24]], x[k[25]], x[k[26]], x[k[27]], x[k[28]], x[k[29]], x[k[30]], x[k[31]]);
+			xreg = _mm512_inserti64x4(_mm512_castsi256_si512(lo), hi, 1);
+			yreg = _mm512_cvtepi8_epi16(_mm256_loadu_si256((const __m256i *)(y + i)));
+			preg = _mm512_add_epi32(preg, _mm512_madd_epi16(xreg, yreg));
+		}
+
+		sreg = widen_add_epi32_512(sreg, preg);
+	}
+
+	return sum + _mm512_reduce_add_epi64(sreg);
+}
+#endif
+
+#ifdef SUPPORTS_AVX512VNNI
+TARGET_AVX512VNNI
+int64_t _mm512_dot_u8i8_vnni(const uint8_t *x, const int8_t *y, int n)
+{
+	int i, end;
+	int cutoff = n % INT8_PER_M512_REG;
+	__m512i xreg, yreg;
+	__m512i preg = _mm512_setzero_si512();
+	__m512i sreg = _mm512_setzero_si512();
+	__mmask64 mask;
+
+	if (cutoff > 0) {
+		mask = (__mmask64)((1ull << cutoff) - 1);
+		xreg = _mm512_maskz_loadu_epi8(mask, x);
+		yreg = _mm512_maskz_loadu_epi8(mask, y);
+		preg = _mm512_dpbusd_epi32(preg, xreg, yreg);
+	}
+
+	for (i = cutoff; i < n; i = end) {
+		end = n - i > INT8_DOT_BLOCK * INT8_PER_M512_REG ? i + INT8_DOT_BLOCK * INT8_PER_M512_REG : n;
+
+		for (; i < end; i += INT8_PER_M512_REG) {
+			xreg = _mm512_loadu_si512(x + i);
+			yreg = _mm512_loadu_si512(y + i);
+			preg = _mm512_dpbusd_epi32(preg, xreg, yreg);
+		}
+
+		sreg = widen_add_epi32_512(sreg, preg);
+		preg = _mm512_setzero_si512();
+	}
+
+	sreg = widen_add_epi32_512(sreg, preg);
+
+	return _mm512_reduce_add_epi64(sreg);
+}
+#endif
+
+//----------------------------------------------------------------------------
+// Half-precision storage. Halves are IEEE binary16 bit patterns held in
+// uint16_t and are widened to float as they are loaded. The AVX kernels use
+// the F16C conversions. The SSE kernels and the scalar heads rebuild them
+// with integer operations: a half's exponent and mantissa shifted into a
+// float and scaled by 2^112 give the same value, subnormals included, and
+// floats are rounded to the nearest even half by adding a rounding bias in
+// the float's own bits. Both produce bit-identical results to F16C, including
+// quieted NaNs.
+//----------------------------------------------------------------------------
+
+#define HALF_SCALE 0x1p112f
+#define HALF_OVERFLOW_BITS (143 << 23)
+#define HALF_SUBNORMAL_BITS (113 << 23)
+#define HALF_REBIAS_ROUND 0xc8000fffu
+
+static inline float half_to_float(uint16_t h)
+{
+	uint32_t sign = (uint32_t)(h & 0x8000) << 16;
+	uint32_t bits = (uint32_t)(h & 0x7fff) << 13;
+	float f;
+
+	if (bits >= 0x0f800000) {
+		bits = 0x7f800000 | bits | (bits > 0x0f800000 ? 0x00400000 : 0);
+	} else {
+		memcpy(&f, &bits, sizeof(f));
+		f *= HALF_SCALE;
+		memcpy(&bits, &f, sizeof(bits));
+	}
+
+	bits |= sign;
+	memcpy(&f, &bits, sizeof(f));
+
+	return f;
+}
+
+static inline uint16_t float_to_half(float f)
+{
+	uint32_t bits, sign, out;
+	float sub;
+
+	memcpy(&bits, &f, sizeof(bits));
+	sign = (bits >> 16) & 0x8000;
+	bits &= 0x7fffffff;
+
+	if (bits >= HALF_OVERFLOW_BITS) {
+		out = bits > 0x7f800000 ? 0x7e00 | ((bits >> 13) & 0x3ff) : 0x7c00;
+	} else if (bits < HALF_SUBNORMAL_BITS) {
+		// Adding 0.5 lines the half's subnormal bits up with the bottom of
+		// the float mantissa, and the addition rounds them.
+		memcpy(&sub, &bits, sizeof(sub));
+		sub += 0.5f;
+		memcpy(&out, &sub, sizeof(out));
+		out -= 0x3f000000;
+	} else {
+		out = (bits + HALF_REBIAS_ROUND + ((bits >> 13) & 1)) >> 13;
+	}
+
+	return (uint16_t)(sign | out);
+}
+
+// Widens the halves held in the low words of each 32-bit lane.
+static inline __m128 cvtph_ps_128(__m128i h)
+{
+	__m128i expmant = _mm_and_si128(h, _mm_set1_epi32(0x7fff));
+	__m128i sign = _mm_slli_epi32(_mm_xor_si128(h, expmant), 16);
+	__m128 scaled = _mm_mul_ps(_mm_castsi128_ps(_mm_slli_epi32(expmant, 13)), _mm_set1_ps(HALF_SCALE));
+	__m128i infnan = _mm_and_si128(_mm_cmpgt_epi32(expmant, _mm_set1_epi32(0x7bff)), _mm_set1_epi32(0x7f800000));
+	__m128i quiet = _mm_and_si128(_mm_cmpgt_epi32(expmant, _mm_set1_epi32(0x7c00)), _mm_set1_epi32(0x00400000));
+
+	return _mm_castsi128_ps(_mm_or_si128(_mm_or_si128(_mm_castps_si128(scaled), sign), _mm_or_si128(infnan, quiet)));
+}
+
+// Narrows to halves in the low words of each 32-bit lane.
+static inline __m128i cvtps_ph_128(__m128 f)
+{
+	__m128i bits = _mm_castps_si128(f);
+	__m128i mag = _mm_and_si128(bits, _mm_set1_epi32(0x7fffffff));
+	__m128i sign = _mm_srli_epi32(_mm_xor_si128(bits, mag), 16);
+	__m128i nan = _mm_cmpgt_epi32(mag, _mm_set1_epi32(0x7f800000));
+	__m128i over = _mm_cmpgt_epi32(mag, _mm_set1_epi32(HALF_OVERFLOW_BITS - 1));
+	__m128i under = _mm_cmpgt_epi32(_mm_set1_epi32(HALF_SUBNORMAL_BITS), mag);
+	__m128i payload = _mm_and_si128(nan, _mm_or_si128(_mm_set1_epi32(0x200), _mm_and_si128(_mm_srli_epi32(mag, 13), _mm_set1_epi32(0x3ff))));
+	__m128i special = _mm_or_si128(_mm_set1_epi32(0x7c00), payload);
+	__m128i sub = _mm_sub_epi32(_mm_castps_si128(_mm_add_ps(_mm_castsi128_ps(mag), _mm_set1_ps(0.5f))), _mm_set1_epi32(0x3f000000));
+	__m128i odd = _mm_and_si128(_mm_srli_epi32(mag, 13), _mm_set1_epi32(1));
+	__m128i out = _mm_srli_epi32(_mm_add_epi32(_mm_add_epi32(mag, _mm_set1_epi32((int)HALF_REBIAS_ROUND)), odd), 13);
+
+	out = _mm_blendv_epi8(out, sub, under);
+	out = _mm_blendv_epi8(out, special, over);
+
+	return _mm_or_si128(out, sign);
+}
+
+static inline __m128 load_ph_128(const uint16_t *x)
+{
+	return cvtph_ps_128(_mm_cvtepu16_epi32(_mm_loadl_epi64((const __m128i *)x)));
+}
+
+void _mm_cvt_f16_to_f32(float *y, const uint16_t *x, int n)
+{
+	int i;
+	int cutoff = n % FLOAT_PER_M128_REG;
+
+	for (i = 0; i < cutoff; i++) {
+		y[i] = half_to_float(x[i]);
+	}
+
+	for (i = cutoff; i < n; i += FLOAT_PER_M128_REG) {
+		_mm_storeu_ps(y + i, load_ph_128(x + i));
+	}
+}
+
+void _mm_cvt_f32_to_f16(uint16_t *y, const float *x, int n)
+{
+	int i;
+	int cutoff = n % FLOAT_PER_M128_REG;
+	__m128i hreg;
+
+	for (i = 0; i < cutoff; i++) {
+		y[i] = float_to_half(x[i]);
+	}
+
+	for (i = cutoff; i < n; i += FLOAT_PER_M128_REG) {
+		hreg = cvtps_ph_128(_mm_loadu_ps(x + i));
+		_mm_storel_epi64((__m128i *)(y + i), _mm_packus_epi32(hreg, hreg));
+	}
+}
+
+float _mm_hdot(const uint16_t *x, const uint16_t *y, int n)
+{
+	int i;
+	int cutoff = n % FLOAT_PER_M128_REG;
+	float sum = 0;
+	__m128 sreg = _mm_setzero_ps();
+
+	for (i = 0; i < cutoff; i++) {
+		sum += half_to_float(x[i]) * half_to_float(y[i]);
+	}
+
+	for (i = cutoff; i < n; i += FLOAT_PER_M128_REG) {
+		sreg = _mm_add_ps(sreg, _mm_mul_ps(load_ph_128(x + i), load_ph_128(y + i)));
+	}
+
+	return sum + _mm_register_sum_ps(sreg);
+}
+
+float _mm_hdot_indexed(const uint16_t *x, const int *xindices, const uint16_t *y, int n)
+{
+	int i;
+	int cutoff = n % FLOAT_PER_M128_REG;
+	float sum = 0;
+	const int *k;
+	__m128 xreg;
+	__m128 sreg = _mm_setzero_ps();
+
+	for (i = 0; i < cutoff; i++) {
+		sum += half_to_float(x[xindices[i]]) * half_to_float(y[i]);
+	}
+
+	for (i = cutoff; i < n; i += FLOAT_PER_M128_REG) {
+		k = xindices + i;
+		xreg = cvtph_ps_128(_mm_setr_epi32(x[k[0]], x[k[1]], x[k[2]], x[k[3]]));
+		sreg = _mm_add_ps(sreg, _mm_mul_ps(xreg, load_ph_128(y + i)));
+	}
+
+	return sum + _mm_register_sum_ps(sreg);
+}
+
+TARGET_AVX2
+static inline __m256 load_ph_256(const uint16_t *x)
+{
+	return _mm256_cvtph_ps(_mm_loadu_si128((const __m128i *)x));
+}
+
+// Gathers eight halves through the dword ending at each, as for epi16.
+TARGET_AVX2
+static inline __m256 gather_ph_256(const uint16_t *x, __m256i vindex)
+{
+	__m256i xreg = _mm256_srli_epi32(gather_high_epi16_256((const int16_t *)x, vindex), 16);
+
+	xreg = _mm256_permute4x64_epi64(_mm256_packus_epi32(xreg, xreg), 0x08);
+
+	return _mm256_cvtph_ps(_mm256_castsi256_si128(xreg));
+}
+
+TARGET_AVX2
+void _mm256_cvt_f16_to_f32(float *y, const uint16_t *x, int n)
+{
+	int i;
+	int cutoff = n % FLOAT_PER_M256_REG;
+
+	for (i = 0; i < cutoff; i++) {
+		y[i] = half_to_float(x[i]);
+	}
+
+	for (i = cutoff; i < n; i += FLOAT_PER_M256_REG) {
+		_mm256_storeu_ps(y + i, load_ph_256(x + i));
+	}
+}
+
+TARGET_AVX2
+void _mm256_cvt_f32_to_f16(uint16_t *y, const float *x, int n)
+{
+	int i;
+	int cutoff = n % FLOAT_PER_M256_REG;
+
+	for (i = 0; i < cutoff; i++) {
+		y[i] = float_to_half(x[i]);
+	}
+
+	for (i = cutoff; i < n; i += FLOAT_PER_M256_REG) {
+		_mm_storeu_si128((__m128i *)(y + i), _mm256_cvtps_ph(_mm256_loadu_ps(x + i), _MM_FROUND_TO_NEAREST_INT));
+	}
+}
+
+TARGET_AVX2
+float _mm256_hdot(const uint16_t *x, const uint16_t *y, int n)
+{
+	int i;
+	int cutoff = n % FLOAT_PER_M256_REG;
+	float sum = 0;
+	__m256 sreg = _mm256_setzero_ps();
+	__m256 sreg1 = _mm256_setzero_ps();
+
+	for (i = 0; i < cutoff; i++) {
+		sum += half_to_float(x[i]) * half_to_float(y[i]);
+	}
+
+	for (i = cutoff; i + 2 * FLOAT_PER_M256_REG <= n; i += 2 * FLOAT_PER_M256_REG) {
+		sreg = madd_ps(load_ph_256(x + i), load_ph_256(y + i), sreg);
+		sreg1 = madd_ps(load_ph_256(x + i + 8), load_ph_256(y + i + 8), sreg1);
+	}
+
+	for (; i < n; i += FLOAT_PER_M256_REG) {
+		sreg = madd_ps(load_ph_256(x + i), load_ph_256(y + i), sreg);
+	}
+
+	return sum + _mm256_register_sum_ps(_mm256_add_ps(sreg, sreg1));
+}
+
+TARGET_AVX2
+float _mm256_hdot_indexed(const uint16_t *x, const int *xindices, const uint16_t *y, int n)
+{
+	int i;
+	int cutoff = n % FLOAT_PER_M256_REG;
+	float sum = 0;
+	__m256i vindex;
+	__m256 sreg = _mm256_setzero_ps();
+
+	for (i = 0; i < cutoff; i++) {
+		sum += half_to_float(x[xindices[i]]) * half_to_float(y[i]);
+	}
+
+	for (i = cutoff; i < n; i += FLOAT_PER_M256_REG) {
+		vindex = _mm256_loadu_si256((const __m256i *)(xindices + i));
+		sreg = madd_ps(gather_ph_256(x, vindex), load_ph_256(y + i), sreg);
+	}
+
+	return sum + _mm256_register_sum_ps(sreg);
+}
+
+TARGET_AVX2
+double _mm256_hdot_acc64(const uint16_t *x, const uint16_t *y, int n)
+{
+	int i;
+	int cutoff = n % FLOAT_PER_M256_REG;
+	double sum = 0;
+	__m256d sreg0 = _mm256_setzero_pd(), sreg1 = _mm256_setzero_pd();
+
+	for (i = 0; i < cutoff; i++) {
+		sum += (double)half_to_float(x[i]) * half_to_float(y[i]);
+	}
+
+	for (i = cutoff; i < n; i += FLOAT_PER_M256_REG) {
+		acc64_step_ps(&sreg0, &sreg1, load_ph_256(x + i), load_ph_256(y + i));
+	}
+
+	return sum + _mm256_register_sum_pd(_mm256_add_pd(sreg0, sreg1));
+}
+
+TARGET_AVX2
+double _mm256_hdot_indexed_acc64(const uint16_t *x, const int *xindices, const uint16_t *y, int n)
+{
+	int i;
+	int cutoff = n % FLOAT_PER_M256_REG;
+	double sum = 0;
+	__m256i vindex;
+	__m256d sreg0 = _mm256_setzero_pd(), sreg1 = _mm256_setzero_pd();
+
+	for (i = 0; i < cutoff; i++) {
+		sum += (double)half_to_float(x[xindices[i]]) * half_to_float(y[i]);
+	}
+
+	for (i = cutoff; i < n; i += FLOAT_PER_M256_REG) {
+		vindex = _mm256_loadu_si256((const __m256i *)(xindices + i));
+		acc64_step_ps(&sreg0, &sreg1, gather_ph_256(x, vindex), load_ph_256(y + i));
+	}
+
+	return sum + _mm256_register_sum_pd(_mm256_add_pd(sreg0, sreg1));
+}
+
+#ifdef SUPPORTS_AVX512
+TARGET_AVX512
+static inline __m512 load_ph_512(const uint16_t *x)
+{
+	return _mm512_cvtph_ps(_mm256_loadu_si256((const __m256i *)x));
+}
+
+TARGET_AVX512
+static inline __m512 gather_ph_512(const uint16_t *x, __m512i vindex)
+{
+	__m512i first = _mm512_set1_epi32((int)((uint32_t)x[0] << 16));
+	__mmask16 mask = _mm512_cmpneq_epi32_mask(vindex, _mm512_setzero_si512());
+	__m512i xreg = _mm512_mask_i32gather_epi32(first, mask, vindex, (const int *)(x - 1), 2);
+
+	return _mm512_cvtph_ps(_mm512_cvtepi32_epi16(_mm512_srli_epi32(xreg, 16)));
+}
+
+TARGET_AVX512
+void _mm512_cvt_f16_to_f32(float *y, const uint16_t *x, int n)
+{
+	int i;
+	int cutoff = n % FLOAT_PER_M512_REG;
+
+	for (i = 0; i < cutoff; i++) {
+		y[i] = half_to_float(x[i]);
+	}
+
+	for (i = cutoff; i < n; i += FLOAT_PER_M512_REG) {
+		_mm512_storeu_ps(y + i, load_ph_512(x + i));
+	}
+}
+
+TARGET_AVX512
+void _mm512_cvt_f32_to_f16(uint16_t *y, const float *x, int n)
+{
+	int i;
+	int cutoff = n % FLOAT_PER_M512_REG;
+
+	for (i = 0; i < cutoff; i++) {
+		y[i] = float_to_half(x[i]);
+	}
+
+	for (i = cutoff; i < n; i += FLOAT_PER_M512_REG) {
+		_mm256_storeu_si256((__m256i *)(y + i), _mm512_cvtps_ph(_mm512_loadu_ps(x + i), _MM_FROUND_TO_NEAREST_INT));
+	}
+}
+
+TARGET_AVX512
+float _mm512_hdot(const uint16_t *x, const uint16_t *y, int n)
+{
+	int i;
+	int cutoff = n % FLOAT_PER_M512_REG;
+	float sum = 0;
+	__m512 sreg = _mm512_setzero_ps();
+	__m512 sreg1 = _mm512_setzero_ps();
+
+	for (i = 0; i < cutoff; i++) {
+		sum += half_to_float(x[i]) * half_to_float(y[i]);
+	}
+
+	for (i = cutoff; i + 2 * FLOAT_PER_M512_REG <= n; i += 2 * FLOAT_PER_M512_REG) {
+		sreg = _mm512_fmadd_ps(load_ph_512(x + i), load_ph_512(y + i), sreg);
+		sreg1 = _mm512_fmadd_ps(load_ph_512(x + i + 16), load_ph_512(y + i + 16), sreg1);
+	}
+
+	for (; i < n; i += FLOAT_PER_M512_REG) {
+		sreg = _mm512_fmadd_ps(load_ph_512(x + i), load_ph_512(y + i), sreg);
+	}
+
+	return sum + _mm512_register_sum_ps(_mm512_add_ps(sreg, sreg1));
+}
+
+TARGET_AVX512
+float _mm512_hdot_indexed(const uint16_t *x, const int *xindices, const uint16_t *y, int n)
+{
+	int i;
+	int cutoff = n % FLOAT_PER_M512_REG;
+	float sum = 0;
+	__m512i vindex;
+	__m512 sreg = _mm512_setzero_ps();
+
+	for (i = 0; i < cutoff; i++) {
+		sum += half_to_float(x[xindices[i]]) * half_to_float(y[i]);
+	}
+
+	for (i = cutoff; i < n; i += FLOAT_PER_M512_REG) {
+		vindex = _mm512_loadu_si512(xindices + i);
+		sreg = _mm512_fmadd_ps(gather_ph_512(x, vindex), load_ph_512(y + i), sreg);
+	}
+
+	return sum + _mm512_register_sum_ps(sreg);
+}
+
+TARGET_AVX512
+double _mm512_hdot_acc64(const uint16_t *x, const uint16_t *y, int n)
+{
+	int i;
+	int cutoff = n % FLOAT_PER_M512_REG;
+	double sum = 0;
+	__m512d sreg0 = _mm512_setzero_pd(), sreg1 = _mm512_setzero_pd();
+
+	for (i = 0; i < cutoff; i++) {
+		sum += (double)half_to_float(x[i]) * half_to_float(y[i]);
+	}
+
+	for (i = cutoff; i < n; i += FLOAT_PER_M512_REG) {
+		acc64_step_ps512(&sreg0, &sreg1, load_ph_512(x + i), load_ph_512(y + i));
+	}
+
+	return sum + _mm512_register_sum_pd(_mm512_add_pd(sreg0, sreg1));
+}
+
+TARGET_AVX512
+double _mm512_hdot_indexed_acc64(const uint16_t *x, const int *xindices, const uint16_t *y, int n)
+{
+	int i;
+	int cutoff = n % FLOAT_PER_M512_REG;
+	double sum = 0;
+	__m512i vindex;
+	__m512d sreg0 = _mm512_setzero_pd(), sreg1 = _mm512_setzero_pd();
+
+	for (i = 0; i < cutoff; i++) {
+		sum += (double)half_to_float(x[xindices[i]]) * half_to_float(y[i]);
+	}
+
+	for (i = cutoff; i < n; i += FLOAT_PER_M512_REG) {
+		vindex = _mm512_loadu_si512(xindices + i);
+		acc64_step_ps512(&sreg0, &sreg1, gather_ph_512(x, vindex), load_ph_512(y + i));
+	}
+
+	return sum + _mm512_register_sum_pd(_mm512_add_pd(sreg0, sreg1));
+}
+#endif
+
+//----------------------------------------------------------------------------
+// Weighted stencils. dst[i] is the sum over k of weights[k] * src[i +
+// offsets[k]], so a column of a padded grid can be convolved with any fixed
+// neighbourhood using contiguous loads only. Four registers of rows share
+// each broadcast weight to keep independent FMA chains in flight.
+//----------------------------------------------------------------------------
+
+void _mm_stencil_ps(float *dst, const float *src, int n, const int *offsets, const float *weights, int nweights)
+{
+	int i, k;
+	int cutoff = n % FLOAT_PER_M128_REG;
+	float sum;
+	__m128 wreg;
+	__m128 sreg0, sreg1;
+
+	for (i = 0; i < cutoff; i++) {
+		sum = 0;
+
+		for (k = 0; k < nweights; k++) {
+			sum += weights[k] * src[i + offsets[k]];
+		}
+
+		dst[i] = sum;
+	}
+
+	for (i = cutoff; i + 2 * FLOAT_PER_M128_REG <= n; i += 2 * FLOAT_PER_M128_REG) {
+		sreg0 = _mm_setzero_ps();
+		sreg1 = _mm_setzero_ps();
+
+		for (k = 0; k < nweights; k++) {
+			wreg = _mm_set1_ps(weights[k]);
+			sreg0 = _mm_add_ps(sreg0, _mm_mul_ps(wreg, _mm_loadu_ps(src + i + offsets[k])));
+			sreg1 = _mm_add_ps(sreg1, _mm_mul_ps(wreg, _mm_loadu_ps(src + i + 4 + offsets[k])));
+		}
+
+		_mm_storeu_ps(dst + i, sreg0);
+		_mm_storeu_ps(dst + i + 4, sreg1);
+	}
+
+	for (; i < n; i += FLOAT_PER_M128_REG) {
+		sreg0 = _mm_setzero_ps();
+
+		for (k = 0; k < nweights; k++) {
+			sreg0 = _mm_add_ps(sreg0, _mm_mul_ps(_mm_set1_ps(weights[k]), _mm_loadu_ps(src + i + offsets[k])));
+		}
+
+		_mm_storeu_ps(dst + i, sreg0);
+	}
+}
+
+TARGET_AVX2
+void _mm256_stencil_ps(float *dst, const float *src, int n, const int *offsets, const float *weights, int nweights)
+{
+	int i, k;
+	int cutoff = n % FLOAT_PER_M256_REG;
+	const float *p;
+	__m256i mask;
+	__m256 wreg;
+	__m256 sreg0, sreg1, sreg2, sreg3;
+
+	if (cutoff > 0) {
+		mask = _mm256_set_mask_epi32(cutoff - 1);
+		sreg0 = _mm256_setzero_ps();
+
+		for (k = 0; k < nweights; k++) {
+			sreg0 = madd_ps(_mm256_set1_ps(weights[k]), _mm256_maskload_ps(src + offsets[k], mask), sreg0);
+		}
+
+		_mm256_maskstore_ps(dst, mask, sreg0);
+	}
+
+	for (i = cutoff; i + 4 * FLOAT_PER_M256_REG <= n; i += 4 * FLOAT_PER_M256_REG) {
+		sreg0 = _mm256_setzero_ps();
+		sreg1 = _mm256_setzero_ps();
+		sreg2 = _mm256_setzero_ps();
+		sreg3 = _mm256_setzero_ps();
+
+		for (k = 0; k < nweights; k++) {
+			p = src + i + offsets[k];
+			wreg = _mm256_set1_ps(weights[k]);
+			sreg0 = madd_ps(wreg, _mm256_loadu_ps(p), sreg0);
+			sreg1 = madd_ps(wreg, _mm256_loadu_ps(p + 8), sreg1);
+			sreg2 = madd_ps(wreg, _mm256_loadu_ps(p + 16), sreg2);
+			sreg3 = madd_ps(wreg, _mm256_loadu_ps(p + 24), sreg3);
+		}
+
+		_mm256_storeu_ps(dst + i, sreg0);
+		_mm256_storeu_ps(dst + i + 8, sreg1);
+		_mm256_storeu_ps(dst + i + 16, sreg2);
+		_mm256_storeu_ps(dst + i + 24, sreg3);
+	}
+
+	for (; i < n; i += FLOAT_PER_M256_REG) {
+		sreg0 = _mm256_setzero_ps();
+
+		for (k = 0; k < nweights; k++) {
+			sreg0 = madd_ps(_mm256_set1_ps(weights[k]), _mm256_loadu_ps(src + i + offsets[k]), sreg0);
+		}
+
+		_mm256_storeu_ps(dst + i, sreg0);
+	}
+}
+
+#ifdef SUPPORTS_AVX512
+TARGET_AVX512
+void _mm512_stencil_ps(float *dst, const float *src, int n, const int *offsets, const float *weights, int nweights)
+{
+	int i, k;
+	int cutoff = n % FLOAT_PER_M512_REG;
+	const float *p;
+	__mmask16 mask;
+	__m512 wreg;
+	__m512 sreg0, sreg1, sreg2, sreg3;
+
+	if (cutoff > 0) {
+		mask = _mm512_set_mask_epi32(cutoff - 1);
+		sreg0 = _mm512_setzero_ps();
+
+		for (k = 0; k < nweights; k++) {
+			sreg0 = _mm512_fmadd_ps(_mm512_set1_ps(weights[k]), _mm512_maskz_loadu_ps(mask, src + offsets[k]), sreg0);
+		}
+
+		_mm512_mask_storeu_ps(dst, mask, sreg0);
+	}
+
+	for (i = cutoff; i + 4 * FLOAT_PER_M512_REG <= n; i += 4 * FLOAT_PER_M512_REG) {
+		sreg0 = _mm512_setzero_ps();
+		sreg1 = _mm512_setzero_ps();
+		sreg2 = _mm512_setzero_ps();
+		sreg3 = _mm512_setzero_ps();
+
+		for (k = 0; k < nweights; k++) {
+			p = src + i + offsets[k];
+			wreg = _mm512_set1_ps(weights[k]);
+			sreg0 = _mm512_fmadd_ps(wreg, _mm512_loadu_ps(p), sreg0);
+			sreg1 = _mm512_fmadd_ps(wreg, _mm512_loadu_ps(p + 16), sreg1);
+			sreg2 = _mm512_fmadd_ps(wreg, _mm512_loadu_ps(p + 32), sreg2);
+			sreg3 = _mm512_fmadd_ps(wreg, _mm512_loadu_ps(p + 48), sreg3);
+		}
+
+		_mm512_storeu_ps(dst + i, sreg0);
+		_mm512_storeu_ps(dst + i + 16, sreg1);
+		_mm512_storeu_ps(dst + i + 32, sreg2);
+		_mm512_storeu_ps(dst + i + 48, sreg3);
+	}
+
+	for (; i < n; i += FLOAT_PER_M512_REG) {
+		sreg0 = _mm512_setzero_ps();
+
+		for (k = 0; k < nweights; k++) {
+			sreg0 = _mm512_fmadd_ps(_mm512_set1_ps(weights[k]), _mm512_loadu_ps(src + i + offsets[k]), sreg0);
+		}
+
+		_mm512_storeu_ps(dst + i, sreg0);
+	}
+}
+#endif
+
+//----------------------------------------------------------------------------
+// SmoothLife transition. Given the filling m of the inner disk and n of the
+// outer annulus, s(n, m) = sigma2(n, sigmam(b1, d1, m), sigmam(b2, d2, m))
+// with sigma1(x, a, alpha) = 1 / (1 + exp(-4 (x - a) / alpha)), as in
+// Rafler's paper. A dt of zero replaces f with s; otherwise f moves by
+// dt (2 s - 1) and is clamped to [0, 1]. exp is evaluated as 2^k e^r with
+// |r| <= ln(2) / 2 and a degree-6 polynomial for e^r (after Cephes' expf),
+// accurate to a couple of ulps over the clamped range.
+//----------------------------------------------------------------------------
+
+#define EXP_HI 88.3762626647949f
+#define EXP_LO -87.3365447504019f
+#define EXP_LOG2E 1.44269504088896341f
+#define EXP_LN2_HI 0.693359375f
+#define EXP_LN2_LO -2.12194440e-4f
+#define EXP_P0 1.9875691500e-4f
+#define EXP_P1 1.3981999507e-3f
+#define EXP_P2 8.3334519073e-3f
+#define EXP_P3 4.1665795894e-2f
+#define EXP_P4 1.6666665459e-1f
+#define EXP_P5 5.0000001201e-1f
+
+static inline __m128 exp_ps128(__m128 x)
+{
+	__m128 k, r, p;
+
+	x = _mm_min_ps(_mm_max_ps(x, _mm_set1_ps(EXP_LO)), _mm_set1_ps(EXP_HI));
+	k = _mm_round_ps(_mm_mul_ps(x, _mm_set1_ps(EXP_LOG2E)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+	r = _mm_sub_ps(_mm_sub_ps(x, _mm_mul_ps(k, _mm_set1_ps(EXP_LN2_HI))), _mm_mul_ps(k, _mm_set1_ps(EXP_LN2_LO)));
+
+	p = _mm_set1_ps(EXP_P0);
+	p = _mm_add_ps(_mm_mul_ps(p, r), _mm_set1_ps(EXP_P1));
+	p = _mm_add_ps(_mm_mul_ps(p, r), _mm_set1_ps(EXP_P2));
+	p = _mm_add_ps(_mm_mul_ps(p, r), _mm_set1_ps(EXP_P3));
+	p = _mm_add_ps(_mm_mul_ps(p, r), _mm_set1_ps(EXP_P4));
+	p = _mm_add_ps(_mm_mul_ps(p, r), _mm_set1_ps(EXP_P5));
+	p = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_mul_ps(p, r), r), r), _mm_set1_ps(1.0f));
+
+	return _mm_mul_ps(p, _mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(_mm_cvtps_epi32(k), _mm_set1_epi32(127)), 23)));
+}
+
+// 1 / (1 + exp(-(x - a) * scale)), with scale = 4 / alpha.
+static inline __m128 sigmoid_ps128(__m128 x, __m128 a, __m128 scale)
+{
+	__m128 e = exp_ps128(_mm_mul_ps(_mm_sub_ps(a, x), scale));
+
+	return _mm_div_ps(_mm_set1_ps(1.0f), _mm_add_ps(_mm_set1_ps(1.0f), e));
+}
+
+static inline __m128 smoothlife_ps128(__m128 f, __m128 m, __m128 n, const struct iu_smoothlife_params *p)
+{
+	__m128 one = _mm_set1_ps(1.0f);
+	__m128 sm = sigmoid_ps128(m, _mm_set1_ps(0.5f), _mm_set1_ps(4.0f / p->alpha_m));
+	__m128 t1 = _mm_add_ps(_mm_set1_ps(p->b1), _mm_mul_ps(_mm_set1_ps(p->d1 - p->b1), sm));
+	__m128 t2 = _mm_add_ps(_mm_set1_ps(p->b2), _mm_mul_ps(_mm_set1_ps(p->d2 - p->b2), sm));
+	__m128 scale = _mm_set1_ps(4.0f / p->alpha_n);
+	__m128 s = _mm_mul_ps(sigmoid_ps128(n, t1, scale), _mm_sub_ps(one, sigmoid_ps128(n, t2, scale)));
+
+	if (p->dt == 0) {
+		return s;
+	}
+
+	f = _mm_add_ps(f, _mm_mul_ps(_mm_set1_ps(p->dt), _mm_sub_ps(_mm_add_ps(s, s), one)));
+
+	return _mm_min_ps(_mm_max_ps(f, _mm_setzero_ps()), one);
+}
+
+void _mm_smoothlife_transition_ps(float *f, const float *m, const float *n, int len, const struct iu_smoothlife_params *p)
+{
+	int i, k;
+	int cutoff = len % FLOAT_PER_M128_REG;
+	float buffer[FLOAT_PER_M128_REG];
+
+	if (cutoff > 0) {
+		_mm_storeu_ps(buffer, smoothlife_ps128(load_partial_ps(f, cutoff), load_partial_ps(m, cutoff), load_partial_ps(n, cutoff), p));
+
+		for (k = 0; k < cutoff; k++) {
+			f[k] = buffer[k];
+		}
+	}
+
+	for (i = cutoff; i < len; i += FLOAT_PER_M128_REG) {
+		_mm_storeu_ps(f + i, smoothlife_ps128(_mm_loadu_ps(f + i), _mm_loadu_ps(m + i), _mm_loadu_ps(n + i), p));
+	}
+}
+
+TARGET_AVX2
+static inline __m256 exp_ps256(__m256 x)
+{
+	__m256 k, r, p;
+
+	x = _mm256_min_ps(_mm256_max_ps(x, _mm256_set1_ps(EXP_LO)), _mm256_set1_ps(EXP_HI));
+	k = _mm256_round_ps(_mm256_mul_ps(x, _mm256_set1_ps(EXP_LOG2E)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+	r = _mm256_fnmadd_ps(k, _mm256_set1_ps(EXP_LN2_HI), x);
+	r = _mm256_fnmadd_ps(k, _mm256_set1_ps(EXP_LN2_LO), r);
+
+	p = _mm256_set1_ps(EXP_P0);
+	p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(EXP_P1));
+	p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(EXP_P2));
+	p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(EXP_P3));
+	p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(EXP_P4));
+	p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(EXP_P5));
+	p = _mm256_add_ps(_mm256_fmadd_ps(_mm256_mul_ps(p, r), r, r), _mm256_set1_ps(1.0f));
+
+	return _mm256_mul_ps(p, _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_add_epi32(_mm256_cvtps_epi32(k), _mm256_set1_epi32(127)), 23)));
+}
+
+TARGET_AVX2
+static inline __m256 sigmoid_ps256(__m256 x, __m256 a, __m256 scale)
+{
+	__m256 e = exp_ps256(_mm256_mul_ps(_mm256_sub_ps(a, x), scale));
+
+	return _mm256_div_ps(_mm256_set1_ps(1.0f), _mm256_add_ps(_mm256_set1_ps(1.0f), e));
+}
+
+TARGET_AVX2
+static inline __m256 smoothlife_ps256(__m256 f, __m256 m, __m256 n, const struct iu_smoothlife_params *p)
+{
+	__m256 one = _mm256_set1_ps(1.0f);
+	__m256 sm = sigmoid_ps256(m, _mm256_set1_ps(0.5f), _mm256_set1_ps(4.0f / p->alpha_m));
+	__m256 t1 = _mm256_fmadd_ps(_mm256_set1_ps(p->d1 - p->b1), sm, _mm256_set1_ps(p->b1));
+	__m256 t2 = _mm256_fmadd_ps(_mm256_set1_ps(p->d2 - p->b2), sm, _mm256_set1_ps(p->b2));
+	__m256 scale = _mm256_set1_ps(4.0f / p->alpha_n);
+	__m256 s = _mm256_mul_ps(sigmoid_ps256(n, t1, scale), _mm256_sub_ps(one, sigmoid_ps256(n, t2, scale)));
+
+	if (p->dt == 0) {
+		return s;
+	}
+
+	f = _mm256_fmadd_ps(_mm256_set1_ps(p->dt), _mm256_sub_ps(_mm256_add_ps(s, s), one), f);
+
+	return _mm256_min_ps(_mm256_max_ps(f, _mm256_setzero_ps()), one);
+}
+
+TARGET_AVX2
+void _mm256_smoothlife_transition_ps(float *f, const float *m, const float *n, int len, const struct iu_smoothlife_params *p)
+{
+	int i;
+	int cutoff = len % FLOAT_PER_M256_REG;
+	__m256i mask;
+
+	if (cutoff > 0) {
+		mask = _mm256_set_mask_epi32(cutoff - 1);
+		_mm256_maskstore_ps(f, mask, smoothlife_ps256(_mm256_maskload_ps(f, mask), _mm256_maskload_ps(m, mask), _mm256_maskload_ps(n, mask), p));
+	}
+
+	for (i = cutoff; i < len; i += FLOAT_PER_M256_REG) {
+		_mm256_storeu_ps(f + i, smoothlife_ps256(_mm256_loadu_ps(f + i), _mm256_loadu_ps(m + i), _mm256_loadu_ps(n + i), p));
+	}
+}
+
+#ifdef SUPPORTS_AVX512
+TARGET_AVX512
+static inline __m512 exp_ps512(__m512 x)
+{
+	__m512 k, r, p;
+
+	x = _mm512_min_ps(_mm512_max_ps(x, _mm512_set1_ps(EXP_LO)), _mm512_set1_ps(EXP_HI));
+	k = _mm512_roundscale_ps(_mm512_mul_ps(x, _mm512_set1_ps(EXP_LOG2E)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+	r = _mm512_fnmadd_ps(k, _mm512_set1_ps(EXP_LN2_HI), x);
+	r = _mm512_fnmadd_ps(k, _mm512_set1_ps(EXP_LN2_LO), r);
+
+	p = _mm512_set1_ps(EXP_P0);
+	p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(EXP_P1));
+	p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(EXP_P2));
+	p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(EXP_P3));
+	p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(EXP_P4));
+	p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(EXP_P5));
+	p = _mm512_add_ps(_mm512_fmadd_ps(_mm512_mul_ps(p, r), r, r), _mm512_set1_ps(1.0f));
+
+	return _mm512_scalef_ps(p, k);
+}
+
+TARGET_AVX512
+static inline __m512 sigmoid_ps512(__m512 x, __m512 a, __m512 scale)
+{
+	__m512 e = exp_ps512(_mm512_mul_ps(_mm512_sub_ps(a, x), scale));
+
+	return _mm512_div_ps(_mm512_set1_ps(1.0f), _mm512_add_ps(_mm512_set1_ps(1.0f), e));
+}
+
+TARGET_AVX512
+static inline __m512 smoothlife_ps512(__m512 f, __m512 m, __m512 n, const struct iu_smoothlife_params *p)
+{
+	__m512 one = _mm512_set1_ps(1.0f);
+	__m512 sm = sigmoid_ps512(m, _mm512_set1_ps(0.5f), _mm512_set1_ps(4.0f / p->alpha_m));
+	__m512 t1 = _mm512_fmadd_ps(_mm512_set1_ps(p->d1 - p->b1), sm, _mm512_set1_ps(p->b1));
+	__m512 t2 = _mm512_fmadd_ps(_mm512_set1_ps(p->d2 - p->b2), sm, _mm512_set1_ps(p->b2));
+	__m512 scale = _mm512_set1_ps(4.0f / p->alpha_n);
+	__m512 s = _mm512_mul_ps(sigmoid_ps512(n, t1, scale), _mm512_sub_ps(one, sigmoid_ps512(n, t2, scale)));
+
+	if (p->dt == 0) {
+		return s;
+	}
+
+	f = _mm512_fmadd_ps(_mm512_set1_ps(p->dt), _mm512_sub_ps(_mm512_add_ps(s, s), one), f);
+
+	return _mm512_min_ps(_mm512_max_ps(f, _mm512_setzero_ps()), one);
+}
+
+TARGET_AVX512
+void _mm512_smoothlife_transition_ps(float *f, const float *m, const float *n, int len, const struct iu_smoothlife_params *p)
+{
+	int i;
+	int cutoff = len % FLOAT_PER_M512_REG;
+	__mmask16 mask;
+
+	if (cutoff > 0) {
+		mask = _mm512_set_mask_epi32(cutoff - 1);
+		_mm512_mask_storeu_ps(f, mask, smoothlife_ps512(_mm512_maskz_loadu_ps(mask, f), _mm512_maskz_loadu_ps(mask, m), _mm512_maskz_loadu_ps(mask, n), p));
+	}
+
+	for (i = cutoff; i < len; i += FLOAT_PER_M512_REG) {
+		_mm512_storeu_ps(f + i, smoothlife_ps512(_mm512_loadu_ps(f + i), _mm512_loadu_ps(m + i), _mm512_loadu_ps(n + i), p));
+	}
+}
+#endif
+
+//----------------------------------------------------------------------------
+// FFT kernels on interleaved complex floats (re, im pairs). A Stockham stage
+// of radix p reads p runs of run complex values from x, spaced m runs apart,
+// and writes their length-p DFTs, each output k multiplied by the twiddle
+// for (jj, k), to consecutive runs of y:
+//
+//   y[p jj + k] = w[jj][k - 1] * sum over r of roots[r k mod p] * x[jj + r m]
+//
+// for every jj < m, where roots holds the p-th roots of unity in the
+// direction of the transform. Within a run the twiddle is constant, so runs
+// map straight onto registers; radix 2 and 4 have dedicated butterflies and
+// other radices sum the terms directly. Tails shorter than a register are
+// left to a scalar butterfly. The complex multiply pairs fmaddsub with the
+// real and imaginary parts duplicated across each lane pair.
+//----------------------------------------------------------------------------
+
+static void fft_butterfly_scalar(float *y, const float *x, int from, int run, int jj, int m, int p, const float *twiddles, const float *roots)
+{
+	int e, k, r, t;
+	size_t stride = (size_t)2 * run;
+	const float *src = x + stride * jj;
+	const float *w = twiddles + (size_t)2 * (p - 1) * jj;
+	float *dst = y + stride * p * jj;
+	float re, im, ar, ai, wr, wi;
+
+	for (t = from; t < run; t++) {
+		for (k = 0; k < p; k++) {
+			re = 0;
+			im = 0;
+
+			for (r = 0; r < p; r++) {
+				e = r * k % p;
+				ar = src[stride * r * m + 2 * t];
+				ai = src[stride * r * m + 2 * t + 1];
+				re += ar * roots[2 * e] - ai * roots[2 * e + 1];
+				im += ar * roots[2 * e + 1] + ai * roots[2 * e];
+			}
+
+			if (k > 0) {
+				wr = w[2 * (k - 1)];
+				wi = w[2 * (k - 1) + 1];
+				ar = re * wr - im * wi;
+				im = re * wi + im * wr;
+				re = ar;
+			}
+
+			dst[stride * k + 2 * t] = re;
+			dst[stride * k + 2 * t + 1] = im;
+		}
+	}
+}
+
+static inline __m128 cmul_ps128(__m128 a, __m128 bre, __m128 bim)
+{
+	return _mm_addsub_ps(_mm_mul_ps(a, bre), _mm_mul_ps(_mm_shuffle_ps(a, a, 0xb1), bim));
+}
+
+void _mm_fft_stage_ps(float *y, const float *x, int run, int m, int p, const float *twiddles, const float *roots)
+{
+	int e, jj, k, r, t;
+	int vrun = run - run % COMPLEX_PER_M128_REG;
+	size_t stride = (size_t)2 * run;
+	size_t gap = stride * m;
+	const float *src, *w;
+	float *dst;
+	__m128 a0, a1, a2, a3, s02, d02, s13, d13;
+	__m128 rot = _mm_setr_ps(-roots[3], roots[3], -roots[3], roots[3]);
+
+	for (jj = 0; jj < m; jj++) {
+		src = x + stride * jj;
+		dst = y + stride * p * jj;
+		w = twiddles + (size_t)2 * (p - 1) * jj;
+
+		switch (p) {
+		case 2:
+			for (t = 0; t < 2 * vrun; t += FLOAT_PER_M128_REG) {
+				a0 = _mm_loadu_ps(src + t);
+				a1 = _mm_loadu_ps(src + gap + t);
+				_mm_storeu_ps(dst + t, _mm_add_ps(a0, a1));
+				_mm_storeu_ps(dst + stride + t, cmul_ps128(_mm_sub_ps(a0, a1), _mm_set1_ps(w[0]), _mm_set1_ps(w[1])));
+			}
+			break;
+		case 4:
+			for (t = 0; t < 2 * vrun; t += FLOAT_PER_M128_REG) {
+				a0 = _mm_loadu_ps(src + t);
+				a1 = _mm_loadu_ps(src + gap + t);
+				a2 = _mm_loadu_ps(src + 2 * gap + t);
+				a3 = _mm_loadu_ps(src + 3 * gap + t);
+				s02 = _mm_add_ps(a0, a2);
+				d02 = _mm_sub_ps(a0, a2);
+				s13 = _mm_add_ps(a1, a3);
+				d13 = _mm_sub_ps(a1, a3);
+				d13 = _mm_mul_ps(_mm_shuffle_ps(d13, d13, 0xb1), rot);
+				_mm_storeu_ps(dst + t, _mm_add_ps(s02, s13));
+				_mm_storeu_ps(dst + stride + t, cmul_ps128(_mm_add_ps(d02, d13), _mm_set1_ps(w[0]), _mm_set1_ps(w[1])));
+				_mm_storeu_ps(dst + 2 * stride + t, cmul_ps128(_mm_sub_ps(s02, s13), _mm_set1_ps(w[2]), _mm_set1_ps(w[3])));
+				_mm_storeu_ps(dst + 3 * stride + t, cmul_ps128(_mm_sub_ps(d02, d13), _mm_set1_ps(w[4]), _mm_set1_ps(w[5])));
+			}
+			break;
+		default:
+			for (t = 0; t < 2 * vrun; t += FLOAT_PER_M128_REG) {
+				for (k = 0; k < p; k++) {
+					a0 = _mm_loadu_ps(src + t);
+
+					for (r = 1; r < p; r++) {
+						e = r * k % p;
+						a0 = _mm_add_ps(a0, cmul_ps128(_mm_loadu_ps(src + r * gap + t), _mm_set1_ps(roots[2 * e]), _mm_set1_ps(roots[2 * e + 1])));
+					}
+
+					if (k > 0) {
+						a0 = cmul_ps128(a0, _mm_set1_ps(w[2 * (k - 1)]), _mm_set1_ps(w[2 * (k - 1) + 1]));
+					}
+
+					_mm_storeu_ps(dst + k * stride + t, a0);
+				}
+			}
+			break;
+		}
+
+		if (vrun < run) {
+			fft_butterfly_scalar(y, x, vrun, run, jj, m, p, twiddles, roots);
+		}
+	}
+}
+
+void _mm_cmul_ps(float *dst, const float *x, const float *y, int n)
+{
+	int i;
+	int cutoff = n % COMPLEX_PER_M128_REG;
+	float re;
+	__m128 yreg;
+
+	if (cutoff > 0) {
+		re = x[0] * y[0] - x[1] * y[1];
+		dst[1] = x[0] * y[1] + x[1] * y[0];
+		dst[0] = re;
+	}
+
+	for (i = 2 * cutoff; i < 2 * n; i += FLOAT_PER_M128_REG) {
+		yreg = _mm_loadu_ps(y + i);
+		_mm_storeu_ps(dst + i, cmul_ps128(_mm_loadu_ps(x + i), _mm_moveldup_ps(yreg), _mm_movehdup_ps(yreg)));
+	}
+}
+
+TARGET_AVX2
+static inline __m256 cmul_ps256(__m256 a, __m256 bre, __m256 bim)
+{
+	return _mm256_fmaddsub_ps(a, bre, _mm256_mul_ps(_mm256_permute_ps(a, 0xb1), bim));
+}
+
+TARGET_AVX2
+void _mm256_fft_stage_ps(float *y, const float *x, int run, int m, int p, const float *twiddles, const float *roots)
+{
+	int e, jj, k, r, t;
+	int vrun = run - run % COMPLEX_PER_M256_REG;
+	size_t stride = (size_t)2 * run;
+	size_t gap = stride * m;
+	const float *src, *w;
+	float *dst;
+	__m256 a0, a1, a2, a3, s02, d02, s13, d13;
+	__m256 rot = _mm256_setr_ps(-roots[3], roots[3], -roots[3], roots[3], -roots[3], roots[3], -roots[3], roots[3]);
+
+	for (jj = 0; jj < m; jj++) {
+		src = x + stride * jj;
+		dst = y + stride * p * jj;
+		w = twiddles + (size_t)2 * (p - 1) * jj;
+
+		switch (p) {
+		case 2:
+			for (t = 0; t < 2 * vrun; t += FLOAT_PER_M256_REG) {
+				a0 = _mm256_loadu_ps(src + t);
+				a1 = _mm256_loadu_ps(src + gap + t);
+				_mm256_storeu_ps(dst + t, _mm256_add_ps(a0, a1));
+				_mm256_storeu_ps(dst + stride + t, cmul_ps256(_mm256_sub_ps(a0, a1), _mm256_set1_ps(w[0]), _mm256_set1_ps(w[1])));
+			}
+			break;
+		case 4:
+			for (t = 0; t < 2 * vrun; t += FLOAT_PER_M256_REG) {
+				a0 = _mm256_loadu_ps(src + t);
+				a1 = _mm256_loadu_ps(src + gap + t);
+				a2 = _mm256_loadu_ps(src + 2 * gap + t);
+				a3 = _mm256_loadu_ps(src + 3 * gap + t);
+				s02 = _mm256_add_ps(a0, a2);
+				d02 = _mm256_sub_ps(a0, a2);
+				s13 = _mm256_add_ps(a1, a3);
+				d13 = _mm256_mul_ps(_mm256_permute_ps(_mm256_sub_ps(a1, a3), 0xb1), rot);
+				_mm256_storeu_ps(dst + t, _mm256_add_ps(s02, s13));
+				_mm256_storeu_ps(dst + stride + t, cmul_ps256(_mm256_add_ps(d02, d13), _mm256_set1_ps(w[0]), _mm256_set1_ps(w[1])));
+				_mm256_storeu_ps(dst + 2 * stride + t, cmul_ps256(_mm256_sub_ps(s02, s13), _mm256_set1_ps(w[2]), _mm256_set1_ps(w[3])));
+				_mm256_storeu_ps(dst + 3 * stride + t, cmul_ps256(_mm256_sub_ps(d02, d13), _mm256_set1_ps(w[4]), _mm256_set1_ps(w[5])));
+			}
+			break;
+		default:
+			for (t = 0; t < 2 * vrun; t += FLOAT_PER_M256_REG) {
+				for (k = 0; k < p; k++) {
+					a0 = _mm256_loadu_ps(src + t);
+
+					for (r = 1; r < p; r++) {
+						e = r * k % p;
+						a0 = _mm256_add_ps(a0, cmul_ps256(_mm256_loadu_ps(src + r * gap + t), _mm256_set1_ps(roots[2 * e]), _mm256_set1_ps(roots[2 * e + 1])));
+					}
+
+					if (k > 0) {
+						a0 = cmul_ps256(a0, _mm256_set1_ps(w[2 * (k - 1)]), _mm256_set1_ps(w[2 * (k - 1) + 1]));
+					}
+
+					_mm256_storeu_ps(dst + k * stride + t, a0);
+				}
+			}
+			break;
+		}
+
+		if (vrun < run) {
+			fft_butterfly_scalar(y, x, vrun, run, jj, m, p, twiddles, roots);
+		}
+	}
+}
+
+TARGET_AVX2
+void _mm256_cmul_ps(float *dst, const float *x, const float *y, int n)
+{
+	int i;
+	int cutoff = n % COMPLEX_PER_M256_REG;
+	__m256i mask;
+	__m256 yreg;
+
+	if (cutoff > 0) {
+		mask = _mm256_set_mask_epi32(2 * cutoff - 1);
+		yreg = _mm256_maskload_ps(y, mask);
+		_mm256_maskstore_ps(dst, mask, cmul_ps256(_mm256_maskload_ps(x, mask), _mm256_moveldup_ps(yreg), _mm256_movehdup_ps(yreg)));
+	}
+
+	for (i = 2 * cutoff; i < 2 * n; i += FLOAT_PER_M256_REG) {
+		yreg = _mm256_loadu_ps(y + i);
+		_mm256_storeu_ps(dst + i, cmul_ps256(_mm256_loadu_ps(x + i), _mm256_moveldup_ps(yreg), _mm256_movehdup_ps(yreg)));
+	}
+}
+
+#ifdef SUPPORTS_AVX512
+TARGET_AVX512
+static inline __m512 cmul_ps512(__m512 a, __m512 bre, __m512 bim)
+{
+	return _mm512_fmaddsub_ps(a, bre, _mm512_mul_ps(_mm512_permute_ps(a, 0xb1), bim));
+}
+
+TARGET_AVX512
+void _mm512_fft_stage_ps(float *y, const float *x, int run, int m, int p, const float *twiddles, const float *roots)
+{
+	int e, jj, k, r, t;
+	int vrun = run - run % COMPLEX_PER_M512_REG;
+	size_t stride = (size_t)2 * run;
+	size_t gap = stride * m;
+	const float *src, *w;
+	float *dst;
+	__m512 a0, a1, a2, a3, s02, d02, s13, d13;
+	__m512 rot = _mm512_mask_mov_ps(_mm512_set1_ps(-roots[3]), 0xaaaa, _mm512_set1_ps(roots[3]));
+
+	for (jj = 0; jj < m; jj++) {
+		src = x + stride * jj;
+		dst = y + stride * p * jj;
+		w = twiddles + (size_t)2 * (p - 1) * jj;
+
+		switch (p) {
+		case 2:
+			for (t = 0; t < 2 * vrun; t += FLOAT_PER_M512_REG) {
+				a0 = _mm512_loadu_ps(src + t);
+				a1 = _mm512_loadu_ps(src + gap + t);
+				_mm512_storeu_ps(dst + t, _mm512_add_ps(a0, a1));
+				_mm512_storeu_ps(dst + stride + t, cmul_ps512(_mm512_sub_ps(a0, a1), _mm512_set1_ps(w[0]), _mm512_set1_ps(w[1])));
+			}
+			break;
+		case 4:
+			for (t = 0; t < 2 * vrun; t += FLOAT_PER_M512_REG) {
+				a0 = _mm512_loadu_ps(src + t);
+				a1 = _mm512_loadu_ps(src + gap + t);
+				a2 = _mm512_loadu_ps(src + 2 * gap + t);
+				a3 = _mm512_loadu_ps(src + 3 * gap + t);
+				s02 = _mm512_add_ps(a0, a2);
+				d02 = _mm512_sub_ps(a0, a2);
+				s13 = _mm512_add_ps(a1, a3);
+				d13 = _mm512_mul_ps(_mm512_permute_ps(_mm512_sub_ps(a1, a3), 0xb1), rot);
+				_mm512_storeu_ps(dst + t, _mm512_add_ps(s02, s13));
+				_mm512_storeu_ps(dst + stride + t, cmul_ps512(_mm512_add_ps(d02, d13), _mm512_set1_ps(w[0]), _mm512_set1_ps(w[1])));
+				_mm512_storeu_ps(dst + 2 * stride + t, cmul_ps512(_mm512_sub_ps(s02, s13), _mm512_set1_ps(w[2]), _mm512_set1_ps(w[3])));
+				_mm512_storeu_ps(dst + 3 * stride + t, cmul_ps512(_mm512_sub_ps(d02, d13), _mm512_set1_ps(w[4]), _mm512_set1_ps(w[5])));
+			}
+			break;
+		default:
+			for (t = 0; t < 2 * vrun; t += FLOAT_PER_M512_REG) {
+				for (k = 0; k < p; k++) {
+					a0 = _mm512_loadu_ps(src + t);
+
+					for (r = 1; r < p; r++) {
+						e = r * k % p;
+						a0 = _mm512_add_ps(a0, cmul_ps512(_mm512_loadu_ps(src + r * gap + t), _mm512_set1_ps(roots[2 * e]), _mm512_set1_ps(roots[2 * e + 1])));
+					}
+
+					if (k > 0) {
+						a0 = cmul_ps512(a0, _mm512_set1_ps(w[2 * (k - 1)]), _mm512_set1_ps(w[2 * (k - 1) + 1]));
+					}
+
+					_mm512_storeu_ps(dst + k * stride + t, a0);
+				}
+			}
+			break;
+		}
+
+		if (vrun < run) {
+			fft_butterfly_scalar(y, x, vrun, run, jj, m, p, twiddles, roots);
+		}
+	}
+}
+
+TARGET_AVX512
+void _mm512_cmul_ps(float *dst, const float *x, const float *y, int n)
+{
+	int i;
+	int cutoff = n % COMPLEX_PER_M512_REG;
+	__mmask16 mask;
+	__m512 yreg;
+
+	if (cutoff > 0) {
+		mask = _mm512_set_mask_epi32(2 * cutoff - 1);
+		yreg = _mm512_maskz_loadu_ps(mask, y);
+		_mm512_mask_storeu_ps(dst, mask, cmul_ps512(_mm512_maskz_loadu_ps(mask, x), _mm512_moveldup_ps(yreg), _mm512_movehdup_ps(yreg)));
+	}
+
+	for (i = 2 * cutoff; i < 2 * n; i += FLOAT_PER_M512_REG) {
+		yreg = _mm512_loadu_ps(y + i);
+		_mm512_storeu_ps(dst + i, cmul_ps512(_mm512_loadu_ps(x + i), _mm512_moveldup_ps(yreg), _mm512_movehdup_ps(yreg)));
+	}
+}
+#endif
+
+//----------------------------------------------------------------------------
+// Summed-area tables. x holds nlines lines of len contiguous elements, ldx
+// apart; the table holds nlines + 1 lines of len + 1 elements, ld apart,
+// with table[l ld + t] the sum of x over lines below l and positions below
+// t, so its first line and first column are zero. Each line is prefix-summed
+// in registers (shifted adds within the register, then the running total of
+// the line carried across registers as a broadcast) and added to the line
+// before. The box kernels read the four corners of a box for a register of
+// consecutive cells at once:
+//
+//   dst[t] = hi[t + width] - hi[t] - lo[t + width] + lo[t]
+//          + count (full[t + width] - full[t])
+//
+// where lo and hi are table lines and full, if not NULL, is a line counted
+// count times, as for boxes wrapping around a periodic grid (see sat.h).
+// With accumulate set the result is added to dst.
+//----------------------------------------------------------------------------
+
+static inline __m128 prefix_ps128(__m128 x)
+{
+	x = _mm_add_ps(x, _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(x), 4)));
+
+	return _mm_add_ps(x, _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(x), 8)));
+}
+
+static inline __m128d prefix_pd128(__m128d x)
+{
+	return _mm_add_pd(x, _mm_castsi128_pd(_mm_slli_si128(_mm_castpd_si128(x), 8)));
+}
+
+void _mm_sat_build_ps(float *table, int ld, const float *x, int ldx, int len, int nlines)
+{
+	int i, l;
+	int cutoff = len % FLOAT_PER_M128_REG;
+	const float *src;
+	const float *prev;
+	float *dst;
+	float sum;
+	__m128 xreg, carry;
+
+	for (i = 0; i <= len; i++) {
+		table[i] = 0;
+	}
+
+	for (l = 0; l < nlines; l++) {
+		src = x + (size_t)l * ldx;
+		prev = table + (size_t)l * ld + 1;
+		dst = table + (size_t)(l + 1) * ld + 1;
+		dst[-1] = 0;
+		sum = 0;
+
+		for (i = 0; i < cutoff; i++) {
+			sum += src[i];
+			dst[i] = prev[i] + sum;
+		}
+
+		carry = _mm_set1_ps(sum);
+
+		for (i = cutoff; i < len; i += FLOAT_PER_M128_REG) {
+			xreg = _mm_add_ps(prefix_ps128(_mm_loadu_ps(src + i)), carry);
+			_mm_storeu_ps(dst + i, _mm_add_ps(xreg, _mm_loadu_ps(prev + i)));
+			carry = _mm_shuffle_ps(xreg, xreg, 0xff);
+		}
+	}
+}
+
+void _mm_sat_build_pd(double *table, int ld, const double *x, int ldx, int len, int nlines)
+{
+	int i, l;
+	int cutoff = len % DOUBLE_PER_M128_REG;
+	const double *src;
+	const double *prev;
+	double *dst;
+	double sum;
+	__m128d xreg, carry;
+
+	for (i = 0; i <= len; i++) {
+		table[i] = 0;
+	}
+
+	for (l = 0; l < nlines; l++) {
+		src = x + (size_t)l * ldx;
+		prev = table + (size_t)l * ld + 1;
+		dst = table + (size_t)(l + 1) * ld + 1;
+		dst[-1] = 0;
+		sum = 0;
+
+		for (i = 0; i < cutoff; i++) {
+			sum += src[i];
+			dst[i] = prev[i] + sum;
+		}
+
+		carry = _mm_set1_pd(sum);
+
+		for (i = cutoff; i < len; i += DOUBLE_PER_M128_REG) {
+			xreg = _mm_add_pd(prefix_pd128(_mm_loadu_pd(src + i)), carry);
+			_mm_storeu_pd(dst + i, _mm_add_pd(xreg, _mm_loadu_pd(prev + i)));
+			carry = _mm_unpackhi_pd(xreg, xreg);
+		}
+	}
+}
+
+void _mm_sat_box_ps(float *dst, const float *lo, const float *hi, const float *full, float count, int len, int width, int accumulate)
+{
+	int i;
+	int cutoff = len % FLOAT_PER_M128_REG;
+	float sum;
+	__m128 sreg;
+
+	for (i = 0; i < cutoff; i++) {
+		sum = hi[i + width] - hi[i] - (lo[i + width] - lo[i]);
+
+		if (full != NULL) {
+			sum += count * (full[i + width] - full[i]);
+		}
+
+		dst[i] = accumulate ? dst[i] + sum : sum;
+	}
+
+	for (i = cutoff; i < len; i += FLOAT_PER_M128_REG) {
+		sreg = _mm_sub_ps(_mm_sub_ps(_mm_loadu_ps(hi + i + width), _mm_loadu_ps(hi + i)), _mm_sub_ps(_mm_loadu_ps(lo + i + width), _mm_loadu_ps(lo + i)));
+
+		if (full != NULL) {
+			sreg = _mm_add_ps(sreg, _mm_mul_ps(_mm_set1_ps(count), _mm_sub_ps(_mm_loadu_ps(full + i + width), _mm_loadu_ps(full + i))));
+		}
+
+		if (accumulate) {
+			sreg = _mm_add_ps(sreg, _mm_loadu_ps(dst + i));
+		}
+
+		_mm_storeu_ps(dst + i, sreg);
+	}
+}
+
+void _mm_sat_box_pd(double *dst, const double *lo, const double *hi, const double *full, double count, int len, int width, int accumulate)
+{
+	int i;
+	int cutoff = len % DOUBLE_PER_M128_REG;
+	double sum;
+	__m128d sreg;
+
+	for (i = 0; i < cutoff; i++) {
+		sum = hi[i + width] - hi[i] - (lo[i + width] - lo[i]);
+
+		if (full != NULL) {
+			sum += count * (full[i + width] - full[i]);
+		}
+
+		dst[i] = accumulate ? dst[i] + sum : sum;
+	}
+
+	for (i = cutoff; i < len; i += DOUBLE_PER_M128_REG) {
+		sreg = _mm_sub_pd(_mm_sub_pd(_mm_loadu_pd(hi + i + width), _mm_loadu_pd(hi + i)), _mm_sub_pd(_mm_loadu_pd(lo + i + width), _mm_loadu_pd(lo + i)));
+
+		if (full != NULL) {
+			sreg = _mm_add_pd(sreg, _mm_mul_pd(_mm_set1_pd(count), _mm_sub_pd(_mm_loadu_pd(full + i + width), _mm_loadu_pd(full + i))));
+		}
+
+		if (accumulate) {
+			sreg = _mm_add_pd(sreg, _mm_loadu_pd(dst + i));
+		}
+
+		_mm_storeu_pd(dst + i, sreg);
+	}
+}
+
+// Within each 128-bit lane, then the low lane's total into the high lane.
+TARGET_AVX2
+static inline __m256 prefix_ps256(__m256 x)
+{
+	__m256 t;
+
+	x = _mm256_add_ps(x, _mm256_castsi256_ps(_mm256_slli_si256(_mm256_castps_si256(x), 4)));
+	x = _mm256_add_ps(x, _mm256_castsi256_ps(_mm256_slli_si256(_mm256_castps_si256(x), 8)));
+	t = _mm256_permute_ps(x, 0xff);
+
+	return _mm256_add_ps(x, _mm256_permute2f128_ps(t, t, 0x08));
+}
+
+TARGET_AVX2
+static inline __m256d prefix_pd256(__m256d x)
+{
+	__m256d t;
+
+	x = _mm256_add_pd(x, _mm256_castsi256_pd(_mm256_slli_si256(_mm256_castpd_si256(x), 8)));
+	t = _mm256_permute_pd(x, 0xf);
+
+	return _mm256_add_pd(x, _mm256_permute2f128_pd(t, t, 0x08));
+}
+
+TARGET_AVX2
+void _mm256_sat_build_ps(float *table, int ld, const float *x, int ldx, int len, int nlines)
+{
+	int i, l;
+	int cutoff = len % FLOAT_PER_M256_REG;
+	const float *src;
+	const float *prev;
+	float *dst;
+	__m256i mask = _mm256_set_mask_epi32(cutoff - 1);
+	__m256i last = _mm256_set1_epi32(FLOAT_PER_M256_REG - 1);
+	__m256 xreg, carry;
+
+	for (i = 0; i <= len; i++) {
+		table[i] = 0;
+	}
+
+	for (l = 0; l < nlines; l++) {
+		src = x + (size_t)l * ldx;
+		prev = table + (size_t)l * ld + 1;
+		dst = table + (size_t)(l + 1) * ld + 1;
+		dst[-1] = 0;
+		carry = _mm256_setzero_ps();
+
+		if (cutoff > 0) {
+			xreg = prefix_ps256(_mm256_maskload_ps(src, mask));
+			_mm256_maskstore_ps(dst, mask, _mm256_add_ps(xreg, _mm256_maskload_ps(prev, mask)));
+			carry = _mm256_permutevar8x32_ps(xreg, last);
+		}
+
+		for (i = cutoff; i < len; i += FLOAT_PER_M256_REG) {
+			xreg = _mm256_add_ps(prefix_ps256(_mm256_loadu_ps(src + i)), carry);
+			_mm256_storeu_ps(dst + i, _mm256_add_ps(xreg, _mm256_loadu_ps(prev + i)));
+			carry = _mm256_permutevar8x32_ps(xreg, last);
+		}
+	}
+}
+
+TARGET_AVX2
+void _mm256_sat_build_pd(double *table, int ld, const double *x, int ldx, int len, int nlines)
+{
+	int i, l;
+	int cutoff = len % DOUBLE_PER_M256_REG;
+	const double *src;
+	const double *prev;
+	double *dst;
+	__m256i mask = _mm256_set_mask_epi64(cutoff - 1);
+	__m256d xreg, carry;
+
+	for (i = 0; i <= len; i++) {
+		table[i] = 0;
+	}
+
+	for (l = 0; l < nlines; l++) {
+		src = x + (size_t)l * ldx;
+		prev = table + (size_t)l * ld + 1;
+		dst = table + (size_t)(l + 1) * ld + 1;
+		dst[-1] = 0;
+		carry = _mm256_setzero_pd();
+
+		if (cutoff > 0) {
+			xreg = prefix_pd256(_mm256_maskload_pd(src, mask));
+			_mm256_maskstore_pd(dst, mask, _mm256_add_pd(xreg, _mm256_maskload_pd(prev, mask)));
+			carry = _mm256_permute4x64_pd(xreg, 0xff);
+		}
+
+		for (i = cutoff; i < len; i += DOUBLE_PER_M256_REG) {
+			xreg = _mm256_add_pd(prefix_pd256(_mm256_loadu_pd(src + i)), carry);
+			_mm256_storeu_pd(dst + i, _mm256_add_pd(xreg, _mm256_loadu_pd(prev + i)));
+			carry = _mm256_permute4x64_pd(xreg, 0xff);
+		}
+	}
+}
+
+TARGET_AVX2
+void _mm256_sat_box_ps(float *dst, const float *lo, const float *hi, const float *full, float count, int len, int width, int accumulate)
+{
+	int i;
+	int cutoff = len % FLOAT_PER_M256_REG;
+	__m256i mask;
+	__m256 sreg;
+	__m256 creg = _mm256_set1_ps(count);
+
+	if (cutoff > 0) {
+		mask = _mm256_set_mask_epi32(cutoff - 1);
+		sreg = _mm256_sub_ps(_mm256_sub_ps(_mm256_maskload_ps(hi + width, mask), _mm256_maskload_ps(hi, mask)), _mm256_sub_ps(_mm256_maskload_ps(lo + width, mask), _mm256_maskload_ps(lo, mask)));
+
+		if (full != NULL) {
+			sreg = madd_ps(creg, _mm256_sub_ps(_mm256_maskload_ps(full + width, mask), _mm256_maskload_ps(full, mask)), sreg);
+		}
+
+		if (accumulate) {
+			sreg = _mm256_add_ps(sreg, _mm256_maskload_ps(dst, mask));
+		}
+
+		_mm256_maskstore_ps(dst, mask, sreg);
+	}
+
+	for (i = cutoff; i < len; i += FLOAT_PER_M256_REG) {
+		sreg = _mm256_sub_ps(_mm256_sub_ps(_mm256_loadu_ps(hi + i + width), _mm256_loadu_ps(hi + i)), _mm256_sub_ps(_mm256_loadu_ps(lo + i + width), _mm256_loadu_ps(lo + i)));
+
+		if (full != NULL) {
+			sreg = madd_ps(creg, _mm256_sub_ps(_mm256_loadu_ps(full + i + width), _mm256_loadu_ps(full + i)), sreg);
+		}
+
+		if (accumulate) {
+			sreg = _mm256_add_ps(sreg, _mm256_loadu_ps(dst + i));
+		}
+
+		_mm256_storeu_ps(dst + i, sreg);
+	}
+}
+
+TARGET_AVX2
+void _mm256_sat_box_pd(double *dst, const double *lo, const double *hi, const double *full, double count, int len, int width, int accumulate)
+{
+	int i;
+	int cutoff = len % DOUBLE_PER_M256_REG;
+	__m256i mask;
+	__m256d sreg;
+	__m256d creg = _mm256_set1_pd(count);
+
+	if (cutoff > 0) {
+		mask = _mm256_set_mask_epi64(cutoff - 1);
+		sreg = _mm256_sub_pd(_mm256_sub_pd(_mm256_maskload_pd(hi + width, mask), _mm256_maskload_pd(hi, mask)), _mm256_sub_pd(_mm256_maskload_pd(lo + width, mask), _mm256_maskload_pd(lo, mask)));
+
+		if (full != NULL) {
+			sreg = madd_pd(creg, _mm256_sub_pd(_mm256_maskload_pd(full + width, mask), _mm256_maskload_pd(full, mask)), sreg);
+		}
+
+		if (accumulate) {
+			sreg = _mm256_add_pd(sreg, _mm256_maskload_pd(dst, mask));
+		}
+
+		_mm256_maskstore_pd(dst, mask, sreg);
+	}
+
+	for (i = cutoff; i < len; i += DOUBLE_PER_M256_REG) {
+		sreg = _mm256_sub_pd(_mm256_sub_pd(_mm256_loadu_pd(hi + i + width), _mm256_loadu_pd(hi + i)), _mm256_sub_pd(_mm256_loadu_pd(lo + i + width), _mm256_loadu_pd(lo + i)));
+
+		if (full != NULL) {
+			sreg = madd_pd(creg, _mm256_sub_pd(_mm256_loadu_pd(full + i + width), _mm256_loadu_pd(full + i)), sreg);
+		}
+
+		if (accumulate) {
+			sreg = _mm256_add_pd(sreg, _mm256_loadu_pd(dst + i));
+		}
+
+		_mm256_storeu_pd(dst + i, sreg);
+	}
+}
+
+#ifdef SUPPORTS_AVX512
+// Shifted adds across the whole register, shifting in zeros with alignr.
+TARGET_AVX512
+static inline __m512 prefix_ps512(__m512 x)
+{
+	__m512i zero = _mm512_setzero_si512();
+
+	x = _mm512_add_ps(x, _mm512_castsi512_ps(_mm512_alignr_epi32(_mm512_castps_si512(x), zero, 15)));
+	x = _mm512_add_ps(x, _mm512_castsi512_ps(_mm512_alignr_epi32(_mm512_castps_si512(x), zero, 14)));
+	x = _mm512_add_ps(x, _mm512_castsi512_ps(_mm512_alignr_epi32(_mm512_castps_si512(x), zero, 12)));
+
+	return _mm512_add_ps(x, _mm512_castsi512_ps(_mm512_alignr_epi32(_mm512_castps_si512(x), zero, 8)));
+}
+
+TARGET_AVX512
+static inline __m512d prefix_pd512(__m512d x)
+{
+	__m512i zero = _mm512_setzero_si512();
+
+	x = _mm512_add_pd(x, _mm512_castsi512_pd(_mm512_alignr_epi64(_mm512_castpd_si512(x), zero, 7)));
+	x = _mm512_add_pd(x, _mm512_castsi512_pd(_mm512_alignr_epi64(_mm512_castpd_si512(x), zero, 6)));
+
+	return _mm512_add_pd(x, _mm512_castsi512_pd(_mm512_alignr_epi64(_mm512_castpd_si512(x), zero, 4)));
+}
+
+TARGET_AVX512
+void _mm512_sat_build_ps(float *table, int ld, const float *x, int ldx, int len, int nlines)
+{
+	int i, l;
+	int cutoff = len % FLOAT_PER_M512_REG;
+	const float *src;
+	const float *prev;
+	float *dst;
+	__mmask16 mask = _mm512_set_mask_epi32(cutoff - 1);
+	__m512i last = _mm512_set1_epi32(FLOAT_PER_M512_REG - 1);
+	__m512 xreg, carry;
+
+	for (i = 0; i <= len; i++) {
+		table[i] = 0;
+	}
+
+	for (l = 0; l < nlines; l++) {
+		src = x + (size_t)l * ldx;
+		prev = table + (size_t)l * ld + 1;
+		dst = table + (size_t)(l + 1) * ld + 1;
+		dst[-1] = 0;
+		carry = _mm512_setzero_ps();
+
+		if (cutoff > 0) {
+			xreg = prefix_ps512(_mm512_maskz_loadu_ps(mask, src));
+			_mm512_mask_storeu_ps(dst, mask, _mm512_add_ps(xreg, _mm512_maskz_loadu_ps(mask, prev)));
+			carry = _mm512_permutexvar_ps(last, xreg);
+		}
+
+		for (i = cutoff; i < len; i += FLOAT_PER_M512_REG) {
+			xreg = _mm512_add_ps(prefix_ps512(_mm512_loadu_ps(src + i)), carry);
+			_mm512_storeu_ps(dst + i, _mm512_add_ps(xreg, _mm512_loadu_ps(prev + i)));
+			carry = _mm512_permutexvar_ps(last, xreg);
+		}
+	}
+}
+
+TARGET_AVX512
+void _mm512_sat_build_pd(double *table, int ld, const double *x, int ldx, int len, int nlines)
+{
+	int i, l;
+	int cutoff = len % DOUBLE_PER_M512_REG;
+	const double *src;
+	const double *prev;
+	double *dst;
+	__mmask8 mask = _mm512_set_mask_epi64(cutoff - 1);
+	__m512i last = _mm512_set1_epi64(DOUBLE_PER_M512_REG - 1);
+	__m512d xreg, carry;
+
+	for (i = 0; i <= len; i++) {
+		table[i] = 0;
+	}
+
+	for (l = 0; l < nlines; l++) {
+		src = x + (size_t)l * ldx;
+		prev = table + (size_t)l * ld + 1;
+		dst = table + (size_t)(l + 1) * ld + 1;
+		dst[-1] = 0;
+		carry = _mm512_setzero_pd();
+
+		if (cutoff > 0) {
+			xreg = prefix_pd512(_mm512_maskz_loadu_pd(mask, src));
+			_mm512_mask_storeu_pd(dst, mask, _mm512_add_pd(xreg, _mm512_maskz_loadu_pd(mask, prev)));
+			carry = _mm512_permutexvar_pd(last, xreg);
+		}
+
+		for (i = cutoff; i < len; i += DOUBLE_PER_M512_REG) {
+			xreg = _mm512_add_pd(prefix_pd512(_mm512_loadu_pd(src + i)), carry);
+			_mm512_storeu_pd(dst + i, _mm512_add_pd(xreg, _mm512_loadu_pd(prev + i)));
+			carry = _mm512_permutexvar_pd(last, xreg);
+		}
+	}
+}
+
+TARGET_AVX512
+void _mm512_sat_box_ps(float *dst, const float *lo, const float *hi, const float *full, float count, int len, int width, int accumulate)
+{
+	int i;
+	int cutoff = len % FLOAT_PER_M512_REG;
+	__mmask16 mask;
+	__m512 sreg;
+	__m512 creg = _mm512_set1_ps(count);
+
+	if (cutoff > 0) {
+		mask = _mm512_set_mask_epi32(cutoff - 1);
+		sreg = _mm512_sub_ps(_mm512_sub_ps(_mm512_maskz_loadu_ps(mask, hi + width), _mm512_maskz_loadu_ps(mask, hi)), _mm512_sub_ps(_mm512_maskz_loadu_ps(mask, lo + width), _mm512_maskz_loadu_ps(mask, lo)));
+
+		if (full != NULL) {
+			sreg = _mm512_fmadd_ps(creg, _mm512_sub_ps(_mm512_maskz_loadu_ps(mask, full + width), _mm512_maskz_loadu_ps(mask, full)), sreg);
+		}
+
+		if (accumulate) {
+			sreg = _mm512_add_ps(sreg, _mm512_maskz_loadu_ps(mask, dst));
+		}
+
+		_mm512_mask_storeu_ps(dst, mask, sreg);
+	}
+
+	for (i = cutoff; i < len; i += FLOAT_PER_M512_REG) {
+		sreg = _mm512_sub_ps(_mm512_sub_ps(_mm512_loadu_ps(hi + i + width), _mm512_loadu_ps(hi + i)), _mm512_sub_ps(_mm512_loadu_ps(lo + i + width), _mm512_loadu_ps(lo + i)));
+
+		if (full != NULL) {
+			sreg = _mm512_fmadd_ps(creg, _mm512_sub_ps(_mm512_loadu_ps(full + i + width), _mm512_loadu_ps(full + i)), sreg);
+		}
+
+		if (accumulate) {
+			sreg = _mm512_add_ps(sreg, _mm512_loadu_ps(dst + i));
+		}
+
+		_mm512_storeu_ps(dst + i, sreg);
+	}
+}
+
+TARGET_AVX512
+void _mm512_sat_box_pd(double *dst, const double *lo, const double *hi, const double *full, double count, int len, int width, int accumulate)
+{
+	int i;
+	int cutoff = len % DOUBLE_PER_M512_REG;
+	__mmask8 mask;
+	__m512d sreg;
+	__m512d creg = _mm512_set1_pd(count);
+
+	if (cutoff > 0) {
+		mask = _mm512_set_mask_epi64(cutoff - 1);
+		sreg = _mm512_sub_pd(_mm512_sub_pd(_mm512_maskz_loadu_pd(mask, hi + width), _mm512_maskz_loadu_pd(mask, hi)), _mm512_sub_pd(_mm512_maskz_loadu_pd(mask, lo + width), _mm512_maskz_loadu_pd(mask, lo)));
+
+		if (full != NULL) {
+			sreg = _mm512_fmadd_pd(creg, _mm512_sub_pd(_mm512_maskz_loadu_pd(mask, full + width), _mm512_maskz_loadu_pd(mask, full)), sreg);
+		}
+
+		if (accumulate) {
+			sreg = _mm512_add_pd(sreg, _mm512_maskz_loadu_pd(mask, dst));
+		}
+
+		_mm512_mask_storeu_pd(dst, mask, sreg);
+	}
+
+	for (i = cutoff; i < len; i += DOUBLE_PER_M512_REG) {
+		sreg = _mm512_sub_pd(_mm512_sub_pd(_mm512_loadu_pd(hi + i + width), _mm512_loadu_pd(hi + i)), _mm512_sub_pd(_mm512_loadu_pd(lo + i + width), _mm512_loadu_pd(lo + i)));
+
+		if (full != NULL) {
+			sreg = _mm512_fmadd_pd(creg, _mm512_sub_pd(_mm512_loadu_pd(full + i + width), _mm512_loadu_pd(full + i)), sreg);
+		}
+
+		if (accumulate) {
+			sreg = _mm512_add_pd(sreg, _mm512_loadu_pd(dst + i));
+		}
+
+		_mm512_storeu_pd(dst + i, sreg);
+	}
+}
+#endif
+
+//----------------------------------------------------------------------------
+// Transposes. The register primitives transpose a square of registers in
+// place, so that r[k] ends up holding lane k of every input register. The
+// matrix kernels write the transpose of a, which is nrows by ncols in the
+// given order, to b in the same order. This is also a copied into the
+// other order. They walk blocks of TRANSPOSE_BLOCK_PS or TRANSPOSE_BLOCK_PD
+// lines (constants.h) and transpose whole squares of registers within each
+// block. Lines and positions past the last whole square are copied one at a
+// time. The in-place kernels swap each square above the diagonal with its
+// mirror. The int kernels move the same bits through the float ones.
+//----------------------------------------------------------------------------
+
+// Scalar part of a transpose of m lines of n: lines from mw on, and
+// positions from nw on in the lines before.
+static void transpose_tail32(float *dst, int lddst, const float *src, int ldsrc, int m, int n, int mw, int nw)
+{
+	int i, j;
+
+	for (i = 0; i < m; i++) {
+		for (j = i < mw ? nw : 0; j < n; j++) {
+			memcpy(dst + (size_t)j * lddst + i, src + (size_t)i * ldsrc + j, sizeof(float));
+		}
+	}
+}
+
+static void transpose_tail64(double *dst, int lddst, const double *src, int ldsrc, int m, int n, int mw, int nw)
+{
+	int i, j;
+
+	for (i = 0; i < m; i++) {
+		for (j = i < mw ? nw : 0; j < n; j++) {
+			memcpy(dst + (size_t)j * lddst + i, src + (size_t)i * ldsrc + j, sizeof(double));
+		}
+	}
+}
+
+// Scalar part of an in-place transpose of n lines of n: pairs with a
+// position from nw on.
+static void transpose_inplace_tail32(float *a, int lda, int n, int nw)
+{
+	int i, j;
+	float t;
+
+	for (i = 0; i < n; i++) {
+		for (j = i + 1 > nw ? i + 1 : nw; j < n; j++) {
+			memcpy(&t, a + (size_t)i * lda + j, sizeof(float));
+			memcpy(a + (size_t)i * lda + j, a + (size_t)j * lda + i, sizeof(float));
+			memcpy(a + (size_t)j * lda + i, &t, sizeof(float));
+		}
+	}
+}
+
+static void transpose_inplace_tail64(double *a, int lda, int n, int nw)
+{
+	int i, j;
+	double t;
+
+	for (i = 0; i < n; i++) {
+		for (j = i + 1 > nw ? i + 1 : nw; j < n; j++) {
+			memcpy(&t, a + (size_t)i * lda + j, sizeof(double));
+			memcpy(a + (size_t)i * lda + j, a + (size_t)j * lda + i, sizeof(double));
+			memcpy(a + (size_t)j * lda + i, &t, sizeof(double));
+		}
+	}
+}
+
+// Lines and positions of a nrows by ncols matrix in the given order.
+static void transpose_lines(char order, int nrows, int ncols, int *m, int *n)
+{
+	*m = order == ROW_MAJOR_ORDER ? nrows : ncols;
+	*n = order == ROW_MAJOR_ORDER ? ncols : nrows;
+}
+
+static inline void transpose4_ps128(__m128 *r)
+{
+	_MM_TRANSPOSE4_PS(r[0], r[1], r[2], r[3]);
+}
+
+static inline void transpose2_pd128(__m128d *r)
+{
+	__m128d t = _mm_unpacklo_pd(r[0], r[1]);
+
+	r[1] = _mm_unpackhi_pd(r[0], r[1]);
+	r[0] = t;
+}
+
+// Moves the transpose of the square at q to p and that of the square at p
+// to q. For a square on the diagonal p equals q.
+static inline void swap_squares_ps128(float *p, float *q, int ld)
+{
+	int k;
+	__m128 x[FLOAT_PER_M128_REG], y[FLOAT_PER_M128_REG];
+
+	for (k = 0; k < FLOAT_PER_M128_REG; k++) {
+		x[k] = _mm_loadu_ps(p + (size_t)k * ld);
+		y[k] = _mm_loadu_ps(q + (size_t)k * ld);
+	}
+
+	transpose4_ps128(x);
+	transpose4_ps128(y);
+
+	for (k = 0; k < FLOAT_PER_M128_REG; k++) {
+		_mm_storeu_ps(q + (size_t)k * ld, x[k]);
+		_mm_storeu_ps(p + (size_t)k * ld, y[k]);
+	}
+}
+
+static inline void swap_squares_pd128(double *p, double *q, int ld)
+{
+	__m128d x[DOUBLE_PER_M128_REG], y[DOUBLE_PER_M128_REG];
+
+	x[0] = _mm_loadu_pd(p);
+	x[1] = _mm_loadu_pd(p + ld);
+	y[0] = _mm_loadu_pd(q);
+	y[1] = _mm_loadu_pd(q + ld);
+
+	transpose2_pd128(x);
+	transpose2_pd128(y);
+
+	_mm_storeu_pd(q, x[0]);
+	_mm_storeu_pd(q + ld, x[1]);
+	_mm_storeu_pd(p, y[0]);
+	_mm_storeu_pd(p + ld, y[1]);
+}
+
+void _mm_transpose4_ps(__m128 *r)
+{
+	transpose4_ps128(r);
+}
+
+void _mm_transpose4_epi32(__m128i *r)
+{
+	__m128 x[INT32_PER_M128_REG];
+	int k;
+
+	for (k = 0; k < INT32_PER_M128_REG; k++) {
+		x[k] = _mm_castsi128_ps(r[k]);
+	}
+
+	transpose4_ps128(x);
+
+	for (k = 0; k < INT32_PER_M128_REG; k++) {
+		r[k] = _mm_castps_si128(x[k]);
+	}
+}
+
+void _mm_transpose2_pd(__m128d *r)
+{
+	transpose2_pd128(r);
+}
+
+void _mm_transpose_ps(char order, int nrows, int ncols, const float *a, int lda, float *b, int ldb)
+{
+	int i, j, i0, j0, i1, j1, m, n, mw, nw, k;
+	__m128 x[FLOAT_PER_M128_REG];
+
+	transpose_lines(order, nrows, ncols, &m, &n);
+	mw = m - m % FLOAT_PER_M128_REG;
+	nw = n - n % FLOAT_PER_M128_REG;
+
+	for (i0 = 0; i0 < mw; i0 += TRANSPOSE_BLOCK_PS) {
+		i1 = i0 + TRANSPOSE_BLOCK_PS < mw ? i0 + TRANSPOSE_BLOCK_PS : mw;
+
+		for (j0 = 0; j0 < nw; j0 += TRANSPOSE_BLOCK_PS) {
+			j1 = j0 + TRANSPOSE_BLOCK_PS < nw ? j0 + TRANSPOSE_BLOCK_PS : nw;
+
+			for (i = i0; i < i1; i += FLOAT_PER_M128_REG) {
+				for (j = j0; j < j1; j += FLOAT_PER_M128_REG) {
+					for (k = 0; k < FLOAT_PER_M128_REG; k++) {
+						x[k] = _mm_loadu_ps(a + (size_t)(i + k) * lda + j);
+					}
+
+					transpose4_ps128(x);
+
+					for (k = 0; k < FLOAT_PER_M128_REG; k++) {
+						_mm_storeu_ps(b + (size_t)(j + k) * ldb + i, x[k]);
+					}
+				}
+			}
+		}
+	}
+
+	transpose_tail32(b, ldb, a, lda, m, n, mw, nw);
+}
+
+void _mm_transpose_pd(char order, int nrows, int ncols, const double *a, int lda, double *b, int ldb)
+{
+	int i, j, i0, j0, i1, j1, m, n, mw, nw;
+	__m128d x[DOUBLE_PER_M128_REG];
+
+	transpose_lines(order, nrows, ncols, &m, &n);
+	mw = m - m % DOUBLE_PER_M128_REG;
+	nw = n - n % DOUBLE_PER_M128_REG;
+
+	for (i0 = 0; i0 < mw; i0 += TRANSPOSE_BLOCK_PD) {
+		i1 = i0 + TRANSPOSE_BLOCK_PD < mw ? i0 + TRANSPOSE_BLOCK_PD : mw;
+
+		for (j0 = 0; j0 < nw; j0 += TRANSPOSE_BLOCK_PD) {
+			j1 = j0 + TRANSPOSE_BLOCK_PD < nw ? j0 + TRANSPOSE_BLOCK_PD : nw;
+
+			for (i = i0; i < i1; i += DOUBLE_PER_M128_REG) {
+				for (j = j0; j < j1; j += DOUBLE_PER_M128_REG) {
+					x[0] = _mm_loadu_pd(a + (size_t)i * lda + j);
+					x[1] = _mm_loadu_pd(a + (size_t)(i + 1) * lda + j);
+					transpose2_pd128(x);
+					_mm_storeu_pd(b + (size_t)j * ldb + i, x[0]);
+					_mm_storeu_pd(b + (size_t)(j + 1) * ldb + i, x[1]);
+				}
+			}
+		}
+	}
+
+	transpose_tail64(b, ldb, a, lda, m, n, mw, nw);
+}
+
+void _mm_transpose_epi32(char order, int nrows, int ncols, const int *a, int lda, int *b, int ldb)
+{
+	_mm_transpose_ps(order, nrows, ncols, (const float *)a, lda, (float *)b, ldb);
+}
+
+void _mm_transpose_inplace_ps(int n, float *a, int lda)
+{
+	int i, j, i0, j0, i1, j1;
+	int nw = n - n % FLOAT_PER_M128_REG;
+
+	for (i0 = 0; i0 < nw; i0 += TRANSPOSE_BLOCK_PS) {
+		i1 = i0 + TRANSPOSE_BLOCK_PS < nw ? i0 + TRANSPOSE_BLOCK_PS : nw;
+
+		for (j0 = i0; j0 < nw; j0 += TRANSPOSE_BLOCK_PS) {
+			j1 = j0 + TRANSPOSE_BLOCK_PS < nw ? j0 + TRANSPOSE_BLOCK_PS : nw;
+
+			for (i = i0; i < i1; i += FLOAT_PER_M128_REG) {
+				for (j = j0 == i0 ? i : j0; j < j1; j += FLOAT_PER_M128_REG) {
+					swap_squares_ps128(a + (size_t)i * lda + j, a + (size_t)j * lda + i, lda);
+				}
+			}
+		}
+	}
+
+	transpose_inplace_tail32(a, lda, n, nw);
+}
+
+void _mm_transpose_inplace_pd(int n, double *a, int lda)
+{
+	int i, j, i0, j0, i1, j1;
+	int nw = n - n % DOUBLE_PER_M128_REG;
+
+	for (i0 = 0; i0 < nw; i0 += TRANSPOSE_BLOCK_PD) {
+		i1 = i0 + TRANSPOSE_BLOCK_PD < nw ? i0 + TRANSPOSE_BLOCK_PD : nw;
+
+		for (j0 = i0; j0 < nw; j0 += TRANSPOSE_BLOCK_PD) {
+			j1 = j0 + TRANSPOSE_BLOCK_PD < nw ? j0 + TRANSPOSE_BLOCK_PD : nw;
+
+			for (i = i0; i < i1; i += DOUBLE_PER_M128_REG) {
+				for (j = j0 == i0 ? i : j0; j < j1; j += DOUBLE_PER_M128_REG) {
+					swap_squares_pd128(a + (size_t)i * lda + j, a + (size_t)j * lda + i, lda);
+				}
+			}
+		}
+	}
+
+	transpose_inplace_tail64(a, lda, n, nw);
+}
+
+void _mm_transpose_inplace_epi32(int n, int *a, int lda)
+{
+	_mm_transpose_inplace_ps(n, (float *)a, lda);
+}
+
+TARGET_AVX2
+static inline void transpose8_ps256(__m256 *r)
+{
+	int k;
+	__m256 t[FLOAT_PER_M256_REG], u[FLOAT_PER_M256_REG];
+
+	for (k = 0; k < FLOAT_PER_M256_REG; k += 2) {
+		t[k] = _mm256_unpacklo_ps(r[k], r[k + 1]);
+		t[k + 1] = _mm256_unpackhi_ps(r[k], r[k + 1]);
+	}
+
+	// u[4 g + e] holds, in each 128-bit lane l, position 4 l + e of lines
+	// 4 g to 4 g + 3.
+	for (k = 0; k < FLOAT_PER_M256_REG; k += 4) {
+		u[k] = _mm256_shuffle_ps(t[k], t[k + 2], 0x44);
+		u[k + 1] = _mm256_shuffle_ps(t[k], t[k + 2], 0xee);
+		u[k + 2] = _mm256_shuffle_ps(t[k + 1], t[k + 3], 0x44);
+		u[k + 3] = _mm256_shuffle_ps(t[k + 1], t[k + 3], 0xee);
+	}
+
+	for (k = 0; k < 4; k++) {
+		r[k] = _mm256_permute2f128_ps(u[k], u[k + 4], 0x20);
+		r[k + 4] = _mm256_permute2f128_ps(u[k], u[k + 4], 0x31);
+	}
+}
+
+TARGET_AVX2
+static inline void transpose4_pd256(__m256d *r)
+{
+	__m256d t0 = _mm256_unpacklo_pd(r[0], r[1]);
+	__m256d t1 = _mm256_unpackhi_pd(r[0], r[1]);
+	__m256d t2 = _mm256_unpacklo_pd(r[2], r[3]);
+	__m256d t3 = _mm256_unpackhi_pd(r[2], r[3]);
+
+	r[0] = _mm256_permute2f128_pd(t0, t2, 0x20);
+	r[1] = _mm256_permute2f128_pd(t1, t3, 0x20);
+	r[2] = _mm256_permute2f128_pd(t0, t2, 0x31);
+	r[3] = _mm256_permute2f128_pd(t1, t3, 0x31);
+}
+
+TARGET_AVX2
+static inline void swap_squares_ps256(float *p, float *q, int ld)
+{
+	int k;
+	__m256 x[FLOAT_PER_M256_REG], y[FLOAT_PER_M256_REG];
+
+	for (k = 0; k < FLOAT_PER_M256_REG; k++) {
+		x[k] = _mm256_loadu_ps(p + (size_t)k * ld);
+		y[k] = _mm256_loadu_ps(q + (size_t)k * ld);
+	}
+
+	transpose8_ps256(x);
+	transpose8_ps256(y);
+
+	for (k = 0; k < FLOAT_PER_M256_REG; k++) {
+		_mm256_storeu_ps(q + (size_t)k * ld, x[k]);
+		_mm256_storeu_ps(p + (size_t)k * ld, y[k]);
+	}
+}
+
+TARGET_AVX2
+static inline void swap_squares_pd256(double *p, double *q, int ld)
+{
+	int k;
+	__m256d x[DOUBLE_PER_M256_REG], y[DOUBLE_PER_M256_REG];
+
+	for (k = 0; k < DOUBLE_PER_M256_REG; k++) {
+		x[k] = _mm256_loadu_pd(p + (size_t)k * ld);
+		y[k] = _mm256_loadu_pd(q + (size_t)k * ld);
+	}
+
+	transpose4_pd256(x);
+	transpose4_pd256(y);
+
+	for (k = 0; k < DOUBLE_PER_M256_REG; k++) {
+		_mm256_storeu_pd(q + (size_t)k * ld, x[k]);
+		_mm256_storeu_pd(p + (size_t)k * ld, y[k]);
+	}
+}
+
+TARGET_AVX2
+void _mm256_transpose8_ps(__m256 *r)
+{
+	transpose8_ps256(r);
+}
+
+TARGET_AVX2
+void _mm256_transpose8_epi32(__m256i *r)
+{
+	__m256 x[INT32_PER_M256_REG];
+	int k;
+
+	for (k = 0; k < INT32_PER_M256_REG; k++) {
+		x[k] = _mm256_castsi256_ps(r[k]);
+	}
+
+	transpose8_ps256(x);
+
+	for (k = 0; k < INT32_PER_M256_REG; k++) {
+		r[k] = _mm256_castps_si256(x[k]);
+	}
+}
+
+TARGET_AVX2
+void _mm256_transpose4_pd(__m256d *r)
+{
+	transpose4_pd256(r);
+}
+
+TARGET_AVX2
+void _mm256_transpose_ps(char order, int nrows, int ncols, const float *a, int lda, float *b, int ldb)
+{
+	int i, j, i0, j0, i1, j1, m, n, mw, nw, k;
+	__m256 x[FLOAT_PER_M256_REG];
+
+	transpose_lines(order, nrows, ncols, &m, &n);
+	mw = m - m % FLOAT_PER_M256_REG;
+	nw = n - n % FLOAT_PER_M256_REG;
+
+	for (i0 = 0; i0 < mw; i0 += TRANSPOSE_BLOCK_PS) {
+		i1 = i0 + TRANSPOSE_BLOCK_PS < mw ? i0 + TRANSPOSE_BLOCK_PS : mw;
+
+		for (j0 = 0; j0 < nw; j0 += TRANSPOSE_BLOCK_PS) {
+			j1 = j0 + TRANSPOSE_BLOCK_PS < nw ? j0 + TRANSPOSE_BLOCK_PS : nw;
+
+			for (i = i0; i < i1; i += FLOAT_PER_M256_REG) {
+				for (j = j0; j < j1; j += FLOAT_PER_M256_REG) {
+					for (k = 0; k < FLOAT_PER_M256_REG; k++) {
+						x[k] = _mm256_loadu_ps(a + (size_t)(i + k) * lda + j);
+					}
+
+					transpose8_ps256(x);
+
+					for (k = 0; k < FLOAT_PER_M256_REG; k++) {
+						_mm256_storeu_ps(b + (size_t)(j + k) * ldb + i, x[k]);
+					}
+				}
+			}
+		}
+	}
+
+	transpose_tail32(b, ldb, a, lda, m, n, mw, nw);
+}
+
+TARGET_AVX2
+void _mm256_transpose_pd(char order, int nrows, int ncols, const double *a, int lda, double *b, int ldb)
+{
+	int i, j, i0, j0, i1, j1, m, n, mw, nw, k;
+	__m256d x[DOUBLE_PER_M256_REG];
+
+	transpose_lines(order, nrows, ncols, &m, &n);
+	mw = m - m % DOUBLE_PER_M256_REG;
+	nw = n - n % DOUBLE_PER_M256_REG;
+
+	for (i0 = 0; i0 < mw; i0 += TRANSPOSE_BLOCK_PD) {
+		i1 = i0 + TRANSPOSE_BLOCK_PD < mw ? i0 + TRANSPOSE_BLOCK_PD : mw;
+
+		for (j0 = 0; j0 < nw; j0 += TRANSPOSE_BLOCK_PD) {
+			j1 = j0 + TRANSPOSE_BLOCK_PD < nw ? j0 + TRANSPOSE_BLOCK_PD : nw;
+
+			for (i = i0; i < i1; i += DOUBLE_PER_M256_REG) {
+				for (j = j0; j < j1; j += DOUBLE_PER_M256_REG) {
+					for (k = 0; k < DOUBLE_PER_M256_REG; k++) {
+						x[k] = _mm256_loadu_pd(a + (size_t)(i + k) * lda + j);
+					}
+
+					transpose4_pd256(x);
+
+					for (k = 0; k < DOUBLE_PER_M256_REG; k++) {
+						_mm256_storeu_pd(b + (size_t)(j + k) * ldb + i, x[k]);
+					}
+				}
+			}
+		}
+	}
+
+	transpose_tail64(b, ldb, a, lda, m, n, mw, nw);
+}
+
+TARGET_AVX2
+void _mm256_transpose_epi32(char order, int nrows, int ncols, const int *a, int lda, int *b, int ldb)
+{
+	_mm256_transpose_ps(order, nrows, ncols, (const float *)a, lda, (float *)b, ldb);
+}
+
+TARGET_AVX2
+void _mm256_transpose_inplace_ps(int n, float *a, int lda)
+{
+	int i, j, i0, j0, i1, j1;
+	int nw = n - n % FLOAT_PER_M256_REG;
+
+	for (i0 = 0; i0 < nw; i0 += TRANSPOSE_BLOCK_PS) {
+		i1 = i0 + TRANSPOSE_BLOCK_PS < nw ? i0 + TRANSPOSE_BLOCK_PS : nw;
+
+		for (j0 = i0; j0 < nw; j0 += TRANSPOSE_BLOCK_PS) {
+			j1 = j0 + TRANSPOSE_BLOCK_PS < nw ? j0 + TRANSPOSE_BLOCK_PS : nw;
+
+			for (i = i0; i < i1; i += FLOAT_PER_M256_REG) {
+				for (j = j0 == i0 ? i : j0; j < j1; j += FLOAT_PER_M256_REG) {
+					swap_squares_ps256(a + (size_t)i * lda + j, a + (size_t)j * lda + i, lda);
+				}
+			}
+		}
+	}
+
+	transpose_inplace_tail32(a, lda, n, nw);
+}
+
+TARGET_AVX2
+void _mm256_transpose_inplace_pd(int n, double *a, int lda)
+{
+	int i, j, i0, j0, i1, j1;
+	int nw = n - n % DOUBLE_PER_M256_REG;
+
+	for (i0 = 0; i0 < nw; i0 += TRANSPOSE_BLOCK_PD) {
+		i1 = i0 + TRANSPOSE_BLOCK_PD < nw ? i0 + TRANSPOSE_BLOCK_PD : nw;
+
+		for (j0 = i0; j0 < nw; j0 += TRANSPOSE_BLOCK_PD) {
+			j1 = j0 + TRANSPOSE_BLOCK_PD < nw ? j0 + TRANSPOSE_BLOCK_PD : nw;
+
+			for (i = i0; i < i1; i += DOUBLE_PER_M256_REG) {
+				for (j = j0 == i0 ? i : j0; j < j1; j += DOUBLE_PER_M256_REG) {
+					swap_squares_pd256(a + (size_t)i * lda + j, a + (size_t)j * lda + i, lda);
+				}
+			}
+		}
+	}
+
+	transpose_inplace_tail64(a, lda, n, nw);
+}
+
+TARGET_AVX2
+void _mm256_transpose_inplace_epi32(int n, int *a, int lda)
+{
+	_mm256_transpose_inplace_ps(n, (float *)a, lda);
+}
+
+#ifdef SUPPORTS_AVX512
+TARGET_AVX512
+static inline void transpose16_ps512(__m512 *r)
+{
+	int k;
+	__m512 t[FLOAT_PER_M512_REG], u[FLOAT_PER_M512_REG];
+
+	for (k = 0; k < FLOAT_PER_M512_REG; k += 2) {
+		t[k] = _mm512_unpacklo_ps(r[k], r[k + 1]);
+		t[k + 1] = _mm512_unpackhi_ps(r[k], r[k + 1]);
+	}
+
+	// u[4 g + e] holds, in each 128-bit lane l, position 4 l + e of lines
+	// 4 g to 4 g + 3.
+	for (k = 0; k < FLOAT_PER_M512_REG; k += 4) {
+		u[k] = _mm512_castpd_ps(_mm512_unpacklo_pd(_mm512_castps_pd(t[k]), _mm512_castps_pd(t[k + 2])));
+		u[k + 1] = _mm512_castpd_ps(_mm512_unpackhi_pd(_mm512_castps_pd(t[k]), _mm512_castps_pd(t[k + 2])));
+		u[k + 2] = _mm512_castpd_ps(_mm512_unpacklo_pd(_mm512_castps_pd(t[k + 1]), _mm512_castps_pd(t[k + 3])));
+		u[k + 3] = _mm512_castpd_ps(_mm512_unpackhi_pd(_mm512_castps_pd(t[k + 1]), _mm512_castps_pd(t[k + 3])));
+	}
+
+	// t[e] and t[4 + e] gather lanes 0 and 2, and lanes 1 and 3, of lines
+	// 0 to 7; t[8 + e] and t[12 + e] those of lines 8 to 15.
+	for (k = 0; k < 4; k++) {
+		t[k] = _mm512_shuffle_f32x4(u[k], u[k + 4], 0x88);
+		t[k + 4] = _mm512_shuffle_f32x4(u[k], u[k + 4], 0xdd);
+		t[k + 8] = _mm512_shuffle_f32x4(u[k + 8], u[k + 12], 0x88);
+		t[k + 12] = _mm512_shuffle_f32x4(u[k + 8], u[k + 12], 0xdd);
+	}
+
+	for (k = 0; k < 4; k++) {
+		r[k] = _mm512_shuffle_f32x4(t[k], t[k + 8], 0x88);
+		r[k + 8] = _mm512_shuffle_f32x4(t[k], t[k + 8], 0xdd);
+		r[k + 4] = _mm512_shuffle_f32x4(t[k + 4], t[k + 12], 0x88);
+		r[k + 12] = _mm512_shuffle_f32x4(t[k + 4], t[k + 12], 0xdd);
+	}
+}
+
+TARGET_AVX512
+static inline void transpose8_pd512(__m512d *r)
+{
+	int k;
+	__m512d t[DOUBLE_PER_M512_REG], u[DOUBLE_PER_M512_REG];
+
+	// t[2 h + e] holds, in each 128-bit lane l, position 2 l + e of lines
+	// 2 h and 2 h + 1.
+	for (k = 0; k < DOUBLE_PER_M512_REG; k += 2) {
+		t[k] = _mm512_unpacklo_pd(r[k], r[k + 1]);
+		t[k + 1] = _mm512_unpackhi_pd(r[k], r[k + 1]);
+	}
+
+	for (k = 0; k < 2; k++) {
+		u[k] = _mm512_shuffle_f64x2(t[k], t[k + 2], 0x88);
+		u[k + 2] = _mm512_shuffle_f64x2(t[k], t[k + 2], 0xdd);
+		u[k + 4] = _mm512_shuffle_f64x2(t[k + 4], t[k + 6], 0x88);
+		u[k + 6] = _mm512_shuffle_f64x2(t[k + 4], t[k + 6], 0xdd);
+	}
+
+	for (k = 0; k < 2; k++) {
+		r[k] = _mm512_shuffle_f64x2(u[k], u[k + 4], 0x88);
+		r[k + 4] = _mm512_shuffle_f64x2(u[k], u[k + 4], 0xdd);
+		r[k + 2] = _mm512_shuffle_f64x2(u[k + 2], u[k + 6], 0x88);
+		r[k + 6] = _mm512_shuffle_f64x2(u[k + 2], u[k + 6], 0xdd);
+	}
+}
+
+TARGET_AVX512
+static inline void swap_squares_ps512(float *p, float *q, int ld)
+{
+	int k;
+	__m512 x[FLOAT_PER_M512_REG], y[FLOAT_PER_M512_REG];
+
+	for (k = 0; k < FLOAT_PER_M512_REG; k++) {
+		x[k] = _mm512_loadu_ps(p + (size_t)k * ld);
+		y[k] = _mm512_loadu_ps(q + (size_t)k * ld);
+	}
+
+	transpose16_ps512(x);
+	transpose16_ps512(y);
+
+	for (k = 0; k < FLOAT_PER_M512_REG; k++) {
+		_mm512_storeu_ps(q + (size_t)k * ld, x[k]);
+		_mm512_storeu_ps(p + (size_t)k * ld, y[k]);
+	}
+}
+
+TARGET_AVX512
+static inline void swap_squares_pd512(double *p, double *q, int ld)
+{
+	int k;
+	__m512d x[DOUBLE_PER_M512_REG], y[DOUBLE_PER_M512_REG];
+
+	for (k = 0; k < DOUBLE_PER_M512_REG; k++) {
+		x[k] = _mm512_loadu_pd(p + (size_t)k * ld);
+		y[k] = _mm512_loadu_pd(q + (size_t)k * ld);
+	}
+
+	transpose8_pd512(x);
+	transpose8_pd512(y);
+
+	for (k = 0; k < DOUBLE_PER_M512_REG; k++) {
+		_mm512_storeu_pd(q + (size_t)k * ld, x[k]);
+		_mm512_storeu_pd(p + (size_t)k * ld, y[k]);
+	}
+}
+
+TARGET_AVX512
+void _mm512_transpose16_ps(__m512 *r)
+{
+	transpose16_ps512(r);
+}
+
+TARGET_AVX512
+void _mm512_transpose16_epi32(__m512i *r)
+{
+	__m512 x[INT32_PER_M512_REG];
+	int k;
+
+	for (k = 0; k < INT32_PER_M512_REG; k++) {
+		x[k] = _mm512_castsi512_ps(r[k]);
+	}
+
+	transpose16_ps512(x);
+
+	for (k = 0; k < INT32_PER_M512_REG; k++) {
+		r[k] = _mm512_castps_si512(x[k]);
+	}
+}
+
+TARGET_AVX512
+void _mm512_transpose8_pd(__m512d *r)
+{
+	transpose8_pd512(r);
+}
+
+TARGET_AVX512
+void _mm512_transpose_ps(char order, int nrows, int ncols, const float *a, int lda, float *b, int ldb)
+{
+	int i, j, i0, j0, i1, j1, m, n, mw, nw, k;
+	__m512 x[FLOAT_PER_M512_REG];
+
+	transpose_lines(order, nrows, ncols, &m, &n);
+	mw = m - m % FLOAT_PER_M512_REG;
+	nw = n - n % FLOAT_PER_M512_REG;
+
+	for (i0 = 0; i0 < mw; i0 += TRANSPOSE_BLOCK_PS) {
+		i1 = i0 + TRANSPOSE_BLOCK_PS < mw ? i0 + TRANSPOSE_BLOCK_PS : mw;
+
+		for (j0 = 0; j0 < nw; j0 += TRANSPOSE_BLOCK_PS) {
+			j1 = j0 + TRANSPOSE_BLOCK_PS < nw ? j0 + TRANSPOSE_BLOCK_PS : nw;
+
+			for (i = i0; i < i1; i += FLOAT_PER_M512_REG) {
+				for (j = j0; j < j1; j += FLOAT_PER_M512_REG) {
+					for (k = 0; k < FLOAT_PER_M512_REG; k++) {
+						x[k] = _mm512_loadu_ps(a + (size_t)(i + k) * lda + j);
+					}
+
+					transpose16_ps512(x);
+
+					for (k = 0; k < FLOAT_PER_M512_REG; k++) {
+						_mm512_storeu_ps(b + (size_t)(j + k) * ldb + i, x[k]);
+					}
+				}
+			}
+		}
+	}
+
+	transpose_tail32(b, ldb, a, lda, m, n, mw, nw);
+}
+
+TARGET_AVX512
+void _mm512_transpose_pd(char order, int nrows, int ncols, const double *a, int lda, double *b, int ldb)
+{
+	int i, j, i0, j0, i1, j1, m, n, mw, nw, k;
+	__m512d x[DOUBLE_PER_M512_REG];
+
+	transpose_lines(order, nrows, ncols, &m, &n);
+	mw = m - m % DOUBLE_PER_M512_REG;
+	nw = n - n % DOUBLE_PER_M512_REG;
+
+	for (i0 = 0; i0 < mw; i0 += TRANSPOSE_BLOCK_PD) {
+		i1 = i0 + TRANSPOSE_BLOCK_PD < mw ? i0 + TRANSPOSE_BLOCK_PD : mw;
+
+		for (j0 = 0; j0 < nw; j0 += TRANSPOSE_BLOCK_PD) {
+			j1 = j0 + TRANSPOSE_BLOCK_PD < nw ? j0 + TRANSPOSE_BLOCK_PD : nw;
+
+			for (i = i0; i < i1; i += DOUBLE_PER_M512_REG) {
+				for (j = j0; j < j1; j += DOUBLE_PER_M512_REG) {
+					for (k = 0; k < DOUBLE_PER_M512_REG; k++) {
+						x[k] = _mm512_loadu_pd(a + (size_t)(i + k) * lda + j);
+					}
+
+					transpose8_pd512(x);
+
+					for (k = 0; k < DOUBLE_PER_M512_REG; k++) {
+						_mm512_storeu_pd(b + (size_t)(j + k) * ldb + i, x[k]);
+					}
+				}
+			}
+		}
+	}
+
+	transpose_tail64(b, ldb, a, lda, m, n, mw, nw);
+}
+
+TARGET_AVX512
+void _mm512_transpose_epi32(char order, int nrows, int ncols, const int *a, int lda, int *b, int ldb)
+{
+	_mm512_transpose_ps(order, nrows, ncols, (const float *)a, lda, (float *)b, ldb);
+}
+
+TARGET_AVX512
+void _mm512_transpose_inplace_ps(int n, float *a, int lda)
+{
+	int i, j, i0, j0, i1, j1;
+	int nw = n - n % FLOAT_PER_M512_REG;
+
+	for (i0 = 0; i0 < nw; i0 += TRANSPOSE_BLOCK_PS) {
+		i1 = i0 + TRANSPOSE_BLOCK_PS < nw ? i0 + TRANSPOSE_BLOCK_PS : nw;
+
+		for (j0 = i0; j0 < nw; j0 += TRANSPOSE_BLOCK_PS) {
+			j1 = j0 + TRANSPOSE_BLOCK_PS < nw ? j0 + TRANSPOSE_BLOCK_PS : nw;
+
+			for (i = i0; i < i1; i += FLOAT_PER_M512_REG) {
+				for (j = j0 == i0 ? i : j0; j < j1; j += FLOAT_PER_M512_REG) {
+					swap_squares_ps512(a + (size_t)i * lda + j, a + (size_t)j * lda + i, lda);
+				}
+			}
+		}
+	}
+
+	transpose_inplace_tail32(a, lda, n, nw);
+}
+
+TARGET_AVX512
+void _mm512_transpose_inplace_pd(int n, double *a, int lda)
+{
+	int i, j, i0, j0, i1, j1;
+	int nw = n - n % DOUBLE_PER_M512_REG;
+
+	for (i0 = 0; i0 < nw; i0 += TRANSPOSE_BLOCK_PD) {
+		i1 = i0 + TRANSPOSE_BLOCK_PD < nw ? i0 + TRANSPOSE_BLOCK_PD : nw;
+
+		for (j0 = i0; j0 < nw; j0 += TRANSPOSE_BLOCK_PD) {
+			j1 = j0 + TRANSPOSE_BLOCK_PD < nw ? j0 + TRANSPOSE_BLOCK_PD : nw;
+
+			for (i = i0; i < i1; i += DOUBLE_PER_M512_REG) {
+				for (j = j0 == i0 ? i : j0; j < j1; j += DOUBLE_PER_M512_REG) {
+					swap_squares_pd512(a + (size_t)i * lda + j, a + (size_t)j * lda + i, lda);
+				}
+			}
+		}
+	}
+
+	transpose_inplace_tail64(a, lda, n, nw);
+}
+
+TARGET_AVX512
+void _mm512_transpose_inplace_epi32(int n, int *a, int lda)
+{
+	_mm512_transpose_inplace_ps(n, (float *)a, lda);
+}
+#endif
+
+//----------------------------------------------------------------------------
+// Functions for reducing two-dimensional gathers. These sum, or weight and
+// sum, the same elements that the copy2d kernels would copy, gathering them
+// straight into the accumulators. Weights are laid out like a copy2d
+// destination, numi by numj in column-major order.
+//----------------------------------------------------------------------------
+
+float _mm_sum2d_indexed_ps(const float *src, int nrows, const int *iind, const int *jind, int numi, int numj)
+{
+	const float *col;
+	__m128 sreg = _mm_set1_ps(0);
+	int i, j;
+	int icutoff = numi % FLOAT_PER_M128_REG;
+
+	for (j = 0; j < numj; j++) {
+		col = src + (size_t)jind[j] * nrows;
+
+		if (icutoff > 0) {
+			sreg = _mm_add_ps(sreg, gather_partial_ps(col, iind, icutoff));
+		}
+
+		for (i = icutoff; i < numi; i += FLOAT_PER_M128_REG) {
+			sreg = _mm_add_ps(sreg, gather_ps(col, iind + i));
+		}
+	}
+
+	return _mm_register_sum_ps(sreg);
+}
+
+float _mm_dot2d_indexed_ps(const float *src, int nrows, const int *iind, const int *jind, int numi, int numj, const float *w)
+{
+	const float *col, *wcol;
+	__m128 xreg;
+	__m128 wreg;
+	__m128 sreg = _mm_set1_ps(0);
+	int i, j;
+	int icutoff = numi % FLOAT_PER_M128_REG;
+
+	for (j = 0; j < numj; j++) {
+		col = src + (size_t)jind[j] * nrows;
+		wcol = w + (size_t)j * numi;
+
+		if (icutoff > 0) {
+			xreg = gather_partial_ps(col, iind, icutoff);
+			wreg = load_partial_ps(wcol, icutoff);
+			sreg = _mm_add_ps(sreg, _mm_mul_ps(xreg, wreg));
+		}
+
+		for (i = icutoff; i < numi; i += FLOAT_PER_M128_REG) {
+			xreg = gather_ps(col, iind + i);
+			wreg = _mm_loadu_ps(wcol + i);
+			sreg = _mm_add_ps(sreg, _mm_mul_ps(xreg, wreg));
+		}
+	}
+
+	return _mm_register_sum_ps(sreg);
+}
+
+double _mm_sum2d_indexed_pd(const double *src, int nrows, const int *iind, const int *jind, int numi, int numj)
+{
+	const double *col;
+	__m128d sreg = _mm_set1_pd(0);
+	int i, j;
+	int icutoff = numi % DOUBLE_PER_M128_REG;
+
+	for (j = 0; j < numj; j++) {
+		col = src + (size_t)jind[j] * nrows;
+
+		if (icutoff > 0) {
+			sreg = _mm_add_pd(sreg, _mm_load_sd(col + iind[0]));
+		}
+
+		for (i = icutoff; i < numi; i += DOUBLE_PER_M128_REG) {
+			sreg = _mm_add_pd(sreg, gather_pd(col, iind + i));
+		}
+	}
+
+	return _mm_register_sum_pd(sreg);
+}
+
+double _mm_dot2d_indexed_pd(const double *src, int nrows, const int *iind, const int *jind, int numi, int numj, const double *w)
+{
+	const double *col, *wcol;
+	__m128d xreg;
+	__m128d wreg;
+	__m128d sreg = _mm_set1_pd(0);
+	int i, j;
+	int icutoff = numi % DOUBLE_PER_M128_REG;
+
+	for (j = 0; j < numj; j++) {
+		col = src + (size_t)jind[j] * nrows;
+		wcol = w + (size_t)j * numi;
+
+		if (icutoff > 0) {
+			xreg = _mm_load_sd(col + iind[0]);
+			wreg = _mm_load_sd(wcol);
+			sreg = _mm_add_pd(sreg, _mm_mul_pd(xreg, wreg));
+		}
+
+		for (i = icutoff; i < numi; i += DOUBLE_PER_M128_REG) {
+			xreg = gather_pd(col, iind + i);
+			wreg = _mm_loadu_pd(wcol + i);
+			sreg = _mm_add_pd(sreg, _mm_mul_pd(xreg, wreg));
+		}
+	}
+
+	return _mm_register_sum_pd(sreg);
+}
+
+TARGET_AVX2
+float _mm256_sum2d_indexed_ps(const float *src, int nrows, const int *iind, const int *jind, int numi, int numj)
+{
+	const float *col;
+	__m256 zero = _mm256_set1_ps(0);
+	__m256 sreg = zero;
+	__m256i vindex, hindex;
+	__m256i mask;
+	int i, j;
+	int icutoff = numi % FLOAT_PER_M256_REG;
+
+	// The partial register of row indices is the same for every column, so
+	// it is loaded once. As in the copy2d kernels, gathers are relative to
+	// the start of each column.
+	mask = _mm256_set_mask_epi32(icutoff - 1);
+	hindex = _mm256_maskload_epi32(iind, mask);
+
+	for (j = 0; j < numj; j++) {
+		col = src + (size_t)jind[j] * nrows;
+
+		if (icutoff > 0) {
+			sreg = _mm256_add_ps(sreg, _mm256_mask_i32gather_ps(zero, col, hindex, _mm256_castsi256_ps(mask), 4));
+		}
+
+		for (i = icutoff; i < numi; i += FLOAT_PER_M256_REG) {
+			vindex = _mm256_loadu_si256((const __m256i *)(iind + i));
+			sreg = _mm256_add_ps(sreg, _mm256_i32gather_ps(col, vindex, 4));
+		}
+	}
+
+	return _mm256_register_sum_ps(sreg);
+}
+
+TARGET_AVX2
+float _mm256_dot2d_indexed_ps(const float *src, int nrows, const int *iind, const int *jind, int numi, int numj, const float *w)
+{
+	const float *col, *wcol;
+	__m256 xreg;
+	__m256 wreg;
+	__m256 zero = _mm256_set1_ps(0);
+	__m256 sreg = zero;
+	__m256i vindex, hindex;
+	__m256i mask;
+	int i, j;
+	int icutoff = numi % FLOAT_PER_M256_REG;
+
+	mask = _mm256_set_mask_epi32(icutoff - 1);
+	hindex = _mm256_maskload_epi32(iind, mask);
+
+	for (j = 0; j < numj; j++) {
+		col = src + (size_t)jind[j] * nrows;
+		wcol = w + (size_t)j * numi;
+
+		if (icutoff > 0) {
+			xreg = _mm256_mask_i32gather_ps(zero, col, hindex, _mm256_castsi256_ps(mask), 4);
+			wreg = _mm256_maskload_ps(wcol, mask);
+			sreg = _mm256_fmadd_ps(xreg, wreg, sreg);
+		}
+
+		for (i = icutoff; i < numi; i += FLOAT_PER_M256_REG) {
+			vindex = _mm256_loadu_si256((const __m256i *)(iind + i));
+			xreg = _mm256_i32gather_ps(col, vindex, 4);
+			wreg = _mm256_loadu_ps(wcol + i);
+			sreg = _mm256_fmadd_ps(xreg, wreg, sreg);
+		}
+	}
+
+	return _mm256_register_sum_ps(sreg);
+}
+
+TARGET_AVX2
+double _mm256_sum2d_indexed_pd(const double *src, int nrows, const int *iind, const int *jind, int numi, int numj)
+{
+	const double *col;
+	__m256d zero = _mm256_set1_pd(0);
+	__m256d sreg = zero;
+	__m128i vindex, hindex;
+	__m256d dmask;
+	int i, j;
+	int icutoff = numi % DOUBLE_PER_M256_REG;
+
+	dmask = _mm256_castsi256_pd(_mm256_set_mask_epi64(icutoff - 1));
+	hindex = _mm_maskload_epi32(iind, _mm_set_mask_epi32(icutoff - 1));
+
+	for (j = 0; j < numj; j++) {
+		col = src + (size_t)jind[j] * nrows;
+
+		if (icutoff > 0) {
+			sreg = _mm256_add_pd(sreg, _mm256_mask_i32gather_pd(zero, col, hindex, dmask, 8));
+		}
+
+		for (i = icutoff; i < numi; i += DOUBLE_PER_M256_REG) {
+			vindex = _mm_loadu_si128((const __m128i *)(iind + i));
+			sreg = _mm256_add_pd(sreg, _mm256_i32gather_pd(col, vindex, 8));
+		}
+	}
+
+	return _mm256_register_sum_pd(sreg);
+}
+
+TARGET_AVX2
+double _mm256_dot2d_indexed_pd(const double *src, int nrows, const int *iind, const int *jind, int numi, int numj, const double *w)
+{
+	const double *col, *wcol;
+	__m256d xreg;
+	__m256d wreg;
+	__m256d zero = _mm256_set1_pd(0);
+	__m256d sreg = zero;
+	__m128i vindex, hindex;
+	__m256i mask;
+	int i, j;
+	int icutoff = numi % DOUBLE_PER_M256_REG;
+
+	mask = _mm256_set_mask_epi64(icutoff - 1);
+	hindex = _mm_maskload_epi32(iind, _mm_set_mask_epi32(icutoff - 1));
+
+	for (j = 0; j < numj; j++) {
+		col = src + (size_t)jind[j] * nrows;
+		wcol = w + (size_t)j * numi;
+
+		if (icutoff > 0) {
+			xreg = _mm256_mask_i32gather_pd(zero, col, hindex, _mm256_castsi256_pd(mask), 8);
+			wreg = _mm256_maskload_pd(wcol, mask);
+			sreg = _mm256_fmadd_pd(xreg, wreg, sreg);
+		}
+
+		for (i = icutoff; i < numi; i += DOUBLE_PER_M256_REG) {
+			vindex = _mm_loadu_si128((const __m128i *)(iind + i));
+			xreg = _mm256_i32gather_pd(col, vindex, 8);
+			wreg = _mm256_loadu_pd(wcol + i);
+			sreg = _mm256_fmadd_pd(xreg, wreg, sreg);
+		}
+	}
+
+	return _mm256_register_sum_pd(sreg);
+}
+
+#ifdef SUPPORTS_AVX512
+TARGET_AVX512
+float _mm512_sum2d_indexed_ps(const float *src, int nrows, const int *iind, const int *jind, int numi, int numj)
+{
+	const float *col;
+	__m512 zero = _mm512_set1_ps(0);
+	__m512 sreg = zero;
+	__m512i vindex, hindex;
+	__mmask16 mask;
+	int i, j;
+	int icutoff = numi % FLOAT_PER_M512_REG;
+
+	mask = _mm512_set_mask_epi32(icutoff - 1);
+	hindex = _mm512_maskz_loadu_epi32(mask, iind);
+
+	for (j = 0; j < numj; j++) {
+		col = src + (size_t)jind[j] * nrows;
+
+		if (icutoff > 0) {
+			sreg = _mm512_add_ps(sreg, _mm512_mask_i32gather_ps(zero, mask, hindex, col, 4));
+		}
+
+		for (i = icutoff; i < numi; i += FLOAT_PER_M512_REG) {
+			vindex = _mm512_loadu_si512(iind + i);
+			sreg = _mm512_add_ps(sreg, _mm512_i32gather_ps(vindex, col, 4));
+		}
+	}
+
+	return _mm512_register_sum_ps(sreg);
+}
+
+TARGET_AVX512
+float _mm512_dot2d_indexed_ps(const float *src, int nrows, const int *iind, const int *jind, int numi, int numj, const float *w)
+{
+	const float *col, *wcol;
+	__m512 xreg;
+	__m512 wreg;
+	__m512 zero = _mm512_set1_ps(0);
+	__m512 sreg = zero;
+	__m512i vindex, hindex;
+	__mmask16 mask;
+	int i, j;
+	int icutoff = numi % FLOAT_PER_M512_REG;
+
+	mask = _mm512_set_mask_epi32(icutoff - 1);
+	hindex = _mm512_maskz_loadu_epi32(mask, iind);
+
+	for (j = 0; j < numj; j++) {
+		col = src + (size_t)jind[j] * nrows;
+		wcol = w + (size_t)j * numi;
+
+		if (icutoff > 0) {
+			xreg = _mm512_mask_i32gather_ps(zero, mask, hindex, col, 4);
+			wreg = _mm512_maskz_loadu_ps(mask, wcol);
+			sreg = _mm512_fmadd_ps(xreg, wreg, sreg);
+		}
+
+		for (i = icutoff; i < numi; i += FLOAT_PER_M512_REG) {
+			vindex = _mm512_loadu_si512(iind + i);
+			xreg = _mm512_i32gather_ps(vindex, col, 4);
+			wreg = _mm512_loadu_ps(wcol + i);
+			sreg = _mm512_fmadd_ps(xreg, wreg, sreg);
+		}
+	}
+
+	return _mm512_register_sum_ps(sreg);
+}
+
+TARGET_AVX512
+double _mm512_sum2d_indexed_pd(const double *src, int nrows, const int *iind, const int *jind, int numi, int numj)
+{
+	const double *col;
+	__m512d zero = _mm512_set1_pd(0);
+	__m512d sreg = zero;
+	__m256i vindex, hindex;
+	__mmask8 mask;
+	int i, j;
+	int icutoff = numi % DOUBLE_PER_M512_REG;
+
+	mask = _mm512_set_mask_epi64(icutoff - 1);
+	hindex = _mm512_castsi512_si256(_mm512_maskz_loadu_epi32(mask, iind));
+
+	for (j = 0; j < numj; j++) {
+		col = src + (size_t)jind[j] * nrows;
+
+		if (icutoff > 0) {
+			sreg = _mm512_add_pd(sreg, _mm512_mask_i32gather_pd(zero, mask, hindex, col, 8));
+		}
+
+		for (i = icutoff; i < numi; i += DOUBLE_PER_M512_REG) {
+			vindex = _mm256_loadu_si256((const __m256i *)(iind + i));
+			sreg = _mm512_add_pd(sreg, _mm512_i32gather_pd(vindex, col, 8));
+		}
+	}
+
+	return _mm512_register_sum_pd(sreg);
+}
+
+TARGET_AVX512
+double _mm512_dot2d_indexed_pd(const double *src, int nrows, const int *iind, const int *jind, int numi, int numj, const double *w)
+{
+	const double *col, *wcol;
+	__m512d xreg;
+	__m512d wreg;
+	__m512d zero = _mm512_set1_pd(0);
+	__m512d sreg = zero;
+	__m256i vindex, hindex;
+	__mmask8 mask;
+	int i, j;
+	int icutoff = numi % DOUBLE_PER_M512_REG;
+
+	mask = _mm512_set_mask_epi64(icutoff - 1);
+	hindex = _mm512_castsi512_si256(_mm512_maskz_loadu_epi32(mask, iind));
+
+	for (j = 0; j < numj; j++) {
+		col = src + (size_t)jind[j] * nrows;
+		wcol = w + (size_t)j * numi;
+
+		if (icutoff > 0) {
+			xreg = _mm512_mask_i32gather_pd(zero, mask, hindex, col, 8);
+			wreg = _mm512_maskz_loadu_pd(mask, wcol);
+			sreg = _mm512_fmadd_pd(xreg, wreg, sreg);
+		}
+
+		for (i = icutoff; i < numi; i += DOUBLE_PER_M512_REG) {
+			vindex = _mm256_loadu_si256((const __m256i *)(iind + i));
+			xreg = _mm512_i32gather_pd(vindex, col, 8);
+			wreg = _mm512_loadu_pd(wcol + i);
+			sreg = _mm512_fmadd_pd(xreg, wreg, sreg);
+		}
+	}
+
+	return _mm512_register_sum_pd(sreg);
+}
+#endif
+
+//----------------------------------------------------------------------------
+// Functions for computing statistics of registers.
+//----------------------------------------------------------------------------
+
+TARGET_AVX2
+float _mm_register_min_ps(__m128 a)
+{
+    __m128 aswap = _mm_permute_ps(a, 0xb1); // Swap indices 1 and 0 as well as 3 and 2 -> 0b 10 11 00 01 = 0xb1
+    __m128 mreg = _mm_min_ps(a, aswap);
+
+    aswap = _mm_permute_ps(mreg, 0x4e); // Swap the two pairs -> 0b 01 00 11 10 = 0x4e
+    mreg = _mm_min_ps(mreg, aswap);
+
+	return _mm_cvtss_f32(mreg);
+}
+
+TARGET_AVX2
+float _mm256_register_min_ps(__m256 a)
+{	
+    // Cross-lane permutation indices needed for final swap.
+    __m256i idx = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+
+    // Perform the comparison two elements at a time across all lanes.
+
+    __m256 aswap = _mm256_permute_ps(a, 0xb1); // Swap indices 1 and 0 as well as 3 and 2 in each lane:
+                                               // 0b 10 11 00 01 = 0b (1011) (0001) = 0xb1
+    __m256 mreg = _mm256_min_ps(a, aswap); 
+
+    // After the first comparison, we now have four unique values in the
+    // minimum register mreg, with each unique value repeated every 64 bits.
+    // To move the comparison along, switch the middle two entires of each
+    // 128-bit lane, swap pairwise-adjacent elements as before, and compute
+    // the next minimum.
+
+    mreg = _mm256_permute_ps(mreg, 0xd8); // Swap indices 2 and 1 in each lane: 0b 11 01 10 00 = 0b (1101) (1000) = 0xd8
+    aswap = _mm256_permute_ps(mreg, 0xb1); // As before, swap indices 1 and 0 as well as 3 and 2 in each lane.  
+    mreg = _mm256_min_ps(mreg, aswap);
+
+    // After the second comparison, we now have two unique elements: The
+    // first is repeated four times in the first 128-bit lane, and the
+    // second value in the second lane. This necessitates permuting values
+    // across all lanes to interleave and compute the minimum value overall.
+    // After permuting, we swap elements at positions 1 and 2 in each lane as
+    // before, and compute the minimum.
+ 
+    mreg = _mm256_permutevar8x32_ps(mreg, idx);
+    aswap = _mm256_permute_ps(mreg, 0xb1);
+    mreg = _mm256_min_ps(mreg, aswap);
+
+	return _mm256_cvtss_f32(mreg);
+}
+
+TARGET_AVX2
+double _mm_register_min_pd(__m128d a)
+{
+	__m128d aswap = _mm_permute_pd(a, 0x1); // Swap positions 1 and 0: 0b 0 1 = 0b(01) = 0x1
+	__m128d mreg = _mm_min_pd(a, aswap);
+
+	return _mm_cvtsd_f64(mreg);
+}
+
+TARGET_AVX2
+double _mm256_register_min_pd(__m256d a)
+{
+    __m256d aswap = _mm256_permute_pd(a, 0x5); // Swap indices 1 and 0 in each lane ->
+                                               // 0b 01 01 = 0x5
+    __m256d mreg = _mm256_min_pd(a, aswap);
+
+    aswap = _mm256_permute4x64_pd(mreg, 0x4e); // Swap the two lanes ->
+                                               // 0b 01 00 11 10 = 0x4e
+    mreg = _mm256_min_pd(mreg, aswap);
+
+	return _mm256_cvtsd_f64(mreg);
+}
+
+// Maxima are minima of the negated register.
+TARGET_AVX2
+float _mm_register_max_ps(__m128 a)
+{
+	return -_mm_register_min_ps(_mm_xor_ps(a, _mm_set1_ps(-0.0f)));
+}
+
+TARGET_AVX2
+float _mm256_register_max_ps(__m256 a)
+{
+	return -_mm256_register_min_ps(_mm256_xor_ps(a, _mm256_set1_ps(-0.0f)));
+}
+
+TARGET_AVX2
+double _mm_register_max_pd(__m128d a)
+{
+	return -_mm_register_min_pd(_mm_xor_pd(a, _mm_set1_pd(-0.0)));
+}
+
+TARGET_AVX2
+double _mm256_register_max_pd(__m256d a)
+{
+	return -_mm256_register_min_pd(_mm256_xor_pd(a, _mm256_set1_pd(-0.0)));
+}
+#ifdef SUPPORTS_AVX512
+TARGET_AVX512
+float _mm512_register_min_ps(__m512 a)
+{
+    // Halve the number of candidates at each step: swap the 256-bit halves,
+    // then the 128-bit lanes within each half, then pairs and single
+    // elements within each lane.
+    __m512 mreg = _mm512_min_ps(a, _mm512_shuffle_f32x4(a, a, 0x4e)); // 0b 01 00 11 10 = 0x4e
+    mreg = _mm512_min_ps(mreg, _mm512_shuffle_f32x4(mreg, mreg, 0xb1)); // 0b 10 11 00 01 = 0xb1
+    mreg = _mm512_min_ps(mreg, _mm512_permute_ps(mreg, 0x4e));
+    mreg = _mm512_min_ps(mreg, _mm512_permute_ps(mreg, 0xb1));
+
+    return _mm512_cvtss_f32(mreg);
+}
+
+TARGET_AVX512
+double _mm512_register_min_pd(__m512d a)
+{
+    __m512d mreg = _mm512_min_pd(a, _mm512_shuffle_f64x2(a, a, 0x4e));
+    mreg = _mm512_min_pd(mreg, _mm512_shuffle_f64x2(mreg, mreg, 0xb1));
+    mreg = _mm512_min_pd(mreg, _mm512_permute_pd(mreg, 0x55)); // Swap the two elements of each lane: 0b 01 01 01 01 = 0x55
+
+    return _mm512_cvtsd_f64(mreg);
+}
+
+TARGET_AVX512
+float _mm512_register_max_ps(__m512 a)
+{
+    return -_mm512_register_min_ps(_mm512_xor_ps(a, _mm512_set1_ps(-0.0f)));
+}
+
+TARGET_AVX512
+double _mm512_register_max_pd(__m512d a)
+{
+    return -_mm512_register_min_pd(_mm512_xor_pd(a, _mm512_set1_pd(-0.0)));
+}
+#endif
+
+
+//----------------------------------------------------------------------------
+// Functions for permuting elements in registers.
+//----------------------------------------------------------------------------
+
+TARGET_AVX2
+__m256 _mm256_leftperm_ps(__m256 a, int nperms)
+{
+	__m256i lpidx = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+
+    nperms = nperms % FLOAT_PER_M256_REG;
+
+    switch (nperms) {
+        case 1:
+            lpidx = _mm256_setr_epi32(1, 2, 3, 4, 5, 6, 7, 0);
+            break;
+        case 2:
+            lpidx = _mm256_setr_epi32(2, 3, 4, 5, 6, 7, 0, 1);
+            break;
+        case 3:
+            lpidx = _mm256_setr_epi32(3, 4, 5, 6, 7, 0, 1, 2);
+            break;
+        case 4:
+            lpidx = _mm256_setr_epi32(4, 5, 6, 7, 0, 1, 2, 3);
+            break;
+        case 5:
+            lpidx = _mm256_setr_epi32(5, 6, 7, 0, 1, 2, 3, 4);
+            break;
+        case 6:
+            lpidx = _mm256_setr_epi32(6, 7, 0, 1, 2, 3, 4, 5);
+            break;
+        case 7:
+            lpidx = _mm256_setr_epi32(7, 0, 1, 2, 3, 4, 5, 6);
+
+    }
+
+	return _mm256_permutevar8x32_ps(a, lpidx);
+}
+
+TARGET_AVX2
+__m256 _mm256_rightperm_ps(__m256 a, int nperms)
+{
+    nperms = FLOAT_PER_M256_REG - (nperms % FLOAT_PER_M256_REG);
+
+    return _mm256_leftperm_ps(a, nperms);
+}
+
+TARGET_AVX2
+__m256d _mm256_leftperm_pd(__m256d a, int nperms)
+{
+    nperms = nperms % DOUBLE_PER_M256_REG;
+
+    switch (nperms) {
+        case 1:
+            a = _mm256_permute4x64_pd(a, M128_LPERM_TO_IMM8(1));
+            break;
+        case 2:
+            a = _mm256_permute4x64_pd(a, M128_LPERM_TO_IMM8(2));
+            break;
+        case 3:
+            a = _mm256_permute4x64_pd(a, M128_LPERM_TO_IMM8(3));
+    }
+
+	return a;
+}
+
+TARGET_AVX2
+__m256d _mm256_rightperm_pd(__m256d a, int nperms)
+{
+    nperms = nperms % DOUBLE_PER_M256_REG;
+
+    switch (nperms) {
+        case 1:
+            a = _mm256_permute4x64_pd(a, M128_RPERM_TO_IMM8(1));
+            break;
+        case 2:
+            a = _mm256_permute4x64_pd(a, M128_RPERM_TO_IMM8(2));
+            break;
+        case 3:
+            a = _mm256_permute4x64_pd(a, M128_RPERM_TO_IMM8(3));
+    }
+
+	return a;
+}
+
+TARGET_AVX2
+__m256i _mm256_leftperm_epi32(__m256i a, int nperms)
+{
+	__m256i lpidx = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+
+    nperms = nperms % INT32_PER_M256_REG;
+
+    switch (nperms) {
+        case 1:
+            lpidx = _mm256_setr_epi32(1, 2, 3, 4, 5, 6, 7, 0);
+            break;
+        case 2:
+            lpidx = _mm256_setr_epi32(2, 3, 4, 5, 6, 7, 0, 1);
+            break;
+        case 3:
+            lpidx = _mm256_setr_epi32(3, 4, 5, 6, 7, 0, 1, 2);
+            break;
+        case 4:
+            lpidx = _mm256_setr_epi32(4, 5, 6, 7, 0, 1, 2, 3);
+            break;
+        case 5:
+            lpidx = _mm256_setr_epi32(5, 6, 7, 0, 1, 2, 3, 4);
+            break;
+        case 6:
+            lpidx = _mm256_setr_epi32(6, 7, 0, 1, 2, 3, 4, 5);
+            break;
+        case 7:
+            lpidx = _mm256_setr_epi32(7, 0, 1, 2, 3, 4, 5, 6);
+
+    }
+
+	return _mm256_permutevar8x32_epi32(a, lpidx);
+}
+
+TARGET_AVX2
+__m256i _mm256_rightperm_epi32(__m256i a, int nperms)
+{
+    nperms = INT32_PER_M256_REG - (nperms % INT32_PER_M256_REG);
+
+    return _mm256_leftperm_epi32(a, nperms);
+}
+
+TARGET_AVX2
+__m256i _mm256_leftperm_epi64(__m256i a, int nperms)
+{
+    nperms = nperms % INT64_PER_M256_REG;
+
+    switch (nperms) {
+        case 1:
+            a = _mm256_permute4x64_epi64(a, M128_LPERM_TO_IMM8(1));
+            break;
+        case 2:
+            a = _mm256_permute4x64_epi64(a, M128_LPERM_TO_IMM8(2));
+            break;
+        case 3:
+            a = _mm256_permute4x64_epi64(a, M128_LPERM_TO_IMM8(3));
+    }
+
+    return a;
+}
+
+TARGET_AVX2
+__m256i _mm256_rightperm_epi64(__m256i a, int nperms)
+{
+    nperms = nperms % INT64_PER_M256_REG;
+
+    switch (nperms) {
+        case 1:
+            a = _mm256_permute4x64_epi64(a, M128_RPERM_TO_IMM8(1));
+            break;
+        case 2:
+            a = _mm256_permute4x64_epi64(a, M128_RPERM_TO_IMM8(2));
+            break;
+        case 3:
+            a = _mm256_permute4x64_epi64(a, M128_RPERM_TO_IMM8(3));
+    }
+
+    return a;
+}
+#ifdef SUPPORTS_AVX512
+// With a full cross-lane permute available, the rotation indices are
+// computed rather than picked from a table of immediates.
+TARGET_AVX512
+static inline __m512i lperm_idx_epi32(int nperms)
+{
+    __m512i idx = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+
+    idx = _mm512_add_epi32(idx, _mm512_set1_epi32(nperms % INT32_PER_M512_REG));
+
+    return _mm512_and_si512(idx, _mm512_set1_epi32(INT32_PER_M512_REG - 1));
+}
+
+TARGET_AVX512
+static inline __m512i lperm_idx_epi64(int nperms)
+{
+    __m512i idx = _mm512_setr_epi64(0, 1, 2, 3, 4, 5, 6, 7);
+
+    idx = _mm512_add_epi64(idx, _mm512_set1_epi64(nperms % INT64_PER_M512_REG));
+
+    return _mm512_and_si512(idx, _mm512_set1_epi64(INT64_PER_M512_REG - 1));
+}
+
+TARGET_AVX512
+__m512 _mm512_leftperm_ps(__m512 a, int nperms)
+{
+    return _mm512_permutexvar_ps(lperm_idx_epi32(nperms), a);
+}
+
+TARGET_AVX512
+__m512 _mm512_rightperm_ps(__m512 a, int nperms)
+{
+    nperms = FLOAT_PER_M512_REG - (nperms % FLOAT_PER_M512_REG);
+
+    return _mm512_leftperm_ps(a, nperms);
+}
+
+TARGET_AVX512
+__m512d _mm512_leftperm_pd(__m512d a, int nperms)
+{
+    return _mm512_permutexvar_pd(lperm_idx_epi64(nperms), a);
+}
+
+TARGET_AVX512
+__m512d _mm512_rightperm_pd(__m512d a, int nperms)
+{
+    nperms = DOUBLE_PER_M512_REG - (nperms % DOUBLE_PER_M512_REG);
+
+    return _mm512_leftperm_pd(a, nperms);
+}
+
+TARGET_AVX512
+__m512i _mm512_leftperm_epi32(__m512i a, int nperms)
+{
+    return _mm512_permutexvar_epi32(lperm_idx_epi32(nperms), a);
+}
+
+TARGET_AVX512
+__m512i _mm512_rightperm_epi32(__m512i a, int nperms)
+{
+    nperms = INT32_PER_M512_REG - (nperms % INT32_PER_M512_REG);
+
+    return _mm512_leftperm_epi32(a, nperms);
+}
+
+TARGET_AVX512
+__m512i _mm512_leftperm_epi64(__m512i a, int nperms)
+{
+    return _mm512_permutexvar_epi64(lperm_idx_epi64(nperms), a);
+}
+
+TARGET_AVX512
+__m512i _mm512_rightperm_epi64(__m512i a, int nperms)
+{
+    nperms = INT64_PER_M512_REG - (nperms % INT64_PER_M512_REG);
+
+    return _mm512_leftperm_epi64(a, nperms);
+}
+#endif
+
+
+//----------------------------------------------------------------------------
+// Helper routines for copying data.
+//----------------------------------------------------------------------------
+
+void _mm_copy1d_epi32(int *dst, const int *src, int n)
+{
+	int i;
+	int cutoff = n % INT32_PER_M128_REG;
+	__m128i sreg;
+
+	for (i = 0; i < cutoff; i++) {
+		dst[i] = src[i];
+	}
+
+	for (i = cutoff; i < n; i += INT32_PER_M128_REG) {
+		sreg = _mm_loadu_si128((const __m128i *)(src + i));
+		_mm_storeu_si128((__m128i *)(dst + i), sreg);
+	}
+}
+
+void _mm_copy2d_epi32_ld(char order, int *kind, int ldk, int ld, const int *iind, const int *jind, int numi, int numj)
+{
+	const int *pos, *lines;
+	int i, j, i0, i1, j0, j1, ti, tj, jdidx, jsidx;
+	int icutoff, npos, nlines;
+	int split = copy2d_strategy == COPY2D_SPLIT;
+	__m128i jreg, kreg;
+
+	if (copy2d_lines(order, iind, jind, numi, numj, &pos, &lines, &npos, &nlines) != 0) {
+		return;
+	}
+
+	icutoff = npos % INT32_PER_M128_REG;
+
+	copy2d_tile(npos, nlines, sizeof(int), &ti, &tj);
+
+	if (split) {
+		for (j = 0; j < nlines; j++) {
+			for (i = 0; i < icutoff; i++) {
+				kind[j * ldk + i] = pos[i] + lines[j] * ld;
+			}
+		}
+	}
+
+	for (j0 = 0; j0 < nlines; j0 = j1) {
+		j1 = j0 + tj < nlines ? j0 + tj : nlines;
+
+		for (i0 = 0; i0 < npos; i0 = i1) {
+			i1 = (int)copy2d_tile_end(i0, icutoff, ti, npos);
+
+			for (j = j0; j < j1; j++) {
+				jdidx = j * ldk;
+				jsidx = lines[j] * ld;
+				jreg = _mm_set1_epi32(jsidx);
+
+				if (i0 == 0 && !split) {
+					for (i = 0; i < icutoff; i++) {
+						kind[jdidx + i] = pos[i] + jsidx;
+					}
+				}
+
+				for (i = i0 > icutoff ? i0 : icutoff; i < i1; i += INT32_PER_M128_REG) {
+					kreg = _mm_loadu_si128((const __m128i *)(pos + i));
+					kreg = _mm_add_epi32(kreg, jreg);
+					_mm_storeu_si128((__m128i *)(kind + jdidx + i), kreg);
+				}
+			}
+		}
+	}
+}
+
+void _mm_copy2d_epi32(int *kind, int nrows, const int *iind, const int *jind, int numi, int numj)
+{
+	_mm_copy2d_epi32_ld(COLUMN_MAJOR_ORDER, kind, numi, nrows, iind, jind, numi, numj);
+}
+
+void _mm_copy1d_ps(float *dst, const float *src, int n)
+{
+	int i;
+	int cutoff = n % FLOAT_PER_M128_REG;
+	__m128 sreg;
+
+	for (i = 0; i < cutoff; i++) {
+		dst[i] = src[i];
+	}
+
+	for (i = cutoff; i < n; i += FLOAT_PER_M128_REG) {
+		sreg = _mm_loadu_ps(src + i);
+		_mm_storeu_ps(dst + i, sreg);
+	}
+}
+
+void _mm_copy2d_indexed_ps_ld(char order, float *dst, int lddst, const float *src, int ldsrc, const int *iind, const int *jind, int numi, int numj)
+{
+	const int *pos, *lines;
+	int i, j, i0, i1, j0, j1, ti, tj, jdidx;
+	int icutoff, npos, nlines;
+	int split = copy2d_strategy == COPY2D_SPLIT;
+	const float *line;
+	__m128 sreg;
+
+	if (copy2d_lines(order, iind, jind, numi, numj, &pos, &lines, &npos, &nlines) != 0) {
+		return;
+	}
+
+	icutoff = npos % FLOAT_PER_M128_REG;
+
+	copy2d_tile(npos, nlines, sizeof(int), &ti, &tj);
+
+	if (split) {
+		for (j = 0; j < nlines; j++) {
+			line = src + (size_t)lines[j] * ldsrc;
+
+			for (i = 0; i < icutoff; i++) {
+				dst[j * lddst + i] = line[pos[i]];
+			}
+		}
+	}
+
+	for (j0 = 0; j0 < nlines; j0 = j1) {
+		j1 = j0 + tj < nlines ? j0 + tj : nlines;
+
+		for (i0 = 0; i0 < npos; i0 = i1) {
+			i1 = (int)copy2d_tile_end(i0, icutoff, ti, npos);
+
+			for (j = j0; j < j1; j++) {
+				jdidx = j * lddst;
+				line = src + (size_t)lines[j] * ldsrc;
+
+				if (i0 == 0 && !split) {
+					for (i = 0; i < icutoff; i++) {
+						dst[jdidx + i] = line[pos[i]];
+					}
+				}
+
+				for (i = i0 > icutoff ? i0 : icutoff; i < i1; i += FLOAT_PER_M128_REG) {
+					sreg = gather_ps(line, pos + i);
+					_mm_storeu_ps(dst + jdidx + i, sreg);
+				}
+			}
+		}
+	}
+}
+
+void _mm_copy2d_indexed_ps(float *dst, const float *src, int nrows, const int *iind, const int *jind, int numi, int numj)
+{
+	_mm_copy2d_indexed_ps_ld(COLUMN_MAJOR_ORDER, dst, numi, src, nrows, iind, jind, numi, numj);
+}
+
+TARGET_AVX2
+void _mm256_copy1d_epi32(int *dst, const int *src, int n)
+{
+	int i;
+	int cutoff = n % INT32_PER_M256_REG;
+	__m256i mask;
+	__m256i sreg, dreg;
+
+	if (use_stream(dst, (size_t)n * sizeof(int), sizeof(int))) {
+		stream_copy1d_epi32_256(dst, src, n);
+		return;
+	}
+
+	if (cutoff > 0) {
+		mask = _mm256_set_mask_epi32(cutoff - 1);
+
+		sreg = _mm256_maskload_epi32(src, mask);
+		_mm256_maskstore_epi32(dst, mask, sreg);
+	}
+
+	for (i = cutoff; i < n; i += INT32_PER_M256_REG) {
+		sreg = _mm256_loadu_si256((const __m256i *)(src + i));
+		_mm256_storeu_si256((__m256i *)(dst + i), sreg);
+	}
+}
+
+TARGET_AVX2
+void _mm256_copy2d_epi32_ld(char order, int *kind, int ldk, int ld, const int *iind, const int *jind, int numi, int numj)
+{
+	const int *pos, *lines;
+	int i, j, i0, i1, j0, j1, ti, tj, jdidx, jsidx;
+	int icutoff, npos, nlines;
+	int split = copy2d_strategy == COPY2D_SPLIT;
+	__m256i jreg, kreg;
+	__m256i mask;
+
+	if (copy2d_lines(order, iind, jind, numi, numj, &pos, &lines, &npos, &nlines) != 0) {
+		return;
+	}
+
+	icutoff = npos % INT32_PER_M256_REG;
+	mask = _mm256_set_mask_epi32(icutoff - 1);
+
+	copy2d_tile(npos, nlines, sizeof(int), &ti, &tj);
+
+	if (split && icutoff > 0) {
+		for (j = 0; j < nlines; j++) {
+			jreg = _mm256_set1_epi32(lines[j] * ld);
+			kreg = _mm256_maskload_epi32(pos, mask);
+			kreg = _mm256_add_epi32(kreg, jreg);
+			_mm256_maskstore_epi32(kind + j * ldk, mask, kreg);
+		}
+	}
+
+	for (j0 = 0; j0 < nlines; j0 = j1) {
+		j1 = j0 + tj < nlines ? j0 + tj : nlines;
+
+		for (i0 = 0; i0 < npos; i0 = i1) {
+			i1 = (int)copy2d_tile_end(i0, icutoff, ti, npos);
+
+			for (j = j0; j < j1; j++) {
+				jdidx = j * ldk;
+				jsidx = lines[j] * ld;
+				jreg = _mm256_set1_epi32(jsidx);
+
+				if (i0 == 0 && icutoff > 0 && !split) {
+					kreg = _mm256_maskload_epi32(pos, mask);
+					kreg = _mm256_add_epi32(kreg, jreg);
+					_mm256_maskstore_epi32(kind + jdidx, mask, kreg);
+				}
+
+				for (i = i0 > icutoff ? i0 : icutoff; i < i1; i += INT32_PER_M256_REG) {
+					kreg = _mm256_loadu_si256((const __m256i *)(pos + i));
+					kreg = _mm256_add_epi32(kreg, jreg);
+					_mm256_storeu_si256((__m256i *)(kind + jdidx + i), kreg);
+				}
+			}
+		}
+	}
+}
+
+TARGET_AVX2
+void _mm256_copy2d_epi32(int *kind, int nrows, const int *iind, const int *jind, int numi, int numj)
+{
+	_mm256_copy2d_epi32_ld(COLUMN_MAJOR_ORDER, kind, numi, nrows, iind, jind, numi, numj);
+}
+
+
+TARGET_AVX2
+void _mm256_copy1d_ps(float *dst, const float *src, int n)
+{
+	int i;
+	int cutoff = n % FLOAT_PER_M256_REG;
+	__m256i mask;
+	__m256 sreg, dreg;
+
+	if (use_stream(dst, (size_t)n * sizeof(float), sizeof(float))) {
+		stream_copy1d_ps256(dst, src, n);
+		return;
+	}
+
+	if (cutoff > 0) {
+		mask = _mm256_set_mask_epi32(cutoff - 1);
+
+		sreg = _mm256_maskload_ps(src, mask);
+		_mm256_maskstore_ps(dst, mask, sreg);
+	}
+
+	for (i = cutoff; i < n; i += FLOAT_PER_M256_REG) {
+		sreg = _mm256_loadu_ps(src + i);
+		_mm256_storeu_ps(dst + i, sreg);
+	}
+}
+
+TARGET_AVX2
+void _mm256_copy2d_indexed_ps_ld(char order, float *dst, int lddst, const float *src, int ldsrc, const int *iind, const int *jind, int numi, int numj)
+{
+	const int *pos, *lines;
+	int i, j, i0, i1, j0, j1, ti, tj, jdidx;
+	int icutoff, npos, nlines;
+	int split = copy2d_strategy == COPY2D_SPLIT;
+	const float *line;
+	__m256i ireg;
+	__m256i mask;
+	__m256 sreg;
+	__m256 zero = _mm256_set1_ps(0);
 
-	vlo = _mm256_hadd_pd(vlo, vlo);
-	vhi = _mm256_hadd_pd(vhi, vhi);
+	if (copy2d_lines(order, iind, jind, numi, numj, &pos, &lines, &npos, &nlines) != 0) {
+		return;
+	}
 
-    // Swap positions 1 and 2: 0xd8 = 0b 1101 1000 = 0b 11 01 10 00
-	vlo = _mm256_permute4x64_pd(vlo, 0xd8);
-	vhi = _mm256_permute4x64_pd(vhi, 0xd8);
+	icutoff = npos % FLOAT_PER_M256_REG;
+	mask = _mm256_set_mask_epi32(icutoff - 1);
 
-    vlo = _mm256_hadd_pd(vlo, vlo);
-    vhi = _mm256_hadd_pd(vhi, vhi);
+	// The gathers are taken relative to the start of each line, so the line
+	// offset is computed in 64 bits and only the positions need to fit in
+	// the 32-bit gather lanes.
+	copy2d_tile(npos, nlines, sizeof(int), &ti, &tj);
 
-    return _mm256_cvtsd_f64(vlo) + _mm256_cvtsd_f64(vhi); 
+	if (split && icutoff > 0) {
+		for (j = 0; j < nlines; j++) {
+			line = src + (size_t)lines[j] * ldsrc;
+			ireg = _mm256_maskload_epi32(pos, mask);
+			sreg = _mm256_mask_i32gather_ps(zero, line, ireg, _mm256_castsi256_ps(mask), 4);
+			_mm256_maskstore_ps(dst + j * lddst, mask, sreg);
+		}
+	}
+
+	for (j0 = 0; j0 < nlines; j0 = j1) {
+		j1 = j0 + tj < nlines ? j0 + tj : nlines;
+
+		for (i0 = 0; i0 < npos; i0 = i1) {
+			i1 = (int)copy2d_tile_end(i0, icutoff, ti, npos);
+
+			for (j = j0; j < j1; j++) {
+				jdidx = j * lddst;
+				line = src + (size_t)lines[j] * ldsrc;
+
+				if (i0 == 0 && icutoff > 0 && !split) {
+					ireg = _mm256_maskload_epi32(pos, mask);
+					sreg = _mm256_mask_i32gather_ps(zero, line, ireg, _mm256_castsi256_ps(mask), 4);
+					_mm256_maskstore_ps(dst + jdidx, mask, sreg);
+				}
+
+				for (i = i0 > icutoff ? i0 : icutoff; i < i1; i += FLOAT_PER_M256_REG) {
+					ireg = _mm256_loadu_si256((const __m256i *)(pos + i));
+					sreg = _mm256_i32gather_ps(line, ireg, 4);
+					_mm256_storeu_ps(dst + jdidx + i, sreg);
+				}
+			}
+		}
+	}
 }
 
-int _mm512_count_nonzero_ps(__m512 vreg)
+TARGET_AVX2
+void _mm256_copy2d_indexed_ps(float *dst, const float *src, int nrows, const int *iind, const int *jind, int numi, int numj)
 {
-    __m256 vlo = _mm512_extractf32x8_ps(vreg, 0);
-    __m256 vhi = _mm512_extractf32x8_ps(vreg, 1);
-	int clo = _mm256_movemask_ps(vlo);
-	int chi = _mm256_movemask_ps(vhi);
+	_mm256_copy2d_indexed_ps_ld(COLUMN_MAJOR_ORDER, dst, numi, src, nrows, iind, jind, numi, numj);
+}
+#ifdef SUPPORTS_AVX512
+TARGET_AVX512
+void _mm512_copy1d_epi32(int *dst, const int *src, int n)
+{
+	int i;
+	int cutoff = n % INT32_PER_M512_REG;
+	__mmask16 mask;
+	__m512i sreg;
 
-    return _popcnt32(clo) + _popcnt32(chi);
+	if (use_stream(dst, (size_t)n * sizeof(int), sizeof(int))) {
+		stream_copy1d_epi32_512(dst, src, n);
+		return;
+	}
+
+	if (cutoff > 0) {
+		mask = _mm512_set_mask_epi32(cutoff - 1);
+
+		sreg = _mm512_maskz_loadu_epi32(mask, src);
+		_mm512_mask_storeu_epi32(dst, mask, sreg);
+	}
+
+	for (i = cutoff; i < n; i += INT32_PER_M512_REG) {
+		sreg = _mm512_loadu_si512(src + i);
+		_mm512_storeu_si512(dst + i, sreg);
+	}
 }
 
-int _mm512_count_nonzero_pd(__m512d vreg)
+TARGET_AVX512
+void _mm512_copy2d_epi32_ld(char order, int *kind, int ldk, int ld, const int *iind, const int *jind, int numi, int numj)
 {
-    __m256d vlo = _mm512_extractf64x4_pd(vreg, 0);
-    __m256d vhi = _mm512_extractf64x4_pd(vreg, 1);
-	int clo = _mm256_movemask_pd(vlo);
-	int chi = _mm256_movemask_pd(vhi);
+	const int *pos, *lines;
+	int i, j, i0, i1, j0, j1, ti, tj, jdidx, jsidx;
+	int icutoff, npos, nlines;
+	int split = copy2d_strategy == COPY2D_SPLIT;
+	__m512i jreg, kreg;
+	__mmask16 mask;
 
-    return _popcnt32(clo) + _popcnt32(chi);
+	if (copy2d_lines(order, iind, jind, numi, numj, &pos, &lines, &npos, &nlines) != 0) {
+		return;
+	}
+
+	icutoff = npos % INT32_PER_M512_REG;
+	mask = _mm512_set_mask_epi32(icutoff - 1);
+
+	copy2d_tile(npos, nlines, sizeof(int), &ti, &tj);
+
+	if (split && icutoff > 0) {
+		for (j = 0; j < nlines; j++) {
+			jreg = _mm512_set1_epi32(lines[j] * ld);
+			kreg = _mm512_maskz_loadu_epi32(mask, pos);
+			kreg = _mm512_add_epi32(kreg, jreg);
+			_mm512_mask_storeu_epi32(kind + j * ldk, mask, kreg);
+		}
+	}
+
+	for (j0 = 0; j0 < nlines; j0 = j1) {
+		j1 = j0 + tj < nlines ? j0 + tj : nlines;
+
+		for (i0 = 0; i0 < npos; i0 = i1) {
+			i1 = (int)copy2d_tile_end(i0, icutoff, ti, npos);
+
+			for (j = j0; j < j1; j++) {
+				jdidx = j * ldk;
+				jsidx = lines[j] * ld;
+				jreg = _mm512_set1_epi32(jsidx);
+
+				if (i0 == 0 && icutoff > 0 && !split) {
+					kreg = _mm512_maskz_loadu_epi32(mask, pos);
+					kreg = _mm512_add_epi32(kreg, jreg);
+					_mm512_mask_storeu_epi32(kind + jdidx, mask, kreg);
+				}
+
+				for (i = i0 > icutoff ? i0 : icutoff; i < i1; i += INT32_PER_M512_REG) {
+					kreg = _mm512_loadu_si512(pos + i);
+					kreg = _mm512_add_epi32(kreg, jreg);
+					_mm512_storeu_si512(kind + jdidx + i, kreg);
+				}
+			}
+		}
+	}
+}
+
+TARGET_AVX512
+void _mm512_copy2d_epi32(int *kind, int nrows, const int *iind, const int *jind, int numi, int numj)
+{
+	_mm512_copy2d_epi32_ld(COLUMN_MAJOR_ORDER, kind, numi, nrows, iind, jind, numi, numj);
+}
+
+TARGET_AVX512
+void _mm512_copy1d_ps(float *dst, const float *src, int n)
+{
+	int i;
+	int cutoff = n % FLOAT_PER_M512_REG;
+	__mmask16 mask;
+	__m512 sreg;
+
+	if (use_stream(dst, (size_t)n * sizeof(float), sizeof(float))) {
+		stream_copy1d_ps512(dst, src, n);
+		return;
+	}
+
+	if (cutoff > 0) {
+		mask = _mm512_set_mask_epi32(cutoff - 1);
+
+		sreg = _mm512_maskz_loadu_ps(mask, src);
+		_mm512_mask_storeu_ps(dst, mask, sreg);
+	}
+
+	for (i = cutoff; i < n; i += FLOAT_PER_M512_REG) {
+		sreg = _mm512_loadu_ps(src + i);
+		_mm512_storeu_ps(dst + i, sreg);
+	}
+}
+
+TARGET_AVX512
+void _mm512_copy2d_indexed_ps_ld(char order, float *dst, int lddst, const float *src, int ldsrc, const int *iind, const int *jind, int numi, int numj)
+{
+	const int *pos, *lines;
+	int i, j, i0, i1, j0, j1, ti, tj, jdidx;
+	int icutoff, npos, nlines;
+	int split = copy2d_strategy == COPY2D_SPLIT;
+	const float *line;
+	__m512i ireg;
+	__mmask16 mask;
+	__m512 sreg;
+	__m512 zero = _mm512_set1_ps(0);
+
+	if (copy2d_lines(order, iind, jind, numi, numj, &pos, &lines, &npos, &nlines) != 0) {
+		return;
+	}
+
+	icutoff = npos % FLOAT_PER_M512_REG;
+	mask = _mm512_set_mask_epi32(icutoff - 1);
+
+	// As in the AVX2 kernel, gathers are relative to the start of each line.
+	copy2d_tile(npos, nlines, sizeof(int), &ti, &tj);
+
+	if (split && icutoff > 0) {
+		for (j = 0; j < nlines; j++) {
+			line = src + (size_t)lines[j] * ldsrc;
+			ireg = _mm512_maskz_loadu_epi32(mask, pos);
+			sreg = _mm512_mask_i32gather_ps(zero, mask, ireg, line, 4);
+			_mm512_mask_storeu_ps(dst + j * lddst, mask, sreg);
+		}
+	}
+
+	for (j0 = 0; j0 < nlines; j0 = j1) {
+		j1 = j0 + tj < nlines ? j0 + tj : nlines;
+
+		for (i0 = 0; i0 < npos; i0 = i1) {
+			i1 = (int)copy2d_tile_end(i0, icutoff, ti, npos);
+
+			for (j = j0; j < j1; j++) {
+				jdidx = j * lddst;
+				line = src + (size_t)lines[j] * ldsrc;
+
+				if (i0 == 0 && icutoff > 0 && !split) {
+					ireg = _mm512_maskz_loadu_epi32(mask, pos);
+					sreg = _mm512_mask_i32gather_ps(zero, mask, ireg, line, 4);
+					_mm512_mask_storeu_ps(dst + jdidx, mask, sreg);
+				}
+
+				for (i = i0 > icutoff ? i0 : icutoff; i < i1; i += FLOAT_PER_M512_REG) {
+					ireg = _mm512_loadu_si512(pos + i);
+					sreg = _mm512_i32gather_ps(ireg, line, 4);
+					_mm512_storeu_ps(dst + jdidx + i, sreg);
+				}
+			}
+		}
+	}
+}
+
+TARGET_AVX512
+void _mm512_copy2d_indexed_ps(float *dst, const float *src, int nrows, const int *iind, const int *jind, int numi, int numj)
+{
+	_mm512_copy2d_indexed_ps_ld(COLUMN_MAJOR_ORDER, dst, numi, src, nrows, iind, jind, numi, numj);
 }
 #endif
 
+
 //----------------------------------------------------------------------------
-// Functions for computing statistics of registers.
+// Functions taking 64-bit lengths and indices, for buffers with more than
+// 2^31 elements. Contiguous kernels hand the array to the int kernels in
+// chunks; indexed kernels gather with int64_t indices.
 //----------------------------------------------------------------------------
 
-float _mm_register_min_ps(__m128 a)
+// Chunks are a whole number of registers of every width, so only the last
+// one passed to an int kernel has a masked tail.
+#define INT32_CHUNK_LEN ((size_t)1 << 30)
+
+TARGET_AVX2
+static inline __m256 gather64_ps(const float *x, const int64_t *indices)
 {
-    __m128 aswap = _mm_permute_ps(a, 0x11); // Swap indices 1 and 0 in each lane -> 0b 00 01 00 01 = 0b (0001) (0001) = 0x11
-    __m128 mreg = _mm_min_ps(a, aswap); 
+	__m128 lo = _mm256_i64gather_ps(x, _mm256_loadu_si256((const __m256i *)indices), 4);
+	__m128 hi = _mm256_i64gather_ps(x, _mm256_loadu_si256((const __m256i *)(indices + 4)), 4);
 
-    aswap = _mm_permute_ps(mreg, 0xd8); // Swap indices 1 and 2 -> 0b 11 01 10 00 = 0b (1101) (1000) = 0xd8
-    mreg = _mm_min_ps(a, aswap);
+	return _mm256_set_m128(hi, lo);
+}
 
-	return _mm_cvtss_f32(mreg);
+// Gather the lanes set in a 32-bit mask, widening the mask halves to cover
+// the 64-bit indices.
+TARGET_AVX2
+static inline __m256 mask_gather64_ps(const float *x, const int64_t *indices, __m256i mask)
+{
+	__m128 zero = _mm_set1_ps(0);
+	__m128i mlo = _mm256_castsi256_si128(mask);
+	__m128i mhi = _mm256_extracti128_si256(mask, 1);
+	__m256i ilo = _mm256_maskload_epi64((const long long *)indices, _mm256_cvtepi32_epi64(mlo));
+	__m256i ihi = _mm256_maskload_epi64((const long long *)(indices + 4), _mm256_cvtepi32_epi64(mhi));
+	__m128 lo = _mm256_mask_i64gather_ps(zero, x, ilo, _mm_castsi128_ps(mlo), 4);
+	__m128 hi = _mm256_mask_i64gather_ps(zero, x, ihi, _mm_castsi128_ps(mhi), 4);
+
+	return _mm256_set_m128(hi, lo);
 }
 
-float _mm256_register_min_ps(__m256 a)
-{	
-    // Cross-lane permutation indices needed for final swap.
-    __m256i idx = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+TARGET_AVX2
+void _mm256_sset_value_64(float *x, size_t n, float value)
+{
+	size_t i;
 
-    // Perform the comparison two elements at a time across all lanes.
+	for (i = 0; i + INT32_CHUNK_LEN < n; i += INT32_CHUNK_LEN) {
+		_mm256_sset_value(x + i, INT32_CHUNK_LEN, value);
+	}
 
-    __m256 aswap = _mm256_permute_ps(a, 0xb1); // Swap indices 1 and 0 as well as 3 and 2 in each lane:
-                                               // 0b 10 11 00 01 = 0b (1011) (0001) = 0xb1
-    __m256 mreg = _mm256_min_ps(a, aswap); 
+	_mm256_sset_value(x + i, (int)(n - i), value);
+}
 
-    // After the first comparison, we now have four unique values in the
-    // minimum register mreg, with each unique value repeated every 64 bits.
-    // To move the comparison along, switch the middle two entires of each
-    // 128-bit lane, swap pairwise-adjacent elements as before, and compute
-    // the next minimum.
+TARGET_AVX2
+void _mm256_dset_value_64(double *x, size_t n, double value)
+{
+	size_t i;
 
-    mreg = _mm256_permute_ps(mreg, 0xd8); // Swap indices 2 and 1 in each lane: 0b 11 01 10 00 = 0b (1101) (1000) = 0xd8
-    aswap = _mm256_permute_ps(mreg, 0xb1); // As before, swap indices 1 and 0 as well as 3 and 2 in each lane.  
-    mreg = _mm256_min_ps(mreg, aswap);
+	for (i = 0; i + INT32_CHUNK_LEN < n; i += INT32_CHUNK_LEN) {
+		_mm256_dset_value(x + i, INT32_CHUNK_LEN, value);
+	}
 
-    // After the second comparison, we now have two unique elements: The
-    // first is repeated four times in the first 128-bit lane, and the
-    // second value in the second lane. This necessitates permuting values
-    // across all lanes to interleave and compute the minimum value overall.
-    // After permuting, we swap elements at positions 1 and 2 in each lane as
-    // before, and compute the minimum.
- 
-    mreg = _mm256_permutevar8x32_ps(mreg, idx);
-    aswap = _mm256_permute_ps(mreg, 0xb1);
-    mreg = _mm256_min_ps(mreg, aswap);
+	_mm256_dset_value(x + i, (int)(n - i), value);
+}
 
-	return _mm256_cvtss_f32(mreg);
+TARGET_AVX2
+float _mm256_fdot_64(const float *x, const float *y, size_t n)
+{
+	double sum = 0;
+	size_t i;
+
+	for (i = 0; i + INT32_CHUNK_LEN < n; i += INT32_CHUNK_LEN) {
+		sum += _mm256_fdot(x + i, y + i, INT32_CHUNK_LEN);
+	}
+
+	return (float)(sum + _mm256_fdot(x + i, y + i, (int)(n - i)));
 }
 
-double _mm_register_min_pd(__m128d a)
+TARGET_AVX2
+float _mm256_fdot_indexed_64(const float *x, const int64_t *xindices, const float *y, size_t n)
 {
-	__m128d aswap = _mm_permute_pd(a, 0x1); // Swap positions 1 and 0: 0b 0 1 = 0b(01) = 0x1
-	__m128d mreg = _mm_min_pd(a, aswap);
+	__m256 xreg;
+	__m256 yreg;
+	__m256 preg;
+	__m256 sreg = _mm256_set1_ps(0);
+	__m256i mask;
+	size_t i;
+	size_t cutoff = n % FLOAT_PER_M256_REG;
 
-	return _mm_cvtsd_f64(mreg);
+	if (cutoff > 0) {
+		mask = _mm256_set_mask_epi32(cutoff - 1);
+		yreg = _mm256_maskload_ps(y, mask);
+		xreg = mask_gather64_ps(x, xindices, mask);
+
+		preg = _mm256_mul_ps(xreg, yreg);
+		sreg = _mm256_add_ps(sreg, preg);
+	}
+
+	for (i = cutoff; i < n; i += FLOAT_PER_M256_REG) {
+		yreg = _mm256_loadu_ps(y + i);
+		xreg = gather64_ps(x, xindices + i);
+
+		preg = _mm256_mul_ps(xreg, yreg);
+		sreg = _mm256_add_ps(sreg, preg);
+	}
+
+	return _mm256_register_sum_ps(sreg);
 }
 
-double _mm256_register_min_pd(__m256d a)
+TARGET_AVX2
+float _mm256_fdot_indexed2_64(const float *x, const int64_t *xindices, const float *y, const int64_t *yindices, size_t n)
 {
-    __m256d aswap = _mm256_permute_pd(a, 0x11); // Swap indices 1 and 0 in each lane ->
-                                                // 0b 00 01 00 01 = 0b (0001) (0001) = 0x11
-    __m256d mreg = _mm256_min_pd(a, aswap); 
+	__m256 xreg;
+	__m256 yreg;
+	__m256 preg;
+	__m256 sreg = _mm256_set1_ps(0);
+	__m256i mask;
+	size_t i;
+	size_t cutoff = n % FLOAT_PER_M256_REG;
 
-    aswap = _mm256_permute4x64_pd(mreg, 0xd8); // Swap indices 1 and 2 across lanes ->
-                                               // 0b 11 01 10 00 = 0b (1101) (1000) = 0xd8
-    mreg = _mm256_min_pd(a, aswap);
+	if (cutoff > 0) {
+		mask = _mm256_set_mask_epi32(cutoff - 1);
+		xreg = mask_gather64_ps(x, xindices, mask);
+		yreg = mask_gather64_ps(y, yindices, mask);
 
-	return _mm256_cvtsd_f64(mreg);
+		preg = _mm256_mul_ps(xreg, yreg);
+		sreg = _mm256_add_ps(sreg, preg);
+	}
+
+	for (i = cutoff; i < n; i += FLOAT_PER_M256_REG) {
+		xreg = gather64_ps(x, xindices + i);
+		yreg = gather64_ps(y, yindices + i);
+
+		preg = _mm256_mul_ps(xreg, yreg);
+		sreg = _mm256_add_ps(sreg, preg);
+	}
+
+	return _mm256_register_sum_ps(sreg);
 }
 
-//----------------------------------------------------------------------------
-// Functions for permuting elements in registers.
-//----------------------------------------------------------------------------
+TARGET_AVX2
+double _mm256_ddot_64(const double *x, const double *y, size_t n)
+{
+	double sum = 0;
+	size_t i;
 
-__m256 _mm256_leftperm_ps(__m256 a, int nperms)
+	for (i = 0; i + INT32_CHUNK_LEN < n; i += INT32_CHUNK_LEN) {
+		sum += _mm256_ddot(x + i, y + i, INT32_CHUNK_LEN);
+	}
+
+	return sum + _mm256_ddot(x + i, y + i, (int)(n - i));
+}
+
+TARGET_AVX2
+double _mm256_ddot_indexed_64(const double *x, const int64_t *xindices, const double *y, size_t n)
 {
-	__m256i lpidx = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+	__m256d xreg;
+	__m256d yreg;
+	__m256d preg;
+	__m256d sreg = _mm256_set1_pd(0);
+	__m256i vindex;
+	__m256i mask;
+	size_t i;
+	size_t cutoff = n % DOUBLE_PER_M256_REG;
 
-    nperms = nperms % FLOAT_PER_M256_REG;
+	if (cutoff > 0) {
+		mask = _mm256_set_mask_epi64(cutoff - 1);
+		vindex = _mm256_maskload_epi64((const long long *)xindices, mask);
+		yreg = _mm256_maskload_pd(y, mask);
+		xreg = _mm256_mask_i64gather_pd(sreg, x, vindex, _mm256_castsi256_pd(mask), 8);
 
-    switch (nperms) {
-        case 1:
-            lpidx = _mm256_setr_epi32(1, 2, 3, 4, 5, 6, 7, 0);
-            break;
-        case 2:
-            lpidx = _mm256_setr_epi32(2, 3, 4, 5, 6, 7, 0, 1);
-            break;
-        case 3:
-            lpidx = _mm256_setr_epi32(3, 4, 5, 6, 7, 0, 1, 2);
-            break;
-        case 4:
-            lpidx = _mm256_setr_epi32(4, 5, 6, 7, 0, 1, 2, 3);
-            break;
-        case 5:
-            lpidx = _mm256_setr_epi32(5, 6, 7, 0, 1, 2, 3, 4);
-            break;
-        case 6:
-            lpidx = _mm256_setr_epi32(6, 7, 0, 1, 2, 3, 4, 5);
-            break;
-        case 7:
-            lpidx = _mm256_setr_epi32(7, 0, 1, 2, 3, 4, 5, 6);
+		preg = _mm256_mul_pd(xreg, yreg);
+		sreg = _mm256_add_pd(sreg, preg);
+	}
+
+	for (i = cutoff; i < n; i += DOUBLE_PER_M256_REG) {
+		vindex = _mm256_loadu_si256((const __m256i *)(xindices + i));
+		yreg = _mm256_loadu_pd(y + i);
+		xreg = _mm256_i64gather_pd(x, vindex, 8);
+
+		preg = _mm256_mul_pd(xreg, yreg);
+		sreg = _mm256_add_pd(sreg, preg);
+	}
+
+	return _mm256_register_sum_pd(sreg);
+}
+
+TARGET_AVX2
+double _mm256_ddot_indexed2_64(const double *x, const int64_t *xindices, const double *y, const int64_t *yindices, size_t n)
+{
+	__m256d xreg;
+	__m256d yreg;
+	__m256d preg;
+	__m256d sreg = _mm256_set1_pd(0);
+	__m256i xindex, yindex;
+	__m256i mask;
+	size_t i;
+	size_t cutoff = n % DOUBLE_PER_M256_REG;
+
+	if (cutoff > 0) {
+		mask = _mm256_set_mask_epi64(cutoff - 1);
+		xindex = _mm256_maskload_epi64((const long long *)xindices, mask);
+		yindex = _mm256_maskload_epi64((const long long *)yindices, mask);
+
+		xreg = _mm256_mask_i64gather_pd(sreg, x, xindex, _mm256_castsi256_pd(mask), 8);
+		yreg = _mm256_mask_i64gather_pd(sreg, y, yindex, _mm256_castsi256_pd(mask), 8);
 
-    }
+		preg = _mm256_mul_pd(xreg, yreg);
+		sreg = _mm256_add_pd(sreg, preg);
+	}
 
-	return _mm256_permutevar8x32_ps(a, lpidx);
+	for (i = cutoff; i < n; i += DOUBLE_PER_M256_REG) {
+		xindex = _mm256_loadu_si256((const __m256i *)(xindices + i));
+		yindex = _mm256_loadu_si256((const __m256i *)(yindices + i));
+
+		xreg = _mm256_i64gather_pd(x, xindex, 8);
+		yreg = _mm256_i64gather_pd(y, yindex, 8);
+
+		preg = _mm256_mul_pd(xreg, yreg);
+		sreg = _mm256_add_pd(sreg, preg);
+	}
+
+	return _mm256_register_sum_pd(sreg);
 }
 
-__m256 _mm256_rightperm_ps(__m256 a, int nperms)
+TARGET_AVX2
+void _mm256_copy1d_epi32_64(int *dst, const int *src, size_t n)
 {
-    nperms = FLOAT_PER_M256_REG - (nperms % FLOAT_PER_M256_REG);
+	size_t i;
 
-    return _mm256_leftperm_ps(a, nperms);
+	for (i = 0; i + INT32_CHUNK_LEN < n; i += INT32_CHUNK_LEN) {
+		_mm256_copy1d_epi32(dst + i, src + i, INT32_CHUNK_LEN);
+	}
+
+	_mm256_copy1d_epi32(dst + i, src + i, (int)(n - i));
 }
 
-__m256d _mm256_leftperm_pd(__m256d a, int nperms)
+TARGET_AVX2
+void _mm256_copy1d_ps_64(float *dst, const float *src, size_t n)
 {
-    nperms = nperms % DOUBLE_PER_M256_REG;
+	size_t i;
 
-    switch (nperms) {
-        case 1:
-            a = _mm256_permute4x64_pd(a, M128_LPERM_TO_IMM8(1));
-            break;
-        case 2:
-            a = _mm256_permute4x64_pd(a, M128_LPERM_TO_IMM8(2));
-            break;
-        case 3:
-            a = _mm256_permute4x64_pd(a, M128_LPERM_TO_IMM8(3));
-    }
+	for (i = 0; i + INT32_CHUNK_LEN < n; i += INT32_CHUNK_LEN) {
+		_mm256_copy1d_ps(dst + i, src + i, INT32_CHUNK_LEN);
+	}
 
-	return a;
+	_mm256_copy1d_ps(dst + i, src + i, (int)(n - i));
 }
 
-__m256d _mm256_rightperm_pd(__m256d a, int nperms)
+// 64-bit counterpart of _mm256_copy2d_epi32, whose linear indices overflow
+// once a grid has more than 2^31 cells.
+TARGET_AVX2
+void _mm256_copy2d_epi64(int64_t *kind, size_t nrows, const int64_t *iind, const int64_t *jind, size_t numi, size_t numj)
 {
-    nperms = nperms % DOUBLE_PER_M256_REG;
+	size_t i, j, i0, i1, j0, j1, ti, tj, jdidx;
+	size_t icutoff = numi % INT64_PER_M256_REG;
+	int split = copy2d_strategy == COPY2D_SPLIT;
+	__m256i jreg, kreg;
+	__m256i mask = _mm256_set_mask_epi64((int)icutoff - 1);
 
-    switch (nperms) {
-        case 1:
-            a = _mm256_permute4x64_pd(a, M128_RPERM_TO_IMM8(1));
-            break;
-        case 2:
-            a = _mm256_permute4x64_pd(a, M128_RPERM_TO_IMM8(2));
-            break;
-        case 3:
-            a = _mm256_permute4x64_pd(a, M128_RPERM_TO_IMM8(3));
-    }
+	copy2d_tile_64(numi, numj, sizeof(int64_t), &ti, &tj);
 
-	return a;
+	if (split && icutoff > 0) {
+		for (j = 0; j < numj; j++) {
+			jreg = _mm256_set1_epi64x(jind[j] * (int64_t)nrows);
+			kreg = _mm256_maskload_epi64((const long long *)iind, mask);
+			kreg = _mm256_add_epi64(kreg, jreg);
+			_mm256_maskstore_epi64((long long *)(kind + j * numi), mask, kreg);
+		}
+	}
+
+	for (j0 = 0; j0 < numj; j0 = j1) {
+		j1 = j0 + tj < numj ? j0 + tj : numj;
+
+		for (i0 = 0; i0 < numi; i0 = i1) {
+			i1 = copy2d_tile_end(i0, icutoff, ti, numi);
+
+			for (j = j0; j < j1; j++) {
+				jdidx = j * numi;
+				jreg = _mm256_set1_epi64x(jind[j] * (int64_t)nrows);
+
+				if (i0 == 0 && icutoff > 0 && !split) {
+					kreg = _mm256_maskload_epi64((const long long *)iind, mask);
+					kreg = _mm256_add_epi64(kreg, jreg);
+					_mm256_maskstore_epi64((long long *)(kind + jdidx), mask, kreg);
+				}
+
+				for (i = i0 > icutoff ? i0 : icutoff; i < i1; i += INT64_PER_M256_REG) {
+					kreg = _mm256_loadu_si256((const __m256i *)(iind + i));
+					kreg = _mm256_add_epi64(kreg, jreg);
+					_mm256_storeu_si256((__m256i *)(kind + jdidx + i), kreg);
+				}
+			}
+		}
+	}
 }
 
-__m256i _mm256_leftperm_epi32(__m256i a, int nperms)
+TARGET_AVX2
+void _mm256_copy2d_indexed_ps_64(float *dst, const float *src, size_t nrows, const int64_t *iind, const int64_t *jind, size_t numi, size_t numj)
 {
-	__m256i lpidx = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+	size_t i, j, i0, i1, j0, j1, ti, tj, jdidx;
+	size_t icutoff = numi % FLOAT_PER_M256_REG;
+	int split = copy2d_strategy == COPY2D_SPLIT;
+	const float *col;
+	__m256i mask = _mm256_set_mask_epi32((int)icutoff - 1);
+	__m256 sreg;
 
-    nperms = nperms % INT32_PER_M256_REG;
+	copy2d_tile_64(numi, numj, sizeof(int64_t), &ti, &tj);
 
-    switch (nperms) {
-        case 1:
-            lpidx = _mm256_setr_epi32(1, 2, 3, 4, 5, 6, 7, 0);
-            break;
-        case 2:
-            lpidx = _mm256_setr_epi32(2, 3, 4, 5, 6, 7, 0, 1);
-            break;
-        case 3:
-            lpidx = _mm256_setr_epi32(3, 4, 5, 6, 7, 0, 1, 2);
-            break;
-        case 4:
-            lpidx = _mm256_setr_epi32(4, 5, 6, 7, 0, 1, 2, 3);
-            break;
-        case 5:
-            lpidx = _mm256_setr_epi32(5, 6, 7, 0, 1, 2, 3, 4);
-            break;
-        case 6:
-            lpidx = _mm256_setr_epi32(6, 7, 0, 1, 2, 3, 4, 5);
-            break;
-        case 7:
-            lpidx = _mm256_setr_epi32(7, 0, 1, 2, 3, 4, 5, 6);
+	if (split && icutoff > 0) {
+		for (j = 0; j < numj; j++) {
+			col = src + jind[j] * (int64_t)nrows;
+			sreg = mask_gather64_ps(col, iind, mask);
+			_mm256_maskstore_ps(dst + j * numi, mask, sreg);
+		}
+	}
 
-    }
+	for (j0 = 0; j0 < numj; j0 = j1) {
+		j1 = j0 + tj < numj ? j0 + tj : numj;
 
-	return _mm256_permutevar8x32_epi32(a, lpidx);
+		for (i0 = 0; i0 < numi; i0 = i1) {
+			i1 = copy2d_tile_end(i0, icutoff, ti, numi);
+
+			for (j = j0; j < j1; j++) {
+				jdidx = j * numi;
+				col = src + jind[j] * (int64_t)nrows;
+
+				if (i0 == 0 && icutoff > 0 && !split) {
+					sreg = mask_gather64_ps(col, iind, mask);
+					_mm256_maskstore_ps(dst + jdidx, mask, sreg);
+				}
+
+				for (i = i0 > icutoff ? i0 : icutoff; i < i1; i += FLOAT_PER_M256_REG) {
+					sreg = gather64_ps(col, iind + i);
+					_mm256_storeu_ps(dst + jdidx + i, sreg);
+				}
+			}
+		}
+	}
 }
 
-__m256i _mm256_rightperm_epi32(__m256i a, int nperms)
+#ifdef SUPPORTS_AVX512
+TARGET_AVX512
+static inline __m512 gather64_ps512(const float *x, const int64_t *indices)
 {
-    nperms = INT32_PER_M256_REG - (nperms % INT32_PER_M256_REG);
+	__m256 lo = _mm512_i64gather_ps(_mm512_loadu_si512(indices), x, 4);
+	__m256 hi = _mm512_i64gather_ps(_mm512_loadu_si512(indices + 8), x, 4);
 
-    return _mm256_leftperm_epi32(a, nperms);
+	return _mm512_insertf32x8(_mm512_castps256_ps512(lo), hi, 1);
 }
 
-__m256i _mm256_leftperm_epi64(__m256i a, int nperms)
+TARGET_AVX512
+static inline __m512 mask_gather64_ps512(const float *x, const int64_t *indices, __mmask16 mask)
 {
-    nperms = nperms % INT64_PER_M256_REG;
-
-    switch (nperms) {
-        case 1:
-            a = _mm256_permute4x64_epi64(a, M128_LPERM_TO_IMM8(1));
-            break;
-        case 2:
-            a = _mm256_permute4x64_epi64(a, M128_LPERM_TO_IMM8(2));
-            break;
-        case 3:
-            a = _mm256_permute4x64_epi64(a, M128_LPERM_TO_IMM8(3));
-    }
+	__m256 zero = _mm256_set1_ps(0);
+	__mmask8 mlo = (__mmask8)mask;
+	__mmask8 mhi = (__mmask8)(mask >> 8);
+	__m256 lo = _mm512_mask_i64gather_ps(zero, mlo, _mm512_maskz_loadu_epi64(mlo, indices), x, 4);
+	__m256 hi = _mm512_mask_i64gather_ps(zero, mhi, _mm512_maskz_loadu_epi64(mhi, indices + 8), x, 4);
 
-    return a;
+	return _mm512_insertf32x8(_mm512_castps256_ps512(lo), hi, 1);
 }
 
-__m256i _mm256_rightperm_epi64(__m256i a, int nperms)
+TARGET_AVX512
+void _mm512_sset_value_64(float *x, size_t n, float value)
 {
-    nperms = nperms % INT64_PER_M256_REG;
+	size_t i;
 
-    switch (nperms) {
-        case 1:
-            a = _mm256_permute4x64_epi64(a, M128_RPERM_TO_IMM8(1));
-            break;
-        case 2:
-            a = _mm256_permute4x64_epi64(a, M128_RPERM_TO_IMM8(2));
-            break;
-        case 3:
-            a = _mm256_permute4x64_epi64(a, M128_RPERM_TO_IMM8(3));
-    }
+	for (i = 0; i + INT32_CHUNK_LEN < n; i += INT32_CHUNK_LEN) {
+		_mm512_sset_value(x + i, INT32_CHUNK_LEN, value);
+	}
 
-    return a;
+	_mm512_sset_value(x + i, (int)(n - i), value);
 }
 
-//----------------------------------------------------------------------------
-// Helper routines for copying data.
-//----------------------------------------------------------------------------
-
-void _mm256_copy1d_epi32(int *dst, const int *src, int n)
+TARGET_AVX512
+void _mm512_dset_value_64(double *x, size_t n, double value)
 {
-	int i;
-	int cutoff = n % INT32_PER_M256_REG;
-	__m256i mask;
-	__m256i sreg, dreg;
-
-	if (cutoff > 0) {
-		mask = _mm256_set_mask_epi32(cutoff);
+	size_t i;
 
-		sreg = _mm256_maskload_epi32(src, mask);
-		_mm256_maskstore_epi32(dst, mask, sreg);
+	for (i = 0; i + INT32_CHUNK_LEN < n; i += INT32_CHUNK_LEN) {
+		_mm512_dset_value(x + i, INT32_CHUNK_LEN, value);
 	}
 
-	mask = _mm256_set1_epi32(INT32_ALLBITS);
-
-	for (i = cutoff; i < n; i += INT32_PER_M256_REG) {
-		sreg = _mm256_maskload_epi32(src, mask);
-		_mm256_maskstore_epi32(dst, mask, sreg);
-	}
+	_mm512_dset_value(x + i, (int)(n - i), value);
 }
 
-void _mm256_copy2d_epi32(int *kind, int nrows, const int *iind, const int *jind, int numi, int numj)
+TARGET_AVX512
+float _mm512_fdot_64(const float *x, const float *y, size_t n)
 {
-	int i, j, jdidx, jsidx;
-	int icutoff = numi % INT32_PER_M256_REG;
-	int jcutoff = numj % INT32_PER_M256_REG;
-	__m256i jreg, kreg;
-	__m256i mask;
+	double sum = 0;
+	size_t i;
 
-#ifdef CONTIGUOUS_LOOP
-	for (j = 0; j < numj; j++) {
-		jdidx = j * numi;
-		jsidx = jind[j] * nrows;
-		jreg = _mm256_set1_epi32(jsidx);
+	for (i = 0; i + INT32_CHUNK_LEN < n; i += INT32_CHUNK_LEN) {
+		sum += _mm512_fdot(x + i, y + i, INT32_CHUNK_LEN);
+	}
 
-		if (icutoff > 0) {
-			mask = _mm256_set_mask_epi32(icutoff - 1);
+	return (float)(sum + _mm512_fdot(x + i, y + i, (int)(n - i)));
+}
 
-			kreg = _mm256_maskload_epi32(iind, mask);
-			kreg = _mm256_add_epi32(kreg, jreg);
-			_mm256_maskstore_epi32(kind + jdidx, mask, kreg);
-		}
+TARGET_AVX512
+float _mm512_fdot_indexed_64(const float *x, const int64_t *xindices, const float *y, size_t n)
+{
+	__m512 xreg;
+	__m512 yreg;
+	__m512 sreg = _mm512_set1_ps(0);
+	__mmask16 mask;
+	size_t i;
+	size_t cutoff = n % FLOAT_PER_M512_REG;
 
-		mask = _mm256_set1_epi32(INT32_PER_M256_REG);
+	if (cutoff > 0) {
+		mask = _mm512_set_mask_epi32(cutoff - 1);
+		yreg = _mm512_maskz_loadu_ps(mask, y);
+		xreg = mask_gather64_ps512(x, xindices, mask);
 
-		for (i = icutoff; i < numi; i += INT32_PER_M256_REG) {
-			kreg = _mm256_maskload_epi32(iind + i, mask);
-			kreg = _mm256_add_epi32(kreg, jreg);
-			_mm256_maskstore_epi32(kind + jdidx + i, mask, kreg);
-		}
+		sreg = _mm512_fmadd_ps(xreg, yreg, sreg);
 	}
-#else
-	if (icutoff > 0) {
-		mask = _mm256_set_mask_epi32(icutoff - 1);
 
-		for (j = 0; j < numj; j++) {
-			jdidx = j * numi;
-			jsidx = jind[j] * nrows;
-			jreg = _mm256_set1_epi32(jsidx);
+	for (i = cutoff; i < n; i += FLOAT_PER_M512_REG) {
+		yreg = _mm512_loadu_ps(y + i);
+		xreg = gather64_ps512(x, xindices + i);
 
-			kreg = _mm256_maskload_epi32(iind, mask);
-			kreg = _mm256_add_epi32(kreg, jreg);
-			_mm256_maskstore_epi32(kind + jdidx, mask, kreg);
-		}
+		sreg = _mm512_fmadd_ps(xreg, yreg, sreg);
 	}
 
-	mask = _mm256_set1_epi32(INT32_ALLBITS);
-
-	for (j = 0; j < numj; j++) {
-		jdidx = j * numi;
-		jsidx = jind[j] * nrows;
-		jreg = _mm256_set1_epi32(jsidx);
-
-		for (i = icutoff; i < numi; i += INT32_PER_M256_REG) {
-			kreg = _mm256_maskload_epi32(iind + i, mask);
-			kreg = _mm256_add_epi32(kreg, jreg);
-			_mm256_maskstore_epi32(kind + jdidx + i, mask, kreg);
-		}
-	}
-#endif
+	return _mm512_register_sum_ps(sreg);
 }
 
-
-void _mm256_copy1d_ps(float *dst, const float *src, int n)
+TARGET_AVX512
+float _mm512_fdot_indexed2_64(const float *x, const int64_t *xindices, const float *y, const int64_t *yindices, size_t n)
 {
-	int i;
-	int cutoff = n % FLOAT_PER_M256_REG;
-	__m256i mask;
-	__m256 sreg, dreg;
+	__m512 xreg;
+	__m512 yreg;
+	__m512 sreg = _mm512_set1_ps(0);
+	__mmask16 mask;
+	size_t i;
+	size_t cutoff = n % FLOAT_PER_M512_REG;
 
 	if (cutoff > 0) {
-		mask = _mm256_set_mask_epi32(cutoff - 1);
+		mask = _mm512_set_mask_epi32(cutoff - 1);
+		xreg = mask_gather64_ps512(x, xindices, mask);
+		yreg = mask_gather64_ps512(y, yindices, mask);
 
-		sreg = _mm256_maskload_ps(src, mask);
-		_mm256_maskstore_ps(dst, mask, sreg);
+		sreg = _mm512_fmadd_ps(xreg, yreg, sreg);
 	}
 
-	for (i = cutoff; i < n; i += INT32_PER_M256_REG) {
-		sreg = _mm256_loadu_ps(src);
-		_mm256_storeu_ps(dst, sreg);
+	for (i = cutoff; i < n; i += FLOAT_PER_M512_REG) {
+		xreg = gather64_ps512(x, xindices + i);
+		yreg = gather64_ps512(y, yindices + i);
+
+		sreg = _mm512_fmadd_ps(xreg, yreg, sreg);
 	}
+
+	return _mm512_register_sum_ps(sreg);
 }
 
-void _mm256_copy2d_indexed_ps(float *dst, const float *src, int nrows, const int *iind, const int *jind, int numi, int numj)
+TARGET_AVX512
+double _mm512_ddot_64(const double *x, const double *y, size_t n)
 {
-	int i, j, jdidx, jsidx;
-	int icutoff = numi % FLOAT_PER_M256_REG;
-	__m256i ireg, jreg, kreg;
-	__m256i mask;
-	__m256 sreg;
-	__m256 zero = _mm256_set1_ps(0);
+	double sum = 0;
+	size_t i;
 
-#ifdef CONTIGUOUS_LOOP
-	for (j = 0; j < numj; j++) {
-		jdidx = j * numi;
-		jsidx = jind[j] * nrows;
-		jreg = _mm256_set1_epi32(jsidx);
+	for (i = 0; i + INT32_CHUNK_LEN < n; i += INT32_CHUNK_LEN) {
+		sum += _mm512_ddot(x + i, y + i, INT32_CHUNK_LEN);
+	}
 
-		if (icutoff > 0) {
-			mask = _mm256_set_mask_epi32(icutoff - 1);
+	return sum + _mm512_ddot(x + i, y + i, (int)(n - i));
+}
 
-			ireg = _mm256_maskload_epi32(iind, mask);
-			kreg = _mm256_add_epi32(jreg, ireg);
+TARGET_AVX512
+double _mm512_ddot_indexed_64(const double *x, const int64_t *xindices, const double *y, size_t n)
+{
+	__m512d xreg;
+	__m512d yreg;
+	__m512d sreg = _mm512_set1_pd(0);
+	__m512i vindex;
+	__mmask8 mask;
+	size_t i;
+	size_t cutoff = n % DOUBLE_PER_M512_REG;
 
-			// Gather the data from the source.
-			sreg = _mm256_mask_i32gather_ps(zero, src, kreg, _mm256_castsi256_ps(mask), 4);
+	if (cutoff > 0) {
+		mask = _mm512_set_mask_epi64(cutoff - 1);
+		vindex = _mm512_maskz_loadu_epi64(mask, xindices);
+		yreg = _mm512_maskz_loadu_pd(mask, y);
+		xreg = _mm512_mask_i64gather_pd(sreg, mask, vindex, x, 8);
 
-			// Store the data.
-			_mm256_maskstore_ps(dst + jdidx, mask, sreg);
-		}
+		sreg = _mm512_fmadd_pd(xreg, yreg, sreg);
+	}
 
-		mask = _mm256_set1_epi32(INT32_ALLBITS);
+	for (i = cutoff; i < n; i += DOUBLE_PER_M512_REG) {
+		vindex = _mm512_loadu_epi64(xindices + i);
+		yreg = _mm512_loadu_pd(y + i);
+		xreg = _mm512_i64gather_pd(vindex, x, 8);
 
-		for (i = icutoff; i < numi; i += INT32_PER_M256_REG) {
-			ireg = _mm256_maskload_epi32(iind + i, mask);
-			kreg = _mm256_add_epi32(jreg, ireg);
+		sreg = _mm512_fmadd_pd(xreg, yreg, sreg);
+	}
 
-			// Gather the data from the source.
-			sreg = _mm256_i32gather_ps(src, kreg, 4);
+	return _mm512_register_sum_pd(sreg);
+}
 
-			// Store the data.
-			_mm256_storeu_ps(dst + jdidx + i, sreg);
-		}
-	}
-#else
-	if (icutoff > 0) {
-		mask = _mm256_set_mask_epi32(icutoff - 1);
+TARGET_AVX512
+double _mm512_ddot_indexed2_64(const double *x, const int64_t *xindices, const double *y, const int64_t *yindices, size_t n)
+{
+	__m512d xreg;
+	__m512d yreg;
+	__m512d sreg = _mm512_set1_pd(0);
+	__m512i xind;
+	__m512i yind;
+	__mmask8 mask;
+	size_t i;
+	size_t cutoff = n % DOUBLE_PER_M512_REG;
 
-		for (j = 0; j < numj; j++) {
-			jdidx = j * numi;
-			jsidx = jind[j] * nrows;
-			jreg = _mm256_set1_epi32(jsidx);
+	if (cutoff > 0) {
+		mask = _mm512_set_mask_epi64(cutoff - 1);
 
-			ireg = _mm256_maskload_epi32(iind, mask);
-			kreg = _mm256_add_epi32(jreg, ireg);
-			sreg = _mm256_mask_i32gather_ps(zero, src, kreg, _mm256_castsi256_ps(mask), 4);
-			_mm256_maskstore_ps(dst + jdidx, mask, sreg);
-		}
+		xind = _mm512_maskz_loadu_epi64(mask, xindices);
+		yind = _mm512_maskz_loadu_epi64(mask, yindices);
+
+		xreg = _mm512_mask_i64gather_pd(sreg, mask, xind, x, 8);
+		yreg = _mm512_mask_i64gather_pd(sreg, mask, yind, y, 8);
+
+		sreg = _mm512_fmadd_pd(xreg, yreg, sreg);
 	}
 
-	mask = _mm256_set1_epi32(INT32_ALLBITS);
+	for (i = cutoff; i < n; i += DOUBLE_PER_M512_REG) {
+		xind = _mm512_loadu_epi64(xindices + i);
+		yind = _mm512_loadu_epi64(yindices + i);
 
-	for (j = 0; j < numj; j++) {
-		jdidx = j * numi;
-		jsidx = jind[j] * nrows;
-		jreg = _mm256_set1_epi32(jsidx);
+		xreg = _mm512_i64gather_pd(xind, x, 8);
+		yreg = _mm512_i64gather_pd(yind, y, 8);
 
-		for (i = icutoff; i < numi; i += INT32_PER_M256_REG) {
-			ireg = _mm256_maskload_epi32(iind + i, mask);
-			kreg = _mm256_add_epi32(jreg, ireg);
-			sreg = _mm256_i32gather_ps(src, kreg, 4);
-			_mm256_storeu_ps(dst + jdidx + i, sreg);
-		}
+		sreg = _mm512_fmadd_pd(xreg, yreg, sreg);
 	}
-#endif
+
+	return _mm512_register_sum_pd(sreg);
 }
+#endif
 
 //----------------------------------------------------------------------------
 // Helper routines for printing.
 //----------------------------------------------------------------------------
 
+TARGET_AVX2
 void _mm256_print_register_epi32(__m256i a)
 {
 	int b[INT32_PER_M256_REG];
@@ -1055,6 +11207,7 @@ void _mm256_print_register_epi32(__m256i a)
 	printf("%d %d %d %d %d %d %d %d\n", b[0], b[1], b[2], b[3], b[4], b[5], b[6], b[7]);
 }
 
+TARGET_AVX2
 void _mm256_print_register_ps(__m256 a)
 {
 	float b[FLOAT_PER_M256_REG];
@@ -0,0 +1,246 @@
+#include "parallel.h"
+#include "dispatch.h"
+#include <pthread.h>
+#include <stdlib.h>
+
+// Slices start on multiples of this many elements, so every thread but the
+// last runs whole registers of every width.
+#define SLICE_ALIGN 64
+
+// The dispatched kernels take int lengths, so slices are handed to them in
+// pieces of at most this many elements.
+#define PIECE_LEN ((size_t)1 << 30)
+
+//----------------------------------------------------------------------------
+// Per-thread work.
+//----------------------------------------------------------------------------
+
+struct dot_task {
+	double (*kernel)(const struct dot_task *);
+
+	const void *x;
+	const void *y;
+	const int *xindices;
+	const int *yindices;
+
+	size_t begin;
+	size_t end;
+
+	double partial;
+
+	pthread_t thread;
+	int started;
+};
+
+static size_t piece_len(size_t i, size_t end)
+{
+	return end - i < PIECE_LEN ? end - i : PIECE_LEN;
+}
+
+static double fdot_slice(const struct dot_task *t)
+{
+	const float *x = t->x;
+	const float *y = t->y;
+	double sum = 0;
+	size_t i;
+
+	for (i = t->begin; i < t->end; i += PIECE_LEN) {
+		sum += iu_fdot(x + i, y + i, (int)piece_len(i, t->end));
+	}
+
+	return sum;
+}
+
+static double fdot_indexed_slice(const struct dot_task *t)
+{
+	const float *y = t->y;
+	double sum = 0;
+	size_t i;
+
+	for (i = t->begin; i < t->end; i += PIECE_LEN) {
+		sum += iu_fdot_indexed(t->x, t->xindices + i, y + i, (int)piece_len(i, t->end));
+	}
+
+	return sum;
+}
+
+static double fdot_indexed2_slice(const struct dot_task *t)
+{
+	double sum = 0;
+	size_t i;
+
+	for (i = t->begin; i < t->end; i += PIECE_LEN) {
+		sum += iu_fdot_indexed2(t->x, t->xindices + i, t->y, t->yindices + i, (int)piece_len(i, t->end));
+	}
+
+	return sum;
+}
+
+static double ddot_slice(const struct dot_task *t)
+{
+	const double *x = t->x;
+	const double *y = t->y;
+	double sum = 0;
+	size_t i;
+
+	for (i = t->begin; i < t->end; i += PIECE_LEN) {
+		sum += iu_ddot(x + i, y + i, (int)piece_len(i, t->end));
+	}
+
+	return sum;
+}
+
+static double ddot_indexed_slice(const struct dot_task *t)
+{
+	const double *y = t->y;
+	double sum = 0;
+	size_t i;
+
+	for (i = t->begin; i < t->end; i += PIECE_LEN) {
+		sum += iu_ddot_indexed(t->x, t->xindices + i, y + i, (int)piece_len(i, t->end));
+	}
+
+	return sum;
+}
+
+static double ddot_indexed2_slice(const struct dot_task *t)
+{
+	double sum = 0;
+	size_t i;
+
+	for (i = t->begin; i < t->end; i += PIECE_LEN) {
+		sum += iu_ddot_indexed2(t->x, t->xindices + i, t->y, t->yindices + i, (int)piece_len(i, t->end));
+	}
+
+	return sum;
+}
+
+static void *run_task(void *arg)
+{
+	struct dot_task *t = arg;
+
+	t->partial = t->kernel(t);
+
+	return NULL;
+}
+
+//----------------------------------------------------------------------------
+// Splitting the range and combining the partial sums.
+//----------------------------------------------------------------------------
+
+static double run_parallel(struct dot_task proto, size_t n, int nthreads)
+{
+	struct dot_task *tasks;
+	size_t slice;
+	double sum;
+	int k, stride;
+
+	if (nthreads < 1) {
+		nthreads = 1;
+	}
+
+	proto.begin = 0;
+	proto.end = n;
+
+	// Round the slices up to whole blocks, then drop any threads that would
+	// be left without work.
+	slice = (n + nthreads - 1) / nthreads;
+	slice = (slice + SLICE_ALIGN - 1) / SLICE_ALIGN * SLICE_ALIGN;
+
+	if (slice > 0 && (n + slice - 1) / slice < (size_t)nthreads) {
+		nthreads = (int)((n + slice - 1) / slice);
+	}
+
+	if (nthreads == 1 || n == 0) {
+		return proto.kernel(&proto);
+	}
+
+	// Without memory for the tasks, fall back to a single serial pass.
+	tasks = calloc(nthreads, sizeof(*tasks));
+
+	if (tasks == NULL) {
+		return proto.kernel(&proto);
+	}
+
+	for (k = 0; k < nthreads; k++) {
+		tasks[k] = proto;
+		tasks[k].begin = (size_t)k * slice;
+		tasks[k].end = tasks[k].begin + slice < n ? tasks[k].begin + slice : n;
+	}
+
+	// The calling thread takes the first slice. A slice whose thread could
+	// not be started is run here as well; its partial sum is the same
+	// either way.
+	for (k = 1; k < nthreads; k++) {
+		tasks[k].started = pthread_create(&tasks[k].thread, NULL, run_task, &tasks[k]) == 0;
+	}
+
+	run_task(&tasks[0]);
+
+	for (k = 1; k < nthreads; k++) {
+		if (tasks[k].started) {
+			pthread_join(tasks[k].thread, NULL);
+		} else {
+			run_task(&tasks[k]);
+		}
+	}
+
+	// Pairwise tree over the slices, in an order fixed by the thread count.
+	for (stride = 1; stride < nthreads; stride *= 2) {
+		for (k = 0; k + stride < nthreads; k += 2 * stride) {
+			tasks[k].partial += tasks[k + stride].partial;
+		}
+	}
+
+	sum = tasks[0].partial;
+
+	free(tasks);
+
+	return sum;
+}
+
+//----------------------------------------------------------------------------
+// Multithreaded entry points.
+//----------------------------------------------------------------------------
+
+float iu_fdot_parallel(const float *x, const float *y, size_t n, int nthreads)
+{
+	struct dot_task proto = {.kernel = fdot_slice, .x = x, .y = y};
+
+	return (float)run_parallel(proto, n, nthreads);
+}
+
+float iu_fdot_indexed_parallel(const float *x, const int *xindices, const float *y, size_t n, int nthreads)
+{
+	struct dot_task proto = {.kernel = fdot_indexed_slice, .x = x, .y = y, .xindices = xindices};
+
+	return (float)run_parallel(proto, n, nthreads);
+}
+
+float iu_fdot_indexed2_parallel(const float *x, const int *xindices, const float *y, const int *yindices, size_t n, int nthreads)
+{
+	struct dot_task proto = {.kernel = fdot_indexed2_slice, .x = x, .y = y, .xindices = xindices, .yindices = yindices};
+
+	return (float)run_parallel(proto, n, nthreads);
+}
+
+double iu_ddot_parallel(const double *x, const double *y, size_t n, int nthreads)
+{
+	struct dot_task proto = {.kernel = ddot_slice, .x = x, .y = y};
+
+	return run_parallel(proto, n, nthreads);
+}
+
+double iu_ddot_indexed_parallel(const double *x, const int *xindices, const double *y, size_t n, int nthreads)
+{
+	struct dot_task proto = {.kernel = ddot_indexed_slice, .x = x, .y = y, .xindices = xindices};
+
+	return run_parallel(proto, n, nthreads);
+}
+
+double iu_ddot_indexed2_parallel(const double *x, const int *xindices, const double *y, const int *yindices, size_t n, int nthreads)
+{
+	struct dot_task proto = {.kernel = ddot_indexed2_slice, .x = x, .y = y, .xindices = xindices, .yindices = yindices};
+
+	return run_parallel(proto, n, nthreads);
+}
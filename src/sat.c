@@ -0,0 +1,312 @@
+#include "sat.h"
+#include "dispatch.h"
+#include "constants.h"
+#include <stdlib.h>
+
+//----------------------------------------------------------------------------
+// Helpers for periodic corners. Rectangles are handled in line coordinates:
+// lines [l0, l1) and positions [t0, t1), any of which may lie outside the
+// grid.
+//----------------------------------------------------------------------------
+
+static long long floor_div(long long a, long long b)
+{
+	long long q = a / b;
+
+	return q - (a - q * b < 0);
+}
+
+// Splits a row and column pair into line and position for the table order.
+static void to_lines(char order, int row, int col, int *line, int *pos)
+{
+	*line = order == ROW_MAJOR_ORDER ? row : col;
+	*pos = order == ROW_MAJOR_ORDER ? col : row;
+}
+
+// The table entry (l, t) extended periodically past the grid in both
+// directions, with the table's full-line and full-grid sums.
+static double corner_ps(const struct iu_ssat *sat, long long l, long long t)
+{
+	long long ql = floor_div(l, sat->nlines), qt = floor_div(t, sat->len);
+	const float *table = sat->table;
+	const float *full = table + (size_t)sat->nlines * sat->ld;
+	size_t rl = (size_t)(l - ql * sat->nlines) * sat->ld;
+	size_t rt = (size_t)(t - qt * sat->len);
+
+	return (double)(ql * qt) * full[sat->len] + (double)ql * full[rt] + (double)qt * table[rl + sat->len] + table[rl + rt];
+}
+
+static double corner_pd(const struct iu_dsat *sat, long long l, long long t)
+{
+	long long ql = floor_div(l, sat->nlines), qt = floor_div(t, sat->len);
+	const double *table = sat->table;
+	const double *full = table + (size_t)sat->nlines * sat->ld;
+	size_t rl = (size_t)(l - ql * sat->nlines) * sat->ld;
+	size_t rt = (size_t)(t - qt * sat->len);
+
+	return (double)(ql * qt) * full[sat->len] + (double)ql * full[rt] + (double)qt * table[rl + sat->len] + table[rl + rt];
+}
+
+static double rect_ps(const struct iu_ssat *sat, long long l0, long long l1, long long t0, long long t1)
+{
+	return corner_ps(sat, l1, t1) - corner_ps(sat, l0, t1) - corner_ps(sat, l1, t0) + corner_ps(sat, l0, t0);
+}
+
+static double rect_pd(const struct iu_dsat *sat, long long l0, long long l1, long long t0, long long t1)
+{
+	return corner_pd(sat, l1, t1) - corner_pd(sat, l0, t1) - corner_pd(sat, l1, t0) + corner_pd(sat, l0, t0);
+}
+
+//----------------------------------------------------------------------------
+// Functions for creating tables.
+//----------------------------------------------------------------------------
+
+struct iu_ssat *iu_ssat_create(int nrows, int ncols, char order)
+{
+	struct iu_ssat *sat;
+
+	if (nrows <= 0 || ncols <= 0 || (order != ROW_MAJOR_ORDER && order != COLUMN_MAJOR_ORDER)) {
+		return NULL;
+	}
+
+	sat = calloc(1, sizeof(*sat));
+
+	if (sat == NULL) {
+		return NULL;
+	}
+
+	sat->nrows = nrows;
+	sat->ncols = ncols;
+	sat->order = order;
+	to_lines(order, nrows, ncols, &sat->nlines, &sat->len);
+	sat->ld = sat->len + 1;
+	sat->table = calloc((size_t)(sat->nlines + 1) * sat->ld, sizeof(float));
+
+	if (sat->table == NULL) {
+		iu_ssat_free(sat);
+		return NULL;
+	}
+
+	return sat;
+}
+
+struct iu_dsat *iu_dsat_create(int nrows, int ncols, char order)
+{
+	struct iu_dsat *sat;
+
+	if (nrows <= 0 || ncols <= 0 || (order != ROW_MAJOR_ORDER && order != COLUMN_MAJOR_ORDER)) {
+		return NULL;
+	}
+
+	sat = calloc(1, sizeof(*sat));
+
+	if (sat == NULL) {
+		return NULL;
+	}
+
+	sat->nrows = nrows;
+	sat->ncols = ncols;
+	sat->order = order;
+	to_lines(order, nrows, ncols, &sat->nlines, &sat->len);
+	sat->ld = sat->len + 1;
+	sat->table = calloc((size_t)(sat->nlines + 1) * sat->ld, sizeof(double));
+
+	if (sat->table == NULL) {
+		iu_dsat_free(sat);
+		return NULL;
+	}
+
+	return sat;
+}
+
+void iu_ssat_build(struct iu_ssat *sat, const float *x, int ldx)
+{
+	iu_sat_build_ps(sat->table, sat->ld, x, ldx, sat->len, sat->nlines);
+}
+
+void iu_dsat_build(struct iu_dsat *sat, const double *x, int ldx)
+{
+	iu_sat_build_pd(sat->table, sat->ld, x, ldx, sat->len, sat->nlines);
+}
+
+void iu_ssat_free(struct iu_ssat *sat)
+{
+	if (sat == NULL) {
+		return;
+	}
+
+	free(sat->table);
+	free(sat);
+}
+
+void iu_dsat_free(struct iu_dsat *sat)
+{
+	if (sat == NULL) {
+		return;
+	}
+
+	free(sat->table);
+	free(sat);
+}
+
+//----------------------------------------------------------------------------
+// Queries. For each line of cells the box spans table lines l0 and l1,
+// reduced into the grid with count copies of the full line between them.
+// Cells whose box stays within the line go to the vector kernel in one run;
+// the few at either end wrap and are summed from periodic corners. A
+// negative sign subtracts the boxes from dst instead of storing them, which
+// is how rings are made.
+//----------------------------------------------------------------------------
+
+static void box_ps(const struct iu_ssat *sat, float *dst, int lddst, int loff, int toff, int lext, int text, int sign)
+{
+	int l, t, tlo, thi;
+	long long l0, l1, q0, q1;
+	const float *lo, *hi, *tmp;
+	const float *full = sat->table + (size_t)sat->nlines * sat->ld;
+	float *out;
+	float count;
+	double sum;
+
+	// Cells t in [tlo, thi) have 0 <= t + toff and t + toff + text <= len.
+	tlo = -toff > 0 ? -toff : 0;
+	tlo = tlo < sat->len ? tlo : sat->len;
+	thi = sat->len - toff - text + 1 < sat->len ? sat->len - toff - text + 1 : sat->len;
+	thi = thi > tlo ? thi : tlo;
+
+	for (l = 0; l < sat->nlines; l++) {
+		out = dst + (size_t)l * lddst;
+		l0 = (long long)l + loff;
+		l1 = l0 + lext;
+		q0 = floor_div(l0, sat->nlines);
+		q1 = floor_div(l1, sat->nlines);
+		lo = sat->table + (size_t)(l0 - q0 * sat->nlines) * sat->ld;
+		hi = sat->table + (size_t)(l1 - q1 * sat->nlines) * sat->ld;
+		count = (float)(q1 - q0);
+
+		if (sign < 0) {
+			tmp = lo;
+			lo = hi;
+			hi = tmp;
+			count = -count;
+		}
+
+		if (thi > tlo) {
+			iu_sat_box_ps(out + tlo, lo + tlo + toff, hi + tlo + toff, count != 0 ? full + tlo + toff : NULL, count, thi - tlo, text, sign < 0);
+		}
+
+		for (t = 0; t < tlo; t++) {
+			sum = rect_ps(sat, l0, l1, (long long)t + toff, (long long)t + toff + text);
+			out[t] = sign < 0 ? (float)(out[t] - sum) : (float)sum;
+		}
+
+		for (t = thi; t < sat->len; t++) {
+			sum = rect_ps(sat, l0, l1, (long long)t + toff, (long long)t + toff + text);
+			out[t] = sign < 0 ? (float)(out[t] - sum) : (float)sum;
+		}
+	}
+}
+
+static void box_pd(const struct iu_dsat *sat, double *dst, int lddst, int loff, int toff, int lext, int text, int sign)
+{
+	int l, t, tlo, thi;
+	long long l0, l1, q0, q1;
+	const double *lo, *hi, *tmp;
+	const double *full = sat->table + (size_t)sat->nlines * sat->ld;
+	double *out;
+	double count;
+	double sum;
+
+	tlo = -toff > 0 ? -toff : 0;
+	tlo = tlo < sat->len ? tlo : sat->len;
+	thi = sat->len - toff - text + 1 < sat->len ? sat->len - toff - text + 1 : sat->len;
+	thi = thi > tlo ? thi : tlo;
+
+	for (l = 0; l < sat->nlines; l++) {
+		out = dst + (size_t)l * lddst;
+		l0 = (long long)l + loff;
+		l1 = l0 + lext;
+		q0 = floor_div(l0, sat->nlines);
+		q1 = floor_div(l1, sat->nlines);
+		lo = sat->table + (size_t)(l0 - q0 * sat->nlines) * sat->ld;
+		hi = sat->table + (size_t)(l1 - q1 * sat->nlines) * sat->ld;
+		count = (double)(q1 - q0);
+
+		if (sign < 0) {
+			tmp = lo;
+			lo = hi;
+			hi = tmp;
+			count = -count;
+		}
+
+		if (thi > tlo) {
+			iu_sat_box_pd(out + tlo, lo + tlo + toff, hi + tlo + toff, count != 0 ? full + tlo + toff : NULL, count, thi - tlo, text, sign < 0);
+		}
+
+		for (t = 0; t < tlo; t++) {
+			sum = rect_pd(sat, l0, l1, (long long)t + toff, (long long)t + toff + text);
+			out[t] = sign < 0 ? out[t] - sum : sum;
+		}
+
+		for (t = thi; t < sat->len; t++) {
+			sum = rect_pd(sat, l0, l1, (long long)t + toff, (long long)t + toff + text);
+			out[t] = sign < 0 ? out[t] - sum : sum;
+		}
+	}
+}
+
+float iu_ssat_rect(const struct iu_ssat *sat, int row, int col, int height, int width)
+{
+	int l, t, lext, text;
+
+	to_lines(sat->order, row, col, &l, &t);
+	to_lines(sat->order, height, width, &lext, &text);
+
+	return (float)rect_ps(sat, l, (long long)l + lext, t, (long long)t + text);
+}
+
+double iu_dsat_rect(const struct iu_dsat *sat, int row, int col, int height, int width)
+{
+	int l, t, lext, text;
+
+	to_lines(sat->order, row, col, &l, &t);
+	to_lines(sat->order, height, width, &lext, &text);
+
+	return rect_pd(sat, l, (long long)l + lext, t, (long long)t + text);
+}
+
+void iu_ssat_box(const struct iu_ssat *sat, float *dst, int lddst, int top, int left, int height, int width)
+{
+	int loff, toff, lext, text;
+
+	to_lines(sat->order, top, left, &loff, &toff);
+	to_lines(sat->order, height, width, &lext, &text);
+	box_ps(sat, dst, lddst, loff, toff, lext, text, 1);
+}
+
+void iu_dsat_box(const struct iu_dsat *sat, double *dst, int lddst, int top, int left, int height, int width)
+{
+	int loff, toff, lext, text;
+
+	to_lines(sat->order, top, left, &loff, &toff);
+	to_lines(sat->order, height, width, &lext, &text);
+	box_pd(sat, dst, lddst, loff, toff, lext, text, 1);
+}
+
+void iu_ssat_ring(const struct iu_ssat *sat, float *dst, int lddst, int inner, int outer)
+{
+	box_ps(sat, dst, lddst, -outer, -outer, 2 * outer + 1, 2 * outer + 1, 1);
+
+	if (inner >= 0) {
+		box_ps(sat, dst, lddst, -inner, -inner, 2 * inner + 1, 2 * inner + 1, -1);
+	}
+}
+
+void iu_dsat_ring(const struct iu_dsat *sat, double *dst, int lddst, int inner, int outer)
+{
+	box_pd(sat, dst, lddst, -outer, -outer, 2 * outer + 1, 2 * outer + 1, 1);
+
+	if (inner >= 0) {
+		box_pd(sat, dst, lddst, -inner, -inner, 2 * inner + 1, 2 * inner + 1, -1);
+	}
+}
@@ -0,0 +1,275 @@
+#include "smoothlife.h"
+#include "dispatch.h"
+#include <stdlib.h>
+#include <math.h>
+
+//----------------------------------------------------------------------------
+// Neighbourhood weights. A cell at distance l from the centre covers a disk
+// of radius r by clamp(r + 1/2 - l, 0, 1), so the edge ramps over one cell.
+//----------------------------------------------------------------------------
+
+static float coverage(float r, float l)
+{
+	float w = r + 0.5f - l;
+
+	return w < 0 ? 0 : (w > 1 ? 1 : w);
+}
+
+// Offsets and weights are listed column by column, so the stencil walks the
+// padded grid in storage order.
+static int build_weights(struct iu_smoothlife *sl)
+{
+	int di, dj, k;
+	int side = 2 * sl->pad + 1;
+	float l, wm, wn;
+	double msum = 0, nsum = 0;
+
+	sl->m_offsets = malloc(side * side * sizeof(int));
+	sl->m_weights = malloc(side * side * sizeof(float));
+	sl->n_offsets = malloc(side * side * sizeof(int));
+	sl->n_weights = malloc(side * side * sizeof(float));
+
+	if (sl->m_offsets == NULL || sl->m_weights == NULL || sl->n_offsets == NULL || sl->n_weights == NULL) {
+		return -1;
+	}
+
+	for (dj = -sl->pad; dj <= sl->pad; dj++) {
+		for (di = -sl->pad; di <= sl->pad; di++) {
+			l = sqrtf((float)(di * di + dj * dj));
+			wm = coverage(sl->params.ri, l);
+			wn = coverage(sl->params.ra, l) - wm;
+
+			if (wm > 0) {
+				sl->m_offsets[sl->nm] = dj * sl->ldp + di;
+				sl->m_weights[sl->nm++] = wm;
+				msum += wm;
+			}
+
+			if (wn > 0) {
+				sl->n_offsets[sl->nn] = dj * sl->ldp + di;
+				sl->n_weights[sl->nn++] = wn;
+				nsum += wn;
+			}
+		}
+	}
+
+	for (k = 0; k < sl->nm; k++) {
+		sl->m_weights[k] = (float)(sl->m_weights[k] / msum);
+	}
+
+	for (k = 0; k < sl->nn; k++) {
+		sl->n_weights[k] = (float)(sl->n_weights[k] / nsum);
+	}
+
+	return 0;
+}
+
+// Spreads both sets of weights over grids for iu_conv2d_create. The integral
+// at a cell sums f at cell + offset, so the weight of an offset goes to the
+// kernel cell at minus the offset, wrapped. Offsets are dj ldp + di with
+// |di| <= pad, which is how they are split again.
+static struct iu_conv2d *build_conv(const struct iu_smoothlife *sl)
+{
+	int k, di, dj, count;
+	int nrows = sl->nrows, ncols = sl->ncols;
+	size_t cells = (size_t)nrows * ncols;
+	const int *offsets;
+	const float *weights;
+	float *kernels = calloc(2 * cells, sizeof(float));
+	struct iu_conv2d *conv;
+
+	if (kernels == NULL) {
+		return NULL;
+	}
+
+	for (k = 0; k < 2; k++) {
+		offsets = k == 0 ? sl->m_offsets : sl->n_offsets;
+		weights = k == 0 ? sl->m_weights : sl->n_weights;
+		count = k == 0 ? sl->nm : sl->nn;
+
+		while (count-- > 0) {
+			dj = (offsets[count] + sl->pad) / sl->ldp;
+			dj -= (offsets[count] + sl->pad) - dj * sl->ldp < 0;
+			di = offsets[count] - dj * sl->ldp;
+			kernels[k * cells + (size_t)((-dj % ncols + ncols) % ncols) * nrows + (-di % nrows + nrows) % nrows] += weights[count];
+		}
+	}
+
+	conv = iu_conv2d_create(nrows, ncols, kernels, 2);
+	free(kernels);
+
+	return conv;
+}
+
+//----------------------------------------------------------------------------
+// Functions for creating engines.
+//----------------------------------------------------------------------------
+
+void iu_smoothlife_default_params(struct iu_smoothlife_params *params)
+{
+	params->ri = SMOOTHLIFE_RI;
+	params->ra = SMOOTHLIFE_RA;
+	params->b1 = SMOOTHLIFE_B1;
+	params->b2 = SMOOTHLIFE_B2;
+	params->d1 = SMOOTHLIFE_D1;
+	params->d2 = SMOOTHLIFE_D2;
+	params->alpha_n = SMOOTHLIFE_ALPHA_N;
+	params->alpha_m = SMOOTHLIFE_ALPHA_M;
+	params->dt = 0;
+}
+
+struct iu_smoothlife *iu_smoothlife_create(int nrows, int ncols, const struct iu_smoothlife_params *params)
+{
+	struct iu_smoothlife *sl;
+	size_t cells = (size_t)nrows * ncols;
+
+	if (nrows <= 0 || ncols <= 0) {
+		return NULL;
+	}
+
+	sl = calloc(1, sizeof(*sl));
+
+	if (sl == NULL) {
+		return NULL;
+	}
+
+	sl->nrows = nrows;
+	sl->ncols = ncols;
+
+	if (params != NULL) {
+		sl->params = *params;
+	} else {
+		iu_smoothlife_default_params(&sl->params);
+	}
+
+	if (!(sl->params.ri > 0 && sl->params.ri < sl->params.ra)) {
+		iu_smoothlife_free(sl);
+		return NULL;
+	}
+
+	// Cells up to ra + 1/2 away carry weight.
+	sl->pad = (int)(sl->params.ra + 0.5f) + 1;
+	sl->ldp = nrows + 2 * sl->pad;
+
+	sl->field = calloc(cells, sizeof(float));
+	sl->m = malloc(cells * sizeof(float));
+	sl->n = malloc(cells * sizeof(float));
+	sl->padded = malloc((size_t)sl->ldp * (ncols + 2 * sl->pad) * sizeof(float));
+
+	if (sl->field == NULL || sl->m == NULL || sl->n == NULL || sl->padded == NULL || build_weights(sl) != 0) {
+		iu_smoothlife_free(sl);
+		return NULL;
+	}
+
+	if (iu_smoothlife_set_method(sl, SMOOTHLIFE_AUTO) != 0) {
+		iu_smoothlife_free(sl);
+		return NULL;
+	}
+
+	return sl;
+}
+
+void iu_smoothlife_free(struct iu_smoothlife *sl)
+{
+	if (sl == NULL) {
+		return;
+	}
+
+	free(sl->field);
+	free(sl->m);
+	free(sl->n);
+	free(sl->padded);
+	free(sl->m_offsets);
+	free(sl->m_weights);
+	free(sl->n_offsets);
+	free(sl->n_weights);
+	iu_conv2d_free(sl->conv);
+	free(sl);
+}
+
+int iu_smoothlife_set_method(struct iu_smoothlife *sl, int method)
+{
+	int fft = method == SMOOTHLIFE_FFT;
+	struct iu_conv2d *conv = NULL;
+
+	if (method != SMOOTHLIFE_DIRECT && method != SMOOTHLIFE_FFT && method != SMOOTHLIFE_AUTO) {
+		return -1;
+	}
+
+	if (method == SMOOTHLIFE_AUTO) {
+		fft = iu_conv2d_prefer_fft(sl->nrows, sl->ncols, sl->nm + sl->nn, 2);
+	}
+
+	if (fft && sl->conv == NULL) {
+		conv = build_conv(sl);
+
+		if (conv == NULL) {
+			return -1;
+		}
+	} else if (fft) {
+		conv = sl->conv;
+	} else {
+		iu_conv2d_free(sl->conv);
+	}
+
+	sl->conv = conv;
+	sl->method = method;
+
+	return 0;
+}
+
+//----------------------------------------------------------------------------
+// Functions for advancing engines.
+//----------------------------------------------------------------------------
+
+// Copies the field into the padded grid, wrapping rows and columns. The
+// padding may be wider than the grid, so runs are taken modulo its size.
+static void pad_field(struct iu_smoothlife *sl)
+{
+	int pi, pj, r, len;
+	int nrows = sl->nrows, ncols = sl->ncols, pad = sl->pad;
+	const float *col;
+	float *dst;
+
+	for (pj = 0; pj < ncols + 2 * pad; pj++) {
+		col = sl->field + (size_t)(((pj - pad) % ncols + ncols) % ncols) * nrows;
+		dst = sl->padded + (size_t)pj * sl->ldp;
+
+		for (pi = 0; pi < sl->ldp; pi += len) {
+			r = ((pi - pad) % nrows + nrows) % nrows;
+			len = nrows - r < sl->ldp - pi ? nrows - r : sl->ldp - pi;
+			iu_copy1d_ps(dst + pi, col + r, len);
+		}
+	}
+}
+
+void iu_smoothlife_integrals(struct iu_smoothlife *sl)
+{
+	int j;
+	size_t out;
+	const float *src;
+	float *outs[2];
+
+	if (sl->conv != NULL) {
+		outs[0] = sl->m;
+		outs[1] = sl->n;
+		iu_conv2d_apply(sl->conv, outs, sl->field);
+		return;
+	}
+
+	pad_field(sl);
+
+	for (j = 0; j < sl->ncols; j++) {
+		out = (size_t)j * sl->nrows;
+		src = sl->padded + (size_t)(j + sl->pad) * sl->ldp + sl->pad;
+
+		iu_stencil_ps(sl->m + out, src, sl->nrows, sl->m_offsets, sl->m_weights, sl->nm);
+		iu_stencil_ps(sl->n + out, src, sl->nrows, sl->n_offsets, sl->n_weights, sl->nn);
+	}
+}
+
+void iu_smoothlife_step(struct iu_smoothlife *sl)
+{
+	iu_smoothlife_integrals(sl);
+	iu_smoothlife_transition_ps(sl->field, sl->m, sl->n, sl->nrows * sl->ncols, &sl->params);
+}
@@ -0,0 +1,233 @@
+#include "sparse.h"
+#include "dispatch.h"
+#include "constants.h"
+#include <stdlib.h>
+
+//----------------------------------------------------------------------------
+// Helpers for building the row permutation.
+//----------------------------------------------------------------------------
+
+struct row_len {
+	int len;
+	int row;
+};
+
+// Longest rows first; ties keep their original order so the permutation is
+// the same on every platform.
+static int compare_row_len(const void *a, const void *b)
+{
+	const struct row_len *ra = a;
+	const struct row_len *rb = b;
+
+	if (ra->len != rb->len) {
+		return ra->len > rb->len ? -1 : 1;
+	}
+
+	return (ra->row > rb->row) - (ra->row < rb->row);
+}
+
+// Fill perm with the rows sorted by decreasing length in windows of sigma
+// rows, and chunkptr with the chunk offsets for chunks of chunk rows.
+// Returns -1 if memory cannot be allocated.
+static int build_sell_layout(int nrows, const int *rowptr, int sigma, int chunk, int *perm, int *chunkptr)
+{
+	struct row_len *rows;
+	int i, k, width, begin, end;
+
+	rows = malloc((nrows > 0 ? nrows : 1) * sizeof(*rows));
+
+	if (rows == NULL) {
+		return -1;
+	}
+
+	for (i = 0; i < nrows; i++) {
+		rows[i].len = rowptr[i + 1] - rowptr[i];
+		rows[i].row = i;
+	}
+
+	if (sigma > 1) {
+		for (begin = 0; begin < nrows; begin += sigma) {
+			end = begin + sigma < nrows ? begin + sigma : nrows;
+			qsort(rows + begin, end - begin, sizeof(*rows), compare_row_len);
+		}
+	}
+
+	chunkptr[0] = 0;
+
+	for (k = 0, begin = 0; begin < nrows; k++, begin += chunk) {
+		end = begin + chunk < nrows ? begin + chunk : nrows;
+		width = 0;
+
+		for (i = begin; i < end; i++) {
+			width = rows[i].len > width ? rows[i].len : width;
+		}
+
+		chunkptr[k + 1] = chunkptr[k] + width * chunk;
+	}
+
+	for (i = 0; i < nrows; i++) {
+		perm[i] = rows[i].row;
+	}
+
+	free(rows);
+
+	return 0;
+}
+
+//----------------------------------------------------------------------------
+// Functions for converting from CSR.
+//----------------------------------------------------------------------------
+
+struct iu_ssell *iu_ssell_from_csr(int nrows, int ncols, const int *rowptr, const int *colind, const float *values, int sigma)
+{
+	struct iu_ssell *a;
+	int i, j, k, row, len, dst;
+
+	a = calloc(1, sizeof(*a));
+
+	if (a == NULL) {
+		return NULL;
+	}
+
+	a->nrows = nrows;
+	a->ncols = ncols;
+	a->sigma = sigma;
+	a->nchunks = (nrows + SELL_CHUNK_PS - 1) / SELL_CHUNK_PS;
+	a->chunkptr = malloc((a->nchunks + 1) * sizeof(int));
+	a->perm = malloc((nrows > 0 ? nrows : 1) * sizeof(int));
+
+	if (a->chunkptr == NULL || a->perm == NULL || build_sell_layout(nrows, rowptr, sigma, SELL_CHUNK_PS, a->perm, a->chunkptr) != 0) {
+		iu_ssell_free(a);
+		return NULL;
+	}
+
+	// Padding values are zeroed by calloc and their columns set to -1, which
+	// the kernels skip instead of loading.
+	a->colind = malloc((a->chunkptr[a->nchunks] > 0 ? a->chunkptr[a->nchunks] : 1) * sizeof(int));
+	a->values = calloc(a->chunkptr[a->nchunks] > 0 ? a->chunkptr[a->nchunks] : 1, sizeof(float));
+
+	if (a->colind == NULL || a->values == NULL) {
+		iu_ssell_free(a);
+		return NULL;
+	}
+
+	for (i = 0; i < a->chunkptr[a->nchunks]; i++) {
+		a->colind[i] = -1;
+	}
+
+	for (i = 0; i < nrows; i++) {
+		k = i / SELL_CHUNK_PS;
+		row = a->perm[i];
+		len = rowptr[row + 1] - rowptr[row];
+
+		for (j = 0; j < len; j++) {
+			dst = a->chunkptr[k] + j * SELL_CHUNK_PS + i % SELL_CHUNK_PS;
+			a->colind[dst] = colind[rowptr[row] + j];
+			a->values[dst] = values[rowptr[row] + j];
+		}
+	}
+
+	return a;
+}
+
+struct iu_dsell *iu_dsell_from_csr(int nrows, int ncols, const int *rowptr, const int *colind, const double *values, int sigma)
+{
+	struct iu_dsell *a;
+	int i, j, k, row, len, dst;
+
+	a = calloc(1, sizeof(*a));
+
+	if (a == NULL) {
+		return NULL;
+	}
+
+	a->nrows = nrows;
+	a->ncols = ncols;
+	a->sigma = sigma;
+	a->nchunks = (nrows + SELL_CHUNK_PD - 1) / SELL_CHUNK_PD;
+	a->chunkptr = malloc((a->nchunks + 1) * sizeof(int));
+	a->perm = malloc((nrows > 0 ? nrows : 1) * sizeof(int));
+
+	if (a->chunkptr == NULL || a->perm == NULL || build_sell_layout(nrows, rowptr, sigma, SELL_CHUNK_PD, a->perm, a->chunkptr) != 0) {
+		iu_dsell_free(a);
+		return NULL;
+	}
+
+	// Padding values are zeroed by calloc and their columns set to -1, which
+	// the kernels skip instead of loading.
+	a->colind = malloc((a->chunkptr[a->nchunks] > 0 ? a->chunkptr[a->nchunks] : 1) * sizeof(int));
+	a->values = calloc(a->chunkptr[a->nchunks] > 0 ? a->chunkptr[a->nchunks] : 1, sizeof(double));
+
+	if (a->colind == NULL || a->values == NULL) {
+		iu_dsell_free(a);
+		return NULL;
+	}
+
+	for (i = 0; i < a->chunkptr[a->nchunks]; i++) {
+		a->colind[i] = -1;
+	}
+
+	for (i = 0; i < nrows; i++) {
+		k = i / SELL_CHUNK_PD;
+		row = a->perm[i];
+		len = rowptr[row + 1] - rowptr[row];
+
+		for (j = 0; j < len; j++) {
+			dst = a->chunkptr[k] + j * SELL_CHUNK_PD + i % SELL_CHUNK_PD;
+			a->colind[dst] = colind[rowptr[row] + j];
+			a->values[dst] = values[rowptr[row] + j];
+		}
+	}
+
+	return a;
+}
+
+void iu_ssell_free(struct iu_ssell *a)
+{
+	if (a == NULL) {
+		return;
+	}
+
+	free(a->chunkptr);
+	free(a->perm);
+	free(a->colind);
+	free(a->values);
+	free(a);
+}
+
+void iu_dsell_free(struct iu_dsell *a)
+{
+	if (a == NULL) {
+		return;
+	}
+
+	free(a->chunkptr);
+	free(a->perm);
+	free(a->colind);
+	free(a->values);
+	free(a);
+}
+
+//----------------------------------------------------------------------------
+// Sparse matrix-vector products.
+//----------------------------------------------------------------------------
+
+void iu_sspmv_csr(int nrows, const int *rowptr, const int *colind, const float *values, const float *x, float *y)
+{
+	iu_scsrmv(nrows, rowptr, colind, values, x, y);
+}
+
+void iu_dspmv_csr(int nrows, const int *rowptr, const int *colind, const double *values, const double *x, double *y)
+{
+	iu_dcsrmv(nrows, rowptr, colind, values, x, y);
+}
+
+void iu_sspmv_sell(const struct iu_ssell *a, const float *x, float *y)
+{
+	iu_ssellmv(a->nrows, a->chunkptr, a->perm, a->colind, a->values, x, y);
+}
+
+void iu_dspmv_sell(const struct iu_dsell *a, const double *x, double *y)
+{
+	iu_dsellmv(a->nrows, a->chunkptr, a->perm, a->colind, a->values, x, y);
+}
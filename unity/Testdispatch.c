@@ -0,0 +1,1074 @@
+#include "unity.h"
+#include "dispatch.h"
+#include "intrinsics_utils.h"
+#include "constants.h"
+#include <stdlib.h>
+#include <stdint.h>
+#include <float.h>
+#include <math.h>
+
+#define FLT_DELTA (2e2 * FLT_EPSILON)
+#define DBL_DELTA (2e2 * DBL_EPSILON)
+
+#define NUM_ISAS 3
+
+// Global variables for the arrays handed to the dispatched kernels.
+float *xf = NULL, *yf = NULL;
+double *xd = NULL, *yd = NULL;
+int *xindices = NULL, *yindices = NULL;
+
+// Array dimensions. The odd length exercises the tail of every kernel.
+int m = 1003;
+
+// Random seed for srand call.
+unsigned random_seed = 0;
+
+// Forward declarations needed to use Unity.
+void setUp(void);
+void tearDown(void);
+
+// Forward declarations for initializing arrays.
+void random_farray(float *, int, float, float);
+void random_darray(double *, int, double, double);
+void random_index_array(int *, int);
+
+// Forward declarations for tests.
+void test_dispatch_default_isa(void);
+void test_dispatch_set_value(void);
+void test_dispatch_fdot(void);
+void test_dispatch_ddot(void);
+void test_dispatch_copy1d(void);
+void test_dispatch_copy2d(void);
+void test_dispatch_copy2d_strategy(void);
+void test_dispatch_copy2d_ld(void);
+void test_dispatch_gemv(void);
+void test_dispatch_gather(void);
+void test_dispatch_extrema(void);
+void test_dispatch_padded(void);
+void test_dispatch_padded_sizes(void);
+void test_dispatch_int_dot(void);
+void test_dispatch_half(void);
+void test_dispatch_transpose(void);
+void test_dispatch_reduce2d(void);
+
+int main(int argc, char *argv[])
+{
+    if (argc > 1) {
+        m = strtol(argv[1], NULL, 10);
+    }
+
+    if (argc > 2) {
+        random_seed = strtoul(argv[2], NULL, 10);
+    }
+
+    UNITY_BEGIN();
+
+    RUN_TEST(test_dispatch_default_isa);
+    RUN_TEST(test_dispatch_set_value);
+    RUN_TEST(test_dispatch_fdot);
+    RUN_TEST(test_dispatch_ddot);
+    RUN_TEST(test_dispatch_copy1d);
+    RUN_TEST(test_dispatch_copy2d);
+    RUN_TEST(test_dispatch_copy2d_strategy);
+    RUN_TEST(test_dispatch_copy2d_ld);
+    RUN_TEST(test_dispatch_gemv);
+    RUN_TEST(test_dispatch_gather);
+    RUN_TEST(test_dispatch_extrema);
+    RUN_TEST(test_dispatch_padded);
+    RUN_TEST(test_dispatch_padded_sizes);
+    RUN_TEST(test_dispatch_int_dot);
+    RUN_TEST(test_dispatch_half);
+    RUN_TEST(test_dispatch_transpose);
+    RUN_TEST(test_dispatch_reduce2d);
+
+    return UNITY_END();
+}
+
+void setUp(void)
+{
+    srand(random_seed);
+
+    xf = calloc(2*m, sizeof(float));
+    xd = calloc(2*m, sizeof(double));
+    xindices = calloc(2*m, sizeof(int));
+
+    if (xf != NULL && xd != NULL && xindices != NULL) {
+        yf = xf + m;
+        yd = xd + m;
+        yindices = xindices + m;
+    } else {
+        tearDown();
+    }
+}
+
+void tearDown(void)
+{
+    free(xf);
+    free(xd);
+    free(xindices);
+
+    xf = yf = NULL;
+    xd = yd = NULL;
+    xindices = yindices = NULL;
+}
+
+void random_farray(float *x, int len, float a, float b)
+{
+    for (int i = 0; i < len; i++) {
+        x[i] = a + (b - a) * ((float)rand() / RAND_MAX);
+    }
+}
+
+void random_darray(double *x, int len, double a, double b)
+{
+    for (int i = 0; i < len; i++) {
+        x[i] = a + (b - a) * ((double)rand() / RAND_MAX);
+    }
+}
+
+void random_index_array(int *indices, int len)
+{
+    int j;
+    int temp;
+
+    for (int i = 0; i < len; i++) {
+        indices[i] = i;
+    }
+
+    for (int i = len - 1; i >= 0; i--) {
+        j = rand() % (i + 1);
+        temp = indices[i];
+        indices[i] = indices[j];
+        indices[j] = temp;
+    }
+}
+
+//----------------------------------------------------------------------------
+// Tests for the dispatch layer. Every kernel is checked against a serial
+// reference under each instruction set the host supports.
+//----------------------------------------------------------------------------
+
+void test_dispatch_default_isa(void)
+{
+    int isa = iu_dispatch_isa();
+
+    TEST_PRINTF("bound isa:                        %s", iu_dispatch_isa_name());
+
+    // The constructor binds the widest instruction set available, so nothing
+    // wider may be accepted.
+    for (int wider = isa + 1; wider < NUM_ISAS; wider++) {
+        TEST_ASSERT_EQUAL_INT(-1, iu_dispatch_set_isa(wider));
+    }
+
+    TEST_ASSERT_EQUAL_INT(0, iu_dispatch_set_isa(IU_ISA_SSE));
+    TEST_ASSERT_EQUAL_INT(0, iu_dispatch_set_isa(isa));
+    TEST_ASSERT_EQUAL_INT(isa, iu_dispatch_isa());
+}
+
+void test_dispatch_set_value(void)
+{
+    int isa = iu_dispatch_isa();
+
+    for (int k = 0; k < NUM_ISAS; k++) {
+        if (iu_dispatch_set_isa(k) != 0) {
+            continue;
+        }
+
+        for (int len = 0; len <= 19; len++) {
+            for (int i = 0; i <= len; i++) {
+                xf[i] = 0;
+                xd[i] = 0;
+            }
+
+            iu_sset_value(xf, len, 2.5f);
+            iu_dset_value(xd, len, -1.5);
+
+            for (int i = 0; i < len; i++) {
+                TEST_ASSERT_EQUAL_FLOAT(2.5f, xf[i]);
+                TEST_ASSERT_EQUAL_DOUBLE(-1.5, xd[i]);
+            }
+
+            TEST_ASSERT_EQUAL_FLOAT(0.0f, xf[len]);
+            TEST_ASSERT_EQUAL_DOUBLE(0.0, xd[len]);
+        }
+    }
+
+    iu_dispatch_set_isa(isa);
+}
+
+void test_dispatch_fdot(void)
+{
+    int isa = iu_dispatch_isa();
+    double exact, exact_indexed, exact_indexed2;
+
+    random_farray(xf, m, -1.0f, 1.0f);
+    random_farray(yf, m, -1.0f, 1.0f);
+    random_index_array(xindices, m);
+    random_index_array(yindices, m);
+
+    exact = exact_indexed = exact_indexed2 = 0;
+
+    for (int i = 0; i < m; i++) {
+        exact += (double)xf[i] * yf[i];
+        exact_indexed += (double)xf[xindices[i]] * yf[i];
+        exact_indexed2 += (double)xf[xindices[i]] * yf[yindices[i]];
+    }
+
+    for (int k = 0; k < NUM_ISAS; k++) {
+        if (iu_dispatch_set_isa(k) != 0) {
+            continue;
+        }
+
+        TEST_PRINTF("%-8s fdot:                    %f", iu_dispatch_isa_name(), iu_fdot(xf, yf, m));
+
+        TEST_ASSERT_FLOAT_WITHIN(m * FLT_DELTA, exact, iu_fdot(xf, yf, m));
+        TEST_ASSERT_FLOAT_WITHIN(m * FLT_DELTA, exact_indexed, iu_fdot_indexed(xf, xindices, yf, m));
+        TEST_ASSERT_FLOAT_WITHIN(m * FLT_DELTA, exact_indexed2, iu_fdot_indexed2(xf, xindices, yf, yindices, m));
+    }
+
+    iu_dispatch_set_isa(isa);
+}
+
+void test_dispatch_ddot(void)
+{
+    int isa = iu_dispatch_isa();
+    double exact, exact_indexed, exact_indexed2;
+
+    random_darray(xd, m, -1.0, 1.0);
+    random_darray(yd, m, -1.0, 1.0);
+    random_index_array(xindices, m);
+    random_index_array(yindices, m);
+
+    exact = exact_indexed = exact_indexed2 = 0;
+
+    for (int i = 0; i < m; i++) {
+        exact += xd[i] * yd[i];
+        exact_indexed += xd[xindices[i]] * yd[i];
+        exact_indexed2 += xd[xindices[i]] * yd[yindices[i]];
+    }
+
+    for (int k = 0; k < NUM_ISAS; k++) {
+        if (iu_dispatch_set_isa(k) != 0) {
+            continue;
+        }
+
+        TEST_PRINTF("%-8s ddot:                    %lf", iu_dispatch_isa_name(), iu_ddot(xd, yd, m));
+
+        TEST_ASSERT_DOUBLE_WITHIN(m * DBL_DELTA, exact, iu_ddot(xd, yd, m));
+        TEST_ASSERT_DOUBLE_WITHIN(m * DBL_DELTA, exact_indexed, iu_ddot_indexed(xd, xindices, yd, m));
+        TEST_ASSERT_DOUBLE_WITHIN(m * DBL_DELTA, exact_indexed2, iu_ddot_indexed2(xd, xindices, yd, yindices, m));
+    }
+
+    iu_dispatch_set_isa(isa);
+}
+
+void test_dispatch_copy1d(void)
+{
+    int isa = iu_dispatch_isa();
+
+    random_farray(xf, m, -1.0f, 1.0f);
+    random_index_array(xindices, m);
+
+    for (int k = 0; k < NUM_ISAS; k++) {
+        if (iu_dispatch_set_isa(k) != 0) {
+            continue;
+        }
+
+        for (int i = 0; i < m; i++) {
+            yf[i] = 0;
+            yindices[i] = -1;
+        }
+
+        iu_copy1d_ps(yf, xf, m);
+        iu_copy1d_epi32(yindices, xindices, m);
+
+        TEST_ASSERT_EQUAL_FLOAT_ARRAY(xf, yf, m);
+        TEST_ASSERT_EQUAL_INT32_ARRAY(xindices, yindices, m);
+    }
+
+    iu_dispatch_set_isa(isa);
+}
+
+void test_dispatch_copy2d(void)
+{
+    int isa = iu_dispatch_isa();
+    int nrows = 31;
+    int ncols = 29;
+    int iind[] = {0, 2, 3, 5, 7, 11, 13, 17, 19, 23, 29};
+    int jind[] = {1, 4, 9, 16, 25};
+    int numi = sizeof(iind) / sizeof(iind[0]);
+    int numj = sizeof(jind) / sizeof(jind[0]);
+    int kind[sizeof(iind) / sizeof(iind[0]) * sizeof(jind) / sizeof(jind[0])];
+    float dst[sizeof(iind) / sizeof(iind[0]) * sizeof(jind) / sizeof(jind[0])];
+
+    random_farray(xf, nrows * ncols, -1.0f, 1.0f);
+
+    for (int k = 0; k < NUM_ISAS; k++) {
+        if (iu_dispatch_set_isa(k) != 0) {
+            continue;
+        }
+
+        iu_copy2d_epi32(kind, nrows, iind, jind, numi, numj);
+        iu_copy2d_indexed_ps(dst, xf, nrows, iind, jind, numi, numj);
+
+        for (int j = 0; j < numj; j++) {
+            for (int i = 0; i < numi; i++) {
+                TEST_ASSERT_EQUAL_INT(jind[j] * nrows + iind[i], kind[j * numi + i]);
+                TEST_ASSERT_EQUAL_FLOAT(xf[jind[j] * nrows + iind[i]], dst[j * numi + i]);
+            }
+        }
+    }
+
+    iu_dispatch_set_isa(isa);
+}
+
+// Every strategy under every instruction set, with caches small enough that
+// the tiles split both the rows and the columns unevenly.
+void test_dispatch_copy2d_strategy(void)
+{
+    int isa = iu_dispatch_isa();
+    int strategy = iu_copy2d_strategy();
+    int strategies[] = {COPY2D_CONTIGUOUS, COPY2D_SPLIT, COPY2D_TILED};
+    int nrows = 80;
+    int ncols = 12;
+    int numi = 75;
+    int numj = 7;
+    int iind[75], jind[7];
+    int *kind = malloc(numi * numj * sizeof(int));
+    float *dst = malloc(numi * numj * sizeof(float));
+    size_t l1, l2;
+
+    TEST_ASSERT_NOT_NULL(kind);
+    TEST_ASSERT_NOT_NULL(dst);
+    TEST_ASSERT_EQUAL_INT(COPY2D_TILED, strategy);
+    TEST_ASSERT_EQUAL_INT(-1, iu_set_copy2d_strategy(3));
+    TEST_ASSERT_EQUAL_INT(strategy, iu_copy2d_strategy());
+
+    for (int i = 0; i < numi; i++) {
+        iind[i] = rand() % nrows;
+    }
+
+    for (int j = 0; j < numj; j++) {
+        jind[j] = rand() % ncols;
+    }
+
+    random_farray(xf, nrows * ncols, -1.0f, 1.0f);
+
+    // 16 rows and 4 columns per tile, which splits numj = 7 unevenly.
+    iu_set_copy2d_cache(256, 512);
+    iu_copy2d_cache(&l1, &l2);
+    TEST_ASSERT_TRUE(l1 == 256 && l2 == 512);
+
+    for (int s = 0; s < 3; s++) {
+        TEST_ASSERT_EQUAL_INT(0, iu_set_copy2d_strategy(strategies[s]));
+
+        for (int k = 0; k < NUM_ISAS; k++) {
+            if (iu_dispatch_set_isa(k) != 0) {
+                continue;
+            }
+
+            iu_copy2d_epi32(kind, nrows, iind, jind, numi, numj);
+            iu_copy2d_indexed_ps(dst, xf, nrows, iind, jind, numi, numj);
+
+            for (int j = 0; j < numj; j++) {
+                for (int i = 0; i < numi; i++) {
+                    TEST_ASSERT_EQUAL_INT(jind[j] * nrows + iind[i], kind[j * numi + i]);
+                    TEST_ASSERT_EQUAL_FLOAT(xf[jind[j] * nrows + iind[i]], dst[j * numi + i]);
+                }
+            }
+        }
+    }
+
+    iu_set_copy2d_cache(0, 0);
+    iu_copy2d_cache(&l1, &l2);
+    TEST_ASSERT_TRUE(l1 > 256 && l2 > 512);
+
+    free(kind);
+    free(dst);
+    iu_set_copy2d_strategy(strategy);
+    iu_dispatch_set_isa(isa);
+}
+
+void test_dispatch_copy2d_ld(void)
+{
+    int isa = iu_dispatch_isa();
+    int gather = iu_dispatch_gather();
+    int strategy = iu_copy2d_strategy();
+    int strategies[] = {COPY2D_CONTIGUOUS, COPY2D_SPLIT, COPY2D_TILED};
+    char orders[] = {COLUMN_MAJOR_ORDER, ROW_MAJOR_ORDER};
+    int nrows = 61;
+    int ncols = 53;
+    int ld = 67;
+    int numi = 45;
+    int numj = 23;
+    int lddst = 50;
+    int iind[45], jind[23];
+    float *src = malloc(ld * ld * sizeof(float));
+    float *dst = malloc(lddst * lddst * sizeof(float));
+    int *kind = malloc(lddst * lddst * sizeof(int));
+
+    TEST_ASSERT_NOT_NULL(src);
+    TEST_ASSERT_NOT_NULL(dst);
+    TEST_ASSERT_NOT_NULL(kind);
+
+    for (int i = 0; i < numi; i++) {
+        iind[i] = rand() % nrows;
+    }
+
+    for (int j = 0; j < numj; j++) {
+        jind[j] = rand() % ncols;
+    }
+
+    random_farray(src, ld * ld, -1.0f, 1.0f);
+    iu_set_copy2d_cache(256, 512);
+
+    for (int s = 0; s < 3; s++) {
+        TEST_ASSERT_EQUAL_INT(0, iu_set_copy2d_strategy(strategies[s]));
+
+        for (int k = 0; k < NUM_ISAS; k++) {
+            if (iu_dispatch_set_isa(k) != 0) {
+                continue;
+            }
+
+            for (int mode = IU_GATHER_HARDWARE; mode <= IU_GATHER_EMULATED; mode++) {
+                TEST_ASSERT_EQUAL_INT(0, iu_dispatch_set_gather(mode));
+
+                for (int o = 0; o < 2; o++) {
+                    int row_major = orders[o] == ROW_MAJOR_ORDER;
+
+                    for (int i = 0; i < lddst * lddst; i++) {
+                        dst[i] = -2.0f;
+                        kind[i] = -1;
+                    }
+
+                    iu_copy2d_epi32_ld(orders[o], kind, lddst, ld, iind, jind, numi, numj);
+                    iu_copy2d_indexed_ps_ld(orders[o], dst, lddst, src, ld, iind, jind, numi, numj);
+
+                    for (int j = 0; j < numj; j++) {
+                        for (int i = 0; i < numi; i++) {
+                            int didx = row_major ? i * lddst + j : j * lddst + i;
+                            int sidx = row_major ? iind[i] * ld + jind[j] : jind[j] * ld + iind[i];
+
+                            TEST_ASSERT_EQUAL_INT(sidx, kind[didx]);
+                            TEST_ASSERT_EQUAL_FLOAT(src[sidx], dst[didx]);
+                        }
+                    }
+
+                    // The padding past each line is left alone.
+                    for (int l = 0; l < (row_major ? numi : numj); l++) {
+                        for (int p = row_major ? numj : numi; p < lddst; p++) {
+                            TEST_ASSERT_EQUAL_INT(-1, kind[l * lddst + p]);
+                            TEST_ASSERT_EQUAL_FLOAT(-2.0f, dst[l * lddst + p]);
+                        }
+                    }
+                }
+
+                // Unknown orders do nothing.
+                kind[0] = -1;
+                dst[0] = -2.0f;
+                iu_copy2d_epi32_ld('X', kind, lddst, ld, iind, jind, numi, numj);
+                iu_copy2d_indexed_ps_ld('X', dst, lddst, src, ld, iind, jind, numi, numj);
+                TEST_ASSERT_EQUAL_INT(-1, kind[0]);
+                TEST_ASSERT_EQUAL_FLOAT(-2.0f, dst[0]);
+            }
+        }
+    }
+
+    iu_set_copy2d_cache(0, 0);
+    free(src);
+    free(dst);
+    free(kind);
+    iu_set_copy2d_strategy(strategy);
+    iu_dispatch_set_isa(isa);
+    iu_dispatch_set_gather(gather);
+}
+
+void test_dispatch_gemv(void)
+{
+    int isa = iu_dispatch_isa();
+    int nrows = 37;
+    int ncols = 29;
+    int lda = 41;
+    char orders[] = {ROW_MAJOR_ORDER, COLUMN_MAJOR_ORDER};
+    float *af = malloc(lda * lda * sizeof(float));
+    double *ad = malloc(lda * lda * sizeof(double));
+    float expf[37], gotf[37];
+    double expd[37], gotd[37];
+
+    TEST_ASSERT_NOT_NULL(af);
+    TEST_ASSERT_NOT_NULL(ad);
+
+    random_farray(af, lda * lda, -1.0f, 1.0f);
+    random_darray(ad, lda * lda, -1.0, 1.0);
+    random_farray(xf, ncols, -1.0f, 1.0f);
+    random_darray(xd, ncols, -1.0, 1.0);
+
+    for (int o = 0; o < 2; o++) {
+        for (int r = 0; r < nrows; r++) {
+            double sumf = 0, sumd = 0;
+
+            for (int c = 0; c < ncols; c++) {
+                int idx = orders[o] == ROW_MAJOR_ORDER ? r * lda + c : r + c * lda;
+
+                sumf += (double)af[idx] * xf[c];
+                sumd += ad[idx] * xd[c];
+            }
+
+            expf[r] = (float)sumf;
+            expd[r] = sumd;
+        }
+
+        for (int k = 0; k < NUM_ISAS; k++) {
+            if (iu_dispatch_set_isa(k) != 0) {
+                continue;
+            }
+
+            iu_sgemv(orders[o], nrows, ncols, af, lda, xf, gotf);
+            iu_dgemv(orders[o], nrows, ncols, ad, lda, xd, gotd);
+
+            TEST_ASSERT_FLOAT_ARRAY_WITHIN(ncols * FLT_DELTA, expf, gotf, nrows);
+            TEST_ASSERT_DOUBLE_ARRAY_WITHIN(ncols * DBL_DELTA, expd, gotd, nrows);
+        }
+    }
+
+    iu_dispatch_set_isa(isa);
+
+    free(af);
+    free(ad);
+}
+
+// Both gather paths must give the same results under every instruction set,
+// and switching paths must leave the instruction set alone.
+void test_dispatch_gather(void)
+{
+    int isa = iu_dispatch_isa();
+    int gather = iu_dispatch_gather();
+    float fresult[2];
+    double dresult[2];
+    float dst[2][64];
+    int column = 0;
+
+    TEST_PRINTF("bound gather:                     %s", iu_dispatch_gather_name());
+
+    TEST_ASSERT_EQUAL_INT(-1, iu_dispatch_set_gather(2));
+    TEST_ASSERT_EQUAL_INT(gather, iu_dispatch_gather());
+
+    random_farray(xf, m, -1.0f, 1.0f);
+    random_farray(yf, m, -1.0f, 1.0f);
+    random_darray(xd, m, -1.0, 1.0);
+    random_darray(yd, m, -1.0, 1.0);
+    random_index_array(xindices, m);
+    random_index_array(yindices, m);
+
+    for (int k = 0; k < NUM_ISAS; k++) {
+        if (iu_dispatch_set_isa(k) != 0) {
+            continue;
+        }
+
+        for (int len = 0; len <= 64; len++) {
+            for (int mode = IU_GATHER_HARDWARE; mode <= IU_GATHER_EMULATED; mode++) {
+                TEST_ASSERT_EQUAL_INT(0, iu_dispatch_set_gather(mode));
+                TEST_ASSERT_EQUAL_INT(k, iu_dispatch_isa());
+
+                fresult[mode] = iu_fdot_indexed2(xf, xindices, yf, yindices, len);
+                dresult[mode] = iu_ddot_indexed(xd, xindices, yd, len);
+                iu_copy2d_indexed_ps(dst[mode], xf, m, xindices, &column, len, 1);
+            }
+
+            TEST_ASSERT_FLOAT_WITHIN((len + 1) * FLT_DELTA, fresult[0], fresult[1]);
+            TEST_ASSERT_DOUBLE_WITHIN((len + 1) * DBL_DELTA, dresult[0], dresult[1]);
+
+            // Unity rejects empty array comparisons.
+            if (len > 0) {
+                TEST_ASSERT_EQUAL_FLOAT_ARRAY(dst[0], dst[1], len);
+            }
+        }
+    }
+
+    iu_dispatch_set_gather(gather);
+    iu_dispatch_set_isa(isa);
+}
+
+// Values are drawn from a few levels so extrema repeat; the arg functions
+// must report the first occurrence for every tail length.
+void test_dispatch_extrema(void)
+{
+    int isa = iu_dispatch_isa();
+    int maxlen = m < 300 ? m : 300;
+
+    for (int len = 0; len <= maxlen; len++) {
+        float fmin = INFINITY, fmax = -INFINITY;
+        double dmin = INFINITY, dmax = -INFINITY;
+        int fargmin = -1, fargmax = -1, dargmin = -1, dargmax = -1;
+
+        for (int i = 0; i < len; i++) {
+            xf[i] = (float)(rand() % 17 - 8);
+            xd[i] = (double)(rand() % 17 - 8) / 3;
+
+            if (xf[i] < fmin) { fmin = xf[i]; fargmin = i; }
+            if (xf[i] > fmax) { fmax = xf[i]; fargmax = i; }
+            if (xd[i] < dmin) { dmin = xd[i]; dargmin = i; }
+            if (xd[i] > dmax) { dmax = xd[i]; dargmax = i; }
+        }
+
+        for (int k = 0; k < NUM_ISAS; k++) {
+            if (iu_dispatch_set_isa(k) != 0) {
+                continue;
+            }
+
+            TEST_ASSERT_EQUAL_FLOAT(fmin, iu_smin(xf, len));
+            TEST_ASSERT_EQUAL_FLOAT(fmax, iu_smax(xf, len));
+            TEST_ASSERT_EQUAL_INT(fargmin, iu_sargmin(xf, len));
+            TEST_ASSERT_EQUAL_INT(fargmax, iu_sargmax(xf, len));
+
+            TEST_ASSERT_EQUAL_DOUBLE(dmin, iu_dmin(xd, len));
+            TEST_ASSERT_EQUAL_DOUBLE(dmax, iu_dmax(xd, len));
+            TEST_ASSERT_EQUAL_INT(dargmin, iu_dargmin(xd, len));
+            TEST_ASSERT_EQUAL_INT(dargmax, iu_dargmax(xd, len));
+        }
+    }
+
+    // Arrays of a single infinite value, where the padding of the masked
+    // tails ties with every element.
+    for (int i = 0; i < maxlen; i++) {
+        xf[i] = INFINITY;
+        xd[i] = -INFINITY;
+    }
+
+    for (int k = 0; k < NUM_ISAS; k++) {
+        if (iu_dispatch_set_isa(k) != 0) {
+            continue;
+        }
+
+        for (int len = 1; len <= 40 && len <= maxlen; len++) {
+            TEST_ASSERT_EQUAL_INT(0, iu_sargmin(xf, len));
+            TEST_ASSERT_EQUAL_INT(0, iu_dargmax(xd, len));
+        }
+    }
+
+    iu_dispatch_set_isa(isa);
+}
+
+// The padded kernels read and write whole registers, so every length must
+// agree with a serial reference and leave the padding of the output zero.
+void test_dispatch_padded(void)
+{
+    int isa = iu_dispatch_isa();
+    int gather = iu_dispatch_gather();
+    int maxlen = m < 200 ? m : 200;
+
+    for (int len = 0; len <= maxlen; len++) {
+        size_t flen = iu_padded_length(len, sizeof(float));
+        size_t dlen = iu_padded_length(len, sizeof(double));
+        float *fx = iu_alloc_padded(len, sizeof(float));
+        float *fy = iu_alloc_padded(len, sizeof(float));
+        float *fz = iu_alloc_padded(len, sizeof(float));
+        double *dx = iu_alloc_padded(len, sizeof(double));
+        double *dy = iu_alloc_padded(len, sizeof(double));
+        double *dz = iu_alloc_padded(len, sizeof(double));
+        int *indices = iu_alloc_padded(len, sizeof(int));
+        int *kind = iu_alloc_padded(len, sizeof(int));
+        double fexact = 0, fexact_indexed = 0;
+        double dexact = 0, dexact_indexed = 0;
+
+        TEST_ASSERT_NOT_NULL(fx);
+        TEST_ASSERT_EQUAL_INT(0, (size_t)fx % PADDED_ALIGNMENT);
+        TEST_ASSERT_EQUAL_INT(0, flen * sizeof(float) % PADDED_ALIGNMENT);
+
+        random_farray(fx, len, -1.0f, 1.0f);
+        random_farray(fy, len, -1.0f, 1.0f);
+        random_darray(dx, len, -1.0, 1.0);
+        random_darray(dy, len, -1.0, 1.0);
+        random_index_array(indices, len);
+
+        for (int i = 0; i < len; i++) {
+            fexact += (double)fx[i] * fy[i];
+            fexact_indexed += (double)fx[indices[i]] * fy[i];
+            dexact += dx[i] * dy[i];
+            dexact_indexed += dx[indices[i]] * dy[i];
+        }
+
+        for (int k = 0; k < NUM_ISAS; k++) {
+            if (iu_dispatch_set_isa(k) != 0) {
+                continue;
+            }
+
+            TEST_ASSERT_FLOAT_WITHIN(len * FLT_DELTA + FLT_MIN, fexact, iu_fdot_padded(fx, fy, len));
+            TEST_ASSERT_DOUBLE_WITHIN(len * DBL_DELTA + DBL_MIN, dexact, iu_ddot_padded(dx, dy, len));
+
+            for (int mode = IU_GATHER_HARDWARE; mode <= IU_GATHER_EMULATED; mode++) {
+                TEST_ASSERT_EQUAL_INT(0, iu_dispatch_set_gather(mode));
+                TEST_ASSERT_FLOAT_WITHIN(len * FLT_DELTA + FLT_MIN, fexact_indexed, iu_fdot_indexed_padded(fx, indices, fy, len));
+                TEST_ASSERT_DOUBLE_WITHIN(len * DBL_DELTA + DBL_MIN, dexact_indexed, iu_ddot_indexed_padded(dx, indices, dy, len));
+            }
+
+            iu_dispatch_set_gather(gather);
+
+            iu_copy1d_ps_padded(fz, fx, len);
+            iu_copy1d_epi32_padded(kind, indices, len);
+
+            for (int i = 0; i < len; i++) {
+                TEST_ASSERT_EQUAL_FLOAT(fx[i], fz[i]);
+                TEST_ASSERT_EQUAL_INT(indices[i], kind[i]);
+            }
+
+            iu_sset_value_padded(fz, len, 0.5f);
+            iu_dset_value_padded(dz, len, 0.5);
+
+            for (size_t i = 0; i < flen; i++) {
+                TEST_ASSERT_EQUAL_FLOAT((int)i < len ? 0.5f : 0.0f, fz[i]);
+            }
+
+            for (size_t i = 0; i < dlen; i++) {
+                TEST_ASSERT_EQUAL_DOUBLE((int)i < len ? 0.5 : 0.0, dz[i]);
+            }
+
+            TEST_ASSERT_FLOAT_WITHIN(FLT_DELTA, 0.25f * len, iu_fdot_padded(fz, fz, len));
+            TEST_ASSERT_DOUBLE_WITHIN(DBL_DELTA, 0.25 * len, iu_ddot_padded(dz, dz, len));
+        }
+
+        iu_free_padded(fx);
+        iu_free_padded(fy);
+        iu_free_padded(fz);
+        iu_free_padded(dx);
+        iu_free_padded(dy);
+        iu_free_padded(dz);
+        iu_free_padded(indices);
+        iu_free_padded(kind);
+    }
+
+    iu_dispatch_set_isa(isa);
+}
+
+// Element sizes that do not divide the alignment, or exceed it, still get
+// whole aligned blocks that hold at least the requested elements.
+void test_dispatch_padded_sizes(void)
+{
+    size_t sizes[] = {1, 12, 24, 64, 128};
+    int nsizes = sizeof(sizes) / sizeof(sizes[0]);
+
+    for (int s = 0; s < nsizes; s++) {
+        for (size_t n = 0; n <= 9; n++) {
+            size_t size = sizes[s];
+            size_t bytes = (n * size + PADDED_ALIGNMENT - 1) / PADDED_ALIGNMENT * PADDED_ALIGNMENT;
+            size_t len = iu_padded_length(n, size);
+            unsigned char *x = iu_alloc_padded(n, size);
+
+            TEST_ASSERT_NOT_NULL(x);
+            TEST_ASSERT_EQUAL_INT(0, (size_t)x % PADDED_ALIGNMENT);
+            TEST_ASSERT_TRUE(len >= n);
+            TEST_ASSERT_TRUE(len == bytes / size);
+
+            for (size_t i = 0; i < bytes; i++) {
+                TEST_ASSERT_EQUAL_INT(0, x[i]);
+            }
+
+            iu_free_padded(x);
+        }
+    }
+
+    // Byte counts that overflow once rounded up are refused rather than
+    // wrapped around to a short buffer.
+    TEST_ASSERT_NULL(iu_alloc_padded(SIZE_MAX, 1));
+    TEST_ASSERT_NULL(iu_alloc_padded(SIZE_MAX / 8 + 1, 8));
+}
+
+// Integer dot products are exact, including at the extremes of each type
+// where madd_epi16 and 32-bit accumulators could wrap.
+void test_dispatch_int_dot(void)
+{
+    int isa = iu_dispatch_isa();
+    int maxlen = m < 300 ? m : 300;
+    int16_t *x16 = malloc(maxlen * sizeof(int16_t));
+    int16_t *y16 = malloc(maxlen * sizeof(int16_t));
+    uint8_t *xu8 = malloc(maxlen * sizeof(uint8_t));
+    int8_t *yi8 = malloc(maxlen * sizeof(int8_t));
+    int *perm = malloc((maxlen + 1) * sizeof(int));
+
+    TEST_ASSERT_NOT_NULL(perm);
+    TEST_ASSERT_NOT_NULL(x16);
+    TEST_ASSERT_NOT_NULL(y16);
+    TEST_ASSERT_NOT_NULL(xu8);
+    TEST_ASSERT_NOT_NULL(yi8);
+
+    for (int extreme = 0; extreme < 2; extreme++) {
+        for (int i = 0; i < maxlen; i++) {
+            xindices[i] = extreme ? INT32_MIN : rand() - RAND_MAX / 2;
+            yindices[i] = extreme ? -(1 << 20) : rand() - RAND_MAX / 2;
+            x16[i] = extreme ? INT16_MIN : (int16_t)rand();
+            y16[i] = extreme ? INT16_MIN : (int16_t)rand();
+            xu8[i] = extreme ? UINT8_MAX : (uint8_t)rand();
+            yi8[i] = extreme ? INT8_MIN : (int8_t)rand();
+        }
+
+        for (int len = 0; len <= maxlen; len++) {
+            int64_t exact32 = 0, exact16 = 0, exact8 = 0;
+            int64_t indexed32 = 0, indexed16 = 0, indexed8 = 0;
+
+            random_index_array(perm, len);
+
+            for (int i = 0; i < len; i++) {
+                int k = perm[i];
+
+                exact32 += (int64_t)xindices[i] * yindices[i];
+                exact16 += (int64_t)x16[i] * y16[i];
+                exact8 += (int64_t)xu8[i] * yi8[i];
+                indexed32 += (int64_t)xindices[k] * yindices[i];
+                indexed16 += (int64_t)x16[k] * y16[i];
+                indexed8 += (int64_t)xu8[k] * yi8[i];
+            }
+
+            for (int k = 0; k < NUM_ISAS; k++) {
+                if (iu_dispatch_set_isa(k) != 0) {
+                    continue;
+                }
+
+                TEST_ASSERT_EQUAL_INT64(exact32, iu_dot_epi32(xindices, yindices, len));
+                TEST_ASSERT_EQUAL_INT64(exact16, iu_dot_epi16(x16, y16, len));
+                TEST_ASSERT_EQUAL_INT64(exact8, iu_dot_u8i8(xu8, yi8, len));
+                TEST_ASSERT_EQUAL_INT64(indexed32, iu_dot_indexed_epi32(xindices, perm, yindices, len));
+                TEST_ASSERT_EQUAL_INT64(indexed16, iu_dot_indexed_epi16(x16, perm, y16, len));
+                TEST_ASSERT_EQUAL_INT64(indexed8, iu_dot_indexed_u8i8(xu8, perm, yi8, len));
+            }
+        }
+    }
+
+    free(x16);
+    free(y16);
+    free(xu8);
+    free(yi8);
+    free(perm);
+
+    iu_dispatch_set_isa(isa);
+}
+
+// Every half must survive a round trip through float on every ISA, with
+// signalling NaNs coming back quieted, and the dot products must agree with
+// a double-precision sum of the widened values.
+void test_dispatch_half(void)
+{
+    int isa = iu_dispatch_isa();
+    int count = 1 << 16;
+    int maxlen = m < 300 ? m : 300;
+    uint16_t *h = malloc(count * sizeof(uint16_t));
+    uint16_t *back = malloc(count * sizeof(uint16_t));
+    float *f = malloc(count * sizeof(float));
+    int *perm = malloc(maxlen * sizeof(int));
+
+    TEST_ASSERT_NOT_NULL(h);
+    TEST_ASSERT_NOT_NULL(back);
+    TEST_ASSERT_NOT_NULL(f);
+    TEST_ASSERT_NOT_NULL(perm);
+
+    for (int i = 0; i < count; i++) {
+        h[i] = (uint16_t)i;
+    }
+
+    for (int k = 0; k < NUM_ISAS; k++) {
+        if (iu_dispatch_set_isa(k) != 0) {
+            continue;
+        }
+
+        iu_cvt_f16_to_f32(f, h, count);
+        iu_cvt_f32_to_f16(back, f, count);
+
+        for (int i = 0; i < count; i++) {
+            int nan = (h[i] & 0x7c00) == 0x7c00 && (h[i] & 0x3ff) != 0;
+
+            TEST_ASSERT_EQUAL_HEX16(nan ? h[i] | 0x200 : h[i], back[i]);
+        }
+    }
+
+    // Finite halves in [-2, 2) for the dot products.
+    for (int i = 0; i < maxlen; i++) {
+        h[i] = (uint16_t)rand() & 0xbfff;
+        back[i] = (uint16_t)rand() & 0xbfff;
+    }
+
+    iu_dispatch_set_isa(IU_ISA_SSE);
+    iu_cvt_f16_to_f32(f, h, maxlen);
+    iu_cvt_f16_to_f32(f + maxlen, back, maxlen);
+
+    for (int len = 0; len <= maxlen; len++) {
+        double exact = 0, indexed = 0, scale = 0;
+
+        random_index_array(perm, len);
+
+        for (int i = 0; i < len; i++) {
+            exact += (double)f[i] * f[maxlen + i];
+            indexed += (double)f[perm[i]] * f[maxlen + i];
+            scale += fabs((double)f[i] * f[maxlen + i]);
+        }
+
+        for (int k = 0; k < NUM_ISAS; k++) {
+            if (iu_dispatch_set_isa(k) != 0) {
+                continue;
+            }
+
+            TEST_ASSERT_DOUBLE_WITHIN(1e-5 * (scale + 1), exact, iu_hdot(h, back, len));
+            TEST_ASSERT_DOUBLE_WITHIN(1e-5 * (scale + 1), indexed, iu_hdot_indexed(h, perm, back, len));
+        }
+    }
+
+    free(h);
+    free(back);
+    free(f);
+    free(perm);
+
+    iu_dispatch_set_isa(isa);
+}
+
+// Shapes around every register width and block size, in both orders, with
+// leading dimensions past the matrix. Padding in b must be left alone, and
+// the in-place transposes must match the out-of-place ones.
+void test_dispatch_transpose(void)
+{
+    int isa = iu_dispatch_isa();
+    int sizes[] = {1, 3, 8, 17, 33, 70};
+    int nsizes = sizeof(sizes) / sizeof(sizes[0]);
+    char orders[] = {ROW_MAJOR_ORDER, COLUMN_MAJOR_ORDER};
+    int ld = 73;
+    float *af = malloc(ld * ld * sizeof(float));
+    float *bf = malloc(ld * ld * sizeof(float));
+    double *ad = malloc(ld * ld * sizeof(double));
+    double *bd = malloc(ld * ld * sizeof(double));
+    int *ai = malloc(ld * ld * sizeof(int));
+    int *bi = malloc(ld * ld * sizeof(int));
+
+    TEST_ASSERT_NOT_NULL(af);
+    TEST_ASSERT_NOT_NULL(bf);
+    TEST_ASSERT_NOT_NULL(ad);
+    TEST_ASSERT_NOT_NULL(bd);
+    TEST_ASSERT_NOT_NULL(ai);
+    TEST_ASSERT_NOT_NULL(bi);
+
+    for (int k = 0; k < NUM_ISAS; k++) {
+        if (iu_dispatch_set_isa(k) != 0) {
+            continue;
+        }
+
+        for (int o = 0; o < 2; o++) {
+            for (int r = 0; r < nsizes; r++) {
+                for (int c = 0; c < nsizes; c++) {
+                    int nrows = sizes[r], ncols = sizes[c];
+                    int m = orders[o] == ROW_MAJOR_ORDER ? nrows : ncols;
+                    int n = orders[o] == ROW_MAJOR_ORDER ? ncols : nrows;
+
+                    for (int i = 0; i < ld * ld; i++) {
+                        af[i] = (float)i;
+                        ad[i] = -(double)i;
+                        ai[i] = 3 * i;
+                        bf[i] = -1.0f;
+                        bd[i] = 1.0;
+                        bi[i] = -1;
+                    }
+
+                    iu_transpose_ps(orders[o], nrows, ncols, af, ld, bf, ld);
+                    iu_transpose_pd(orders[o], nrows, ncols, ad, ld, bd, ld);
+                    iu_transpose_epi32(orders[o], nrows, ncols, ai, ld, bi, ld);
+
+                    // a holds m lines of n, and b n lines of m.
+                    for (int j = 0; j < ld; j++) {
+                        for (int i = 0; i < ld; i++) {
+                            int in = j < n && i < m;
+
+                            TEST_ASSERT_EQUAL_FLOAT(in ? af[i * ld + j] : -1.0f, bf[j * ld + i]);
+                            TEST_ASSERT_EQUAL_DOUBLE(in ? ad[i * ld + j] : 1.0, bd[j * ld + i]);
+                            TEST_ASSERT_EQUAL_INT(in ? ai[i * ld + j] : -1, bi[j * ld + i]);
+                        }
+                    }
+
+                    if (nrows != ncols) {
+                        continue;
+                    }
+
+                    iu_transpose_inplace_ps(n, af, ld);
+                    iu_transpose_inplace_pd(n, ad, ld);
+                    iu_transpose_inplace_epi32(n, ai, ld);
+
+                    for (int i = 0; i < n; i++) {
+                        TEST_ASSERT_EQUAL_FLOAT_ARRAY(bf + i * ld, af + i * ld, n);
+                        TEST_ASSERT_EQUAL_DOUBLE_ARRAY(bd + i * ld, ad + i * ld, n);
+                        TEST_ASSERT_EQUAL_INT32_ARRAY(bi + i * ld, ai + i * ld, n);
+                    }
+                }
+            }
+        }
+    }
+
+    free(af);
+    free(bf);
+    free(ad);
+    free(bd);
+    free(ai);
+    free(bi);
+    iu_dispatch_set_isa(isa);
+}
+
+void test_dispatch_reduce2d(void)
+{
+    int isa = iu_dispatch_isa();
+    int gather = iu_dispatch_gather();
+    int sizes[] = {0, 1, 3, 5, 8, 17, 35};
+    int nsizes = sizeof(sizes) / sizeof(sizes[0]);
+    int nrows = 71;
+    int ncols = 43;
+    int numj = 9;
+    int iind[35], jind[9];
+    float *srcf = malloc(nrows * ncols * sizeof(float));
+    double *srcd = malloc(nrows * ncols * sizeof(double));
+    float wf[35 * 9];
+    double wd[35 * 9];
+
+    TEST_ASSERT_NOT_NULL(srcf);
+    TEST_ASSERT_NOT_NULL(srcd);
+
+    random_farray(srcf, nrows * ncols, -1.0f, 1.0f);
+    random_darray(srcd, nrows * ncols, -1.0, 1.0);
+    random_farray(wf, 35 * 9, -1.0f, 1.0f);
+    random_darray(wd, 35 * 9, -1.0, 1.0);
+
+    for (int i = 0; i < 35; i++) {
+        iind[i] = rand() % nrows;
+    }
+
+    for (int j = 0; j < numj; j++) {
+        jind[j] = rand() % ncols;
+    }
+
+    for (int k = 0; k < NUM_ISAS; k++) {
+        if (iu_dispatch_set_isa(k) != 0) {
+            continue;
+        }
+
+        for (int s = 0; s < nsizes; s++) {
+            int numi = sizes[s];
+            double sumf = 0, dotf = 0, sumd = 0, dotd = 0;
+
+            for (int j = 0; j < numj; j++) {
+                for (int i = 0; i < numi; i++) {
+                    int idx = jind[j] * nrows + iind[i];
+
+                    sumf += srcf[idx];
+                    dotf += srcf[idx] * wf[j * numi + i];
+                    sumd += srcd[idx];
+                    dotd += srcd[idx] * wd[j * numi + i];
+                }
+            }
+
+            for (int mode = IU_GATHER_HARDWARE; mode <= IU_GATHER_EMULATED; mode++) {
+                TEST_ASSERT_EQUAL_INT(0, iu_dispatch_set_gather(mode));
+
+                TEST_ASSERT_FLOAT_WITHIN(1e-4f, (float)sumf, iu_sum2d_indexed_ps(srcf, nrows, iind, jind, numi, numj));
+                TEST_ASSERT_FLOAT_WITHIN(1e-4f, (float)dotf, iu_dot2d_indexed_ps(srcf, nrows, iind, jind, numi, numj, wf));
+                TEST_ASSERT_DOUBLE_WITHIN(1e-12, sumd, iu_sum2d_indexed_pd(srcd, nrows, iind, jind, numi, numj));
+                TEST_ASSERT_DOUBLE_WITHIN(1e-12, dotd, iu_dot2d_indexed_pd(srcd, nrows, iind, jind, numi, numj, wd));
+            }
+        }
+    }
+
+    free(srcf);
+    free(srcd);
+    iu_dispatch_set_isa(isa);
+    iu_dispatch_set_gather(gather);
+}
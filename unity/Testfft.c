@@ -0,0 +1,412 @@
+#include "unity.h"
+#include "fft.h"
+#include "dispatch.h"
+#include <stdlib.h>
+#include <math.h>
+
+#define NUM_ISAS 3
+
+// Transforms are compared relative to the norm of their input; float
+// rounding grows with the number of stages.
+#define RELATIVE_DELTA 2e-5
+
+#define PI 3.14159265358979323846
+
+// Random seed for srand call.
+unsigned random_seed = 0;
+
+// Forward declarations needed to use Unity.
+void setUp(void);
+void tearDown(void);
+
+// Forward declarations for helpers.
+void random_floats(float *, size_t);
+void reference_dft(const float *, double *, int, int, int);
+void check_batch(int, int);
+
+// Forward declarations for tests.
+void test_fft_plan(void);
+void test_fft_batch(void);
+void test_fft_cmul(void);
+void test_fft2d_spectrum(void);
+void test_fft2d_roundtrip(void);
+void test_conv2d(void);
+void test_conv2d_prefer_fft(void);
+
+int main(int argc, char *argv[])
+{
+    if (argc > 1) {
+        random_seed = strtoul(argv[1], NULL, 10);
+    }
+
+    UNITY_BEGIN();
+
+    RUN_TEST(test_fft_plan);
+    RUN_TEST(test_fft_batch);
+    RUN_TEST(test_fft_cmul);
+    RUN_TEST(test_fft2d_spectrum);
+    RUN_TEST(test_fft2d_roundtrip);
+    RUN_TEST(test_conv2d);
+    RUN_TEST(test_conv2d_prefer_fft);
+
+    return UNITY_END();
+}
+
+void setUp(void)
+{
+    srand(random_seed);
+}
+
+void tearDown(void)
+{
+}
+
+void random_floats(float *x, size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        x[i] = 2.0f * rand() / RAND_MAX - 1.0f;
+    }
+}
+
+// Direct DFT of sequence b of a batch laid out as for iu_fft_batch.
+void reference_dft(const float *x, double *y, int n, int batch, int b)
+{
+    for (int k = 0; k < n; k++) {
+        double re = 0, im = 0;
+
+        for (int j = 0; j < n; j++) {
+            double angle = -2 * PI * (double)((long long)j * k % n) / n;
+            double xr = x[2 * ((size_t)j * batch + b)];
+            double xi = x[2 * ((size_t)j * batch + b) + 1];
+
+            re += xr * cos(angle) - xi * sin(angle);
+            im += xr * sin(angle) + xi * cos(angle);
+        }
+
+        y[2 * k] = re;
+        y[2 * k + 1] = im;
+    }
+}
+
+// Forward transforms match the direct DFT and inverse transforms bring the
+// input back scaled by n, under each instruction set the host supports.
+void check_batch(int n, int batch)
+{
+    int isa = iu_dispatch_isa();
+    size_t len = 2 * (size_t)n * batch;
+    struct iu_fft_plan *plan = iu_fft_plan_create(n);
+    float *x = malloc(len * sizeof(float));
+    float *y = malloc(len * sizeof(float));
+    float *work = malloc(len * sizeof(float));
+    double *ref = malloc(2 * (size_t)n * batch * sizeof(double));
+    double norm = 0;
+
+    TEST_ASSERT_NOT_NULL(plan);
+    TEST_ASSERT_NOT_NULL(x);
+    TEST_ASSERT_NOT_NULL(y);
+    TEST_ASSERT_NOT_NULL(work);
+    TEST_ASSERT_NOT_NULL(ref);
+
+    random_floats(x, len);
+
+    for (size_t i = 0; i < len; i++) {
+        norm += (double)x[i] * x[i];
+    }
+
+    norm = sqrt(norm / batch);
+
+    for (int b = 0; b < batch; b++) {
+        reference_dft(x, ref + 2 * (size_t)b * n, n, batch, b);
+    }
+
+    for (int k = 0; k < NUM_ISAS; k++) {
+        if (iu_dispatch_set_isa(k) != 0) {
+            continue;
+        }
+
+        for (size_t i = 0; i < len; i++) {
+            y[i] = x[i];
+        }
+
+        iu_fft_batch(plan, y, work, batch, IU_FFT_FORWARD);
+
+        for (int b = 0; b < batch; b++) {
+            for (int e = 0; e < n; e++) {
+                TEST_ASSERT_DOUBLE_WITHIN(RELATIVE_DELTA * norm, ref[2 * ((size_t)b * n + e)], y[2 * ((size_t)e * batch + b)]);
+                TEST_ASSERT_DOUBLE_WITHIN(RELATIVE_DELTA * norm, ref[2 * ((size_t)b * n + e) + 1], y[2 * ((size_t)e * batch + b) + 1]);
+            }
+        }
+
+        iu_fft_batch(plan, y, work, batch, IU_FFT_INVERSE);
+
+        for (size_t i = 0; i < len; i++) {
+            TEST_ASSERT_DOUBLE_WITHIN(RELATIVE_DELTA * norm, x[i], y[i] / n);
+        }
+    }
+
+    iu_fft_plan_free(plan);
+    free(x);
+    free(y);
+    free(work);
+    free(ref);
+
+    iu_dispatch_set_isa(isa);
+}
+
+void test_fft_plan(void)
+{
+    struct iu_fft_plan *plan;
+    int product = 1;
+
+    TEST_ASSERT_NULL(iu_fft_plan_create(0));
+
+    plan = iu_fft_plan_create(1);
+    TEST_ASSERT_NOT_NULL(plan);
+    TEST_ASSERT_EQUAL_INT(0, plan->nstages);
+    iu_fft_plan_free(plan);
+
+    // 2 * 3^2 * 4^2 * 5 * 7 * 11, with the radix-4 stages first.
+    plan = iu_fft_plan_create(2 * 9 * 16 * 5 * 7 * 11);
+    TEST_ASSERT_NOT_NULL(plan);
+    TEST_ASSERT_EQUAL_INT(8, plan->nstages);
+    TEST_ASSERT_EQUAL_INT(4, plan->radix[0]);
+    TEST_ASSERT_EQUAL_INT(4, plan->radix[1]);
+    TEST_ASSERT_EQUAL_INT(2, plan->radix[2]);
+
+    for (int s = 0; s < plan->nstages; s++) {
+        product *= plan->radix[s];
+    }
+
+    TEST_ASSERT_EQUAL_INT(plan->n, product);
+    iu_fft_plan_free(plan);
+    iu_fft_plan_free(NULL);
+}
+
+void test_fft_batch(void)
+{
+    int sizes[] = {1, 2, 3, 4, 5, 7, 8, 12, 16, 30, 49, 64, 97, 100, 128, 243, 256, 1000, 1024};
+    int batches[] = {1, 3, 8, 17};
+
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        for (size_t b = 0; b < sizeof(batches) / sizeof(batches[0]); b++) {
+            check_batch(sizes[s], batches[b]);
+        }
+    }
+}
+
+void test_fft_cmul(void)
+{
+    int isa = iu_dispatch_isa();
+    float x[2 * 40], y[2 * 40], z[2 * 40];
+
+    random_floats(x, 2 * 40);
+    random_floats(y, 2 * 40);
+
+    for (int k = 0; k < NUM_ISAS; k++) {
+        if (iu_dispatch_set_isa(k) != 0) {
+            continue;
+        }
+
+        for (int n = 0; n <= 40; n++) {
+            for (int i = 0; i < 2 * 40; i++) {
+                z[i] = -7;
+            }
+
+            iu_cmul_ps(z, x, y, n);
+
+            for (int i = 0; i < n; i++) {
+                TEST_ASSERT_FLOAT_WITHIN(1e-6, x[2 * i] * y[2 * i] - x[2 * i + 1] * y[2 * i + 1], z[2 * i]);
+                TEST_ASSERT_FLOAT_WITHIN(1e-6, x[2 * i] * y[2 * i + 1] + x[2 * i + 1] * y[2 * i], z[2 * i + 1]);
+            }
+
+            for (int i = 2 * n; i < 2 * 40; i++) {
+                TEST_ASSERT_EQUAL_FLOAT(-7, z[i]);
+            }
+        }
+    }
+
+    iu_dispatch_set_isa(isa);
+}
+
+// The half spectrum of a real grid against a direct two-dimensional DFT, for
+// even and odd numbers of columns.
+void test_fft2d_spectrum(void)
+{
+    int dims[][2] = {{1, 1}, {1, 2}, {8, 1}, {6, 8}, {9, 10}, {16, 7}, {12, 15}};
+
+    for (size_t d = 0; d < sizeof(dims) / sizeof(dims[0]); d++) {
+        int nr = dims[d][0], nc = dims[d][1];
+        struct iu_fft2d *fft = iu_fft2d_create(nr, nc);
+        float *x = malloc((size_t)nr * nc * sizeof(float));
+        float *spectrum;
+        double norm = 0;
+
+        TEST_ASSERT_NOT_NULL(fft);
+        TEST_ASSERT_NOT_NULL(x);
+        TEST_ASSERT_EQUAL_INT(nc / 2 + 1, fft->hcols);
+
+        spectrum = malloc(2 * (size_t)nr * fft->hcols * sizeof(float));
+        TEST_ASSERT_NOT_NULL(spectrum);
+
+        random_floats(x, (size_t)nr * nc);
+
+        for (int i = 0; i < nr * nc; i++) {
+            norm += (double)x[i] * x[i];
+        }
+
+        norm = sqrt(norm);
+        iu_fft2d_r2c(fft, spectrum, x);
+
+        for (int kr = 0; kr < nr; kr++) {
+            for (int kc = 0; kc < fft->hcols; kc++) {
+                double re = 0, im = 0;
+
+                for (int j = 0; j < nc; j++) {
+                    for (int i = 0; i < nr; i++) {
+                        double angle = -2 * PI * ((double)(i * kr % nr) / nr + (double)(j * kc % nc) / nc);
+
+                        re += x[j * nr + i] * cos(angle);
+                        im += x[j * nr + i] * sin(angle);
+                    }
+                }
+
+                TEST_ASSERT_DOUBLE_WITHIN(RELATIVE_DELTA * norm, re, spectrum[2 * (kc + kr * fft->hcols)]);
+                TEST_ASSERT_DOUBLE_WITHIN(RELATIVE_DELTA * norm, im, spectrum[2 * (kc + kr * fft->hcols) + 1]);
+            }
+        }
+
+        iu_fft2d_free(fft);
+        free(x);
+        free(spectrum);
+    }
+
+    TEST_ASSERT_NULL(iu_fft2d_create(0, 4));
+    iu_fft2d_free(NULL);
+}
+
+void test_fft2d_roundtrip(void)
+{
+    int isa = iu_dispatch_isa();
+    int dims[][2] = {{64, 64}, {100, 36}, {37, 51}, {128, 2}, {3, 96}};
+
+    for (size_t d = 0; d < sizeof(dims) / sizeof(dims[0]); d++) {
+        int nr = dims[d][0], nc = dims[d][1];
+        size_t cells = (size_t)nr * nc;
+        struct iu_fft2d *fft = iu_fft2d_create(nr, nc);
+        float *x = malloc(cells * sizeof(float));
+        float *y = malloc(cells * sizeof(float));
+        float *spectrum;
+
+        TEST_ASSERT_NOT_NULL(fft);
+        TEST_ASSERT_NOT_NULL(x);
+        TEST_ASSERT_NOT_NULL(y);
+
+        spectrum = malloc(2 * (size_t)nr * fft->hcols * sizeof(float));
+        TEST_ASSERT_NOT_NULL(spectrum);
+
+        random_floats(x, cells);
+
+        for (int k = 0; k < NUM_ISAS; k++) {
+            if (iu_dispatch_set_isa(k) != 0) {
+                continue;
+            }
+
+            iu_fft2d_r2c(fft, spectrum, x);
+            iu_fft2d_c2r(fft, y, spectrum);
+
+            for (size_t i = 0; i < cells; i++) {
+                TEST_ASSERT_FLOAT_WITHIN(1e-5, x[i], y[i]);
+            }
+        }
+
+        iu_fft2d_free(fft);
+        free(x);
+        free(y);
+        free(spectrum);
+    }
+
+    iu_dispatch_set_isa(isa);
+}
+
+// Periodic convolution with two kernels against direct summation, including
+// a kernel whose offsets wrap to the far edges.
+void test_conv2d(void)
+{
+    int isa = iu_dispatch_isa();
+    int dims[][2] = {{37, 24}, {16, 15}, {5, 2}};
+
+    for (size_t d = 0; d < sizeof(dims) / sizeof(dims[0]); d++) {
+        int nr = dims[d][0], nc = dims[d][1];
+        size_t cells = (size_t)nr * nc;
+        float *kernels = malloc(2 * cells * sizeof(float));
+        float *f = malloc(cells * sizeof(float));
+        float *out0 = malloc(cells * sizeof(float));
+        float *out1 = malloc(cells * sizeof(float));
+        float *out[2] = {out0, out1};
+        struct iu_conv2d *conv;
+
+        TEST_ASSERT_NOT_NULL(kernels);
+        TEST_ASSERT_NOT_NULL(f);
+        TEST_ASSERT_NOT_NULL(out0);
+        TEST_ASSERT_NOT_NULL(out1);
+
+        random_floats(kernels, 2 * cells);
+        random_floats(f, cells);
+
+        // A single cell at offset (-1, 2) shifts the grid.
+        for (size_t i = 0; i < cells; i++) {
+            kernels[cells + i] = 0;
+        }
+
+        kernels[cells + (size_t)(2 % nc) * nr + nr - 1] = 1;
+
+        conv = iu_conv2d_create(nr, nc, kernels, 2);
+        TEST_ASSERT_NOT_NULL(conv);
+
+        for (int k = 0; k < NUM_ISAS; k++) {
+            if (iu_dispatch_set_isa(k) != 0) {
+                continue;
+            }
+
+            iu_conv2d_apply(conv, out, f);
+
+            for (int j = 0; j < nc; j++) {
+                for (int i = 0; i < nr; i++) {
+                    double sum = 0;
+
+                    for (int b = 0; b < nc; b++) {
+                        for (int a = 0; a < nr; a++) {
+                            sum += (double)kernels[b * nr + a] * f[((j - b) % nc + nc) % nc * nr + ((i - a) % nr + nr) % nr];
+                        }
+                    }
+
+                    TEST_ASSERT_DOUBLE_WITHIN(1e-4, sum, out0[j * nr + i]);
+                    TEST_ASSERT_FLOAT_WITHIN(1e-5, f[((j - 2) % nc + nc) % nc * nr + (i + 1) % nr], out1[j * nr + i]);
+                }
+            }
+        }
+
+        iu_conv2d_free(conv);
+        free(kernels);
+        free(f);
+        free(out0);
+        free(out1);
+    }
+
+    TEST_ASSERT_NULL(iu_conv2d_create(8, 8, NULL, 0));
+    iu_conv2d_free(NULL);
+    iu_dispatch_set_isa(isa);
+}
+
+void test_conv2d_prefer_fft(void)
+{
+    // A 3x3 stencil is always summed directly, and a radius-21 disk and
+    // annulus (about 1400 weights) on a large grid is not.
+    TEST_ASSERT_FALSE(iu_conv2d_prefer_fft(512, 512, 9, 1));
+    TEST_ASSERT_TRUE(iu_conv2d_prefer_fft(512, 512, 1400, 2));
+
+    // Large prime factors make transforms more expensive.
+    TEST_ASSERT_TRUE(iu_conv2d_prefer_fft(512, 512, 5000, 2));
+    TEST_ASSERT_FALSE(iu_conv2d_prefer_fft(509, 509, 5000, 2));
+    TEST_ASSERT_FALSE(iu_conv2d_prefer_fft(521, 523, 1400, 2));
+}
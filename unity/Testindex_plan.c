@@ -0,0 +1,368 @@
+#include "unity.h"
+#include "index_plan.h"
+#include "dispatch.h"
+#include <stdlib.h>
+#include <string.h>
+#include <float.h>
+
+#define FLT_DELTA (2e2 * FLT_EPSILON)
+#define DBL_DELTA (2e2 * DBL_EPSILON)
+
+#define NUM_ISAS 3
+
+// Global variables for the arrays reduced over, and for the index list.
+float *xf = NULL, *yf = NULL, *df = NULL;
+double *xd = NULL, *yd = NULL;
+int *indices = NULL;
+
+// Array dimensions. The grid is nrows by ncols; m is its number of cells.
+int nrows = 96;
+int ncols = 80;
+int m = 96 * 80;
+
+// Random seed for srand call.
+unsigned random_seed = 0;
+
+// Neighbourhoods exercised by the radius tests, as {inner, outer} pairs:
+// Smoothlife's disk and annulus, a small and a wide ring, and a single cell.
+double radii[][2] = {{0.0, 7.0}, {7.0, 21.0}, {2.0, 3.5}, {0.0, 30.0}, {0.0, 0.5}};
+int num_radii = sizeof(radii) / sizeof(radii[0]);
+
+// Forward declarations needed to use Unity.
+void setUp(void);
+void tearDown(void);
+
+// Forward declarations for initializing arrays.
+void random_farray(float *, int, float, float);
+void random_darray(double *, int, double, double);
+int random_run_indices(int *, int, int);
+
+// Forward declarations for helpers.
+void check_plan(const struct iu_index_plan *, const int *, int);
+void check_plan_at(const struct iu_index_plan *, const float *, const double *, const int *, int);
+
+// Forward declarations for tests.
+void test_plan_structure(void);
+void test_plan_runs(void);
+void test_plan_radius(void);
+void test_plan_radius_ld(void);
+void test_plan_min_span(void);
+
+int main(int argc, char *argv[])
+{
+    if (argc > 1) {
+        nrows = strtol(argv[1], NULL, 10);
+    }
+
+    if (argc > 2) {
+        ncols = strtol(argv[2], NULL, 10);
+    }
+
+    if (argc > 3) {
+        random_seed = strtoul(argv[3], NULL, 10);
+    }
+
+    m = nrows * ncols;
+
+    UNITY_BEGIN();
+
+    RUN_TEST(test_plan_structure);
+    RUN_TEST(test_plan_runs);
+    RUN_TEST(test_plan_radius);
+    RUN_TEST(test_plan_radius_ld);
+    RUN_TEST(test_plan_min_span);
+
+    return UNITY_END();
+}
+
+void setUp(void)
+{
+    srand(random_seed);
+
+    xf = calloc(3*m, sizeof(float));
+    xd = calloc(2*m, sizeof(double));
+    indices = calloc(m, sizeof(int));
+
+    if (xf != NULL && xd != NULL && indices != NULL) {
+        yf = xf + m;
+        df = yf + m;
+        yd = xd + m;
+        random_farray(xf, 2*m, -1.0f, 1.0f);
+        random_darray(xd, 2*m, -1.0, 1.0);
+    } else {
+        tearDown();
+    }
+}
+
+void tearDown(void)
+{
+    free(xf);
+    free(xd);
+    free(indices);
+
+    xf = yf = df = NULL;
+    xd = yd = NULL;
+    indices = NULL;
+}
+
+void random_farray(float *x, int len, float a, float b)
+{
+    for (int i = 0; i < len; i++) {
+        x[i] = a + (b - a) * ((float)rand() / RAND_MAX);
+    }
+}
+
+void random_darray(double *x, int len, double a, double b)
+{
+    for (int i = 0; i < len; i++) {
+        x[i] = a + (b - a) * ((double)rand() / RAND_MAX);
+    }
+}
+
+// Fill indices with runs of random length up to max_run starting at random
+// cells, so the list mixes long spans, short runs and isolated indices.
+// Returns the number of indices written.
+int random_run_indices(int *idx, int len, int max_run)
+{
+    int n = 0;
+
+    while (n < len) {
+        int run = 1 + rand() % max_run;
+        int start = rand() % (m - run);
+
+        for (int k = 0; k < run && n < len; k++) {
+            idx[n++] = start + k;
+        }
+    }
+
+    return n;
+}
+
+// Compare every reduction over plan with the indexed kernels on the same
+// list, under each instruction set the host supports.
+void check_plan(const struct iu_index_plan *plan, const int *idx, int n)
+{
+    check_plan_at(plan, xf, xd, idx, n);
+}
+
+// As check_plan, but with the plan applied to pf and pd, which must hold
+// xf[idx[i]] and xd[idx[i]] at the plan's i-th index.
+void check_plan_at(const struct iu_index_plan *plan, const float *pf, const double *pd, const int *idx, int n)
+{
+    int isa = iu_dispatch_isa();
+    double exactf, exactd, sumf, sumd;
+
+    exactf = exactd = sumf = sumd = 0;
+
+    for (int i = 0; i < n; i++) {
+        exactf += (double)xf[idx[i]] * yf[i];
+        exactd += xd[idx[i]] * yd[i];
+        sumf += xf[idx[i]];
+        sumd += xd[idx[i]];
+    }
+
+    for (int k = 0; k < NUM_ISAS; k++) {
+        if (iu_dispatch_set_isa(k) != 0) {
+            continue;
+        }
+
+        TEST_ASSERT_FLOAT_WITHIN((n + 1) * FLT_DELTA, exactf, iu_fdot_plan(plan, pf, yf));
+        TEST_ASSERT_DOUBLE_WITHIN((n + 1) * DBL_DELTA, exactd, iu_ddot_plan(plan, pd, yd));
+        TEST_ASSERT_FLOAT_WITHIN((n + 1) * FLT_DELTA, sumf, iu_fsum_plan(plan, pf));
+        TEST_ASSERT_DOUBLE_WITHIN((n + 1) * DBL_DELTA, sumd, iu_dsum_plan(plan, pd));
+
+        memset(df, 0, m * sizeof(float));
+        iu_copy_plan_ps(plan, df, pf);
+
+        for (int i = 0; i < n; i++) {
+            TEST_ASSERT_EQUAL_FLOAT(xf[idx[i]], df[i]);
+        }
+    }
+
+    iu_dispatch_set_isa(isa);
+}
+
+//----------------------------------------------------------------------------
+// Tests for span-compressed index plans.
+//----------------------------------------------------------------------------
+
+// Spans and singles must partition the list, in order, and every span must
+// be a maximal run of at least the minimum length.
+void test_plan_structure(void)
+{
+    int n = random_run_indices(indices, m / 4, 24);
+    struct iu_index_plan *plan = iu_index_plan_from_indices(indices, n, 0);
+    int *covered = calloc(n, sizeof(int));
+
+    TEST_ASSERT_NOT_NULL(plan);
+    TEST_ASSERT_NOT_NULL(covered);
+    TEST_ASSERT_EQUAL_INT(n, plan->len);
+
+    for (int s = 0; s < plan->nspans; s++) {
+        int start = plan->spans[3*s];
+        int len = plan->spans[3*s + 1];
+        int offset = plan->spans[3*s + 2];
+
+        TEST_ASSERT_TRUE(len >= PLAN_MIN_SPAN);
+        TEST_ASSERT_TRUE(offset + len == n || indices[offset + len] != start + len);
+
+        for (int k = 0; k < len; k++) {
+            TEST_ASSERT_EQUAL_INT(start + k, indices[offset + k]);
+            covered[offset + k]++;
+        }
+    }
+
+    for (int s = 0; s < plan->nsingles; s++) {
+        TEST_ASSERT_EQUAL_INT(indices[plan->single_offsets[s]], plan->singles[s]);
+        covered[plan->single_offsets[s]]++;
+    }
+
+    for (int i = 0; i < n; i++) {
+        TEST_ASSERT_EQUAL_INT(1, covered[i]);
+    }
+
+    free(covered);
+    iu_index_plan_free(plan);
+}
+
+void test_plan_runs(void)
+{
+    int max_runs[] = {1, 3, 8, 40};
+
+    for (int r = 0; r < 4; r++) {
+        for (int len = 0; len < 70; len += 1 + len / 8) {
+            int n = random_run_indices(indices, len, max_runs[r]);
+            struct iu_index_plan *plan = iu_index_plan_from_indices(indices, n, 0);
+
+            TEST_ASSERT_NOT_NULL(plan);
+            check_plan(plan, indices, n);
+            iu_index_plan_free(plan);
+        }
+    }
+}
+
+// A plan built from a radius is applied at centres across a copy of the
+// grid padded by the widest radius, wrapping rows and columns, and must
+// match the wrapped indices listed column by column. One plan serves every
+// centre, including centres on the edges of the grid.
+void test_plan_radius(void)
+{
+    int centres[][2] = {{nrows / 2, ncols / 2}, {0, 0}, {nrows - 1, 3}};
+    int pad = 30;
+    int ld = nrows + 2 * pad;
+    float *padf = malloc((size_t)ld * (ncols + 2 * pad) * sizeof(float));
+    double *padd = malloc((size_t)ld * (ncols + 2 * pad) * sizeof(double));
+
+    TEST_ASSERT_NOT_NULL(padf);
+    TEST_ASSERT_NOT_NULL(padd);
+
+    for (int pj = 0; pj < ncols + 2 * pad; pj++) {
+        int j = ((pj - pad) % ncols + ncols) % ncols;
+
+        for (int pi = 0; pi < ld; pi++) {
+            int i = ((pi - pad) % nrows + nrows) % nrows;
+
+            padf[pj * ld + pi] = xf[j * nrows + i];
+            padd[pj * ld + pi] = xd[j * nrows + i];
+        }
+    }
+
+    for (int r = 0; r < num_radii; r++) {
+        double inner = radii[r][0], outer = radii[r][1];
+        int reach = (int)outer;
+        struct iu_index_plan *plan = iu_index_plan_from_radius(ld, inner, outer);
+
+        TEST_ASSERT_NOT_NULL(plan);
+        TEST_PRINTF("radius [%4.1f, %4.1f): %5d cells, %3d spans, %4d gathered",
+                    inner, outer, plan->len, plan->nspans, plan->nsingles);
+
+        for (int c = 0; c < 3; c++) {
+            int centre = (centres[c][1] + pad) * ld + centres[c][0] + pad;
+            int n = 0;
+
+            for (int dj = -reach; dj <= reach; dj++) {
+                for (int di = -reach; di <= reach; di++) {
+                    double dist2 = di * di + dj * dj;
+
+                    if (dist2 >= inner * inner && dist2 < outer * outer) {
+                        int i = ((centres[c][0] + di) % nrows + nrows) % nrows;
+                        int j = ((centres[c][1] + dj) % ncols + ncols) % ncols;
+
+                        indices[n++] = j * nrows + i;
+                    }
+                }
+            }
+
+            TEST_ASSERT_EQUAL_INT(n, plan->len);
+            check_plan_at(plan, padf + centre, padd + centre, indices, n);
+        }
+
+        iu_index_plan_free(plan);
+    }
+
+    free(padf);
+    free(padd);
+}
+
+// The offsets of a radius plan are distinct and increasing as long as the
+// columns of the window fit in ld, and narrower columns are refused.
+void test_plan_radius_ld(void)
+{
+    double outers[] = {0.5, 2.5, 3.0, 7.0};
+
+    for (int o = 0; o < 4; o++) {
+        int reach = (int)outers[o];
+        struct iu_index_plan *plan = iu_index_plan_from_radius(2 * reach + 1, 0.0, outers[o]);
+        int *expanded;
+
+        TEST_ASSERT_NULL(iu_index_plan_from_radius(2 * reach, 0.0, outers[o]));
+        TEST_ASSERT_NOT_NULL(plan);
+
+        expanded = malloc((plan->len > 0 ? plan->len : 1) * sizeof(int));
+        TEST_ASSERT_NOT_NULL(expanded);
+
+        for (int s = 0; s < plan->nspans; s++) {
+            for (int k = 0; k < plan->spans[3*s + 1]; k++) {
+                expanded[plan->spans[3*s + 2] + k] = plan->spans[3*s] + k;
+            }
+        }
+
+        for (int s = 0; s < plan->nsingles; s++) {
+            expanded[plan->single_offsets[s]] = plan->singles[s];
+        }
+
+        for (int k = 1; k < plan->len; k++) {
+            TEST_ASSERT_TRUE(expanded[k - 1] < expanded[k]);
+        }
+
+        TEST_ASSERT_TRUE(plan->len == 0 || expanded[0] == -expanded[plan->len - 1]);
+
+        free(expanded);
+        iu_index_plan_free(plan);
+    }
+}
+
+// A larger minimum span moves short runs to the singles; a minimum of one
+// turns the whole of a contiguous list into a single span.
+void test_plan_min_span(void)
+{
+    struct iu_index_plan *plan;
+
+    for (int i = 0; i < 100; i++) {
+        indices[i] = 7 + i;
+    }
+
+    plan = iu_index_plan_from_indices(indices, 100, 1);
+    TEST_ASSERT_NOT_NULL(plan);
+    TEST_ASSERT_EQUAL_INT(1, plan->nspans);
+    TEST_ASSERT_EQUAL_INT(0, plan->nsingles);
+    check_plan(plan, indices, 100);
+    iu_index_plan_free(plan);
+
+    plan = iu_index_plan_from_indices(indices, 100, 101);
+    TEST_ASSERT_NOT_NULL(plan);
+    TEST_ASSERT_EQUAL_INT(0, plan->nspans);
+    TEST_ASSERT_EQUAL_INT(100, plan->nsingles);
+    check_plan(plan, indices, 100);
+    iu_index_plan_free(plan);
+}
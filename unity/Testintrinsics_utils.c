@@ -1,8 +1,12 @@
 #include "unity.h"
 #include "mask_utils.h"
 #include "intrinsics_utils.h"
+#include "constants.h"
 #include <stdlib.h>
 #include <float.h>
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
 
 #define FLT_DELTA (2e2 * FLT_EPSILON)
 #define DBL_DELTA (2e2 * DBL_EPSILON)
@@ -32,6 +36,7 @@ void copy_farray(float *, const float *, int);
 float serial_fdot(const float *, const float *, int);
 float serial_fsum(const float *, int);
 float serial_fdot_kahan(const float *, const float *, int);
+void serial_sgemv(char, int, int, const float *, int, const float *, float *);
 
 // Forward declarations for double precision functions.
 void random_darray(double *, int, double, double);
@@ -41,6 +46,7 @@ void copy_darray(double *, const double *, int);
 double serial_ddot(const double *, const double *, int);
 double serial_dsum(const double *, int);
 double serial_ddot_kahan(const double *, const double *, int);
+void serial_dgemv(char, int, int, const double *, int, const double *, double *);
 
 // Forward declarations fo setting indices.
 void random_index_array(int *, int);
@@ -51,12 +57,44 @@ void test_m256_fdot(void);
 void test_m256_fdot_indexed(void);
 void test_m256_ddot(void);
 void test_m256_ddot_indexed(void);
+void test_m256_fdot_lengths(void);
+void test_m256_ddot_lengths(void);
+void test_m256_fdot_kahan(void);
+void test_m256_ddot_kahan(void);
+void test_m256_fdot_acc64(void);
+void test_m256_api64(void);
+void test_m256_copy2d_64(void);
+void test_m256_gemv(void);
+void test_m256_prefetch(void);
+void test_m256_emulated_gather(void);
+void test_m256_register_min(void);
+void test_m256_stream(void);
+void test_stream_threshold(void);
+void test_m256_int_dot(void);
+void test_m256_half(void);
+void test_m256_transpose(void);
 
 #ifdef SUPPORTS_AVX512
 void test_m512_fdot(void);
 void test_m512_fdot_indexed(void);
 void test_m512_ddot(void);
 void test_m512_ddot_indexed(void);
+void test_m512_fdot_lengths(void);
+void test_m512_ddot_lengths(void);
+void test_m512_fdot_kahan(void);
+void test_m512_ddot_kahan(void);
+void test_m512_fdot_acc64(void);
+void test_m512_api64(void);
+void test_m512_gemv(void);
+void test_m512_prefetch(void);
+void test_m512_emulated_gather(void);
+void test_m512_copy(void);
+void test_m512_permute(void);
+void test_m512_register_min(void);
+void test_m512_stream(void);
+void test_m512_int_dot(void);
+void test_m512_half(void);
+void test_m512_transpose(void);
 #endif
 
 int main(int argc, char *argv[])
@@ -79,12 +117,44 @@ int main(int argc, char *argv[])
     RUN_TEST(test_m256_fdot_indexed);
     RUN_TEST(test_m256_ddot);
     RUN_TEST(test_m256_ddot_indexed);
+    RUN_TEST(test_m256_fdot_lengths);
+    RUN_TEST(test_m256_ddot_lengths);
+    RUN_TEST(test_m256_fdot_kahan);
+    RUN_TEST(test_m256_ddot_kahan);
+    RUN_TEST(test_m256_fdot_acc64);
+    RUN_TEST(test_m256_api64);
+    RUN_TEST(test_m256_copy2d_64);
+    RUN_TEST(test_m256_gemv);
+    RUN_TEST(test_m256_prefetch);
+    RUN_TEST(test_m256_emulated_gather);
+    RUN_TEST(test_m256_register_min);
+    RUN_TEST(test_m256_stream);
+    RUN_TEST(test_stream_threshold);
+    RUN_TEST(test_m256_int_dot);
+    RUN_TEST(test_m256_half);
+    RUN_TEST(test_m256_transpose);
 
 #ifdef SUPPORTS_AVX512
     RUN_TEST(test_m512_fdot);
     RUN_TEST(test_m512_fdot_indexed);
     RUN_TEST(test_m512_ddot);
     RUN_TEST(test_m512_ddot_indexed);
+    RUN_TEST(test_m512_fdot_lengths);
+    RUN_TEST(test_m512_ddot_lengths);
+    RUN_TEST(test_m512_fdot_kahan);
+    RUN_TEST(test_m512_ddot_kahan);
+    RUN_TEST(test_m512_fdot_acc64);
+    RUN_TEST(test_m512_api64);
+    RUN_TEST(test_m512_gemv);
+    RUN_TEST(test_m512_prefetch);
+    RUN_TEST(test_m512_emulated_gather);
+    RUN_TEST(test_m512_copy);
+    RUN_TEST(test_m512_permute);
+    RUN_TEST(test_m512_register_min);
+    RUN_TEST(test_m512_stream);
+    RUN_TEST(test_m512_int_dot);
+    RUN_TEST(test_m512_half);
+    RUN_TEST(test_m512_transpose);
 #endif
 
     return UNITY_END();
@@ -172,6 +242,19 @@ float serial_fdot(const float *x, const float *y, int len)
     return sum;   
 }
 
+void serial_sgemv(char order, int nrows, int ncols, const float *a, int lda, const float *x, float *y)
+{
+    for (int r = 0; r < nrows; r++) {
+        double sum = 0;
+
+        for (int c = 0; c < ncols; c++) {
+            sum += (double)(order == ROW_MAJOR_ORDER ? a[r * lda + c] : a[r + c * lda]) * x[c];
+        }
+
+        y[r] = (float)sum;
+    }
+}
+
 float serial_fsum(const float *x, int len)
 {
     float sum = 0;
@@ -233,6 +316,17 @@ double serial_dsum(const double *x, int len)
     return sum;   
 }
 
+void serial_dgemv(char order, int nrows, int ncols, const double *a, int lda, const double *x, double *y)
+{
+    for (int r = 0; r < nrows; r++) {
+        y[r] = 0;
+
+        for (int c = 0; c < ncols; c++) {
+            y[r] += (order == ROW_MAJOR_ORDER ? a[r * lda + c] : a[r + c * lda]) * x[c];
+        }
+    }
+}
+
 double serial_ddot_kahan(const double *x, const double *y, int len)
 {
     double z, t;
@@ -398,6 +492,787 @@ void test_m256_ddot_indexed(void)
     TEST_ASSERT_LESS_THAN_FLOAT(DBL_DELTA, m256_rel_err);   
 }
 
+// Sweep the lengths covering every combination of masked prologue and
+// unrolled-loop remainder, checking against a double precision reference.
+void test_m256_fdot_lengths(void)
+{
+    int max_len = m < 200 ? m : 200;
+    double exact, abs_sum;
+
+    random_farray(xf, max_len, -1.0f, 1.0f);
+    random_farray(yf, max_len, -1.0f, 1.0f);
+
+    for (int len = 0; len <= max_len; len++) {
+        exact = abs_sum = 0;
+
+        for (int i = 0; i < len; i++) {
+            exact += (double)xf[i] * yf[i];
+            abs_sum += fabs((double)xf[i] * yf[i]);
+        }
+
+        TEST_ASSERT_FLOAT_WITHIN(abs_sum * FLT_DELTA + FLT_MIN, exact, _mm256_fdot(xf, yf, len));
+    }
+}
+
+void test_m256_ddot_lengths(void)
+{
+    int max_len = m < 200 ? m : 200;
+    double exact, abs_sum;
+
+    random_darray(xd, max_len, -1.0, 1.0);
+    random_darray(yd, max_len, -1.0, 1.0);
+
+    for (int len = 0; len <= max_len; len++) {
+        exact = abs_sum = 0;
+
+        for (int i = 0; i < len; i++) {
+            exact += xd[i] * yd[i];
+            abs_sum += fabs(xd[i] * yd[i]);
+        }
+
+        TEST_ASSERT_DOUBLE_WITHIN(abs_sum * DBL_DELTA + DBL_MIN, exact, _mm256_ddot(xd, yd, len));
+    }
+}
+
+// Sum a long vector of a constant that is not exactly representable. The
+// plain kernel drifts by many ulps, while the compensated ones must stay
+// within a couple of ulps of the exact result.
+void test_m256_fdot_kahan(void)
+{
+    int len = (1 << 20) + 5;
+    float *x = malloc(len * sizeof(float));
+    float *y = malloc(len * sizeof(float));
+    int *indices = malloc(len * sizeof(int));
+
+    TEST_ASSERT_NOT_NULL(x);
+    TEST_ASSERT_NOT_NULL(y);
+    TEST_ASSERT_NOT_NULL(indices);
+
+    set_farray(x, len, 0.1f);
+    set_farray(y, len, 1.0f);
+    random_index_array(indices, len);
+
+    double exact_dot = (double)len * (double)x[0];
+    float m256_dot = _mm256_fdot(x, y, len);
+    float m256_dot_kahan = _mm256_fdot_kahan(x, y, len);
+    float m256_dot_idx_kahan = _mm256_fdot_indexed_kahan(x, indices, y, len);
+    double m256_rel_err = fabs(m256_dot_kahan - exact_dot) / exact_dot;
+    double m256_idx_rel_err = fabs(m256_dot_idx_kahan - exact_dot) / exact_dot;
+
+    TEST_PRINTF("exact:                            %f", exact_dot);
+    TEST_PRINTF("m256:                             %f", m256_dot);
+    TEST_PRINTF("m256 kahan:                       %f", m256_dot_kahan);
+    TEST_PRINTF("m256 kahan random indices:        %f", m256_dot_idx_kahan);
+    TEST_PRINTF("m256 kahan relative error:        %e", m256_rel_err);
+
+    free(x);
+    free(y);
+    free(indices);
+
+    TEST_ASSERT_LESS_THAN_FLOAT(2 * FLT_EPSILON, m256_rel_err);
+    TEST_ASSERT_LESS_THAN_FLOAT(2 * FLT_EPSILON, m256_idx_rel_err);
+}
+
+void test_m256_ddot_kahan(void)
+{
+    int len = (1 << 20) + 3;
+    double *x = malloc(len * sizeof(double));
+    double *y = malloc(len * sizeof(double));
+    int *indices = malloc(len * sizeof(int));
+
+    TEST_ASSERT_NOT_NULL(x);
+    TEST_ASSERT_NOT_NULL(y);
+    TEST_ASSERT_NOT_NULL(indices);
+
+    set_darray(x, len, 0.1);
+    set_darray(y, len, 1.0);
+    random_index_array(indices, len);
+
+    long double exact_dot = (long double)len * (long double)x[0];
+    double m256_dot = _mm256_ddot(x, y, len);
+    double m256_dot_kahan = _mm256_ddot_kahan(x, y, len);
+    double m256_dot_idx_kahan = _mm256_ddot_indexed_kahan(x, indices, y, len);
+    double m256_rel_err = (double)(fabsl(m256_dot_kahan - exact_dot) / exact_dot);
+    double m256_idx_rel_err = (double)(fabsl(m256_dot_idx_kahan - exact_dot) / exact_dot);
+
+    TEST_PRINTF("exact:                            %Lf", exact_dot);
+    TEST_PRINTF("m256:                             %lf", m256_dot);
+    TEST_PRINTF("m256 kahan:                       %lf", m256_dot_kahan);
+    TEST_PRINTF("m256 kahan random indices:        %lf", m256_dot_idx_kahan);
+    TEST_PRINTF("m256 kahan relative error:        %e", m256_rel_err);
+
+    free(x);
+    free(y);
+    free(indices);
+
+    TEST_ASSERT_LESS_THAN_DOUBLE(2 * DBL_EPSILON, m256_rel_err);
+    TEST_ASSERT_LESS_THAN_DOUBLE(2 * DBL_EPSILON, m256_idx_rel_err);
+}
+
+// Float inputs accumulated in double must match the double dot product of
+// the same values to within the usual bound for recursive summation.
+void test_m256_fdot_acc64(void)
+{
+    int len = (1 << 20) + 7;
+    float *x = malloc(len * sizeof(float));
+    float *y = malloc(len * sizeof(float));
+    int *indices = malloc(2 * len * sizeof(int));
+
+    TEST_ASSERT_NOT_NULL(x);
+    TEST_ASSERT_NOT_NULL(y);
+    TEST_ASSERT_NOT_NULL(indices);
+
+    set_farray(x, len, 0.1f);
+    random_farray(y, len, 0.5f, 1.5f);
+    random_index_array(indices, len);
+    random_index_array(indices + len, len);
+
+    long double exact_dot = 0;
+
+    for (int i = 0; i < len; i++) {
+        exact_dot += (long double)x[i] * y[i];
+    }
+
+    float m256_dot = _mm256_fdot(x, y, len);
+    double m256_dot_acc64 = _mm256_fdot_acc64(x, y, len);
+    double m256_dot_idx_acc64 = _mm256_fdot_indexed_acc64(x, indices, y, len);
+    double m256_dot_idx2_acc64 = _mm256_fdot_indexed2_acc64(x, indices, y, indices + len, len);
+    double m256_rel_err = (double)(fabsl(m256_dot_acc64 - exact_dot) / exact_dot);
+    double m256_idx_rel_err = (double)(fabsl(m256_dot_idx_acc64 - exact_dot) / exact_dot);
+    double m256_idx2_rel_err = (double)(fabsl(m256_dot_idx2_acc64 - exact_dot) / exact_dot);
+
+    TEST_PRINTF("exact:                            %Lf", exact_dot);
+    TEST_PRINTF("m256:                             %f", m256_dot);
+    TEST_PRINTF("m256 acc64:                       %lf", m256_dot_acc64);
+    TEST_PRINTF("m256 acc64 random indices:        %lf", m256_dot_idx_acc64);
+    TEST_PRINTF("m256 acc64 relative error:        %e", m256_rel_err);
+
+    free(x);
+    free(y);
+    free(indices);
+
+    TEST_ASSERT_LESS_THAN_DOUBLE(len * DBL_EPSILON, m256_rel_err);
+    TEST_ASSERT_LESS_THAN_DOUBLE(len * DBL_EPSILON, m256_idx_rel_err);
+    TEST_ASSERT_LESS_THAN_DOUBLE(len * DBL_EPSILON, m256_idx2_rel_err);
+}
+
+// The 64-bit kernels must agree with the int ones. The indexed kernels are
+// also run against base pointers shifted down by 2^32 elements, so indices
+// that were truncated to 32 bits would read the wrong elements.
+void test_m256_api64(void)
+{
+    int64_t offset = (int64_t)1 << 32;
+    int64_t *xind64 = malloc(2 * m * sizeof(int64_t));
+    int64_t *yind64 = xind64 + m;
+
+    TEST_ASSERT_NOT_NULL(xind64);
+
+    random_farray(xf, m, -1.0f, 1.0f);
+    random_farray(yf, m, -1.0f, 1.0f);
+    random_darray(xd, m, -1.0, 1.0);
+    random_darray(yd, m, -1.0, 1.0);
+    random_index_array(xindices, m);
+    random_index_array(yindices, m);
+
+    for (int i = 0; i < m; i++) {
+        xind64[i] = xindices[i] + offset;
+        yind64[i] = yindices[i] + offset;
+    }
+
+    const float *xf_shifted = (const float *)((uintptr_t)xf - offset * sizeof(float));
+    const float *yf_shifted = (const float *)((uintptr_t)yf - offset * sizeof(float));
+    const double *xd_shifted = (const double *)((uintptr_t)xd - offset * sizeof(double));
+    const double *yd_shifted = (const double *)((uintptr_t)yd - offset * sizeof(double));
+
+    TEST_ASSERT_EQUAL_FLOAT(_mm256_fdot(xf, yf, m), _mm256_fdot_64(xf, yf, m));
+    TEST_ASSERT_EQUAL_DOUBLE(_mm256_ddot(xd, yd, m), _mm256_ddot_64(xd, yd, m));
+
+    TEST_ASSERT_FLOAT_WITHIN(m * FLT_DELTA, _mm256_fdot_indexed(xf, xindices, yf, m),
+                             _mm256_fdot_indexed_64(xf_shifted, xind64, yf, m));
+    TEST_ASSERT_FLOAT_WITHIN(m * FLT_DELTA, _mm256_fdot_indexed2(xf, xindices, yf, yindices, m),
+                             _mm256_fdot_indexed2_64(xf_shifted, xind64, yf_shifted, yind64, m));
+    TEST_ASSERT_DOUBLE_WITHIN(m * DBL_DELTA, _mm256_ddot_indexed(xd, xindices, yd, m),
+                              _mm256_ddot_indexed_64(xd_shifted, xind64, yd, m));
+    TEST_ASSERT_DOUBLE_WITHIN(m * DBL_DELTA, _mm256_ddot_indexed2(xd, xindices, yd, yindices, m),
+                              _mm256_ddot_indexed2_64(xd_shifted, xind64, yd_shifted, yind64, m));
+
+    for (int len = 0; len <= 19; len++) {
+        set_farray(xf, len + 1, 0);
+        set_darray(xd, len + 1, 0);
+
+        _mm256_sset_value_64(xf, len, 2.5f);
+        _mm256_dset_value_64(xd, len, -1.5);
+
+        for (int i = 0; i < len; i++) {
+            TEST_ASSERT_EQUAL_FLOAT(2.5f, xf[i]);
+            TEST_ASSERT_EQUAL_DOUBLE(-1.5, xd[i]);
+        }
+
+        TEST_ASSERT_EQUAL_FLOAT(0.0f, xf[len]);
+        TEST_ASSERT_EQUAL_DOUBLE(0.0, xd[len]);
+    }
+
+    free(xind64);
+}
+
+// Column offsets past 2^32 must survive in the linear indices, and the
+// 64-bit copies must agree with the int ones on small grids.
+void test_m256_copy2d_64(void)
+{
+    int64_t nrows = 1 << 20;
+    int64_t iind[] = {0, 1, 3, 7, 15, 31, 63, 127, 255, 511, 1023};
+    int64_t jind[] = {0, 1, 2047, 2048, 4095};
+    int numi = sizeof(iind) / sizeof(iind[0]);
+    int numj = sizeof(jind) / sizeof(jind[0]);
+    int64_t kind[sizeof(iind) / sizeof(iind[0]) * sizeof(jind) / sizeof(jind[0])];
+
+    _mm256_copy2d_epi64(kind, nrows, iind, jind, numi, numj);
+
+    for (int j = 0; j < numj; j++) {
+        for (int i = 0; i < numi; i++) {
+            TEST_ASSERT_TRUE(jind[j] * nrows + iind[i] == kind[j * numi + i]);
+        }
+    }
+
+    int small_nrows = 31;
+    int iind32[] = {0, 2, 3, 5, 7, 11, 13, 17, 19, 23, 29};
+    int jind32[] = {1, 4, 9, 16, 25};
+    float dst32[sizeof(iind) / sizeof(iind[0]) * sizeof(jind) / sizeof(jind[0])];
+    float dst64[sizeof(iind) / sizeof(iind[0]) * sizeof(jind) / sizeof(jind[0])];
+
+    for (int i = 0; i < numi; i++) {
+        iind[i] = iind32[i];
+    }
+
+    for (int j = 0; j < numj; j++) {
+        jind[j] = jind32[j];
+    }
+
+    random_farray(xf, small_nrows * 29, -1.0f, 1.0f);
+
+    _mm256_copy2d_indexed_ps(dst32, xf, small_nrows, iind32, jind32, numi, numj);
+    _mm256_copy2d_indexed_ps_64(dst64, xf, small_nrows, iind, jind, numi, numj);
+    TEST_ASSERT_EQUAL_FLOAT_ARRAY(dst32, dst64, numi * numj);
+
+    // Tiles of 16 rows by 1 column leave every strategy a partial register.
+    iu_set_copy2d_cache(512, 256);
+
+    for (int s = COPY2D_CONTIGUOUS; s <= COPY2D_TILED; s++) {
+        iu_set_copy2d_strategy(s);
+        _mm256_copy2d_indexed_ps_64(dst64, xf, small_nrows, iind, jind, numi, numj);
+        TEST_ASSERT_EQUAL_FLOAT_ARRAY(dst32, dst64, numi * numj);
+    }
+
+    iu_set_copy2d_cache(0, 0);
+    iu_set_copy2d_strategy(COPY2D_TILED);
+
+    random_farray(yf, m, -1.0f, 1.0f);
+    _mm256_copy1d_ps_64(xf, yf, m);
+    TEST_ASSERT_EQUAL_FLOAT_ARRAY(yf, xf, m);
+
+    random_index_array(yindices, m);
+    _mm256_copy1d_epi32_64(xindices, yindices, m);
+    TEST_ASSERT_EQUAL_INT32_ARRAY(yindices, xindices, m);
+}
+
+// Both storage orders over sizes that leave ragged row blocks and column
+// tails, with a leading dimension larger than the matrix. The element past
+// the end of y must be left alone.
+void test_m256_gemv(void)
+{
+    int sizes[] = {0, 1, 3, 7, 8, 9, 16, 17, 37, 70};
+    int num_sizes = sizeof(sizes) / sizeof(sizes[0]);
+    char orders[] = {ROW_MAJOR_ORDER, COLUMN_MAJOR_ORDER};
+    int lda = 75;
+    float *af = malloc(lda * lda * sizeof(float));
+    double *ad = malloc(lda * lda * sizeof(double));
+    float expf[71], gotf[71];
+    double expd[71], gotd[71];
+
+    TEST_ASSERT_NOT_NULL(af);
+    TEST_ASSERT_NOT_NULL(ad);
+
+    random_farray(af, lda * lda, -1.0f, 1.0f);
+    random_darray(ad, lda * lda, -1.0, 1.0);
+    random_farray(xf, lda, -1.0f, 1.0f);
+    random_darray(xd, lda, -1.0, 1.0);
+
+    for (int o = 0; o < 2; o++) {
+        for (int i = 0; i < num_sizes; i++) {
+            for (int j = 0; j < num_sizes; j++) {
+                int nrows = sizes[i];
+                int ncols = sizes[j];
+
+                set_farray(gotf, nrows + 1, 0);
+                set_darray(gotd, nrows + 1, 0);
+
+                serial_sgemv(orders[o], nrows, ncols, af, lda, xf, expf);
+                serial_dgemv(orders[o], nrows, ncols, ad, lda, xd, expd);
+                _mm256_sgemv(orders[o], nrows, ncols, af, lda, xf, gotf);
+                _mm256_dgemv(orders[o], nrows, ncols, ad, lda, xd, gotd);
+
+                for (int r = 0; r < nrows; r++) {
+                    TEST_ASSERT_FLOAT_WITHIN((ncols + 1) * FLT_DELTA, expf[r], gotf[r]);
+                    TEST_ASSERT_DOUBLE_WITHIN((ncols + 1) * DBL_DELTA, expd[r], gotd[r]);
+                }
+
+                TEST_ASSERT_EQUAL_FLOAT(0.0f, gotf[nrows]);
+                TEST_ASSERT_EQUAL_DOUBLE(0.0, gotd[nrows]);
+            }
+        }
+    }
+
+    // An unknown order leaves y untouched.
+    set_farray(gotf, 8, 1.0f);
+    _mm256_sgemv('x', 8, 8, af, lda, xf, gotf);
+    TEST_ASSERT_EQUAL_FLOAT(1.0f, gotf[0]);
+
+    free(af);
+    free(ad);
+}
+
+// The prefetching kernels must agree with the plain ones for every length
+// and for distances shorter than, equal to and longer than the input.
+void test_m256_prefetch(void)
+{
+    int distances[] = {0, 1, 7, 64, 1000};
+    int num_distances = sizeof(distances) / sizeof(distances[0]);
+    int maxlen = m < 300 ? m : 300;
+
+    random_farray(xf, m, -1.0f, 1.0f);
+    random_farray(yf, m, -1.0f, 1.0f);
+    random_darray(xd, m, -1.0, 1.0);
+    random_darray(yd, m, -1.0, 1.0);
+    random_index_array(xindices, m);
+    random_index_array(yindices, m);
+
+    for (int len = 0; len <= maxlen; len++) {
+        float fdot_idx = _mm256_fdot_indexed(xf, xindices, yf, len);
+        float fdot_idx2 = _mm256_fdot_indexed2(xf, xindices, yf, yindices, len);
+        double ddot_idx = _mm256_ddot_indexed(xd, xindices, yd, len);
+        double ddot_idx2 = _mm256_ddot_indexed2(xd, xindices, yd, yindices, len);
+
+        for (int d = 0; d < num_distances; d++) {
+            TEST_ASSERT_FLOAT_WITHIN((len + 1) * FLT_DELTA, fdot_idx, _mm256_fdot_indexed_prefetch(xf, xindices, yf, len, distances[d]));
+            TEST_ASSERT_FLOAT_WITHIN((len + 1) * FLT_DELTA, fdot_idx2, _mm256_fdot_indexed2_prefetch(xf, xindices, yf, yindices, len, distances[d]));
+            TEST_ASSERT_DOUBLE_WITHIN((len + 1) * DBL_DELTA, ddot_idx, _mm256_ddot_indexed_prefetch(xd, xindices, yd, len, distances[d]));
+            TEST_ASSERT_DOUBLE_WITHIN((len + 1) * DBL_DELTA, ddot_idx2, _mm256_ddot_indexed2_prefetch(xd, xindices, yd, yindices, len, distances[d]));
+        }
+    }
+
+    int nrows = 31;
+    int iind[] = {0, 2, 3, 5, 7, 11, 13, 17, 19, 23, 29};
+    int jind[] = {1, 4, 9, 16, 25};
+    int numi = sizeof(iind) / sizeof(iind[0]);
+    int numj = sizeof(jind) / sizeof(jind[0]);
+    float dst[sizeof(iind) / sizeof(iind[0]) * sizeof(jind) / sizeof(jind[0])];
+    float dst_prefetch[sizeof(iind) / sizeof(iind[0]) * sizeof(jind) / sizeof(jind[0])];
+
+    random_farray(xf, nrows * 29, -1.0f, 1.0f);
+    _mm256_copy2d_indexed_ps(dst, xf, nrows, iind, jind, numi, numj);
+
+    for (int d = 0; d < num_distances; d++) {
+        _mm256_copy2d_indexed_ps_prefetch(dst_prefetch, xf, nrows, iind, jind, numi, numj, distances[d]);
+        TEST_ASSERT_EQUAL_FLOAT_ARRAY(dst, dst_prefetch, numi * numj);
+    }
+
+    // Columns shorter than the distance put the targets several columns
+    // ahead, up to and past the last column. The index arrays are exactly as
+    // long as the copy, so a look-ahead past them would read out of bounds.
+    int numj_short = 40;
+    int *iind_short = malloc(31 * sizeof(int));
+    int *jind_short = malloc(numj_short * sizeof(int));
+    float *dst_short = malloc(31 * numj_short * sizeof(float));
+    float *dst_short_prefetch = malloc(31 * numj_short * sizeof(float));
+
+    TEST_ASSERT_NOT_NULL(iind_short);
+    TEST_ASSERT_NOT_NULL(jind_short);
+    TEST_ASSERT_NOT_NULL(dst_short);
+    TEST_ASSERT_NOT_NULL(dst_short_prefetch);
+
+    for (int j = 0; j < numj_short; j++) {
+        jind_short[j] = (j * 7) % 29;
+    }
+
+    for (int numi_short = 1; numi_short < 32; numi_short++) {
+        for (int i = 0; i < numi_short; i++) {
+            iind_short[i] = (i * 11) % nrows;
+        }
+
+        _mm256_copy2d_indexed_ps(dst_short, xf, nrows, iind_short, jind_short, numi_short, numj_short);
+
+        for (int d = 0; d < num_distances; d++) {
+            _mm256_copy2d_indexed_ps_prefetch(dst_short_prefetch, xf, nrows, iind_short, jind_short, numi_short, numj_short, distances[d]);
+            TEST_ASSERT_EQUAL_FLOAT_ARRAY(dst_short, dst_short_prefetch, numi_short * numj_short);
+        }
+    }
+
+    free(iind_short);
+    free(jind_short);
+    free(dst_short);
+    free(dst_short_prefetch);
+}
+
+// Kernels built from scalar loads must agree with the gather kernels for
+// every length, including the masked tails.
+void test_m256_emulated_gather(void)
+{
+    int maxlen = m < 300 ? m : 300;
+
+    random_farray(xf, m, -1.0f, 1.0f);
+    random_farray(yf, m, -1.0f, 1.0f);
+    random_darray(xd, m, -1.0, 1.0);
+    random_darray(yd, m, -1.0, 1.0);
+    random_index_array(xindices, m);
+    random_index_array(yindices, m);
+
+    for (int len = 0; len <= maxlen; len++) {
+        TEST_ASSERT_FLOAT_WITHIN((len + 1) * FLT_DELTA, _mm256_fdot_indexed(xf, xindices, yf, len),
+                                 _mm256_fdot_indexed_emu(xf, xindices, yf, len));
+        TEST_ASSERT_FLOAT_WITHIN((len + 1) * FLT_DELTA, _mm256_fdot_indexed2(xf, xindices, yf, yindices, len),
+                                 _mm256_fdot_indexed2_emu(xf, xindices, yf, yindices, len));
+        TEST_ASSERT_DOUBLE_WITHIN((len + 1) * DBL_DELTA, _mm256_ddot_indexed(xd, xindices, yd, len),
+                                  _mm256_ddot_indexed_emu(xd, xindices, yd, len));
+        TEST_ASSERT_DOUBLE_WITHIN((len + 1) * DBL_DELTA, _mm256_ddot_indexed2(xd, xindices, yd, yindices, len),
+                                  _mm256_ddot_indexed2_emu(xd, xindices, yd, yindices, len));
+    }
+
+    int nrows = 31;
+    int iind[] = {0, 2, 3, 5, 7, 11, 13, 17, 19, 23, 29};
+    int jind[] = {1, 4, 9, 16, 25};
+    int numi = sizeof(iind) / sizeof(iind[0]);
+    int numj = sizeof(jind) / sizeof(jind[0]);
+    float dst[sizeof(iind) / sizeof(iind[0]) * sizeof(jind) / sizeof(jind[0])];
+    float dst_emu[sizeof(iind) / sizeof(iind[0]) * sizeof(jind) / sizeof(jind[0])];
+
+    _mm256_copy2d_indexed_ps(dst, xf, nrows, iind, jind, numi, numj);
+    _mm256_copy2d_indexed_ps_emu(dst_emu, xf, nrows, iind, jind, numi, numj);
+    TEST_ASSERT_EQUAL_FLOAT_ARRAY(dst, dst_emu, numi * numj);
+}
+
+// The minimum and maximum are planted at every position in turn.
+void test_m256_register_min(void)
+{
+    for (int trial = 0; trial < 64; trial++) {
+        random_farray(xf, FLOAT_PER_M256_REG, -1.0f, 1.0f);
+        random_darray(xd, DOUBLE_PER_M256_REG, -1.0, 1.0);
+        xf[trial % FLOAT_PER_M256_REG] = -2.0f - trial;
+        xd[trial % DOUBLE_PER_M256_REG] = -2.0 - trial;
+        xf[(trial + 1) % FLOAT_PER_M256_REG] = 2.0f + trial;
+        xd[(trial + 1) % DOUBLE_PER_M256_REG] = 2.0 + trial;
+
+        TEST_ASSERT_EQUAL_FLOAT(-2.0f - trial, _mm256_register_min_ps(_mm256_loadu_ps(xf)));
+        TEST_ASSERT_EQUAL_DOUBLE(-2.0 - trial, _mm256_register_min_pd(_mm256_loadu_pd(xd)));
+        TEST_ASSERT_EQUAL_FLOAT(2.0f + trial, _mm256_register_max_ps(_mm256_loadu_ps(xf)));
+        TEST_ASSERT_EQUAL_DOUBLE(2.0 + trial, _mm256_register_max_pd(_mm256_loadu_pd(xd)));
+
+        xf[trial % FLOAT_PER_M128_REG] = -3.0f - trial;
+        xd[trial % DOUBLE_PER_M128_REG] = -3.0 - trial;
+        xf[(trial + 1) % FLOAT_PER_M128_REG] = 3.0f + trial;
+        xd[(trial + 1) % DOUBLE_PER_M128_REG] = 3.0 + trial;
+
+        TEST_ASSERT_EQUAL_FLOAT(-3.0f - trial, _mm_register_min_ps(_mm_loadu_ps(xf)));
+        TEST_ASSERT_EQUAL_DOUBLE(-3.0 - trial, _mm_register_min_pd(_mm_loadu_pd(xd)));
+        TEST_ASSERT_EQUAL_FLOAT(3.0f + trial, _mm_register_max_ps(_mm_loadu_ps(xf)));
+        TEST_ASSERT_EQUAL_DOUBLE(3.0 + trial, _mm_register_max_pd(_mm_loadu_pd(xd)));
+    }
+}
+
+// With a one-byte threshold every non-empty call streams, so starting
+// offsets that cover each alignment within a register exercise the peeled
+// head, the streamed body and the masked tail.
+void test_m256_stream(void)
+{
+    int maxlen = m < 117 ? m - 17 : 100;
+
+    iu_set_stream_threshold(1);
+
+    random_farray(yf, m, -1.0f, 1.0f);
+    random_index_array(yindices, m);
+
+    for (int offset = 0; offset < 16; offset++) {
+        for (int len = 0; len <= maxlen; len++) {
+            float *fdst = xf + offset;
+            double *ddst = xd + offset;
+            int *idst = xindices + offset;
+
+            set_farray(fdst, len + 1, -7.0f);
+            set_darray(ddst, len + 1, -7.0);
+
+            _mm256_sset_value(fdst, len, 0.5f);
+            _mm256_dset_value(ddst, len, 0.5);
+
+            for (int i = 0; i < len; i++) {
+                TEST_ASSERT_EQUAL_FLOAT(0.5f, fdst[i]);
+                TEST_ASSERT_EQUAL_DOUBLE(0.5, ddst[i]);
+            }
+
+            TEST_ASSERT_EQUAL_FLOAT(-7.0f, fdst[len]);
+            TEST_ASSERT_EQUAL_DOUBLE(-7.0, ddst[len]);
+
+            set_farray(fdst, len + 1, -7.0f);
+            seq_index_array(idst, len + 1, -7, 0);
+
+            _mm256_copy1d_ps(fdst, yf + 1, len);
+            _mm256_copy1d_epi32(idst, yindices + 1, len);
+
+            for (int i = 0; i < len; i++) {
+                TEST_ASSERT_EQUAL_FLOAT(yf[i + 1], fdst[i]);
+                TEST_ASSERT_EQUAL_INT(yindices[i + 1], idst[i]);
+            }
+
+            TEST_ASSERT_EQUAL_FLOAT(-7.0f, fdst[len]);
+            TEST_ASSERT_EQUAL_INT(-7, idst[len]);
+        }
+    }
+
+    iu_set_stream_threshold(0);
+}
+
+// IU_STREAM_THRESHOLD overrides the default only with a positive byte
+// count; an empty, zero or malformed value keeps the default, as
+// iu_set_stream_threshold(0) does.
+void test_stream_threshold(void)
+{
+    const char *ignored[] = {"", "0", "abc", "12abc", "-1", " 64"};
+    const char *saved = getenv("IU_STREAM_THRESHOLD");
+    char *copy = saved != NULL ? strdup(saved) : NULL;
+    size_t fallback;
+
+    unsetenv("IU_STREAM_THRESHOLD");
+    iu_set_stream_threshold(0);
+    fallback = iu_stream_threshold();
+    TEST_ASSERT_TRUE(fallback > 0);
+
+    for (int k = 0; k < (int)(sizeof(ignored) / sizeof(ignored[0])); k++) {
+        setenv("IU_STREAM_THRESHOLD", ignored[k], 1);
+        iu_set_stream_threshold(0);
+        TEST_ASSERT_EQUAL_UINT64(fallback, iu_stream_threshold());
+    }
+
+    setenv("IU_STREAM_THRESHOLD", "4096", 1);
+    iu_set_stream_threshold(0);
+    TEST_ASSERT_EQUAL_UINT64(4096, iu_stream_threshold());
+
+    if (copy != NULL) {
+        setenv("IU_STREAM_THRESHOLD", copy, 1);
+        free(copy);
+    } else {
+        unsetenv("IU_STREAM_THRESHOLD");
+    }
+
+    iu_set_stream_threshold(0);
+}
+
+// Byte products stay in 32-bit lanes for blocks of registers, so lengths
+// spanning several blocks of the largest products must still sum exactly.
+void test_m256_int_dot(void)
+{
+    int len = (1 << 20) + 37;
+    uint8_t *xu8 = malloc(len * sizeof(uint8_t));
+    int8_t *yi8 = malloc(len * sizeof(int8_t));
+    int16_t *x16 = malloc(len * sizeof(int16_t));
+    int *perm = malloc(len * sizeof(int));
+
+    TEST_ASSERT_NOT_NULL(xu8);
+    TEST_ASSERT_NOT_NULL(yi8);
+    TEST_ASSERT_NOT_NULL(x16);
+    TEST_ASSERT_NOT_NULL(perm);
+
+    for (int i = 0; i < len; i++) {
+        xu8[i] = UINT8_MAX;
+        yi8[i] = INT8_MIN;
+        x16[i] = INT16_MIN;
+        perm[i] = len - 1 - i;
+    }
+
+    TEST_ASSERT_EQUAL_INT64((int64_t)len * -32640, _mm256_dot_u8i8(xu8, yi8, len));
+    TEST_ASSERT_EQUAL_INT64((int64_t)len * -32640, _mm256_dot_indexed_u8i8(xu8, perm, yi8, len));
+    TEST_ASSERT_EQUAL_INT64((int64_t)len << 30, _mm256_dot_epi16(x16, x16, len));
+    TEST_ASSERT_EQUAL_INT64((int64_t)len << 30, _mm256_dot_indexed_epi16(x16, perm, x16, len));
+#ifdef SUPPORTS_AVXVNNI
+    if (SUPPORTS_AVXVNNI) {
+        TEST_ASSERT_EQUAL_INT64((int64_t)len * -32640, _mm256_dot_u8i8_vnni(xu8, yi8, len));
+    }
+#endif
+
+    // Short random inputs against a scalar reference, for every tail length.
+    for (int n = 0; n <= 200; n++) {
+        int64_t exact8 = 0, exact16 = 0, indexed8 = 0, indexed16 = 0;
+
+        for (int i = 0; i < n; i++) {
+            xu8[i] = (uint8_t)rand();
+            yi8[i] = (int8_t)rand();
+            x16[i] = (int16_t)rand();
+        }
+
+        random_index_array(perm, n);
+
+        for (int i = 0; i < n; i++) {
+            exact8 += (int64_t)xu8[i] * yi8[i];
+            exact16 += (int64_t)x16[i] * x16[i];
+            indexed8 += (int64_t)xu8[perm[i]] * yi8[i];
+            indexed16 += (int64_t)x16[perm[i]] * x16[i];
+        }
+
+        TEST_ASSERT_EQUAL_INT64(exact8, _mm256_dot_u8i8(xu8, yi8, n));
+        TEST_ASSERT_EQUAL_INT64(exact16, _mm256_dot_epi16(x16, x16, n));
+        TEST_ASSERT_EQUAL_INT64(indexed8, _mm256_dot_indexed_u8i8(xu8, perm, yi8, n));
+        TEST_ASSERT_EQUAL_INT64(indexed16, _mm256_dot_indexed_epi16(x16, perm, x16, n));
+#ifdef SUPPORTS_AVXVNNI
+        if (SUPPORTS_AVXVNNI) {
+            TEST_ASSERT_EQUAL_INT64(exact8, _mm256_dot_u8i8_vnni(xu8, yi8, n));
+        }
+#endif
+    }
+
+    free(xu8);
+    free(yi8);
+    free(x16);
+    free(perm);
+}
+
+// The F16C conversions must match the integer ones of the SSE kernels bit
+// for bit, on every half and on floats around each rounding boundary. The
+// offset calls take the scalar heads through the same inputs.
+void test_m256_half(void)
+{
+    int count = 1 << 16;
+    uint16_t *h = malloc(count * sizeof(uint16_t));
+    uint16_t *href = malloc(count * sizeof(uint16_t));
+    float *f = malloc(count * sizeof(float));
+    float *fref = malloc(count * sizeof(float));
+    int *perm = malloc(count * sizeof(int));
+    uint32_t bits;
+    double exact = 0, indexed = 0, scale = 0;
+
+    TEST_ASSERT_NOT_NULL(h);
+    TEST_ASSERT_NOT_NULL(href);
+    TEST_ASSERT_NOT_NULL(f);
+    TEST_ASSERT_NOT_NULL(fref);
+    TEST_ASSERT_NOT_NULL(perm);
+
+    for (int i = 0; i < count; i++) {
+        h[i] = (uint16_t)i;
+    }
+
+    for (int offset = 0; offset < 2; offset++) {
+        _mm_cvt_f16_to_f32(fref + offset, h + offset, count - offset);
+        _mm256_cvt_f16_to_f32(f + offset, h + offset, count - offset);
+        TEST_ASSERT_EQUAL_MEMORY(fref + offset, f + offset, (count - offset) * sizeof(float));
+    }
+
+    // Random floats, mostly within the range of halves, plus values on the
+    // overflow, subnormal and rounding boundaries.
+    for (int i = 0; i < count; i++) {
+        bits = ((uint32_t)rand() << 16) ^ (uint32_t)rand();
+
+        if (i % 4 != 0) {
+            bits = (bits & 0x807fffffu) | (uint32_t)(100 + rand() % 46) << 23;
+        }
+
+        if (i % 16 == 1) {
+            bits &= 0xffffe000u;
+            bits |= 0x1000u;
+        }
+
+        memcpy(f + i, &bits, sizeof(float));
+    }
+
+    f[0] = 65504.0f;
+    f[1] = 65520.0f;
+    f[2] = 0x1p-25f;
+    f[3] = 0x1.8p-24f;
+    f[4] = INFINITY;
+    f[5] = -NAN;
+
+    for (int offset = 0; offset < 2; offset++) {
+        _mm_cvt_f32_to_f16(href + offset, f + offset, count - offset);
+        _mm256_cvt_f32_to_f16(h + offset, f + offset, count - offset);
+        TEST_ASSERT_EQUAL_MEMORY(href + offset, h + offset, (count - offset) * sizeof(uint16_t));
+    }
+
+    TEST_ASSERT_EQUAL_HEX16(0x7bff, h[0]);
+    TEST_ASSERT_EQUAL_HEX16(0x7c00, h[1]);
+    TEST_ASSERT_EQUAL_HEX16(0x0000, h[2]);
+    TEST_ASSERT_EQUAL_HEX16(0x0002, h[3]);
+
+    // Double accumulation of finite halves in [-2, 2).
+    for (int i = 0; i < count; i++) {
+        h[i] = (uint16_t)rand() & 0xbfff;
+        href[i] = (uint16_t)rand() & 0xbfff;
+    }
+
+    random_index_array(perm, count);
+    _mm_cvt_f16_to_f32(f, h, count);
+    _mm_cvt_f16_to_f32(fref, href, count);
+
+    for (int i = 0; i < count - 1; i++) {
+        exact += (double)f[i] * fref[i];
+        indexed += (double)f[perm[i]] * fref[i];
+        scale += fabs((double)f[i] * fref[i]);
+    }
+
+    TEST_ASSERT_DOUBLE_WITHIN(1e-12 * scale, exact, _mm256_hdot_acc64(h, href, count - 1));
+    TEST_ASSERT_DOUBLE_WITHIN(1e-12 * scale, indexed, _mm256_hdot_indexed_acc64(h, perm, href, count - 1));
+    TEST_ASSERT_DOUBLE_WITHIN(1e-4 * scale, exact, _mm256_hdot(h, href, count - 1));
+    TEST_ASSERT_DOUBLE_WITHIN(1e-4 * scale, indexed, _mm256_hdot_indexed(h, perm, href, count - 1));
+
+    free(h);
+    free(href);
+    free(f);
+    free(fref);
+    free(perm);
+}
+
+// Lane j of register i holds i * width + j, so after the transpose lane i
+// of register j must hold the same value.
+void test_m256_transpose(void)
+{
+    __m256 rf[FLOAT_PER_M256_REG];
+    __m256i ri[INT32_PER_M256_REG];
+    __m256d rd[DOUBLE_PER_M256_REG];
+    float f[FLOAT_PER_M256_REG];
+    int k[INT32_PER_M256_REG];
+    double d[DOUBLE_PER_M256_REG];
+
+    for (int i = 0; i < FLOAT_PER_M256_REG; i++) {
+        for (int j = 0; j < FLOAT_PER_M256_REG; j++) {
+            f[j] = 8 * i + j;
+            k[j] = -(8 * i + j);
+        }
+
+        rf[i] = _mm256_loadu_ps(f);
+        ri[i] = _mm256_loadu_si256((const __m256i *)k);
+    }
+
+    for (int i = 0; i < DOUBLE_PER_M256_REG; i++) {
+        rd[i] = _mm256_setr_pd(4 * i, 4 * i + 1, 4 * i + 2, 4 * i + 3);
+    }
+
+    _mm256_transpose8_ps(rf);
+    _mm256_transpose8_epi32(ri);
+    _mm256_transpose4_pd(rd);
+
+    for (int j = 0; j < FLOAT_PER_M256_REG; j++) {
+        _mm256_storeu_ps(f, rf[j]);
+        _mm256_storeu_si256((__m256i *)k, ri[j]);
+
+        for (int i = 0; i < FLOAT_PER_M256_REG; i++) {
+            TEST_ASSERT_EQUAL_FLOAT(8 * i + j, f[i]);
+            TEST_ASSERT_EQUAL_INT(-(8 * i + j), k[i]);
+        }
+    }
+
+    for (int j = 0; j < DOUBLE_PER_M256_REG; j++) {
+        _mm256_storeu_pd(d, rd[j]);
+
+        for (int i = 0; i < DOUBLE_PER_M256_REG; i++) {
+            TEST_ASSERT_EQUAL_DOUBLE(4 * i + j, d[i]);
+        }
+    }
+}
+
 #ifdef SUPPORTS_AVX512
 void test_m512_fdot(void)
 {
@@ -516,4 +1391,730 @@ void test_m512_ddot_indexed(void)
     if (m512_rel_err < 0) m512_rel_err = -m512_rel_err;
     TEST_ASSERT_LESS_THAN_FLOAT(FLT_DELTA, m512_rel_err);   
 }
+
+void test_m512_fdot_lengths(void)
+{
+    int max_len = m < 200 ? m : 200;
+    double exact, abs_sum;
+
+    random_farray(xf, max_len, -1.0f, 1.0f);
+    random_farray(yf, max_len, -1.0f, 1.0f);
+
+    for (int len = 0; len <= max_len; len++) {
+        exact = abs_sum = 0;
+
+        for (int i = 0; i < len; i++) {
+            exact += (double)xf[i] * yf[i];
+            abs_sum += fabs((double)xf[i] * yf[i]);
+        }
+
+        TEST_ASSERT_FLOAT_WITHIN(abs_sum * FLT_DELTA + FLT_MIN, exact, _mm512_fdot(xf, yf, len));
+    }
+}
+
+void test_m512_ddot_lengths(void)
+{
+    int max_len = m < 200 ? m : 200;
+    double exact, abs_sum;
+
+    random_darray(xd, max_len, -1.0, 1.0);
+    random_darray(yd, max_len, -1.0, 1.0);
+
+    for (int len = 0; len <= max_len; len++) {
+        exact = abs_sum = 0;
+
+        for (int i = 0; i < len; i++) {
+            exact += xd[i] * yd[i];
+            abs_sum += fabs(xd[i] * yd[i]);
+        }
+
+        TEST_ASSERT_DOUBLE_WITHIN(abs_sum * DBL_DELTA + DBL_MIN, exact, _mm512_ddot(xd, yd, len));
+    }
+}
+
+// Sum a long vector of a constant that is not exactly representable. The
+// plain kernel drifts by many ulps, while the compensated ones must stay
+// within a couple of ulps of the exact result.
+void test_m512_fdot_kahan(void)
+{
+    int len = (1 << 20) + 5;
+    float *x = malloc(len * sizeof(float));
+    float *y = malloc(len * sizeof(float));
+    int *indices = malloc(len * sizeof(int));
+
+    TEST_ASSERT_NOT_NULL(x);
+    TEST_ASSERT_NOT_NULL(y);
+    TEST_ASSERT_NOT_NULL(indices);
+
+    set_farray(x, len, 0.1f);
+    set_farray(y, len, 1.0f);
+    random_index_array(indices, len);
+
+    double exact_dot = (double)len * (double)x[0];
+    float m512_dot = _mm512_fdot(x, y, len);
+    float m512_dot_kahan = _mm512_fdot_kahan(x, y, len);
+    float m512_dot_idx_kahan = _mm512_fdot_indexed_kahan(x, indices, y, len);
+    double m512_rel_err = fabs(m512_dot_kahan - exact_dot) / exact_dot;
+    double m512_idx_rel_err = fabs(m512_dot_idx_kahan - exact_dot) / exact_dot;
+
+    TEST_PRINTF("exact:                            %f", exact_dot);
+    TEST_PRINTF("m512:                             %f", m512_dot);
+    TEST_PRINTF("m512 kahan:                       %f", m512_dot_kahan);
+    TEST_PRINTF("m512 kahan random indices:        %f", m512_dot_idx_kahan);
+    TEST_PRINTF("m512 kahan relative error:        %e", m512_rel_err);
+
+    free(x);
+    free(y);
+    free(indices);
+
+    TEST_ASSERT_LESS_THAN_FLOAT(2 * FLT_EPSILON, m512_rel_err);
+    TEST_ASSERT_LESS_THAN_FLOAT(2 * FLT_EPSILON, m512_idx_rel_err);
+}
+
+void test_m512_ddot_kahan(void)
+{
+    int len = (1 << 20) + 3;
+    double *x = malloc(len * sizeof(double));
+    double *y = malloc(len * sizeof(double));
+    int *indices = malloc(len * sizeof(int));
+
+    TEST_ASSERT_NOT_NULL(x);
+    TEST_ASSERT_NOT_NULL(y);
+    TEST_ASSERT_NOT_NULL(indices);
+
+    set_darray(x, len, 0.1);
+    set_darray(y, len, 1.0);
+    random_index_array(indices, len);
+
+    long double exact_dot = (long double)len * (long double)x[0];
+    double m512_dot = _mm512_ddot(x, y, len);
+    double m512_dot_kahan = _mm512_ddot_kahan(x, y, len);
+    double m512_dot_idx_kahan = _mm512_ddot_indexed_kahan(x, indices, y, len);
+    double m512_rel_err = (double)(fabsl(m512_dot_kahan - exact_dot) / exact_dot);
+    double m512_idx_rel_err = (double)(fabsl(m512_dot_idx_kahan - exact_dot) / exact_dot);
+
+    TEST_PRINTF("exact:                            %Lf", exact_dot);
+    TEST_PRINTF("m512:                             %lf", m512_dot);
+    TEST_PRINTF("m512 kahan:                       %lf", m512_dot_kahan);
+    TEST_PRINTF("m512 kahan random indices:        %lf", m512_dot_idx_kahan);
+    TEST_PRINTF("m512 kahan relative error:        %e", m512_rel_err);
+
+    free(x);
+    free(y);
+    free(indices);
+
+    TEST_ASSERT_LESS_THAN_DOUBLE(2 * DBL_EPSILON, m512_rel_err);
+    TEST_ASSERT_LESS_THAN_DOUBLE(2 * DBL_EPSILON, m512_idx_rel_err);
+}
+// Float inputs accumulated in double must match the double dot product of
+// the same values to within the usual bound for recursive summation.
+void test_m512_fdot_acc64(void)
+{
+    int len = (1 << 20) + 7;
+    float *x = malloc(len * sizeof(float));
+    float *y = malloc(len * sizeof(float));
+    int *indices = malloc(2 * len * sizeof(int));
+
+    TEST_ASSERT_NOT_NULL(x);
+    TEST_ASSERT_NOT_NULL(y);
+    TEST_ASSERT_NOT_NULL(indices);
+
+    set_farray(x, len, 0.1f);
+    random_farray(y, len, 0.5f, 1.5f);
+    random_index_array(indices, len);
+    random_index_array(indices + len, len);
+
+    long double exact_dot = 0;
+
+    for (int i = 0; i < len; i++) {
+        exact_dot += (long double)x[i] * y[i];
+    }
+
+    float m512_dot = _mm512_fdot(x, y, len);
+    double m512_dot_acc64 = _mm512_fdot_acc64(x, y, len);
+    double m512_dot_idx_acc64 = _mm512_fdot_indexed_acc64(x, indices, y, len);
+    double m512_dot_idx2_acc64 = _mm512_fdot_indexed2_acc64(x, indices, y, indices + len, len);
+    double m512_rel_err = (double)(fabsl(m512_dot_acc64 - exact_dot) / exact_dot);
+    double m512_idx_rel_err = (double)(fabsl(m512_dot_idx_acc64 - exact_dot) / exact_dot);
+    double m512_idx2_rel_err = (double)(fabsl(m512_dot_idx2_acc64 - exact_dot) / exact_dot);
+
+    TEST_PRINTF("exact:                            %Lf", exact_dot);
+    TEST_PRINTF("m512:                             %f", m512_dot);
+    TEST_PRINTF("m512 acc64:                       %lf", m512_dot_acc64);
+    TEST_PRINTF("m512 acc64 random indices:        %lf", m512_dot_idx_acc64);
+    TEST_PRINTF("m512 acc64 relative error:        %e", m512_rel_err);
+
+    free(x);
+    free(y);
+    free(indices);
+
+    TEST_ASSERT_LESS_THAN_DOUBLE(len * DBL_EPSILON, m512_rel_err);
+    TEST_ASSERT_LESS_THAN_DOUBLE(len * DBL_EPSILON, m512_idx_rel_err);
+    TEST_ASSERT_LESS_THAN_DOUBLE(len * DBL_EPSILON, m512_idx2_rel_err);
+}
+// The 64-bit kernels must agree with the int ones. The indexed kernels are
+// also run against base pointers shifted down by 2^32 elements, so indices
+// that were truncated to 32 bits would read the wrong elements.
+void test_m512_api64(void)
+{
+    int64_t offset = (int64_t)1 << 32;
+    int64_t *xind64 = malloc(2 * m * sizeof(int64_t));
+    int64_t *yind64 = xind64 + m;
+
+    TEST_ASSERT_NOT_NULL(xind64);
+
+    random_farray(xf, m, -1.0f, 1.0f);
+    random_farray(yf, m, -1.0f, 1.0f);
+    random_darray(xd, m, -1.0, 1.0);
+    random_darray(yd, m, -1.0, 1.0);
+    random_index_array(xindices, m);
+    random_index_array(yindices, m);
+
+    for (int i = 0; i < m; i++) {
+        xind64[i] = xindices[i] + offset;
+        yind64[i] = yindices[i] + offset;
+    }
+
+    const float *xf_shifted = (const float *)((uintptr_t)xf - offset * sizeof(float));
+    const float *yf_shifted = (const float *)((uintptr_t)yf - offset * sizeof(float));
+    const double *xd_shifted = (const double *)((uintptr_t)xd - offset * sizeof(double));
+    const double *yd_shifted = (const double *)((uintptr_t)yd - offset * sizeof(double));
+
+    TEST_ASSERT_EQUAL_FLOAT(_mm512_fdot(xf, yf, m), _mm512_fdot_64(xf, yf, m));
+    TEST_ASSERT_EQUAL_DOUBLE(_mm512_ddot(xd, yd, m), _mm512_ddot_64(xd, yd, m));
+
+    TEST_ASSERT_FLOAT_WITHIN(m * FLT_DELTA, _mm512_fdot_indexed(xf, xindices, yf, m),
+                             _mm512_fdot_indexed_64(xf_shifted, xind64, yf, m));
+    TEST_ASSERT_FLOAT_WITHIN(m * FLT_DELTA, _mm512_fdot_indexed2(xf, xindices, yf, yindices, m),
+                             _mm512_fdot_indexed2_64(xf_shifted, xind64, yf_shifted, yind64, m));
+    TEST_ASSERT_DOUBLE_WITHIN(m * DBL_DELTA, _mm512_ddot_indexed(xd, xindices, yd, m),
+                              _mm512_ddot_indexed_64(xd_shifted, xind64, yd, m));
+    TEST_ASSERT_DOUBLE_WITHIN(m * DBL_DELTA, _mm512_ddot_indexed2(xd, xindices, yd, yindices, m),
+                              _mm512_ddot_indexed2_64(xd_shifted, xind64, yd_shifted, yind64, m));
+
+    for (int len = 0; len <= 19; len++) {
+        set_farray(xf, len + 1, 0);
+        set_darray(xd, len + 1, 0);
+
+        _mm512_sset_value_64(xf, len, 2.5f);
+        _mm512_dset_value_64(xd, len, -1.5);
+
+        for (int i = 0; i < len; i++) {
+            TEST_ASSERT_EQUAL_FLOAT(2.5f, xf[i]);
+            TEST_ASSERT_EQUAL_DOUBLE(-1.5, xd[i]);
+        }
+
+        TEST_ASSERT_EQUAL_FLOAT(0.0f, xf[len]);
+        TEST_ASSERT_EQUAL_DOUBLE(0.0, xd[len]);
+    }
+
+    free(xind64);
+}
+
+// Both storage orders over sizes that leave ragged row blocks and column
+// tails, with a leading dimension larger than the matrix. The element past
+// the end of y must be left alone.
+void test_m512_gemv(void)
+{
+    int sizes[] = {0, 1, 3, 7, 8, 9, 16, 17, 37, 70};
+    int num_sizes = sizeof(sizes) / sizeof(sizes[0]);
+    char orders[] = {ROW_MAJOR_ORDER, COLUMN_MAJOR_ORDER};
+    int lda = 75;
+    float *af = malloc(lda * lda * sizeof(float));
+    double *ad = malloc(lda * lda * sizeof(double));
+    float expf[71], gotf[71];
+    double expd[71], gotd[71];
+
+    TEST_ASSERT_NOT_NULL(af);
+    TEST_ASSERT_NOT_NULL(ad);
+
+    random_farray(af, lda * lda, -1.0f, 1.0f);
+    random_darray(ad, lda * lda, -1.0, 1.0);
+    random_farray(xf, lda, -1.0f, 1.0f);
+    random_darray(xd, lda, -1.0, 1.0);
+
+    for (int o = 0; o < 2; o++) {
+        for (int i = 0; i < num_sizes; i++) {
+            for (int j = 0; j < num_sizes; j++) {
+                int nrows = sizes[i];
+                int ncols = sizes[j];
+
+                set_farray(gotf, nrows + 1, 0);
+                set_darray(gotd, nrows + 1, 0);
+
+                serial_sgemv(orders[o], nrows, ncols, af, lda, xf, expf);
+                serial_dgemv(orders[o], nrows, ncols, ad, lda, xd, expd);
+                _mm512_sgemv(orders[o], nrows, ncols, af, lda, xf, gotf);
+                _mm512_dgemv(orders[o], nrows, ncols, ad, lda, xd, gotd);
+
+                for (int r = 0; r < nrows; r++) {
+                    TEST_ASSERT_FLOAT_WITHIN((ncols + 1) * FLT_DELTA, expf[r], gotf[r]);
+                    TEST_ASSERT_DOUBLE_WITHIN((ncols + 1) * DBL_DELTA, expd[r], gotd[r]);
+                }
+
+                TEST_ASSERT_EQUAL_FLOAT(0.0f, gotf[nrows]);
+                TEST_ASSERT_EQUAL_DOUBLE(0.0, gotd[nrows]);
+            }
+        }
+    }
+
+    // An unknown order leaves y untouched.
+    set_farray(gotf, 8, 1.0f);
+    _mm512_sgemv('x', 8, 8, af, lda, xf, gotf);
+    TEST_ASSERT_EQUAL_FLOAT(1.0f, gotf[0]);
+
+    free(af);
+    free(ad);
+}
+
+// The prefetching kernels must agree with the plain ones for every length
+// and for distances shorter than, equal to and longer than the input.
+void test_m512_prefetch(void)
+{
+    int distances[] = {0, 1, 7, 64, 1000};
+    int num_distances = sizeof(distances) / sizeof(distances[0]);
+    int maxlen = m < 300 ? m : 300;
+
+    random_farray(xf, m, -1.0f, 1.0f);
+    random_farray(yf, m, -1.0f, 1.0f);
+    random_darray(xd, m, -1.0, 1.0);
+    random_darray(yd, m, -1.0, 1.0);
+    random_index_array(xindices, m);
+    random_index_array(yindices, m);
+
+    for (int len = 0; len <= maxlen; len++) {
+        float fdot_idx = _mm512_fdot_indexed(xf, xindices, yf, len);
+        float fdot_idx2 = _mm512_fdot_indexed2(xf, xindices, yf, yindices, len);
+        double ddot_idx = _mm512_ddot_indexed(xd, xindices, yd, len);
+        double ddot_idx2 = _mm512_ddot_indexed2(xd, xindices, yd, yindices, len);
+
+        for (int d = 0; d < num_distances; d++) {
+            TEST_ASSERT_FLOAT_WITHIN((len + 1) * FLT_DELTA, fdot_idx, _mm512_fdot_indexed_prefetch(xf, xindices, yf, len, distances[d]));
+            TEST_ASSERT_FLOAT_WITHIN((len + 1) * FLT_DELTA, fdot_idx2, _mm512_fdot_indexed2_prefetch(xf, xindices, yf, yindices, len, distances[d]));
+            TEST_ASSERT_DOUBLE_WITHIN((len + 1) * DBL_DELTA, ddot_idx, _mm512_ddot_indexed_prefetch(xd, xindices, yd, len, distances[d]));
+            TEST_ASSERT_DOUBLE_WITHIN((len + 1) * DBL_DELTA, ddot_idx2, _mm512_ddot_indexed2_prefetch(xd, xindices, yd, yindices, len, distances[d]));
+        }
+    }
+}
+
+// Kernels built from scalar loads must agree with the gather kernels for
+// every length, including the masked tails.
+void test_m512_emulated_gather(void)
+{
+    int maxlen = m < 300 ? m : 300;
+
+    random_farray(xf, m, -1.0f, 1.0f);
+    random_farray(yf, m, -1.0f, 1.0f);
+    random_darray(xd, m, -1.0, 1.0);
+    random_darray(yd, m, -1.0, 1.0);
+    random_index_array(xindices, m);
+    random_index_array(yindices, m);
+
+    for (int len = 0; len <= maxlen; len++) {
+        TEST_ASSERT_FLOAT_WITHIN((len + 1) * FLT_DELTA, _mm512_fdot_indexed(xf, xindices, yf, len),
+                                 _mm512_fdot_indexed_emu(xf, xindices, yf, len));
+        TEST_ASSERT_FLOAT_WITHIN((len + 1) * FLT_DELTA, _mm512_fdot_indexed2(xf, xindices, yf, yindices, len),
+                                 _mm512_fdot_indexed2_emu(xf, xindices, yf, yindices, len));
+        TEST_ASSERT_DOUBLE_WITHIN((len + 1) * DBL_DELTA, _mm512_ddot_indexed(xd, xindices, yd, len),
+                                  _mm512_ddot_indexed_emu(xd, xindices, yd, len));
+        TEST_ASSERT_DOUBLE_WITHIN((len + 1) * DBL_DELTA, _mm512_ddot_indexed2(xd, xindices, yd, yindices, len),
+                                  _mm512_ddot_indexed2_emu(xd, xindices, yd, yindices, len));
+    }
+
+    int nrows = 31;
+    int iind[] = {0, 2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 30, 1, 4, 6, 8, 9, 10};
+    int jind[] = {1, 4, 9, 16, 25};
+    int numi = sizeof(iind) / sizeof(iind[0]);
+    int numj = sizeof(jind) / sizeof(jind[0]);
+    float dst[sizeof(iind) / sizeof(iind[0]) * sizeof(jind) / sizeof(jind[0])];
+    float dst_emu[sizeof(iind) / sizeof(iind[0]) * sizeof(jind) / sizeof(jind[0])];
+
+    _mm512_copy2d_indexed_ps(dst, xf, nrows, iind, jind, numi, numj);
+    _mm512_copy2d_indexed_ps_emu(dst_emu, xf, nrows, iind, jind, numi, numj);
+    TEST_ASSERT_EQUAL_FLOAT_ARRAY(dst, dst_emu, numi * numj);
+}
+
+// Contiguous copies must stop exactly at the length, and the 2D copies must
+// match the linear indices they stand for, for every tail length.
+void test_m512_copy(void)
+{
+    int maxlen = m < 100 ? m - 1 : 100;
+    int nrows = 37;
+    int jind[] = {0, 3, 5, 11, 19};
+    int numj = sizeof(jind) / sizeof(jind[0]);
+    int iind[40];
+    int kind[40 * 5];
+    float dst[40 * 5];
+
+    random_farray(yf, m, -1.0f, 1.0f);
+    random_index_array(yindices, m);
+
+    for (int len = 0; len <= maxlen; len++) {
+        set_farray(xf, len + 1, -7.0f);
+        seq_index_array(xindices, len + 1, -7, 0);
+
+        _mm512_copy1d_ps(xf, yf, len);
+        _mm512_copy1d_epi32(xindices, yindices, len);
+
+        for (int i = 0; i < len; i++) {
+            TEST_ASSERT_EQUAL_FLOAT(yf[i], xf[i]);
+            TEST_ASSERT_EQUAL_INT(yindices[i], xindices[i]);
+        }
+
+        TEST_ASSERT_EQUAL_FLOAT(-7.0f, xf[len]);
+        TEST_ASSERT_EQUAL_INT(-7, xindices[len]);
+    }
+
+    random_farray(xf, nrows * 20, -1.0f, 1.0f);
+
+    for (int numi = 1; numi <= 40; numi++) {
+        for (int i = 0; i < numi; i++) {
+            iind[i] = (i * 7 + 3) % nrows;
+        }
+
+        _mm512_copy2d_epi32(kind, nrows, iind, jind, numi, numj);
+        _mm512_copy2d_indexed_ps(dst, xf, nrows, iind, jind, numi, numj);
+
+        for (int j = 0; j < numj; j++) {
+            for (int i = 0; i < numi; i++) {
+                TEST_ASSERT_EQUAL_INT(jind[j] * nrows + iind[i], kind[j * numi + i]);
+                TEST_ASSERT_EQUAL_FLOAT(xf[jind[j] * nrows + iind[i]], dst[j * numi + i]);
+            }
+        }
+    }
+}
+
+// Left permutations by n move element (k + n) mod width to position k, for
+// counts beyond the width too; right permutations undo them.
+void test_m512_permute(void)
+{
+    float fout[FLOAT_PER_M512_REG];
+    double dout[DOUBLE_PER_M512_REG];
+    int iout[INT32_PER_M512_REG];
+    int64_t lout[INT64_PER_M512_REG];
+    __m512 freg = _mm512_setr_ps(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    __m512d dreg = _mm512_setr_pd(0, 1, 2, 3, 4, 5, 6, 7);
+    __m512i ireg = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    __m512i lreg = _mm512_setr_epi64(0, 1, 2, 3, 4, 5, 6, 7);
+
+    for (int nperms = 0; nperms < 40; nperms++) {
+        _mm512_storeu_ps(fout, _mm512_leftperm_ps(freg, nperms));
+        _mm512_storeu_si512(iout, _mm512_leftperm_epi32(ireg, nperms));
+
+        for (int k = 0; k < FLOAT_PER_M512_REG; k++) {
+            TEST_ASSERT_EQUAL_FLOAT((k + nperms) % FLOAT_PER_M512_REG, fout[k]);
+            TEST_ASSERT_EQUAL_INT((k + nperms) % INT32_PER_M512_REG, iout[k]);
+        }
+
+        _mm512_storeu_ps(fout, _mm512_rightperm_ps(freg, nperms));
+        _mm512_storeu_si512(iout, _mm512_rightperm_epi32(ireg, nperms));
+
+        for (int k = 0; k < FLOAT_PER_M512_REG; k++) {
+            TEST_ASSERT_EQUAL_FLOAT((k + 16 * FLOAT_PER_M512_REG - nperms) % FLOAT_PER_M512_REG, fout[k]);
+            TEST_ASSERT_EQUAL_INT((k + 16 * INT32_PER_M512_REG - nperms) % INT32_PER_M512_REG, iout[k]);
+        }
+
+        _mm512_storeu_pd(dout, _mm512_leftperm_pd(dreg, nperms));
+        _mm512_storeu_si512(lout, _mm512_leftperm_epi64(lreg, nperms));
+
+        for (int k = 0; k < DOUBLE_PER_M512_REG; k++) {
+            TEST_ASSERT_EQUAL_DOUBLE((k + nperms) % DOUBLE_PER_M512_REG, dout[k]);
+            TEST_ASSERT_TRUE((k + nperms) % INT64_PER_M512_REG == lout[k]);
+        }
+
+        _mm512_storeu_pd(dout, _mm512_rightperm_pd(dreg, nperms));
+        _mm512_storeu_si512(lout, _mm512_rightperm_epi64(lreg, nperms));
+
+        for (int k = 0; k < DOUBLE_PER_M512_REG; k++) {
+            TEST_ASSERT_EQUAL_DOUBLE((k + 16 * DOUBLE_PER_M512_REG - nperms) % DOUBLE_PER_M512_REG, dout[k]);
+            TEST_ASSERT_TRUE((k + 16 * INT64_PER_M512_REG - nperms) % INT64_PER_M512_REG == lout[k]);
+        }
+    }
+}
+
+// The minimum and maximum are planted at every position in turn.
+void test_m512_register_min(void)
+{
+    for (int trial = 0; trial < 64; trial++) {
+        random_farray(xf, FLOAT_PER_M512_REG, -1.0f, 1.0f);
+        random_darray(xd, DOUBLE_PER_M512_REG, -1.0, 1.0);
+        xf[trial % FLOAT_PER_M512_REG] = -2.0f - trial;
+        xd[trial % DOUBLE_PER_M512_REG] = -2.0 - trial;
+
+        TEST_ASSERT_EQUAL_FLOAT(-2.0f - trial, _mm512_register_min_ps(_mm512_loadu_ps(xf)));
+        TEST_ASSERT_EQUAL_DOUBLE(-2.0 - trial, _mm512_register_min_pd(_mm512_loadu_pd(xd)));
+
+        xf[(trial + 1) % FLOAT_PER_M512_REG] = 2.0f + trial;
+        xd[(trial + 1) % DOUBLE_PER_M512_REG] = 2.0 + trial;
+
+        TEST_ASSERT_EQUAL_FLOAT(2.0f + trial, _mm512_register_max_ps(_mm512_loadu_ps(xf)));
+        TEST_ASSERT_EQUAL_DOUBLE(2.0 + trial, _mm512_register_max_pd(_mm512_loadu_pd(xd)));
+    }
+}
+
+// With a one-byte threshold every non-empty call streams, so starting
+// offsets that cover each alignment within a register exercise the peeled
+// head, the streamed body and the masked tail.
+void test_m512_stream(void)
+{
+    int maxlen = m < 117 ? m - 17 : 100;
+
+    iu_set_stream_threshold(1);
+
+    random_farray(yf, m, -1.0f, 1.0f);
+    random_index_array(yindices, m);
+
+    for (int offset = 0; offset < 16; offset++) {
+        for (int len = 0; len <= maxlen; len++) {
+            float *fdst = xf + offset;
+            double *ddst = xd + offset;
+            int *idst = xindices + offset;
+
+            set_farray(fdst, len + 1, -7.0f);
+            set_darray(ddst, len + 1, -7.0);
+
+            _mm512_sset_value(fdst, len, 0.5f);
+            _mm512_dset_value(ddst, len, 0.5);
+
+            for (int i = 0; i < len; i++) {
+                TEST_ASSERT_EQUAL_FLOAT(0.5f, fdst[i]);
+                TEST_ASSERT_EQUAL_DOUBLE(0.5, ddst[i]);
+            }
+
+            TEST_ASSERT_EQUAL_FLOAT(-7.0f, fdst[len]);
+            TEST_ASSERT_EQUAL_DOUBLE(-7.0, ddst[len]);
+
+            set_farray(fdst, len + 1, -7.0f);
+            seq_index_array(idst, len + 1, -7, 0);
+
+            _mm512_copy1d_ps(fdst, yf + 1, len);
+            _mm512_copy1d_epi32(idst, yindices + 1, len);
+
+            for (int i = 0; i < len; i++) {
+                TEST_ASSERT_EQUAL_FLOAT(yf[i + 1], fdst[i]);
+                TEST_ASSERT_EQUAL_INT(yindices[i + 1], idst[i]);
+            }
+
+            TEST_ASSERT_EQUAL_FLOAT(-7.0f, fdst[len]);
+            TEST_ASSERT_EQUAL_INT(-7, idst[len]);
+        }
+    }
+
+    iu_set_stream_threshold(0);
+}
+
+// Byte products stay in 32-bit lanes for blocks of registers, so lengths
+// spanning several blocks of the largest products must still sum exactly.
+void test_m512_int_dot(void)
+{
+    int len = (1 << 20) + 37;
+    uint8_t *xu8 = malloc(len * sizeof(uint8_t));
+    int8_t *yi8 = malloc(len * sizeof(int8_t));
+    int16_t *x16 = malloc(len * sizeof(int16_t));
+    int *perm = malloc(len * sizeof(int));
+
+    TEST_ASSERT_NOT_NULL(xu8);
+    TEST_ASSERT_NOT_NULL(yi8);
+    TEST_ASSERT_NOT_NULL(x16);
+    TEST_ASSERT_NOT_NULL(perm);
+
+    for (int i = 0; i < len; i++) {
+        xu8[i] = UINT8_MAX;
+        yi8[i] = INT8_MIN;
+        x16[i] = INT16_MIN;
+        perm[i] = len - 1 - i;
+    }
+
+#ifdef SUPPORTS_AVX512BW
+    TEST_ASSERT_EQUAL_INT64((int64_t)len * -32640, _mm512_dot_u8i8(xu8, yi8, len));
+    TEST_ASSERT_EQUAL_INT64((int64_t)len * -32640, _mm512_dot_indexed_u8i8(xu8, perm, yi8, len));
+    TEST_ASSERT_EQUAL_INT64((int64_t)len << 30, _mm512_dot_epi16(x16, x16, len));
+    TEST_ASSERT_EQUAL_INT64((int64_t)len << 30, _mm512_dot_indexed_epi16(x16, perm, x16, len));
+#endif
+#ifdef SUPPORTS_AVX512VNNI
+    if (SUPPORTS_AVX512VNNI) {
+        TEST_ASSERT_EQUAL_INT64((int64_t)len * -32640, _mm512_dot_u8i8_vnni(xu8, yi8, len));
+    }
+#endif
+
+    // Short random inputs against a scalar reference, for every tail length.
+    for (int n = 0; n <= 200; n++) {
+        int64_t exact8 = 0, exact16 = 0, indexed8 = 0, indexed16 = 0;
+
+        for (int i = 0; i < n; i++) {
+            xu8[i] = (uint8_t)rand();
+            yi8[i] = (int8_t)rand();
+            x16[i] = (int16_t)rand();
+        }
+
+        random_index_array(perm, n);
+
+        for (int i = 0; i < n; i++) {
+            exact8 += (int64_t)xu8[i] * yi8[i];
+            exact16 += (int64_t)x16[i] * x16[i];
+            indexed8 += (int64_t)xu8[perm[i]] * yi8[i];
+            indexed16 += (int64_t)x16[perm[i]] * x16[i];
+        }
+
+#ifdef SUPPORTS_AVX512BW
+        TEST_ASSERT_EQUAL_INT64(exact8, _mm512_dot_u8i8(xu8, yi8, n));
+        TEST_ASSERT_EQUAL_INT64(exact16, _mm512_dot_epi16(x16, x16, n));
+        TEST_ASSERT_EQUAL_INT64(indexed8, _mm512_dot_indexed_u8i8(xu8, perm, yi8, n));
+        TEST_ASSERT_EQUAL_INT64(indexed16, _mm512_dot_indexed_epi16(x16, perm, x16, n));
+#endif
+#ifdef SUPPORTS_AVX512VNNI
+        if (SUPPORTS_AVX512VNNI) {
+            TEST_ASSERT_EQUAL_INT64(exact8, _mm512_dot_u8i8_vnni(xu8, yi8, n));
+        }
+#endif
+    }
+
+    free(xu8);
+    free(yi8);
+    free(x16);
+    free(perm);
+}
+
+// The F16C conversions must match the integer ones of the SSE kernels bit
+// for bit, on every half and on floats around each rounding boundary. The
+// offset calls take the scalar heads through the same inputs.
+void test_m512_half(void)
+{
+    int count = 1 << 16;
+    uint16_t *h = malloc(count * sizeof(uint16_t));
+    uint16_t *href = malloc(count * sizeof(uint16_t));
+    float *f = malloc(count * sizeof(float));
+    float *fref = malloc(count * sizeof(float));
+    int *perm = malloc(count * sizeof(int));
+    uint32_t bits;
+    double exact = 0, indexed = 0, scale = 0;
+
+    TEST_ASSERT_NOT_NULL(h);
+    TEST_ASSERT_NOT_NULL(href);
+    TEST_ASSERT_NOT_NULL(f);
+    TEST_ASSERT_NOT_NULL(fref);
+    TEST_ASSERT_NOT_NULL(perm);
+
+    for (int i = 0; i < count; i++) {
+        h[i] = (uint16_t)i;
+    }
+
+    for (int offset = 0; offset < 2; offset++) {
+        _mm_cvt_f16_to_f32(fref + offset, h + offset, count - offset);
+        _mm512_cvt_f16_to_f32(f + offset, h + offset, count - offset);
+        TEST_ASSERT_EQUAL_MEMORY(fref + offset, f + offset, (count - offset) * sizeof(float));
+    }
+
+    // Random floats, mostly within the range of halves, plus values on the
+    // overflow, subnormal and rounding boundaries.
+    for (int i = 0; i < count; i++) {
+        bits = ((uint32_t)rand() << 16) ^ (uint32_t)rand();
+
+        if (i % 4 != 0) {
+            bits = (bits & 0x807fffffu) | (uint32_t)(100 + rand() % 46) << 23;
+        }
+
+        if (i % 16 == 1) {
+            bits &= 0xffffe000u;
+            bits |= 0x1000u;
+        }
+
+        memcpy(f + i, &bits, sizeof(float));
+    }
+
+    f[0] = 65504.0f;
+    f[1] = 65520.0f;
+    f[2] = 0x1p-25f;
+    f[3] = 0x1.8p-24f;
+    f[4] = INFINITY;
+    f[5] = -NAN;
+
+    for (int offset = 0; offset < 2; offset++) {
+        _mm_cvt_f32_to_f16(href + offset, f + offset, count - offset);
+        _mm512_cvt_f32_to_f16(h + offset, f + offset, count - offset);
+        TEST_ASSERT_EQUAL_MEMORY(href + offset, h + offset, (count - offset) * sizeof(uint16_t));
+    }
+
+    TEST_ASSERT_EQUAL_HEX16(0x7bff, h[0]);
+    TEST_ASSERT_EQUAL_HEX16(0x7c00, h[1]);
+    TEST_ASSERT_EQUAL_HEX16(0x0000, h[2]);
+    TEST_ASSERT_EQUAL_HEX16(0x0002, h[3]);
+
+    // Double accumulation of finite halves in [-2, 2).
+    for (int i = 0; i < count; i++) {
+        h[i] = (uint16_t)rand() & 0xbfff;
+        href[i] = (uint16_t)rand() & 0xbfff;
+    }
+
+    random_index_array(perm, count);
+    _mm_cvt_f16_to_f32(f, h, count);
+    _mm_cvt_f16_to_f32(fref, href, count);
+
+    for (int i = 0; i < count - 1; i++) {
+        exact += (double)f[i] * fref[i];
+        indexed += (double)f[perm[i]] * fref[i];
+        scale += fabs((double)f[i] * fref[i]);
+    }
+
+    TEST_ASSERT_DOUBLE_WITHIN(1e-12 * scale, exact, _mm512_hdot_acc64(h, href, count - 1));
+    TEST_ASSERT_DOUBLE_WITHIN(1e-12 * scale, indexed, _mm512_hdot_indexed_acc64(h, perm, href, count - 1));
+    TEST_ASSERT_DOUBLE_WITHIN(1e-4 * scale, exact, _mm512_hdot(h, href, count - 1));
+    TEST_ASSERT_DOUBLE_WITHIN(1e-4 * scale, indexed, _mm512_hdot_indexed(h, perm, href, count - 1));
+
+    free(h);
+    free(href);
+    free(f);
+    free(fref);
+    free(perm);
+}
+
+void test_m512_transpose(void)
+{
+    __m512 rf[FLOAT_PER_M512_REG];
+    __m512i ri[INT32_PER_M512_REG];
+    __m512d rd[DOUBLE_PER_M512_REG];
+    float f[FLOAT_PER_M512_REG];
+    int k[INT32_PER_M512_REG];
+    double d[DOUBLE_PER_M512_REG];
+
+    for (int i = 0; i < FLOAT_PER_M512_REG; i++) {
+        for (int j = 0; j < FLOAT_PER_M512_REG; j++) {
+            f[j] = 16 * i + j;
+            k[j] = -(16 * i + j);
+        }
+
+        rf[i] = _mm512_loadu_ps(f);
+        ri[i] = _mm512_loadu_si512(k);
+    }
+
+    for (int i = 0; i < DOUBLE_PER_M512_REG; i++) {
+        for (int j = 0; j < DOUBLE_PER_M512_REG; j++) {
+            d[j] = 8 * i + j;
+        }
+
+        rd[i] = _mm512_loadu_pd(d);
+    }
+
+    _mm512_transpose16_ps(rf);
+    _mm512_transpose16_epi32(ri);
+    _mm512_transpose8_pd(rd);
+
+    for (int j = 0; j < FLOAT_PER_M512_REG; j++) {
+        _mm512_storeu_ps(f, rf[j]);
+        _mm512_storeu_si512(k, ri[j]);
+
+        for (int i = 0; i < FLOAT_PER_M512_REG; i++) {
+            TEST_ASSERT_EQUAL_FLOAT(16 * i + j, f[i]);
+            TEST_ASSERT_EQUAL_INT(-(16 * i + j), k[i]);
+        }
+    }
+
+    for (int j = 0; j < DOUBLE_PER_M512_REG; j++) {
+        _mm512_storeu_pd(d, rd[j]);
+
+        for (int i = 0; i < DOUBLE_PER_M512_REG; i++) {
+            TEST_ASSERT_EQUAL_DOUBLE(8 * i + j, d[i]);
+        }
+    }
+}
 #endif
@@ -3,6 +3,7 @@
 #include "cpu_flags.h"
 #include "constants.h"
 #include <immintrin.h>
+#include <limits.h>
 
 #ifdef SUPPORTS_AVX512
 #define MAX_BUFFER_SIZE INT32_PER_M512_REG
@@ -56,9 +57,15 @@ void test_mm_set_mask_epi64(void);
 
 void test_mm256_set_mask_fromto_epi32(void);
 void test_mm256_set_mask_epi32(void);
+void test_mm256_set_mask_fromto_epi64(void);
 
+#ifdef SUPPORTS_AVX512
 void test_mm512_set_mask_fromto_epi32(void);
 void test_mm512_set_mask_epi32(void);
+void test_mm512_set_mask_fromto_epi64(void);
+#endif
+
+void test_set_mask_extreme_bounds(void);
 
 // Functions for setting expected mask results in XMM registers.
 void m128_epi32_set_expected_fromto(int, int);
@@ -88,13 +95,20 @@ int main(int argc, char *argv[])
 
     RUN_TEST(test_mm_set_mask_fromto_epi32);
     RUN_TEST(test_mm_set_mask_epi32);
+    RUN_TEST(test_mm_set_mask_fromto_epi64);
     RUN_TEST(test_mm_set_mask_epi64);
 
     RUN_TEST(test_mm256_set_mask_fromto_epi32);
     RUN_TEST(test_mm256_set_mask_epi32);
+    RUN_TEST(test_mm256_set_mask_fromto_epi64);
 
+#ifdef SUPPORTS_AVX512
     RUN_TEST(test_mm512_set_mask_fromto_epi32);
     RUN_TEST(test_mm512_set_mask_epi32);
+    RUN_TEST(test_mm512_set_mask_fromto_epi64);
+#endif
+
+    RUN_TEST(test_set_mask_extreme_bounds);
 
     return UNITY_END();
 }
@@ -187,7 +201,21 @@ void test_mm_set_mask_epi32(void)
 
 void test_mm_set_mask_fromto_epi64(void)
 {
-    TEST_IGNORE();
+    __m128i result_mask;
+    __m128i store_mask = _mm_set1_epi64x(INT64_ALLBITS);
+
+    // Every ordering of the starting and ending index, including ones
+    // outside the register.
+    for (int i = 0; i < M128_INDICES_LEN; i++) {
+        for (int j = 0; j < M128_INDICES_LEN; j++) {
+            m128_epi64_set_expected_fromto(m128_indices[i], m128_indices[j]);
+
+            result_mask = _mm_setmask_fromto_epi64(m128_indices[i], m128_indices[j]);
+            _mm_maskstore_epi64(epi64_actual, store_mask, result_mask);
+
+            TEST_ASSERT_EQUAL_INT64_ARRAY(epi64_expected, epi64_actual, INT64_PER_M128_REG);
+        }
+    }
 }
 
 void test_mm_set_mask_epi64(void)
@@ -275,6 +303,24 @@ void test_mm256_set_mask_epi32(void)
     }
 }
 
+void test_mm256_set_mask_fromto_epi64(void)
+{
+    __m256i result_mask;
+    __m256i store_mask = _mm256_set1_epi64x(INT64_ALLBITS);
+
+    for (int i = 0; i < M256_INDICES_LEN; i++) {
+        for (int j = 0; j < M256_INDICES_LEN; j++) {
+            m256_epi64_set_expected_fromto(m256_indices[i], m256_indices[j]);
+
+            result_mask = _mm256_setmask_fromto_epi64(m256_indices[i], m256_indices[j]);
+            _mm256_maskstore_epi64(epi64_actual, store_mask, result_mask);
+
+            TEST_ASSERT_EQUAL_INT64_ARRAY(epi64_expected, epi64_actual, INT64_PER_M256_REG);
+        }
+    }
+}
+
+#ifdef SUPPORTS_AVX512
 void test_mm512_set_mask_fromto_epi32(void)
 {
     int start, end;
@@ -337,6 +383,57 @@ void test_mm512_set_mask_epi32(void)
     }
 }
 
+void test_mm512_set_mask_fromto_epi64(void)
+{
+    __mmask8 result_mask;
+
+    for (int i = 0; i < M512_INDICES_LEN; i++) {
+        for (int j = 0; j < M512_INDICES_LEN; j++) {
+            m512_epi64_set_expected_fromto(m512_indices[i], m512_indices[j]);
+
+            result_mask = _mm512_setmask_fromto_epi64(m512_indices[i], m512_indices[j]);
+            _mm512_storeu_epi64(epi64_actual, _mm512_movm_epi64(result_mask));
+
+            TEST_ASSERT_EQUAL_INT64_ARRAY(epi64_expected, epi64_actual, INT64_PER_M512_REG);
+        }
+    }
+}
+#endif
+
+// Bounds at the limits of int must neither overflow nor wrap around.
+void test_set_mask_extreme_bounds(void)
+{
+    int bounds[] = {INT_MIN, INT_MIN + 1, -1, 0, 1, 7, 15, 16, INT_MAX - 1, INT_MAX};
+    int nbounds = sizeof(bounds) / sizeof(bounds[0]);
+    __m256i store_mask = _mm256_set1_epi32(INT32_ALLBITS);
+
+    for (int i = 0; i < nbounds; i++) {
+        for (int j = 0; j < nbounds; j++) {
+            m128_epi32_set_expected_fromto(bounds[i], bounds[j]);
+            _mm_maskstore_epi32(epi32_actual, _mm_set1_epi32(INT32_ALLBITS), _mm_setmask_fromto_epi32(bounds[i], bounds[j]));
+            TEST_ASSERT_EQUAL_INT32_ARRAY(epi32_expected, epi32_actual, INT32_PER_M128_REG);
+
+            m256_epi32_set_expected_fromto(bounds[i], bounds[j]);
+            _mm256_maskstore_epi32(epi32_actual, store_mask, _mm256_setmask_fromto_epi32(bounds[i], bounds[j]));
+            TEST_ASSERT_EQUAL_INT32_ARRAY(epi32_expected, epi32_actual, INT32_PER_M256_REG);
+
+            m256_epi64_set_expected_fromto(bounds[i], bounds[j]);
+            _mm256_maskstore_epi64(epi64_actual, store_mask, _mm256_setmask_fromto_epi64(bounds[i], bounds[j]));
+            TEST_ASSERT_EQUAL_INT64_ARRAY(epi64_expected, epi64_actual, INT64_PER_M256_REG);
+
+#ifdef SUPPORTS_AVX512
+            m512_epi32_set_expected_fromto(bounds[i], bounds[j]);
+            _mm512_storeu_epi32(epi32_actual, _mm512_movm_epi32(_mm512_setmask_fromto_epi32(bounds[i], bounds[j])));
+            TEST_ASSERT_EQUAL_INT32_ARRAY(epi32_expected, epi32_actual, INT32_PER_M512_REG);
+
+            m512_epi64_set_expected_fromto(bounds[i], bounds[j]);
+            _mm512_storeu_epi64(epi64_actual, _mm512_movm_epi64(_mm512_setmask_fromto_epi64(bounds[i], bounds[j])));
+            TEST_ASSERT_EQUAL_INT64_ARRAY(epi64_expected, epi64_actual, INT64_PER_M512_REG);
+#endif
+        }
+    }
+}
+
 //----------------------------------------------------------------------------
 // Functions for setting expected mask results in XMM registers.
 //----------------------------------------------------------------------------
@@ -0,0 +1,238 @@
+#include "unity.h"
+#include "parallel.h"
+#include "dispatch.h"
+#include <stdlib.h>
+#include <string.h>
+#include <float.h>
+#include <math.h>
+
+#define FLT_DELTA (2e2 * FLT_EPSILON)
+#define DBL_DELTA (2e2 * DBL_EPSILON)
+
+// Global variables for the arrays handed to the parallel kernels.
+float *xf = NULL, *yf = NULL;
+double *xd = NULL, *yd = NULL;
+int *xindices = NULL, *yindices = NULL;
+
+// Array dimensions. The odd length leaves a ragged last slice.
+int m = 100003;
+
+// Random seed for srand call.
+unsigned random_seed = 0;
+
+// Thread counts exercised by every test, including ones that do not divide
+// the length and ones larger than the number of slices on short inputs.
+int thread_counts[] = {1, 2, 3, 4, 7, 8, 16, 64};
+int num_thread_counts = sizeof(thread_counts) / sizeof(thread_counts[0]);
+
+// Forward declarations needed to use Unity.
+void setUp(void);
+void tearDown(void);
+
+// Forward declarations for initializing arrays.
+void random_farray(float *, int, float, float);
+void random_darray(double *, int, double, double);
+void random_index_array(int *, int);
+
+// Forward declarations for tests.
+void test_parallel_fdot(void);
+void test_parallel_ddot(void);
+void test_parallel_reproducible(void);
+void test_parallel_lengths(void);
+
+int main(int argc, char *argv[])
+{
+    if (argc > 1) {
+        m = strtol(argv[1], NULL, 10);
+    }
+
+    if (argc > 2) {
+        random_seed = strtoul(argv[2], NULL, 10);
+    }
+
+    UNITY_BEGIN();
+
+    RUN_TEST(test_parallel_fdot);
+    RUN_TEST(test_parallel_ddot);
+    RUN_TEST(test_parallel_reproducible);
+    RUN_TEST(test_parallel_lengths);
+
+    return UNITY_END();
+}
+
+void setUp(void)
+{
+    srand(random_seed);
+
+    xf = calloc(2*m, sizeof(float));
+    xd = calloc(2*m, sizeof(double));
+    xindices = calloc(2*m, sizeof(int));
+
+    if (xf != NULL && xd != NULL && xindices != NULL) {
+        yf = xf + m;
+        yd = xd + m;
+        yindices = xindices + m;
+    } else {
+        tearDown();
+    }
+}
+
+void tearDown(void)
+{
+    free(xf);
+    free(xd);
+    free(xindices);
+
+    xf = yf = NULL;
+    xd = yd = NULL;
+    xindices = yindices = NULL;
+}
+
+void random_farray(float *x, int len, float a, float b)
+{
+    for (int i = 0; i < len; i++) {
+        x[i] = a + (b - a) * ((float)rand() / RAND_MAX);
+    }
+}
+
+void random_darray(double *x, int len, double a, double b)
+{
+    for (int i = 0; i < len; i++) {
+        x[i] = a + (b - a) * ((double)rand() / RAND_MAX);
+    }
+}
+
+void random_index_array(int *indices, int len)
+{
+    int j;
+    int temp;
+
+    for (int i = 0; i < len; i++) {
+        indices[i] = i;
+    }
+
+    for (int i = len - 1; i >= 0; i--) {
+        j = rand() % (i + 1);
+        temp = indices[i];
+        indices[i] = indices[j];
+        indices[j] = temp;
+    }
+}
+
+//----------------------------------------------------------------------------
+// Tests for the multithreaded dot products. Results are checked against a
+// serial reference, and repeated calls must agree bit for bit.
+//----------------------------------------------------------------------------
+
+void test_parallel_fdot(void)
+{
+    double exact, exact_indexed, exact_indexed2;
+
+    random_farray(xf, m, -1.0f, 1.0f);
+    random_farray(yf, m, -1.0f, 1.0f);
+    random_index_array(xindices, m);
+    random_index_array(yindices, m);
+
+    exact = exact_indexed = exact_indexed2 = 0;
+
+    for (int i = 0; i < m; i++) {
+        exact += (double)xf[i] * yf[i];
+        exact_indexed += (double)xf[xindices[i]] * yf[i];
+        exact_indexed2 += (double)xf[xindices[i]] * yf[yindices[i]];
+    }
+
+    for (int k = 0; k < num_thread_counts; k++) {
+        int nthreads = thread_counts[k];
+
+        TEST_PRINTF("%2d threads fdot:                 %f", nthreads, iu_fdot_parallel(xf, yf, m, nthreads));
+
+        TEST_ASSERT_FLOAT_WITHIN(m * FLT_DELTA, exact, iu_fdot_parallel(xf, yf, m, nthreads));
+        TEST_ASSERT_FLOAT_WITHIN(m * FLT_DELTA, exact_indexed, iu_fdot_indexed_parallel(xf, xindices, yf, m, nthreads));
+        TEST_ASSERT_FLOAT_WITHIN(m * FLT_DELTA, exact_indexed2, iu_fdot_indexed2_parallel(xf, xindices, yf, yindices, m, nthreads));
+    }
+}
+
+void test_parallel_ddot(void)
+{
+    double exact, exact_indexed, exact_indexed2;
+
+    random_darray(xd, m, -1.0, 1.0);
+    random_darray(yd, m, -1.0, 1.0);
+    random_index_array(xindices, m);
+    random_index_array(yindices, m);
+
+    exact = exact_indexed = exact_indexed2 = 0;
+
+    for (int i = 0; i < m; i++) {
+        exact += xd[i] * yd[i];
+        exact_indexed += xd[xindices[i]] * yd[i];
+        exact_indexed2 += xd[xindices[i]] * yd[yindices[i]];
+    }
+
+    for (int k = 0; k < num_thread_counts; k++) {
+        int nthreads = thread_counts[k];
+
+        TEST_PRINTF("%2d threads ddot:                 %lf", nthreads, iu_ddot_parallel(xd, yd, m, nthreads));
+
+        TEST_ASSERT_DOUBLE_WITHIN(m * DBL_DELTA, exact, iu_ddot_parallel(xd, yd, m, nthreads));
+        TEST_ASSERT_DOUBLE_WITHIN(m * DBL_DELTA, exact_indexed, iu_ddot_indexed_parallel(xd, xindices, yd, m, nthreads));
+        TEST_ASSERT_DOUBLE_WITHIN(m * DBL_DELTA, exact_indexed2, iu_ddot_indexed2_parallel(xd, xindices, yd, yindices, m, nthreads));
+    }
+}
+
+void test_parallel_reproducible(void)
+{
+    float fresult[2];
+    double dresult[2];
+    float fserial;
+    double dserial;
+
+    random_farray(xf, m, -1.0f, 1.0f);
+    random_farray(yf, m, -1.0f, 1.0f);
+    random_darray(xd, m, -1.0, 1.0);
+    random_darray(yd, m, -1.0, 1.0);
+    random_index_array(xindices, m);
+
+    // A single thread runs the dispatched kernel over the whole range.
+    fresult[0] = iu_fdot_parallel(xf, yf, m, 1);
+    dresult[0] = iu_ddot_parallel(xd, yd, m, 1);
+    fserial = iu_fdot(xf, yf, m);
+    dserial = iu_ddot(xd, yd, m);
+
+    TEST_ASSERT_EQUAL_MEMORY(&fserial, &fresult[0], sizeof(float));
+    TEST_ASSERT_EQUAL_MEMORY(&dserial, &dresult[0], sizeof(double));
+
+    for (int k = 0; k < num_thread_counts; k++) {
+        int nthreads = thread_counts[k];
+
+        for (int rep = 0; rep < 2; rep++) {
+            fresult[rep] = iu_fdot_indexed_parallel(xf, xindices, yf, m, nthreads);
+            dresult[rep] = iu_ddot_parallel(xd, yd, m, nthreads);
+        }
+
+        TEST_ASSERT_EQUAL_MEMORY(&fresult[0], &fresult[1], sizeof(float));
+        TEST_ASSERT_EQUAL_MEMORY(&dresult[0], &dresult[1], sizeof(double));
+    }
+}
+
+void test_parallel_lengths(void)
+{
+    int maxlen = m < 300 ? m : 300;
+
+    random_darray(xd, maxlen, -1.0, 1.0);
+    random_darray(yd, maxlen, -1.0, 1.0);
+
+    for (int len = 0; len <= maxlen; len++) {
+        double exact = 0;
+        double abs_sum = 0;
+
+        for (int i = 0; i < len; i++) {
+            exact += xd[i] * yd[i];
+            abs_sum += fabs(xd[i] * yd[i]);
+        }
+
+        for (int k = 0; k < num_thread_counts; k++) {
+            TEST_ASSERT_DOUBLE_WITHIN(abs_sum * DBL_DELTA + DBL_MIN, exact, iu_ddot_parallel(xd, yd, len, thread_counts[k]));
+        }
+    }
+}
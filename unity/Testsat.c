@@ -0,0 +1,358 @@
+#include "unity.h"
+#include "sat.h"
+#include "dispatch.h"
+#include "constants.h"
+#include <stdlib.h>
+
+#define NUM_ISAS 3
+
+// Float grids hold small integers, so every sum is exact in float; double
+// grids hold random reals.
+#define DOUBLE_DELTA 1e-9
+
+// Grid dimensions, deliberately not multiples of any register width.
+int nrows = 23;
+int ncols = 37;
+
+// Random seed for srand call.
+unsigned random_seed = 0;
+
+// Forward declarations needed to use Unity.
+void setUp(void);
+void tearDown(void);
+
+// Forward declarations for helpers.
+double reference_rect(const double *, int, int, char, int, int, int, int, int);
+void fill_grids(float *, double *, size_t);
+
+// Forward declarations for tests.
+void test_sat_create(void);
+void test_sat_build(void);
+void test_sat_rect(void);
+void test_sat_box(void);
+void test_sat_ring(void);
+
+int main(int argc, char *argv[])
+{
+    if (argc > 1) {
+        nrows = strtol(argv[1], NULL, 10);
+    }
+
+    if (argc > 2) {
+        ncols = strtol(argv[2], NULL, 10);
+    }
+
+    if (argc > 3) {
+        random_seed = strtoul(argv[3], NULL, 10);
+    }
+
+    UNITY_BEGIN();
+
+    RUN_TEST(test_sat_create);
+    RUN_TEST(test_sat_build);
+    RUN_TEST(test_sat_rect);
+    RUN_TEST(test_sat_box);
+    RUN_TEST(test_sat_ring);
+
+    return UNITY_END();
+}
+
+void setUp(void)
+{
+    srand(random_seed);
+}
+
+void tearDown(void)
+{
+}
+
+// Grids are stored with lines one element longer than needed, to exercise
+// the leading dimensions.
+void fill_grids(float *xs, double *xd, size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        xs[i] = (float)(rand() % 10);
+        xd[i] = (double)rand() / RAND_MAX;
+    }
+}
+
+// Periodic sum of the rows [row, row + height) and columns [col, col + width)
+// of a grid of nr by nc whose lines are ld apart.
+double reference_rect(const double *x, int nr, int nc, char order, int ld, int row, int col, int height, int width)
+{
+    double sum = 0;
+
+    for (int r = row; r < row + height; r++) {
+        for (int c = col; c < col + width; c++) {
+            int i = (r % nr + nr) % nr;
+            int j = (c % nc + nc) % nc;
+
+            sum += order == ROW_MAJOR_ORDER ? x[(size_t)i * ld + j] : x[(size_t)j * ld + i];
+        }
+    }
+
+    return sum;
+}
+
+void test_sat_create(void)
+{
+    struct iu_ssat *ssat;
+    struct iu_dsat *dsat;
+
+    TEST_ASSERT_NULL(iu_ssat_create(0, ncols, ROW_MAJOR_ORDER));
+    TEST_ASSERT_NULL(iu_dsat_create(nrows, -1, COLUMN_MAJOR_ORDER));
+    TEST_ASSERT_NULL(iu_ssat_create(nrows, ncols, 'x'));
+
+    ssat = iu_ssat_create(nrows, ncols, ROW_MAJOR_ORDER);
+    TEST_ASSERT_NOT_NULL(ssat);
+    TEST_ASSERT_EQUAL_INT(nrows, ssat->nlines);
+    TEST_ASSERT_EQUAL_INT(ncols, ssat->len);
+    TEST_ASSERT_EQUAL_INT(ncols + 1, ssat->ld);
+    iu_ssat_free(ssat);
+
+    dsat = iu_dsat_create(nrows, ncols, COLUMN_MAJOR_ORDER);
+    TEST_ASSERT_NOT_NULL(dsat);
+    TEST_ASSERT_EQUAL_INT(ncols, dsat->nlines);
+    TEST_ASSERT_EQUAL_INT(nrows, dsat->len);
+    iu_dsat_free(dsat);
+
+    iu_ssat_free(NULL);
+    iu_dsat_free(NULL);
+}
+
+// Every table entry against a direct sum, for line lengths on both sides of
+// each register width.
+void test_sat_build(void)
+{
+    int isa = iu_dispatch_isa();
+    int nlines = 5;
+
+    for (int len = 1; len <= 40; len++) {
+        int ldx = len + 3;
+        float *xs = malloc((size_t)nlines * ldx * sizeof(float));
+        double *xd = malloc((size_t)nlines * ldx * sizeof(double));
+        double *xsd = malloc((size_t)nlines * ldx * sizeof(double));
+        struct iu_ssat *ssat = iu_ssat_create(nlines, len, ROW_MAJOR_ORDER);
+        struct iu_dsat *dsat = iu_dsat_create(len, nlines, COLUMN_MAJOR_ORDER);
+
+        TEST_ASSERT_NOT_NULL(xs);
+        TEST_ASSERT_NOT_NULL(xd);
+        TEST_ASSERT_NOT_NULL(xsd);
+        TEST_ASSERT_NOT_NULL(ssat);
+        TEST_ASSERT_NOT_NULL(dsat);
+
+        fill_grids(xs, xd, (size_t)nlines * ldx);
+
+        for (int i = 0; i < nlines * ldx; i++) {
+            xsd[i] = xs[i];
+        }
+
+        for (int k = 0; k < NUM_ISAS; k++) {
+            if (iu_dispatch_set_isa(k) != 0) {
+                continue;
+            }
+
+            iu_ssat_build(ssat, xs, ldx);
+            iu_dsat_build(dsat, xd, ldx);
+
+            for (int l = 0; l <= nlines; l++) {
+                for (int t = 0; t <= len; t++) {
+                    TEST_ASSERT_EQUAL_FLOAT(reference_rect(xsd, nlines, len, ROW_MAJOR_ORDER, ldx, 0, 0, l, t), ssat->table[l * ssat->ld + t]);
+                    TEST_ASSERT_DOUBLE_WITHIN(DOUBLE_DELTA, reference_rect(xd, len, nlines, COLUMN_MAJOR_ORDER, ldx, 0, 0, t, l), dsat->table[l * dsat->ld + t]);
+                }
+            }
+        }
+
+        free(xs);
+        free(xd);
+        free(xsd);
+        iu_ssat_free(ssat);
+        iu_dsat_free(dsat);
+    }
+
+    iu_dispatch_set_isa(isa);
+}
+
+// Rectangles anywhere, including ones wrapping several times.
+void test_sat_rect(void)
+{
+    char orders[] = {ROW_MAJOR_ORDER, COLUMN_MAJOR_ORDER};
+
+    for (int o = 0; o < 2; o++) {
+        int ld = (orders[o] == ROW_MAJOR_ORDER ? ncols : nrows) + 1;
+        int nlines = orders[o] == ROW_MAJOR_ORDER ? nrows : ncols;
+        float *xs = malloc((size_t)nlines * ld * sizeof(float));
+        double *xd = malloc((size_t)nlines * ld * sizeof(double));
+        double *xsd = malloc((size_t)nlines * ld * sizeof(double));
+        struct iu_ssat *ssat = iu_ssat_create(nrows, ncols, orders[o]);
+        struct iu_dsat *dsat = iu_dsat_create(nrows, ncols, orders[o]);
+
+        TEST_ASSERT_NOT_NULL(xs);
+        TEST_ASSERT_NOT_NULL(xd);
+        TEST_ASSERT_NOT_NULL(xsd);
+        TEST_ASSERT_NOT_NULL(ssat);
+        TEST_ASSERT_NOT_NULL(dsat);
+
+        fill_grids(xs, xd, (size_t)nlines * ld);
+
+        for (int i = 0; i < nlines * ld; i++) {
+            xsd[i] = xs[i];
+        }
+
+        iu_ssat_build(ssat, xs, ld);
+        iu_dsat_build(dsat, xd, ld);
+
+        for (int trial = 0; trial < 500; trial++) {
+            int row = rand() % (4 * nrows) - 2 * nrows;
+            int col = rand() % (4 * ncols) - 2 * ncols;
+            int height = rand() % (2 * nrows + 2);
+            int width = rand() % (2 * ncols + 2);
+
+            TEST_ASSERT_EQUAL_FLOAT(reference_rect(xsd, nrows, ncols, orders[o], ld, row, col, height, width), iu_ssat_rect(ssat, row, col, height, width));
+            TEST_ASSERT_DOUBLE_WITHIN(DOUBLE_DELTA, reference_rect(xd, nrows, ncols, orders[o], ld, row, col, height, width), iu_dsat_rect(dsat, row, col, height, width));
+        }
+
+        free(xs);
+        free(xd);
+        free(xsd);
+        iu_ssat_free(ssat);
+        iu_dsat_free(dsat);
+    }
+}
+
+// Boxes around every cell, centred and off-centre, small and wider than
+// the grid, under each instruction set the host supports.
+void test_sat_box(void)
+{
+    int isa = iu_dispatch_isa();
+    char orders[] = {ROW_MAJOR_ORDER, COLUMN_MAJOR_ORDER};
+    int boxes[][4] = {{0, 0, 1, 1}, {-1, -1, 3, 3}, {-3, -5, 7, 11}, {2, -7, 1, 4}, {-30, -2, 60, 5}, {0, -40, 2, 90}};
+
+    for (int o = 0; o < 2; o++) {
+        int nlines = orders[o] == ROW_MAJOR_ORDER ? nrows : ncols;
+        int ld = (orders[o] == ROW_MAJOR_ORDER ? ncols : nrows) + 2;
+        float *xs = malloc((size_t)nlines * ld * sizeof(float));
+        double *xd = malloc((size_t)nlines * ld * sizeof(double));
+        double *xsd = malloc((size_t)nlines * ld * sizeof(double));
+        float *bs = malloc((size_t)nlines * ld * sizeof(float));
+        double *bd = malloc((size_t)nlines * ld * sizeof(double));
+        struct iu_ssat *ssat = iu_ssat_create(nrows, ncols, orders[o]);
+        struct iu_dsat *dsat = iu_dsat_create(nrows, ncols, orders[o]);
+
+        TEST_ASSERT_NOT_NULL(xs);
+        TEST_ASSERT_NOT_NULL(xd);
+        TEST_ASSERT_NOT_NULL(xsd);
+        TEST_ASSERT_NOT_NULL(bs);
+        TEST_ASSERT_NOT_NULL(bd);
+        TEST_ASSERT_NOT_NULL(ssat);
+        TEST_ASSERT_NOT_NULL(dsat);
+
+        fill_grids(xs, xd, (size_t)nlines * ld);
+
+        for (int i = 0; i < nlines * ld; i++) {
+            xsd[i] = xs[i];
+        }
+
+        for (int k = 0; k < NUM_ISAS; k++) {
+            if (iu_dispatch_set_isa(k) != 0) {
+                continue;
+            }
+
+            iu_ssat_build(ssat, xs, ld);
+            iu_dsat_build(dsat, xd, ld);
+
+            for (size_t b = 0; b < sizeof(boxes) / sizeof(boxes[0]); b++) {
+                int top = boxes[b][0], left = boxes[b][1], height = boxes[b][2], width = boxes[b][3];
+
+                iu_ssat_box(ssat, bs, ld, top, left, height, width);
+                iu_dsat_box(dsat, bd, ld, top, left, height, width);
+
+                for (int i = 0; i < nrows; i++) {
+                    for (int j = 0; j < ncols; j++) {
+                        size_t c = orders[o] == ROW_MAJOR_ORDER ? (size_t)i * ld + j : (size_t)j * ld + i;
+
+                        TEST_ASSERT_EQUAL_FLOAT(reference_rect(xsd, nrows, ncols, orders[o], ld, i + top, j + left, height, width), bs[c]);
+                        TEST_ASSERT_DOUBLE_WITHIN(DOUBLE_DELTA, reference_rect(xd, nrows, ncols, orders[o], ld, i + top, j + left, height, width), bd[c]);
+                    }
+                }
+            }
+        }
+
+        free(xs);
+        free(xd);
+        free(xsd);
+        free(bs);
+        free(bd);
+        iu_ssat_free(ssat);
+        iu_dsat_free(dsat);
+    }
+
+    iu_dispatch_set_isa(isa);
+}
+
+void test_sat_ring(void)
+{
+    int isa = iu_dispatch_isa();
+    int rings[][2] = {{-1, 2}, {0, 1}, {2, 5}, {4, 20}};
+    float *xs = malloc((size_t)nrows * ncols * sizeof(float));
+    double *xd = malloc((size_t)nrows * ncols * sizeof(double));
+    double *xsd = malloc((size_t)nrows * ncols * sizeof(double));
+    float *rs = malloc((size_t)nrows * ncols * sizeof(float));
+    double *rd = malloc((size_t)nrows * ncols * sizeof(double));
+    struct iu_ssat *ssat = iu_ssat_create(nrows, ncols, COLUMN_MAJOR_ORDER);
+    struct iu_dsat *dsat = iu_dsat_create(nrows, ncols, COLUMN_MAJOR_ORDER);
+
+    TEST_ASSERT_NOT_NULL(xs);
+    TEST_ASSERT_NOT_NULL(xd);
+    TEST_ASSERT_NOT_NULL(xsd);
+    TEST_ASSERT_NOT_NULL(rs);
+    TEST_ASSERT_NOT_NULL(rd);
+    TEST_ASSERT_NOT_NULL(ssat);
+    TEST_ASSERT_NOT_NULL(dsat);
+
+    fill_grids(xs, xd, (size_t)nrows * ncols);
+
+    for (int i = 0; i < nrows * ncols; i++) {
+        xsd[i] = xs[i];
+    }
+
+    for (int k = 0; k < NUM_ISAS; k++) {
+        if (iu_dispatch_set_isa(k) != 0) {
+            continue;
+        }
+
+        iu_ssat_build(ssat, xs, nrows);
+        iu_dsat_build(dsat, xd, nrows);
+
+        for (size_t r = 0; r < sizeof(rings) / sizeof(rings[0]); r++) {
+            int inner = rings[r][0], outer = rings[r][1];
+
+            iu_ssat_ring(ssat, rs, nrows, inner, outer);
+            iu_dsat_ring(dsat, rd, nrows, inner, outer);
+
+            for (int j = 0; j < ncols; j++) {
+                for (int i = 0; i < nrows; i++) {
+                    double es = reference_rect(xsd, nrows, ncols, COLUMN_MAJOR_ORDER, nrows, i - outer, j - outer, 2 * outer + 1, 2 * outer + 1);
+                    double ed = reference_rect(xd, nrows, ncols, COLUMN_MAJOR_ORDER, nrows, i - outer, j - outer, 2 * outer + 1, 2 * outer + 1);
+
+                    if (inner >= 0) {
+                        es -= reference_rect(xsd, nrows, ncols, COLUMN_MAJOR_ORDER, nrows, i - inner, j - inner, 2 * inner + 1, 2 * inner + 1);
+                        ed -= reference_rect(xd, nrows, ncols, COLUMN_MAJOR_ORDER, nrows, i - inner, j - inner, 2 * inner + 1, 2 * inner + 1);
+                    }
+
+                    TEST_ASSERT_EQUAL_FLOAT(es, rs[(size_t)j * nrows + i]);
+                    TEST_ASSERT_DOUBLE_WITHIN(DOUBLE_DELTA, ed, rd[(size_t)j * nrows + i]);
+                }
+            }
+        }
+    }
+
+    free(xs);
+    free(xd);
+    free(xsd);
+    free(rs);
+    free(rd);
+    iu_ssat_free(ssat);
+    iu_dsat_free(dsat);
+    iu_dispatch_set_isa(isa);
+}
@@ -0,0 +1,353 @@
+#include "unity.h"
+#include "smoothlife.h"
+#include "dispatch.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define NUM_ISAS 3
+
+// Integrals are sums of a few thousand weighted cells in float.
+#define INTEGRAL_DELTA 1e-5
+
+// Grid dimensions, deliberately not multiples of any register width.
+int nrows = 61;
+int ncols = 47;
+
+// Random seed for srand call.
+unsigned random_seed = 0;
+
+// Forward declarations needed to use Unity.
+void setUp(void);
+void tearDown(void);
+
+// Forward declarations for helpers.
+void random_field(float *, int);
+void reference_integrals(const struct iu_smoothlife_params *, const float *, int, int, double *, double *);
+double reference_transition(const struct iu_smoothlife_params *, double, double, double);
+void check_integrals(struct iu_smoothlife *);
+
+// Forward declarations for tests.
+void test_smoothlife_create(void);
+void test_smoothlife_uniform(void);
+void test_smoothlife_integrals(void);
+void test_smoothlife_small_grid(void);
+void test_smoothlife_step(void);
+
+int main(int argc, char *argv[])
+{
+    if (argc > 1) {
+        nrows = strtol(argv[1], NULL, 10);
+    }
+
+    if (argc > 2) {
+        ncols = strtol(argv[2], NULL, 10);
+    }
+
+    if (argc > 3) {
+        random_seed = strtoul(argv[3], NULL, 10);
+    }
+
+    UNITY_BEGIN();
+
+    RUN_TEST(test_smoothlife_create);
+    RUN_TEST(test_smoothlife_uniform);
+    RUN_TEST(test_smoothlife_integrals);
+    RUN_TEST(test_smoothlife_small_grid);
+    RUN_TEST(test_smoothlife_step);
+
+    return UNITY_END();
+}
+
+void setUp(void)
+{
+    srand(random_seed);
+}
+
+void tearDown(void)
+{
+}
+
+void random_field(float *f, int len)
+{
+    for (int i = 0; i < len; i++) {
+        f[i] = (float)rand() / RAND_MAX;
+    }
+}
+
+static double coverage(double r, double l)
+{
+    double w = r + 0.5 - l;
+
+    return w < 0 ? 0 : (w > 1 ? 1 : w);
+}
+
+// Direct double-precision integrals over the torus, wrapping every
+// neighbour with a modulo rather than through padding.
+void reference_integrals(const struct iu_smoothlife_params *p, const float *f, int nr, int nc, double *m, double *n)
+{
+    int r = (int)(p->ra + 0.5f) + 1;
+    double msum = 0, nsum = 0;
+
+    for (int dj = -r; dj <= r; dj++) {
+        for (int di = -r; di <= r; di++) {
+            double l = sqrt((double)(di * di + dj * dj));
+
+            msum += coverage(p->ri, l);
+            nsum += coverage(p->ra, l) - coverage(p->ri, l);
+        }
+    }
+
+    for (int j = 0; j < nc; j++) {
+        for (int i = 0; i < nr; i++) {
+            double ms = 0, ns = 0;
+
+            for (int dj = -r; dj <= r; dj++) {
+                for (int di = -r; di <= r; di++) {
+                    double l = sqrt((double)(di * di + dj * dj));
+                    double x = f[(size_t)((j + dj) % nc + nc) % nc * nr + ((i + di) % nr + nr) % nr];
+
+                    ms += coverage(p->ri, l) * x;
+                    ns += (coverage(p->ra, l) - coverage(p->ri, l)) * x;
+                }
+            }
+
+            m[(size_t)j * nr + i] = ms / msum;
+            n[(size_t)j * nr + i] = ns / nsum;
+        }
+    }
+}
+
+static double sigma1(double x, double a, double alpha)
+{
+    return 1.0 / (1.0 + exp(-4.0 * (x - a) / alpha));
+}
+
+double reference_transition(const struct iu_smoothlife_params *p, double f, double m, double n)
+{
+    double sm = sigma1(m, 0.5, p->alpha_m);
+    double t1 = p->b1 * (1 - sm) + p->d1 * sm;
+    double t2 = p->b2 * (1 - sm) + p->d2 * sm;
+    double s = sigma1(n, t1, p->alpha_n) * (1 - sigma1(n, t2, p->alpha_n));
+
+    if (p->dt == 0) {
+        return s;
+    }
+
+    f += p->dt * (2 * s - 1);
+
+    return f < 0 ? 0 : (f > 1 ? 1 : f);
+}
+
+// Compare the engine's integrals of its current field with the reference,
+// by direct summation and by FFT under each instruction set the host
+// supports.
+void check_integrals(struct iu_smoothlife *sl)
+{
+    int isa = iu_dispatch_isa();
+    int method = sl->method;
+    size_t cells = (size_t)sl->nrows * sl->ncols;
+    double *m = malloc(cells * sizeof(double));
+    double *n = malloc(cells * sizeof(double));
+
+    TEST_ASSERT_NOT_NULL(m);
+    TEST_ASSERT_NOT_NULL(n);
+
+    reference_integrals(&sl->params, sl->field, sl->nrows, sl->ncols, m, n);
+
+    for (int k = 0; k < NUM_ISAS; k++) {
+        if (iu_dispatch_set_isa(k) != 0) {
+            continue;
+        }
+
+        for (int d = SMOOTHLIFE_DIRECT; d <= SMOOTHLIFE_FFT; d++) {
+            TEST_ASSERT_EQUAL_INT(0, iu_smoothlife_set_method(sl, d));
+            TEST_ASSERT_TRUE((sl->conv != NULL) == (d == SMOOTHLIFE_FFT));
+            iu_smoothlife_integrals(sl);
+
+            for (size_t c = 0; c < cells; c++) {
+                TEST_ASSERT_DOUBLE_WITHIN(INTEGRAL_DELTA, m[c], sl->m[c]);
+                TEST_ASSERT_DOUBLE_WITHIN(INTEGRAL_DELTA, n[c], sl->n[c]);
+            }
+        }
+    }
+
+    free(m);
+    free(n);
+
+    iu_smoothlife_set_method(sl, method);
+    iu_dispatch_set_isa(isa);
+}
+
+void test_smoothlife_create(void)
+{
+    struct iu_smoothlife_params p;
+    struct iu_smoothlife *sl;
+    double msum = 0, nsum = 0;
+
+    iu_smoothlife_default_params(&p);
+    TEST_ASSERT_EQUAL_FLOAT(SMOOTHLIFE_RA, p.ra);
+    TEST_ASSERT_EQUAL_FLOAT(SMOOTHLIFE_RI, p.ri);
+    TEST_ASSERT_EQUAL_FLOAT(0, p.dt);
+
+    p.ri = p.ra;
+    TEST_ASSERT_NULL(iu_smoothlife_create(nrows, ncols, &p));
+    p.ri = 0;
+    TEST_ASSERT_NULL(iu_smoothlife_create(nrows, ncols, &p));
+    TEST_ASSERT_NULL(iu_smoothlife_create(0, ncols, NULL));
+
+    sl = iu_smoothlife_create(nrows, ncols, NULL);
+    TEST_ASSERT_NOT_NULL(sl);
+    TEST_ASSERT_EQUAL_FLOAT(SMOOTHLIFE_RA, sl->params.ra);
+    TEST_ASSERT_EQUAL_INT(nrows + 2 * sl->pad, sl->ldp);
+    TEST_ASSERT_TRUE(sl->nm > 0);
+    TEST_ASSERT_TRUE(sl->nn > sl->nm);
+    TEST_ASSERT_EQUAL_INT(SMOOTHLIFE_AUTO, sl->method);
+    TEST_ASSERT_TRUE((sl->conv != NULL) == iu_conv2d_prefer_fft(nrows, ncols, sl->nm + sl->nn, 2));
+    TEST_ASSERT_EQUAL_INT(-1, iu_smoothlife_set_method(sl, 3));
+    TEST_ASSERT_EQUAL_INT(-1, iu_smoothlife_set_method(sl, -1));
+    TEST_ASSERT_EQUAL_INT(SMOOTHLIFE_AUTO, sl->method);
+
+    for (int i = 0; i < nrows * ncols; i++) {
+        TEST_ASSERT_EQUAL_FLOAT(0, sl->field[i]);
+    }
+
+    for (int k = 0; k < sl->nm; k++) {
+        msum += sl->m_weights[k];
+    }
+
+    for (int k = 0; k < sl->nn; k++) {
+        nsum += sl->n_weights[k];
+    }
+
+    TEST_ASSERT_DOUBLE_WITHIN(1e-5, 1.0, msum);
+    TEST_ASSERT_DOUBLE_WITHIN(1e-5, 1.0, nsum);
+
+    iu_smoothlife_free(sl);
+    iu_smoothlife_free(NULL);
+}
+
+// A constant field fills both neighbourhoods to the same level.
+void test_smoothlife_uniform(void)
+{
+    struct iu_smoothlife *sl = iu_smoothlife_create(nrows, ncols, NULL);
+    int isa = iu_dispatch_isa();
+
+    TEST_ASSERT_NOT_NULL(sl);
+
+    for (int i = 0; i < nrows * ncols; i++) {
+        sl->field[i] = 0.3f;
+    }
+
+    for (int k = 0; k < NUM_ISAS; k++) {
+        if (iu_dispatch_set_isa(k) != 0) {
+            continue;
+        }
+
+        iu_smoothlife_integrals(sl);
+
+        for (int i = 0; i < nrows * ncols; i++) {
+            TEST_ASSERT_DOUBLE_WITHIN(INTEGRAL_DELTA, 0.3, sl->m[i]);
+            TEST_ASSERT_DOUBLE_WITHIN(INTEGRAL_DELTA, 0.3, sl->n[i]);
+        }
+    }
+
+    iu_smoothlife_free(sl);
+    iu_dispatch_set_isa(isa);
+}
+
+void test_smoothlife_integrals(void)
+{
+    struct iu_smoothlife_params p;
+    struct iu_smoothlife *sl;
+
+    iu_smoothlife_default_params(&p);
+    p.ri = 2.5f;
+    p.ra = 7.5f;
+
+    sl = iu_smoothlife_create(nrows, ncols, &p);
+    TEST_ASSERT_NOT_NULL(sl);
+    random_field(sl->field, nrows * ncols);
+    check_integrals(sl);
+    iu_smoothlife_free(sl);
+
+    sl = iu_smoothlife_create(nrows, ncols, NULL);
+    TEST_ASSERT_NOT_NULL(sl);
+    random_field(sl->field, nrows * ncols);
+    check_integrals(sl);
+    iu_smoothlife_free(sl);
+}
+
+// Neighbourhoods wider than the grid wrap around it several times.
+void test_smoothlife_small_grid(void)
+{
+    struct iu_smoothlife_params p;
+    struct iu_smoothlife *sl;
+
+    iu_smoothlife_default_params(&p);
+    p.ri = 3.0f;
+    p.ra = 9.0f;
+
+    sl = iu_smoothlife_create(5, 9, &p);
+    TEST_ASSERT_NOT_NULL(sl);
+    random_field(sl->field, 5 * 9);
+    check_integrals(sl);
+    iu_smoothlife_free(sl);
+
+    sl = iu_smoothlife_create(1, 1, &p);
+    TEST_ASSERT_NOT_NULL(sl);
+    sl->field[0] = 0.7f;
+    check_integrals(sl);
+    iu_smoothlife_free(sl);
+}
+
+// After a step, m and n hold the integrals of the previous field, so the new
+// field can be checked cell by cell against the reference transition.
+void test_smoothlife_step(void)
+{
+    struct iu_smoothlife_params p;
+    struct iu_smoothlife *sl;
+    int isa = iu_dispatch_isa();
+    int cells = nrows * ncols;
+    float *before = malloc(cells * sizeof(float));
+    float dts[] = {0, 0.1f};
+
+    TEST_ASSERT_NOT_NULL(before);
+
+    iu_smoothlife_default_params(&p);
+    p.ri = 2.5f;
+    p.ra = 7.5f;
+
+    for (int d = 0; d < 2; d++) {
+        p.dt = dts[d];
+        sl = iu_smoothlife_create(nrows, ncols, &p);
+        TEST_ASSERT_NOT_NULL(sl);
+
+        for (int k = 0; k < NUM_ISAS; k++) {
+            if (iu_dispatch_set_isa(k) != 0) {
+                continue;
+            }
+
+            random_field(sl->field, cells);
+            memcpy(before, sl->field, cells * sizeof(float));
+
+            for (int step = 0; step < 3; step++) {
+                iu_smoothlife_step(sl);
+
+                for (int i = 0; i < cells; i++) {
+                    double expected = reference_transition(&p, before[i], sl->m[i], sl->n[i]);
+
+                    TEST_ASSERT_DOUBLE_WITHIN(1e-5, expected, sl->field[i]);
+                    TEST_ASSERT_TRUE(sl->field[i] >= 0 && sl->field[i] <= 1);
+                }
+
+                memcpy(before, sl->field, cells * sizeof(float));
+            }
+        }
+
+        iu_smoothlife_free(sl);
+    }
+
+    free(before);
+    iu_dispatch_set_isa(isa);
+}
@@ -0,0 +1,358 @@
+#include "unity.h"
+#include "sparse.h"
+#include "dispatch.h"
+#include "constants.h"
+#include <stdlib.h>
+#include <float.h>
+#include <math.h>
+
+#define FLT_DELTA (2e2 * FLT_EPSILON)
+#define DBL_DELTA (2e2 * DBL_EPSILON)
+
+#define NUM_ISAS 3
+
+// Maximum number of nonzeros in a row. Row lengths are drawn uniformly from
+// zero to this, so the matrix has empty rows and ragged chunks.
+#define MAX_ROW_LEN 40
+
+// Global variables for a random CSR matrix and the vectors multiplied by it.
+int *rowptr = NULL, *colind = NULL;
+float *valf = NULL, *xf = NULL, *yf = NULL, *exactf = NULL;
+double *vald = NULL, *xd = NULL, *yd = NULL, *exactd = NULL;
+
+// Matrix dimensions. The odd row count leaves a partial last chunk.
+int nrows = 1003;
+int ncols = 517;
+
+// Random seed for srand call.
+unsigned random_seed = 0;
+
+// Window sizes exercised by the SELL tests, from no sorting to sorting the
+// whole matrix.
+int sigmas[] = {1, 16, 64, 1 << 30};
+int num_sigmas = sizeof(sigmas) / sizeof(sigmas[0]);
+
+// Forward declarations needed to use Unity.
+void setUp(void);
+void tearDown(void);
+
+// Forward declarations for building the matrix.
+void random_csr(void);
+
+// Forward declarations for tests.
+void test_sparse_csr(void);
+void test_sparse_sell_layout(void);
+void test_sparse_sell_fspmv(void);
+void test_sparse_sell_dspmv(void);
+void test_sparse_empty(void);
+void test_sparse_sell_nonfinite(void);
+
+int main(int argc, char *argv[])
+{
+    if (argc > 1) {
+        nrows = strtol(argv[1], NULL, 10);
+    }
+
+    if (argc > 2) {
+        random_seed = strtoul(argv[2], NULL, 10);
+    }
+
+    UNITY_BEGIN();
+
+    RUN_TEST(test_sparse_csr);
+    RUN_TEST(test_sparse_sell_layout);
+    RUN_TEST(test_sparse_sell_fspmv);
+    RUN_TEST(test_sparse_sell_dspmv);
+    RUN_TEST(test_sparse_empty);
+    RUN_TEST(test_sparse_sell_nonfinite);
+
+    return UNITY_END();
+}
+
+void setUp(void)
+{
+    srand(random_seed);
+
+    rowptr = calloc(nrows + 1, sizeof(int));
+    colind = calloc(nrows * MAX_ROW_LEN, sizeof(int));
+    valf = calloc(nrows * MAX_ROW_LEN + 2 * ncols + 2 * (nrows + 1), sizeof(float));
+    vald = calloc(nrows * MAX_ROW_LEN + 2 * ncols + 2 * (nrows + 1), sizeof(double));
+
+    if (rowptr != NULL && colind != NULL && valf != NULL && vald != NULL) {
+        xf = valf + nrows * MAX_ROW_LEN;
+        exactf = xf + ncols;
+        yf = exactf + nrows + 1;
+        xd = vald + nrows * MAX_ROW_LEN;
+        exactd = xd + ncols;
+        yd = exactd + nrows + 1;
+        random_csr();
+    } else {
+        tearDown();
+    }
+}
+
+void tearDown(void)
+{
+    free(rowptr);
+    free(colind);
+    free(valf);
+    free(vald);
+
+    rowptr = colind = NULL;
+    valf = xf = yf = exactf = NULL;
+    vald = xd = yd = exactd = NULL;
+}
+
+// Build a random matrix with distinct, unsorted columns in every row, along
+// with its product with a random vector in double precision.
+void random_csr(void)
+{
+    for (int c = 0; c < ncols; c++) {
+        xf[c] = -1.0f + 2.0f * ((float)rand() / RAND_MAX);
+        xd[c] = -1.0 + 2.0 * ((double)rand() / RAND_MAX);
+    }
+
+    for (int r = 0; r < nrows; r++) {
+        int len = rand() % (MAX_ROW_LEN + 1);
+        double sumf = 0, sumd = 0;
+
+        rowptr[r + 1] = rowptr[r] + len;
+
+        for (int j = 0; j < len; j++) {
+            int k = rowptr[r] + j;
+
+            colind[k] = (r * 7 + j * 13) % ncols;
+            valf[k] = -1.0f + 2.0f * ((float)rand() / RAND_MAX);
+            vald[k] = -1.0 + 2.0 * ((double)rand() / RAND_MAX);
+
+            sumf += (double)valf[k] * xf[colind[k]];
+            sumd += vald[k] * xd[colind[k]];
+        }
+
+        exactf[r] = (float)sumf;
+        exactd[r] = sumd;
+    }
+}
+
+//----------------------------------------------------------------------------
+// Tests for the sparse matrix-vector products. Every product is checked
+// against a serial reference under each instruction set the host supports.
+//----------------------------------------------------------------------------
+
+// Rows are reduced in blocks, so the odd row count also covers the rows left
+// over after the last block, and the element past the end of y must be left
+// alone.
+void test_sparse_csr(void)
+{
+    int isa = iu_dispatch_isa();
+    int gather = iu_dispatch_gather();
+
+    for (int k = 0; k < NUM_ISAS; k++) {
+        if (iu_dispatch_set_isa(k) != 0) {
+            continue;
+        }
+
+        for (int mode = IU_GATHER_HARDWARE; mode <= IU_GATHER_EMULATED; mode++) {
+            TEST_ASSERT_EQUAL_INT(0, iu_dispatch_set_gather(mode));
+
+            for (int r = 0; r <= nrows; r++) {
+                yf[r] = 0;
+                yd[r] = 0;
+            }
+
+            iu_sspmv_csr(nrows, rowptr, colind, valf, xf, yf);
+            iu_dspmv_csr(nrows, rowptr, colind, vald, xd, yd);
+
+            TEST_ASSERT_FLOAT_ARRAY_WITHIN(MAX_ROW_LEN * FLT_DELTA, exactf, yf, nrows);
+            TEST_ASSERT_DOUBLE_ARRAY_WITHIN(MAX_ROW_LEN * DBL_DELTA, exactd, yd, nrows);
+            TEST_ASSERT_EQUAL_FLOAT(0.0f, yf[nrows]);
+            TEST_ASSERT_EQUAL_DOUBLE(0.0, yd[nrows]);
+        }
+    }
+
+    iu_dispatch_set_gather(gather);
+    iu_dispatch_set_isa(isa);
+}
+
+// Rows must be a permutation, sorted by decreasing length inside each
+// window, and each chunk must be exactly as wide as its longest row.
+void test_sparse_sell_layout(void)
+{
+    for (int s = 0; s < num_sigmas; s++) {
+        struct iu_ssell *a = iu_ssell_from_csr(nrows, ncols, rowptr, colind, valf, sigmas[s]);
+        int *seen = calloc(nrows, sizeof(int));
+
+        TEST_ASSERT_NOT_NULL(a);
+        TEST_ASSERT_NOT_NULL(seen);
+        TEST_ASSERT_EQUAL_INT((nrows + SELL_CHUNK_PS - 1) / SELL_CHUNK_PS, a->nchunks);
+
+        for (int i = 0; i < nrows; i++) {
+            seen[a->perm[i]]++;
+
+            if (sigmas[s] > 1 && i % sigmas[s] != 0) {
+                int prev = a->perm[i - 1];
+                int cur = a->perm[i];
+
+                TEST_ASSERT_TRUE(rowptr[prev + 1] - rowptr[prev] >= rowptr[cur + 1] - rowptr[cur]);
+            }
+        }
+
+        for (int i = 0; i < nrows; i++) {
+            TEST_ASSERT_EQUAL_INT(1, seen[i]);
+        }
+
+        for (int k = 0; k < a->nchunks; k++) {
+            int width = 0;
+
+            for (int i = k * SELL_CHUNK_PS; i < nrows && i < (k + 1) * SELL_CHUNK_PS; i++) {
+                int len = rowptr[a->perm[i] + 1] - rowptr[a->perm[i]];
+
+                width = len > width ? len : width;
+            }
+
+            TEST_ASSERT_EQUAL_INT(width * SELL_CHUNK_PS, a->chunkptr[k + 1] - a->chunkptr[k]);
+        }
+
+        free(seen);
+        iu_ssell_free(a);
+    }
+}
+
+void test_sparse_sell_fspmv(void)
+{
+    int isa = iu_dispatch_isa();
+
+    for (int s = 0; s < num_sigmas; s++) {
+        struct iu_ssell *a = iu_ssell_from_csr(nrows, ncols, rowptr, colind, valf, sigmas[s]);
+
+        TEST_ASSERT_NOT_NULL(a);
+
+        for (int k = 0; k < NUM_ISAS; k++) {
+            if (iu_dispatch_set_isa(k) != 0) {
+                continue;
+            }
+
+            // The element past the end of y must be left alone.
+            for (int r = 0; r <= nrows; r++) {
+                yf[r] = 0;
+            }
+
+            iu_sspmv_sell(a, xf, yf);
+
+            TEST_ASSERT_FLOAT_ARRAY_WITHIN(MAX_ROW_LEN * FLT_DELTA, exactf, yf, nrows);
+            TEST_ASSERT_EQUAL_FLOAT(0.0f, yf[nrows]);
+        }
+
+        iu_ssell_free(a);
+    }
+
+    iu_dispatch_set_isa(isa);
+}
+
+void test_sparse_sell_dspmv(void)
+{
+    int isa = iu_dispatch_isa();
+
+    for (int s = 0; s < num_sigmas; s++) {
+        struct iu_dsell *a = iu_dsell_from_csr(nrows, ncols, rowptr, colind, vald, sigmas[s]);
+
+        TEST_ASSERT_NOT_NULL(a);
+
+        for (int k = 0; k < NUM_ISAS; k++) {
+            if (iu_dispatch_set_isa(k) != 0) {
+                continue;
+            }
+
+            for (int r = 0; r <= nrows; r++) {
+                yd[r] = 0;
+            }
+
+            iu_dspmv_sell(a, xd, yd);
+
+            TEST_ASSERT_DOUBLE_ARRAY_WITHIN(MAX_ROW_LEN * DBL_DELTA, exactd, yd, nrows);
+            TEST_ASSERT_EQUAL_DOUBLE(0.0, yd[nrows]);
+        }
+
+        iu_dsell_free(a);
+    }
+
+    iu_dispatch_set_isa(isa);
+}
+
+// Matrices without rows or without nonzeros convert and multiply cleanly.
+void test_sparse_empty(void)
+{
+    int zero_rowptr[4] = {0, 0, 0, 0};
+    float yzero[3] = {1.0f, 1.0f, 1.0f};
+    struct iu_ssell *none = iu_ssell_from_csr(0, ncols, zero_rowptr, colind, valf, 16);
+    struct iu_ssell *empty = iu_ssell_from_csr(3, ncols, zero_rowptr, colind, valf, 16);
+
+    TEST_ASSERT_NOT_NULL(none);
+    TEST_ASSERT_NOT_NULL(empty);
+    TEST_ASSERT_EQUAL_INT(0, none->nchunks);
+    TEST_ASSERT_EQUAL_INT(0, empty->chunkptr[empty->nchunks]);
+
+    iu_sspmv_sell(none, xf, yzero);
+    TEST_ASSERT_EQUAL_FLOAT(1.0f, yzero[0]);
+
+    iu_sspmv_sell(empty, xf, yzero);
+
+    for (int r = 0; r < 3; r++) {
+        TEST_ASSERT_EQUAL_FLOAT(0.0f, yzero[r]);
+    }
+
+    iu_ssell_free(none);
+    iu_ssell_free(empty);
+}
+
+// A NaN or infinity in x must only reach the rows that use its column; the
+// padding of every other row is masked out, whichever gathers are in use.
+void test_sparse_sell_nonfinite(void)
+{
+    int isa = iu_dispatch_isa();
+    int gather = iu_dispatch_gather();
+    int *uses = calloc(nrows, sizeof(int));
+    struct iu_ssell *af = iu_ssell_from_csr(nrows, ncols, rowptr, colind, valf, 16);
+    struct iu_dsell *ad = iu_dsell_from_csr(nrows, ncols, rowptr, colind, vald, 16);
+
+    TEST_ASSERT_NOT_NULL(uses);
+    TEST_ASSERT_NOT_NULL(af);
+    TEST_ASSERT_NOT_NULL(ad);
+
+    xf[0] = NAN;
+    xd[0] = INFINITY;
+
+    for (int r = 0; r < nrows; r++) {
+        for (int k = rowptr[r]; k < rowptr[r + 1]; k++) {
+            uses[r] |= colind[k] == 0;
+        }
+    }
+
+    for (int k = 0; k < NUM_ISAS; k++) {
+        if (iu_dispatch_set_isa(k) != 0) {
+            continue;
+        }
+
+        for (int mode = IU_GATHER_HARDWARE; mode <= IU_GATHER_EMULATED; mode++) {
+            TEST_ASSERT_EQUAL_INT(0, iu_dispatch_set_gather(mode));
+            iu_sspmv_sell(af, xf, yf);
+            iu_dspmv_sell(ad, xd, yd);
+
+            for (int r = 0; r < nrows; r++) {
+                if (uses[r]) {
+                    TEST_ASSERT_TRUE(isnan(yf[r]));
+                    TEST_ASSERT_FALSE(isfinite(yd[r]));
+                } else {
+                    TEST_ASSERT_FLOAT_WITHIN(MAX_ROW_LEN * FLT_DELTA, exactf[r], yf[r]);
+                    TEST_ASSERT_DOUBLE_WITHIN(MAX_ROW_LEN * DBL_DELTA, exactd[r], yd[r]);
+                }
+            }
+        }
+    }
+
+    free(uses);
+    iu_ssell_free(af);
+    iu_dsell_free(ad);
+    iu_dispatch_set_gather(gather);
+    iu_dispatch_set_isa(isa);
+}